@@ -32,6 +32,8 @@
 #  endif
 #endif
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -56,7 +58,9 @@ enum MDAL_Status
   Warn_InvalidElements,
   Warn_ElementWithInvalidNode,
   Warn_ElementNotUnique,
-  Warn_NodeNotUnique
+  Warn_NodeNotUnique,
+  // Errors added later, kept at the end so the values above do not change
+  Err_Cancelled
 };
 
 /**
@@ -74,20 +78,301 @@ enum MDAL_DataLocation
   DataOnVolumes3D
 };
 
+/**
+ * Order of the values in the buffer filled by MDAL_G_dataBlock
+ */
+enum MDAL_DataBlockLayout
+{
+  //! Values of each dataset are contiguous, buffer[dataset][index]
+  TimeMajor = 0,
+  //! Time series of each face/vertex are contiguous, buffer[index][dataset]
+  IndexMajor
+};
+
+/**
+ * Aggregation of the volumes of the face column used by MDAL_G_addAveragedGroup
+ *
+ * Levels are counted from 0, ranges average the values weighted by the thickness
+ * of the part of the volume in the range
+ */
+enum MDAL_AveragingMethod
+{
+  //! Value of the volume startParameter counted from the surface
+  SINGLE_LEVEL_FROM_TOP = 0,
+  //! Value of the volume startParameter counted from the bed
+  SINGLE_LEVEL_FROM_BOTTOM,
+  //! Range between fractions startParameter and endParameter of the water column, 0 is the bed and 1 the surface
+  SIGMA,
+  //! Range between depths startParameter and endParameter below the surface
+  DEPTH_FROM_SURFACE,
+  //! Range between heights startParameter and endParameter above the bed
+  HEIGHT_FROM_BED,
+  //! Range between absolute elevations startParameter and endParameter
+  ELEVATION
+};
+
+/**
+ * Aggregation of all datasets of the group used by MDAL_G_addTemporalAggregateGroup
+ *
+ * Vectors are aggregated as their magnitudes
+ */
+enum MDAL_TemporalAggregate
+{
+  //! Maximum value over the time steps
+  TemporalMaximum = 0,
+  //! Minimum value over the time steps
+  TemporalMinimum,
+  //! Mean of the valid values over the time steps
+  TemporalMean,
+  //! Time of the first time step with the maximum value, in hours relative to the reference time
+  TimeOfMaximum
+};
+
+/**
+ * Weights of the values averaged by MDAL_G_addConvertedGroup
+ *
+ * The weight of the face and its vertex is the same for the conversion from vertices to faces
+ * and from faces to vertices
+ */
+enum MDAL_ConversionWeighting
+{
+  //! All vertices of the face (faces of the vertex) have the same weight
+  EqualWeights = 0,
+  //! Area of the part of the face closest to the vertex
+  AreaWeights,
+  //! Inverse distance of the vertex from the centre of the face (mean of its vertices)
+  InverseDistanceWeights
+};
+
+/**
+ * Aggregation of the values of the full mesh to the elements of the level of detail used by MDAL_G_addLevelOfDetailGroup
+ */
+enum MDAL_LevelOfDetailAggregate
+{
+  //! Mean of the valid values, vectors are averaged by components
+  LevelMean = 0,
+  //! Maximum of the valid values, vectors take the vector with the largest magnitude
+  LevelMaximum
+};
+
+/**
+ * Render vertices of the buffers created by MDAL_M_renderBuffers
+ */
+enum MDAL_RenderVertices
+{
+  //! Vertices of the mesh, shared by the triangles of the neighbouring faces, for values on vertices
+  RenderSharedVertices = 0,
+  //! Corners of the faces in the order of the faces and their vertices, for values on faces or vertices
+  RenderFaceCorners
+};
+
+/**
+ * Type of the values written by MDAL_RB_values
+ */
+enum MDAL_RenderValueType
+{
+  //! float, invalid values are numeric_limits<float>::quiet_NaN
+  RenderFloat32 = 0,
+  //! uint16_t quantized linearly from the range minimum to maximum to 0 to 65534, invalid values are 65535
+  RenderUInt16
+};
+
 typedef void *MeshH;
 typedef void *MeshVertexIteratorH;
 typedef void *MeshFaceIteratorH;
+typedef void *MeshAdjacencyIteratorH;
+typedef void *DatasetVolumeIteratorH;
+typedef void *ContourIteratorH;
+typedef void *RenderBuffersH;
 typedef void *DatasetGroupH;
 typedef void *DatasetH;
 typedef void *DriverH;
 typedef void *AveragingMethodH;
 
+//! Called on the background thread of MDAL_LoadMesh with PROGRESSIVE_LOAD open option once the group is ready
+typedef void ( *MDAL_GroupReadyCallback )( DatasetGroupH group, void *userData );
+
+//! Called with the progress of the load or save between 0 and 1, returning false cancels it
+typedef bool ( *MDAL_ProgressCallback )( double progress, void *userData );
+
 //! Returns MDAL version
 MDAL_EXPORT const char *MDAL_Version();
 
-//! Returns last status message
+/**
+ * Returns last status message
+ *
+ * The status is kept for each thread separately.
+ *
+ * Threading: all functions may be called from several threads. Loading, saving,
+ * editing and closing of meshes are serialized internally. Reading of values
+ * (MDAL_D_data, MDAL_G_dataBlock, MDAL_M_sampleTimeSeries, MDAL_D_minimumMaximum,
+ * MDAL_G_minimumMaximum, mesh iterators)
+ * runs concurrently on any handles, also the same one; reads of datasets held in memory
+ * run in parallel, reads from files (e.g. HDF5 or NetCDF) are serialized internally.
+ * The mesh must not be edited or closed while other threads read from it.
+ */
 MDAL_EXPORT MDAL_Status MDAL_LastStatus();
 
+//! Sets option used for all subsequent loads of meshes and datasets
+//! Empty or null value removes the option
+//!
+//! Supported options:
+//!  - "LAZY_STATISTICS": "YES" to calculate dataset and group minimum/maximum on first
+//!    call of MDAL_D_minimumMaximum/MDAL_G_minimumMaximum instead of during the load. Default "NO"
+//!  - "QUANTILE_SKETCH": "YES" to build quantile sketches of the values (magnitudes for vectors) together
+//!    with the minimum and maximum, so they are cached in STATISTICS_CACHE_DIR too. Otherwise the sketches
+//!    are built on first call of the quantile and histogram functions. Default "NO"
+//!  - "STATISTICS_CACHE_DIR": path to existing directory where the statistics are stored
+//!    after the load, so next load of the same unchanged file (same path, size and
+//!    modification time) does not need to calculate them. Not set by default
+//!  - "HDF5_CHUNK_CACHE_SIZE": maximum size in bytes of the chunk cache of one chunked HDF5 dataset.
+//!    The cache is sized to hold the chunks of one time step up to this size. Default 33554432 (32 MB),
+//!    values up to 1048576 keep the HDF5 library default
+//!  - "MEMORY_BUDGET": bytes of the large mesh and memory dataset arrays (1 MB and more) kept on the heap.
+//!    Arrays allocated over the budget are mapped from deleted temporary files, so the operating system
+//!    can page them out. Not set by default (no limit)
+//!  - "SPILL_DIR": directory of the temporary files used over MEMORY_BUDGET, system temporary directory by default
+//!  - "SINGLE_PRECISION": YES to store values of the datasets held in memory as floats, which halves
+//!    their memory. Values are still returned as doubles, or as floats with SCALAR_FLOAT and VECTOR_2D_FLOAT
+//!  - "COMPRESS_DATASETS": YES to compress values of the datasets held in memory once they are loaded or added
+//!    by MDAL_G_addDataset. Values are compressed losslessly in blocks, which are decompressed on read,
+//!    so large NaN regions and smooth fields take a fraction of their memory. Default "NO"
+//!  - "SPARSE_DATASETS": maximum fraction (0-1) of valid values of the datasets held in memory that are
+//!    stored sparse, as the runs of valid values only, once they are loaded or added by MDAL_G_addDataset.
+//!    Suits flood results with mostly dry (NaN) faces. Not set by default (all datasets are dense)
+//!  - "HDF5_DEFLATE_LEVEL": deflate level (1-9) of the time step values of datasets written to HDF5
+//!    files (FLO-2D). Not set by default (uncompressed)
+//!  - "REORDER_ELEMENTS": YES to sort vertices and faces of meshes held in memory along the Hilbert curve
+//!    on load, so the elements close in space get close indices. Vertex, face and dataset value indices
+//!    then differ from the file, see MDAL_M_originalVertexIndices and MDAL_M_originalFaceIndices.
+//!    Datasets loaded later are reordered too, values of those stored in files are read to memory. Default "NO"
+//!  - "PROGRESSIVE_LOAD": YES to return meshes from MDAL_LoadMesh as soon as the file is parsed and the dataset
+//!    groups discovered. Statistics of the datasets and groups are then calculated by a background thread,
+//!    group by group, see MDAL_G_isReady. Statistics requested earlier are calculated on request. Default "NO"
+//!  - "REMOTE_BLOCK_SIZE": size in bytes of the blocks fetched by range requests from the remote files
+//!    (http://, https:// and s3:// uris, MDAL must be built with libcurl). Default 1048576 (1 MB)
+//!  - "REMOTE_CACHE_SIZE": maximum size in bytes of the blocks cached for one remote file. Default 67108864 (64 MB)
+//!  - "REMOTE_READAHEAD": number of blocks fetched ahead when the reads of a remote file are sequential. Default 4
+//!  - "S3_ENDPOINT": endpoint of the s3://bucket/key uris, read as endpoint/bucket/key. When not set,
+//!    https://bucket.s3.amazonaws.com/key is read. Requests are not signed, only public objects are readable
+MDAL_EXPORT void MDAL_SetOpenOption( const char *name, const char *value );
+
+//! Returns value of the option set by MDAL_SetOpenOption, empty string if not set
+//! valid only till next call from the same thread
+MDAL_EXPORT const char *MDAL_OpenOption( const char *name );
+
+//! Sets budget in bytes of the cache of the values read by MDAL_D_data
+//!
+//! Only datasets read from files are cached. The block is served from the cache
+//! when it is requested again with the same dataset, data type, start index and count.
+//! The least recently used blocks are removed when the budget is exceeded.
+//! 0 disables the cache and removes all blocks, which is the default
+MDAL_EXPORT void MDAL_SetCacheSize( long long bytes );
+
+//! Returns budget of the cache in bytes set by MDAL_SetCacheSize
+MDAL_EXPORT long long MDAL_CacheSize();
+
+//! Returns number of MDAL_D_data requests served from the cache since the library was loaded
+MDAL_EXPORT long long MDAL_CacheHits();
+
+//! Returns number of MDAL_D_data requests not found in the enabled cache since the library was loaded
+MDAL_EXPORT long long MDAL_CacheMisses();
+
+//! Sets maximum number of idle HDF5 files kept open for the following loads
+//!
+//! Loads of the same unchanged file (same path, size and modification time) share one open handle
+//! while any mesh or dataset uses it, regardless of this setting. Handles released by all their users
+//! are kept open up to this count, the least recently used are closed over it, so files loaded again
+//! are not reopened. Files are closed before they are written. 0 closes the files with their last user,
+//! which is the default
+MDAL_EXPORT void MDAL_SetFileHandlePoolSize( int count );
+
+//! Returns maximum number of idle files kept open set by MDAL_SetFileHandlePoolSize
+MDAL_EXPORT int MDAL_FileHandlePoolSize();
+
+//! Sets maximum number of HDF5 files open for reading at once, in use or idle
+//!
+//! The least recently used idle files are closed to open a file at the limit. When all files are in use,
+//! the open waits until a mesh or dataset releases its file and fails after 10 seconds, so the limit
+//! must not be lower than the number of files used at once by the meshes of the thread. 0 is no limit,
+//! which is the default
+MDAL_EXPORT void MDAL_SetFileHandleLimit( int count );
+
+//! Returns maximum number of files open at once set by MDAL_SetFileHandleLimit
+MDAL_EXPORT int MDAL_FileHandleLimit();
+
+//! Returns number of HDF5 files opened for reading since the library was loaded
+MDAL_EXPORT long long MDAL_FileHandleOpens();
+
+//! Returns number of HDF5 file opens served by a handle already open since the library was loaded
+MDAL_EXPORT long long MDAL_FileHandleReuses();
+
+//! Returns number of opens of the HDF5 files that had been open and were closed since the library was loaded
+MDAL_EXPORT long long MDAL_FileHandleReopens();
+
+//! Sets number of datasets read to the cache in the background after a dataset is read by MDAL_D_data
+//!
+//! When a block of dataset t is read from the file, the same block of datasets t+1 .. t+count
+//! of the group is read on a background thread, so it is likely cached when requested next.
+//! Needs the cache enabled by MDAL_SetCacheSize. 0 disables it, which is the default
+MDAL_EXPORT void MDAL_SetPrefetchCount( int count );
+
+//! Returns number of datasets read in the background set by MDAL_SetPrefetchCount
+MDAL_EXPORT int MDAL_PrefetchCount();
+
+//! Sets maximum number of threads used by parallel tasks, e.g. calculation of statistics or parsing of large 2DM files
+//!
+//! 1 disables the parallel processing. 0 restores the default, which is the value of MDAL_NUM_THREADS
+//! environment variable when set, number of processor cores otherwise
+MDAL_EXPORT void MDAL_SetThreadCount( int count );
+
+//! Returns maximum number of threads used by parallel tasks, see MDAL_SetThreadCount
+MDAL_EXPORT int MDAL_ThreadCount();
+
+//! Enables sharing of the meshes loaded by MDAL_LoadMesh
+//!
+//! While any handle of a mesh is open, MDAL_LoadMesh of the same unchanged file (same path, size
+//! and modification time) with the same open options returns the loaded mesh instead of reading
+//! the file again, e.g. for concurrent requests on the same model. Each MDAL_LoadMesh must be still
+//! paired with MDAL_CloseMesh, the mesh is freed with its last handle.
+//! Shared meshes are immutable: functions adding dataset groups or metadata fail with Err_IncompatibleMesh
+//! while the mesh has other handles. The only handle is detached first, so the following loads do not see the edits.
+//! Disabled by default, disabling does not affect the handles already open
+MDAL_EXPORT void MDAL_SetMeshSharing( bool enabled );
+
+//! Returns whether the meshes are shared, see MDAL_SetMeshSharing
+MDAL_EXPORT bool MDAL_MeshSharing();
+
+//! Sets function called on the background threads of progressive loads once a group is ready, see MDAL_G_isReady
+//! Null removes it. The function must not close the mesh of the group
+MDAL_EXPORT void MDAL_SetGroupReadyCallback( MDAL_GroupReadyCallback callback, void *userData );
+
+//! Sets function reporting the progress of the loads and saves of the calling thread: MDAL_LoadMesh,
+//! MDAL_M_LoadDatasets, MDAL_M_LoadDatasetsBatch, MDAL_SaveMesh, MDAL_SaveMeshWithUri and MDAL_SaveMeshToBuffer.
+//! The function is called on the calling thread only, at the granularity of the driver (e.g. blocks of lines or timesteps),
+//! drivers without the support report the end only. Returning false cancels the operation,
+//! which then fails with Err_Cancelled and leaves no partial mesh or dataset groups. Null removes it
+MDAL_EXPORT void MDAL_SetProgressCallback( MDAL_ProgressCallback callback, void *userData );
+
+//! Copies names and values of the performance counters collected since the library was loaded or reset
+//!
+//! Counters include loads, loads of datasets, saves, persisted groups, dataset reads and statistics calculations,
+//! each with its total time in microseconds (".time_us"), bytes returned by dataset reads and bytes read from HDF5,
+//! NetCDF and mapped files. Counters per driver are named "driver.<name>.<operation>.count" and ".time_us".
+//! Up to size names and values are copied (either may be null), the names stay valid while the library is loaded.
+//! Returns number of the counters, 0 when MDAL is built without ENABLE_PERF_COUNTERS
+MDAL_EXPORT int MDAL_GetPerfCounters( const char **names, long long *values, int size );
+
+//! Sets all performance counters to zero and removes the recorded trace events
+MDAL_EXPORT void MDAL_ResetPerfCounters();
+
+//! Enables recording of the trace events of loads, saves, dataset reads and statistics calculations, disabled by default
+MDAL_EXPORT void MDAL_SetTracing( bool enabled );
+
+//! Writes the recorded trace events to the file in Chrome trace JSON format (chrome://tracing, Perfetto)
+//! Sets Err_FailToWriteToDisk when the file cannot be written
+MDAL_EXPORT void MDAL_WriteTrace( const char *path );
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// DRIVERS
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -113,17 +398,20 @@ MDAL_EXPORT bool MDAL_DR_writeDatasetsCapability( DriverH driver, MDAL_DataLocat
 //! Returns whether driver has capability to save mesh
 MDAL_EXPORT bool MDAL_DR_saveMeshCapability( DriverH driver );
 
+//! Returns whether driver has capability to save mesh to a memory buffer, see MDAL_SaveMeshToBuffer
+MDAL_EXPORT bool MDAL_DR_saveMeshToBufferCapability( DriverH driver );
+
 //! Returns name of MDAL driver
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_DR_name( DriverH driver );
 
 //! Returns long name of MDAL driver
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_DR_longName( DriverH driver );
 
 //! Returns file filters that MDAL driver recognizes
 //! Filters are separated by ;;, e.g. *.abc;;*.def
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_DR_filters( DriverH driver );
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -136,28 +424,84 @@ MDAL_EXPORT const char *MDAL_DR_filters( DriverH driver );
 MDAL_EXPORT MeshH MDAL_LoadMesh( const char *meshFile );
 
 //! Closes mesh, frees the memory
+//! For meshes shared by several handles (see MDAL_SetMeshSharing) frees the memory with the last handle
 MDAL_EXPORT void MDAL_CloseMesh( MeshH mesh );
 
 //! Saves mesh (only mesh structure) on a file with the specified driver. On error see MDAL_LastStatus for error type.
 MDAL_EXPORT void MDAL_SaveMesh( MeshH mesh, const char *meshFile, const char *driver );
 
+//! Saves mesh (only mesh structure) to a memory buffer with the specified driver, without any file written,
+//! e.g. to send the mesh over the network. The driver must have MDAL_DR_saveMeshToBufferCapability.
+//! The buffer holds the same bytes as the file saved by MDAL_SaveMesh.
+//! \param buffer populated with the data, to be freed by MDAL_FreeBuffer()
+//! \returns size of the data in bytes, 0 on error, see MDAL_LastStatus for error type
+MDAL_EXPORT int64_t MDAL_SaveMeshToBuffer( MeshH mesh, const char *driver, void **buffer );
+
+//! Frees the buffer returned by MDAL_SaveMeshToBuffer
+MDAL_EXPORT void MDAL_FreeBuffer( void *buffer );
+
 //! Returns mesh projection
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_M_projection( MeshH mesh );
 //! Returns mesh extent in native projection
 //! Returns NaN on error
 MDAL_EXPORT void MDAL_M_extent( MeshH mesh, double *minX, double *maxX, double *minY, double *maxY );
 //! Returns vertex count for the mesh
 MDAL_EXPORT int MDAL_M_vertexCount( MeshH mesh );
+//! Returns vertex count for the mesh, for meshes beyond 2^31 vertices
+MDAL_EXPORT int64_t MDAL_M_vertexCount64( MeshH mesh );
 //! Returns face count for the mesh
 MDAL_EXPORT int MDAL_M_faceCount( MeshH mesh );
+//! Returns face count for the mesh, for meshes beyond 2^31 faces
+MDAL_EXPORT int64_t MDAL_M_faceCount64( MeshH mesh );
 //! Returns maximum number of vertices face can consist of, e.g. 4 for regular quad mesh
 MDAL_EXPORT int MDAL_M_faceVerticesMaximumCount( MeshH mesh );
+//! Returns number of vertices of every face when all faces of the mesh have the same number of vertices
+//! (3 for triangle meshes, 4 for quad meshes), 0 for mixed meshes, meshes without faces or on error
+//! Such meshes are stored without face offsets and processed by kernels specialized for the face size
+MDAL_EXPORT int MDAL_M_uniformFaceVerticesCount( MeshH mesh );
+//! Returns whether vertices and faces of the mesh were reordered on load, see REORDER_ELEMENTS open option
+MDAL_EXPORT bool MDAL_M_isReordered( MeshH mesh );
+//! Returns number of open handles of the mesh shared by the loads of the same file, see MDAL_SetMeshSharing
+//! 1 for meshes that are not shared, 0 on error
+MDAL_EXPORT int MDAL_M_handleCount( MeshH mesh );
+//! Returns number of bytes held in memory by the mesh and its datasets, including blocks spilled to temporary files
+//! (see MEMORY_BUDGET open option), for enforcing memory quotas
+//!
+//! Arrays of the datasets held in memory are allocated from an arena of the mesh, which is released at once
+//! when the mesh is closed. The arena counts whole, also the space of removed groups, which is reused by new datasets.
+//! Data read from the files on request and the caches of the reads are not counted. Returns 0 on error
+MDAL_EXPORT int64_t MDAL_M_memoryUsage( MeshH mesh );
+//! Returns number of the levels of detail of the mesh for rendering at lower resolutions, at least 1 (the mesh itself),
+//! 0 on error
+//!
+//! The levels are built on the first call and kept until the mesh is closed. Each level is simplified by clustering
+//! the vertices to square cells, the cells double with each level. Meshes with few faces have only the level 0
+MDAL_EXPORT int MDAL_M_levelOfDetailCount( MeshH mesh );
+//! Returns the mesh of the level of detail, the mesh itself for level 0, nullptr on error
+//! The mesh of the level is owned by the mesh and must not be closed, use MDAL_G_addLevelOfDetailGroup to add its groups
+MDAL_EXPORT MeshH MDAL_M_levelOfDetail( MeshH mesh, int level );
+//! Returns size of the cells the vertices of the level were clustered by (in the mesh units), 0 for level 0, -1 on error
+MDAL_EXPORT double MDAL_M_levelOfDetailResolution( MeshH mesh, int level );
+//! Returns the coarsest level of detail with resolution not larger than the resolution, e.g. the size of a pixel on the screen,
+//! 0 when no simplified level is fine enough, -1 on error
+MDAL_EXPORT int MDAL_M_levelOfDetailAtResolution( MeshH mesh, double resolution );
+//! Copies indices of the vertices in the source file, the same as the vertex indices when the mesh is not reordered
+//! \returns number of indices written to the buffer of count items
+MDAL_EXPORT int MDAL_M_originalVertexIndices( MeshH mesh, int indexStart, int count, int *buffer );
+//! Copies indices of the faces in the source file, the same as the face indices when the mesh is not reordered
+//! \returns number of indices written to the buffer of count items
+MDAL_EXPORT int MDAL_M_originalFaceIndices( MeshH mesh, int indexStart, int count, int *buffer );
 //! Loads dataset file. On error see MDAL_LastStatus for error type.
 //! This may effectively load whole dataset in-memory for some providers
 //! Datasets will be closed automatically on mesh destruction or memory
 //! can be freed manually with MDAL_CloseDataset if needed
 MDAL_EXPORT void MDAL_M_LoadDatasets( MeshH mesh, const char *datasetFile );
+//! Loads count dataset files, the groups are added in the order of the files. On error see MDAL_LastStatus
+//! for error type of the last file that failed, the groups of the other files are loaded anyway.
+//! ASCII and binary DAT files are parsed at once on the threads set by MDAL_SetThreadCount(),
+//! each with its own driver, files of the other drivers are loaded in turn
+MDAL_EXPORT void MDAL_M_LoadDatasetsBatch( MeshH mesh, int count, const char **datasetFiles );
 //! Returns dataset groups count
 MDAL_EXPORT int MDAL_M_datasetGroupCount( MeshH mesh );
 //! Returns dataset group handle
@@ -187,9 +531,60 @@ MDAL_EXPORT DatasetGroupH MDAL_M_addDatasetGroup( MeshH mesh,
     const char *datasetGroupFile );
 
 //! Returns name of MDAL driver
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_M_driverName( MeshH mesh );
 
+//! Populates buffer with values of all datasets of the group at point (x, y)
+//!
+//! The face containing the point is found using spatial index of the mesh, built on the first call.
+//! Values on faces are taken from the face, values on vertices are linearly interpolated
+//! within the triangle of the face containing the point. Only values of the face or
+//! its vertices are read, so the call is cheap also for datasets stored in files.
+//! For points outside of the mesh or on inactive faces the values are numeric_limits<double>::quiet_NaN
+//!
+//! \param mesh handle to mesh
+//! \param group handle to dataset group of the mesh with DataOnVertices2D or DataOnFaces2D data location
+//! \param x X coordinate of the point
+//! \param y Y coordinate of the point
+//! \param buffer output array to be populated with the values. must be already allocated
+//!               For scalar groups, the minimum size must be datasetCount * size_of(double)
+//!               For vector groups, the minimum size must be datasetCount * 2 * size_of(double).
+//!               Values are returned as x1, y1, x2, y2, ..., xN, yN
+//! \returns number of datasets written, i.e. MDAL_G_datasetCount(). On error returns 0, see MDAL_LastStatus() for error type
+MDAL_EXPORT int MDAL_M_sampleTimeSeries( MeshH mesh, DatasetGroupH group, double x, double y, double *buffer );
+
+//! Samples values of all datasets of the group at many points at once
+//!
+//! Values are the same as returned by MDAL_M_sampleTimeSeries() for each point, but the points
+//! are located in parallel and every dataset is read only once for all the points,
+//! so extraction of time series at many gauges does not read the whole datasets.
+//! Datasets are read concurrently when the driver supports it.
+//!
+//! \param mesh handle to mesh
+//! \param group handle to dataset group of the mesh with DataOnVertices2D or DataOnFaces2D data location
+//! \param pointCount number of the points
+//! \param x X coordinates of the points
+//! \param y Y coordinates of the points
+//! \param buffer output array to be populated with the values. must be already allocated
+//!               Time series of the points follow each other, point by point.
+//!               For scalar groups, the minimum size must be pointCount * datasetCount * size_of(double)
+//!               For vector groups, the minimum size must be pointCount * datasetCount * 2 * size_of(double).
+//! \returns number of datasets written, i.e. MDAL_G_datasetCount(). On error returns 0, see MDAL_LastStatus() for error type
+MDAL_EXPORT int MDAL_M_sampleTimeSeriesAtPoints( MeshH mesh, DatasetGroupH group, int pointCount, const double *x, const double *y, double *buffer );
+
+//! Reads values of all datasets of the group at the vertices or faces
+//!
+//! Indices are of vertices for groups with DataOnVertices2D, of faces for groups
+//! with DataOnFaces2D data location. Every dataset is read once for all the indices.
+//! Values on inactive faces are numeric_limits<double>::quiet_NaN
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param count number of the indices
+//! \param indices vertex or face indices, in any order, may repeat
+//! \param buffer output array with the same layout as for MDAL_M_sampleTimeSeriesAtPoints()
+//! \returns number of datasets written, i.e. MDAL_G_datasetCount(). On error returns 0, see MDAL_LastStatus() for error type
+MDAL_EXPORT int MDAL_G_timeSeriesAtIndices( DatasetGroupH group, int count, const int *indices, double *buffer );
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// MESH VERTICES
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -205,9 +600,35 @@ MDAL_EXPORT MeshVertexIteratorH MDAL_M_vertexIterator( MeshH mesh );
 //! \returns number of vertices written in the buffer
 MDAL_EXPORT int MDAL_VI_next( MeshVertexIteratorH iterator, int verticesCount, double *coordinates );
 
+//! Same as MDAL_VI_next with 64-bit count, for meshes beyond 2^31 vertices
+MDAL_EXPORT int64_t MDAL_VI_next64( MeshVertexIteratorH iterator, int64_t verticesCount, double *coordinates );
+
 //! Closes mesh data iterator, frees the memory
 MDAL_EXPORT void MDAL_VI_close( MeshVertexIteratorH iterator );
 
+//! Returns iterator to the mesh vertices inside the extent, boundary included, in ascending order of their indices
+//! The spatial index of the vertices is built on the first call and kept until the mesh is closed
+MDAL_EXPORT MeshVertexIteratorH MDAL_M_vertexIteratorInExtent( MeshH mesh, double minX, double maxX, double minY, double maxY );
+
+//! Returns number of vertices returned by the iterator created by MDAL_M_vertexIteratorInExtent, -1 for other iterators
+MDAL_EXPORT int MDAL_VI_count( MeshVertexIteratorH iterator );
+
+//! Copies mesh indices of the vertices returned by the iterator created by MDAL_M_vertexIteratorInExtent
+//! \param indexStart position of the first vertex in the iteration
+//! \returns number of indices written in the buffer, 0 for other iterators
+MDAL_EXPORT int MDAL_VI_vertexIndices( MeshVertexIteratorH iterator, int indexStart, int count, int *buffer );
+
+//! Copies vertex coordinates to separate X, Y and Z arrays (structure of arrays)
+//! For in-memory meshes the coordinates are copied in bulk without any transpose
+//! \param mesh mesh handle
+//! \param indexStart index of the first vertex to copy
+//! \param count number of vertices to copy
+//! \param xBuffer allocated array of count items to store x1, ..., xN coordinates, or null pointer to skip X coordinates
+//! \param yBuffer allocated array of count items to store y1, ..., yN coordinates, or null pointer to skip Y coordinates
+//! \param zBuffer allocated array of count items to store z1, ..., zN coordinates, or null pointer to skip Z coordinates
+//! \returns number of vertices written in the buffers
+MDAL_EXPORT int MDAL_M_vertexCoordinatesSoA( MeshH mesh, int indexStart, int count, double *xBuffer, double *yBuffer, double *zBuffer );
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// MESH FACES
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -235,9 +656,131 @@ MDAL_EXPORT int MDAL_FI_next( MeshFaceIteratorH iterator,
                               int vertexIndicesBufferLen,
                               int *vertexIndicesBuffer );
 
+//! Same as MDAL_FI_next with 64-bit face offsets and vertex indices, for meshes beyond 2^31 vertices
+//! or with face offsets overflowing int
+MDAL_EXPORT int64_t MDAL_FI_next64( MeshFaceIteratorH iterator,
+                                    int64_t faceOffsetsBufferLen,
+                                    int64_t *faceOffsetsBuffer,
+                                    int64_t vertexIndicesBufferLen,
+                                    int64_t *vertexIndicesBuffer );
+
 //! Closes mesh data iterator, frees the memory
 MDAL_EXPORT void MDAL_FI_close( MeshFaceIteratorH iterator );
 
+//! Returns iterator to the mesh faces with bounding box intersecting the extent, in ascending order of their indices
+//! The spatial index (packed Hilbert R-tree) of the faces is built on the first call and kept until the mesh is closed
+MDAL_EXPORT MeshFaceIteratorH MDAL_M_faceIteratorInExtent( MeshH mesh, double minX, double maxX, double minY, double maxY );
+
+//! Returns number of faces returned by the iterator created by MDAL_M_faceIteratorInExtent, -1 for other iterators
+MDAL_EXPORT int MDAL_FI_count( MeshFaceIteratorH iterator );
+
+//! Copies mesh indices of the faces returned by the iterator created by MDAL_M_faceIteratorInExtent
+//! \param indexStart position of the first face in the iteration
+//! \returns number of indices written in the buffer, 0 for other iterators
+MDAL_EXPORT int MDAL_FI_faceIndices( MeshFaceIteratorH iterator, int indexStart, int count, int *buffer );
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// MESH TOPOLOGY
+///////////////////////////////////////////////////////////////////////////////////////
+
+//! Returns iterator to the faces using each vertex, in ascending order
+//! The topology of the mesh (faces of vertices, face neighbours and edges) is built on the first request
+//! of any of them in parallel and kept until the mesh is closed
+MDAL_EXPORT MeshAdjacencyIteratorH MDAL_M_vertexFacesIterator( MeshH mesh );
+
+//! Returns iterator to the neighbours of each face, i.e. the faces sharing a side with the face, in ascending order
+MDAL_EXPORT MeshAdjacencyIteratorH MDAL_M_faceNeighboursIterator( MeshH mesh );
+
+//! Returns next rows (vertices or faces) from iterator, in the same layout as MDAL_FI_next
+//!
+//! Reading stops when indicesBuffer capacity is full / offsetsBuffer
+//! capacity is full / end of rows is reached, whatever comes first
+//!
+//! \param iterator mesh adjacency iterator
+//! \param offsetsBufferLen size of offsetsBuffer, minimum 1
+//! \param offsetsBuffer allocated array to store end offset of the row in indicesBuffer,
+//!                      number of items of row i is offsetsBuffer[i] - offsetsBuffer[i-1]
+//! \param indicesBufferLen size of indicesBuffer, minimum is MDAL_AI_maximumRowSize()
+//! \param indicesBuffer writes face indices of the rows
+//! \returns number of rows written in the buffer
+MDAL_EXPORT int MDAL_AI_next( MeshAdjacencyIteratorH iterator,
+                              int offsetsBufferLen,
+                              int *offsetsBuffer,
+                              int indicesBufferLen,
+                              int *indicesBuffer );
+
+//! Returns number of items of the longest row of the iterator
+MDAL_EXPORT int MDAL_AI_maximumRowSize( MeshAdjacencyIteratorH iterator );
+
+//! Closes mesh adjacency iterator, frees the memory
+MDAL_EXPORT void MDAL_AI_close( MeshAdjacencyIteratorH iterator );
+
+//! Returns number of edges (unique sides of the faces, or edges stored in the file) of the mesh
+MDAL_EXPORT int MDAL_M_edgeCount( MeshH mesh );
+
+//! Returns number of edges of the mesh, for meshes beyond 2^31 edges
+MDAL_EXPORT int64_t MDAL_M_edgeCount64( MeshH mesh );
+
+//! Copies vertex indices of edges starting from indexStart as start1, end1, ..., startN, endN
+//! \param buffer allocated array of 2 * count items
+//! \returns number of edges written in the buffer
+MDAL_EXPORT int MDAL_M_edgeVertices( MeshH mesh, int indexStart, int count, int *buffer );
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// RENDER BUFFERS
+///////////////////////////////////////////////////////////////////////////////////////
+
+//! Creates vertex and index buffers of the mesh ready for the upload to GPU
+//!
+//! Faces are split to triangles from their first vertex (fan triangulation) in parallel, the triangles
+//! of each face follow the triangles of the previous face. Positions of the render vertices are x, y, z floats
+//! relative to the origin, e.g. the centre of the mesh extent, so they keep precision of the coordinates far from zero.
+//! Faces and vertices of meshes held in memory are read in place. The buffers are kept until they are closed,
+//! they must be closed before the mesh is closed. Vertex and face indices must fit into 32 bits.
+//!
+//! \param layout render vertices, mesh vertices or face corners
+//! \param originX origin subtracted from the x coordinates
+//! \param originY origin subtracted from the y coordinates
+//! \param originZ origin subtracted from the z coordinates
+//! \returns null on error, see MDAL_LastStatus() for error type
+MDAL_EXPORT RenderBuffersH MDAL_M_renderBuffers( MeshH mesh, MDAL_RenderVertices layout, double originX, double originY, double originZ );
+
+//! Returns number of render vertices of the buffers, 0 on error
+MDAL_EXPORT int64_t MDAL_RB_vertexCount( RenderBuffersH buffers );
+
+//! Returns number of triangles of the buffers, 0 on error
+MDAL_EXPORT int64_t MDAL_RB_triangleCount( RenderBuffersH buffers );
+
+//! Returns read-only pointer to x1, y1, z1, ..., xN, yN, zN positions of the render vertices relative to the origin,
+//! valid until the buffers are closed, null on error
+MDAL_EXPORT const float *MDAL_RB_vertices( RenderBuffersH buffers );
+
+//! Returns read-only pointer to 3 * MDAL_RB_triangleCount indices of the render vertices of the triangles,
+//! valid until the buffers are closed, null on error
+MDAL_EXPORT const uint32_t *MDAL_RB_indices( RenderBuffersH buffers );
+
+//! Populates buffer with the value of the dataset for each render vertex, vectors as magnitudes
+//!
+//! Corners of the faces take the value of their vertex or their face, values of inactive faces are invalid
+//! for face corners. The values are gathered and converted in parallel.
+//!
+//! \param dataset dataset of the mesh of the buffers with DataOnVertices2D data location,
+//!                or DataOnFaces2D for RenderFaceCorners buffers
+//! \param type type of the values
+//! \param minimum value mapped to 0 for RenderUInt16, ignored for RenderFloat32
+//! \param maximum value mapped to 65534 for RenderUInt16, must be larger than minimum, ignored for RenderFloat32
+//! \param buffer allocated array of MDAL_RB_vertexCount values of the type
+//! \returns number of values written in the buffer, 0 on error
+MDAL_EXPORT int64_t MDAL_RB_values( RenderBuffersH buffers,
+                                    DatasetH dataset,
+                                    MDAL_RenderValueType type,
+                                    double minimum,
+                                    double maximum,
+                                    void *buffer );
+
+//! Closes render buffers, frees the memory
+MDAL_EXPORT void MDAL_RB_close( RenderBuffersH buffers );
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// DATASET GROUPS
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -255,11 +798,11 @@ MDAL_EXPORT DatasetH MDAL_G_dataset( DatasetGroupH group, int index );
 MDAL_EXPORT int MDAL_G_metadataCount( DatasetGroupH group );
 
 //! Returns dataset metadata key
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_G_metadataKey( DatasetGroupH group, int index );
 
 //! Returns dataset metadata value
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_G_metadataValue( DatasetGroupH group, int index );
 
 //! Adds new metadata to the group
@@ -267,11 +810,11 @@ MDAL_EXPORT const char *MDAL_G_metadataValue( DatasetGroupH group, int index );
 MDAL_EXPORT void MDAL_G_setMetadata( DatasetGroupH group, const char *key, const char *val );
 
 //! Returns dataset group name
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_G_name( DatasetGroupH group );
 
 //! Returns name of MDAL driver
-//! not thread-safe and valid only till next call
+//! valid only till next call from the same thread
 MDAL_EXPORT const char *MDAL_G_driverName( DatasetGroupH group );
 
 //! Whether dataset has scalar data associated
@@ -283,10 +826,27 @@ MDAL_EXPORT MDAL_DataLocation MDAL_G_dataLocation( DatasetGroupH group );
 //! Returns maximum number of vertical levels (for 3D meshes)
 MDAL_EXPORT int MDAL_G_maximumVerticalLevelCount( DatasetGroupH group );
 
+//! Returns whether statistics of the group loaded with PROGRESSIVE_LOAD open option are calculated by the background thread
+//! True for the groups of the other loads, false on error
+MDAL_EXPORT bool MDAL_G_isReady( DatasetGroupH group );
+
+//! Waits until the group is ready, see MDAL_G_isReady
+//! Returns false when the mesh is closed before or on error
+MDAL_EXPORT bool MDAL_G_waitUntilReady( DatasetGroupH group );
+
 //! Returns the minimum and maximum values of the group
 //! Returns NaN on error
 MDAL_EXPORT void MDAL_G_minimumMaximum( DatasetGroupH group, double *min, double *max );
 
+//! Returns approximate quantile of the values of all datasets of the group, see MDAL_D_quantile
+//! Sketches of the datasets are merged, so the datasets are read only when they have no sketch yet
+//! Returns NaN on error or when there is no valid value
+MDAL_EXPORT double MDAL_G_quantile( DatasetGroupH group, double fraction );
+
+//! Counts the values of all datasets of the group in bins, see MDAL_D_histogram
+//! \returns false on error
+MDAL_EXPORT bool MDAL_G_histogram( DatasetGroupH group, double min, double max, int binCount, double *counts );
+
 //! Adds empty (new) dataset to the group
 //! This increases dataset group count MDAL_G_datasetCount() by 1
 //!
@@ -324,6 +884,13 @@ MDAL_EXPORT void MDAL_G_closeEditMode( DatasetGroupH group );
 //! Returns reference time for dataset group expressed in date with ISO8601 format, return "" if reference time is not defined
 MDAL_EXPORT const char *MDAL_G_referenceTime( DatasetGroupH group );
 
+//! Returns index of the dataset with the time (hours) nearest to the time, the earlier one when two datasets are equally near
+//!
+//! Looks up the time axis of the group by binary search, the axis (the datasets sorted by their times) is built
+//! on the first call and again after datasets are added to the group.
+//! Returns -1 for the group without datasets or on error
+MDAL_EXPORT int MDAL_G_datasetIndexAtTime( DatasetGroupH group, double time );
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// DATASETS
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -337,6 +904,9 @@ MDAL_EXPORT double MDAL_D_time( DatasetH dataset );
 //! Returns volumes count for the mesh (for 3D meshes)
 MDAL_EXPORT int MDAL_D_volumesCount( DatasetH dataset );
 
+//! Returns number of volumes in dataset, for datasets beyond 2^31 volumes
+MDAL_EXPORT int64_t MDAL_D_volumesCount64( DatasetH dataset );
+
 //! Returns maximum number of vertical levels (for 3D meshes)
 MDAL_EXPORT int MDAL_D_maximumVerticalLevelCount( DatasetH dataset );
 
@@ -348,6 +918,9 @@ MDAL_EXPORT int MDAL_D_maximumVerticalLevelCount( DatasetH dataset );
  */
 MDAL_EXPORT int MDAL_D_valueCount( DatasetH dataset );
 
+//! Returns number of values, for datasets beyond 2^31 values
+MDAL_EXPORT int64_t MDAL_D_valueCount64( DatasetH dataset );
+
 //! Returns whether dataset is valid
 MDAL_EXPORT bool MDAL_D_isValid( DatasetH dataset );
 
@@ -365,6 +938,9 @@ enum MDAL_DataType
   FACE_INDEX_TO_VOLUME_INDEX_INTEGER, //!< the first index of 3D volume for particular mesh's face in 3D Stacked Meshes (DataOnVolumes3D)
   SCALAR_VOLUMES_DOUBLE, //!< double scalar values for volumes in 3D Stacked Meshes (DataOnVolumes3D)
   VECTOR_2D_VOLUMES_DOUBLE, //!< double, double value for volumes in 3D Stacked Meshes (DataOnVolumes3D)
+  SCALAR_FLOAT, //!< float value for scalar datasets (DataOnVertices2D or DataOnFaces2D)
+  VECTOR_2D_FLOAT, //!< float, float value for vector datasets (DataOnVertices2D or DataOnFaces2D)
+  ACTIVE_BITS, //!< bit-packed active flags for dataset faces, bit i % 8 of byte i / 8 is the flag of face indexStart + i (see MDAL_D_hasActiveFlagCapability)
 };
 
 //! Populates buffer with values from the dataset
@@ -384,13 +960,317 @@ enum MDAL_DataType
 //!               For FACE_INDEX_TO_VOLUME_INDEX_INTEGER, the minimum size must be faceCount * size_of(int)
 //!               For SCALAR_VOLUMES_DOUBLE, the minimum size must be volumesCount * size_of(double)
 //!               For VECTOR_2D_VOLUMES_DOUBLE, the minimum size must be 2 * volumesCount * size_of(double)
+//!               For SCALAR_FLOAT, the minimum size must be valuesCount * size_of(float)
+//!               For VECTOR_2D_FLOAT, the minimum size must be valuesCount * 2 * size_of(float).
+//!                                    Halves the memory traffic, values of double precision datasets are rounded
+//!               For ACTIVE_BITS, the minimum size must be ( valuesCount + 7 ) / 8 bytes, unused bits of the last byte are zero
 //! \returns number of values written to buffer. If return value != count requested, see MDAL_LastStatus() for error type
 MDAL_EXPORT int MDAL_D_data( DatasetH dataset, int indexStart, int count, MDAL_DataType dataType, void *buffer );
 
+//! Same as MDAL_D_data with 64-bit index and count, for datasets beyond 2^31 values
+MDAL_EXPORT int64_t MDAL_D_data64( DatasetH dataset, int64_t indexStart, int64_t count, MDAL_DataType dataType, void *buffer );
+
+//! Populates buffer with values of the dataset at the indices, in the order of the indices
+//! e.g. for the faces or vertices returned by MDAL_M_faceIteratorInExtent or MDAL_M_vertexIteratorInExtent.
+//! Values at close indices are read at once, the indices do not need to be sorted.
+//! Supports SCALAR_DOUBLE, SCALAR_FLOAT, VECTOR_2D_DOUBLE, VECTOR_2D_FLOAT and ACTIVE_INTEGER data types
+//! \param indices count indices, face indices for ACTIVE_INTEGER
+//! \param buffer allocated array of count values of the type (2 * count for vectors)
+//! \returns number of values written in the buffer, 0 on error
+MDAL_EXPORT int MDAL_D_dataAtIndices( DatasetH dataset, int count, const int *indices, MDAL_DataType dataType, void *buffer );
+
+//! Populates buffer with indices of the valid values (not NaN, both components for vectors)
+//! among count values from indexStart, e.g. wet faces of flood results, so the others can be skipped.
+//! Datasets stored sparse (see "SPARSE_DATASETS" open option) list them without reading the values
+//! \param buffer allocated array of count indices
+//! \returns number of indices written in the buffer, 0 on error
+MDAL_EXPORT int MDAL_D_validIndices( DatasetH dataset, int indexStart, int count, int *buffer );
+
+//! Returns read-only pointer to the values of the dataset held in the memory, so they are used without copying,
+//! e.g. mapped for the upload to GPU. Values are in the layout of MDAL_D_data, x1, y1, ..., xN, yN for vectors.
+//! The pointer is owned by the dataset, it is valid until the mesh is closed or the dataset is edited.
+//! \param stride if not null, populated with the number of values per element, 1 for scalars, 2 for vectors
+//! \returns pointer to MDAL_D_valueCount * stride values, null for datasets not held in memory as doubles
+//!          (read from the file on demand, compressed, sparse or single precision, see MDAL_D_dataPointerFloat)
+MDAL_EXPORT const double *MDAL_D_dataPointer( DatasetH dataset, int *stride );
+
+//! Returns read-only pointer to the values of single precision dataset held in the memory (see "SINGLE_PRECISION" open option),
+//! the same as MDAL_D_dataPointer otherwise
+//! \returns null for datasets not held in memory as floats
+MDAL_EXPORT const float *MDAL_D_dataPointerFloat( DatasetH dataset, int *stride );
+
+//! Populates buffer with values of consecutive datasets (time steps) of the group at once
+//! for nodata, returned is numeric_limits<double>::quiet_NaN
+//!
+//! Drivers storing all time steps in a single array (e.g. XMDF, NetCDF CF/UGRID)
+//! read the whole block by one request, which is much faster than calling
+//! MDAL_D_data for each dataset when extracting time series.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param datasetIndexStart index of the first dataset of the group to read
+//! \param datasetCount number of datasets to read
+//! \param indexStart index of face/vertex to start reading of values to the buffer
+//! \param count number of values of each dataset to be written to the buffer
+//! \param dataType SCALAR_DOUBLE or VECTOR_2D_DOUBLE, must match MDAL_G_hasScalarData
+//! \param layout order of the values in the buffer
+//! \param buffer output array to be populated with the values. must be already allocated
+//!               For SCALAR_DOUBLE, the minimum size must be datasetCount * count * size_of(double)
+//!               For VECTOR_2D_DOUBLE, the minimum size must be datasetCount * count * 2 * size_of(double),
+//!                                     x and y of each value are next to each other
+//! \returns number of values written to buffer, i.e. datasetCount * count. On error returns 0, see MDAL_LastStatus() for error type
+MDAL_EXPORT int MDAL_G_dataBlock( DatasetGroupH group,
+                                  int datasetIndexStart,
+                                  int datasetCount,
+                                  int indexStart,
+                                  int count,
+                                  MDAL_DataType dataType,
+                                  MDAL_DataBlockLayout layout,
+                                  double *buffer );
+
+//! Reads datasets of the group to the cache in the background, see MDAL_SetCacheSize
+//!
+//! Whole datasets are read, as requested by MDAL_D_data with SCALAR_DOUBLE or VECTOR_2D_DOUBLE
+//! data type for indexes 0 to MDAL_D_valueCount. Does nothing when the cache is disabled
+//! or for datasets held in memory.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param datasetIndexStart index of the first dataset of the group to read
+//! \param datasetCount number of datasets to read
+MDAL_EXPORT void MDAL_G_prefetch( DatasetGroupH group, int datasetIndexStart, int datasetCount );
+
 //! Returns the minimum and maximum values of the dataset
 //! Returns NaN on error
 MDAL_EXPORT void MDAL_D_minimumMaximum( DatasetH dataset, double *min, double *max );
 
+//! Returns approximate quantile of the dataset values, e.g. 0.98 for the 98th percentile
+//!
+//! Quantiles are taken from the quantile sketch of the values (magnitudes for vectors), which is built
+//! with the minimum and maximum when "QUANTILE_SKETCH" open option is set, or on first request otherwise.
+//! The rank error is below 1 % of the values count, fractions 0 and 1 give exact minimum and maximum.
+//! Returns NaN on error or when there is no valid value
+MDAL_EXPORT double MDAL_D_quantile( DatasetH dataset, double fraction );
+
+//! Counts the dataset values (magnitudes for vectors) in binCount bins of the same width between min and max
+//!
+//! The last bin includes max, values outside of the range are not counted. The counts are taken
+//! from the quantile sketch (see MDAL_D_quantile) so they are approximate for datasets with more than
+//! 256 values, the counts of all bins add up to the count of the values in the range.
+//! \param counts allocated array of binCount values
+//! \returns false on error
+MDAL_EXPORT bool MDAL_D_histogram( DatasetH dataset, double min, double max, int binCount, double *counts );
+
+//! Rasterizes the dataset defined on vertices or faces of 2D mesh to the grid of columns x rows cells
+//!
+//! Cells are sampled at their centers, cell (0, 0) is in the top left corner (minX, maxY) of the grid.
+//! Values on vertices are interpolated linearly within triangles of the faces (faces are split to triangles
+//! from their first vertex), values on faces are constant within the face, vectors are rasterized as magnitudes.
+//! Cells outside of the mesh or in inactive faces are NaN. Tiles of the grid are rasterized in parallel.
+//!
+//! \param buffer allocated array of columns * rows values, row by row from the top one
+//! \returns false on error, e.g. for datasets on volumes or edges
+MDAL_EXPORT bool MDAL_D_rasterize( DatasetH dataset,
+                                   double minX,
+                                   double maxY,
+                                   double cellWidth,
+                                   double cellHeight,
+                                   int columns,
+                                   int rows,
+                                   float *buffer );
+
+//! Returns iterator to the contour lines of the dataset defined on vertices of 2D mesh for the levels
+//!
+//! Faces are split to triangles from their first vertex and contoured by marching triangles with
+//! the values interpolated linearly along the sides, vertex with the value equal to the level is above it.
+//! Inactive faces and triangles with invalid values are skipped, vectors are contoured as magnitudes.
+//! Values on faces can be converted to vertices first by MDAL_G_addConvertedGroup.
+//!
+//! All levels are extracted in one pass over the triangles, in parallel for spatial tiles of the mesh.
+//! Segments are joined to polylines by the sides of the faces they cross, polylines are oriented with the higher
+//! values on the right, closed polylines end with their first point. The contours are extracted on the creation
+//! and kept by the iterator, the iterator must be closed before the mesh is closed.
+//!
+//! \param levelCount number of levels, minimum 1
+//! \param levels ascending levels
+//! \returns null on error, see MDAL_LastStatus() for error type
+MDAL_EXPORT ContourIteratorH MDAL_D_contourLines( DatasetH dataset, int levelCount, const double *levels );
+
+//! Returns iterator to the polygons of the bands between the levels, see MDAL_D_contourLines
+//!
+//! Band i covers values from levels[i] (included) to levels[i + 1], the polygons are the parts of the band
+//! within the triangles of the faces, counter-clockwise and closed. The polygons are not dissolved.
+//!
+//! \param levelCount number of levels, minimum 2
+//! \param levels ascending levels
+//! \returns null on error, see MDAL_LastStatus() for error type
+MDAL_EXPORT ContourIteratorH MDAL_D_contourBands( DatasetH dataset, int levelCount, const double *levels );
+
+//! Returns next polylines or polygons from the contour iterator
+//!
+//! Reading stops when the next part does not fit to coordinatesBuffer / partCount parts
+//! are written / end of the contours is reached, whatever comes first.
+//!
+//! \param iterator contour iterator
+//! \param partCount size of levelIndexBuffer and pointOffsetsBuffer
+//! \param levelIndexBuffer allocated array to store the index of the level (band) of the parts
+//! \param pointOffsetsBuffer allocated array to store the end offset of the part in points,
+//!                           number of points of part i is pointOffsetsBuffer[i] - pointOffsetsBuffer[i-1]
+//! \param coordinatesBufferLen size of coordinatesBuffer, minimum is 2 * MDAL_CI_maximumPointCount()
+//! \param coordinatesBuffer allocated array to store x, y coordinates of the points of the parts
+//! \returns number of parts written
+MDAL_EXPORT int MDAL_CI_next( ContourIteratorH iterator,
+                              int partCount,
+                              int *levelIndexBuffer,
+                              int *pointOffsetsBuffer,
+                              int coordinatesBufferLen,
+                              double *coordinatesBuffer );
+
+//! Returns number of points of the longest part of the contour iterator
+MDAL_EXPORT int MDAL_CI_maximumPointCount( ContourIteratorH iterator );
+
+//! Returns number of all parts of the contour iterator
+MDAL_EXPORT int MDAL_CI_partCount( ContourIteratorH iterator );
+
+//! Closes contour iterator, frees the memory
+MDAL_EXPORT void MDAL_CI_close( ContourIteratorH iterator );
+
+//! Adds dataset group with values on faces aggregated from the volumes of 3D group to its mesh
+//!
+//! Each dataset of the group is aggregated by the averaging method. The values are calculated
+//! on request of the dataset, the values of the few datasets read last are kept in memory.
+//! The group has the active flag capability of the 3D group and is removed with the mesh.
+//!
+//! \param group handle to dataset group with DataOnVolumes3D data location
+//! \param name name of the new group
+//! \param method aggregation of the volumes of the face
+//! \param startParameter first parameter of the method, see MDAL_AveragingMethod
+//! \param endParameter second parameter of the range methods, see MDAL_AveragingMethod
+//! \returns empty pointer if not possible to create the group, otherwise handle to new group
+MDAL_EXPORT DatasetGroupH MDAL_G_addAveragedGroup( DatasetGroupH group,
+    const char *name,
+    MDAL_AveragingMethod method,
+    double startParameter,
+    double endParameter );
+
+//! Adds scalar dataset group with single dataset aggregated over all datasets of the group to its mesh
+//!
+//! The values are calculated on the first request of the dataset by one pass over the datasets
+//! of the group, holding only one of them in memory at a time, and then read at the cost of 2D dataset
+//! held in memory. Values on inactive faces (and on vertices of inactive faces only) are skipped,
+//! values never valid are numeric_limits<double>::quiet_NaN. The group is removed with the mesh.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param name name of the new group
+//! \param aggregate aggregation of the time steps
+//! \returns empty pointer if not possible to create the group, otherwise handle to new group
+MDAL_EXPORT DatasetGroupH MDAL_G_addTemporalAggregateGroup( DatasetGroupH group,
+    const char *name,
+    MDAL_TemporalAggregate aggregate );
+
+//! Adds dataset group with the values of the group converted from vertices to faces or from faces to vertices to its mesh
+//!
+//! Value on the face is the weighted mean of the values on its vertices, value on the vertex is the weighted mean
+//! of the values on the faces using it. Nothing is precomputed except the weights: each read of the new datasets
+//! reads the range of the source elements used by the requested range and averages them in parallel.
+//! Invalid values and values on inactive faces are skipped, the elements without valid values are
+//! numeric_limits<double>::quiet_NaN. The new datasets have the active flags of the source datasets.
+//! The group is removed with the mesh.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param name name of the new group
+//! \param weighting weights of the averaged values
+//! \returns empty pointer if not possible to create the group, otherwise handle to new group with DataOnFaces2D
+//!          or DataOnVertices2D data location
+MDAL_EXPORT DatasetGroupH MDAL_G_addConvertedGroup( DatasetGroupH group,
+    const char *name,
+    MDAL_ConversionWeighting weighting );
+
+//! Adds dataset group with the datasets of the group interpolated linearly in time at the times to its mesh
+//!
+//! Nothing is precomputed: each read of the new dataset reads the same range of the two datasets around its time,
+//! found in the time axis of the group (see MDAL_G_datasetIndexAtTime), and blends them. Values invalid in either
+//! dataset are numeric_limits<double>::quiet_NaN, faces are active when they are active in both datasets.
+//! Times outside of the time range of the group take the first or the last dataset. The group is removed with the mesh.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location and at least one dataset
+//! \param name name of the new group
+//! \param timeCount number of the times
+//! \param times times of the new datasets (hours)
+//! \returns empty pointer if not possible to create the group, otherwise handle to new group
+MDAL_EXPORT DatasetGroupH MDAL_G_addTimeInterpolatedGroup( DatasetGroupH group,
+    const char *name,
+    int timeCount,
+    const double *times );
+
+//! Adds dataset group with the datasets of the group aggregated to the level of detail to the mesh of the level
+//!
+//! Nothing is precomputed: each read of the new dataset reads the values of the elements of the full mesh merged
+//! to the requested elements of the level and aggregates them. Invalid values and values on inactive faces are skipped,
+//! elements without valid values are numeric_limits<double>::quiet_NaN. Face of the level is active when any of its
+//! faces is active. The group has the name of the source group and is removed with the mesh of the group.
+//!
+//! \param group handle to dataset group with DataOnVertices2D or DataOnFaces2D data location
+//! \param level level of detail, see MDAL_M_levelOfDetailCount
+//! \param aggregate aggregation of the values
+//! \returns empty pointer if not possible to create the group, the group itself for level 0, otherwise handle
+//!          to new group of the mesh of the level (see MDAL_M_levelOfDetail)
+MDAL_EXPORT DatasetGroupH MDAL_G_addLevelOfDetailGroup( DatasetGroupH group,
+    int level,
+    MDAL_LevelOfDetailAggregate aggregate );
+
+//! Adds scalar dataset group evaluated from expression over the groups of the mesh
+//!
+//! Example: "Depth * (Velocity + 0.5)" or "if(\"Water Level\" > 10, 1, 0)". The expression supports
+//! numbers, + - * / ^, comparisons < <= > >= == != (1 or 0), functions abs, sqrt, min, max and if(condition, a, b).
+//! Groups are referenced by their names, names which are not identifiers must be in double quotes.
+//! Vector groups are used as their magnitudes.
+//!
+//! All groups must be defined on vertices or all on faces. Groups with single dataset (e.g. bed elevation)
+//! are used for every time step, the others must have the same number of datasets.
+//! Nothing is precomputed: each read of the new datasets reads the same range of the groups
+//! and evaluates the expression for it. Datasets are active where all datasets of the groups are active.
+//! The expression is stored in the group metadata "expression". The group is removed with the mesh.
+//!
+//! \param mesh handle to mesh
+//! \param name name of the new group
+//! \param expression the expression
+//! \returns empty pointer if the expression is not valid or the groups are not compatible, otherwise handle to new group
+MDAL_EXPORT DatasetGroupH MDAL_M_addDerivedGroup( MeshH mesh, const char *name, const char *expression );
+
+//! Returns iterator to the columns of volumes of 3D dataset (DataOnVolumes3D), face by face
+//!
+//! The data are read from the dataset in large batches of faces, so iterating over
+//! all faces is much faster than matching MDAL_D_data calls for VERTICAL_LEVEL_COUNT_INTEGER,
+//! FACE_INDEX_TO_VOLUME_INDEX_INTEGER, VERTICAL_LEVEL_DOUBLE and SCALAR_VOLUMES_DOUBLE.
+//! The iterator must be closed before the mesh is closed.
+//! \returns null on error, see MDAL_LastStatus() for error type
+MDAL_EXPORT DatasetVolumeIteratorH MDAL_D_volumeIterator( DatasetH dataset );
+
+//! Returns next faces with their vertical levels and volume values from the iterator
+//!
+//! Reading stops when the next face does not fit to one of the buffers / faceCount faces
+//! are written / end of faces is reached, whatever comes first.
+//! Face with N > 0 levels writes N + 1 level z values and N values of volumes
+//! (2 * N for vector datasets, x1, y1, ..., xN, yN), faces without levels write nothing to levelsBuffer and valuesBuffer
+//!
+//! \param iterator dataset volume iterator
+//! \param faceCount size of levelCountBuffer
+//! \param levelCountBuffer allocated array to store the number of vertical levels of the faces
+//! \param levelsBufferLen size of levelsBuffer, minimum is MDAL_D_maximumVerticalLevelCount() + 1
+//! \param levelsBuffer allocated array to store the level z values of the faces one after another
+//! \param valuesBufferLen size of valuesBuffer, minimum is MDAL_D_maximumVerticalLevelCount() (2 * for vector datasets)
+//! \param valuesBuffer allocated array to store values of the volumes of the faces one after another
+//! \returns number of faces written
+MDAL_EXPORT int MDAL_VOI_next( DatasetVolumeIteratorH iterator,
+                               int faceCount,
+                               int *levelCountBuffer,
+                               int levelsBufferLen,
+                               double *levelsBuffer,
+                               int valuesBufferLen,
+                               double *valuesBuffer );
+
+//! Closes dataset volume iterator, frees the memory
+MDAL_EXPORT void MDAL_VOI_close( DatasetVolumeIteratorH iterator );
+
 #ifdef __cplusplus
 }
 #endif
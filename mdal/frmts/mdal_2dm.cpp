@@ -10,14 +10,20 @@
 #include <sstream>
 #include <string>
 #include <vector>
-#include <map>
 #include <cassert>
 #include <limits>
 #include <algorithm>
+#include <atomic>
+#include <string.h>
 
 #include "mdal_2dm.hpp"
 #include "mdal.h"
 #include "mdal_utils.hpp"
+#include "mdal_mapped_file.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_pipeline.hpp"
+#include "mdal_progress.hpp"
+#include "mdal_remote.hpp"
 
 #define DRIVER_NAME "2DM"
 
@@ -26,41 +32,39 @@ MDAL::Mesh2dm::Mesh2dm( size_t verticesCount,
                         size_t faceVerticesMaximumCount,
                         MDAL::BBox extent,
                         const std::string &uri,
-                        const std::map<size_t, size_t> vertexIDtoIndex )
+                        MDAL::IdToIndexMap vertexIDtoIndex )
   : MemoryMesh( DRIVER_NAME,
                 verticesCount,
                 facesCount,
                 faceVerticesMaximumCount,
                 extent,
                 uri )
-  , mVertexIDtoIndex( vertexIDtoIndex )
+  , mVertexIDtoIndex( std::move( vertexIDtoIndex ) )
 {
 }
 
 MDAL::Mesh2dm::~Mesh2dm() = default;
 
-bool _parse_vertex_id_gaps( std::map<size_t, size_t> &vertexIDtoIndex, size_t vertexIndex, size_t vertexID, MDAL_Status *status )
+bool _parse_vertex_id_gaps( MDAL::IdToIndexMap &vertexIDtoIndex, size_t vertexIndex, size_t vertexID, MDAL_Status *status )
 {
   if ( vertexIndex == vertexID )
     return false;
 
-  std::map<size_t, size_t>::iterator search = vertexIDtoIndex.find( vertexID );
-  if ( search != vertexIDtoIndex.end() )
+  if ( !vertexIDtoIndex.insert( vertexID, vertexIndex ) )
   {
     if ( status ) *status = MDAL_Status::Warn_ElementNotUnique;
     return true;
   }
 
-  vertexIDtoIndex[vertexID] = vertexIndex;
   return false;
 }
 
 size_t MDAL::Mesh2dm::vertexIndex( size_t vertexID ) const
 {
-  auto ni2i = mVertexIDtoIndex.find( vertexID );
-  if ( ni2i != mVertexIDtoIndex.end() )
+  const size_t index = mVertexIDtoIndex.find( vertexID );
+  if ( index != IdToIndexMap::NOT_FOUND )
   {
-    return  ni2i->second; // convert from ID to index
+    return index; // convert from ID to index
   }
   return vertexID;
 }
@@ -72,8 +76,7 @@ size_t MDAL::Mesh2dm::maximumVertexId() const
     return maxIndex;
   else
   {
-    // std::map is sorted!
-    size_t maxID = mVertexIDtoIndex.rbegin()->first;
+    size_t maxID = mVertexIDtoIndex.maximumId();
     return std::max( maxIndex, maxID );
   }
 }
@@ -82,7 +85,7 @@ MDAL::Driver2dm::Driver2dm():
   Driver( DRIVER_NAME,
           "2DM Mesh File",
           "*.2dm",
-          Capability::ReadMesh | Capability::SaveMesh
+          Capability::ReadMesh | Capability::SaveMesh | Capability::SaveMeshToStream
         )
 {
 }
@@ -94,8 +97,16 @@ MDAL::Driver2dm *MDAL::Driver2dm::create()
 
 MDAL::Driver2dm::~Driver2dm() = default;
 
+bool MDAL::Driver2dm::canReadSignature( const MDAL::FileSignature &signature )
+{
+  return signature.startsWith( "MESH2D" );
+}
+
 bool MDAL::Driver2dm::canReadMesh( const std::string &uri )
 {
+  if ( isRemoteUri( uri ) )
+    return FileSignature( uri ).startsWith( "MESH2D" );
+
   std::ifstream in( uri, std::ifstream::in );
   std::string line;
   if ( !MDAL::getHeaderLine( in, line ) || !startsWith( line, "MESH2D" ) )
@@ -105,158 +116,304 @@ bool MDAL::Driver2dm::canReadMesh( const std::string &uri )
   return true;
 }
 
-std::unique_ptr<MDAL::Mesh> MDAL::Driver2dm::load( const std::string &meshFile, MDAL_Status *status )
-{
-  mMeshFile = meshFile;
-
-  if ( status ) *status = MDAL_Status::None;
+//! Maximum number of tokens we need to inspect on a single 2DM card
+#define MAX_TOKENS_2DM 16
 
-  std::ifstream in( mMeshFile, std::ifstream::in );
-  std::string line;
-  if ( !std::getline( in, line ) || !startsWith( line, "MESH2D" ) )
-  {
-    if ( status ) *status = MDAL_Status::Err_UnknownFormat;
-    return nullptr;
-  }
+static bool _starts_with( const char *begin, const char *end, const char *prefix )
+{
+  const size_t len = strlen( prefix );
+  return ( static_cast<size_t>( end - begin ) >= len ) && ( memcmp( begin, prefix, len ) == 0 );
+}
 
-  size_t faceCount = 0;
-  size_t vertexCount = 0;
+static bool _is_unsupported_element( const char *begin, const char *end )
+{
+  return _starts_with( begin, end, "E2L" ) ||
+         _starts_with( begin, end, "E3L" ) ||
+         _starts_with( begin, end, "E6T" ) ||
+         _starts_with( begin, end, "E8Q" ) ||
+         _starts_with( begin, end, "E9Q" );
+}
 
-  // Find out how many nodes and elements are contained in the .2dm mesh file
-  while ( std::getline( in, line ) )
-  {
-    if ( startsWith( line, "E4Q" ) ||
-         startsWith( line, "E3T" ) )
-    {
-      faceCount++;
-    }
-    else if ( startsWith( line, "ND" ) )
-    {
-      vertexCount++;
-    }
-    else if ( startsWith( line, "E2L" ) ||
-              startsWith( line, "E3L" ) ||
-              startsWith( line, "E6T" ) ||
-              startsWith( line, "E8Q" ) ||
-              startsWith( line, "E9Q" ) )
-    {
-      if ( status ) *status = MDAL_Status::Warn_UnsupportedElement;
-      faceCount += 1; // We still count them as elements
-    }
-  }
+//! Minimum size of the part of the file parsed by one task
+static const size_t MIN_CHUNK_SIZE_2DM = 16 * 1024 * 1024;
 
-  // Allocate memory
-  std::vector<Vertex> vertices( vertexCount );
-  std::vector<Face> faces( faceCount );
+//! Number of lines parsed between the progress reports
+static const size_t PROGRESS_LINES_2DM = 65536;
 
-  // Basement 3.x supports definition of elevation for cell centers
+//! Vertices and faces parsed from a part of the file
+struct Chunk2dm
+{
+  MDAL::VertexArrays vertices;
+  //! IDs of the vertices numbered from 0, face vertices are stored as IDs too
+  std::vector<size_t> vertexIds;
+  MDAL::CompressedFaces faces;
+  //! Basement 3.x supports definition of elevation for cell centers, empty when not present
   std::vector<double> elementCenteredElevation;
 
-  in.clear();
-  in.seekg( 0, std::ios::beg );
+  //! First and last non-zero vertex ID as in the file, checked between the chunks
+  size_t firstVertexID = 0;
+  size_t lastVertexID = 0;
 
-  std::vector<std::string> chunks;
+  MDAL_Status status = MDAL_Status::None;
+};
 
-  size_t faceIndex = 0;
-  size_t vertexIndex = 0;
-  std::map<size_t, size_t> vertexIDtoIndex;
-  size_t lastVertexID = 0;
+//! Bytes of the file parsed by all chunks, for the progress reports
+struct ParseProgress2dm
+{
+  MDAL::Progress &progress;
+  std::atomic<size_t> parsedBytes;
+  size_t fileSize;
+};
+
+/**
+ * Parses lines [ptr, fileEnd) to the chunk, the range must start at the beginning of a line
+ * Sets Err_InvalidData status of the chunk on error, Err_Cancelled when the load is cancelled
+ */
+static void _parse_chunk( const char *ptr, const char *fileEnd, Chunk2dm &chunk, ParseProgress2dm &parseProgress )
+{
+  MDAL::VertexArrays &vertices = chunk.vertices;
+  MDAL::CompressedFaces &faces = chunk.faces;
+  std::vector<double> &elementCenteredElevation = chunk.elementCenteredElevation;
+  size_t faceVertexIds[MAX_VERTICES_PER_FACE_2DM];
 
-  while ( std::getline( in, line ) )
+  MDAL::StringSpan tokens[MAX_TOKENS_2DM];
+  size_t linesCount = 0;
+  const char *reportedPtr = ptr;
+
+  while ( ptr < fileEnd )
   {
-    if ( startsWith( line, "E4Q" ) ||
-         startsWith( line, "E3T" )
-       )
+    if ( ++linesCount % PROGRESS_LINES_2DM == 0 )
     {
-      chunks = split( line,  ' ' );
-      assert( faceIndex < faceCount );
+      const size_t parsedBytes = parseProgress.parsedBytes += static_cast<size_t>( ptr - reportedPtr );
+      reportedPtr = ptr;
+      if ( !parseProgress.progress.report( static_cast<double>( parsedBytes ) / static_cast<double>( parseProgress.fileSize ) ) )
+      {
+        chunk.status = MDAL_Status::Err_Cancelled;
+        return;
+      }
+    }
 
-      const size_t faceVertexCount = MDAL::toSizeT( line[1] );
+    const MDAL::StringSpan line = MDAL::nextLine( ptr, fileEnd );
+    const char *lineBegin = line.begin;
+    const char *lineEnd = line.end;
+
+    if ( _starts_with( lineBegin, lineEnd, "E4Q" ) ||
+         _starts_with( lineBegin, lineEnd, "E3T" ) )
+    {
+      const size_t faceVertexCount = static_cast<size_t>( lineBegin[1] - '0' );
       assert( ( faceVertexCount == 3 ) || ( faceVertexCount == 4 ) );
 
-      Face &face = faces[faceIndex];
-      face.resize( faceVertexCount );
+      const size_t tokensCount = MDAL::split( lineBegin, lineEnd, tokens, MAX_TOKENS_2DM );
 
-      // chunks format here
+      // tokens format here
       // E** id vertex_id1, vertex_id2, ... material_id (elevation - optional)
       // vertex ids are numbered from 1
       // Right now we just store node IDs here - we will convert them to node indices afterwards
-      assert( chunks.size() > faceVertexCount + 1 );
+      assert( tokensCount > faceVertexCount + 1 );
+      if ( tokensCount <= faceVertexCount + 1 )
+      {
+        chunk.status = MDAL_Status::Warn_InvalidElements;
+        faces.addFace( faceVertexIds, 0 );
+        continue;
+      }
 
       for ( size_t i = 0; i < faceVertexCount; ++i )
-        face[i] = MDAL::toSizeT( chunks[i + 2] ) - 1; // 2dm is numbered from 1
+        faceVertexIds[i] = MDAL::toSizeT( tokens[i + 2].begin, tokens[i + 2].end ) - 1; // 2dm is numbered from 1
+      faces.addFace( faceVertexIds, faceVertexCount );
 
       // OK, now find out if there is optional cell elevation (BASEMENT 3.x)
-      if ( chunks.size() == faceVertexCount + 4 )
+      if ( tokensCount == faceVertexCount + 4 )
       {
-
-        // initialize dataset if it is still empty
-        if ( elementCenteredElevation.empty() )
-        {
-          elementCenteredElevation = std::vector<double>( faceCount, std::numeric_limits<double>::quiet_NaN() );
-        }
+        const size_t faceIndex = faces.size() - 1;
+        elementCenteredElevation.resize( faceIndex + 1, std::numeric_limits<double>::quiet_NaN() );
 
         // add Bed Elevation (Face) value
-        elementCenteredElevation[faceIndex] = MDAL::toDouble( chunks[ faceVertexCount + 3 ] );
+        const MDAL::StringSpan &elevation = tokens[ faceVertexCount + 3 ];
+        elementCenteredElevation[faceIndex] = MDAL::toDouble( elevation.begin, elevation.end );
       }
-
-      faceIndex++;
     }
-    else if ( startsWith( line, "E2L" ) ||
-              startsWith( line, "E3L" ) ||
-              startsWith( line, "E6T" ) ||
-              startsWith( line, "E8Q" ) ||
-              startsWith( line, "E9Q" ) )
+    else if ( _is_unsupported_element( lineBegin, lineEnd ) )
     {
       // We do not yet support these elements
-      chunks = split( line,  ' ' );
-      assert( faceIndex < faceCount );
+      chunk.status = MDAL_Status::Warn_UnsupportedElement;
 
-      //size_t elemID = toSizeT( chunks[1] );
       assert( false ); //TODO mark element as unusable
 
-      faceIndex++;
+      faces.addFace( faceVertexIds, 0 ); // We still count them as elements
     }
-    else if ( startsWith( line, "ND" ) )
+    else if ( _starts_with( lineBegin, lineEnd, "ND" ) )
     {
-      chunks = split( line,  ' ' );
-      size_t nodeID = toSizeT( chunks[1] );
+      const size_t tokensCount = MDAL::split( lineBegin, lineEnd, tokens, MAX_TOKENS_2DM );
+      if ( tokensCount < 5 )
+      {
+        chunk.status = MDAL_Status::Err_InvalidData;
+        return;
+      }
+
+      size_t nodeID = MDAL::toSizeT( tokens[1].begin, tokens[1].end );
 
       if ( nodeID != 0 )
       {
         // specification of 2DM states that ID should be positive integer numbered from 1
         // but it seems some formats do not respect that
-        if ( ( lastVertexID != 0 ) && ( nodeID <= lastVertexID ) )
+        if ( ( chunk.lastVertexID != 0 ) && ( nodeID <= chunk.lastVertexID ) )
         {
           // the algorithm requires that the file has NDs orderer by index
-          if ( status ) *status = MDAL_Status::Err_InvalidData;
-          return nullptr;
+          chunk.status = MDAL_Status::Err_InvalidData;
+          return;
         }
-        lastVertexID = nodeID;
+        if ( chunk.firstVertexID == 0 )
+          chunk.firstVertexID = nodeID;
+        chunk.lastVertexID = nodeID;
       }
       nodeID -= 1; // 2dm is numbered from 1
 
-      _parse_vertex_id_gaps( vertexIDtoIndex, vertexIndex, nodeID, status );
-      assert( vertexIndex < vertexCount );
-      Vertex &vertex = vertices[vertexIndex];
-      vertex.x = toDouble( chunks[2] );
-      vertex.y = toDouble( chunks[3] );
-      vertex.z = toDouble( chunks[4] );
-      vertexIndex++;
+      chunk.vertexIds.push_back( nodeID );
+      MDAL::Vertex vertex;
+      vertex.x = MDAL::toDouble( tokens[2].begin, tokens[2].end );
+      vertex.y = MDAL::toDouble( tokens[3].begin, tokens[3].end );
+      vertex.z = MDAL::toDouble( tokens[4].begin, tokens[4].end );
+      vertices.push_back( vertex );
+    }
+  }
+}
+
+/**
+ * Splits [begin, end) to about count parts ending at line ends
+ * Returns the boundaries, first is begin and last is end
+ */
+static std::vector<const char *> _split_lines( const char *begin, const char *end, size_t count )
+{
+  std::vector<const char *> boundaries( 1, begin );
+  const size_t size = static_cast<size_t>( end - begin );
+  for ( size_t i = 1; i < count; ++i )
+  {
+    const char *ptr = std::max( begin + size / count * i, boundaries.back() );
+    const char *lineEnd = static_cast<const char *>( memchr( ptr, '\n', static_cast<size_t>( end - ptr ) ) );
+    if ( !lineEnd )
+      break;
+    if ( lineEnd + 1 > boundaries.back() )
+      boundaries.push_back( lineEnd + 1 );
+  }
+  boundaries.push_back( end );
+  return boundaries;
+}
+
+std::unique_ptr<MDAL::Mesh> MDAL::Driver2dm::load( const std::string &meshFile, MDAL_Status *status )
+{
+  mMeshFile = meshFile;
+
+  if ( status ) *status = MDAL_Status::None;
+
+  // The whole file is scanned in place, numbers are parsed directly from the buffer (no substrings)
+  MappedFile file( mMeshFile );
+  const char *ptr = file.data();
+  const char *fileEnd = ptr + file.size();
+
+  if ( !file.isValid() || !_starts_with( ptr, fileEnd, "MESH2D" ) )
+  {
+    if ( status ) *status = MDAL_Status::Err_UnknownFormat;
+    return nullptr;
+  }
+
+  // Lines are independent, large files are split to chunks parsed in parallel,
+  // the chunks are merged in the order of the file afterwards
+  const size_t chunksCount = std::max( size_t( 1 ), std::min( 4 * MDAL::threadCount(), file.size() / MIN_CHUNK_SIZE_2DM ) );
+  const std::vector<const char *> boundaries = _split_lines( ptr, fileEnd, MDAL::threadCount() > 1 ? chunksCount : 1 );
+  std::vector<Chunk2dm> chunks( boundaries.size() - 1 );
+  ParseProgress2dm parseProgress{ MDAL::Progress::current(), { 0 }, file.size() };
+  MDAL::parallelFor( chunks.size(), [&]( size_t i )
+  {
+    _parse_chunk( boundaries[i], boundaries[i + 1], chunks[i], parseProgress );
+  } );
+
+  if ( parseProgress.progress.isCancelled() )
+  {
+    if ( status ) *status = MDAL_Status::Err_Cancelled;
+    return nullptr;
+  }
+
+  size_t lastVertexID = 0;
+  size_t verticesCount = 0;
+  size_t facesCount = 0;
+  size_t indicesCount = 0;
+  bool hasElementCenteredElevation = false;
+  for ( const Chunk2dm &chunk : chunks )
+  {
+    if ( chunk.status == MDAL_Status::Err_InvalidData ||
+         ( lastVertexID != 0 && chunk.firstVertexID != 0 && chunk.firstVertexID <= lastVertexID ) )
+    {
+      // the algorithm requires that the file has NDs orderer by index
+      if ( status ) *status = MDAL_Status::Err_InvalidData;
+      return nullptr;
     }
+    if ( chunk.status != MDAL_Status::None && status )
+      *status = chunk.status;
+    if ( chunk.lastVertexID != 0 )
+      lastVertexID = chunk.lastVertexID;
+
+    verticesCount += chunk.vertices.size();
+    facesCount += chunk.faces.size();
+    indicesCount += chunk.faces.indicesCount();
+    hasElementCenteredElevation = hasElementCenteredElevation || !chunk.elementCenteredElevation.empty();
   }
 
-  for ( std::vector<Face>::iterator it = faces.begin(); it != faces.end(); ++it )
+  VertexArrays vertices;
+  CompressedFaces faces;
+  std::vector<double> elementCenteredElevation;
+  IdToIndexMap vertexIDtoIndex;
+  if ( chunks.size() == 1 )
+  {
+    vertices = std::move( chunks[0].vertices );
+    faces = std::move( chunks[0].faces );
+    elementCenteredElevation = std::move( chunks[0].elementCenteredElevation );
+  }
+  else
   {
-    Face &face = *it;
-    for ( Face::size_type nd = 0; nd < face.size(); ++nd )
+    vertices.reserve( verticesCount );
+    faces.reserve( facesCount, indicesCount );
+  }
+
+  size_t vertexOffset = 0;
+  for ( Chunk2dm &chunk : chunks )
+  {
+    for ( size_t i = 0; i < chunk.vertexIds.size(); ++i )
+      _parse_vertex_id_gaps( vertexIDtoIndex, vertexOffset + i, chunk.vertexIds[i], status );
+    vertexOffset += chunk.vertexIds.size();
+    std::vector<size_t>().swap( chunk.vertexIds );
+
+    if ( chunks.size() == 1 )
+      break;
+
+    const size_t faceOffset = faces.size();
+    vertices.append( chunk.vertices );
+    faces.append( chunk.faces );
+    if ( hasElementCenteredElevation )
+    {
+      elementCenteredElevation.resize( faceOffset + chunk.faces.size(), std::numeric_limits<double>::quiet_NaN() );
+      std::copy( chunk.elementCenteredElevation.begin(), chunk.elementCenteredElevation.end(),
+                 elementCenteredElevation.begin() + static_cast<std::ptrdiff_t>( faceOffset ) );
+    }
+    chunk = Chunk2dm();
+  }
+
+  if ( !elementCenteredElevation.empty() )
+    elementCenteredElevation.resize( faces.size(), std::numeric_limits<double>::quiet_NaN() );
+
+  // all vertices are read, use the dense table for lookups when the IDs allow it
+  vertexIDtoIndex.optimize();
+
+  for ( size_t faceIndex = 0; faceIndex < faces.size(); ++faceIndex )
+  {
+    const size_t faceVertexCount = faces.faceVerticesCount( faceIndex );
+    for ( size_t nd = 0; nd < faceVertexCount; ++nd )
     {
-      size_t nodeID = face[nd];
+      size_t nodeID = faces.vertexIndex( faceIndex, nd );
 
-      std::map<size_t, size_t>::iterator ni2i = vertexIDtoIndex.find( nodeID );
-      if ( ni2i != vertexIDtoIndex.end() )
+      const size_t vertexIndex = vertexIDtoIndex.find( nodeID );
+      if ( vertexIndex != IdToIndexMap::NOT_FOUND )
       {
-        face[nd] = ni2i->second; // convert from ID to index
+        faces.setVertexIndex( faceIndex, nd, vertexIndex ); // convert from ID to index
       }
       else if ( vertices.size() < nodeID )
       {
@@ -274,19 +431,69 @@ std::unique_ptr<MDAL::Mesh> MDAL::Driver2dm::load( const std::string &meshFile,
       MAX_VERTICES_PER_FACE_2DM,
       computeExtent( vertices ),
       mMeshFile,
-      vertexIDtoIndex
+      std::move( vertexIDtoIndex )
     )
   );
-  mesh->faces = faces;
-  mesh->vertices = vertices;
+  mesh->faces = std::move( faces );
+  mesh->vertices = std::move( vertices );
 
   // Add Bed Elevations
   MDAL::addFaceScalarDatasetGroup( mesh.get(), elementCenteredElevation, "Bed Elevation (Face)" );
-  MDAL::addBedElevationDatasetGroup( mesh.get(), vertices );
+  MDAL::addBedElevationDatasetGroup( mesh.get(), mesh->vertices );
 
   return std::unique_ptr<Mesh>( mesh.release() );
 }
 
+//! Text of the saved file, written to the stream in large blocks
+class Buffer2dm
+{
+  public:
+    explicit Buffer2dm( std::ostream &file ): mFile( file )
+    {
+      mText.reserve( BLOCK_SIZE + 256 );
+    }
+
+    ~Buffer2dm() { flush(); }
+
+    void append( const char *text )
+    {
+      mText.append( text );
+    }
+
+    void appendSizeT( size_t value )
+    {
+      char digits[MDAL::MAX_NUMBER_CHARS];
+      mText.push_back( ' ' );
+      mText.append( digits, MDAL::sizeTToChars( value, digits ) );
+    }
+
+    void appendDouble( double value )
+    {
+      char digits[MDAL::MAX_NUMBER_CHARS];
+      mText.push_back( ' ' );
+      mText.append( digits, MDAL::doubleToChars( value, digits ) );
+    }
+
+    //! Ends the line, writes the text when the block is full
+    void endLine()
+    {
+      mText.push_back( '\n' );
+      if ( mText.size() >= BLOCK_SIZE )
+        flush();
+    }
+
+    void flush()
+    {
+      mFile.write( mText.data(), static_cast<std::streamsize>( mText.size() ) );
+      mText.clear();
+    }
+
+  private:
+    static const size_t BLOCK_SIZE = 1024 * 1024;
+    std::ostream &mFile;
+    std::string mText;
+};
+
 void MDAL::Driver2dm::save( const std::string &uri, MDAL::Mesh *mesh, MDAL_Status *status )
 {
   if ( status ) *status = MDAL_Status::None;
@@ -296,56 +503,96 @@ void MDAL::Driver2dm::save( const std::string &uri, MDAL::Mesh *mesh, MDAL_Statu
   if ( !file.is_open() )
   {
     if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
+    return;
   }
 
-  std::string line = "MESH2D";
-  file << line << std::endl;
+  saveToStream( file, mesh, status );
+}
+
+void MDAL::Driver2dm::saveToStream( std::ostream &file, MDAL::Mesh *mesh, MDAL_Status *status )
+{
+  if ( status ) *status = MDAL_Status::None;
+
+  Buffer2dm text( file );
+  text.append( "MESH2D" );
+  text.endLine();
+
+  const size_t blockSize = 65536;
+  MDAL::Progress &progress = MDAL::Progress::current();
+  const double elementsCount = static_cast<double>( mesh->verticesCount() + mesh->facesCount() );
 
   //write vertices
-  std::unique_ptr<MDAL::MeshVertexIterator> vertexIterator = mesh->readVertices();
-  double vertex[3];
-  for ( size_t i = 0; i < mesh->verticesCount(); ++i )
+  std::unique_ptr<MDAL::MeshVertexIterator> vertexIterator = MDAL::readVerticesPipelined( mesh );
+  const size_t verticesCount = mesh->verticesCount();
+  std::vector<double> vertices( 3 * std::min( verticesCount, blockSize ) );
+  size_t vertexIndex = 0;
+  while ( vertexIndex < verticesCount )
   {
-    vertexIterator->next( 1, vertex );
-    line = "ND ";
-    line.append( std::to_string( i + 1 ) );
-    for ( size_t j = 0; j < 2; ++j )
+    const size_t verticesRead = vertexIterator->next( std::min( verticesCount - vertexIndex, blockSize ), vertices.data() );
+    if ( verticesRead == 0 )
+      break;
+
+    for ( size_t i = 0; i < verticesRead; ++i )
     {
-      line.append( " " );
-      line.append( MDAL::coordinateToString( vertex[j] ) );
+      text.append( "ND" );
+      text.appendSizeT( vertexIndex + i + 1 );
+      text.appendDouble( vertices[3 * i] );
+      text.appendDouble( vertices[3 * i + 1] );
+      text.appendDouble( vertices[3 * i + 2] );
+      text.endLine();
     }
-    line.append( " " );
-    line.append( MDAL::doubleToString( vertex[2] ) );
+    vertexIndex += verticesRead;
 
-    file << line << std::endl;
+    if ( !progress.report( static_cast<double>( vertexIndex ) / elementsCount ) )
+    {
+      if ( status ) *status = MDAL_Status::Err_Cancelled;
+      return;
+    }
   }
 
   //write faces
-  std::unique_ptr<MDAL::MeshFaceIterator> faceIterator = mesh->readFaces();
-  for ( size_t i = 0; i < mesh->facesCount(); ++i )
+  std::unique_ptr<MDAL::MeshFaceIterator> faceIterator = MDAL::readFacesPipelined( mesh );
+  const size_t facesCount = mesh->facesCount();
+  const size_t faceVerticesMax = std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) );
+  std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+  std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+  size_t faceIndex = 0;
+  while ( faceIndex < facesCount )
   {
-    int faceOffsets[1];
-    int vertexIndices[4]; //max 4 vertices for a face
-    faceIterator->next( 1, faceOffsets, 4, vertexIndices );
+    const size_t facesRead = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                             vertexIndices.size(), vertexIndices.data() );
+    if ( facesRead == 0 )
+      break;
 
-    if ( faceOffsets[0] > 2 && faceOffsets[0] < 5 )
+    int startIndex = 0;
+    for ( size_t i = 0; i < facesRead; ++i )
     {
-      if ( faceOffsets[0] == 3 )
-        line = "E3T ";
-      if ( faceOffsets[0] == 4 )
-        line = "E4Q ";
+      const int endIndex = faceOffsets[i];
+      const int faceVerticesCount = endIndex - startIndex;
 
-      line.append( std::to_string( i + 1 ) );
-
-      for ( int j = 0; j < faceOffsets[0]; ++j )
+      // only triangles and quads are supported
+      if ( faceVerticesCount == 3 || faceVerticesCount == 4 )
       {
-        line.append( " " );
-        line.append( std::to_string( vertexIndices[j] + 1 ) );
+        text.append( faceVerticesCount == 3 ? "E3T" : "E4Q" );
+        text.appendSizeT( faceIndex + i + 1 );
+        for ( int j = startIndex; j < endIndex; ++j )
+          text.appendSizeT( static_cast<size_t>( vertexIndices[static_cast<size_t>( j )] ) + 1 );
+        text.endLine();
       }
+      startIndex = endIndex;
     }
+    faceIndex += facesRead;
 
-    file << line << std::endl;
+    if ( !progress.report( static_cast<double>( verticesCount + faceIndex ) / elementsCount ) )
+    {
+      if ( status ) *status = MDAL_Status::Err_Cancelled;
+      return;
+    }
+  }
 
+  text.flush();
+  if ( !file )
+  {
+    if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
   }
-  file.close();
 }
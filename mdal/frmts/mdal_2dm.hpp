@@ -11,6 +11,7 @@
 
 #include "mdal_data_model.hpp"
 #include "mdal_memory_data_model.hpp"
+#include "mdal_id_map.hpp"
 #include "mdal.h"
 #include "mdal_driver.hpp"
 
@@ -27,7 +28,7 @@ namespace MDAL
                size_t faceVerticesMaximumCount,
                BBox extent,
                const std::string &uri,
-               const std::map<size_t, size_t> vertexIDtoIndex
+               IdToIndexMap vertexIDtoIndex
              );
       ~Mesh2dm() override;
 
@@ -47,7 +48,7 @@ namespace MDAL
       //! 2dm supports "gaps" in the mesh indexing
       //! Store only the indices that have different index and ID
       //! https://github.com/lutraconsulting/MDAL/issues/51
-      std::map<size_t, size_t> mVertexIDtoIndex;
+      IdToIndexMap mVertexIDtoIndex;
   };
 
   /**
@@ -86,9 +87,11 @@ namespace MDAL
       int faceVerticesMaximumCount() const override
       {return MAX_VERTICES_PER_FACE_2DM;}
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadMesh( const std::string &uri ) override;
       std::unique_ptr< Mesh > load( const std::string &meshFile, MDAL_Status *status ) override;
       void save( const std::string &uri, Mesh *mesh, MDAL_Status *status ) override;
+      void saveToStream( std::ostream &stream, Mesh *mesh, MDAL_Status *status ) override;
 
     private:
       std::string mMeshFile;
@@ -144,8 +144,8 @@ void MDAL::Driver3Di::addBedElevation( MemoryMesh *mesh )
   {
     dataset->setScalarValue( i, MDAL::safeValue( coordZ[i], fillZ ) );
   }
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+  MDAL::updateStatistics( dataset );
+  MDAL::updateStatistics( group );
   group->datasets.push_back( dataset );
   mesh->datasetGroups.push_back( group );
 }
@@ -14,16 +14,175 @@
 #include <cassert>
 #include <memory>
 #include <limits>
+#include <locale>
+#include <algorithm>
+#include <string.h>
 
 #include "mdal_ascii_dat.hpp"
 #include "mdal.h"
 #include "mdal_utils.hpp"
 #include "mdal_2dm.hpp"
+#include "mdal_options.hpp"
 
 #include <math.h>
 
 #define EXIT_WITH_ERROR(error)       {  if (status) *status = (error); return; }
 
+static void _skipLines( std::ifstream &stream, size_t count )
+{
+  for ( size_t i = 0; i < count; ++i )
+    stream.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
+}
+
+MDAL::AsciiDatReader::AsciiDatReader( const std::string &datFile, const Mesh *mesh, size_t meshIdCount, bool mapNativeIds )
+  : mIn( datFile, std::ifstream::in )
+  , mMesh( mesh )
+  , mMeshIdCount( meshIdCount )
+  , mMapNativeIds( mapNativeIds )
+{
+}
+
+bool MDAL::AsciiDatReader::readTimestep( std::streampos position, bool isVector, bool faceCentered, bool hasStatus )
+{
+  if ( position == mPosition )
+    return true;
+
+  mPosition = -1;
+  mIn.clear();
+  mIn.seekg( position );
+  if ( !mIn )
+    return false;
+
+  const size_t faceCount = mMesh->facesCount();
+  const size_t vertexCount = mMesh->verticesCount();
+  const size_t valuesPerIndex = isVector ? 2 : 1;
+
+  mValues.assign( ( faceCentered ? faceCount : vertexCount ) * valuesPerIndex, std::numeric_limits<double>::quiet_NaN() );
+  mActive.assign( hasStatus ? faceCount : 0, 1 );
+
+  // the line buffer is reused and lines are split in place, so there is no allocation per line
+  StringSpan tokens[2];
+
+  // only for new format
+  for ( size_t i = 0; i < mActive.size(); ++i )
+  {
+    std::getline( mIn, mLine );
+    const char *lineBegin = mLine.data();
+    mActive[i] = ( split( lineBegin, lineBegin + mLine.size(), tokens, 1 ) > 0 ) &&
+                 ( toInt( tokens[0].begin, tokens[0].end ) != 0 );
+  }
+
+  const Mesh2dm *m2dm = ( faceCentered || !mMapNativeIds ) ? nullptr : dynamic_cast<const Mesh2dm *>( mMesh );
+  // these are native format indexes (IDs). For formats without gaps it equals vertex array index
+  const size_t lineCount = faceCentered ? faceCount : mMeshIdCount;
+
+  for ( size_t id = 0; id < lineCount; ++id )
+  {
+    std::getline( mIn, mLine );
+    const char *lineBegin = mLine.data();
+    const size_t tokensCount = split( lineBegin, lineBegin + mLine.size(), tokens, 2 );
+
+    size_t index;
+    if ( m2dm )
+      index = m2dm->vertexIndex( id ); //this index may be out of values array
+    else
+      index = id;
+
+    if ( index * valuesPerIndex >= mValues.size() ) continue;
+
+    if ( isVector )
+    {
+      if ( tokensCount >= 2 ) // BASEMENT files with vectors have 3 columns
+      {
+        mValues[2 * index] = toDouble( tokens[0].begin, tokens[0].end );
+        mValues[2 * index + 1] = toDouble( tokens[1].begin, tokens[1].end );
+      }
+      else
+      {
+        debug( "invalid timestep line" );
+      }
+    }
+    else
+    {
+      if ( tokensCount >= 1 )
+        mValues[index] = toDouble( tokens[0].begin, tokens[0].end );
+      else
+      {
+        debug( "invalid timestep line" );
+      }
+    }
+  }
+
+  mPosition = position;
+  return true;
+}
+
+const std::vector<double> &MDAL::AsciiDatReader::values() const
+{
+  return mValues;
+}
+
+const std::vector<int> &MDAL::AsciiDatReader::active() const
+{
+  return mActive;
+}
+
+MDAL::AsciiDatDataset::AsciiDatDataset( DatasetGroup *parent, std::shared_ptr<AsciiDatReader> reader, std::streampos position, bool hasStatus )
+  : Dataset2D( parent )
+  , mReader( reader )
+  , mPosition( position )
+{
+  setSupportsActiveFlag( hasStatus );
+}
+
+MDAL::AsciiDatDataset::~AsciiDatDataset() = default;
+
+bool MDAL::AsciiDatDataset::readTimestep()
+{
+  return mReader->readTimestep( mPosition,
+                                !group()->isScalar(),
+                                group()->dataLocation() == MDAL_DataLocation::DataOnFaces2D,
+                                supportsActiveFlag() );
+}
+
+size_t MDAL::AsciiDatDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) || !readTimestep() )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  memcpy( buffer, mReader->values().data() + indexStart, copyValues * sizeof( double ) );
+  return copyValues;
+}
+
+size_t MDAL::AsciiDatDataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) || !readTimestep() )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  memcpy( buffer, mReader->values().data() + 2 * indexStart, 2 * copyValues * sizeof( double ) );
+  return copyValues;
+}
+
+size_t MDAL::AsciiDatDataset::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  if ( !supportsActiveFlag() )
+    return Dataset2D::activeData( indexStart, count, buffer );
+
+  size_t nValues = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) || !readTimestep() )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  memcpy( buffer, mReader->active().data() + indexStart, copyValues * sizeof( int ) );
+  return copyValues;
+}
+
 MDAL::DriverAsciiDat::DriverAsciiDat( ):
   Driver( "ASCII_DAT",
           "DAT",
@@ -40,6 +199,15 @@ MDAL::DriverAsciiDat *MDAL::DriverAsciiDat::create()
 
 MDAL::DriverAsciiDat::~DriverAsciiDat( ) = default;
 
+bool MDAL::DriverAsciiDat::canReadSignature( const MDAL::FileSignature &signature )
+{
+  if ( signature.format() != MDAL::FileSignature::Text )
+    return false;
+
+  const std::string line = trim( signature.headerLine() );
+  return canReadNewFormat( line ) || canReadOldFormat( line );
+}
+
 bool MDAL::DriverAsciiDat::canReadDatasets( const std::string &uri )
 {
   std::ifstream in( uri, std::ifstream::in );
@@ -53,14 +221,14 @@ bool MDAL::DriverAsciiDat::canReadDatasets( const std::string &uri )
   return canReadNewFormat( line ) || canReadOldFormat( line );
 }
 
-bool MDAL::DriverAsciiDat::canReadOldFormat( const std::string &line ) const
+bool MDAL::DriverAsciiDat::canReadOldFormat( const std::string &line )
 {
   return MDAL::contains( line, "SCALAR" ) ||
          MDAL::contains( line, "VECTOR" ) ||
          MDAL::contains( line, "TS" );
 }
 
-bool MDAL::DriverAsciiDat::canReadNewFormat( const std::string &line ) const
+bool MDAL::DriverAsciiDat::canReadNewFormat( const std::string &line )
 {
   return line == "DATASET";
 }
@@ -68,6 +236,7 @@ bool MDAL::DriverAsciiDat::canReadNewFormat( const std::string &line ) const
 
 void MDAL::DriverAsciiDat::loadOldFormat( std::ifstream &in,
     Mesh *mesh,
+    std::shared_ptr<AsciiDatReader> reader,
     MDAL_Status *status ) const
 {
   std::shared_ptr<DatasetGroup> group; // DAT outputs data
@@ -118,7 +287,7 @@ void MDAL::DriverAsciiDat::loadOldFormat( std::ifstream &in,
     {
       double rawTime = toDouble( items[ 1 ] );
       MDAL::RelativeTimestamp t( rawTime, MDAL::RelativeTimestamp::hours );
-      readVertexTimestep( mesh, group, t, isVector, false, in );
+      readVertexTimestep( mesh, group, t, false, reader, in );
     }
     else
     {
@@ -134,14 +303,15 @@ void MDAL::DriverAsciiDat::loadOldFormat( std::ifstream &in,
     EXIT_WITH_ERROR( MDAL_Status::Err_UnknownFormat )
   }
 
-  group->setStatistics( MDAL::calculateStatistics( group ) );
-  mesh->datasetGroups.push_back( group );
+  MDAL::updateStatistics( group );
+  addLoadedGroup( mesh, group );
   group.reset();
 }
 
 void MDAL::DriverAsciiDat::loadNewFormat(
   std::ifstream &in,
   Mesh *mesh,
+  std::shared_ptr<AsciiDatReader> reader,
   MDAL_Status *status ) const
 {
   bool isVector = false;
@@ -213,8 +383,8 @@ void MDAL::DriverAsciiDat::loadNewFormat(
         debug( "ENDDS card for no active dataset!" );
         EXIT_WITH_ERROR( MDAL_Status::Err_UnknownFormat )
       }
-      group->setStatistics( MDAL::calculateStatistics( group ) );
-      mesh->datasetGroups.push_back( group );
+      MDAL::updateStatistics( group );
+      addLoadedGroup( mesh, group );
       group.reset();
     }
     else if ( cardType == "NAME" && items.size() >= 2 )
@@ -251,12 +421,12 @@ void MDAL::DriverAsciiDat::loadNewFormat(
 
       if ( faceCentered )
       {
-        readFaceTimestep( mesh, group, t, isVector, in );
+        readFaceTimestep( mesh, group, t, reader, in );
       }
       else
       {
         bool hasStatus = ( toBool( items[1] ) );
-        readVertexTimestep( mesh, group, t, isVector, hasStatus, in );
+        readVertexTimestep( mesh, group, t, hasStatus, reader, in );
       }
 
     }
@@ -278,6 +448,12 @@ size_t MDAL::DriverAsciiDat::maximumId( const MDAL::Mesh *mesh ) const
     return mesh->verticesCount() - 1;
 }
 
+bool MDAL::DriverAsciiDat::supportsParallelLoad() const
+{
+  // the files are read with the standard streams only
+  return true;
+}
+
 /**
  * The DAT format contains "datasets" and each dataset has N-outputs. One output
  * represents data for all vertices/faces for one timestep
@@ -312,10 +488,13 @@ void MDAL::DriverAsciiDat::load( const std::string &datFile, MDAL::Mesh *mesh, M
     return;
   }
   line = trim( line );
+
+  // values of the time steps are read by the datasets, with own stream
+  std::shared_ptr<AsciiDatReader> reader = std::make_shared<AsciiDatReader>( mDatFile, mesh, mID + 1 );
   if ( canReadNewFormat( line ) )
   {
     // we do not need to parse first line again
-    loadNewFormat( in, mesh, status );
+    loadNewFormat( in, mesh, reader, status );
   }
   else
   {
@@ -323,7 +502,7 @@ void MDAL::DriverAsciiDat::load( const std::string &datFile, MDAL::Mesh *mesh, M
     // scalar/vector flag or timestep flag
     in.clear();
     in.seekg( 0 );
-    loadOldFormat( in, mesh, status );
+    loadOldFormat( in, mesh, reader, status );
   }
 }
 
@@ -331,68 +510,18 @@ void MDAL::DriverAsciiDat::readVertexTimestep(
   const MDAL::Mesh *mesh,
   std::shared_ptr<DatasetGroup> group,
   MDAL::RelativeTimestamp t,
-  bool isVector,
   bool hasStatus,
+  std::shared_ptr<AsciiDatReader> reader,
   std::ifstream &stream ) const
 {
   assert( group );
-  size_t faceCount = mesh->facesCount();
-  size_t vertexCount = mesh->verticesCount();
-
-  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MDAL::MemoryDataset2D >( group.get(), hasStatus );
+  std::shared_ptr<MDAL::AsciiDatDataset> dataset = std::make_shared< MDAL::AsciiDatDataset >( group.get(), reader, stream.tellg(), hasStatus );
   dataset->setTime( t );
 
-  // only for new format
-  for ( size_t i = 0; i < faceCount; ++i )
-  {
-    if ( hasStatus )
-    {
-      std::string line;
-      std::getline( stream, line );
-      dataset->setActive( i, toBool( line ) );
-    }
-  }
-
-  const Mesh2dm *m2dm = dynamic_cast<const Mesh2dm *>( mesh );
-  size_t meshIdCount = maximumId( mesh ) + 1; // these are native format indexes (IDs). For formats without gaps it equals vertex array index
-
-  for ( size_t id = 0; id < meshIdCount; ++id )
-  {
-    std::string line;
-    std::getline( stream, line );
-    std::vector<std::string> tsItems = split( line,  ' ' );
-
-    size_t index;
-    if ( m2dm )
-      index = m2dm->vertexIndex( id ); //this index may be out of values array
-    else
-      index = id;
-
-    if ( index >= vertexCount ) continue;
-
-    if ( isVector )
-    {
-      if ( tsItems.size() >= 2 ) // BASEMENT files with vectors have 3 columns
-      {
-        dataset->setVectorValue( index, toDouble( tsItems[0] ), toDouble( tsItems[1] ) );
-      }
-      else
-      {
-        debug( "invalid timestep line" );
-      }
-    }
-    else
-    {
-      if ( tsItems.size() >= 1 )
-        dataset->setScalarValue( index, toDouble( tsItems[0] ) );
-      else
-      {
-        debug( "invalid timestep line" );
-      }
-    }
-  }
+  // status flags only for new format, then a line for each native vertex index (ID)
+  size_t meshIdCount = maximumId( mesh ) + 1;
+  _skipLines( stream, ( hasStatus ? mesh->facesCount() : 0 ) + meshIdCount );
 
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
   group->datasets.push_back( dataset );
 }
 
@@ -400,126 +529,198 @@ void MDAL::DriverAsciiDat::readFaceTimestep(
   const MDAL::Mesh *mesh,
   std::shared_ptr<DatasetGroup> group,
   MDAL::RelativeTimestamp t,
-  bool isVector,
+  std::shared_ptr<AsciiDatReader> reader,
   std::ifstream &stream ) const
 {
   assert( group );
-
-  size_t faceCount = mesh->facesCount();
-
-  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MDAL::MemoryDataset2D >( group.get() );
+  std::shared_ptr<MDAL::AsciiDatDataset> dataset = std::make_shared< MDAL::AsciiDatDataset >( group.get(), reader, stream.tellg(), false );
   dataset->setTime( t );
-  for ( size_t index = 0; index < faceCount; ++index )
-  {
-    std::string line;
-    std::getline( stream, line );
-    std::vector<std::string> tsItems = split( line, ' ' );
 
-    if ( isVector )
-    {
-      if ( tsItems.size() >= 2 ) // BASEMENT files with vectors have 3 columns
-      {
-        dataset->setVectorValue( index, toDouble( tsItems[0] ), toDouble( tsItems[1] ) );
-      }
-      else
-      {
-        debug( "invalid timestep line" );
-      }
-    }
-    else
-    {
-      if ( tsItems.size() >= 1 )
-        dataset->setScalarValue( index, toDouble( tsItems[0] ) ) ;
-      else
-      {
-        debug( "invalid timestep line" );
-      }
-    }
-  }
+  _skipLines( stream, mesh->facesCount() );
 
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
   group->datasets.push_back( dataset );
 }
 
-bool MDAL::DriverAsciiDat::persist( MDAL::DatasetGroup *group )
+//! Size of the block of the text which is appended to the file at once
+static const size_t WRITE_BLOCK_SIZE = 4 * 1024 * 1024;
+
+MDAL::AsciiDatWriter::AsciiDatWriter( MDAL::DatasetGroup *group )
+  : mGroup( group )
+  , mIsOnVertices( group->dataLocation() == MDAL_DataLocation::DataOnVertices2D )
 {
   assert( ( group->dataLocation() == MDAL_DataLocation::DataOnFaces2D ) ||
           ( group->dataLocation() == MDAL_DataLocation::DataOnVertices2D ) );
 
-  const bool isScalar = group->isScalar();
-  const bool isOnVertices = group->dataLocation() == MDAL_DataLocation::DataOnVertices2D;
   std::string uri = group->uri();
 
-  if ( !MDAL::contains( uri, "_els" ) && isOnVertices == false )
+  if ( !MDAL::contains( uri, "_els" ) && mIsOnVertices == false )
   {
     // Should contain _els in name but it does not
     uri.insert( uri.size() - 4, "_els" );
   }
 
-  std::ofstream out( uri, std::ofstream::out );
+  mOut.open( uri, std::ofstream::out );
+  // numbers are written in the C locale whatever the global locale of the application is
+  mOut.imbue( std::locale::classic() );
 
   // implementation based on information from:
   // https://www.xmswiki.com/wiki/SMS:ASCII_Dataset_Files_*.dat
-  if ( !out )
-    return true; // Couldn't open the file
+  if ( !mOut )
+    return; // Couldn't open the file
 
   const Mesh *mesh = group->mesh();
   size_t nodeCount = mesh->verticesCount();
   size_t elemCount = mesh->facesCount();
 
-  out << "DATASET\n";
-  out << "OBJTYPE \"mesh2d\"\n";
+  mOut << "DATASET\n";
+  mOut << "OBJTYPE \"mesh2d\"\n";
 
-  if ( isScalar )
-    out << "BEGSCL\n";
+  if ( group->isScalar() )
+    mOut << "BEGSCL\n";
   else
-    out << "BEGVEC\n";
+    mOut << "BEGVEC\n";
 
-  out << "ND " << nodeCount << "\n";
-  out << "NC " << elemCount << "\n";
-  out << "NAME " "\"" << group->name() << "\"" "\n";
+  mOut << "ND " << nodeCount << "\n";
+  mOut << "NC " << elemCount << "\n";
+  mOut << "NAME " "\"" << group->name() << "\"" "\n";
   std::string referenceTimeStr = group->referenceTime().toJulianDayString();
 
   if ( !referenceTimeStr.empty() )
   {
-    out << "RT_JULIAN " << referenceTimeStr << "\n";
+    mOut << "RT_JULIAN " << referenceTimeStr << "\n";
   }
 
-  out << "TIMEUNITS " << 0 << "\n";
+  mOut << "TIMEUNITS " << 0 << "\n";
 
-  for ( size_t time_index = 0; time_index < group->datasets.size(); ++ time_index )
-  {
-    const std::shared_ptr<MDAL::MemoryDataset2D> dataset
-      = std::dynamic_pointer_cast<MDAL::MemoryDataset2D>( group->datasets[time_index] );
+  // written time steps are read back with own stream, a line for each vertex (not native ID)
+  mOut.flush();
+  mReader = std::make_shared<AsciiDatReader>( uri, mesh, nodeCount, false );
+  mBlock.reserve( WRITE_BLOCK_SIZE + 2 * MDAL::MAX_NUMBER_CHARS );
+}
+
+MDAL::AsciiDatWriter::~AsciiDatWriter()
+{
+  // the file is terminated even when the group is not persisted
+  if ( mOut.is_open() )
+    finish();
+}
 
-    bool hasActiveStatus = isOnVertices && dataset->supportsActiveFlag();
-    out << "TS " << hasActiveStatus << " " << std::to_string( dataset->time( RelativeTimestamp::hours ) ) << "\n";
+bool MDAL::AsciiDatWriter::isValid() const
+{
+  return mOut && mReader;
+}
+
+void MDAL::AsciiDatWriter::flushBlock( bool force )
+{
+  if ( mBlock.empty() || ( !force && mBlock.size() < WRITE_BLOCK_SIZE ) )
+    return;
 
-    if ( hasActiveStatus )
+  mOut.write( mBlock.data(), static_cast<std::streamsize>( mBlock.size() ) );
+  mBlock.clear();
+}
+
+std::shared_ptr<MDAL::Dataset> MDAL::AsciiDatWriter::writeTimestep( MDAL::RelativeTimestamp time, const double *values, const int *active )
+{
+  const Mesh *mesh = mGroup->mesh();
+  const bool isScalar = mGroup->isScalar();
+  const size_t elemCount = mesh->facesCount();
+
+  bool hasActiveStatus = mIsOnVertices && active;
+  char number[MDAL::MAX_NUMBER_CHARS];
+  mOut << "TS " << hasActiveStatus << " ";
+  mOut.write( number, static_cast<std::streamsize>( MDAL::doubleToChars( time.value( RelativeTimestamp::hours ), number ) ) );
+  mOut << "\n";
+  const std::streampos position = mOut.tellp();
+
+  if ( hasActiveStatus )
+  {
+    // Fill the active data
+    for ( size_t i = 0; i < elemCount; ++i )
     {
-      // Fill the active data
-      for ( size_t i = 0; i < elemCount; ++i )
-      {
-        int active = dataset->active( i );
-        out << ( active == 1 ? true : false ) << "\n";
-      }
+      mBlock += ( active[i] == 1 ) ? "1\n" : "0\n";
+      flushBlock( false );
     }
+  }
 
-    size_t valuesToWrite = isOnVertices ? nodeCount : elemCount;
+  size_t valuesToWrite = mIsOnVertices ? mesh->verticesCount() : elemCount;
 
-    for ( size_t i = 0; i < valuesToWrite; ++i )
+  // shortest text reading back to the same double in the C locale, so the read back values are the written ones
+  char line[2 * MDAL::MAX_NUMBER_CHARS + 2];
+  for ( size_t i = 0; i < valuesToWrite; ++i )
+  {
+    size_t n;
+    if ( isScalar )
     {
-      // Read values flags
-      if ( isScalar )
-        out << dataset->scalarValue( i ) << "\n";
-      else
-      {
-        out << dataset->valueX( i ) << " " << dataset->valueY( i )  << "\n";
-      }
+      n = MDAL::doubleToChars( values[i], line );
+    }
+    else
+    {
+      n = MDAL::doubleToChars( values[2 * i], line );
+      line[n++] = ' ';
+      n += MDAL::doubleToChars( values[2 * i + 1], line + n );
     }
+    line[n++] = '\n';
+    mBlock.append( line, n );
+    flushBlock( false );
+  }
+
+  // the time step must be in the file before it is read back
+  flushBlock( true );
+  mOut.flush();
+  if ( !mOut )
+    return nullptr;
+
+  std::shared_ptr<MDAL::AsciiDatDataset> dataset = std::make_shared< MDAL::AsciiDatDataset >( mGroup, mReader, position, hasActiveStatus );
+  dataset->setTime( time );
+  if ( !MDAL::openOptionAsBool( MDAL::OPTION_LAZY_STATISTICS ) )
+    dataset->setStatistics( MDAL::calculateStatistics( values, valuesToWrite, !isScalar ) );
+  return dataset;
+}
+
+bool MDAL::AsciiDatWriter::finish()
+{
+  mOut << "ENDDS";
+  mOut.close();
+  return !mOut;
+}
+
+MDAL::AsciiDatWriter *MDAL::DriverAsciiDat::writer( MDAL::DatasetGroup *group ) const
+{
+  if ( !group->writer() )
+  {
+    std::unique_ptr<AsciiDatWriter> writer( new AsciiDatWriter( group ) );
+    if ( !writer->isValid() )
+      return nullptr;
+    group->setWriter( std::move( writer ) );
   }
+  return static_cast<AsciiDatWriter *>( group->writer() );
+}
 
-  out << "ENDDS";
+void MDAL::DriverAsciiDat::createDataset( MDAL::DatasetGroup *group,
+    MDAL::RelativeTimestamp time,
+    const double *values,
+    const int *active )
+{
+  // the time step is written to the file now, values are not kept in memory
+  AsciiDatWriter *w = writer( group );
+  if ( !w )
+    return;
+
+  std::shared_ptr<Dataset> dataset = w->writeTimestep( time, values, active );
+  if ( !dataset )
+    return;
+
+  group->datasets.push_back( dataset );
+}
+
+bool MDAL::DriverAsciiDat::persist( MDAL::DatasetGroup *group )
+{
+  // time steps are already written by createDataset()
+  AsciiDatWriter *w = writer( group );
+  if ( !w )
+    return true; // Couldn't open the file
 
-  return false;
+  bool error = w->finish();
+  group->setWriter( nullptr );
+  return error;
 }
@@ -19,6 +19,98 @@
 
 namespace MDAL
 {
+  /**
+   * Parses time steps of ASCII DAT file from their positions in the file
+   *
+   * Lines of one time step map to vertices or faces only when the whole block
+   * is parsed (mesh may have numbering gaps), so the last parsed time step
+   * is kept for the following requests of the same dataset
+   */
+  class AsciiDatReader
+  {
+    public:
+      /**
+       * meshIdCount is number of native vertex IDs, see DriverAsciiDat::maximumId()
+       * Lines of files written by MDAL map to the vertex array indexes, these are read with mapNativeIds false
+       */
+      AsciiDatReader( const std::string &datFile, const Mesh *mesh, size_t meshIdCount, bool mapNativeIds = true );
+
+      /**
+       * Parses the time step starting at position, after its TS line
+       * 
+eturns false when the file cannot be read
+       */
+      bool readTimestep( std::streampos position, bool isVector, bool faceCentered, bool hasStatus );
+
+      //! Values of the last parsed time step, interleaved x and y for vectors
+      const std::vector<double> &values() const;
+      //! Active flags of the last parsed time step, empty when it has no status
+      const std::vector<int> &active() const;
+
+    private:
+      std::ifstream mIn;
+      const Mesh *mMesh;
+      size_t mMeshIdCount;
+      bool mMapNativeIds;
+      std::streampos mPosition = -1;
+      std::string mLine;
+      std::vector<double> mValues;
+      std::vector<int> mActive;
+  };
+
+  /**
+   * The AsciiDatDataset reads a single time step from the file on request
+   */
+  class AsciiDatDataset: public Dataset2D
+  {
+    public:
+      AsciiDatDataset( DatasetGroup *parent, std::shared_ptr<AsciiDatReader> reader, std::streampos position, bool hasStatus );
+      ~AsciiDatDataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+    private:
+      bool readTimestep();
+
+      std::shared_ptr<AsciiDatReader> mReader;
+      std::streampos mPosition;
+  };
+
+  /**
+   * Writes time steps of the group in edit mode to the file as they are added,
+   * so only one time step is held in memory. The written time steps are read back
+   * by AsciiDatDataset
+   */
+  class AsciiDatWriter: public DatasetGroupWriter
+  {
+    public:
+      //! Opens the file and writes the header, check isValid()
+      explicit AsciiDatWriter( DatasetGroup *group );
+      ~AsciiDatWriter() override;
+
+      bool isValid() const;
+
+      /**
+       * Writes the time step, values are interleaved x and y for vectors and active is optional
+       * \returns dataset reading the written time step, nullptr on error
+       */
+      std::shared_ptr<Dataset> writeTimestep( RelativeTimestamp time, const double *values, const int *active );
+
+      //! Writes end of the datasets and closes the file, returns true on error. Called by the destructor unless called before
+      bool finish();
+
+    private:
+      //! Appends the block to the file when it is full or when forced
+      void flushBlock( bool force );
+
+      DatasetGroup *mGroup;
+      bool mIsOnVertices;
+      std::ofstream mOut;
+      std::string mBlock;
+      std::shared_ptr<AsciiDatReader> mReader;
+  };
 
   /**
    * ASCII Dat format is used by various solvers and the output
@@ -53,16 +145,25 @@ namespace MDAL
       ~DriverAsciiDat( ) override;
       DriverAsciiDat *create() override;
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadDatasets( const std::string &uri ) override;
       void load( const std::string &datFile, Mesh *mesh, MDAL_Status *status ) override;
+      bool supportsParallelLoad() const override;
+      void createDataset( DatasetGroup *group,
+                          RelativeTimestamp time,
+                          const double *values,
+                          const int *active ) override;
       bool persist( DatasetGroup *group ) override;
 
     private:
-      bool canReadOldFormat( const std::string &line ) const;
-      bool canReadNewFormat( const std::string &line ) const;
+      //! Returns writer of the group, creates it and writes the header on the first call, nullptr on error
+      AsciiDatWriter *writer( DatasetGroup *group ) const;
+
+      static bool canReadOldFormat( const std::string &line );
+      static bool canReadNewFormat( const std::string &line );
 
-      void loadOldFormat( std::ifstream &in, Mesh *mesh, MDAL_Status *status ) const;
-      void loadNewFormat( std::ifstream &in, Mesh *mesh, MDAL_Status *status ) const;
+      void loadOldFormat( std::ifstream &in, Mesh *mesh, std::shared_ptr<AsciiDatReader> reader, MDAL_Status *status ) const;
+      void loadNewFormat( std::ifstream &in, Mesh *mesh, std::shared_ptr<AsciiDatReader> reader, MDAL_Status *status ) const;
 
       //! Gets maximum (native) index.
       //! For meshes without indexing gap it is vertexCount - 1
@@ -70,17 +171,19 @@ namespace MDAL
       //! maximum native index of the vertex in defined in the mesh
       size_t maximumId( const Mesh *mesh ) const;
 
+      //! Adds dataset for the time step and skips its lines, values are read by the dataset
       void readVertexTimestep( const Mesh *mesh,
                                std::shared_ptr<DatasetGroup> group,
                                RelativeTimestamp t,
-                               bool isVector,
                                bool hasStatus,
+                               std::shared_ptr<AsciiDatReader> reader,
                                std::ifstream &stream ) const;
 
+      //! Adds dataset for the time step and skips its lines, values are read by the dataset
       void readFaceTimestep( const Mesh *mesh,
                              std::shared_ptr<DatasetGroup> group,
                              RelativeTimestamp t,
-                             bool isVector,
+                             std::shared_ptr<AsciiDatReader> reader,
                              std::ifstream &stream ) const;
 
       std::string mDatFile;
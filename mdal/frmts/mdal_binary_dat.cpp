@@ -13,10 +13,13 @@
 #include <map>
 #include <cassert>
 #include <memory>
+#include <algorithm>
 
 #include "mdal_binary_dat.hpp"
 #include "mdal.h"
 #include "mdal_utils.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_options.hpp"
 
 #include <math.h>
 
@@ -78,6 +81,118 @@ static bool readIStat( std::ifstream &in, int sflg, char *flag )
   return false;
 }
 
+MDAL::BinaryDatDataset::BinaryDatDataset( DatasetGroup *parent,
+    std::shared_ptr<std::ifstream> in,
+    std::streampos activePosition,
+    std::streampos valuesPosition,
+    int sflg,
+    bool hasStatus )
+  : Dataset2D( parent )
+  , mIn( in )
+  , mActivePosition( activePosition )
+  , mValuesPosition( valuesPosition )
+  , mSflg( sflg )
+{
+  setSupportsActiveFlag( hasStatus );
+}
+
+MDAL::BinaryDatDataset::~BinaryDatDataset() = default;
+
+bool MDAL::BinaryDatDataset::readFloats( size_t indexStart, size_t count, float *values )
+{
+  const size_t valuesPerIndex = group()->isScalar() ? 1 : 2;
+  const size_t valuesCount = count * valuesPerIndex;
+
+  // the whole block is read by single call, the file is always little-endian
+  mIn->clear();
+  mIn->seekg( mValuesPosition + static_cast<std::streamoff>( indexStart * valuesPerIndex * CT_FLOAT_SIZE ) );
+  return MDAL::readValues( values, valuesCount, *mIn, !MDAL::isNativeLittleEndian() ) == valuesCount;
+}
+
+size_t MDAL::BinaryDatDataset::readData( size_t indexStart, size_t count, double *buffer )
+{
+  const size_t valuesPerIndex = group()->isScalar() ? 1 : 2;
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  mValuesBuffer.resize( count * valuesPerIndex );
+  if ( !readFloats( indexStart, count, mValuesBuffer.data() ) )
+    return 0;
+
+  MDAL::floatToDouble( mValuesBuffer.data(), mValuesBuffer.size(), buffer );
+  return count;
+}
+
+size_t MDAL::BinaryDatDataset::readDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  // values are stored as floats, read directly to the buffer
+  if ( !readFloats( indexStart, count, buffer ) )
+    return 0;
+  return count;
+}
+
+size_t MDAL::BinaryDatDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return readData( indexStart, count, buffer );
+}
+
+size_t MDAL::BinaryDatDataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return readData( indexStart, count, buffer );
+}
+
+size_t MDAL::BinaryDatDataset::scalarDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return readDataFloat( indexStart, count, buffer );
+}
+
+size_t MDAL::BinaryDatDataset::vectorDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return readDataFloat( indexStart, count, buffer );
+}
+
+size_t MDAL::BinaryDatDataset::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  if ( !supportsActiveFlag() )
+    return Dataset2D::activeData( indexStart, count, buffer );
+
+  size_t nFaces = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nFaces ) )
+    return 0;
+  count = std::min( nFaces - indexStart, count );
+
+  mIn->clear();
+  mIn->seekg( mActivePosition + static_cast<std::streamoff>( indexStart * static_cast<size_t>( mSflg ) ) );
+  if ( mSflg == CF_FLAG_SIZE )
+  {
+    mFlagsBuffer.resize( count );
+    if ( MDAL::readValues( mFlagsBuffer.data(), count, *mIn ) != count )
+      return 0;
+    for ( size_t i = 0; i < count; ++i )
+      buffer[i] = mFlagsBuffer[i] ? 1 : 0;
+  }
+  else
+  {
+    // 4-byte flags are read directly to the buffer
+    if ( MDAL::readValues( buffer, count, *mIn, !MDAL::isNativeLittleEndian() ) != count )
+      return 0;
+    for ( size_t i = 0; i < count; ++i )
+      buffer[i] = ( buffer[i] == 1 ) ? 1 : 0;
+  }
+  return count;
+}
+
 MDAL::DriverBinaryDat::DriverBinaryDat():
   Driver( "BINARY_DAT",
           "Binary DAT",
@@ -108,6 +223,12 @@ bool MDAL::DriverBinaryDat::canReadDatasets( const std::string &uri )
   return true;
 }
 
+bool MDAL::DriverBinaryDat::supportsParallelLoad() const
+{
+  // the files are read with the standard streams only
+  return true;
+}
+
 /**
  * The DAT format contains "datasets" and each dataset has N-outputs. One output
  * represents data for all vertices/faces for one timestep
@@ -135,6 +256,10 @@ void MDAL::DriverBinaryDat::load( const std::string &datFile, MDAL::Mesh *mesh,
   // http://www.xmswiki.com/wiki/SMS:Binary_Dataset_Files_*.dat
   if ( !in ) return exit_with_error( status, MDAL_Status::Err_FileNotFound, "Couldn't open the file" );
 
+  // values are read by the datasets later, with own stream
+  std::shared_ptr<std::ifstream> valuesIn = std::make_shared<std::ifstream>( mDatFile, std::ifstream::in | std::ifstream::binary );
+  if ( !( *valuesIn ) ) return exit_with_error( status, MDAL_Status::Err_FileNotFound, "Couldn't open the file" );
+
   size_t vertexCount = mesh->verticesCount();
   size_t elemCount = mesh->facesCount();
 
@@ -291,7 +416,7 @@ void MDAL::DriverBinaryDat::load( const std::string &datFile, MDAL::Mesh *mesh,
         double rawTime = static_cast<double>( time );
         MDAL::RelativeTimestamp t( rawTime, MDAL::parseDurationTimeUnit( timeUnitStr ) );
 
-        if ( readVertexTimestep( mesh, group, groupMax, t, istat, sflg, in ) )
+        if ( readVertexTimestep( mesh, group, groupMax, t, istat, sflg, in, valuesIn ) )
           return exit_with_error( status, MDAL_Status::Err_UnknownFormat, "Unable to read vertex timestep" );
 
         break;
@@ -301,13 +426,13 @@ void MDAL::DriverBinaryDat::load( const std::string &datFile, MDAL::Mesh *mesh,
   if ( !group || group->datasets.size() == 0 )
     return exit_with_error( status, MDAL_Status::Err_UnknownFormat, "No datasets" );
 
-  group->setStatistics( MDAL::calculateStatistics( group ) );
-  mesh->datasetGroups.push_back( group );
+  MDAL::updateStatistics( group );
+  addLoadedGroup( mesh, group );
 
   if ( groupMax && groupMax->datasets.size() > 0 )
   {
-    groupMax->setStatistics( MDAL::calculateStatistics( groupMax ) );
-    mesh->datasetGroups.push_back( groupMax );
+    MDAL::updateStatistics( groupMax );
+    addLoadedGroup( mesh, groupMax );
   }
 }
 
@@ -318,7 +443,8 @@ bool MDAL::DriverBinaryDat::readVertexTimestep(
   MDAL::RelativeTimestamp time,
   bool hasStatus,
   int sflg,
-  std::ifstream &in )
+  std::ifstream &in,
+  std::shared_ptr<std::ifstream> valuesIn )
 {
   assert( group && groupMax && ( group->isScalar() == groupMax->isScalar() ) );
   bool isScalar = group->isScalar();
@@ -326,54 +452,36 @@ bool MDAL::DriverBinaryDat::readVertexTimestep(
   size_t vertexCount = mesh->verticesCount();
   size_t faceCount = mesh->facesCount();
 
-  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MDAL::MemoryDataset2D >( group.get(), hasStatus );
+  // only positions of the status flags and values are stored, these are read by the dataset
+  std::streampos activePosition = in.tellg();
+  if ( hasStatus )
+    in.seekg( static_cast<std::streamoff>( faceCount * static_cast<size_t>( sflg ) ), in.cur );
 
-  bool active = true;
-  for ( size_t i = 0; i < faceCount; ++i )
-  {
-    if ( hasStatus )
-    {
-      if ( readIStat( in, sflg, reinterpret_cast< char * >( &active ) ) )
-        return true; //error
-
-    }
-    dataset->setActive( i, active );
-  }
+  std::streampos valuesPosition = in.tellg();
+  std::streampos valuesEnd = valuesPosition + static_cast<std::streamoff>( vertexCount * ( isScalar ? 1 : 2 ) * CT_FLOAT_SIZE );
 
-  for ( size_t i = 0; i < vertexCount; ++i )
-  {
-    if ( !isScalar )
-    {
-      float x, y;
-
-      if ( read( in, reinterpret_cast< char * >( &x ), 4 ) )
-        return true; //error
-      if ( read( in, reinterpret_cast< char * >( &y ), 4 ) )
-        return true; //error
-
-      dataset->setVectorValue( i, static_cast< double >( x ), static_cast< double >( y ) );
-    }
-    else
-    {
-      float scalar;
-
-      if ( read( in, reinterpret_cast< char * >( &scalar ), 4 ) )
-        return true; //error
+  // seeking past the end does not fail, check the time step is complete
+  in.seekg( 0, in.end );
+  if ( !in || in.tellg() < valuesEnd )
+    return true; //error
+  in.seekg( valuesEnd );
 
-      dataset->setScalarValue( i, static_cast< double >( scalar ) );
-    }
-  }
+  std::shared_ptr<MDAL::BinaryDatDataset> dataset = std::make_shared< MDAL::BinaryDatDataset >(
+        group.get(),
+        valuesIn,
+        activePosition,
+        valuesPosition,
+        sflg,
+        hasStatus );
 
   if ( MDAL::equals( time.value( MDAL::RelativeTimestamp::hours ), 99999.0 ) ) // Special TUFLOW dataset with maximus
   {
     dataset->setTime( time );
-    dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
     groupMax->datasets.push_back( dataset );
   }
   else
   {
     dataset->setTime( time );
-    dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
     group->datasets.push_back( dataset );
   }
   return false; //OK
@@ -392,104 +500,184 @@ static bool writeRawData( std::ofstream &out, const char *s, int n )
     return false; //OK
 }
 
-bool MDAL::DriverBinaryDat::persist( MDAL::DatasetGroup *group )
+//! Size of the write buffer, a time step is written by blocks of this size
+static const size_t WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+MDAL::BinaryDatWriter::BinaryDatWriter( MDAL::DatasetGroup *group )
+  : mGroup( group )
+  , mOutBuffer( WRITE_BUFFER_SIZE )
 {
   assert( group->dataLocation() == MDAL_DataLocation::DataOnVertices2D );
 
-  std::ofstream out( group->uri(), std::ofstream::out | std::ofstream::binary );
+  // the buffer must be set before the file is opened
+  mOut.rdbuf()->pubsetbuf( mOutBuffer.data(), static_cast<std::streamsize>( mOutBuffer.size() ) );
+  mOut.open( group->uri(), std::ofstream::out | std::ofstream::binary );
 
   // implementation based on information from:
   // http://www.xmswiki.com/wiki/SMS:Binary_Dataset_Files_*.dat
-  if ( !out )
-    return true; // Couldn't open the file
+  if ( !mOut )
+    return; // Couldn't open the file
 
   const Mesh *mesh = group->mesh();
-  size_t nodeCount = mesh->verticesCount();
-  size_t elemCount = mesh->facesCount();
+  int nodeCount = static_cast<int>( mesh->verticesCount() );
+  int elemCount = static_cast<int>( mesh->facesCount() );
 
   // version card
-  writeRawData( out, reinterpret_cast< const char * >( &CT_VERSION ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_VERSION ), 4 );
 
   // objecttype
-  writeRawData( out, reinterpret_cast< const char * >( &CT_OBJTYPE ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &CT_2D_MESHES ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_OBJTYPE ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_2D_MESHES ), 4 );
 
   // float size
-  writeRawData( out, reinterpret_cast< const char * >( &CT_SFLT ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &CT_FLOAT_SIZE ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_SFLT ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_FLOAT_SIZE ), 4 );
 
   // Flag size
-  writeRawData( out, reinterpret_cast< const char * >( &CT_SFLG ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &CF_FLAG_SIZE ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_SFLG ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CF_FLAG_SIZE ), 4 );
 
   // Dataset Group Type
   if ( group->isScalar() )
   {
-    writeRawData( out, reinterpret_cast< const char * >( &CT_BEGSCL ), 4 );
+    writeRawData( mOut, reinterpret_cast< const char * >( &CT_BEGSCL ), 4 );
   }
   else
   {
-    writeRawData( out, reinterpret_cast< const char * >( &CT_BEGVEC ), 4 );
+    writeRawData( mOut, reinterpret_cast< const char * >( &CT_BEGVEC ), 4 );
   }
 
   // Object id (ignored)
   int ignored_val = 1;
-  writeRawData( out, reinterpret_cast< const char * >( &CT_OBJID ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &ignored_val ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_OBJID ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &ignored_val ), 4 );
 
   // Num nodes
-  writeRawData( out, reinterpret_cast< const char * >( &CT_NUMDATA ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &nodeCount ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_NUMDATA ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &nodeCount ), 4 );
 
   // Num cells
-  writeRawData( out, reinterpret_cast< const char * >( &CT_NUMCELLS ), 4 );
-  writeRawData( out, reinterpret_cast< const char * >( &elemCount ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_NUMCELLS ), 4 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &elemCount ), 4 );
 
   // Name
-  writeRawData( out, reinterpret_cast< const char * >( &CT_NAME ), 4 );
-  writeRawData( out, MDAL::leftJustified( group->name(), 39 ).c_str(), 40 );
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_NAME ), 4 );
+  writeRawData( mOut, MDAL::leftJustified( group->name(), 39 ).c_str(), 40 );
 
-  // Time steps
-  int istat = 1; // include if elements are active
+  // written time steps are read back with own stream
+  mOut.flush();
+  mIn = std::make_shared<std::ifstream>( group->uri(), std::ifstream::in | std::ifstream::binary );
+}
 
-  for ( size_t time_index = 0; time_index < group->datasets.size(); ++ time_index )
-  {
-    const std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::dynamic_pointer_cast<MDAL::MemoryDataset2D>( group->datasets[time_index] );
+MDAL::BinaryDatWriter::~BinaryDatWriter()
+{
+  // the file is terminated even when the group is not persisted
+  if ( mOut.is_open() )
+    finish();
+}
 
-    writeRawData( out, reinterpret_cast< const char * >( &CT_TS ), 4 );
-    writeRawData( out, reinterpret_cast< const char * >( &istat ), 1 );
-    float ftime = static_cast<float>( dataset->time( RelativeTimestamp::hours ) );
-    writeRawData( out, reinterpret_cast< const char * >( &ftime ), 4 );
+bool MDAL::BinaryDatWriter::isValid() const
+{
+  return mOut && mIn && *mIn;
+}
 
-    if ( istat )
-    {
-      // Write status flags
-      for ( size_t i = 0; i < elemCount; i++ )
-      {
-        bool active = static_cast<bool>( dataset->active( i ) );
-        writeRawData( out, reinterpret_cast< const char * >( &active ), 1 );
-      }
-    }
+std::shared_ptr<MDAL::Dataset> MDAL::BinaryDatWriter::writeTimestep( MDAL::RelativeTimestamp time, const double *values, const int *active )
+{
+  const Mesh *mesh = mGroup->mesh();
+  const size_t nodeCount = mesh->verticesCount();
+  const size_t elemCount = mesh->facesCount();
+  const size_t valuesCount = nodeCount * ( mGroup->isScalar() ? 1 : 2 );
+
+  writeRawData( mOut, reinterpret_cast< const char * >( &CT_TS ), 4 );
+  const char istat = 1; // include if elements are active
+  writeRawData( mOut, &istat, 1 );
+  float ftime = static_cast<float>( time.value( RelativeTimestamp::hours ) );
+  writeRawData( mOut, reinterpret_cast< const char * >( &ftime ), 4 );
+
+  // Write status flags, all elements are active without flags
+  const std::streampos activePosition = mOut.tellp();
+  mFlags.resize( elemCount );
+  for ( size_t i = 0; i < elemCount; i++ )
+    mFlags[i] = active ? static_cast<char>( active[i] != 0 ) : 1;
+  mOut.write( mFlags.data(), static_cast<std::streamsize>( mFlags.size() ) );
+
+  // Write values, the file is always little-endian
+  // statistics are calculated from the values rounded to float, which are read back from the file
+  const bool calculateStatistics = !MDAL::openOptionAsBool( MDAL::OPTION_LAZY_STATISTICS );
+  const std::streampos valuesPosition = mOut.tellp();
+  mValues.resize( valuesCount );
+  mWrittenValues.resize( calculateStatistics ? valuesCount : 0 );
+  for ( size_t i = 0; i < valuesCount; i++ )
+    mValues[i] = static_cast<float>( values[i] );
+  if ( calculateStatistics )
+    std::copy( mValues.begin(), mValues.end(), mWrittenValues.begin() );
+  if ( !MDAL::isNativeLittleEndian() )
+    MDAL::changeEndianness( mValues.data(), mValues.size() );
+  mOut.write( reinterpret_cast< const char * >( mValues.data() ), static_cast<std::streamsize>( mValues.size() * sizeof( float ) ) );
+
+  // the time step must be in the file before it is read back
+  mOut.flush();
+  if ( !mOut )
+    return nullptr;
+
+  std::shared_ptr<BinaryDatDataset> dataset = std::make_shared<BinaryDatDataset>(
+        mGroup,
+        mIn,
+        activePosition,
+        valuesPosition,
+        CF_FLAG_SIZE,
+        active != nullptr );
+  // the time is read back as float too
+  dataset->setTime( static_cast<double>( ftime ), RelativeTimestamp::hours );
+  if ( calculateStatistics )
+    dataset->setStatistics( MDAL::calculateStatistics( mWrittenValues.data(), nodeCount, !mGroup->isScalar() ) );
+  return dataset;
+}
 
-    for ( size_t i = 0; i < nodeCount; i++ )
-    {
-      // Read values flags
-      if ( !group->isScalar() )
-      {
-        float x = static_cast<float>( dataset->valueX( i ) );
-        float y = static_cast<float>( dataset->valueY( i ) );
-        writeRawData( out, reinterpret_cast< const char * >( &x ), 4 );
-        writeRawData( out, reinterpret_cast< const char * >( &y ), 4 );
-      }
-      else
-      {
-        float val = static_cast<float>( dataset->scalarValue( i ) );
-        writeRawData( out, reinterpret_cast< const char * >( &val ), 4 );
-      }
-    }
+bool MDAL::BinaryDatWriter::finish()
+{
+  const bool error = writeRawData( mOut, reinterpret_cast< const char * >( &CT_ENDDS ), 4 );
+  mOut.close();
+  return error || !mOut;
+}
+
+MDAL::BinaryDatWriter *MDAL::DriverBinaryDat::writer( MDAL::DatasetGroup *group ) const
+{
+  if ( !group->writer() )
+  {
+    std::unique_ptr<BinaryDatWriter> writer( new BinaryDatWriter( group ) );
+    if ( !writer->isValid() )
+      return nullptr;
+    group->setWriter( std::move( writer ) );
   }
+  return static_cast<BinaryDatWriter *>( group->writer() );
+}
 
-  if ( writeRawData( out, reinterpret_cast< const char * >( &CT_ENDDS ), 4 ) ) return true;
+void MDAL::DriverBinaryDat::createDataset( MDAL::DatasetGroup *group,
+    MDAL::RelativeTimestamp time,
+    const double *values,
+    const int *active )
+{
+  // the time step is written to the file now, values are not kept in memory
+  BinaryDatWriter *w = writer( group );
+  if ( !w )
+    return;
 
-  return false;
+  std::shared_ptr<Dataset> dataset = w->writeTimestep( time, values, active );
+  if ( !dataset )
+    return;
+
+  group->datasets.push_back( dataset );
+}
+
+bool MDAL::DriverBinaryDat::persist( MDAL::DatasetGroup *group )
+{
+  // time steps are already written by createDataset()
+  BinaryDatWriter *w = writer( group );
+  if ( !w )
+    return true; // Couldn't open the file
+
+  bool error = w->finish();
+  group->setWriter( nullptr );
+  return error;
 }
@@ -19,6 +19,81 @@
 
 namespace MDAL
 {
+  /**
+   * The BinaryDatDataset reads values and active flags of a single time step
+   * from the file on request
+   *
+   * Each time step is stored as optional status flags for all faces followed
+   * by the values for all vertices, positions of these are found on load
+   */
+  class BinaryDatDataset: public Dataset2D
+  {
+    public:
+      BinaryDatDataset( DatasetGroup *parent,
+                        std::shared_ptr<std::ifstream> in,
+                        std::streampos activePosition,
+                        std::streampos valuesPosition,
+                        int sflg,
+                        bool hasStatus );
+      ~BinaryDatDataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Values are stored as floats, so these are read without conversion
+      size_t scalarDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+      size_t vectorDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+
+    private:
+      //! Reads values of count vertices by a single read of the stream
+      bool readFloats( size_t indexStart, size_t count, float *values );
+      size_t readData( size_t indexStart, size_t count, double *buffer );
+      size_t readDataFloat( size_t indexStart, size_t count, float *buffer );
+
+      std::shared_ptr<std::ifstream> mIn;
+      std::streampos mActivePosition;
+      std::streampos mValuesPosition;
+      int mSflg;
+
+      // reused between the requests, reads of the dataset are serialized
+      std::vector<float> mValuesBuffer;
+      std::vector<char> mFlagsBuffer;
+  };
+
+  /**
+   * Writes time steps of the group in edit mode to the file as they are added,
+   * so only one time step is held in memory. The written time steps are read back
+   * by BinaryDatDataset
+   */
+  class BinaryDatWriter: public DatasetGroupWriter
+  {
+    public:
+      //! Opens the file and writes the header, check isValid()
+      explicit BinaryDatWriter( DatasetGroup *group );
+      ~BinaryDatWriter() override;
+
+      bool isValid() const;
+
+      /**
+       * Writes the time step, values are interleaved x and y for vectors and active is optional
+       * \returns dataset reading the written time step, nullptr on error
+       */
+      std::shared_ptr<Dataset> writeTimestep( RelativeTimestamp time, const double *values, const int *active );
+
+      //! Writes end of the datasets and closes the file, returns true on error. Called by the destructor unless called before
+      bool finish();
+
+    private:
+      DatasetGroup *mGroup;
+      std::vector<char> mOutBuffer;
+      std::ofstream mOut;
+      std::shared_ptr<std::ifstream> mIn;
+      std::vector<float> mValues;
+      //! Values of the time step as read back, for the statistics
+      std::vector<double> mWrittenValues;
+      std::vector<char> mFlags;
+  };
 
   class DriverBinaryDat: public Driver
   {
@@ -29,16 +104,25 @@ namespace MDAL
 
       bool canReadDatasets( const std::string &uri ) override;
       void load( const std::string &datFile, Mesh *mesh, MDAL_Status *status ) override;
+      bool supportsParallelLoad() const override;
+      void createDataset( DatasetGroup *group,
+                          RelativeTimestamp time,
+                          const double *values,
+                          const int *active ) override;
       bool persist( DatasetGroup *group ) override;
 
     private:
+      //! Returns writer of the group, creates it and writes the header on the first call, nullptr on error
+      BinaryDatWriter *writer( DatasetGroup *group ) const;
+
       bool readVertexTimestep( const Mesh *mesh,
                                std::shared_ptr<DatasetGroup> group,
                                std::shared_ptr<DatasetGroup> groupMax,
                                RelativeTimestamp time,
                                bool hasStatus,
                                int sflg,
-                               std::ifstream &in );
+                               std::ifstream &in,
+                               std::shared_ptr<std::ifstream> valuesIn );
 
       std::string mDatFile;
   };
@@ -230,7 +230,7 @@ void MDAL::DriverCF::addDatasetGroups( MDAL::Mesh *mesh, const std::vector<Relat
     // Add to mesh
     if ( !group->datasets.empty() )
     {
-      group->setStatistics( MDAL::calculateStatistics( group ) );
+      MDAL::updateStatistics( group );
       group->setReferenceTime( referenceTime );
       mesh->datasetGroups.push_back( group );
     }
@@ -279,7 +279,7 @@ std::shared_ptr<MDAL::Dataset> MDAL::DriverCF::create2DDataset( std::shared_ptr<
         ts,
         mNcFile
       );
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+  MDAL::updateStatistics( dataset );
   return std::move( dataset );
 }
 
@@ -302,6 +302,13 @@ MDAL::DriverCF::DriverCF( const std::string &name,
 
 MDAL::DriverCF::~DriverCF() = default;
 
+bool MDAL::DriverCF::canReadSignature( const MDAL::FileSignature &signature )
+{
+  // NetCDF4 files are HDF5 files
+  return signature.format() == MDAL::FileSignature::NetCDF ||
+         signature.format() == MDAL::FileSignature::Hdf5;
+}
+
 bool MDAL::DriverCF::canReadMesh( const std::string &uri )
 {
   try
@@ -600,3 +607,59 @@ size_t MDAL::CFDataset2D::vectorData( size_t indexStart, size_t count, double *b
 
   return copyValues;
 }
+
+size_t MDAL::CFDataset2D::dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer )
+{
+  // datasets of the group are consecutive time steps of the same variable
+  if ( mTimeLocation == CFDatasetGroupInfo::NoTimeDimension )
+    return 0;
+  if ( ( count < 1 ) || ( indexStart + count > mValues ) )
+    return 0;
+  if ( mTs + datasetCount > mTimesteps )
+    return 0;
+
+  const bool isVector = !group()->isScalar();
+  const bool timeFirstDim = mTimeLocation == CFDatasetGroupInfo::TimeDimensionFirst;
+  size_t start_dim1 = timeFirstDim ?  mTs : indexStart;
+  size_t start_dim2 = timeFirstDim ?  indexStart : mTs;
+  size_t count_dim1 = timeFirstDim ?  datasetCount : count;
+  size_t count_dim2 = timeFirstDim ?  count : datasetCount;
+
+  std::vector<double> values_x = mNcFile->readDoubleArr(
+                                   mNcidX,
+                                   start_dim1,
+                                   start_dim2,
+                                   count_dim1,
+                                   count_dim2
+                                 );
+  std::vector<double> values_y;
+  if ( isVector )
+  {
+    values_y = mNcFile->readDoubleArr(
+                 mNcidY,
+                 start_dim1,
+                 start_dim2,
+                 count_dim1,
+                 count_dim2
+               );
+  }
+
+  for ( size_t t = 0; t < datasetCount; ++t )
+  {
+    for ( size_t i = 0; i < count; ++i )
+    {
+      // with time as last dimension the values are read as [index][time]
+      const size_t idx = timeFirstDim ? t * count + i : i * datasetCount + t;
+      populate_vals( isVector,
+                     buffer,
+                     t * count + i,
+                     values_x,
+                     values_y,
+                     idx,
+                     mFillValX,
+                     mFillValY );
+    }
+  }
+
+  return count;
+}
@@ -88,6 +88,8 @@ namespace MDAL
 
       virtual size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
       virtual size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      //! Reads the time steps by single nc_get_vars call for each component
+      virtual size_t dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer ) override;
 
     protected:
       double mFillValX;
@@ -112,6 +114,7 @@ namespace MDAL
                 const std::string &filters,
                 const int capabilities );
       virtual ~DriverCF() override;
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadMesh( const std::string &uri ) override;
       std::unique_ptr< Mesh > load( const std::string &fileName, MDAL_Status *status ) override;
 
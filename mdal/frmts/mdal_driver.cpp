@@ -6,7 +6,9 @@
 #include <string.h>
 #include "mdal_driver.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_options.hpp"
 #include "mdal_memory_data_model.hpp"
+#include "mdal_sparse_dataset.hpp"
 
 MDAL::Driver::Driver( const std::string &name,
                       const std::string &longName,
@@ -41,6 +43,8 @@ bool MDAL::Driver::hasCapability( MDAL::Capability capability ) const
   return capability == ( mCapabilityFlags & capability );
 }
 
+bool MDAL::Driver::canReadSignature( const FileSignature & ) { return true; }
+
 bool MDAL::Driver::canReadMesh( const std::string & ) { return false; }
 
 bool MDAL::Driver::canReadDatasets( const std::string & ) { return false; }
@@ -66,8 +70,28 @@ std::unique_ptr< MDAL::Mesh > MDAL::Driver::load( const std::string &, MDAL_Stat
 
 void MDAL::Driver::load( const std::string &, Mesh *, MDAL_Status * ) {}
 
+bool MDAL::Driver::supportsParallelLoad() const { return false; }
+
+void MDAL::Driver::setLoadedGroups( DatasetGroups *groups )
+{
+  mLoadedGroups = groups;
+}
+
+void MDAL::Driver::addLoadedGroup( MDAL::Mesh *mesh, const std::shared_ptr<DatasetGroup> &group ) const
+{
+  if ( mLoadedGroups )
+    mLoadedGroups->push_back( group );
+  else
+    mesh->datasetGroups.push_back( group );
+}
+
 void MDAL::Driver::save( const std::string &, MDAL::Mesh *, MDAL_Status * ) {}
 
+void MDAL::Driver::saveToStream( std::ostream &, MDAL::Mesh *, MDAL_Status *status )
+{
+  if ( status ) *status = MDAL_Status::Err_MissingDriverCapability;
+}
+
 void MDAL::Driver::createDatasetGroup( MDAL::Mesh *mesh, const std::string &groupName, MDAL_DataLocation dataLocation, bool hasScalarData, const std::string &datasetGroupFile )
 {
   std::shared_ptr<MDAL::DatasetGroup> grp(
@@ -87,16 +111,18 @@ void MDAL::Driver::createDataset( MDAL::DatasetGroup *group, MDAL::RelativeTimes
   bool supportsActiveFlag = ( active != nullptr );
   std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group, supportsActiveFlag );
   dataset->setTime( time );
-  size_t count = dataset->valuesCount();
-
-  if ( !group->isScalar() )
-    count *= 2;
-
-  memcpy( dataset->values(), values, sizeof( double ) * count );
+  dataset->setValues( values );
   if ( dataset->supportsActiveFlag() )
     dataset->setActive( active );
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
-  group->datasets.push_back( dataset );
+  MDAL::updateStatistics( dataset );
+
+  const double sparseFraction = MDAL::sparseDatasetsFraction();
+  std::shared_ptr<MDAL::Dataset> stored = dataset;
+  if ( sparseFraction >= 0 )
+    stored = MDAL::sparseIfMostlyInvalid( dataset, sparseFraction );
+  if ( stored == dataset && MDAL::openOptionAsBool( MDAL::OPTION_COMPRESS_DATASETS ) )
+    dataset->compress();
+  group->datasets.push_back( stored );
 }
 
 bool MDAL::Driver::persist( MDAL::DatasetGroup * ) { return true; } // failure
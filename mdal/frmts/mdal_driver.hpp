@@ -6,8 +6,10 @@
 #ifndef MDAL_DRIVER_HPP
 #define MDAL_DRIVER_HPP
 
+#include <ostream>
 #include <string>
 #include "mdal_data_model.hpp"
+#include "mdal_file_signature.hpp"
 #include "mdal.h"
 
 namespace MDAL
@@ -21,6 +23,7 @@ namespace MDAL
     WriteDatasetsOnVertices2D = 1 << 3, //! Can write datasets (groups) on MDAL_DataLocation::DataOnVertices2D
     WriteDatasetsOnFaces2D    = 1 << 4, //! Can write datasets (groups) on MDAL_DataLocation::DataOnFaces2D
     WriteDatasetsOnVolumes3D  = 1 << 5, //! Can write datasets (groups) on MDAL_DataLocation::DataOnVolumes3D
+    SaveMeshToStream          = 1 << 6, //! Can save the mesh to a stream, e.g. to a memory buffer
   };
 
   class Driver
@@ -41,6 +44,13 @@ namespace MDAL
       bool hasCapability( Capability capability ) const;
       bool hasWriteDatasetCapability( MDAL_DataLocation location ) const;
 
+      /**
+       * Quick check of the leading bytes of the file, done before canReadMesh() or canReadDatasets()
+       * Returns false only when the driver certainly cannot read the file, true by default
+       *
+       * It is checked before the driver is created, so drivers hide it with their own static function
+       */
+      static bool canReadSignature( const FileSignature &signature );
       virtual bool canReadMesh( const std::string &uri );
       virtual bool canReadDatasets( const std::string &uri );
 
@@ -51,9 +61,25 @@ namespace MDAL
       virtual std::unique_ptr< Mesh > load( const std::string &uri, MDAL_Status *status );
       // loads datasets
       virtual void load( const std::string &uri, Mesh *mesh, MDAL_Status *status );
+
+      /**
+       * Whether the datasets are loaded only reading the mesh and without any library that is not thread-safe,
+       * so several files can be loaded at once, each with its own driver created by create(). False by default
+       */
+      virtual bool supportsParallelLoad() const;
+
+      /**
+       * Makes load( uri, mesh, status ) collect the loaded dataset groups in groups instead of adding them to the mesh,
+       * null to add them to the mesh again. Used by the drivers that support parallel load
+       */
+      void setLoadedGroups( DatasetGroups *groups );
       // save mesh
       virtual void save( const std::string &uri, Mesh *mesh, MDAL_Status *status );
 
+      //! Saves the mesh to the stream instead of a file, for the drivers with SaveMeshToStream capability
+      //! The stream is seekable, drivers may seek back within the written data
+      virtual void saveToStream( std::ostream &stream, Mesh *mesh, MDAL_Status *status );
+
       // create new dataset group
       virtual void createDatasetGroup(
         Mesh *mesh,
@@ -72,11 +98,16 @@ namespace MDAL
       // returns true on error, false on success
       virtual bool persist( DatasetGroup *group );
 
+    protected:
+      //! Adds the loaded group to the mesh or to the groups set by setLoadedGroups()
+      void addLoadedGroup( Mesh *mesh, const std::shared_ptr<DatasetGroup> &group ) const;
+
     private:
       std::string mName;
       std::string mLongName;
       std::string mFilters;
       int mCapabilityFlags;
+      DatasetGroups *mLoadedGroups = nullptr;
   };
 
 } // namespace MDAL
@@ -5,6 +5,10 @@
 
 #include "mdal_esri_tin.hpp"
 
+#include <string.h>
+
+#include "mdal_mapped_file.hpp"
+
 MDAL::DriverEsriTin::DriverEsriTin(): Driver( "ESRI_TIN",
       "Esri TIN",
       "*.adf",
@@ -22,8 +26,6 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverEsriTin::load( const std::string &uri, M
 
   try
   {
-    std::list<int> superpointIndexes;
-    Faces faces;
     bool isNativeLittleEndian = MDAL::isNativeLittleEndian();
 
     //read the total number of vertices (including superpoints and isolated vertices)
@@ -38,18 +40,18 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverEsriTin::load( const std::string &uri, M
     readValue( totalIndexesCount32, inDenv, isNativeLittleEndian );
     size_t totalIndexesCount = static_cast<size_t>( totalIndexesCount32 );
 
-    /* Round 1 :populates faces with raw indexes from the file
+    /* Round 1 :reads raw indexes of the unmasked faces from the file
      * rawAndCorrectedIndexesMap is used to map raw indexes from the files and corrected indexes
      * Corrected indexes take into account the unwanted vertexes (superpoints, isolated vertices)
      * Wanted vertices are associated with the corrected index
      * Unwanted vertices are associated with the totalIndexesCount value
      */
     std::vector<size_t> rawAndCorrectedIndexesMap( totalIndexesCount, totalIndexesCount );
-    std::ifstream inFaces( faceFile( uri ), std::ifstream::in | std::ifstream::binary );
+    MappedFile inFaces( faceFile( uri ) );
     std::ifstream inMsk( mskFile( uri ), std::ifstream::in | std::ifstream::binary );
     std::ifstream inMsx( msxFile( uri ), std::ifstream::in | std::ifstream::binary );
 
-    if ( ! inFaces.is_open() )
+    if ( ! inFaces.isValid() )
       throw MDAL_Status::Err_FileNotFound;
     if ( ! inMsk.is_open() )
       throw MDAL_Status::Err_FileNotFound;
@@ -72,49 +74,50 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverEsriTin::load( const std::string &uri, M
     if ( ! readValue( maskBitsCount, inMsk, true ) )
       throw MDAL_Status::Err_UnknownFormat;
 
-    int c = 0;
-    int32_t maskInt = 0;
-    while ( true )
-    {
-      //read mask file
-      if ( c % 32 == 0 && c < maskBitsCount ) //first bit in the mask array have to be used-->read next maskInt
-        if ( ! readValue( maskInt, inMsk, true ) )
-          throw MDAL_Status::Err_UnknownFormat;
-
-      Face f;
-      for ( int i = 0; i < 3; ++i )
-      {
-        int32_t index;
-        if ( ! readValue( index, inFaces, isNativeLittleEndian ) )
-          break;
+    //3 indexes of 4 bytes per face, a partial face is an error, trailing bytes shorter than an index are ignored
+    const size_t faceBytes = 3 * sizeof( int32_t );
+    const size_t rawFacesCount = inFaces.size() / faceBytes;
+    if ( inFaces.size() % faceBytes >= sizeof( int32_t ) )
+      throw MDAL_Status::Err_UnknownFormat;
 
-        f.push_back( static_cast<size_t>( index - 1 ) );
-      }
+    //all mask integers used by the faces are read at once
+    const size_t maskedFacesCount = std::min( rawFacesCount, static_cast<size_t>( std::max( maskBitsCount, 0 ) ) );
+    std::vector<int32_t> maskInts( ( maskedFacesCount + 31 ) / 32 );
+    if ( readValues( maskInts.data(), maskInts.size(), inMsk, true ) != maskInts.size() )
+      throw MDAL_Status::Err_UnknownFormat;
 
-      if ( f.size() == 0 ) //that's mean this is the end of the file
-        break;
+    std::vector<int32_t> faceIndexes( 3 * rawFacesCount );
+    if ( rawFacesCount > 0 )
+      memcpy( faceIndexes.data(), inFaces.data(), rawFacesCount * faceBytes );
+    if ( isNativeLittleEndian )
+      changeEndianness( faceIndexes.data(), faceIndexes.size() );
 
-      if ( f.size() < 3 ) //that's mean the face is not complete
-        throw MDAL_Status::Err_UnknownFormat;
+    //indexes of unmasked faces are compacted to the beginning of faceIndexes
+    size_t facesCount = 0;
+    int32_t maskInt = 0;
+    for ( size_t c = 0; c < rawFacesCount; ++c )
+    {
+      //first bit in the mask array have to be used-->use next maskInt
+      if ( c % 32 == 0 && c < maskedFacesCount )
+        maskInt = maskInts[c / 32];
 
       //exclude masked face
       if ( !( maskInt & 0x01 ) )
       {
-        faces.push_back( f );
-        //fill raw indexes
-        for ( auto ri : f )
+        for ( size_t i = 0; i < 3; ++i )
         {
-          if ( ri >= totalIndexesCount )
+          const int64_t ri = static_cast<int64_t>( faceIndexes[3 * c + i] ) - 1;
+          if ( ri < 0 || static_cast<size_t>( ri ) >= totalIndexesCount )
             throw MDAL_Status::Err_UnknownFormat;
-          rawAndCorrectedIndexesMap[ri] = 1;
+          rawAndCorrectedIndexesMap[static_cast<size_t>( ri )] = 1;
+          faceIndexes[3 * facesCount + i] = static_cast<int32_t>( ri );
         }
+        facesCount++;
       }
 
-      c++;
       maskInt = maskInt >> 1;
     }
 
-    inFaces.close();
     inMsk.close();
     inMsx.close();
 
@@ -122,54 +125,72 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverEsriTin::load( const std::string &uri, M
     size_t correctedIndexCount = 0;
     for ( size_t i = 0; i < rawAndCorrectedIndexesMap.size(); ++i )
     {
-      if ( rawAndCorrectedIndexesMap.at( i ) < totalIndexesCount )
+      if ( rawAndCorrectedIndexesMap[i] < totalIndexesCount )
       {
         rawAndCorrectedIndexesMap[i] = correctedIndexCount;
         correctedIndexCount++;
       }
     }
 
-    //Round 3: populate vertices
-    Vertices vertices( correctedIndexCount );
-    std::ifstream inXY( xyFile( uri ), std::ifstream::in | std::ifstream::binary );
-    std::ifstream inZ( zFile( uri ), std::ifstream::in | std::ifstream::binary );
+    //Round 3: populate vertices, decoded in chunks of vertices by bulk byte swap
+    VertexArrays vertices;
+    vertices.resize( correctedIndexCount );
+    MappedFile inXY( xyFile( uri ) );
+    MappedFile inZ( zFile( uri ) );
 
-    if ( ! inXY.is_open() )
+    if ( ! inXY.isValid() )
       throw MDAL_Status::Err_FileNotFound;
 
-    if ( ! inZ.is_open() )
+    if ( ! inZ.isValid() )
       throw MDAL_Status::Err_FileNotFound;
 
-    size_t rawIndex = 0;
-    while ( rawIndex < rawAndCorrectedIndexesMap.size() )
-    {
-      Vertex vert;
-
-      if ( !readValue( vert.x, inXY, isNativeLittleEndian ) )
-        break;
-
-      if ( !readValue( vert.y, inXY, isNativeLittleEndian ) )
-        throw MDAL_Status::Err_UnknownFormat;
-
-      float zValue;
-      if ( !readValue( zValue, inZ, isNativeLittleEndian ) )
-        throw MDAL_Status::Err_UnknownFormat;
-      vert.z = double( zValue );
+    const size_t xyBytes = 2 * sizeof( double );
+    const size_t rawVerticesCount = std::min( totalIndexesCount, inXY.size() / xyBytes );
+    if ( rawVerticesCount < totalIndexesCount && inXY.size() % xyBytes >= sizeof( double ) )
+      throw MDAL_Status::Err_UnknownFormat; //x without y
+    if ( inZ.size() / sizeof( float ) < rawVerticesCount )
+      throw MDAL_Status::Err_UnknownFormat;
 
-      // store the vertex only if it is a wanted index
-      if ( rawAndCorrectedIndexesMap[rawIndex] < totalIndexesCount )
-        vertices[rawAndCorrectedIndexesMap[rawIndex]] = vert ;
+    const size_t chunkSize = 65536;
+    std::vector<double> xy( 2 * std::min( chunkSize, rawVerticesCount ) );
+    std::vector<float> z( std::min( chunkSize, rawVerticesCount ) );
+    for ( size_t chunkStart = 0; chunkStart < rawVerticesCount; chunkStart += chunkSize )
+    {
+      const size_t count = std::min( chunkSize, rawVerticesCount - chunkStart );
+      memcpy( xy.data(), inXY.data() + chunkStart * xyBytes, count * xyBytes );
+      memcpy( z.data(), inZ.data() + chunkStart * sizeof( float ), count * sizeof( float ) );
+      if ( isNativeLittleEndian )
+      {
+        changeEndianness( xy.data(), 2 * count );
+        changeEndianness( z.data(), count );
+      }
 
-      rawIndex++;
+      for ( size_t i = 0; i < count; ++i )
+      {
+        // store the vertex only if it is a wanted index
+        const size_t correctedIndex = rawAndCorrectedIndexesMap[chunkStart + i];
+        if ( correctedIndex < totalIndexesCount )
+        {
+          Vertex vert;
+          vert.x = xy[2 * i];
+          vert.y = xy[2 * i + 1];
+          vert.z = double( z[i] );
+          vertices.setVertex( correctedIndex, vert );
+        }
+      }
     }
 
-    inXY.close();
-    inZ.close();
-
     //Round 4 :apply correction to the face's indexes
-    for ( auto &face : faces )
-      for ( auto &fi : face )
-        fi = rawAndCorrectedIndexesMap[fi];
+    CompressedFaces faces;
+    faces.reserve( facesCount, 3 * facesCount );
+    for ( size_t f = 0; f < facesCount; ++f )
+    {
+      size_t face[3];
+      for ( size_t i = 0; i < 3; ++i )
+        face[i] = rawAndCorrectedIndexesMap[static_cast<size_t>( faceIndexes[3 * f + i] )];
+      faces.addFace( face, 3 );
+    }
+    faceIndexes = std::vector<int32_t>();
 
     //create the memory mesh
     std::unique_ptr< MemoryMesh > mesh(
@@ -274,7 +295,7 @@ std::string MDAL::DriverEsriTin::crsFile( const std::string &uri ) const
   return pathJoin( dirName( uri ), "prj.adf" );
 }
 
-void MDAL::DriverEsriTin::readSuperpoints( const std::string &uri, std::list<int> &superpointsIndexes ) const
+void MDAL::DriverEsriTin::readSuperpoints( const std::string &uri, std::vector<int> &superpointsIndexes ) const
 {
   superpointsIndexes.clear();
   bool isNativeLittleEndian = MDAL::isNativeLittleEndian();
@@ -284,7 +305,7 @@ void MDAL::DriverEsriTin::readSuperpoints( const std::string &uri, std::list<int
   while ( readValue( index, inHull, isNativeLittleEndian ) && index != -1 )
     superpointsIndexes.push_back( index );
 
-  superpointsIndexes.sort();
+  std::sort( superpointsIndexes.begin(), superpointsIndexes.end() );
 }
 
 std::string MDAL::DriverEsriTin::getTinName( const std::string &uri ) const
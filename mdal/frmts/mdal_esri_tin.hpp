@@ -8,7 +8,6 @@
 
 #include <string>
 #include <vector>
-#include <list>
 #include <memory>
 #include <iosfwd>
 #include <iostream>
@@ -86,8 +85,8 @@ namespace MDAL
       std::string denv9File( const std::string &uri ) const;
       std::string crsFile( const std::string &uri ) const;
 
-      //* can be used to read superpoints indexes, currently unused in MDAL
-      void readSuperpoints( const std::string &uri, std::list<int> &superpointsIndexes ) const;
+      //* can be used to read sorted superpoints indexes for binary search, currently unused in MDAL
+      void readSuperpoints( const std::string &uri, std::vector<int> &superpointsIndexes ) const;
 
 
       std::string getCrsWkt( const std::string &uri ) const;
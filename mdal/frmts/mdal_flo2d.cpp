@@ -6,37 +6,26 @@
 
 #include "mdal_flo2d.hpp"
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <limits>
 #include <iosfwd>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <cmath>
+#include <cctype>
 #include <cstring>
 #include <assert.h>
 
 #include "mdal_utils.hpp"
 #include "mdal_hdf5.hpp"
+#include "mdal_id_map.hpp"
+#include "mdal_mapped_file.hpp"
+#include "mdal_options.hpp"
 
 #define FLO2D_NAN 0.0
 
-struct VertexCompare
-{
-  bool operator()( const MDAL::Vertex &lhs, const MDAL::Vertex &rhs ) const
-  {
-    double resX = 0;
-    resX += lhs.x * 1000000;
-    resX += lhs.y * 1000;
-
-    double resY = 0;
-    resY += rhs.x * 1000000;
-    resY += rhs.y * 1000;
-
-    return resX < resY;
-  }
-};
-
 static std::string fileNameFromDir( const std::string &mainFileName, const std::string &name )
 {
   std::string dir = MDAL::dirName( mainFileName );
@@ -67,10 +56,257 @@ static double toFlo2DDouble( double val )
   }
 }
 
-static double getDouble( const std::string &val )
+//! Maximum number of tokens of TIMDEP.OUT line
+static const size_t MAX_TOKENS_TIMDEP = 6;
+
+//! Maximum number of tokens of the lines of other FLO-2D text files
+static const size_t MAX_TOKENS_FLO2D = 8;
+
+/**
+ * Calls parseLine( tokens, tokensCount ) for every line of the file
+ * The file is scanned in place, tokens point to the file content
+ */
+template<typename ParseLine>
+static void _parseLines( const std::string &fileName, ParseLine parseLine )
+{
+  MDAL::MappedFile file( fileName );
+  if ( !file.isValid() )
+    return;
+
+  const char *ptr = file.data();
+  const char *end = ptr + file.size();
+  MDAL::StringSpan tokens[MAX_TOKENS_FLO2D];
+  while ( ptr < end )
+  {
+    const MDAL::StringSpan line = MDAL::nextLine( ptr, end );
+    const size_t tokensCount = MDAL::split( line.begin, line.end, tokens, MAX_TOKENS_FLO2D );
+    parseLine( tokens, tokensCount );
+  }
+}
+
+MDAL::Flo2DHdf5Dataset::Flo2DHdf5Dataset( DatasetGroup *grp, const HdfDataset &valuesDs, const std::string &valuesPath, size_t timeIndex )
+  : Dataset2D( grp )
+  , mValuesPath( valuesPath )
+  , mTimeIndex( timeIndex )
+  , mValues( new HdfDataset( valuesDs ) )
+{
+}
+
+MDAL::Flo2DHdf5Dataset::~Flo2DHdf5Dataset() = default;
+
+void MDAL::Flo2DHdf5Dataset::closeFile()
+{
+  mValues.reset();
+}
+
+bool MDAL::Flo2DHdf5Dataset::readValues( size_t datasetCount, size_t indexStart, size_t count, double *buffer )
+{
+  if ( !mValues )
+  {
+    // opened again after closeFile(), the dataset keeps the file open
+    HdfFile file( group()->uri(), HdfFile::ReadOnly );
+    if ( !file.isValid() )
+      return false;
+    std::unique_ptr<HdfDataset> values( new HdfDataset( file.dataset( mValuesPath ) ) );
+    if ( !values->isValid() )
+      return false;
+    mValues = std::move( values );
+  }
+
+  std::vector<hsize_t> dims = mValues->dims();
+  if ( dims.size() < 2 || mTimeIndex + datasetCount > dims[0] || indexStart + count > dims[1] )
+    return false;
+
+  std::vector<hsize_t> offsets = {mTimeIndex, indexStart};
+  std::vector<hsize_t> counts = {datasetCount, count};
+  if ( !group()->isScalar() )
+  {
+    offsets.push_back( 0 );
+    counts.push_back( 2 );
+  }
+
+  std::vector<float> values = mValues->readArray( offsets, counts );
+  const size_t valuesCount = group()->isScalar() ? datasetCount * count : 2 * datasetCount * count;
+  if ( values.size() != valuesCount )
+    return false;
+
+  for ( size_t j = 0; j < valuesCount; ++j )
+    buffer[j] = getDouble( static_cast<double>( values[j] ) );
+  return true;
+}
+
+size_t MDAL::Flo2DHdf5Dataset::scalarData( size_t indexStart, size_t count, double *buffer )
 {
-  double valF = MDAL::toDouble( val );
-  return getDouble( valF );
+  assert( group()->isScalar() ); //checked in C API interface
+  if ( indexStart >= valuesCount() )
+    return 0;
+  count = std::min( count, valuesCount() - indexStart );
+  return readValues( 1, indexStart, count, buffer ) ? count : 0;
+}
+
+size_t MDAL::Flo2DHdf5Dataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  if ( indexStart >= valuesCount() )
+    return 0;
+  count = std::min( count, valuesCount() - indexStart );
+  return readValues( 1, indexStart, count, buffer ) ? count : 0;
+}
+
+size_t MDAL::Flo2DHdf5Dataset::dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer )
+{
+  // datasets of the group are consecutive rows of the same array
+  return readValues( datasetCount, indexStart, count, buffer ) ? count : 0;
+}
+
+const size_t MDAL::Flo2DTimdepIndex::LINES_PER_OFFSET;
+
+MDAL::Flo2DTimdepIndex::Flo2DTimdepIndex( const std::string &fileName, size_t facesCount, std::vector<double> elevations )
+  : mFileName( fileName )
+  , mFacesCount( facesCount )
+  , mElevations( std::move( elevations ) )
+{
+  std::ifstream inStream( fileName, std::ifstream::in | std::ifstream::binary );
+  if ( !inStream )
+    throw MDAL_Status::Err_FileNotFound;
+
+  // the file is read by blocks, only the times and the line offsets are stored
+  const size_t blockSize = 1 << 20;
+  std::vector<char> block( blockSize );
+  std::string line; // line spanning two blocks
+  unsigned long long blockOffset = 0;
+  unsigned long long lineOffset = 0;
+  MDAL::StringSpan tokens[MAX_TOKENS_TIMDEP];
+
+  const auto parseLine = [&]( const char *begin, const char *end )
+  {
+    const size_t tokensCount = MDAL::split( begin, end, tokens, MAX_TOKENS_TIMDEP );
+    if ( tokensCount == 1 )
+    {
+      mTimes.push_back( MDAL::toDouble( tokens[0].begin, tokens[0].end ) );
+      mLinesCount.push_back( 0 );
+      mOffsets.resize( mOffsets.size() + offsetsPerTime(), lineOffset );
+    }
+    else if ( ( tokensCount == 5 ) || ( tokensCount == 6 ) )
+    {
+      // new face for time
+      if ( mTimes.empty() ) throw MDAL_Status::Err_UnknownFormat;
+      size_t &linesCount = mLinesCount.back();
+      if ( linesCount == mFacesCount ) throw MDAL_Status::Err_IncompatibleMesh;
+      if ( linesCount % LINES_PER_OFFSET == 0 )
+        mOffsets[( mTimes.size() - 1 ) * offsetsPerTime() + linesCount / LINES_PER_OFFSET] = lineOffset;
+      ++linesCount;
+    }
+    else
+    {
+      throw MDAL_Status::Err_UnknownFormat;
+    }
+  };
+
+  while ( inStream )
+  {
+    inStream.read( block.data(), static_cast<std::streamsize>( blockSize ) );
+    const size_t readCount = static_cast<size_t>( inStream.gcount() );
+    const char *ptr = block.data();
+    const char *blockEnd = ptr + readCount;
+    while ( ptr < blockEnd )
+    {
+      const char *lineEnd = static_cast<const char *>( memchr( ptr, '\n', static_cast<size_t>( blockEnd - ptr ) ) );
+      if ( !lineEnd )
+      {
+        line.append( ptr, blockEnd );
+        break;
+      }
+
+      if ( line.empty() )
+      {
+        parseLine( ptr, lineEnd );
+      }
+      else
+      {
+        line.append( ptr, lineEnd );
+        parseLine( line.data(), line.data() + line.size() );
+        line.clear();
+      }
+      lineOffset = blockOffset + static_cast<unsigned long long>( lineEnd + 1 - block.data() );
+      ptr = lineEnd + 1;
+    }
+    blockOffset += readCount;
+  }
+
+  // last line without end of line
+  if ( !line.empty() )
+    parseLine( line.data(), line.data() + line.size() );
+}
+
+bool MDAL::Flo2DTimdepIndex::readValues( size_t timeIndex, size_t indexStart, size_t count,
+    const Column *columns, size_t columnsCount, bool waterLevel, double *buffer ) const
+{
+  if ( timeIndex >= mTimes.size() || indexStart + count > mFacesCount )
+    return false;
+
+  std::fill( buffer, buffer + count * columnsCount, std::numeric_limits<double>::quiet_NaN() );
+  const size_t linesCount = mLinesCount[timeIndex];
+  if ( indexStart >= linesCount )
+    return true;
+
+  std::ifstream inStream( mFileName, std::ifstream::in | std::ifstream::binary );
+  const unsigned long long offset = mOffsets[timeIndex * offsetsPerTime() + indexStart / LINES_PER_OFFSET];
+  inStream.seekg( static_cast<std::streamoff>( offset ) );
+
+  std::string line;
+  for ( size_t i = indexStart - indexStart % LINES_PER_OFFSET; i < indexStart; ++i )
+    std::getline( inStream, line );
+
+  MDAL::StringSpan tokens[MAX_TOKENS_TIMDEP];
+  const size_t readCount = std::min( count, linesCount - indexStart );
+  for ( size_t i = 0; i < readCount; ++i )
+  {
+    if ( !std::getline( inStream, line ) )
+      return false;
+
+    const size_t tokensCount = MDAL::split( line.data(), line.data() + line.size(), tokens, MAX_TOKENS_TIMDEP );
+    if ( tokensCount != 5 && tokensCount != 6 )
+      return false;
+
+    for ( size_t c = 0; c < columnsCount; ++c )
+    {
+      double value = getDouble( MDAL::toDouble( tokens[columns[c]].begin, tokens[columns[c]].end ) );
+      if ( waterLevel && !std::isnan( value ) )
+        value += mElevations[indexStart + i];
+      buffer[i * columnsCount + c] = value;
+    }
+  }
+  return true;
+}
+
+MDAL::Flo2DTimdepDataset::Flo2DTimdepDataset( DatasetGroup *grp, std::shared_ptr<const Flo2DTimdepIndex> index, size_t timeIndex, Type type )
+  : Dataset2D( grp )
+  , mIndex( std::move( index ) )
+  , mTimeIndex( timeIndex )
+  , mType( type )
+{
+}
+
+size_t MDAL::Flo2DTimdepDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  if ( indexStart >= valuesCount() )
+    return 0;
+  count = std::min( count, valuesCount() - indexStart );
+  const Flo2DTimdepIndex::Column column = Flo2DTimdepIndex::Depth;
+  return mIndex->readValues( mTimeIndex, indexStart, count, &column, 1, mType == WaterLevel, buffer ) ? count : 0;
+}
+
+size_t MDAL::Flo2DTimdepDataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  if ( indexStart >= valuesCount() )
+    return 0;
+  count = std::min( count, valuesCount() - indexStart );
+  // this is magnitude: column 2
+  const Flo2DTimdepIndex::Column columns[] = { Flo2DTimdepIndex::VelocityX, Flo2DTimdepIndex::VelocityY };
+  return mIndex->readValues( mTimeIndex, indexStart, count, columns, 2, false, buffer ) ? count : 0;
 }
 
 void MDAL::DriverFlo2D::addStaticDataset(
@@ -90,11 +326,10 @@ void MDAL::DriverFlo2D::addStaticDataset(
   std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group.get() );
   assert( vals.size() == dataset->valuesCount() );
   dataset->setTime( MDAL::RelativeTimestamp() );
-  double *values = dataset->values();
-  memcpy( values, vals.data(), vals.size() * sizeof( double ) );
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+  dataset->setValues( vals.data() );
+  MDAL::updateStatistics( dataset );
   group->datasets.push_back( dataset );
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+  MDAL::updateStatistics( group );
   mMesh->datasetGroups.push_back( group );
 }
 
@@ -106,24 +341,20 @@ void MDAL::DriverFlo2D::parseCADPTSFile( const std::string &datFileName, std::ve
     throw MDAL_Status::Err_FileNotFound;
   }
 
-  std::ifstream cadptsStream( cadptsFile, std::ifstream::in );
-  std::string line;
   // CADPTS.DAT - COORDINATES OF CELL CENTERS (ELEM NUM, X, Y)
-  while ( std::getline( cadptsStream, line ) )
+  _parseLines( cadptsFile, [&cells]( const MDAL::StringSpan * tokens, size_t tokensCount )
   {
-    line = MDAL::rtrim( line );
-    std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-    if ( lineParts.size() != 3 )
+    if ( tokensCount != 3 )
     {
       throw MDAL_Status::Err_UnknownFormat;
     }
     CellCenter cc;
-    cc.id = MDAL::toSizeT( lineParts[1] ) - 1; //numbered from 1
-    cc.x = MDAL::toDouble( lineParts[1] );
-    cc.y = MDAL::toDouble( lineParts[2] );
+    cc.id = MDAL::toSizeT( tokens[1].begin, tokens[1].end ) - 1; //numbered from 1
+    cc.x = MDAL::toDouble( tokens[1].begin, tokens[1].end );
+    cc.y = MDAL::toDouble( tokens[2].begin, tokens[2].end );
     cc.conn.resize( 4 );
     cells.push_back( cc );
-  }
+  } );
 }
 
 void MDAL::DriverFlo2D::parseFPLAINFile( std::vector<double> &elevations,
@@ -138,33 +369,19 @@ void MDAL::DriverFlo2D::parseFPLAINFile( std::vector<double> &elevations,
     throw MDAL_Status::Err_FileNotFound;
   }
 
-  std::ifstream fplainStream( fplainFile, std::ifstream::in );
-  std::string line;
-
-  while ( std::getline( fplainStream, line ) )
+  _parseLines( fplainFile, [&elevations, &cells]( const MDAL::StringSpan * tokens, size_t tokensCount )
   {
-    line = MDAL::rtrim( line );
-    std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-    if ( lineParts.size() != 7 )
+    if ( tokensCount != 7 )
     {
       throw MDAL_Status::Err_UnknownFormat;
     }
-    size_t cc_i = MDAL::toSizeT( lineParts[0] ) - 1; //numbered from 1
+    size_t cc_i = MDAL::toSizeT( tokens[0].begin, tokens[0].end ) - 1; //numbered from 1
     for ( size_t j = 0; j < 4; ++j )
     {
-      cells[cc_i].conn[j] = MDAL::toInt( lineParts[j + 1] ) - 1; //numbered from 1, 0 boundary Vertex
+      cells[cc_i].conn[j] = MDAL::toInt( tokens[j + 1].begin, tokens[j + 1].end ) - 1; //numbered from 1, 0 boundary Vertex
     }
-    elevations.push_back( MDAL::toDouble( lineParts[6] ) );
-  }
-}
-
-static void addDatasetToGroup( std::shared_ptr<MDAL::DatasetGroup> group, std::shared_ptr<MDAL::MemoryDataset2D> dataset )
-{
-  if ( group && dataset && dataset->valuesCount() > 0 )
-  {
-    dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
-    group->datasets.push_back( dataset );
-  }
+    elevations.push_back( MDAL::toDouble( tokens[6].begin, tokens[6].end ) );
+  } );
 }
 
 void MDAL::DriverFlo2D::parseTIMDEPFile( const std::string &datFileName, const std::vector<double> &elevations )
@@ -181,14 +398,8 @@ void MDAL::DriverFlo2D::parseTIMDEPFile( const std::string &datFileName, const s
     return;
   }
 
-  std::ifstream inStream( inFile, std::ifstream::in );
-  std::string line;
-
-  size_t nVertexs = mMesh->verticesCount();
-  size_t ntimes = 0;
-
-  RelativeTimestamp time = RelativeTimestamp();
-  size_t face_idx = 0;
+  // the file may be huge, only the offsets of the time steps are read now, the values on demand
+  std::shared_ptr<const Flo2DTimdepIndex> index = std::make_shared<Flo2DTimdepIndex>( inFile, mMesh->facesCount(), elevations );
 
   std::shared_ptr<DatasetGroup> depthDsGroup = std::make_shared< DatasetGroup >(
         name(),
@@ -218,64 +429,27 @@ void MDAL::DriverFlo2D::parseTIMDEPFile( const std::string &datFileName, const s
   flowDsGroup->setDataLocation( MDAL_DataLocation::DataOnFaces2D );
   flowDsGroup->setIsScalar( false );
 
-  std::shared_ptr<MDAL::MemoryDataset2D> flowDataset;
-  std::shared_ptr<MDAL::MemoryDataset2D> depthDataset;
-  std::shared_ptr<MDAL::MemoryDataset2D> waterLevelDataset;
-
-  while ( std::getline( inStream, line ) )
+  for ( size_t ts = 0; ts < index->timesCount(); ++ts )
   {
-    line = MDAL::rtrim( line );
-    std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-    if ( lineParts.size() == 1 )
+    const RelativeTimestamp time( index->time( ts ), RelativeTimestamp::hours );
+    const std::pair<DatasetGroup *, Flo2DTimdepDataset::Type> datasets[] =
     {
-      time = RelativeTimestamp( MDAL::toDouble( line ), RelativeTimestamp::hours );
-      ntimes++;
-
-      if ( depthDataset ) addDatasetToGroup( depthDsGroup, depthDataset );
-      if ( flowDataset ) addDatasetToGroup( flowDsGroup, flowDataset );
-      if ( waterLevelDataset ) addDatasetToGroup( waterLevelDsGroup, waterLevelDataset );
-
-      depthDataset  = std::make_shared< MemoryDataset2D >( depthDsGroup.get() );
-      flowDataset = std::make_shared< MemoryDataset2D >( flowDsGroup.get() );
-      waterLevelDataset = std::make_shared< MemoryDataset2D >( waterLevelDsGroup.get() );
-
-      depthDataset->setTime( time );
-      flowDataset->setTime( time );
-      waterLevelDataset->setTime( time );
-
-      face_idx = 0;
-
-    }
-    else if ( ( lineParts.size() == 5 ) || ( lineParts.size() == 6 ) )
+      { depthDsGroup.get(), Flo2DTimdepDataset::Depth },
+      { flowDsGroup.get(), Flo2DTimdepDataset::Velocity },
+      { waterLevelDsGroup.get(), Flo2DTimdepDataset::WaterLevel },
+    };
+    for ( const auto &ds : datasets )
     {
-      // new Vertex for time
-      if ( !depthDataset || !flowDataset || !waterLevelDataset ) throw MDAL_Status::Err_UnknownFormat;
-      if ( face_idx == nVertexs ) throw MDAL_Status::Err_IncompatibleMesh;
-
-      // this is magnitude: getDouble(lineParts[2]);
-      flowDataset->setVectorValue( face_idx, getDouble( lineParts[3] ),  getDouble( lineParts[4] ) );
-
-      double depth = getDouble( lineParts[1] );
-      depthDataset->setScalarValue( face_idx, depth );
-
-      if ( !std::isnan( depth ) ) depth += elevations[face_idx];
-      waterLevelDataset->setScalarValue( face_idx, depth );
-
-      face_idx ++;
-    }
-    else
-    {
-      throw MDAL_Status::Err_UnknownFormat;
+      std::shared_ptr<Flo2DTimdepDataset> dataset = std::make_shared<Flo2DTimdepDataset>( ds.first, index, ts, ds.second );
+      dataset->setTime( time );
+      MDAL::updateStatistics( dataset );
+      ds.first->datasets.push_back( dataset );
     }
   }
 
-  if ( depthDataset ) addDatasetToGroup( depthDsGroup, depthDataset );
-  if ( flowDataset ) addDatasetToGroup( flowDsGroup, flowDataset );
-  if ( waterLevelDataset ) addDatasetToGroup( waterLevelDsGroup, waterLevelDataset );
-
-  depthDsGroup->setStatistics( MDAL::calculateStatistics( depthDsGroup ) );
-  flowDsGroup->setStatistics( MDAL::calculateStatistics( flowDsGroup ) );
-  waterLevelDsGroup->setStatistics( MDAL::calculateStatistics( waterLevelDsGroup ) );
+  MDAL::updateStatistics( depthDsGroup );
+  MDAL::updateStatistics( flowDsGroup );
+  MDAL::updateStatistics( waterLevelDsGroup );
 
   mMesh->datasetGroups.push_back( depthDsGroup );
   mMesh->datasetGroups.push_back( flowDsGroup );
@@ -292,9 +466,6 @@ void MDAL::DriverFlo2D::parseDEPTHFile( const std::string &datFileName, const st
     return; //optional file
   }
 
-  std::ifstream depthStream( depthFile, std::ifstream::in );
-  std::string line;
-
   size_t nFaces = mMesh->facesCount();
   std::vector<double> maxDepth( nFaces );
   std::vector<double> maxWaterLevel( nFaces );
@@ -302,18 +473,16 @@ void MDAL::DriverFlo2D::parseDEPTHFile( const std::string &datFileName, const st
   size_t vertex_idx = 0;
 
   // DEPTH.OUT - COORDINATES (ELEM NUM, X, Y, MAX DEPTH)
-  while ( std::getline( depthStream, line ) )
+  _parseLines( depthFile, [&]( const MDAL::StringSpan * tokens, size_t tokensCount )
   {
-    line = MDAL::rtrim( line );
     if ( vertex_idx == nFaces ) throw MDAL_Status::Err_IncompatibleMesh;
 
-    std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-    if ( lineParts.size() != 4 )
+    if ( tokensCount != 4 )
     {
       throw MDAL_Status::Err_UnknownFormat;
     }
 
-    double val = getDouble( lineParts[3] );
+    double val = getDouble( MDAL::toDouble( tokens[3].begin, tokens[3].end ) );
     maxDepth[vertex_idx] = val;
 
     //water level
@@ -322,7 +491,7 @@ void MDAL::DriverFlo2D::parseDEPTHFile( const std::string &datFileName, const st
 
 
     vertex_idx++;
-  }
+  } );
 
   addStaticDataset( maxDepth, "Depth/Maximums", datFileName );
   addStaticDataset( maxWaterLevel, "Water Level/Maximums", datFileName );
@@ -342,28 +511,23 @@ void MDAL::DriverFlo2D::parseVELFPVELOCFile( const std::string &datFileName )
       return; //optional file
     }
 
-    std::ifstream velocityStream( velocityFile, std::ifstream::in );
-    std::string line;
-
     size_t vertex_idx = 0;
 
     // VELFP.OUT - COORDINATES (ELEM NUM, X, Y, MAX VEL) - Maximum floodplain flow velocity;
-    while ( std::getline( velocityStream, line ) )
+    _parseLines( velocityFile, [&]( const MDAL::StringSpan * tokens, size_t tokensCount )
     {
       if ( vertex_idx == nFaces ) throw MDAL_Status::Err_IncompatibleMesh;
 
-      line = MDAL::rtrim( line );
-      std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-      if ( lineParts.size() != 4 )
+      if ( tokensCount != 4 )
       {
         throw MDAL_Status::Err_UnknownFormat;
       }
 
-      double val = getDouble( lineParts[3] );
+      double val = getDouble( MDAL::toDouble( tokens[3].begin, tokens[3].end ) );
       maxVel[vertex_idx] = val;
 
       vertex_idx++;
-    }
+    } );
   }
 
   {
@@ -373,31 +537,26 @@ void MDAL::DriverFlo2D::parseVELFPVELOCFile( const std::string &datFileName )
       return; //optional file
     }
 
-    std::ifstream velocityStream( velocityFile, std::ifstream::in );
-    std::string line;
-
     size_t vertex_idx = 0;
 
     // VELOC.OUT - COORDINATES (ELEM NUM, X, Y, MAX VEL)  - Maximum channel flow velocity
-    while ( std::getline( velocityStream, line ) )
+    _parseLines( velocityFile, [&]( const MDAL::StringSpan * tokens, size_t tokensCount )
     {
       if ( vertex_idx == nFaces ) throw MDAL_Status::Err_IncompatibleMesh;
 
-      line = MDAL::rtrim( line );
-      std::vector<std::string> lineParts = MDAL::split( line, ' ' );
-      if ( lineParts.size() != 4 )
+      if ( tokensCount != 4 )
       {
         throw MDAL_Status::Err_UnknownFormat;
       }
 
-      double val = getDouble( lineParts[3] );
+      double val = getDouble( MDAL::toDouble( tokens[3].begin, tokens[3].end ) );
       if ( !std::isnan( val ) )  // overwrite value from VELFP if it is not 0
       {
         maxVel[vertex_idx] = val;
       }
 
       vertex_idx++;
-    }
+    } );
   }
 
   addStaticDataset( maxVel, "Velocity/Maximums", datFileName );
@@ -464,34 +623,50 @@ void MDAL::DriverFlo2D::createMesh( const std::vector<CellCenter> &cells, double
 {
   // Create all Faces from cell centers.
   // Vertexs must be also created, they are not stored in FLO-2D files
-  // try to reuse Vertexs already created for other Faces by usage of unique_Vertexs set.
-  Faces faces;
-  Vertices vertices;
-  std::map<Vertex, size_t, VertexCompare> unique_vertices; //vertex -> id
-  size_t vertex_idx = 0;
+  // try to reuse Vertexs already created for other Faces.
+  // The cells lie on a regular grid, so the corners are identified by their
+  // integer column and row in the grid of the corners
+  double minX = std::numeric_limits<double>::max();
+  double minY = std::numeric_limits<double>::max();
+  double maxX = -std::numeric_limits<double>::max();
+  for ( const CellCenter &cell : cells )
+  {
+    minX = std::min( minX, cell.x );
+    minY = std::min( minY, cell.y );
+    maxX = std::max( maxX, cell.x );
+  }
+  const double cellSize = half_cell_size > 0 ? 2 * half_cell_size : 1;
+  const double originX = minX - half_cell_size;
+  const double originY = minY - half_cell_size;
+  const size_t columns = cells.empty() ? 0 : static_cast<size_t>( std::llround( ( maxX - minX ) / cellSize ) ) + 2;
+
+  CompressedFaces faces;
+  VertexArrays vertices;
+  faces.reserve( cells.size(), 4 * cells.size() );
+  vertices.reserve( cells.size() + 2 * static_cast<size_t>( std::sqrt( static_cast<double>( cells.size() ) ) ) + 1 );
+  IdToIndexMap unique_vertices; // corner grid key -> vertex index
+  size_t face[4];
 
   for ( size_t i = 0; i < cells.size(); ++i )
   {
-    Face e( 4 );
-
     for ( size_t position = 0; position < 4; ++position )
     {
       Vertex n = createVertex( position, half_cell_size, cells[i] );
-      const auto iter = unique_vertices.find( n );
-      if ( iter == unique_vertices.end() )
+      const size_t column = static_cast<size_t>( std::llround( ( n.x - originX ) / cellSize ) );
+      const size_t row = static_cast<size_t>( std::llround( ( n.y - originY ) / cellSize ) );
+      const size_t key = row * columns + column;
+      if ( unique_vertices.insert( key, vertices.size() ) )
       {
-        unique_vertices[n] = vertex_idx;
+        face[position] = vertices.size();
         vertices.push_back( n );
-        e[position] = vertex_idx;
-        ++vertex_idx;
       }
       else
       {
-        e[position] = iter->second;
+        face[position] = unique_vertices.find( key );
       }
     }
 
-    faces.push_back( e );
+    faces.addFace( face, 4 );
   }
 
   mMesh.reset(
@@ -504,15 +679,14 @@ void MDAL::DriverFlo2D::createMesh( const std::vector<CellCenter> &cells, double
       mDatFileName
     )
   );
-  mMesh->faces = faces;
-  mMesh->vertices = vertices;
+  mMesh->faces = std::move( faces );
+  mMesh->vertices = std::move( vertices );
 }
 
 bool MDAL::DriverFlo2D::parseHDF5Datasets( MemoryMesh *mesh, const std::string &timedepFileName )
 {
   //return true on error
 
-  size_t nFaces =  mesh->facesCount();
   if ( !fileExists( timedepFileName ) ) return true;
 
   HdfFile file( timedepFileName, HdfFile::ReadOnly );
@@ -556,9 +730,9 @@ bool MDAL::DriverFlo2D::parseHDF5Datasets( MemoryMesh *mesh, const std::string &
     if ( isVector ) expectedSize *= 2;
     if ( valuesDs.elementCount() != expectedSize ) return true;
 
-    // Read data
+    // Read times only, the values are read on demand
     std::vector<double> times = timesDs.readArrayDouble();
-    std::vector<float> values = valuesDs.readArray();
+    const RelativeTimestamp::Unit timeUnit = parseDurationTimeUnit( timeUnitString );
 
     // Create dataset now
     std::shared_ptr<DatasetGroup> ds = std::make_shared< DatasetGroup >(
@@ -572,35 +746,14 @@ bool MDAL::DriverFlo2D::parseHDF5Datasets( MemoryMesh *mesh, const std::string &
 
     for ( size_t ts = 0; ts < timesteps; ++ts )
     {
-      std::shared_ptr< MemoryDataset2D > output = std::make_shared< MemoryDataset2D >( ds.get() );
-      output->setTime( times[ts], parseDurationTimeUnit( timeUnitString ) );
-
-      if ( isVector )
-      {
-        // vector
-        for ( size_t i = 0; i < nFaces; ++i )
-        {
-          size_t idx = 2 * ( ts * nFaces + i );
-          double x = getDouble( static_cast<double>( values[idx] ) );
-          double y = getDouble( static_cast<double>( values[idx + 1] ) );
-          output->setVectorValue( i, x, y );
-        }
-      }
-      else
-      {
-        // scalar
-        for ( size_t i = 0; i < nFaces; ++i )
-        {
-          size_t idx = ts * nFaces + i;
-          double val = getDouble( static_cast<double>( values[idx] ) );
-          output->setScalarValue( i, val );
-        }
-      }
-      addDatasetToGroup( ds, output );
+      std::shared_ptr< Flo2DHdf5Dataset > output = std::make_shared< Flo2DHdf5Dataset >( ds.get(), valuesDs, grp.childPath( "Values" ), ts );
+      output->setTime( times[ts], timeUnit );
+      MDAL::updateStatistics( output );
+      ds->datasets.push_back( output );
     }
 
     // TODO use mins & maxs arrays
-    ds->setStatistics( MDAL::calculateStatistics( ds ) );
+    MDAL::updateStatistics( ds );
     mesh->datasetGroups.push_back( ds );
 
   }
@@ -730,123 +883,98 @@ std::unique_ptr< MDAL::Mesh > MDAL::DriverFlo2D::load( const std::string &result
 }
 
 
-bool MDAL::DriverFlo2D::addToHDF5File( DatasetGroup *group )
+//! Closes the files of the time steps read from the file, so it can be opened for writing
+static void closeReadingDatasets( MDAL::Mesh *mesh, const std::string &uri )
 {
-  assert( MDAL::fileExists( group->uri() ) );
-  HdfFile file( group->uri(), HdfFile::ReadWrite );
-  if ( !file.isValid() ) return true;
-
-  HdfGroup timedataGroup = file.group( "TIMDEP NETCDF OUTPUT RESULTS" );
-  if ( !timedataGroup.isValid() ) return true;
-  return appendGroup( file, group, timedataGroup );
+  for ( const std::shared_ptr<MDAL::DatasetGroup> &meshGroup : mesh->datasetGroups )
+  {
+    if ( meshGroup->uri() != uri )
+      continue;
+    for ( const std::shared_ptr<MDAL::Dataset> &dataset : meshGroup->datasets )
+    {
+      MDAL::Flo2DHdf5Dataset *hdf5Dataset = dynamic_cast<MDAL::Flo2DHdf5Dataset *>( dataset.get() );
+      if ( hdf5Dataset )
+        hdf5Dataset->closeFile();
+    }
+  }
 }
 
-
-bool MDAL::DriverFlo2D::saveNewHDF5File( DatasetGroup *dsGroup )
+MDAL::Flo2DHdf5Writer::Flo2DHdf5Writer( DatasetGroup *group )
+  : mGroup( group )
 {
-  // Create file
-  HdfFile file( dsGroup->uri(), HdfFile::Create );
-  // Unable to create
-  if ( !file.isValid() ) return true;
-
-  // Create float dataset File Version
-  HdfDataset dsFileVersion( file.id(), "/File Version", H5T_NATIVE_FLOAT );
-  dsFileVersion.write( 1.0f );
-
-  // Create string dataset File Type
-  HdfDataset dsFileType( file.id(), "/File Type", HdfDataType::createString() );
-  dsFileType.write( "Xmdf" );
+  assert( group->dataLocation() == MDAL_DataLocation::DataOnFaces2D );
 
-  // Create group TIMDEP NETCDF OUTPUT RESULTS
-  HdfGroup groupTNOR = HdfGroup::create( file.id(), "/TIMDEP NETCDF OUTPUT RESULTS" );
-
-  // Create attribute
-  HdfAttribute attTNORGrouptype( groupTNOR.id(), "Grouptype", HdfDataType::createString() );
-  // Write string value to attribute
-  attTNORGrouptype.write( "Generic" );
+  if ( MDAL::fileExists( group->uri() ) )
+  {
+    // Add dataset to a existing file
+    // the file cannot be opened for writing while the datasets read from it keep it open
+    closeReadingDatasets( group->mesh(), group->uri() );
 
-  return appendGroup( file, dsGroup, groupTNOR );
-}
+    mFile.reset( new HdfFile( group->uri(), HdfFile::ReadWrite ) );
+    if ( !mFile->isValid() ) throw MDAL_Status::Err_FailToWriteToDisk;
 
-bool MDAL::DriverFlo2D::appendGroup( HdfFile &file, MDAL::DatasetGroup *dsGroup, HdfGroup &groupTNOR )
-{
-  assert( dsGroup->dataLocation() == MDAL_DataLocation::DataOnFaces2D );
-
-  HdfDataType dtMaxString = HdfDataType::createString();
-  std::string dsGroupName = dsGroup->name();
-  const size_t timesCount = dsGroup->datasets.size();
-  const size_t facesCount = dsGroup->mesh()->facesCount();
-  size_t valCount = facesCount;
-  HdfDataspace dscValues;
-  if ( dsGroup->isScalar() )
-  {
-    std::vector<hsize_t> dimsForScalarValues = { timesCount, facesCount };
-    dscValues = HdfDataspace( dimsForScalarValues );
+    HdfGroup groupTNOR = mFile->group( "TIMDEP NETCDF OUTPUT RESULTS" );
+    if ( !groupTNOR.isValid() ) throw MDAL_Status::Err_FailToWriteToDisk;
+    createGroup( groupTNOR );
   }
   else
   {
-    valCount *= 2;
-    std::vector<hsize_t> dimsForVectorValues = { timesCount, facesCount, 2 };
-    dscValues =  HdfDataspace( dimsForVectorValues );
-  }
+    // Create new HDF5 file with Flow2D structure
+    mFile.reset( new HdfFile( group->uri(), HdfFile::Create ) );
+    // Unable to create
+    if ( !mFile->isValid() ) throw MDAL_Status::Err_FailToWriteToDisk;
 
-  std::vector<hsize_t> timesCountVec = {timesCount};
-  HdfDataspace dscTimes( timesCountVec );
+    // Create float dataset File Version
+    HdfDataset dsFileVersion( mFile->id(), "/File Version", H5T_NATIVE_FLOAT );
+    dsFileVersion.write( 1.0f );
 
-  std::vector<float> maximums( timesCount );
-  std::vector<float> minimums( timesCount );
-  std::vector<double> times( timesCount );
-  std::vector<float> values( timesCount * valCount );
+    // Create string dataset File Type
+    HdfDataset dsFileType( mFile->id(), "/File Type", HdfDataType::createString() );
+    dsFileType.write( "Xmdf" );
 
-  // prepare data
-  for ( size_t i = 0; i < dsGroup->datasets.size(); i++ )
-  {
-    const std::shared_ptr<Dataset> &dataset = dsGroup->datasets.at( i );
-    std::vector<double> singleRowValues( valCount );
+    // Create group TIMDEP NETCDF OUTPUT RESULTS
+    HdfGroup groupTNOR = HdfGroup::create( mFile->id(), "/TIMDEP NETCDF OUTPUT RESULTS" );
 
-    if ( dsGroup->isScalar() )
-    {
-      dataset->scalarData( 0, facesCount, singleRowValues.data() );
-    }
-    else
-    {
-      dataset->vectorData( 0, facesCount, singleRowValues.data() );
-    }
+    // Create attribute
+    HdfAttribute attTNORGrouptype( groupTNOR.id(), "Grouptype", HdfDataType::createString() );
+    // Write string value to attribute
+    attTNORGrouptype.write( "Generic" );
 
-    for ( size_t j = 0; j < valCount; j++ )
-    {
-      double doubleValue = toFlo2DDouble( singleRowValues[j] );
-      values[i * valCount + j] = static_cast<float>( doubleValue );
-    }
-
-    const Statistics st = dataset->statistics();
-    maximums[i] = static_cast<float>( st.maximum );
-    minimums[i] = static_cast<float>( st.minimum );
-    times.push_back( dataset->time( RelativeTimestamp::hours ) );
+    createGroup( groupTNOR );
   }
+}
+
+MDAL::Flo2DHdf5Writer::~Flo2DHdf5Writer() = default;
+
+void MDAL::Flo2DHdf5Writer::createGroup( HdfGroup &groupTNOR )
+{
+  HdfDataType dtMaxString = HdfDataType::createString();
+  std::string dsGroupName = mGroup->name();
+  const hsize_t facesCount = mGroup->mesh()->facesCount();
+
+  std::vector<hsize_t> rowDims = { facesCount };
+  if ( !mGroup->isScalar() )
+    rowDims.push_back( 2 );
 
-  // store data
   int i = 0;
-  while ( file.pathExists( "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName ) )
+  while ( mFile->pathExists( "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName ) )
   {
-    dsGroupName = dsGroup->name() + "_" + std::to_string( i ); // make sure we have unique group name
+    dsGroupName = mGroup->name() + "_" + std::to_string( i++ ); // make sure we have unique group name
   }
-  HdfGroup group = HdfGroup::create( groupTNOR.id(), "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName );
+  const std::string groupPath = "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName;
+  HdfGroup group = HdfGroup::create( groupTNOR.id(), groupPath );
+
+  const std::string deflateLevelOption = MDAL::openOption( MDAL::OPTION_HDF5_DEFLATE_LEVEL );
+  const int deflateLevel = deflateLevelOption.empty() ? 0 : std::max( 0, std::min( MDAL::toInt( deflateLevelOption ), 9 ) );
 
   HdfAttribute attDataType( group.id(), "Data Type", H5T_NATIVE_INT );
   attDataType.write( 0 );
 
   HdfAttribute attDatasetCompression( group.id(), "DatasetCompression", H5T_NATIVE_INT );
-  attDatasetCompression.write( -1 );
-
-  /*
-  HdfDataspace dscDatasetUnits( dimsSingle );
-  HdfAttribute attDatasetUnits( group.id(), "DatasetUnits", true );
-  attDatasetUnits.writeString( dscDatasetUnits.id(), "unknown" );
-  */
+  attDatasetCompression.write( deflateLevel > 0 ? deflateLevel : -1 );
 
   HdfAttribute attGrouptype( group.id(), "Grouptype", dtMaxString );
-  if ( dsGroup->isScalar() )
+  if ( mGroup->isScalar() )
     attGrouptype.write( "DATASET SCALAR" );
   else
     attGrouptype.write( "DATASET VECTOR" );
@@ -854,19 +982,73 @@ bool MDAL::DriverFlo2D::appendGroup( HdfFile &file, MDAL::DatasetGroup *dsGroup,
   HdfAttribute attTimeUnits( group.id(), "TimeUnits", dtMaxString );
   attTimeUnits.write( "Hours" );
 
-  HdfDataset dsMaxs( file.id(), "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName + "/Maxs", H5T_NATIVE_FLOAT, timesCountVec );
-  dsMaxs.write( maximums );
+  // empty arrays extended by each time step
+  mMaxs.reset( new HdfDataset( mFile->id(), groupPath + "/Maxs", H5T_NATIVE_FLOAT, {}, 0 ) );
+  mMins.reset( new HdfDataset( mFile->id(), groupPath + "/Mins", H5T_NATIVE_FLOAT, {}, 0 ) );
+  mTimes.reset( new HdfDataset( mFile->id(), groupPath + "/Times", H5T_NATIVE_DOUBLE, {}, 0 ) );
+  mValuesPath = groupPath + "/Values";
+  mValues.reset( new HdfDataset( mFile->id(), mValuesPath, H5T_NATIVE_FLOAT, rowDims, deflateLevel ) );
 
-  HdfDataset dsMins( file.id(), "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName + "/Mins", H5T_NATIVE_FLOAT, timesCountVec );
-  dsMins.write( minimums );
+  if ( !mMaxs->isValid() || !mMins->isValid() || !mTimes->isValid() || !mValues->isValid() )
+    throw MDAL_Status::Err_FailToWriteToDisk;
+}
 
-  HdfDataset dsTimes( file.id(), "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName + "/Times", H5T_NATIVE_DOUBLE, timesCountVec );
-  dsTimes.write( times );
+std::shared_ptr<MDAL::Dataset> MDAL::Flo2DHdf5Writer::writeTimestep( RelativeTimestamp time, const double *values )
+{
+  const size_t facesCount = mGroup->mesh()->facesCount();
+  const size_t valCount = mGroup->isScalar() ? facesCount : 2 * facesCount;
+
+  mRow.resize( valCount );
+  for ( size_t j = 0; j < valCount; j++ )
+    mRow[j] = static_cast<float>( toFlo2DDouble( values[j] ) );
+
+  const Statistics st = MDAL::calculateStatistics( values, facesCount, !mGroup->isScalar() );
+  const float maximum = static_cast<float>( st.maximum );
+  const float minimum = static_cast<float>( st.minimum );
+  const double hours = time.value( RelativeTimestamp::hours );
+
+  mValues->appendRow( mRow.data() );
+  mMaxs->appendRow( &maximum );
+  mMins->appendRow( &minimum );
+  mTimes->appendRow( &hours );
+
+  std::shared_ptr<Flo2DHdf5Dataset> dataset = std::make_shared<Flo2DHdf5Dataset>( mGroup, *mValues, mValuesPath, mTimestepCount );
+  dataset->setTime( time );
+  dataset->setStatistics( st );
+  ++mTimestepCount;
+  return dataset;
+}
+
+bool MDAL::Flo2DHdf5Writer::finish()
+{
+  return H5Fflush( mFile->id(), H5F_SCOPE_LOCAL ) < 0;
+}
+
+MDAL::Flo2DHdf5Writer *MDAL::DriverFlo2D::writer( DatasetGroup *group ) const
+{
+  if ( !group->writer() )
+    group->setWriter( std::unique_ptr<DatasetGroupWriter>( new Flo2DHdf5Writer( group ) ) );
+  return static_cast<Flo2DHdf5Writer *>( group->writer() );
+}
 
-  HdfDataset dsValues( file.id(), "/TIMDEP NETCDF OUTPUT RESULTS/" + dsGroupName + "/Values", H5T_NATIVE_FLOAT, dscValues );
-  dsValues.write( values );
+void MDAL::DriverFlo2D::createDataset( DatasetGroup *group, RelativeTimestamp time, const double *values, const int *active )
+{
+  MDAL_UNUSED( active );
+  if ( !group || ( group->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
+  {
+    MDAL::debug( "flo-2d can store only 2D face datasets" );
+    return;
+  }
 
-  return false; //OK
+  // the time step is appended to the file now, values are not kept in memory
+  try
+  {
+    group->datasets.push_back( writer( group )->writeTimestep( time, values ) );
+  }
+  catch ( MDAL_Status error )
+  {
+    MDAL::debug( "Error status: " + std::to_string( error ) );
+  }
 }
 
 bool MDAL::DriverFlo2D::persist( DatasetGroup *group )
@@ -880,16 +1062,13 @@ bool MDAL::DriverFlo2D::persist( DatasetGroup *group )
   try
   {
     // Return true on error
-    if ( MDAL::fileExists( group->uri() ) )
-    {
-      // Add dataset to a existing file
-      return addToHDF5File( group );
-    }
-    else
-    {
-      // Create new HDF5 file with Flow2D structure
-      return saveNewHDF5File( group );
-    }
+    // time steps are already written by createDataset(), the group without them is created now
+    bool error = writer( group )->finish();
+    group->setWriter( nullptr );
+
+    // the written time steps keep the file open for writing until they are read again
+    closeReadingDatasets( group->mesh(), group->uri() );
+    return error;
   }
   catch ( MDAL_Status error )
   {
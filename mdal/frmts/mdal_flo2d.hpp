@@ -6,7 +6,9 @@
 #ifndef MDAL_FLO2D_HPP
 #define MDAL_FLO2D_HPP
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "mdal_data_model.hpp"
 #include "mdal_memory_data_model.hpp"
@@ -15,9 +17,139 @@
 
 class HdfGroup;
 class HdfFile;
+class HdfDataset;
 
 namespace MDAL
 {
+  /**
+   * Time step of a group of TIMDEP.HDF5 file, read on demand
+   *
+   * The file is kept open by the values array, see closeFile()
+   */
+  class Flo2DHdf5Dataset: public Dataset2D
+  {
+    public:
+      Flo2DHdf5Dataset( DatasetGroup *grp, const HdfDataset &valuesDs, const std::string &valuesPath, size_t timeIndex );
+      ~Flo2DHdf5Dataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      //! Reads the time steps by single hyperslab
+      size_t dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer ) override;
+
+      //! Closes the file so it can be opened for writing, it is opened again on the next read
+      void closeFile();
+
+    private:
+      //! Reads values of the time steps, returns false on error
+      bool readValues( size_t datasetCount, size_t indexStart, size_t count, double *buffer );
+
+      std::string mValuesPath;
+      size_t mTimeIndex;
+      std::unique_ptr<HdfDataset> mValues;
+  };
+
+  /**
+   * Index of the time steps of TIMDEP.OUT file
+   *
+   * Stores the time of each time step and the offsets of every LINES_PER_OFFSET-th line
+   * of its values, so the values are parsed from the file on demand
+   */
+  class Flo2DTimdepIndex
+  {
+    public:
+      //! Values of one face, the face lines are ELEM NUM, depth, velocity, velocity x, velocity y (water surface elevation)
+      enum Column
+      {
+        Depth = 1,
+        VelocityX = 3,
+        VelocityY = 4,
+      };
+
+      //! Scans the file, throws MDAL_Status on invalid file
+      Flo2DTimdepIndex( const std::string &fileName, size_t facesCount, std::vector<double> elevations );
+
+      size_t timesCount() const { return mTimes.size(); }
+      double time( size_t timeIndex ) const { return mTimes[timeIndex]; }
+
+      /**
+       * Reads values of the columns for count faces from indexStart of the time step
+       * The values are interleaved in the buffer for more columns, bed elevation is added to the depth
+       * for water level. Faces missing in the file are NaN. Returns false on read error
+       */
+      bool readValues( size_t timeIndex, size_t indexStart, size_t count,
+                       const Column *columns, size_t columnsCount, bool waterLevel, double *buffer ) const;
+
+    private:
+      static const size_t LINES_PER_OFFSET = 1024;
+
+      std::string mFileName;
+      size_t mFacesCount;
+      std::vector<double> mElevations;
+      std::vector<double> mTimes;
+      //! Number of the face lines of each time step
+      std::vector<size_t> mLinesCount;
+      //! Offsets of every LINES_PER_OFFSET-th face line, offsetsPerTime() per time step
+      std::vector<unsigned long long> mOffsets;
+
+      size_t offsetsPerTime() const { return ( mFacesCount + LINES_PER_OFFSET - 1 ) / LINES_PER_OFFSET; }
+  };
+
+  //! Depth, water level or velocity of a time step of TIMDEP.OUT file, read on demand
+  class Flo2DTimdepDataset: public Dataset2D
+  {
+    public:
+      enum Type
+      {
+        Depth,
+        WaterLevel,
+        Velocity,
+      };
+
+      Flo2DTimdepDataset( DatasetGroup *grp, std::shared_ptr<const Flo2DTimdepIndex> index, size_t timeIndex, Type type );
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+
+    private:
+      std::shared_ptr<const Flo2DTimdepIndex> mIndex;
+      size_t mTimeIndex;
+      Type mType;
+  };
+
+  /**
+   * Writes time steps of the group in edit mode to HDF5 file with FLO-2D (XMDF) structure as they are added
+   *
+   * Values, times, minimums and maximums are chunked arrays extended by one row for each time step,
+   * so only one time step is held in memory. The written time steps are read back by Flo2DHdf5Dataset
+   */
+  class Flo2DHdf5Writer: public DatasetGroupWriter
+  {
+    public:
+      //! Creates the file or opens the existing one and creates the group, throws MDAL_Status on error
+      explicit Flo2DHdf5Writer( DatasetGroup *group );
+      ~Flo2DHdf5Writer() override;
+
+      //! Appends the time step, values are interleaved x and y for vectors, throws MDAL_Status on error
+      std::shared_ptr<Dataset> writeTimestep( RelativeTimestamp time, const double *values );
+
+      //! Flushes the file, returns true on error
+      bool finish();
+
+    private:
+      void createGroup( HdfGroup &groupTNOR );
+
+      DatasetGroup *mGroup;
+      std::unique_ptr<HdfFile> mFile;
+      std::unique_ptr<HdfDataset> mValues;
+      std::unique_ptr<HdfDataset> mTimes;
+      std::unique_ptr<HdfDataset> mMaxs;
+      std::unique_ptr<HdfDataset> mMins;
+      std::string mValuesPath;
+      size_t mTimestepCount = 0;
+      std::vector<float> mRow;
+  };
+
   class DriverFlo2D: public Driver
   {
     public:
@@ -30,6 +162,10 @@ namespace MDAL
 
       std::unique_ptr< Mesh > load( const std::string &resultsFile, MDAL_Status *status ) override;
       void load( const std::string &uri, Mesh *mesh, MDAL_Status *status ) override;
+      void createDataset( DatasetGroup *group,
+                          RelativeTimestamp time,
+                          const double *values,
+                          const int *active ) override;
       bool persist( DatasetGroup *group ) override;
 
     private:
@@ -57,9 +193,8 @@ namespace MDAL
       static double calcCellSize( const std::vector<CellCenter> &cells );
 
       // Write API
-      bool addToHDF5File( DatasetGroup *group );
-      bool saveNewHDF5File( DatasetGroup *group );
-      bool appendGroup( HdfFile &file, DatasetGroup *dsGroup, HdfGroup &groupTNOR );
+      //! Returns writer of the group, creates it on the first call, throws MDAL_Status on error
+      Flo2DHdf5Writer *writer( DatasetGroup *group ) const;
 
   };
 
@@ -426,12 +426,12 @@ void MDAL::DriverGdal::addDatasetGroups()
         addDataToOutput( raster_bands[i], dataset, is_vector, i == 0 );
       }
       dataset->activateFaces( mMesh.get() );
-      dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+      MDAL::updateStatistics( dataset );
       group->datasets.push_back( dataset );
     }
 
     // TODO use GDALComputeRasterMinMax
-    group->setStatistics( MDAL::calculateStatistics( group ) );
+    MDAL::updateStatistics( group );
     group->setReferenceTime( referenceTime() );
     mMesh->datasetGroups.push_back( group );
   }
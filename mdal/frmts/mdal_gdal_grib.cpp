@@ -25,6 +25,19 @@ MDAL::DriverGdalGrib *MDAL::DriverGdalGrib::create()
 
 MDAL::DriverGdalGrib::~DriverGdalGrib() = default;
 
+bool MDAL::DriverGdalGrib::canReadSignature( const MDAL::FileSignature &signature )
+{
+  if ( signature.format() == MDAL::FileSignature::Grib )
+    return true;
+
+  // GRIB messages can be preceded by WMO bulletin header
+  if ( signature.header().find( "GRIB" ) != std::string::npos )
+    return true;
+
+  const std::string &ext = signature.extension();
+  return ext == "grb" || ext == "grb2" || ext == "bin" || ext == "grib" || ext == "grib1" || ext == "grib2";
+}
+
 bool MDAL::DriverGdalGrib::parseBandInfo( const MDAL::GdalDataset *cfGDALDataset,
     const metadata_hash &metadata, std::string &band_name,
     MDAL::RelativeTimestamp *time, bool *is_vector, bool *is_x
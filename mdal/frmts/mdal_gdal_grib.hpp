@@ -22,6 +22,7 @@ namespace MDAL
       DriverGdalGrib();
       ~DriverGdalGrib() override;
       DriverGdalGrib *create() override;
+      static bool canReadSignature( const FileSignature &signature );
 
     private:
       bool parseBandInfo( const MDAL::GdalDataset *cfGDALDataset,
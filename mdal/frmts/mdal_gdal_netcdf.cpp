@@ -20,6 +20,13 @@ MDAL::DriverGdalNetCDF *MDAL::DriverGdalNetCDF::create()
   return new DriverGdalNetCDF();
 }
 
+bool MDAL::DriverGdalNetCDF::canReadSignature( const MDAL::FileSignature &signature )
+{
+  // NetCDF4 files are HDF5 files
+  return signature.format() == MDAL::FileSignature::NetCDF ||
+         signature.format() == MDAL::FileSignature::Hdf5;
+}
+
 std::string MDAL::DriverGdalNetCDF::GDALFileName( const std::string &fileName )
 {
 #ifdef WIN32
@@ -22,6 +22,7 @@ namespace MDAL
       DriverGdalNetCDF();
       ~DriverGdalNetCDF( ) override = default;
       DriverGdalNetCDF *create() override;
+      static bool canReadSignature( const FileSignature &signature );
 
     private:
       std::string GDALFileName( const std::string &fileName ) override;
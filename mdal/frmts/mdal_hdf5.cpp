@@ -7,20 +7,144 @@
 #include <cstring>
 #include <algorithm>
 
+#include "mdal_options.hpp"
+#include "mdal_handle_pool.hpp"
+#include "mdal_remote.hpp"
+
+//! Chunk cache size of HDF5 library used for datasets without the access property list
+static const size_t DEFAULT_CHUNK_CACHE_SIZE = 1024 * 1024;
+//! Maximum chunk cache size of one dataset when not set by HDF5_CHUNK_CACHE_SIZE option
+static const size_t MAX_CHUNK_CACHE_SIZE = 32 * 1024 * 1024;
+
+static size_t _nextPrime( size_t n )
+{
+  for ( ;; ++n )
+  {
+    bool prime = n > 1;
+    for ( size_t i = 2; prime && i * i <= n; ++i )
+      prime = n % i != 0;
+    if ( prime )
+      return n;
+  }
+}
+
+//! Opens the remote file read-only with the read-only S3 driver (http range requests), invalid id when HDF5 is built without it
+static hid_t _openRemote( const std::string &uri )
+{
+#ifdef H5_HAVE_ROS3_VFD
+  hid_t fapl = H5Pcreate( H5P_FILE_ACCESS );
+  H5FD_ros3_fapl_t config;
+  memset( &config, 0, sizeof( config ) );
+  config.version = H5FD_CURR_ROS3_FAPL_T_VERSION;
+  config.authenticate = false;
+  H5Pset_fapl_ros3( fapl, &config );
+  const hid_t file = H5Fopen( MDAL::remoteUrl( uri ).c_str(), H5F_ACC_RDONLY, fapl );
+  H5Pclose( fapl );
+  return file;
+#else
+  MDAL::debug( "Remote HDF5 files require HDF5 built with the read-only S3 driver" );
+  MDAL_UNUSED( uri );
+  return -1;
+#endif
+}
+
+/**
+ * Returns dataset access property list with chunk cache large enough to keep all the chunks
+ * of one row (e.g. one time step) of the dataset, or -1 when the default cache is sufficient
+ */
+static hid_t _chunkCacheAccessList( hid_t dataset )
+{
+  size_t maxSize = MAX_CHUNK_CACHE_SIZE;
+  const std::string option = MDAL::openOption( MDAL::OPTION_HDF5_CHUNK_CACHE_SIZE );
+  if ( !option.empty() )
+    maxSize = MDAL::toSizeT( option );
+  if ( maxSize <= DEFAULT_CHUNK_CACHE_SIZE )
+    return -1;
+
+  hid_t dcpl = H5Dget_create_plist( dataset );
+  if ( dcpl < 0 )
+    return -1;
+
+  std::vector<hsize_t> chunkDims( H5S_MAX_RANK );
+  int rank = -1;
+  if ( H5Pget_layout( dcpl ) == H5D_CHUNKED )
+    rank = H5Pget_chunk( dcpl, H5S_MAX_RANK, chunkDims.data() );
+  H5Pclose( dcpl );
+  if ( rank < 1 )
+    return -1;
+
+  hid_t space = H5Dget_space( dataset );
+  std::vector<hsize_t> dims( static_cast<size_t>( rank ) );
+  const bool sameRank = H5Sget_simple_extent_ndims( space ) == rank;
+  if ( sameRank )
+    H5Sget_simple_extent_dims( space, dims.data(), nullptr );
+  H5Sclose( space );
+
+  hid_t type = H5Dget_type( dataset );
+  const size_t typeSize = H5Tget_size( type );
+  H5Tclose( type );
+  if ( !sameRank || typeSize == 0 )
+    return -1;
+
+  size_t chunkSize = typeSize;
+  size_t chunksInRow = 1;
+  for ( size_t i = 0; i < dims.size(); ++i )
+  {
+    if ( chunkDims[i] == 0 )
+      return -1;
+    chunkSize *= chunkDims[i];
+    if ( i > 0 )
+      chunksInRow *= ( dims[i] + chunkDims[i] - 1 ) / chunkDims[i];
+  }
+
+  const size_t cacheSize = std::min( chunkSize * chunksInRow, maxSize );
+  if ( cacheSize <= DEFAULT_CHUNK_CACHE_SIZE )
+    return -1;
+
+  // HDF5 recommends prime number of slots, about 100 times the number of chunks that fit the cache
+  const size_t slots = _nextPrime( std::min( std::max( cacheSize / chunkSize, size_t( 1 ) ) * 100, size_t( 1 ) << 20 ) );
+
+  hid_t dapl = H5Pcreate( H5P_DATASET_ACCESS );
+  if ( dapl >= 0 && H5Pset_chunk_cache( dapl, slots, cacheSize, H5D_CHUNK_CACHE_W0_DEFAULT ) < 0 )
+  {
+    H5Pclose( dapl );
+    return -1;
+  }
+  return dapl;
+}
+
 HdfFile::HdfFile( const std::string &path, HdfFile::Mode mode )
   : mPath( path )
 {
   switch ( mode )
   {
     case HdfFile::ReadOnly:
-      if ( H5Fis_hdf5( mPath.c_str() ) > 0 )
-        d = std::make_shared< Handle >( H5Fopen( path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT ) );
+    {
+      // files already open are shared through the pool
+      std::shared_ptr<void> handle = MDAL::HandlePool::instance().acquire( "HDF5", mPath, [&path]() -> std::shared_ptr<void>
+      {
+        std::shared_ptr<Handle> opened;
+        if ( MDAL::isRemoteUri( path ) )
+          opened = std::make_shared< Handle >( _openRemote( path ) );
+        else if ( H5Fis_hdf5( path.c_str() ) > 0 )
+          opened = std::make_shared< Handle >( H5Fopen( path.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT ) );
+        else
+          return nullptr;
+        if ( opened->id < 0 )
+          return nullptr;
+        return opened;
+      } );
+      if ( handle )
+        d = std::static_pointer_cast< Handle >( handle );
       break;
+    }
     case HdfFile::ReadWrite:
+      MDAL::HandlePool::instance().closeIdle( "HDF5", mPath );
       if ( H5Fis_hdf5( mPath.c_str() ) > 0 )
         d = std::make_shared< Handle >( H5Fopen( path.c_str(), H5F_ACC_RDWR, H5P_DEFAULT ) );
       break;
     case HdfFile::Create:
+      MDAL::HandlePool::instance().closeIdle( "HDF5", mPath );
       d = std::make_shared< Handle >( H5Fcreate( path.c_str(), H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT ) );
       break;
   }
@@ -114,7 +238,7 @@ hid_t HdfAttribute::id() const { return d->id; }
 
 std::string HdfAttribute::readString() const
 {
-  HdfDataType datatype( H5Aget_type( id() ) );
+  HdfDataType datatype( H5Aget_type( id() ), false );
   char name[HDF_MAX_NAME + 1];
   std::memset( name, '\0', HDF_MAX_NAME + 1 );
   herr_t status = H5Aread( d->id, datatype.id(), name );
@@ -167,9 +291,56 @@ HdfDataset::HdfDataset( hid_t file, const std::string &path, HdfDataType dtype,
   d = std::make_shared< Handle >( H5Dcreate2( file, path.c_str(), dtype.id(), dataspace.id(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT ) );
 }
 
+HdfDataset::HdfDataset( hid_t file, const std::string &path, HdfDataType dtype, const std::vector<hsize_t> &rowDims, int deflateLevel )
+  : mType( dtype )
+{
+  std::vector<hsize_t> dims = {0};
+  dims.insert( dims.end(), rowDims.begin(), rowDims.end() );
+  std::vector<hsize_t> maxDims = dims;
+  maxDims[0] = H5S_UNLIMITED;
+  hid_t dsc = H5Screate_simple( static_cast<int>( dims.size() ), dims.data(), maxDims.data() );
+
+  // chunks of whole rows, so a row is read and written at once,
+  // small rows (e.g. times) are grouped not to have tiny chunks
+  hsize_t rowSize = 1;
+  for ( hsize_t dim : rowDims )
+    rowSize *= std::max( dim, hsize_t( 1 ) );
+  std::vector<hsize_t> chunkDims = dims;
+  chunkDims[0] = std::max( hsize_t( 1 ), hsize_t( 1024 ) / rowSize );
+  for ( size_t i = 1; i < chunkDims.size(); ++i )
+    chunkDims[i] = std::max( chunkDims[i], hsize_t( 1 ) );
+
+  hid_t dcpl = H5Pcreate( H5P_DATASET_CREATE );
+  H5Pset_chunk( dcpl, static_cast<int>( chunkDims.size() ), chunkDims.data() );
+  if ( deflateLevel > 0 && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) > 0 )
+  {
+    H5Pset_shuffle( dcpl );
+    H5Pset_deflate( dcpl, static_cast<unsigned>( std::min( deflateLevel, 9 ) ) );
+  }
+
+  d = std::make_shared< Handle >( H5Dcreate2( file, path.c_str(), dtype.id(), dsc, H5P_DEFAULT, dcpl, H5P_DEFAULT ) );
+  H5Pclose( dcpl );
+  H5Sclose( dsc );
+}
+
 HdfDataset::HdfDataset( hid_t file, const std::string &path )
-  : d( std::make_shared< Handle >( H5Dopen2( file, path.c_str(), H5P_DEFAULT ) ) )
 {
+  hid_t id = H5Dopen2( file, path.c_str(), H5P_DEFAULT );
+  if ( id >= 0 )
+  {
+    // the chunk cache is set when opening, the chunking is known only after that,
+    // the dataset must be closed first, otherwise the library reuses the opened one
+    hid_t dapl = _chunkCacheAccessList( id );
+    if ( dapl >= 0 )
+    {
+      H5Dclose( id );
+      id = H5Dopen2( file, path.c_str(), dapl );
+      H5Pclose( dapl );
+      if ( id < 0 )
+        id = H5Dopen2( file, path.c_str(), H5P_DEFAULT );
+    }
+  }
+  d = std::make_shared< Handle >( id );
 }
 
 HdfDataset::~HdfDataset() = default;
@@ -180,13 +351,42 @@ hid_t HdfDataset::id() const { return d->id; }
 
 std::vector<hsize_t> HdfDataset::dims() const
 {
-  hid_t sid = H5Dget_space( d->id );
-  std::vector<hsize_t> ret( static_cast<size_t>( H5Sget_simple_extent_ndims( sid ) ) );
+  hid_t sid = fileSpace().id();
+  std::vector<hsize_t> ret( static_cast<size_t>( std::max( 0, H5Sget_simple_extent_ndims( sid ) ) ) );
   H5Sget_simple_extent_dims( sid, ret.data(), nullptr );
-  H5Sclose( sid );
   return ret;
 }
 
+HdfDataspace &HdfDataset::fileSpace() const
+{
+  if ( !mFileSpace )
+    mFileSpace = std::make_shared<HdfDataspace>( d->id );
+  return *mFileSpace;
+}
+
+HdfDataspace &HdfDataset::memSpace( hsize_t count ) const
+{
+  if ( !mMemSpace || mMemSpaceCount != count )
+  {
+    std::vector<hsize_t> dims = {count};
+    mMemSpace = std::make_shared<HdfDataspace>( dims );
+    mMemSpace->selectHyperslab( 0, count );
+    mMemSpaceCount = count;
+  }
+  return *mMemSpace;
+}
+
+void HdfDataset::countRead( hsize_t count, hid_t memTypeId )
+{
+#ifdef HAVE_PERF_COUNTERS
+  MDAL::Perf::instance().add( MDAL::PerfCounter::Hdf5Reads, 1 );
+  MDAL::Perf::instance().add( MDAL::PerfCounter::Hdf5ReadBytes, static_cast<long long>( count * H5Tget_size( memTypeId ) ) );
+#else
+  MDAL_UNUSED( count );
+  MDAL_UNUSED( memTypeId );
+#endif
+}
+
 hsize_t HdfDataset::elementCount() const
 {
   hsize_t count = 1;
@@ -201,7 +401,7 @@ H5T_class_t HdfDataset::type() const
     return H5Tget_class( mType.id() );
   else
   {
-    HdfDataType dt( H5Dget_type( d->id ) );
+    HdfDataType dt( H5Dget_type( d->id ), false );
     return H5Tget_class( dt.id() );
   }
 }
@@ -286,6 +486,46 @@ void HdfDataset::write( std::vector<double> &value )
     throw MDAL_Status::Err_FailToWriteToDisk;
 }
 
+void HdfDataset::appendRow( const float *values )
+{
+  appendRow( H5T_NATIVE_FLOAT, values );
+}
+
+void HdfDataset::appendRow( const double *values )
+{
+  appendRow( H5T_NATIVE_DOUBLE, values );
+}
+
+void HdfDataset::appendRow( hid_t memTypeId, const void *values )
+{
+  if ( !isValid() )
+    throw MDAL_Status::Err_FailToWriteToDisk;
+
+  std::vector<hsize_t> newDims = dims();
+  if ( newDims.empty() )
+    throw MDAL_Status::Err_FailToWriteToDisk;
+  std::vector<hsize_t> offsets( newDims.size(), 0 );
+  offsets[0] = newDims[0];
+  newDims[0] += 1;
+
+  if ( H5Dset_extent( d->id, newDims.data() ) < 0 )
+    throw MDAL_Status::Err_FailToWriteToDisk;
+
+  // the extent changed, the cached dataspace is replaced (copies of the dataset keep the old one)
+  mFileSpace = std::make_shared<HdfDataspace>( d->id );
+
+  std::vector<hsize_t> counts = newDims;
+  counts[0] = 1;
+  mFileSpace->selectHyperslab( offsets, counts );
+
+  hsize_t rowSize = 1;
+  for ( size_t i = 1; i < counts.size(); ++i )
+    rowSize *= counts[i];
+
+  if ( H5Dwrite( d->id, memTypeId, memSpace( rowSize ).id(), mFileSpace->id(), H5P_DEFAULT, values ) < 0 )
+    throw MDAL_Status::Err_FailToWriteToDisk;
+}
+
 void HdfDataset::write( const std::string &value )
 {
   if ( !isValid() || !mType.isValid() )
@@ -368,6 +608,21 @@ void HdfDataspace::selectHyperslab( const std::vector<hsize_t> offsets,
   }
 }
 
+void HdfDataspace::selectElements( const std::vector<hsize_t> &coordinates )
+{
+  const int rank = H5Sget_simple_extent_ndims( d->id );
+  assert( rank > 0 && coordinates.size() % static_cast<size_t>( rank ) == 0 );
+
+  herr_t status = H5Sselect_elements( d->id,
+                                      H5S_SELECT_SET,
+                                      coordinates.size() / static_cast<size_t>( rank ),
+                                      coordinates.data() );
+  if ( status < 0 )
+  {
+    MDAL::debug( "Failed to select elements!" );
+  }
+}
+
 bool HdfDataspace::isValid() const { return d->id >= 0; }
 
 hid_t HdfDataspace::id() const { return d->id; }
@@ -13,6 +13,7 @@
 #define H5Gopen_vers 1
 
 #include "mdal_utils.hpp"
+#include "mdal_perf.hpp"
 #include "hdf5.h"
 typedef unsigned char uchar;
 
@@ -178,6 +179,8 @@ class HdfDataspace
     //! select from N-D array
     void selectHyperslab( const std::vector<hsize_t> offsets,
                           const std::vector<hsize_t> counts );
+    //! select individual elements of N-D array, coordinates of the elements follow each other
+    void selectElements( const std::vector<hsize_t> &coordinates );
 
     bool isValid() const;
     hid_t id() const;
@@ -195,6 +198,12 @@ class HdfDataset
     HdfDataset( hid_t file, const std::string &path, HdfDataType dtype, size_t nItems = 1 );
     //! Create new dataset with custom dimensions
     HdfDataset( hid_t file, const std::string &path, HdfDataType dtype, HdfDataspace dataspace );
+    /**
+     * Create new chunked dataset extendable along the first dimension, which is empty
+     * rowDims are the dimensions of one row (e.g. one time step), rows are added by appendRow()
+     * The rows are compressed when deflateLevel is 1-9 and the deflate filter is available
+     */
+    HdfDataset( hid_t file, const std::string &path, HdfDataType dtype, const std::vector<hsize_t> &rowDims, int deflateLevel );
     //! Opens dataset for reading
     HdfDataset( hid_t file, const std::string &path );
     ~HdfDataset();
@@ -233,6 +242,7 @@ class HdfDataset
       hsize_t cnt = elementCount();
       std::vector<T> data( cnt );
       herr_t status = H5Dread( d->id, mem_type_id, H5S_ALL, H5S_ALL, H5P_DEFAULT, data.data() );
+      countRead( cnt, mem_type_id );
       if ( status < 0 )
       {
         MDAL::debug( "Failed to read data!" );
@@ -245,25 +255,60 @@ class HdfDataset
         const std::vector<hsize_t> offsets,
         const std::vector<hsize_t> counts ) const
     {
-      HdfDataspace dataspace( d->id );
+      hsize_t totalItems = 1;
+      for ( auto it = counts.begin(); it != counts.end(); ++it )
+        totalItems *= *it;
+
+      std::vector<T> data( totalItems );
+      if ( !readArray( mem_type_id, offsets, counts, data.data() ) )
+        return std::vector<T>();
+      return data;
+    }
+
+    //! Reads part of the N-D array to the buffer with space for the product of counts items
+    template <typename T> bool readArray( hid_t mem_type_id,
+                                          const std::vector<hsize_t> &offsets,
+                                          const std::vector<hsize_t> &counts,
+                                          T *buffer ) const
+    {
+      HdfDataspace &dataspace = fileSpace();
       dataspace.selectHyperslab( offsets, counts );
 
       hsize_t totalItems = 1;
       for ( auto it = counts.begin(); it != counts.end(); ++it )
         totalItems *= *it;
 
-      std::vector<hsize_t> dims = {totalItems};
-      HdfDataspace memspace( dims );
-      memspace.selectHyperslab( 0, totalItems );
+      herr_t status = H5Dread( d->id, mem_type_id, memSpace( totalItems ).id(), dataspace.id(), H5P_DEFAULT, buffer );
+      countRead( totalItems, mem_type_id );
+      if ( status < 0 )
+      {
+        MDAL::debug( "Failed to read data!" );
+        return false;
+      }
+      return true;
+    }
 
-      std::vector<T> data( totalItems );
-      herr_t status = H5Dread( d->id, mem_type_id, memspace.id(), dataspace.id(), H5P_DEFAULT, data.data() );
+    //! Reads the elements of the N-D array to the buffer, in the order of the coordinates
+    //! coordinates contain rank (number of dims) values for each element
+    template <typename T> bool readElements( hid_t mem_type_id,
+        const std::vector<hsize_t> &coordinates,
+        T *buffer ) const
+    {
+      const hsize_t rank = static_cast<hsize_t>( dims().size() );
+      if ( rank == 0 || coordinates.empty() )
+        return false;
+
+      HdfDataspace &dataspace = fileSpace();
+      dataspace.selectElements( coordinates );
+
+      herr_t status = H5Dread( d->id, mem_type_id, memSpace( coordinates.size() / rank ).id(), dataspace.id(), H5P_DEFAULT, buffer );
+      countRead( coordinates.size() / rank, mem_type_id );
       if ( status < 0 )
       {
         MDAL::debug( "Failed to read data!" );
-        return std::vector<T>();
+        return false;
       }
-      return data;
+      return true;
     }
 
     //! Reads float value
@@ -282,12 +327,29 @@ class HdfDataset
     //! Writes array of double data
     void write( std::vector<double> &value );
 
+    //! Extends the dataset created for appending by one row and writes the values to it
+    void appendRow( const float *values );
+    void appendRow( const double *values );
+
   protected:
+    void appendRow( hid_t memTypeId, const void *values );
+
+    //! Dataspace of the dataset, created on first use and reused by the hyperslab reads
+    HdfDataspace &fileSpace() const;
+    //! 1D memory dataspace with count items, reused while the count does not change
+    HdfDataspace &memSpace( hsize_t count ) const;
+    //! Counts the read of count items of the memory type in the performance counters
+    static void countRead( hsize_t count, hid_t memTypeId );
+
     std::shared_ptr<Handle> d;
     hid_t m_fileId;
     std::string m_path;
 
     HdfDataType mType; // when in write mode
+
+    mutable std::shared_ptr<HdfDataspace> mFileSpace;
+    mutable std::shared_ptr<HdfDataspace> mMemSpace;
+    mutable hsize_t mMemSpaceCount = 0;
 };
 
 inline std::vector<std::string> HdfFile::groups() const { return group( "/" ).groups(); }
@@ -296,9 +358,9 @@ inline HdfGroup HdfFile::group( const std::string &path ) const { return HdfGrou
 
 inline HdfDataset HdfFile::dataset( const std::string &path ) const { return HdfDataset( d->id, path ); }
 
-inline HdfGroup HdfGroup::group( const std::string &groupName ) const { return HdfGroup( file_id(), childPath( groupName ) ); }
+inline HdfGroup HdfGroup::group( const std::string &groupName ) const { return HdfGroup( id(), childPath( groupName ) ); }
 
-inline HdfDataset HdfGroup::dataset( const std::string &dsName ) const { return HdfDataset( file_id(), childPath( dsName ) ); }
+inline HdfDataset HdfGroup::dataset( const std::string &dsName ) const { return HdfDataset( id(), childPath( dsName ) ); }
 
 inline bool HdfDataset::hasAttribute( const std::string &attr_name ) const
 {
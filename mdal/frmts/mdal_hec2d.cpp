@@ -4,16 +4,26 @@
  Copyright (C) 2018 Peter Petrik (zilolv at gmail dot com)
 */
 
+#include <string.h>
 #include <vector>
 #include <string>
 #include <cmath>
 #include <limits>
 #include <iterator>
+#include <algorithm>
 #include "assert.h"
 
 #include "mdal_hec2d.hpp"
 #include "mdal_hdf5.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_progress.hpp"
+#include "mdal_parallel.hpp"
+
+//! Number of the groups added by the load, the second half of the progress is split among them
+static const size_t HEC2D_GROUPS_COUNT = 8;
+
+//! Number of cells of a flow area converted by one task
+static const size_t HEC2D_CONVERT_BLOCK = 65536;
 
 static HdfFile openHdfFile( const std::string &fileName )
 {
@@ -201,6 +211,167 @@ static std::vector<MDAL::RelativeTimestamp> readTimes( const HdfFile &hdfFile )
   return convertTimeData( times, dataTimeUnits );
 }
 
+MDAL::HecRasElementDataset::HecRasElementDataset( DatasetGroup *grp,
+    std::shared_ptr<const HecRasOutput> output,
+    hsize_t timeIndex,
+    NoDataFilter filter,
+    std::shared_ptr<MemoryDataset2D> bedElevation )
+  : Dataset2D( grp )
+  , mOutput( output )
+  , mTimeIndex( timeIndex )
+  , mFilter( filter )
+  , mBedElevation( bedElevation )
+{
+}
+
+MDAL::HecRasElementDataset::~HecRasElementDataset() = default;
+
+size_t MDAL::HecRasElementDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  double eps = std::numeric_limits<double>::min();
+  std::fill( buffer, buffer + count, std::numeric_limits<double>::quiet_NaN() );
+
+  const std::vector<size_t> &areaElemStartIndex = mOutput->areaElemStartIndex;
+  const size_t indexEnd = indexStart + count;
+  for ( size_t nArea = 0; nArea < mOutput->areaValues.size(); ++nArea )
+  {
+    // read only the part of the area within the requested range
+    const size_t start = std::max( indexStart, areaElemStartIndex[nArea] );
+    const size_t end = std::min( indexEnd, areaElemStartIndex[nArea + 1] );
+    if ( start >= end )
+      continue;
+
+    const HdfDataset &dsVals = mOutput->areaValues[nArea];
+    const hsize_t areaOffset = start - areaElemStartIndex[nArea];
+    const hsize_t areaCount = end - start;
+    std::vector<float> vals;
+    if ( dsVals.dims().size() == 1 )
+      vals = dsVals.readArray( {areaOffset}, {areaCount} );
+    else
+      vals = dsVals.readArray( {mTimeIndex, areaOffset}, {1, areaCount} );
+
+    if ( vals.size() != areaCount )
+      continue;
+
+    for ( size_t i = 0; i < areaCount; ++i )
+    {
+      size_t eInx = start + i;
+      double val = static_cast<double>( vals[i] );
+      if ( std::isnan( val ) )
+        continue;
+
+      if ( mFilter == ZeroIsNoData )
+      {
+        if ( fabs( val ) <= eps ) // 0 Depth is no-data
+          continue;
+      }
+      else if ( mFilter == BedElevationIsNoData )
+      {
+        double bed_elev = mBedElevation->scalarValue( eInx );
+        if ( !std::isnan( bed_elev ) && fabs( bed_elev - val ) <= eps ) // no change from bed elevation
+          continue;
+      }
+
+      buffer[eInx - indexStart] = val;
+    }
+  }
+
+  return count;
+}
+
+size_t MDAL::HecRasElementDataset::vectorData( size_t, size_t, double * )
+{
+  assert( false ); //checked in C API interface
+  return 0;
+}
+
+MDAL::HecRasFaceDataset::HecRasFaceDataset( DatasetGroup *grp,
+    std::shared_ptr<const HecRasOutput> output,
+    hsize_t timeIndex )
+  : Dataset2D( grp )
+  , mOutput( output )
+  , mTimeIndex( timeIndex )
+{
+}
+
+MDAL::HecRasFaceDataset::~HecRasFaceDataset() = default;
+
+size_t MDAL::HecRasFaceDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  // datasets of the output may be read concurrently, each from its own thread
+  HecRasOutput::CellValues &cellValues = *mOutput->cellValues;
+  std::lock_guard<std::mutex> lock( cellValues.mutex );
+  if ( cellValues.timeIndex != mTimeIndex )
+  {
+    readCellValues( cellValues.values );
+    cellValues.timeIndex = mTimeIndex;
+  }
+  if ( cellValues.values.size() < indexStart + count )
+    return 0;
+
+  memcpy( buffer, cellValues.values.data() + indexStart, count * sizeof( double ) );
+  return count;
+}
+
+void MDAL::HecRasFaceDataset::readCellValues( std::vector<double> &values ) const
+{
+  double eps = std::numeric_limits<double>::min();
+  values.assign( valuesCount(), std::numeric_limits<double>::quiet_NaN() );
+
+  const std::vector<size_t> &areaElemStartIndex = mOutput->areaElemStartIndex;
+  for ( size_t nArea = 0; nArea < mOutput->areaValues.size(); ++nArea )
+  {
+    const size_t areaStart = areaElemStartIndex[nArea];
+    const size_t areaEnd = std::min( areaElemStartIndex[nArea + 1], values.size() );
+
+    const std::vector<int> &face2Cells = mOutput->areaFace2Cells[nArea];
+    const hsize_t nFaces = face2Cells.size() / 2;
+    std::vector<float> vals = mOutput->areaValues[nArea].readArray( {mTimeIndex, 0}, {1, nFaces} );
+    if ( vals.size() != nFaces )
+      continue;
+
+    for ( size_t i = 0; i < nFaces; ++i )
+    {
+      double val = static_cast<double>( vals[i] ); // This is value on face!
+      if ( std::isnan( val ) || fabs( val ) <= eps ) // nan or 0
+        continue;
+
+      for ( size_t c = 0; c < 2; ++c )
+      {
+        if ( face2Cells[2 * i + c] < 0 )
+          continue;
+
+        size_t cell_idx = static_cast<size_t>( face2Cells[2 * i + c] ) + areaStart;
+        if ( cell_idx >= areaEnd )
+          continue;
+
+        // Take just maximum
+        double &value = values[cell_idx];
+        if ( std::isnan( value ) || value < val )
+          value = val;
+      }
+    }
+  }
+}
+
+size_t MDAL::HecRasFaceDataset::vectorData( size_t, size_t, double * )
+{
+  assert( false ); //checked in C API interface
+  return 0;
+}
+
 static std::vector<int> readFace2Cells( const HdfFile &hdfFile, const std::string &flowAreaName, size_t *nFaces )
 {
   // First read face to node mapping
@@ -225,8 +396,6 @@ void MDAL::DriverHec2D::readFaceOutput( const HdfFile &hdfFile,
                                         const std::vector<RelativeTimestamp> &times,
                                         const DateTime &referenceTime )
 {
-  double eps = std::numeric_limits<double>::min();
-
   std::shared_ptr<DatasetGroup> group = std::make_shared< DatasetGroup >(
                                           name(),
                                           mMesh.get(),
@@ -237,60 +406,31 @@ void MDAL::DriverHec2D::readFaceOutput( const HdfFile &hdfFile,
   group->setIsScalar( true );
   group->setReferenceTime( referenceTime );
 
-  std::vector<std::shared_ptr<MDAL::MemoryDataset2D>> datasets;
-
-  for ( size_t tidx = 0; tidx < times.size(); ++tidx )
-  {
-    std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group.get() );
-    dataset->setTime( times[tidx] );
-    datasets.push_back( dataset );
-  }
-
-  std::shared_ptr<MDAL::MemoryDataset2D> firstDataset;
+  std::shared_ptr<HecRasOutput> output = std::make_shared<HecRasOutput>();
+  output->areaElemStartIndex = areaElemStartIndex;
+  output->cellValues.reset( new HecRasOutput::CellValues );
 
   for ( size_t nArea = 0; nArea < flowAreaNames.size(); ++nArea )
   {
     std::string flowAreaName = flowAreaNames[nArea];
 
     size_t nFaces;
-    std::vector<int> face2Cells = readFace2Cells( hdfFile, flowAreaName, &nFaces );
+    output->areaFace2Cells.push_back( readFace2Cells( hdfFile, flowAreaName, &nFaces ) );
 
     HdfGroup gFlowAreaRes = openHdfGroup( rootGroup, flowAreaName );
-    HdfDataset dsVals = openHdfDataset( gFlowAreaRes, rawDatasetName );
-    std::vector<float> vals = dsVals.readArray();
-
-    for ( size_t tidx = 0; tidx < times.size(); ++tidx )
-    {
-      std::shared_ptr<MDAL::MemoryDataset2D> dataset = datasets[tidx];
-      double *values = dataset->values();
-
-      for ( size_t i = 0; i < nFaces; ++i )
-      {
-        size_t idx = tidx * nFaces + i;
-        double val = static_cast<double>( vals[idx] ); // This is value on face!
-
-        if ( !std::isnan( val ) && fabs( val ) > eps ) //not nan and not 0
-        {
-          for ( size_t c = 0; c < 2; ++c )
-          {
-            size_t cell_idx = static_cast<size_t>( face2Cells[2 * i + c] ) + areaElemStartIndex[nArea];
-            // Take just maximum
-            if ( std::isnan( values[cell_idx] ) || values[cell_idx] < val )
-            {
-              values[cell_idx] = val;
-            }
-          }
-        }
-      }
-    }
+    output->areaValues.push_back( openHdfDataset( gFlowAreaRes, rawDatasetName ) );
   }
 
-  for ( auto dataset : datasets )
+  for ( size_t tidx = 0; tidx < times.size(); ++tidx )
   {
-    dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+    std::shared_ptr<HecRasFaceDataset> dataset = std::make_shared< HecRasFaceDataset >( group.get(), output, tidx );
+    dataset->setTime( times[tidx] );
     group->datasets.push_back( dataset );
   }
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+
+  // statistics read all values of the group
+  MDAL::Progress::current().reportOrThrow( 0.5 + 0.5 * static_cast<double>( mMesh->datasetGroups.size() ) / HEC2D_GROUPS_COUNT );
+  MDAL::updateStatistics( group );
   mMesh->datasetGroups.push_back( group );
 }
 
@@ -322,8 +462,6 @@ std::shared_ptr<MDAL::MemoryDataset2D> MDAL::DriverHec2D::readElemOutput( const
     std::shared_ptr<MDAL::MemoryDataset2D> bed_elevation,
     const DateTime &referenceTime )
 {
-  double eps = std::numeric_limits<double>::min();
-
   std::shared_ptr<DatasetGroup> group = std::make_shared< DatasetGroup >(
                                           name(),
                                           mMesh.get(),
@@ -334,74 +472,50 @@ std::shared_ptr<MDAL::MemoryDataset2D> MDAL::DriverHec2D::readElemOutput( const
   group->setIsScalar( true );
   group->setReferenceTime( referenceTime );
 
-  std::vector<std::shared_ptr<MDAL::MemoryDataset2D>> datasets;
+  std::shared_ptr<HecRasOutput> output = std::make_shared<HecRasOutput>();
+  output->areaElemStartIndex = areaElemStartIndex;
 
-  for ( size_t tidx = 0; tidx < times.size(); ++tidx )
+  for ( size_t nArea = 0; nArea < flowAreaNames.size(); ++nArea )
   {
-    std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group.get() );
-    dataset->setTime( times[tidx] );
-    datasets.push_back( dataset );
+    HdfGroup gFlowAreaRes = openHdfGroup( rootGroup, flowAreaNames[nArea] );
+    output->areaValues.push_back( openHdfDataset( gFlowAreaRes, rawDatasetName ) );
   }
 
-  for ( size_t nArea = 0; nArea < flowAreaNames.size(); ++nArea )
+  HecRasElementDataset::NoDataFilter filter = HecRasElementDataset::NoFilter;
+  if ( bed_elevation )
   {
-    size_t nAreaElements = areaElemStartIndex[nArea + 1] - areaElemStartIndex[nArea];
-    std::string flowAreaName = flowAreaNames[nArea];
-    HdfGroup gFlowAreaRes = openHdfGroup( rootGroup, flowAreaName );
-
-    HdfDataset dsVals = openHdfDataset( gFlowAreaRes, rawDatasetName );
-    std::vector<float> vals = dsVals.readArray();
-
-    for ( size_t tidx = 0; tidx < times.size(); ++tidx )
-    {
-      std::shared_ptr<MDAL::MemoryDataset2D> dataset = datasets[tidx];
-      double *values = dataset->values();
-
-      for ( size_t i = 0; i < nAreaElements; ++i )
-      {
-        size_t idx = tidx * nAreaElements + i;
-        size_t eInx = areaElemStartIndex[nArea] + i;
-        double val = static_cast<double>( vals[idx] );
-        if ( !std::isnan( val ) )
-        {
-          if ( !bed_elevation )
-          {
-            // we are populating bed elevation dataset
-            values[eInx] = val;
-          }
-          else
-          {
-            if ( datasetName == "Depth" )
-            {
-              if ( fabs( val ) > eps ) // 0 Depth is no-data
-              {
-                values[eInx] = val;
-              }
-            }
-            else //Water surface
-            {
-              assert( bed_elevation );
-              double bed_elev = bed_elevation->scalarValue( eInx );
-              if ( std::isnan( bed_elev ) || fabs( bed_elev - val ) > eps ) // change from bed elevation
-              {
-                values[eInx] = val;
-              }
-            }
-          }
-        }
-      }
-    }
+    if ( datasetName == "Depth" )
+      filter = HecRasElementDataset::ZeroIsNoData;
+    else  //Water surface
+      filter = HecRasElementDataset::BedElevationIsNoData;
   }
 
-  for ( auto dataset : datasets )
+  for ( size_t tidx = 0; tidx < times.size(); ++tidx )
   {
-    dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+    std::shared_ptr<HecRasElementDataset> dataset =
+      std::make_shared< HecRasElementDataset >( group.get(), output, tidx, filter, bed_elevation );
+    dataset->setTime( times[tidx] );
     group->datasets.push_back( dataset );
   }
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+
+  std::shared_ptr<MDAL::MemoryDataset2D> firstDataset;
+  if ( !bed_elevation )
+  {
+    // we are populating bed elevation dataset, it is needed by other outputs, so keep it in memory
+    firstDataset = std::make_shared< MemoryDataset2D >( group.get() );
+    firstDataset->setTime( group->datasets[0]->time( RelativeTimestamp::hours ), RelativeTimestamp::hours );
+    std::vector<double> values( firstDataset->valuesCount() );
+    group->datasets[0]->scalarData( 0, values.size(), values.data() );
+    firstDataset->setValues( values.data() );
+    group->datasets[0] = firstDataset;
+  }
+
+  // statistics read all values of the group
+  MDAL::Progress::current().reportOrThrow( 0.5 + 0.5 * static_cast<double>( mMesh->datasetGroups.size() ) / HEC2D_GROUPS_COUNT );
+  MDAL::updateStatistics( group );
   mMesh->datasetGroups.push_back( group );
 
-  return datasets[0];
+  return firstDataset;
 }
 
 std::shared_ptr<MDAL::MemoryDataset2D> MDAL::DriverHec2D::readBedElevation(
@@ -563,50 +677,97 @@ void MDAL::DriverHec2D::setProjection( HdfFile hdfFile )
   catch ( MDAL_Status ) { /* projection not set */}
 }
 
+//! Arrays of one 2D flow area read from the file and the positions of its elements in the mesh
+struct FlowAreaArrays2D
+{
+  std::vector<double> coords;
+  size_t coordsColumns = 0;
+  size_t nodeStart = 0;
+  std::vector<int> elemNodes;
+  size_t elemColumns = 0;
+  std::vector<int> edgeNodes;
+  size_t edgeStart = 0;
+};
+
 void MDAL::DriverHec2D::parseMesh(
   HdfGroup gGeom2DFlowAreas,
   std::vector<size_t> &areaElemStartIndex,
   const std::vector<std::string> &flowAreaNames )
 {
-  Faces faces;
-  Vertices vertices;
-
-  size_t maxVerticesInFace = 0;
+  // HDF5 is read on this thread, the arrays of all areas are then converted in parallel into their slices
+  std::vector<FlowAreaArrays2D> areas( flowAreaNames.size() );
+  bool hasEdges = true;
+  size_t verticesCount = 0;
+  size_t edgesCount = 0;
 
   for ( size_t nArea = 0; nArea < flowAreaNames.size(); ++nArea )
   {
-    std::string flowAreaName = flowAreaNames[nArea];
-
-    HdfGroup gArea = openHdfGroup( gGeom2DFlowAreas, flowAreaName );
+    MDAL::Progress::current().reportOrThrow( 0.5 * static_cast<double>( nArea ) / static_cast<double>( flowAreaNames.size() ) );
+    FlowAreaArrays2D &area = areas[nArea];
+    HdfGroup gArea = openHdfGroup( gGeom2DFlowAreas, flowAreaNames[nArea] );
 
     HdfDataset dsCoords = openHdfDataset( gArea, "FacePoints Coordinate" );
     std::vector<hsize_t> cdims = dsCoords.dims();
-    std::vector<double> coords = dsCoords.readArrayDouble(); //2xnNodes matrix in array
-    size_t nNodes = cdims[0];
-    size_t areaNodeStartIndex = vertices.size();
-    vertices.resize( areaNodeStartIndex + nNodes );
-    for ( size_t n = 0; n < nNodes; ++n )
-    {
-      size_t nIdx = areaNodeStartIndex + n;
-      vertices[nIdx].x = coords[cdims[1] * n];
-      vertices[nIdx].y = coords[cdims[1] * n + 1];
-    }
+    area.coords = dsCoords.readArrayDouble(); //2xnNodes matrix in array
+    area.coordsColumns = cdims[1];
+    area.nodeStart = verticesCount;
+    verticesCount += cdims[0];
 
     HdfDataset dsElems = openHdfDataset( gArea, "Cells FacePoint Indexes" );
     std::vector<hsize_t> edims = dsElems.dims();
-    size_t nElems = edims[0];
-    size_t maxFaces = edims[1]; // elems have up to 8 faces, but sometimes the table has less than 8 columns
-    std::vector<int> elem_nodes = dsElems.readArrayInt(); //maxFacesxnElements matrix in array
-    areaElemStartIndex[nArea] = faces.size();
-    faces.resize( faces.size() + nElems );
-    for ( size_t e = 0; e < nElems; ++e )
+    area.elemNodes = dsElems.readArrayInt(); //maxFacesxnElements matrix in array
+    area.elemColumns = edims[1]; // elems have up to 8 faces, but sometimes the table has less than 8 columns
+    areaElemStartIndex[nArea + 1] = areaElemStartIndex[nArea] + edims[0];
+
+    // HEC-RAS stores the faces (edges) of the cells, these are used for the mesh topology
+    hasEdges = hasEdges && gArea.pathExists( "Faces FacePoint Indexes" );
+    if ( hasEdges )
+    {
+      HdfDataset dsEdges = openHdfDataset( gArea, "Faces FacePoint Indexes" );
+      area.edgeNodes = dsEdges.readArrayInt(); //2xnFaces matrix in array
+      area.edgeStart = edgesCount;
+      edgesCount += area.edgeNodes.size();
+    }
+  }
+  const size_t facesCount = areaElemStartIndex[flowAreaNames.size()];
+
+  // blocks of the areas, so a single large area is split too, each area has at least one block
+  struct Block
+  {
+    size_t area;
+    size_t start;
+    size_t end;
+  };
+  std::vector<Block> blocks;
+  for ( size_t nArea = 0; nArea < areas.size(); ++nArea )
+  {
+    const size_t nElems = areaElemStartIndex[nArea + 1] - areaElemStartIndex[nArea];
+    size_t start = 0;
+    do
+    {
+      blocks.push_back( { nArea, start, std::min( nElems, start + HEC2D_CONVERT_BLOCK ) } );
+      start += HEC2D_CONVERT_BLOCK;
+    }
+    while ( start < nElems );
+  }
+
+  Vertices vertices( verticesCount );
+  Faces faces( facesCount );
+  std::vector<uint32_t> edges( hasEdges ? edgesCount : 0 );
+  std::vector<size_t> blockMaxVerticesInFace( blocks.size(), 0 );
+  parallelFor( blocks.size(), [&]( size_t nBlock )
+  {
+    const Block &block = blocks[nBlock];
+    const FlowAreaArrays2D &area = areas[block.area];
+    const size_t maxFaces = area.elemColumns;
+    std::vector<size_t> idx( maxFaces );
+    for ( size_t e = block.start; e < block.end; ++e )
     {
-      size_t eIdx = areaElemStartIndex[nArea] + e;
-      std::vector<size_t> idx( maxFaces );
+      size_t eIdx = areaElemStartIndex[block.area] + e;
       size_t nValidVertexes = maxFaces;
       for ( size_t fi = 0; fi < maxFaces; ++fi )
       {
-        int elem_node_idx = elem_nodes[edims[1] * e + fi];
+        int elem_node_idx = area.elemNodes[maxFaces * e + fi];
 
         if ( elem_node_idx == -1 )
         {
@@ -615,17 +776,39 @@ void MDAL::DriverHec2D::parseMesh(
         }
         else
         {
-          idx[fi] = areaNodeStartIndex + static_cast<size_t>( elem_node_idx ); // shift by this area start node index
+          idx[fi] = area.nodeStart + static_cast<size_t>( elem_node_idx ); // shift by this area start node index
         }
       }
       if ( nValidVertexes > 0 )
         faces[eIdx].assign( idx.begin(), std::next( idx.begin(), nValidVertexes ) );
 
-      if ( nValidVertexes > maxVerticesInFace )
-        maxVerticesInFace = nValidVertexes;
+      if ( nValidVertexes > blockMaxVerticesInFace[nBlock] )
+        blockMaxVerticesInFace[nBlock] = nValidVertexes;
+    }
+
+    // the first block of the area converts its vertices and edges as well
+    if ( block.start > 0 )
+      return;
+
+    const size_t nNodes = area.coordsColumns > 0 ? area.coords.size() / area.coordsColumns : 0;
+    for ( size_t n = 0; n < nNodes; ++n )
+    {
+      size_t nIdx = area.nodeStart + n;
+      vertices[nIdx].x = area.coords[area.coordsColumns * n];
+      vertices[nIdx].y = area.coords[area.coordsColumns * n + 1];
     }
-  }
-  areaElemStartIndex[flowAreaNames.size()] = faces.size();
+
+    if ( hasEdges )
+    {
+      for ( size_t i = 0; i < area.edgeNodes.size(); ++i )
+        edges[area.edgeStart + i] = static_cast<uint32_t>( area.nodeStart + static_cast<size_t>( area.edgeNodes[i] ) );
+    }
+  } );
+
+  areas.clear();
+
+  const size_t maxVerticesInFace = blockMaxVerticesInFace.empty() ? 0 :
+                                   *std::max_element( blockMaxVerticesInFace.begin(), blockMaxVerticesInFace.end() );
 
   mMesh.reset(
     new MemoryMesh(
@@ -637,8 +820,10 @@ void MDAL::DriverHec2D::parseMesh(
       mFileName
     )
   );
-  mMesh->faces = faces;
-  mMesh->vertices = vertices;
+  mMesh->faces = std::move( faces );
+  mMesh->vertices = std::move( vertices );
+  if ( hasEdges )
+    mMesh->setFileEdges( std::move( edges ) );
 }
 
 MDAL::DriverHec2D::DriverHec2D()
@@ -654,6 +839,11 @@ MDAL::DriverHec2D *MDAL::DriverHec2D::create()
   return new DriverHec2D();
 }
 
+bool MDAL::DriverHec2D::canReadSignature( const MDAL::FileSignature &signature )
+{
+  return signature.format() == MDAL::FileSignature::Hdf5;
+}
+
 bool MDAL::DriverHec2D::canReadMesh( const std::string &uri )
 {
   try
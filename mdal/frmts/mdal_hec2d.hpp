@@ -6,7 +6,11 @@
 #ifndef MDAL_HEC2D_HPP
 #define MDAL_HEC2D_HPP
 
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "mdal_data_model.hpp"
 #include "mdal_memory_data_model.hpp"
@@ -16,6 +20,87 @@
 
 namespace MDAL
 {
+  /**
+   * HDF5 arrays of one HEC-RAS output, shared by all its time steps
+   *
+   * Each 2D flow area has its own array, either (time, items) or (items)
+   * for the outputs without time
+   */
+  struct HecRasOutput
+  {
+    std::vector<HdfDataset> areaValues;
+    //! index of the first mesh face of each area, the last one is faces count
+    std::vector<size_t> areaElemStartIndex;
+    //! two cell indexes for each HEC-RAS face of each area, only for the outputs on HEC-RAS faces
+    std::vector<std::vector<int>> areaFace2Cells;
+
+    //! Values of the cells of the last time step read from HEC-RAS faces, filled by HecRasFaceDataset
+    struct CellValues
+    {
+      std::mutex mutex;
+      size_t timeIndex = std::numeric_limits<size_t>::max();
+      std::vector<double> values;
+    };
+    std::unique_ptr<CellValues> cellValues;
+  };
+
+  /**
+   * The HecRasElementDataset reads values of the cells for a single time step
+   * directly from HDF5 file by hyperslabs of the overlapping flow areas
+   */
+  class HecRasElementDataset: public Dataset2D
+  {
+    public:
+      enum NoDataFilter
+      {
+        NoFilter = 0, //!< all values are valid
+        ZeroIsNoData, //!< zero depth is no-data
+        BedElevationIsNoData, //!< water surface equal to bed elevation is no-data
+      };
+
+      HecRasElementDataset( DatasetGroup *grp,
+                            std::shared_ptr<const HecRasOutput> output,
+                            hsize_t timeIndex,
+                            NoDataFilter filter,
+                            std::shared_ptr<MemoryDataset2D> bedElevation );
+      ~HecRasElementDataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+
+    private:
+      std::shared_ptr<const HecRasOutput> mOutput;
+      hsize_t mTimeIndex;
+      NoDataFilter mFilter;
+      std::shared_ptr<MemoryDataset2D> mBedElevation;
+  };
+
+  /**
+   * The HecRasFaceDataset reads values on HEC-RAS faces (mesh edges) for a single
+   * time step and assigns each cell the maximum of its faces
+   *
+   * Any face of an area may belong to the requested cells, so the whole time step is read at once
+   * and the values of the cells are kept in the output until a different time step is read.
+   */
+  class HecRasFaceDataset: public Dataset2D
+  {
+    public:
+      HecRasFaceDataset( DatasetGroup *grp,
+                         std::shared_ptr<const HecRasOutput> output,
+                         hsize_t timeIndex );
+      ~HecRasFaceDataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+
+    private:
+      //! Assigns the maximum of the faces of the time step to the cells of all areas
+      void readCellValues( std::vector<double> &values ) const;
+
+      std::shared_ptr<const HecRasOutput> mOutput;
+      hsize_t mTimeIndex;
+  };
+
   /**
    * HEC-RAS 2D format.
    *
@@ -42,6 +127,7 @@ namespace MDAL
       ~DriverHec2D( ) override = default;
       DriverHec2D *create() override;
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadMesh( const std::string &uri ) override;
       std::unique_ptr< Mesh > load( const std::string &resultsFile, MDAL_Status *status ) override;
 
@@ -12,6 +12,8 @@
 #include "mdal_netcdf.hpp"
 #include "mdal.h"
 #include "mdal_utils.hpp"
+#include "mdal_perf.hpp"
+#include "mdal_remote.hpp"
 
 NetCDFFile::NetCDFFile(): mNcid( 0 ) {}
 
@@ -31,7 +33,9 @@ int NetCDFFile::handle() const
 
 void NetCDFFile::openFile( const std::string &fileName )
 {
-  int res = nc_open( fileName.c_str(), NC_NOWRITE, &mNcid );
+  // remote files are read by http range requests, requires NetCDF built with byte-range support
+  const std::string path = MDAL::isRemoteUri( fileName ) ? MDAL::remoteUrl( fileName ) + "#mode=bytes" : fileName;
+  int res = nc_open( path.c_str(), NC_NOWRITE, &mNcid );
   if ( res != NC_NOERR )
   {
     MDAL::debug( nc_strerror( res ) );
@@ -39,6 +43,18 @@ void NetCDFFile::openFile( const std::string &fileName )
   }
 }
 
+//! Counts the read of count values of the size in the performance counters
+static void _countRead( size_t count, size_t valueSize )
+{
+#ifdef HAVE_PERF_COUNTERS
+  MDAL::Perf::instance().add( MDAL::PerfCounter::NetCDFReads, 1 );
+  MDAL::Perf::instance().add( MDAL::PerfCounter::NetCDFReadBytes, static_cast<long long>( count * valueSize ) );
+#else
+  MDAL_UNUSED( count );
+  MDAL_UNUSED( valueSize );
+#endif
+}
+
 std::vector<int> NetCDFFile::readIntArr( const std::string &name, size_t dim ) const
 {
   assert( mNcid != 0 );
@@ -46,6 +62,7 @@ std::vector<int> NetCDFFile::readIntArr( const std::string &name, size_t dim ) c
   if ( nc_inq_varid( mNcid, name.c_str(), &arr_id ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
   std::vector<int> arr_val( dim );
   if ( nc_get_var_int( mNcid, arr_id, arr_val.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+  _countRead( dim, sizeof( int ) );
   return arr_val;
 }
 
@@ -60,6 +77,7 @@ std::vector<int> NetCDFFile::readIntArr( int arr_id, size_t start_dim1, size_t s
   std::vector<int> arr_val( count_dim1 * count_dim2 );
   int res = nc_get_vars_int( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val.data() );
   if ( res != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+  _countRead( arr_val.size(), sizeof( int ) );
   return arr_val;
 }
 
@@ -74,6 +92,7 @@ std::vector<int> NetCDFFile::readIntArr( int arr_id, size_t start_dim, size_t co
   std::vector<int> arr_val( count_dim );
   int res = nc_get_vars_int( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val.data() );
   if ( res != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+  _countRead( arr_val.size(), sizeof( int ) );
   return arr_val;
 }
 
@@ -93,6 +112,7 @@ std::vector<double> NetCDFFile::readDoubleArr( const std::string &name, size_t d
   {
     std::vector<float> arr_val_f( dim );
     if ( nc_get_var_float( mNcid, arr_id, arr_val_f.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( dim, sizeof( float ) );
     for ( size_t i = 0; i < dim; ++i )
     {
       const float val = arr_val_f[i];
@@ -105,6 +125,7 @@ std::vector<double> NetCDFFile::readDoubleArr( const std::string &name, size_t d
   else if ( typep == NC_DOUBLE )
   {
     if ( nc_get_var_double( mNcid, arr_id, arr_val.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( dim, sizeof( double ) );
   }
   else
   {
@@ -132,6 +153,7 @@ std::vector<double> NetCDFFile::readDoubleArr( int arr_id,
   {
     std::vector<float> arr_val_f( count_dim1 * count_dim2 );
     if ( nc_get_vars_float( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val_f.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( arr_val_f.size(), sizeof( float ) );
     for ( size_t i = 0; i < count_dim1 * count_dim2; ++i )
     {
       const float val = arr_val_f[i];
@@ -145,6 +167,7 @@ std::vector<double> NetCDFFile::readDoubleArr( int arr_id,
   {
     std::vector<unsigned char> arr_val_b( count_dim1 * count_dim2 );
     if ( nc_get_vars_uchar( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val_b.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( arr_val_b.size(), sizeof( unsigned char ) );
     for ( size_t i = 0; i < count_dim1 * count_dim2; ++i )
     {
       const unsigned char val = arr_val_b[i];
@@ -157,6 +180,7 @@ std::vector<double> NetCDFFile::readDoubleArr( int arr_id,
   else if ( typep == NC_DOUBLE )
   {
     if ( nc_get_vars_double( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( arr_val.size(), sizeof( double ) );
   }
   else
   {
@@ -185,6 +209,7 @@ std::vector<double> NetCDFFile::readDoubleArr( int arr_id,
   {
     std::vector<float> arr_val_f( count_dim );
     if ( nc_get_vars_float( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val_f.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( arr_val_f.size(), sizeof( float ) );
     for ( size_t i = 0; i < count_dim; ++i )
     {
       const float val = arr_val_f[i];
@@ -197,6 +222,7 @@ std::vector<double> NetCDFFile::readDoubleArr( int arr_id,
   else if ( typep == NC_DOUBLE )
   {
     if ( nc_get_vars_double( mNcid, arr_id, startp.data(), countp.data(), stridep.data(), arr_val.data() ) != NC_NOERR ) throw MDAL_Status::Err_UnknownFormat;
+    _countRead( arr_val.size(), sizeof( double ) );
   }
   else
   {
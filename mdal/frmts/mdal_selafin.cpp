@@ -20,6 +20,7 @@
 #include "mdal_selafin.hpp"
 #include "mdal.h"
 #include "mdal_utils.hpp"
+#include "mdal_progress.hpp"
 #include <math.h>
 
 MDAL::SerafinStreamReader::SerafinStreamReader() = default;
@@ -186,6 +187,39 @@ size_t MDAL::SerafinStreamReader::read_sizet()
   return static_cast<size_t>( var );
 }
 
+void MDAL::SerafinStreamReader::ignore_double_arr( size_t len )
+{
+  size_t length = read_sizet();
+  if ( length != len * valueSize() ) throw MDAL_Status::Err_UnknownFormat;
+  if ( remainingBytes() < length + 4 ) throw MDAL_Status::Err_UnknownFormat;
+  mIn.seekg( static_cast<std::streamoff>( length ), mIn.cur );
+  ignore_array_length();
+}
+
+void MDAL::SerafinStreamReader::read_double_arr( std::streampos recordPosition, size_t indexStart, size_t count, double *buffer )
+{
+  // skip the record length and values before indexStart
+  mIn.clear();
+  mIn.seekg( recordPosition + static_cast<std::streamoff>( 4 + indexStart * valueSize() ) );
+  if ( !mIn )
+    throw MDAL_Status::Err_UnknownFormat;
+
+  for ( size_t i = 0; i < count; ++i )
+  {
+    buffer[i] = read_double();
+  }
+}
+
+size_t MDAL::SerafinStreamReader::valueSize() const
+{
+  return mStreamInFloatPrecision ? 4 : 8;
+}
+
+std::streampos MDAL::SerafinStreamReader::position()
+{
+  return mIn.tellg();
+}
+
 size_t MDAL::SerafinStreamReader::remainingBytes()
 {
   return static_cast<size_t>( mFileSize - mIn.tellg() );
@@ -203,6 +237,147 @@ void MDAL::SerafinStreamReader::ignore_array_length( )
   ignore( 4 );
 }
 
+// //////////////////////////////
+// DATASET
+// //////////////////////////////
+MDAL::SelafinDataset::SelafinDataset( DatasetGroup *parent, std::shared_ptr<SerafinStreamReader> reader )
+  : Dataset2D( parent )
+  , mReader( reader )
+{
+  setSupportsActiveFlag( true );
+}
+
+MDAL::SelafinDataset::~SelafinDataset() = default;
+
+void MDAL::SelafinDataset::setXRecordPosition( std::streampos position )
+{
+  mXRecordPosition = position;
+}
+
+void MDAL::SelafinDataset::setYRecordPosition( std::streampos position )
+{
+  mYRecordPosition = position;
+}
+
+void MDAL::SelafinDataset::readValues( std::streampos position, size_t indexStart, size_t count, double *buffer )
+{
+  if ( position < 0 )
+  {
+    // component missing in the file
+    std::fill( buffer, buffer + count, std::numeric_limits<double>::quiet_NaN() );
+    return;
+  }
+
+  mReader->read_double_arr( position, indexStart, count, buffer );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    if ( MDAL::equals( buffer[i], 0 ) )
+      buffer[i] = std::numeric_limits<double>::quiet_NaN();
+  }
+}
+
+size_t MDAL::SelafinDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  try
+  {
+    readValues( mXRecordPosition, indexStart, count, buffer );
+  }
+  catch ( MDAL_Status )
+  {
+    return 0;
+  }
+  return count;
+}
+
+size_t MDAL::SelafinDataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+  count = std::min( nValues - indexStart, count );
+
+  std::vector<double> x( count );
+  std::vector<double> y( count );
+  try
+  {
+    readValues( mXRecordPosition, indexStart, count, x.data() );
+    readValues( mYRecordPosition, indexStart, count, y.data() );
+  }
+  catch ( MDAL_Status )
+  {
+    return 0;
+  }
+
+  for ( size_t i = 0; i < count; ++i )
+  {
+    buffer[2 * i] = x[i];
+    buffer[2 * i + 1] = y[i];
+  }
+  return count;
+}
+
+bool MDAL::SelafinDataset::readActive()
+{
+  MemoryMesh *m = static_cast<MemoryMesh *>( mesh() );
+  const size_t nVertices = m->verticesCount();
+  const bool isScalar = group()->isScalar();
+
+  // Activate only Faces that do all Vertex's outputs with some data
+  std::vector<double> values( isScalar ? nVertices : 2 * nVertices );
+  size_t read = isScalar ? scalarData( 0, nVertices, values.data() ) : vectorData( 0, nVertices, values.data() );
+  if ( read != nVertices )
+    return false;
+
+  const CompressedFaces &faces = m->faces;
+  const size_t nFaces = m->facesCount();
+  mActive.assign( nFaces, true );
+  for ( size_t faceIndex = 0; faceIndex < nFaces; ++faceIndex )
+  {
+    const size_t faceEnd = faces.faceOffset( faceIndex + 1 );
+    for ( size_t i = faces.faceOffset( faceIndex ); i < faceEnd; ++i )
+    {
+      const size_t vertexIndex = faces.vertexIndexAt( i );
+      const bool hasValue = isScalar ?
+                            !std::isnan( values[vertexIndex] ) :
+                            !( std::isnan( values[2 * vertexIndex] ) || std::isnan( values[2 * vertexIndex + 1] ) );
+      if ( !hasValue )
+      {
+        mActive[faceIndex] = false; //NOT ACTIVE
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+size_t MDAL::SelafinDataset::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  size_t nFaces = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nFaces ) )
+    return 0;
+  count = std::min( nFaces - indexStart, count );
+
+  // the faces are read by blocks, all values of the time step are read only once
+  if ( mActive.empty() && !readActive() )
+    return 0;
+
+  for ( size_t idx = 0; idx < count; ++idx )
+    buffer[idx] = mActive[indexStart + idx] ? 1 : 0;
+  return count;
+}
+
+size_t MDAL::SelafinDataset::memoryUsage() const
+{
+  return mActive.capacity() / 8;
+}
+
 // //////////////////////////////
 // DRIVER
 // //////////////////////////////
@@ -239,20 +414,21 @@ void MDAL::DriverSelafin::parseFile( std::vector<std::string> &var_names,
   /* 1 record containing the title of the study (72 characters) and a 8 characters
   string indicating the type of format (SERAFIN or SERAFIND)
   */
-  mReader.initialize( mFileName );
+  mReader = std::make_shared<SerafinStreamReader>();
+  mReader->initialize( mFileName );
 
   /* 1 record containing the two integers NBV(1) and NBV(2) (number of linear
      and quadratic variables, NBV(2) with the value of 0 for Telemac, as
      quadratic values are not saved so far), numbered from 1 in docs
   */
-  std::vector<size_t> nbv = mReader.read_size_t_arr( 2 );
+  std::vector<size_t> nbv = mReader->read_size_t_arr( 2 );
 
   /* NBV(1) records containing the names and units of each variab
      le (over 32 characters)
   */
   for ( size_t i = 0; i < nbv[0]; ++i )
   {
-    var_names.push_back( mReader.read_string( 32 ) );
+    var_names.push_back( mReader->read_string( 32 ) );
   }
 
   /* 1 record containing the integers table IPARAM (10 integers, of which only
@@ -277,7 +453,7 @@ void MDAL::DriverSelafin::parseFile( std::vector<std::string> &var_names,
       by the array KNOLG (total initial number of points). All the other
       numbers are local to the sub-domain, including IKLE
   */
-  std::vector<int> params = mReader.read_int_arr( 10 );
+  std::vector<int> params = mReader->read_int_arr( 10 );
   *xOrigin = static_cast<double>( params[2] );
   *yOrigin = static_cast<double>( params[3] );
 
@@ -293,14 +469,14 @@ void MDAL::DriverSelafin::parseFile( std::vector<std::string> &var_names,
 
   if ( params[9] == 1 )
   {
-    std::vector<int> datetime = mReader.read_int_arr( 6 );
+    std::vector<int> datetime = mReader->read_int_arr( 6 );
     referenceTime = DateTime( datetime[0], datetime[1], datetime[2], datetime[3], datetime[4], double( datetime[5] ) );
   }
 
   /* 1 record containing the integers NELEM,NPOIN,NDP,1 (number of
      elements, number of points, number of points per element and the value 1)
    */
-  std::vector<size_t> numbers = mReader.read_size_t_arr( 4 );
+  std::vector<size_t> numbers = mReader->read_size_t_arr( 4 );
   *nElem = numbers[0];
   *nPoint = numbers[1];
   *nPointsPerElem = numbers[2];
@@ -311,7 +487,7 @@ void MDAL::DriverSelafin::parseFile( std::vector<std::string> &var_names,
 
      Attention: in TELEMAC-2D, the dimensions of this array are (NELEM,NDP))
   */
-  ikle = mReader.read_size_t_arr( ( *nElem ) * ( *nPointsPerElem ) );
+  ikle = mReader->read_size_t_arr( ( *nElem ) * ( *nPointsPerElem ) );
   for ( size_t i = 0; i < ikle.size(); ++i )
   {
     -- ikle[i];  //numbered from 1
@@ -321,37 +497,43 @@ void MDAL::DriverSelafin::parseFile( std::vector<std::string> &var_names,
      value of one element is 0 for an internal point, and
      gives the numbering of boundary points for the others
   */
-  std::vector<int> iPointBoundary = mReader.read_int_arr( *nPoint );
+  std::vector<int> iPointBoundary = mReader->read_int_arr( *nPoint );
   MDAL_UNUSED( iPointBoundary )
 
   /* 1 record containing table X (real array of dimension NPOIN containing the
      abscissae of the points)
   */
-  x = mReader.read_double_arr( *nPoint );
+  x = mReader->read_double_arr( *nPoint );
 
   /* 1 record containing table Y (real array of dimension NPOIN containing the
      abscissae of the points)
   */
-  y = mReader.read_double_arr( *nPoint );
+  y = mReader->read_double_arr( *nPoint );
 
 
   /* Next, for each time step, the following are found:
      - 1 record containing time T (real),
      - NBV(1)+NBV(2) records containing the results tables for each variable at time
+
+     Only positions of the records are stored here, values are read by SelafinDataset
   */
   data.resize( var_names.size() );
 
-  size_t nTimesteps = mReader.remainingBytes() / ( 12 + ( 4 + ( *nPoint ) * 4 + 4 ) * var_names.size() );
+  const size_t valueSize = mReader->valueSize();
+  const size_t timestepSize = 8 + valueSize + ( 8 + ( *nPoint ) * valueSize ) * var_names.size();
+  size_t nTimesteps = mReader->remainingBytes() / timestepSize;
+  MDAL::Progress &progress = MDAL::Progress::current();
   for ( size_t nT = 0; nT < nTimesteps; ++nT )
   {
-    std::vector<double> times = mReader.read_double_arr( 1 );
+    progress.reportOrThrow( static_cast<double>( nT ) / static_cast<double>( nTimesteps ) );
+    std::vector<double> times = mReader->read_double_arr( 1 );
     double time = times[0];
 
     for ( size_t i = 0; i < var_names.size(); ++i )
     {
       timestep_map &datait = data[i];
-      std::vector<double> datavals = mReader.read_double_arr( *nPoint );
-      datait[time] = datavals;
+      datait[time] = mReader->position();
+      mReader->ignore_double_arr( *nPoint );
     }
   }
 }
@@ -414,7 +596,6 @@ void MDAL::DriverSelafin::createMesh(
 
 void MDAL::DriverSelafin::addData( const std::vector<std::string> &var_names,
                                    const std::vector<timestep_map> &data,
-                                   size_t nPoints,
                                    const DateTime &referenceTime )
 {
   for ( size_t nName = 0; nName < var_names.size(); ++nName )
@@ -474,62 +655,41 @@ void MDAL::DriverSelafin::addData( const std::vector<std::string> &var_names,
     size_t i = 0;
     for ( timestep_map::const_iterator it = data[nName].begin(); it != data[nName].end(); ++it, ++i )
     {
-      std::shared_ptr<MDAL::MemoryDataset2D> dataset;
+      std::shared_ptr<MDAL::SelafinDataset> dataset;
       if ( group->datasets.size() > i )
       {
-        dataset = std::dynamic_pointer_cast<MDAL::MemoryDataset2D>( group->datasets[i] );
+        dataset = std::dynamic_pointer_cast<MDAL::SelafinDataset>( group->datasets[i] );
       }
       else
       {
-        dataset = std::make_shared< MemoryDataset2D >( group.get(), true );
+        dataset = std::make_shared< SelafinDataset >( group.get(), mReader );
         // see https://github.com/lutraconsulting/MDAL/issues/185
         dataset->setTime( it->first, RelativeTimestamp::seconds );
         group->datasets.push_back( dataset );
       }
-      for ( size_t nP = 0; nP < nPoints; nP++ )
-      {
-        double val = it->second.at( nP );
-        if ( MDAL::equals( val, 0 ) )
-        {
-          val = std::numeric_limits<double>::quiet_NaN();
-        }
-        if ( is_vector )
-        {
-          if ( is_x )
-          {
-            dataset->setValueX( nP, val );
-          }
-          else
-          {
-            dataset->setValueY( nP, val );
-          }
-        }
-        else
-        {
-          dataset->setScalarValue( nP, val );
-        }
-      }
+
+      if ( is_vector && !is_x )
+        dataset->setYRecordPosition( it->second );
+      else
+        dataset->setXRecordPosition( it->second );
     }
   }
 
-  // now activate faces and calculate statistics
+  // now calculate statistics
   for ( auto group : mMesh->datasetGroups )
   {
-    for ( auto dataset : group->datasets )
-    {
-      std::shared_ptr<MDAL::MemoryDataset2D> dts = std::dynamic_pointer_cast<MDAL::MemoryDataset2D>( dataset );
-      if ( dts )
-        dts->activateFaces( mMesh.get() );
-
-      MDAL::Statistics stats = MDAL::calculateStatistics( dataset );
-      dataset->setStatistics( stats );
-    }
-
-    MDAL::Statistics stats = MDAL::calculateStatistics( group );
-    group->setStatistics( stats );
+    if ( MDAL::Progress::current().isCancelled() )
+      throw MDAL_Status::Err_Cancelled;
+    MDAL::updateStatistics( group );
   }
 }
 
+bool MDAL::DriverSelafin::canReadSignature( const MDAL::FileSignature &signature )
+{
+  // record with the title, see canReadMesh()
+  return signature.startsWith( std::string( "\0\0\0\x50", 4 ) );
+}
+
 bool MDAL::DriverSelafin::canReadMesh( const std::string &uri )
 {
   if ( !MDAL::fileExists( uri ) ) return false;
@@ -599,12 +759,13 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverSelafin::load( const std::string &meshFi
                 x,
                 y );
 
-    addData( var_names, data, nPoints, referenceTime );
+    addData( var_names, data, referenceTime );
   }
   catch ( MDAL_Status error )
   {
     if ( status ) *status = ( error );
     mMesh.reset();
   }
+  mReader.reset();
   return std::unique_ptr<Mesh>( mMesh.release() );
 }
@@ -9,6 +9,7 @@
 #include <string>
 #include <memory>
 #include <map>
+#include <vector>
 #include <iostream>
 #include <fstream>
 
@@ -34,6 +35,15 @@ namespace MDAL
       int read_int( );
       size_t read_sizet( );
 
+      //! Skips record of double array with len values, without reading the values
+      void ignore_double_arr( size_t len );
+      //! Reads count values from indexStart of the double array record starting at recordPosition
+      void read_double_arr( std::streampos recordPosition, size_t indexStart, size_t count, double *buffer );
+
+      //! Size of the stored real value in bytes, 4 for SERAFIN or 8 for SERAFIND
+      size_t valueSize() const;
+
+      std::streampos position();
       size_t remainingBytes();
     private:
       void ignore_array_length( );
@@ -48,6 +58,42 @@ namespace MDAL
       std::ifstream mIn;
   };
 
+  /**
+   * The SelafinDataset reads values of a single time step from the file on request
+   *
+   * Positions of the variable records are found when the file is loaded, vector
+   * datasets have separate records for the x and y components. The active flags of the faces
+   * are derived from the values of all vertices on the first request and kept as bits
+   */
+  class SelafinDataset: public Dataset2D
+  {
+    public:
+      SelafinDataset( DatasetGroup *parent, std::shared_ptr<SerafinStreamReader> reader );
+      ~SelafinDataset() override;
+
+      //! Sets position of the record with values of x component, or the scalar values
+      void setXRecordPosition( std::streampos position );
+      //! Sets position of the record with values of y component
+      void setYRecordPosition( std::streampos position );
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      size_t memoryUsage() const override;
+
+    private:
+      void readValues( std::streampos position, size_t indexStart, size_t count, double *buffer );
+
+      //! Faces with values on all their vertices, empty until the first request
+      bool readActive();
+
+      std::shared_ptr<SerafinStreamReader> mReader;
+      std::streampos mXRecordPosition = -1;
+      std::streampos mYRecordPosition = -1;
+      std::vector<bool> mActive;
+  };
+
   /**
    * Serafin format (also called Selafin)
    *
@@ -62,11 +108,12 @@ namespace MDAL
       ~DriverSelafin() override;
       DriverSelafin *create() override;
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadMesh( const std::string &uri ) override;
       std::unique_ptr< Mesh > load( const std::string &meshFile, MDAL_Status *status ) override;
 
     private:
-      typedef std::map<double, std::vector<double> > timestep_map; //TIME (sorted), nodeVal
+      typedef std::map<double, std::streampos > timestep_map; //TIME (sorted), position of values record
 
       void createMesh( double xOrigin,
                        double yOrigin,
@@ -78,7 +125,6 @@ namespace MDAL
                        std::vector<double> &y );
       void addData( const std::vector<std::string> &var_names,
                     const std::vector<timestep_map> &data,
-                    size_t nPoints,
                     const DateTime &referenceTime );
       void parseFile( std::vector<std::string> &var_names,
                       double *xOrigin,
@@ -96,7 +142,7 @@ namespace MDAL
 
       std::unique_ptr< MDAL::MemoryMesh > mMesh;
       std::string mFileName;
-      SerafinStreamReader mReader;
+      std::shared_ptr<SerafinStreamReader> mReader;
   };
 
 } // namespace MDAL
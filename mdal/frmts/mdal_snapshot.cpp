@@ -0,0 +1,800 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "mdal_snapshot.hpp"
+#include "mdal_utils.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_file_signature.hpp"
+#include "mdal_pipeline.hpp"
+
+#define DRIVER_NAME "MDALB"
+
+static const char SNAPSHOT_MAGIC[8] = { 'M', 'D', 'A', 'L', 'B', 'I', 'N', '\n' };
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+//! Text in the file
+struct SnapshotString
+{
+  uint64_t offset;
+  uint64_t length;
+};
+
+struct SnapshotHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint64_t verticesCount;
+  uint64_t facesCount;
+  uint64_t indicesCount;
+  uint64_t faceVerticesMaximumCount;
+  double minX;
+  double maxX;
+  double minY;
+  double maxY;
+  SnapshotString crs;
+  uint64_t xOffset;
+  uint64_t yOffset;
+  uint64_t zOffset;
+  uint64_t faceOffsetsOffset;
+  uint64_t vertexIndicesOffset;
+  uint64_t groupsCount;
+  uint64_t groupsOffset;
+};
+
+struct SnapshotGroup
+{
+  uint64_t metadataCount;
+  uint64_t metadataOffset; // SnapshotString[2 * metadataCount], key and value
+  uint32_t isScalar;
+  uint32_t dataLocation;
+  double minimum;
+  double maximum;
+  double referenceTime; // julian day, NaN when not set
+  uint64_t datasetsCount;
+  uint64_t datasetsOffset; // SnapshotDatasetRecord[datasetsCount]
+};
+
+struct SnapshotDatasetRecord
+{
+  double time; // hours
+  double minimum;
+  double maximum;
+  uint64_t valuesOffset;
+  uint64_t activeOffset; // 0 when the dataset has no active flags
+};
+
+static_assert( sizeof( SnapshotHeader ) == 152, "snapshot header must have no padding" );
+static_assert( sizeof( SnapshotGroup ) == 64, "snapshot group must have no padding" );
+static_assert( sizeof( SnapshotDatasetRecord ) == 40, "snapshot dataset must have no padding" );
+
+//! Returns pointer to the section of the file, nullptr when it is out of the file or not aligned
+static const char *_section( const MDAL::MappedFile &file, uint64_t offset, uint64_t count, size_t itemSize )
+{
+  if ( offset % 8 != 0 || offset > file.size() )
+    return nullptr;
+  if ( count > ( file.size() - offset ) / itemSize )
+    return nullptr;
+  return file.data() + offset;
+}
+
+//! Returns whether the offsets of the faces grow from 0 to the indices count, with faces not larger than the maximum and valid vertex indices
+static bool _validFaces( const SnapshotHeader &header, const uint64_t *faceOffsets, const uint32_t *vertexIndices )
+{
+  if ( faceOffsets[0] != 0 || faceOffsets[header.facesCount] != header.indicesCount )
+    return false;
+  for ( uint64_t f = 0; f < header.facesCount; ++f )
+  {
+    if ( faceOffsets[f + 1] < faceOffsets[f] ||
+         faceOffsets[f + 1] - faceOffsets[f] > header.faceVerticesMaximumCount ||
+         faceOffsets[f + 1] > header.indicesCount )
+      return false;
+  }
+  for ( uint64_t i = 0; i < header.indicesCount; ++i )
+  {
+    if ( vertexIndices[i] >= header.verticesCount )
+      return false;
+  }
+  return true;
+}
+
+static bool _readString( const MDAL::MappedFile &file, const SnapshotString &str, std::string &result )
+{
+  if ( str.offset > file.size() || str.length > file.size() - str.offset )
+    return false;
+  result.assign( file.data() + str.offset, static_cast<size_t>( str.length ) );
+  return true;
+}
+
+//! Writes sections aligned to 8 bytes
+class SnapshotWriter
+{
+  public:
+    explicit SnapshotWriter( std::ostream &stream )
+      : mStream( stream )
+    {}
+
+    bool isValid() const { return mStream.good(); }
+
+    //! Moves to the 8 byte boundary, returns offset of the next section
+    uint64_t align()
+    {
+      static const char zeros[8] = {};
+      const uint64_t padding = ( 8 - mOffset % 8 ) % 8;
+      write( zeros, padding );
+      return mOffset;
+    }
+
+    void write( const void *data, uint64_t size )
+    {
+      mStream.write( static_cast<const char *>( data ), static_cast<std::streamsize>( size ) );
+      mOffset += size;
+    }
+
+    uint64_t writeSection( const void *data, uint64_t size )
+    {
+      const uint64_t offset = align();
+      write( data, size );
+      return offset;
+    }
+
+    SnapshotString writeString( const std::string &str )
+    {
+      SnapshotString result;
+      result.length = str.size();
+      result.offset = writeSection( str.data(), str.size() );
+      return result;
+    }
+
+    //! Writes the header to the beginning of the stream
+    bool finish( const SnapshotHeader &header )
+    {
+      mStream.seekp( 0 );
+      mStream.write( reinterpret_cast<const char *>( &header ), sizeof( SnapshotHeader ) );
+      mStream.flush();
+      return !mStream.fail();
+    }
+
+  private:
+    std::ostream &mStream;
+    uint64_t mOffset = 0;
+};
+
+MDAL::SnapshotMesh::SnapshotMesh( const std::string &driverName,
+                                  size_t verticesCount,
+                                  size_t facesCount,
+                                  size_t faceVerticesMaximumCount,
+                                  MDAL::BBox extent,
+                                  const std::string &uri,
+                                  std::shared_ptr<MDAL::MappedFile> file,
+                                  const double *x,
+                                  const double *y,
+                                  const double *z,
+                                  const uint64_t *faceOffsets,
+                                  const uint32_t *vertexIndices )
+  : Mesh( driverName, verticesCount, facesCount, faceVerticesMaximumCount, extent, uri )
+  , mFile( file )
+  , mX( x )
+  , mY( y )
+  , mZ( z )
+  , mFaceOffsets( faceOffsets )
+  , mVertexIndices( vertexIndices )
+{
+}
+
+MDAL::SnapshotMesh::~SnapshotMesh() = default;
+
+std::unique_ptr<MDAL::MeshVertexIterator> MDAL::SnapshotMesh::readVertices()
+{
+  return std::unique_ptr<MDAL::MeshVertexIterator>( new SnapshotMeshVertexIterator( this ) );
+}
+
+std::unique_ptr<MDAL::MeshFaceIterator> MDAL::SnapshotMesh::readFaces()
+{
+  return std::unique_ptr<MDAL::MeshFaceIterator>( new SnapshotMeshFaceIterator( this ) );
+}
+
+size_t MDAL::SnapshotMesh::vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z )
+{
+  const size_t maxVertices = verticesCount();
+  if ( ( count < 1 ) || ( indexStart >= maxVertices ) )
+    return 0;
+
+  const size_t copyValues = std::min( maxVertices - indexStart, count );
+  if ( x )
+    memcpy( x, mX + indexStart, copyValues * sizeof( double ) );
+  if ( y )
+    memcpy( y, mY + indexStart, copyValues * sizeof( double ) );
+  if ( z )
+    memcpy( z, mZ + indexStart, copyValues * sizeof( double ) );
+  return copyValues;
+}
+
+MDAL::SnapshotMeshVertexIterator::SnapshotMeshVertexIterator( MDAL::SnapshotMesh *mesh )
+  : mMesh( mesh )
+{
+}
+
+MDAL::SnapshotMeshVertexIterator::~SnapshotMeshVertexIterator() = default;
+
+size_t MDAL::SnapshotMeshVertexIterator::next( size_t vertexCount, double *coordinates )
+{
+  assert( mMesh );
+  assert( coordinates );
+
+  const size_t maxVertices = mMesh->verticesCount();
+  if ( mLastVertexIndex >= maxVertices )
+    return 0;
+
+  const size_t count = std::min( vertexCount, maxVertices - mLastVertexIndex );
+  const size_t blockSize = 1024;
+  double x[blockSize], y[blockSize], z[blockSize];
+  for ( size_t start = 0; start < count; start += blockSize )
+  {
+    const size_t blockCount = mMesh->vertexCoordinates( mLastVertexIndex + start, std::min( blockSize, count - start ), x, y, z );
+    for ( size_t i = 0; i < blockCount; ++i )
+    {
+      coordinates[3 * ( start + i )] = x[i];
+      coordinates[3 * ( start + i ) + 1] = y[i];
+      coordinates[3 * ( start + i ) + 2] = z[i];
+    }
+  }
+
+  mLastVertexIndex += count;
+  return count;
+}
+
+MDAL::SnapshotMeshFaceIterator::SnapshotMeshFaceIterator( const MDAL::SnapshotMesh *mesh )
+  : mMesh( mesh )
+{
+}
+
+MDAL::SnapshotMeshFaceIterator::~SnapshotMeshFaceIterator() = default;
+
+size_t MDAL::SnapshotMeshFaceIterator::next( size_t faceOffsetsBufferLen,
+    int *faceOffsetsBuffer,
+    size_t vertexIndicesBufferLen,
+    int *vertexIndicesBuffer )
+{
+  assert( mMesh );
+  assert( faceOffsetsBuffer );
+  assert( vertexIndicesBuffer );
+
+  const size_t maxFaces = mMesh->facesCount();
+  const uint64_t *offsets = mMesh->faceOffsets();
+  const size_t firstVertexOffset = static_cast<size_t>( offsets[mLastFaceIndex] );
+  size_t vertexIndex = 0;
+  size_t faceIndex = 0;
+
+  while ( mLastFaceIndex + faceIndex < maxFaces && faceIndex < faceOffsetsBufferLen )
+  {
+    // offsets are relative to the first face returned in this batch
+    const size_t nextVertexIndex = static_cast<size_t>( offsets[mLastFaceIndex + faceIndex + 1] ) - firstVertexOffset;
+    if ( nextVertexIndex > vertexIndicesBufferLen )
+      break;
+
+    vertexIndex = nextVertexIndex;
+    faceOffsetsBuffer[faceIndex] = static_cast<int>( vertexIndex );
+    ++faceIndex;
+  }
+
+  const uint32_t *indices = mMesh->vertexIndices() + firstVertexOffset;
+  for ( size_t i = 0; i < vertexIndex; ++i )
+    vertexIndicesBuffer[i] = static_cast<int>( indices[i] );
+
+  mLastFaceIndex += faceIndex;
+  return faceIndex;
+}
+
+MDAL::SnapshotDataset::SnapshotDataset( MDAL::DatasetGroup *parent,
+                                        std::shared_ptr<MDAL::MappedFile> file,
+                                        const double *values,
+                                        const unsigned char *active )
+  : Dataset2D( parent )
+  , mFile( file )
+  , mValues( values )
+  , mActive( active )
+{
+  setSupportsActiveFlag( active != nullptr );
+}
+
+MDAL::SnapshotDataset::~SnapshotDataset() = default;
+
+size_t MDAL::SnapshotDataset::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() );
+  const size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  memcpy( buffer, mValues + indexStart, copyValues * sizeof( double ) );
+  return copyValues;
+}
+
+size_t MDAL::SnapshotDataset::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() );
+  const size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  memcpy( buffer, mValues + 2 * indexStart, 2 * copyValues * sizeof( double ) );
+  return copyValues;
+}
+
+size_t MDAL::SnapshotDataset::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  assert( supportsActiveFlag() );
+  const size_t nValues = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  MDAL::unpackBits( mActive, indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+size_t MDAL::SnapshotDataset::activeDataBits( size_t indexStart, size_t count, unsigned char *buffer )
+{
+  assert( supportsActiveFlag() );
+  const size_t nValues = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  MDAL::copyBits( mActive, nValues, indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+bool MDAL::SnapshotDataset::supportsConcurrentReads() const
+{
+  return true;
+}
+
+MDAL::DriverSnapshot::DriverSnapshot():
+  Driver( DRIVER_NAME,
+          "MDAL Binary Snapshot",
+          "*.mdalb",
+          Capability::ReadMesh | Capability::SaveMesh | Capability::SaveMeshToStream
+        )
+{
+}
+
+MDAL::DriverSnapshot::~DriverSnapshot() = default;
+
+MDAL::DriverSnapshot *MDAL::DriverSnapshot::create()
+{
+  return new DriverSnapshot();
+}
+
+int MDAL::DriverSnapshot::faceVerticesMaximumCount() const
+{
+  return std::numeric_limits<int>::max();
+}
+
+bool MDAL::DriverSnapshot::canReadSignature( const MDAL::FileSignature &signature )
+{
+  return signature.startsWith( std::string( SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) );
+}
+
+bool MDAL::DriverSnapshot::canReadMesh( const std::string &uri )
+{
+  if ( !MDAL::isNativeLittleEndian() )
+    return false;
+
+  std::ifstream in( uri, std::ifstream::in | std::ifstream::binary );
+  SnapshotHeader header;
+  if ( !in.read( reinterpret_cast<char *>( &header ), sizeof( SnapshotHeader ) ) )
+    return false;
+
+  return memcmp( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) == 0 &&
+         header.version == SNAPSHOT_VERSION;
+}
+
+std::unique_ptr<MDAL::Mesh> MDAL::DriverSnapshot::load( const std::string &uri, MDAL_Status *status )
+{
+  if ( status ) *status = MDAL_Status::None;
+
+  std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>( uri );
+  if ( !file->isValid() )
+  {
+    if ( status ) *status = MDAL_Status::Err_FileNotFound;
+    return std::unique_ptr<Mesh>();
+  }
+
+  SnapshotHeader header;
+  if ( !MDAL::isNativeLittleEndian() ||
+       file->size() < sizeof( SnapshotHeader ) ||
+       memcmp( file->data(), SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) != 0 )
+  {
+    if ( status ) *status = MDAL_Status::Err_UnknownFormat;
+    return std::unique_ptr<Mesh>();
+  }
+  memcpy( &header, file->data(), sizeof( SnapshotHeader ) );
+  if ( header.version != SNAPSHOT_VERSION || header.headerSize != sizeof( SnapshotHeader ) )
+  {
+    if ( status ) *status = MDAL_Status::Err_UnknownFormat;
+    return std::unique_ptr<Mesh>();
+  }
+
+  // counts larger than the file would overflow the sizes of the sections below
+  if ( header.verticesCount > file->size() || header.facesCount >= file->size() || header.indicesCount > file->size() ||
+       header.groupsCount > file->size() || header.verticesCount > std::numeric_limits<uint32_t>::max() )
+  {
+    if ( status ) *status = MDAL_Status::Err_InvalidData;
+    return std::unique_ptr<Mesh>();
+  }
+
+  const double *x = reinterpret_cast<const double *>( _section( *file, header.xOffset, header.verticesCount, sizeof( double ) ) );
+  const double *y = reinterpret_cast<const double *>( _section( *file, header.yOffset, header.verticesCount, sizeof( double ) ) );
+  const double *z = reinterpret_cast<const double *>( _section( *file, header.zOffset, header.verticesCount, sizeof( double ) ) );
+  const uint64_t *faceOffsets = reinterpret_cast<const uint64_t *>( _section( *file, header.faceOffsetsOffset, header.facesCount + 1, sizeof( uint64_t ) ) );
+  const uint32_t *vertexIndices = reinterpret_cast<const uint32_t *>( _section( *file, header.vertexIndicesOffset, header.indicesCount, sizeof( uint32_t ) ) );
+  const char *groups = _section( *file, header.groupsOffset, header.groupsCount, sizeof( SnapshotGroup ) );
+  // faces are used without copying, so they are validated once here rather than on each read
+  std::string crs;
+  if ( !x || !y || !z || !faceOffsets || !vertexIndices || !groups ||
+       !_validFaces( header, faceOffsets, vertexIndices ) ||
+       !_readString( *file, header.crs, crs ) )
+  {
+    if ( status ) *status = MDAL_Status::Err_InvalidData;
+    return std::unique_ptr<Mesh>();
+  }
+
+  std::unique_ptr<SnapshotMesh> mesh(
+    new SnapshotMesh(
+      name(),
+      static_cast<size_t>( header.verticesCount ),
+      static_cast<size_t>( header.facesCount ),
+      static_cast<size_t>( header.faceVerticesMaximumCount ),
+      BBox( header.minX, header.maxX, header.minY, header.maxY ),
+      uri,
+      file,
+      x, y, z,
+      faceOffsets,
+      vertexIndices
+    )
+  );
+  mesh->setSourceCrs( crs );
+
+  const size_t activeBytes = static_cast<size_t>( ( header.facesCount + 7 ) / 8 );
+  for ( uint64_t groupIndex = 0; groupIndex < header.groupsCount; ++groupIndex )
+  {
+    SnapshotGroup groupRecord;
+    memcpy( &groupRecord, groups + groupIndex * sizeof( SnapshotGroup ), sizeof( SnapshotGroup ) );
+
+    const char *metadata = groupRecord.metadataCount > file->size() ? nullptr :
+                           _section( *file, groupRecord.metadataOffset, 2 * groupRecord.metadataCount, sizeof( SnapshotString ) );
+    const char *datasets = _section( *file, groupRecord.datasetsOffset, groupRecord.datasetsCount, sizeof( SnapshotDatasetRecord ) );
+    const MDAL_DataLocation location = static_cast<MDAL_DataLocation>( groupRecord.dataLocation );
+    if ( !metadata || !datasets ||
+         ( location != MDAL_DataLocation::DataOnVertices2D && location != MDAL_DataLocation::DataOnFaces2D ) )
+    {
+      if ( status ) *status = MDAL_Status::Err_InvalidData;
+      return std::unique_ptr<Mesh>();
+    }
+
+    std::shared_ptr<DatasetGroup> group = std::make_shared<DatasetGroup>( name(), mesh.get(), uri );
+    for ( uint64_t i = 0; i < groupRecord.metadataCount; ++i )
+    {
+      SnapshotString strings[2];
+      memcpy( strings, metadata + i * sizeof( strings ), sizeof( strings ) );
+      std::string key, value;
+      if ( !_readString( *file, strings[0], key ) || !_readString( *file, strings[1], value ) )
+      {
+        if ( status ) *status = MDAL_Status::Err_InvalidData;
+        return std::unique_ptr<Mesh>();
+      }
+      group->metadata.push_back( std::make_pair( key, value ) );
+    }
+    group->setIsScalar( groupRecord.isScalar != 0 );
+    group->setDataLocation( location );
+    if ( !std::isnan( groupRecord.referenceTime ) )
+      group->setReferenceTime( DateTime( groupRecord.referenceTime, DateTime::JulianDay ) );
+
+    const size_t valuesCount = ( location == MDAL_DataLocation::DataOnVertices2D ? mesh->verticesCount() : mesh->facesCount() ) *
+                               ( group->isScalar() ? 1 : 2 );
+    for ( uint64_t i = 0; i < groupRecord.datasetsCount; ++i )
+    {
+      SnapshotDatasetRecord datasetRecord;
+      memcpy( &datasetRecord, datasets + i * sizeof( SnapshotDatasetRecord ), sizeof( SnapshotDatasetRecord ) );
+
+      const double *values = reinterpret_cast<const double *>( _section( *file, datasetRecord.valuesOffset, valuesCount, sizeof( double ) ) );
+      const unsigned char *active = nullptr;
+      if ( datasetRecord.activeOffset != 0 )
+        active = reinterpret_cast<const unsigned char *>( _section( *file, datasetRecord.activeOffset, activeBytes, 1 ) );
+      if ( !values || ( datasetRecord.activeOffset != 0 && !active ) )
+      {
+        if ( status ) *status = MDAL_Status::Err_InvalidData;
+        return std::unique_ptr<Mesh>();
+      }
+
+      std::shared_ptr<SnapshotDataset> dataset = std::make_shared<SnapshotDataset>( group.get(), file, values, active );
+      dataset->setTime( datasetRecord.time, RelativeTimestamp::hours );
+      Statistics stats;
+      stats.minimum = datasetRecord.minimum;
+      stats.maximum = datasetRecord.maximum;
+      dataset->setStatistics( stats );
+      group->datasets.push_back( dataset );
+    }
+
+    Statistics stats;
+    stats.minimum = groupRecord.minimum;
+    stats.maximum = groupRecord.maximum;
+    group->setStatistics( stats );
+    mesh->datasetGroups.push_back( group );
+  }
+
+  return std::unique_ptr<Mesh>( mesh.release() );
+}
+
+//! Writes values of the dataset on the location, returns offset of the section
+static uint64_t _writeValues( SnapshotWriter &writer, MDAL::Dataset *dataset, size_t count, bool isScalar )
+{
+  const size_t blockSize = 65536;
+  const size_t components = isScalar ? 1 : 2;
+  std::vector<double> buffer( components * std::min( count, blockSize ) );
+
+  const uint64_t offset = writer.align();
+  for ( size_t start = 0; start < count; start += blockSize )
+  {
+    const size_t blockCount = std::min( blockSize, count - start );
+    size_t read = isScalar ? dataset->scalarData( start, blockCount, buffer.data() ) :
+                  dataset->vectorData( start, blockCount, buffer.data() );
+    // missing values are stored as nodata
+    std::fill( buffer.begin() + static_cast<std::ptrdiff_t>( components * read ),
+               buffer.begin() + static_cast<std::ptrdiff_t>( components * blockCount ),
+               std::numeric_limits<double>::quiet_NaN() );
+    writer.write( buffer.data(), components * blockCount * sizeof( double ) );
+  }
+  return offset;
+}
+
+//! Writes active flags of the dataset packed to bits, returns offset of the section
+static uint64_t _writeActive( SnapshotWriter &writer, MDAL::Dataset *dataset, size_t facesCount )
+{
+  const size_t blockSize = 65536; // multiple of 8, so blocks end on whole bytes
+  std::vector<unsigned char> buffer( ( std::min( facesCount, blockSize ) + 7 ) / 8 );
+
+  const uint64_t offset = writer.align();
+  for ( size_t start = 0; start < facesCount; start += blockSize )
+  {
+    const size_t blockCount = std::min( blockSize, facesCount - start );
+    const size_t bytesCount = ( blockCount + 7 ) / 8;
+    if ( dataset->activeDataBits( start, blockCount, buffer.data() ) != blockCount )
+      std::fill( buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>( bytesCount ), 0xFF );
+    writer.write( buffer.data(), bytesCount );
+  }
+  return offset;
+}
+
+void MDAL::DriverSnapshot::save( const std::string &uri, MDAL::Mesh *mesh, MDAL_Status *status )
+{
+  if ( status ) *status = MDAL_Status::None;
+
+  if ( !MDAL::isNativeLittleEndian() )
+  {
+    if ( status ) *status = MDAL_Status::Err_MissingDriverCapability;
+    return;
+  }
+
+  // written to a temporary file first, so the existing file is kept when the write fails, and on POSIX systems
+  // the snapshot may be saved over the mapped file the mesh is read from
+  const std::string tmpUri = uri + ".tmp";
+  MDAL_Status streamStatus = MDAL_Status::None;
+  {
+    std::ofstream file( tmpUri, std::ofstream::out | std::ofstream::binary );
+    if ( !file.is_open() )
+    {
+      if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
+      return;
+    }
+    saveToStream( file, mesh, &streamStatus );
+    file.close();
+    if ( streamStatus == MDAL_Status::None && file.fail() )
+      streamStatus = MDAL_Status::Err_FailToWriteToDisk;
+  }
+
+  if ( streamStatus != MDAL_Status::None )
+  {
+    remove( tmpUri.c_str() );
+    if ( status ) *status = streamStatus;
+    return;
+  }
+
+#ifdef _WIN32
+  // rename does not replace existing file on Windows, the file is replaced in one step and kept on failure,
+  // which is the case of the file mapped by a mesh
+  const bool replaced = MoveFileExA( tmpUri.c_str(), uri.c_str(), MOVEFILE_REPLACE_EXISTING ) != 0;
+#else
+  const bool replaced = rename( tmpUri.c_str(), uri.c_str() ) == 0;
+#endif
+  if ( !replaced )
+  {
+    remove( tmpUri.c_str() );
+    if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
+  }
+}
+
+void MDAL::DriverSnapshot::saveToStream( std::ostream &stream, MDAL::Mesh *mesh, MDAL_Status *status )
+{
+  if ( status ) *status = MDAL_Status::None;
+
+  if ( !MDAL::isNativeLittleEndian() )
+  {
+    if ( status ) *status = MDAL_Status::Err_MissingDriverCapability;
+    return;
+  }
+
+  SnapshotWriter writer( stream );
+  if ( !writer.isValid() )
+  {
+    if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
+    return;
+  }
+
+  SnapshotHeader header;
+  memset( &header, 0, sizeof( SnapshotHeader ) );
+  memcpy( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) );
+  header.version = SNAPSHOT_VERSION;
+  header.headerSize = sizeof( SnapshotHeader );
+  header.verticesCount = mesh->verticesCount();
+  header.facesCount = mesh->facesCount();
+  header.faceVerticesMaximumCount = mesh->faceVerticesMaximumCount();
+  const BBox extent = mesh->extent();
+  header.minX = extent.minX;
+  header.maxX = extent.maxX;
+  header.minY = extent.minY;
+  header.maxY = extent.maxY;
+  writer.write( &header, sizeof( SnapshotHeader ) );
+
+  const size_t blockSize = 65536;
+
+  // vertices, coordinate by coordinate
+  const size_t verticesCount = mesh->verticesCount();
+  std::vector<double> coordinates( std::min( verticesCount, blockSize ) );
+  uint64_t *coordinateOffsets[3] = { &header.xOffset, &header.yOffset, &header.zOffset };
+  for ( int coordinate = 0; coordinate < 3; ++coordinate )
+  {
+    *coordinateOffsets[coordinate] = writer.align();
+    for ( size_t start = 0; start < verticesCount; start += blockSize )
+    {
+      const size_t blockCount = std::min( blockSize, verticesCount - start );
+      double *buffer = coordinates.data();
+      mesh->vertexCoordinates( start, blockCount,
+                               coordinate == 0 ? buffer : nullptr,
+                               coordinate == 1 ? buffer : nullptr,
+                               coordinate == 2 ? buffer : nullptr );
+      writer.write( buffer, blockCount * sizeof( double ) );
+    }
+  }
+
+  // faces, offsets in the first pass and vertex indices in the second one
+  const size_t facesCount = mesh->facesCount();
+  const size_t faceVerticesMax = std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) );
+  std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+  std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    std::unique_ptr<MeshFaceIterator> faceIterator = readFacesPipelined( mesh );
+    uint64_t indicesCount = 0;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> indices;
+
+    if ( pass == 0 )
+    {
+      header.faceOffsetsOffset = writer.align();
+      writer.write( &indicesCount, sizeof( uint64_t ) );
+    }
+    else
+    {
+      header.vertexIndicesOffset = writer.align();
+    }
+
+    size_t faceIndex = 0;
+    while ( faceIndex < facesCount )
+    {
+      const size_t facesRead = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                               vertexIndices.size(), vertexIndices.data() );
+      if ( facesRead == 0 )
+        break;
+
+      const size_t indicesRead = static_cast<size_t>( faceOffsets[facesRead - 1] );
+      if ( pass == 0 )
+      {
+        offsets.resize( facesRead );
+        for ( size_t i = 0; i < facesRead; ++i )
+          offsets[i] = indicesCount + static_cast<uint64_t>( faceOffsets[i] );
+        writer.write( offsets.data(), facesRead * sizeof( uint64_t ) );
+      }
+      else
+      {
+        indices.resize( indicesRead );
+        for ( size_t i = 0; i < indicesRead; ++i )
+          indices[i] = static_cast<uint32_t>( vertexIndices[i] );
+        writer.write( indices.data(), indicesRead * sizeof( uint32_t ) );
+      }
+      indicesCount += indicesRead;
+      faceIndex += facesRead;
+    }
+    header.indicesCount = indicesCount;
+  }
+
+  header.crs = writer.writeString( mesh->crs() );
+
+  // datasets of the groups, the tables are written after all their sections
+  std::vector<SnapshotGroup> groups;
+  for ( const std::shared_ptr<DatasetGroup> &group : mesh->datasetGroups )
+  {
+    const MDAL_DataLocation location = group->dataLocation();
+    if ( location != MDAL_DataLocation::DataOnVertices2D && location != MDAL_DataLocation::DataOnFaces2D )
+      continue;
+
+    SnapshotGroup groupRecord;
+    memset( &groupRecord, 0, sizeof( SnapshotGroup ) );
+    groupRecord.isScalar = group->isScalar() ? 1 : 0;
+    groupRecord.dataLocation = static_cast<uint32_t>( location );
+    const Statistics groupStats = group->statistics();
+    groupRecord.minimum = groupStats.minimum;
+    groupRecord.maximum = groupStats.maximum;
+    const DateTime referenceTime = group->referenceTime();
+    groupRecord.referenceTime = referenceTime.isValid() ? referenceTime.toJulianDay() : std::numeric_limits<double>::quiet_NaN();
+
+    std::vector<SnapshotString> metadata;
+    for ( const std::pair<std::string, std::string> &item : group->metadata )
+    {
+      metadata.push_back( writer.writeString( item.first ) );
+      metadata.push_back( writer.writeString( item.second ) );
+    }
+    groupRecord.metadataCount = group->metadata.size();
+    groupRecord.metadataOffset = writer.writeSection( metadata.data(), metadata.size() * sizeof( SnapshotString ) );
+
+    const size_t valuesCount = location == MDAL_DataLocation::DataOnVertices2D ? mesh->verticesCount() : mesh->facesCount();
+    std::vector<SnapshotDatasetRecord> datasets;
+    for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    {
+      SnapshotDatasetRecord datasetRecord;
+      memset( &datasetRecord, 0, sizeof( SnapshotDatasetRecord ) );
+      datasetRecord.time = dataset->time( RelativeTimestamp::hours );
+      const Statistics stats = dataset->statistics();
+      datasetRecord.minimum = stats.minimum;
+      datasetRecord.maximum = stats.maximum;
+      datasetRecord.valuesOffset = _writeValues( writer, dataset.get(), valuesCount, group->isScalar() );
+      if ( dataset->supportsActiveFlag() )
+        datasetRecord.activeOffset = _writeActive( writer, dataset.get(), facesCount );
+      datasets.push_back( datasetRecord );
+    }
+    groupRecord.datasetsCount = datasets.size();
+    groupRecord.datasetsOffset = writer.writeSection( datasets.data(), datasets.size() * sizeof( SnapshotDatasetRecord ) );
+    groups.push_back( groupRecord );
+  }
+  header.groupsCount = groups.size();
+  header.groupsOffset = writer.writeSection( groups.data(), groups.size() * sizeof( SnapshotGroup ) );
+
+  if ( !writer.finish( header ) )
+  {
+    if ( status ) *status = MDAL_Status::Err_FailToWriteToDisk;
+  }
+}
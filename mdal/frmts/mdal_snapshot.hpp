@@ -0,0 +1,153 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_SNAPSHOT_HPP
+#define MDAL_SNAPSHOT_HPP
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+#include "mdal_data_model.hpp"
+#include "mdal.h"
+#include "mdal_driver.hpp"
+#include "mdal_mapped_file.hpp"
+
+namespace MDAL
+{
+
+  /** *********************************************
+   *                   Structure of the file
+   ************************************************
+   * Native binary snapshot of the mesh and its datasets, used as a cache
+   * of models which are slow to parse from the original format
+   *
+   * All numbers are little-endian and every section starts on 8 byte boundary,
+   * so the loaded mesh and datasets are served directly from the memory-mapped file
+   *
+   * header (see SnapshotHeader in the source), "MDALBIN\n" magic, version,
+   * counts, extent and offsets of the sections:
+   *
+   * vertices      X, Y and Z coordinates, double[verticesCount] each
+   * faces         compressed rows: offsets uint64[facesCount + 1]
+   *               and vertex indices uint32[indicesCount]
+   * crs           text
+   * groups        table of groups, each group references its metadata (pairs of texts),
+   *               statistics, reference time and table of datasets
+   * datasets      time in hours, statistics, values double[valuesCount] (x, y pairs
+   *               for vectors) and active flags packed to bits, ( facesCount + 7 ) / 8 bytes
+   *               for datasets with active flag capability
+   *
+   * Only groups defined on vertices or faces are stored, groups on volumes are skipped
+   * The format is read and written on little-endian platforms only
+   */
+
+  class SnapshotMesh: public Mesh
+  {
+    public:
+      SnapshotMesh( const std::string &driverName,
+                    size_t verticesCount,
+                    size_t facesCount,
+                    size_t faceVerticesMaximumCount,
+                    BBox extent,
+                    const std::string &uri,
+                    std::shared_ptr<MappedFile> file,
+                    const double *x,
+                    const double *y,
+                    const double *z,
+                    const uint64_t *faceOffsets,
+                    const uint32_t *vertexIndices );
+      ~SnapshotMesh() override;
+
+      std::unique_ptr<MDAL::MeshVertexIterator> readVertices() override;
+      std::unique_ptr<MDAL::MeshFaceIterator> readFaces() override;
+
+      size_t vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z ) override;
+
+      const uint64_t *faceOffsets() const { return mFaceOffsets; }
+      const uint32_t *vertexIndices() const { return mVertexIndices; }
+
+    private:
+      std::shared_ptr<MappedFile> mFile;
+      const double *mX;
+      const double *mY;
+      const double *mZ;
+      const uint64_t *mFaceOffsets;
+      const uint32_t *mVertexIndices;
+  };
+
+  class SnapshotMeshVertexIterator: public MeshVertexIterator
+  {
+    public:
+      SnapshotMeshVertexIterator( SnapshotMesh *mesh );
+      ~SnapshotMeshVertexIterator() override;
+
+      size_t next( size_t vertexCount, double *coordinates ) override;
+
+    private:
+      SnapshotMesh *mMesh;
+      size_t mLastVertexIndex = 0;
+  };
+
+  class SnapshotMeshFaceIterator: public MeshFaceIterator
+  {
+    public:
+      SnapshotMeshFaceIterator( const SnapshotMesh *mesh );
+      ~SnapshotMeshFaceIterator() override;
+
+      size_t next( size_t faceOffsetsBufferLen,
+                   int *faceOffsetsBuffer,
+                   size_t vertexIndicesBufferLen,
+                   int *vertexIndicesBuffer ) override;
+
+    private:
+      const SnapshotMesh *mMesh;
+      size_t mLastFaceIndex = 0;
+  };
+
+  //! Dataset with values and active flags in the memory-mapped snapshot file
+  class SnapshotDataset: public Dataset2D
+  {
+    public:
+      //! active is nullptr for datasets without active flag capability
+      SnapshotDataset( DatasetGroup *parent,
+                       std::shared_ptr<MappedFile> file,
+                       const double *values,
+                       const unsigned char *active );
+      ~SnapshotDataset() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+      size_t activeDataBits( size_t indexStart, size_t count, unsigned char *buffer ) override;
+
+      //! Data are only copied from the mapped memory
+      bool supportsConcurrentReads() const override;
+
+    private:
+      std::shared_ptr<MappedFile> mFile;
+      const double *mValues;
+      const unsigned char *mActive;
+  };
+
+  class DriverSnapshot: public Driver
+  {
+    public:
+      DriverSnapshot();
+      ~DriverSnapshot() override;
+      DriverSnapshot *create() override;
+
+      int faceVerticesMaximumCount() const override;
+
+      static bool canReadSignature( const FileSignature &signature );
+      bool canReadMesh( const std::string &uri ) override;
+
+      std::unique_ptr< Mesh > load( const std::string &uri, MDAL_Status *status ) override;
+      void save( const std::string &uri, Mesh *mesh, MDAL_Status *status ) override;
+      void saveToStream( std::ostream &stream, Mesh *mesh, MDAL_Status *status ) override;
+  };
+
+} // namespace MDAL
+#endif //MDAL_SNAPSHOT_HPP
@@ -35,6 +35,13 @@ size_t MDAL::DriverSWW::getVertexCount( const NetCDFFile &ncFile ) const
 }
 
 
+bool MDAL::DriverSWW::canReadSignature( const MDAL::FileSignature &signature )
+{
+  // NetCDF4 files are HDF5 files
+  return signature.format() == MDAL::FileSignature::NetCDF ||
+         signature.format() == MDAL::FileSignature::Hdf5;
+}
+
 bool MDAL::DriverSWW::canReadMesh( const std::string &uri )
 {
   NetCDFFile ncFile;
@@ -305,7 +312,7 @@ std::shared_ptr<MDAL::DatasetGroup> MDAL::DriverSWW::readScalarGroup(
       {
         o->setScalarValue( i, valuesX[i] );
       }
-      o->setStatistics( MDAL::calculateStatistics( o ) );
+      MDAL::updateStatistics( o );
       mds->datasets.push_back( o );
     }
     else
@@ -315,7 +322,7 @@ std::shared_ptr<MDAL::DatasetGroup> MDAL::DriverSWW::readScalarGroup(
       {
         std::shared_ptr<MDAL::MemoryDataset2D> mto = std::make_shared<MDAL::MemoryDataset2D>( mds.get() );
         mto->setTime( static_cast<double>( times[t] ), RelativeTimestamp::seconds ); // Time is always in seconds
-        double *values = mto->values();
+        std::vector<double> values( nPoints );
 
         // fetching data for one timestep
         size_t start[2], count[2];
@@ -324,12 +331,13 @@ std::shared_ptr<MDAL::DatasetGroup> MDAL::DriverSWW::readScalarGroup(
         start[1] = 0;
         count[0] = 1;
         count[1] = nPoints;
-        nc_get_vars_double( ncFile.handle(), varxid, start, count, stride, values );
-        mto->setStatistics( MDAL::calculateStatistics( mto ) );
+        nc_get_vars_double( ncFile.handle(), varxid, start, count, stride, values.data() );
+        mto->setValues( values.data() );
+        MDAL::updateStatistics( mto );
         mds->datasets.push_back( mto );
       }
     }
-    mds->setStatistics( MDAL::calculateStatistics( mds ) );
+    MDAL::updateStatistics( mds );
   }
 
   return mds;
@@ -381,7 +389,7 @@ std::shared_ptr<MDAL::DatasetGroup> MDAL::DriverSWW::readVectorGroup(
       {
         o->setVectorValue( i, valuesX[i], valuesY[i] );
       }
-      o->setStatistics( MDAL::calculateStatistics( o ) );
+      MDAL::updateStatistics( o );
       mds->datasets.push_back( o );
     }
     else
@@ -408,11 +416,11 @@ std::shared_ptr<MDAL::DatasetGroup> MDAL::DriverSWW::readVectorGroup(
           mto->setVectorValue( i, static_cast<double>( valuesX[i] ),  static_cast<double>( valuesY[i] ) );
         }
 
-        mto->setStatistics( MDAL::calculateStatistics( mto ) );
+        MDAL::updateStatistics( mto );
         mds->datasets.push_back( mto );
       }
     }
-    mds->setStatistics( MDAL::calculateStatistics( mds ) );
+    MDAL::updateStatistics( mds );
   }
 
   return mds;
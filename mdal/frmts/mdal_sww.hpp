@@ -41,6 +41,7 @@ namespace MDAL
       DriverSWW *create() override;
 
       std::unique_ptr< Mesh > load( const std::string &resultsFile, MDAL_Status *status ) override;
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadMesh( const std::string &uri ) override;
 
     private:
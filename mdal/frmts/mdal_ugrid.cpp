@@ -5,6 +5,7 @@
 
 #include "mdal_ugrid.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_pipeline.hpp"
 
 #include <netcdf.h>
 #include <assert.h>
@@ -529,7 +530,7 @@ void MDAL::DriverUgrid::writeVariables( MDAL::Mesh *mesh )
   const size_t verticesCoordCount = bufferSize * 3;
 
   std::vector<double> verticesCoordinates( verticesCoordCount );
-  std::unique_ptr<MDAL::MeshVertexIterator> vertexIterator = mesh->readVertices();
+  std::unique_ptr<MDAL::MeshVertexIterator> vertexIterator = MDAL::readVerticesPipelined( mesh );
 
   {
     size_t vertexIndex = 0;
@@ -555,7 +556,7 @@ void MDAL::DriverUgrid::writeVariables( MDAL::Mesh *mesh )
   }
 
   // Write faces
-  std::unique_ptr<MDAL::MeshFaceIterator> faceIterator = mesh->readFaces();
+  std::unique_ptr<MDAL::MeshFaceIterator> faceIterator = MDAL::readFacesPipelined( mesh );
   const size_t faceVerticesMax = mesh->faceVerticesMaximumCount();
   const size_t facesCount = mesh->facesCount();
   const size_t faceOffsetsBufferLen = std::min( facesCount, maxBufferSize );
@@ -19,6 +19,7 @@
 #include "mdal_utils.hpp"
 #include "mdal_data_model.hpp"
 #include "mdal_xml.hpp"
+#include "mdal_simd.hpp"
 
 MDAL::XdmfDataset::XdmfDataset( MDAL::DatasetGroup *grp,
                                 const MDAL::HyperSlab &slab,
@@ -67,14 +68,12 @@ size_t MDAL::XdmfDataset::scalarData( size_t indexStart, size_t count, double *b
     return 0;
   size_t copyValues = std::min( nValues - indexStart, count );
 
+  // selection of single column or row, read directly to the buffer
   std::vector<hsize_t> off = offsets( indexStart );
   std::vector<hsize_t> counts = selections( copyValues );
-  std::vector<double> values = mHdf5DatasetValues.readArrayDouble( off, counts );
-  if ( values.empty() )
+  if ( !mHdf5DatasetValues.readArray( H5T_NATIVE_DOUBLE, off, counts, buffer ) )
     return 0;
 
-  const double *input = values.data();
-  memcpy( buffer, input, copyValues * sizeof( double ) );
   return copyValues;
 }
 
@@ -109,12 +108,76 @@ size_t MDAL::XdmfDataset::vectorData( size_t indexStart, size_t count, double *b
 // //////////////////////////////////////////////////////////////////////////////
 
 
+const size_t MDAL::XdmfSlabCache::MAX_ENTRIES = 8;
+
+MDAL::XdmfSlabCache::Values MDAL::XdmfSlabCache::values( XdmfDataset &dataset, size_t indexStart, size_t count )
+{
+  const hid_t datasetId = dataset.hdfDataset().id();
+  const HyperSlab &slab = dataset.hyperSlab();
+  ++mUseCounter;
+
+  for ( Entry &entry : mEntries )
+  {
+    if ( entry.datasetId == datasetId && entry.startX == slab.startX && entry.startY == slab.startY &&
+         entry.indexStart == indexStart && entry.count == count )
+    {
+      entry.lastUse = mUseCounter;
+      return entry.values;
+    }
+  }
+
+  // least recently used entry is replaced when the cache is full
+  Entry *entry = nullptr;
+  if ( mEntries.size() < MAX_ENTRIES )
+  {
+    mEntries.push_back( Entry() );
+    entry = &mEntries.back();
+  }
+  else
+  {
+    entry = &*std::min_element( mEntries.begin(), mEntries.end(), []( const Entry & e1, const Entry & e2 )
+    {
+      return e1.lastUse < e2.lastUse;
+    } );
+  }
+
+  // the storage is reused unless the values are still used by the caller
+  if ( !entry->values || entry->values.use_count() > 1 )
+    entry->values = std::make_shared<std::vector<double>>();
+  std::vector<double> &values = *entry->values;
+  values.resize( count );
+
+  entry->datasetId = datasetId;
+  entry->startX = slab.startX;
+  entry->startY = slab.startY;
+  entry->indexStart = indexStart;
+  entry->count = count;
+  entry->lastUse = mUseCounter;
+
+  const size_t valuesRead = dataset.scalarData( indexStart, count, values.data() );
+  values.resize( valuesRead );
+  if ( valuesRead == 0 )
+  {
+    // do not cache the failure
+    entry->datasetId = -1;
+    return Values();
+  }
+  return entry->values;
+}
+
+// //////////////////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////////////////
+
+
 MDAL::XdmfFunctionDataset::XdmfFunctionDataset(
   MDAL::DatasetGroup *grp,
   MDAL::XdmfFunctionDataset::FunctionType type,
-  const RelativeTimestamp &time )
+  const RelativeTimestamp &time,
+  std::shared_ptr<XdmfSlabCache> cache )
   : MDAL::Dataset2D( grp )
   , mType( type )
+  , mCache( cache )
   , mBaseReferenceGroup( "XDMF", grp->mesh(), grp->uri() )
 {
   setTime( time );
@@ -170,76 +233,61 @@ size_t MDAL::XdmfFunctionDataset::vectorData( size_t indexStart, size_t count, d
 
 size_t MDAL::XdmfFunctionDataset::subtractFunction( size_t indexStart, size_t count, double *buffer )
 {
-  std::vector<double> buf( 2 * count, std::numeric_limits<double>::quiet_NaN() );
-  size_t copyVals = extractRawData( indexStart, count, 2, buf );
-  for ( size_t j = 0; j < copyVals; ++j )
-  {
-    double x0 = buf[j];
-    double x1 = buf[count + j];
-    if ( !std::isnan( x0 ) && !std::isnan( x1 ) )
-      buffer[j] = x1 - x0;
-  }
+  XdmfSlabCache::Values values[2];
+  size_t copyVals = referenceValues( indexStart, count, 0, 2, values );
+  if ( copyVals == 0 )
+    return 0;
+
+  MDAL::subtract( values[1]->data(), values[0]->data(), copyVals, buffer );
   return copyVals;
 }
 
 size_t MDAL::XdmfFunctionDataset::flowFunction( size_t indexStart, size_t count, double *buffer )
 {
-  std::vector<double> buf( 4 * count, std::numeric_limits<double>::quiet_NaN() );
-  size_t copyVals = extractRawData( indexStart, count, 4, buf );
-  for ( size_t j = 0; j < copyVals; ++j )
-  {
-    double x0 = buf[1 * count + j];
-    double x1 = buf[1 * count + j];
-    double x2 = buf[2 * count + j];
-    double x3 = buf[3 * count + j];
-
-    if ( !std::isnan( x0 ) &&
-         !std::isnan( x1 ) &&
-         !std::isnan( x2 ) &&
-         !MDAL::equals( x2, x3 )
-       )
-    {
-      double diff = x2 - x3;
-      buffer[j] = sqrt( ( x0 / diff ) * ( x0 / diff ) + ( x1 / diff ) * ( x1 / diff ) );
-    }
-  }
+  if ( mReferenceDatasets.size() < 4 )
+    return 0;
+
+  // both components are read from $1 to keep the results of the previous versions
+  XdmfSlabCache::Values values[3];
+  size_t copyVals = referenceValues( indexStart, count, 1, 3, values );
+  if ( copyVals == 0 )
+    return 0;
+
+  MDAL::flowVelocity( values[0]->data(), values[0]->data(), values[1]->data(), values[2]->data(), copyVals, buffer );
   return copyVals;
 }
 
 size_t MDAL::XdmfFunctionDataset::joinFunction( size_t indexStart, size_t count, double *buffer )
 {
-  std::vector<double> buf( 2 * count, std::numeric_limits<double>::quiet_NaN() );
-  size_t copyVals = extractRawData( indexStart, count, 2, buf );
-  for ( size_t j = 0; j < copyVals; ++j )
-  {
-    double x = buf[j];
-    double y = buf[count + j];
-    if ( !std::isnan( x ) && !std::isnan( y ) )
-    {
-      buffer[2 * j] = x;
-      buffer[2 * j + 1] = y;
-    }
-  }
+  XdmfSlabCache::Values values[2];
+  size_t copyVals = referenceValues( indexStart, count, 0, 2, values );
+  if ( copyVals == 0 )
+    return 0;
+
+  MDAL::join( values[0]->data(), values[1]->data(), copyVals, buffer );
   return copyVals;
 }
 
-size_t MDAL::XdmfFunctionDataset::extractRawData( size_t indexStart, size_t count, size_t nDatasets, std::vector< double > &buf )
+size_t MDAL::XdmfFunctionDataset::referenceValues( size_t indexStart, size_t count, size_t firstDataset, size_t nDatasets,
+    XdmfSlabCache::Values *values )
 {
-  assert( buf.size() == nDatasets * count );
-
-  if ( mReferenceDatasets.size() < nDatasets )
-    return 0;
-
-  if ( !mReferenceDatasets[0]->group()->isScalar() )
+  if ( mReferenceDatasets.size() < firstDataset + nDatasets )
     return 0;
 
-  size_t ret = mReferenceDatasets[0]->scalarData( indexStart, count, buf.data() );
-  for ( size_t i = 1; i < nDatasets ; ++i )
+  size_t ret = 0;
+  for ( size_t i = 0; i < nDatasets ; ++i )
   {
-    if ( !mReferenceDatasets[i]->group()->isScalar() )
+    XdmfDataset *dataset = mReferenceDatasets[firstDataset + i].get();
+    if ( !dataset->group()->isScalar() )
+      return 0;
+
+    values[i] = mCache->values( *dataset, indexStart, count );
+    if ( !values[i] )
       return 0;
-    size_t ret1 = mReferenceDatasets[i]->scalarData( indexStart, count, buf.data() + count * i );
-    if ( ret != ret1 )
+
+    if ( i == 0 )
+      ret = values[i]->size();
+    else if ( values[i]->size() != ret )
       return 0;
   }
   return ret;
@@ -341,8 +389,11 @@ HdfDataset MDAL::DriverXdmf::parseHdf5Node( const XMLFile &xmfFile, xmlNodePtr n
     hdfFile = mHdfFiles[hdf5Name];
   }
 
-  HdfDataset hdfDataset( hdfFile->id(), hdf5Path );
-  return hdfDataset;
+  const std::string datasetKey = hdf5Name + ":" + hdf5Path;
+  auto it = mHdfDatasets.find( datasetKey );
+  if ( it == mHdfDatasets.end() )
+    it = mHdfDatasets.insert( std::make_pair( datasetKey, HdfDataset( hdfFile->id(), hdf5Path ) ) ).first;
+  return it->second;
 }
 
 void MDAL::DriverXdmf::hdf5NamePath( const std::string &dataItemPath, std::string &filePath, std::string &hdf5Path )
@@ -418,138 +469,163 @@ std::pair<HdfDataset, MDAL::HyperSlab> MDAL::DriverXdmf::parseXdmfDataset(
   }
 }
 
-MDAL::DatasetGroups MDAL::DriverXdmf::parseXdmfXml( )
+void MDAL::DriverXdmf::parseXdmfGrid( const XMLFile &xmfFile,
+                                      xmlNodePtr gridNod,
+                                      std::map< std::string, std::shared_ptr<MDAL::DatasetGroup> > &groups,
+                                      std::shared_ptr<XdmfSlabCache> slabCache )
 {
-  std::map< std::string, std::shared_ptr<MDAL::DatasetGroup> > groups;
-  size_t nTimesteps = 0;
-
-  XMLFile xmfFile;
-  xmfFile.openFile( mDatFile );
-
-  xmlNodePtr elem = xmfFile.getCheckRoot( "Xdmf" );
-  elem = xmfFile.getCheckChild( elem, "Domain" );
-  elem = xmfFile.getCheckChild( elem, "Grid" );
-
-  xmfFile.checkAttribute( elem, "GridType", "Collection", "Expecting Collection Grid Type" );
-  xmfFile.checkAttribute( elem, "CollectionType", "Temporal", "Expecting Temporal Collection Type" );
-
-  elem = xmfFile.getCheckChild( elem, "Grid" );
+  xmlNodePtr timeNod = xmfFile.getCheckChild( gridNod, "Time" );
+  RelativeTimestamp time( xmfFile.queryDoubleAttribute( timeNod, "Value" ), RelativeTimestamp::hours ); //units, supposed to be hours
+  xmlNodePtr scalarNod = xmfFile.getCheckChild( gridNod, "Attribute" );
 
-  for ( xmlNodePtr gridNod = elem;
-        gridNod != nullptr;
-        gridNod = xmfFile.getCheckSibling( gridNod, "Grid", false ) )
+  for ( ;
+        scalarNod != nullptr;
+        scalarNod = xmfFile.getCheckSibling( scalarNod, "Attribute", false ) )
   {
-    ++nTimesteps;
-    xmlNodePtr timeNod = xmfFile.getCheckChild( gridNod, "Time" );
-    RelativeTimestamp time( xmfFile.queryDoubleAttribute( timeNod, "Value" ), RelativeTimestamp::hours ); //units, supposed to be hours
-    xmlNodePtr scalarNod = xmfFile.getCheckChild( gridNod, "Attribute" );
+    xmfFile.checkAttribute( scalarNod, "Center", "Cell", "Only cell centered data is currently supported" );
+    if ( !xmfFile.checkAttribute( scalarNod, "AttributeType", "Scalar" ) &&
+         !xmfFile.checkAttribute( scalarNod, "AttributeType", "Vector" ) )
+    {
+      MDAL::debug( "Only scalar and vector data are currently supported" );
+      throw MDAL_Status::Err_UnknownFormat;
+    }
+    std::string groupName = xmfFile.attribute( scalarNod, "Name" );
+    if ( groupName.empty() )
+    {
+      MDAL::debug( "Group name cannot be empty" );
+      throw MDAL_Status::Err_UnknownFormat;
+    }
+
+    xmlNodePtr itemNod = xmfFile.getCheckChild( scalarNod, "DataItem" );
 
-    for ( ;
-          scalarNod != nullptr;
-          scalarNod = xmfFile.getCheckSibling( scalarNod, "Attribute", false ) )
+    if ( xmfFile.checkAttribute( itemNod, "ItemType", "Function" ) )
     {
-      xmfFile.checkAttribute( scalarNod, "Center", "Cell", "Only cell centered data is currently supported" );
-      if ( !xmfFile.checkAttribute( scalarNod, "AttributeType", "Scalar" ) &&
-           !xmfFile.checkAttribute( scalarNod, "AttributeType", "Vector" ) )
+      std::string function = xmfFile.attribute( itemNod, "Function" );
+      function = MDAL::replace( function, " ", "" );
+      XdmfFunctionDataset::FunctionType type;
+      bool reversed = false;
+      bool isScalar = true;
+      if ( function == "sqrt($0/($2-$3)*$0/($2-$3)+$1/($2-$3)*$1/($2-$3))" )
       {
-        MDAL::debug( "Only scalar and vector data are currently supported" );
-        throw MDAL_Status::Err_UnknownFormat;
+        type = XdmfFunctionDataset::Flow;
       }
-      std::string groupName = xmfFile.attribute( scalarNod, "Name" );
-      if ( groupName.empty() )
+      else if ( function == "$0-$1" )
       {
-        MDAL::debug( "Group name cannot be empty" );
-        throw MDAL_Status::Err_UnknownFormat;
+        reversed = true;
+        type = XdmfFunctionDataset::Subtract;
       }
-
-      xmlNodePtr itemNod = xmfFile.getCheckChild( scalarNod, "DataItem" );
-
-      if ( xmfFile.checkAttribute( itemNod, "ItemType", "Function" ) )
+      else if ( function == "$1-$0" )
       {
-        std::string function = xmfFile.attribute( itemNod, "Function" );
-        function = MDAL::replace( function, " ", "" );
-        XdmfFunctionDataset::FunctionType type;
-        bool reversed = false;
-        bool isScalar = true;
-        if ( function == "sqrt($0/($2-$3)*$0/($2-$3)+$1/($2-$3)*$1/($2-$3))" )
-        {
-          type = XdmfFunctionDataset::Flow;
-        }
-        else if ( function == "$0-$1" )
-        {
-          reversed = true;
-          type = XdmfFunctionDataset::Subtract;
-        }
-        else if ( function == "$1-$0" )
-        {
-          type = XdmfFunctionDataset::Subtract;
-        }
-        else if ( ( function == "JOIN($0,$1,0*$1)" ) || ( function == "JOIN($0,$1,0)" ) )
-        {
-          type = XdmfFunctionDataset::Join;
-          isScalar = false;
-        }
-
-        std::shared_ptr<MDAL::DatasetGroup> group = findGroup( groups, groupName, isScalar );
-        std::shared_ptr<MDAL::XdmfFunctionDataset> xdmfFunctionDataset = std::make_shared<MDAL::XdmfFunctionDataset>(
-              group.get(),
-              type,
-              time
-            );
+        type = XdmfFunctionDataset::Subtract;
+      }
+      else if ( ( function == "JOIN($0,$1,0*$1)" ) || ( function == "JOIN($0,$1,0)" ) )
+      {
+        type = XdmfFunctionDataset::Join;
+        isScalar = false;
+      }
 
-        xmlNodePtr dataNod = xmfFile.getCheckChild( itemNod, "DataItem" );
-        for ( ;
-              dataNod != nullptr;
-              dataNod = xmfFile.getCheckSibling( dataNod, "DataItem", false ) )
+      std::shared_ptr<MDAL::DatasetGroup> group = findGroup( groups, groupName, isScalar );
+      std::shared_ptr<MDAL::XdmfFunctionDataset> xdmfFunctionDataset = std::make_shared<MDAL::XdmfFunctionDataset>(
+            group.get(),
+            type,
+            time,
+            slabCache
+          );
+
+      xmlNodePtr dataNod = xmfFile.getCheckChild( itemNod, "DataItem" );
+      for ( ;
+            dataNod != nullptr;
+            dataNod = xmfFile.getCheckSibling( dataNod, "DataItem", false ) )
+      {
+        if (
+          xmfFile.checkAttribute( dataNod, "ItemType", "HyperSlab" ) ||
+          xmfFile.checkAttribute( dataNod, "Type", "HyperSlab" ) )
         {
-          if (
-            xmfFile.checkAttribute( dataNod, "ItemType", "HyperSlab" ) ||
-            xmfFile.checkAttribute( dataNod, "Type", "HyperSlab" ) )
-          {
-            std::pair<HdfDataset, HyperSlab> data = parseXdmfDataset( xmfFile, dataNod );
-            xdmfFunctionDataset->addReferenceDataset( data.second, data.first, time );
-          }
-          else
-          {
-            MDAL::debug( "Expecting HyperSlab Types under Function" );
-            throw MDAL_Status::Err_UnknownFormat;
-          }
+          std::pair<HdfDataset, HyperSlab> data = parseXdmfDataset( xmfFile, dataNod );
+          xdmfFunctionDataset->addReferenceDataset( data.second, data.first, time );
         }
-
-        if ( reversed )
+        else
         {
-          xdmfFunctionDataset->swap();
+          MDAL::debug( "Expecting HyperSlab Types under Function" );
+          throw MDAL_Status::Err_UnknownFormat;
         }
-
-        // This basically forces to load all data to calculate statistics!
-        const MDAL::Statistics stats = MDAL::calculateStatistics( xdmfFunctionDataset );
-        xdmfFunctionDataset->setStatistics( stats );
-        group->datasets.push_back( xdmfFunctionDataset );
-      }
-      else if (
-        xmfFile.checkAttribute( itemNod, "ItemType", "HyperSlab" ) ||
-        xmfFile.checkAttribute( itemNod, "Type", "HyperSlab" ) )
-      {
-        std::pair<HdfDataset, HyperSlab> data = parseXdmfDataset( xmfFile, itemNod );
-        std::shared_ptr<MDAL::DatasetGroup> group = findGroup( groups, groupName, data.second.isScalar );
-        std::shared_ptr<MDAL::XdmfDataset> xdmfDataset = std::make_shared<MDAL::XdmfDataset>(
-              group.get(),
-              data.second,
-              data.first,
-              time
-            );
-        // This basically forces to load all data to calculate statistics!
-        const MDAL::Statistics stats = MDAL::calculateStatistics( xdmfDataset );
-        xdmfDataset->setStatistics( stats );
-        group->datasets.push_back( xdmfDataset );
       }
-      else
+
+      if ( reversed )
       {
-        MDAL::debug( "Expecting Function or HyperSlab Type" );
-        throw MDAL_Status::Err_UnknownFormat;
+        xdmfFunctionDataset->swap();
       }
+
+      // This basically forces to load all data to calculate statistics!
+      const MDAL::Statistics stats = MDAL::calculateStatistics( xdmfFunctionDataset );
+      xdmfFunctionDataset->setStatistics( stats );
+      group->datasets.push_back( xdmfFunctionDataset );
+    }
+    else if (
+      xmfFile.checkAttribute( itemNod, "ItemType", "HyperSlab" ) ||
+      xmfFile.checkAttribute( itemNod, "Type", "HyperSlab" ) )
+    {
+      std::pair<HdfDataset, HyperSlab> data = parseXdmfDataset( xmfFile, itemNod );
+      std::shared_ptr<MDAL::DatasetGroup> group = findGroup( groups, groupName, data.second.isScalar );
+      std::shared_ptr<MDAL::XdmfDataset> xdmfDataset = std::make_shared<MDAL::XdmfDataset>(
+            group.get(),
+            data.second,
+            data.first,
+            time
+          );
+      // This basically forces to load all data to calculate statistics!
+      const MDAL::Statistics stats = MDAL::calculateStatistics( xdmfDataset );
+      xdmfDataset->setStatistics( stats );
+      group->datasets.push_back( xdmfDataset );
+    }
+    else
+    {
+      MDAL::debug( "Expecting Function or HyperSlab Type" );
+      throw MDAL_Status::Err_UnknownFormat;
     }
   }
+}
+
+MDAL::DatasetGroups MDAL::DriverXdmf::parseXdmfXml( )
+{
+  std::map< std::string, std::shared_ptr<MDAL::DatasetGroup> > groups;
+  size_t nTimesteps = 0;
+  std::shared_ptr<XdmfSlabCache> slabCache = std::make_shared<XdmfSlabCache>();
+
+  // the time step grids are expanded one by one, so the whole tree is never held in memory
+  XMLStreamFile xmfFile;
+  xmfFile.openFile( mDatFile );
+
+  if ( !xmfFile.nextElement( 0, "Xdmf" ) ||
+       !xmfFile.nextElement( 1, "Domain" ) ||
+       !xmfFile.nextElement( 2, "Grid" ) )
+  {
+    MDAL::debug( "Expecting Grid in Domain of Xdmf" );
+    throw MDAL_Status::Err_UnknownFormat;
+  }
+
+  if ( xmfFile.currentAttribute( "GridType" ) != "Collection" )
+  {
+    MDAL::debug( "Expecting Collection Grid Type" );
+    throw MDAL_Status::Err_UnknownFormat;
+  }
+  if ( xmfFile.currentAttribute( "CollectionType" ) != "Temporal" )
+  {
+    MDAL::debug( "Expecting Temporal Collection Type" );
+    throw MDAL_Status::Err_UnknownFormat;
+  }
+
+  while ( xmfFile.nextElement( 3, "Grid" ) )
+  {
+    ++nTimesteps;
+    parseXdmfGrid( xmfFile, xmfFile.expand(), groups, slabCache );
+  }
+
+  if ( nTimesteps == 0 )
+  {
+    MDAL::debug( "Temporal Collection does not have any Grid" );
+    throw MDAL_Status::Err_UnknownFormat;
+  }
 
   // check groups
   DatasetGroups ret;
@@ -617,20 +693,30 @@ MDAL::DriverXdmf *MDAL::DriverXdmf::create()
   return new DriverXdmf();
 }
 
+bool MDAL::DriverXdmf::canReadSignature( const MDAL::FileSignature &signature )
+{
+  if ( signature.format() != MDAL::FileSignature::Text )
+    return false;
+
+  // XML declaration or root element, optionally after UTF-8 BOM
+  const std::string &header = signature.header();
+  const size_t pos = header.find_first_not_of( " \t\r\n\xEF\xBB\xBF" );
+  return pos != std::string::npos && header[pos] == '<';
+}
+
 bool MDAL::DriverXdmf::canReadDatasets( const std::string &uri )
 {
-  XMLFile xmfFile;
+  // only the root element is read
+  XMLStreamFile xmfFile;
   try
   {
     xmfFile.openFile( uri );
-    xmlNodePtr root = xmfFile.getCheckRoot( "Xdmf" );
-    xmfFile.checkAttribute( root, "Version", "2.0", "Invalid version" );
+    return xmfFile.nextElement( 0, "Xdmf" ) && xmfFile.currentAttribute( "Version" ) == "2.0";
   }
   catch ( MDAL_Status )
   {
     return false;
   }
-  return true;
 }
 
 void MDAL::DriverXdmf::load( const std::string &datFile,
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <fstream>
 #include <utility>
+#include <map>
 
 #include "mdal_data_model.hpp"
 #include "mdal.h"
@@ -68,6 +69,9 @@ namespace MDAL
       size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
       size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
 
+      const HdfDataset &hdfDataset() const { return mHdf5DatasetValues; }
+      const HyperSlab &hyperSlab() const { return mHyperSlab; }
+
     private:
       std::vector<hsize_t> offsets( size_t indexStart );
       std::vector<hsize_t> selections( size_t copyValues );
@@ -76,6 +80,41 @@ namespace MDAL
       HyperSlab mHyperSlab;
   };
 
+  /**
+   * Last values read from the reference datasets of the XdmfFunctionDatasets
+   *
+   * Function datasets of one time step often share the inputs, e.g. the water depth
+   * is used by the flow velocity and also by other functions. The entries are keyed
+   * by the HDF5 dataset handle and the slab, so the driver shares the handles of
+   * the same HDF5 datasets. Storage of the evicted entries is reused.
+   *
+   * Not thread-safe, datasets read from files are read with libraryMutex() held
+   */
+  class XdmfSlabCache
+  {
+    public:
+      typedef std::shared_ptr<const std::vector<double>> Values;
+
+      //! Returns values of the scalar dataset from indexStart, at most count, nullptr on error
+      Values values( XdmfDataset &dataset, size_t indexStart, size_t count );
+
+    private:
+      struct Entry
+      {
+        hid_t datasetId = -1;
+        size_t startX = 0;
+        size_t startY = 0;
+        size_t indexStart = 0;
+        size_t count = 0;
+        size_t lastUse = 0;
+        std::shared_ptr<std::vector<double>> values;
+      };
+
+      static const size_t MAX_ENTRIES;
+      std::vector<Entry> mEntries;
+      size_t mUseCounter = 0;
+  };
+
   /**
    * The XdmfFunctionDataset is a function that
    * references two or three scalar XdmfDatasets
@@ -110,7 +149,8 @@ namespace MDAL
 
       XdmfFunctionDataset( DatasetGroup *grp,
                            FunctionType type,
-                           const RelativeTimestamp &time
+                           const RelativeTimestamp &time,
+                           std::shared_ptr<XdmfSlabCache> cache
                          );
       ~XdmfFunctionDataset() override;
 
@@ -126,10 +166,17 @@ namespace MDAL
       size_t subtractFunction( size_t indexStart, size_t count, double *buffer );
       size_t flowFunction( size_t indexStart, size_t count, double *buffer );
       size_t joinFunction( size_t indexStart, size_t count, double *buffer );
-      size_t extractRawData( size_t indexStart, size_t count, size_t nDatasets, std::vector<double> &buf );
+
+      /**
+       * Reads values of nDatasets reference datasets from firstDataset through the cache
+       * \returns number of values read by all of them, 0 on error
+       */
+      size_t referenceValues( size_t indexStart, size_t count, size_t firstDataset, size_t nDatasets,
+                              XdmfSlabCache::Values *values );
 
       const FunctionType mType;
       std::vector<std::shared_ptr<XdmfDataset>> mReferenceDatasets;
+      std::shared_ptr<XdmfSlabCache> mCache;
       /**
        * "fake" base group for reference datasets.
        * This group is not exposed to public API and
@@ -156,6 +203,7 @@ namespace MDAL
       ~DriverXdmf( ) override;
       DriverXdmf *create() override;
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadDatasets( const std::string &uri ) override;
       void load( const std::string &datFile, Mesh *mesh, MDAL_Status *status ) override;
 
@@ -182,6 +230,12 @@ namespace MDAL
       */
       DatasetGroups parseXdmfXml( );
 
+      //! Adds datasets of the Attribute tags of one time step Grid of the temporal collection to the groups
+      void parseXdmfGrid( const XMLFile &xmfFile,
+                          xmlNodePtr gridNod,
+                          std::map< std::string, std::shared_ptr<MDAL::DatasetGroup> > &groups,
+                          std::shared_ptr<XdmfSlabCache> slabCache );
+
       //! Finds a group with a name or creates a new group if does not exists
       std::shared_ptr<MDAL::DatasetGroup> findGroup( std::map< std::string, std::shared_ptr<MDAL::DatasetGroup> > &groups,
           const std::string &groupName,
@@ -224,6 +278,8 @@ namespace MDAL
       MDAL::Mesh *mMesh = nullptr;
       std::string mDatFile;
       std::map< std::string, std::shared_ptr<HdfFile> > mHdfFiles;
+      //! HDF5 datasets by file and path, the same datasets share the handle
+      std::map< std::string, HdfDataset > mHdfDatasets;
 
   };
 
@@ -71,6 +71,92 @@ size_t MDAL::XmdfDataset::vectorData( size_t indexStart, size_t count, double *b
   return count;
 }
 
+size_t MDAL::XmdfDataset::dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer )
+{
+  // datasets of the group are consecutive rows of the same array
+  std::vector<hsize_t> dims = dsValues().dims();
+  if ( dims.size() < 2 || timeIndex() + datasetCount > dims[0] || indexStart + count > dims[1] )
+    return 0;
+
+  std::vector<hsize_t> offsets = {timeIndex(), indexStart};
+  std::vector<hsize_t> counts = {datasetCount, count};
+  if ( !group()->isScalar() )
+  {
+    offsets.push_back( 0 );
+    counts.push_back( 2 );
+  }
+
+  std::vector<float> values = dsValues().readArray( offsets, counts );
+  const size_t valuesCount = group()->isScalar() ? datasetCount * count : 2 * datasetCount * count;
+  if ( values.size() != valuesCount )
+    return 0;
+
+  for ( size_t j = 0; j < valuesCount; ++j )
+  {
+    buffer[j] = double( values[j] );
+  }
+  return count;
+}
+
+size_t MDAL::XmdfDataset::dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer )
+{
+  if ( count == 0 )
+    return 0;
+
+  const bool vector = type == MDAL_DataType::VECTOR_2D_DOUBLE || type == MDAL_DataType::VECTOR_2D_FLOAT;
+  const bool scalar = type == MDAL_DataType::SCALAR_DOUBLE || type == MDAL_DataType::SCALAR_FLOAT;
+  if ( type == MDAL_DataType::ACTIVE_INTEGER )
+  {
+    std::vector<hsize_t> coordinates( 2 * count );
+    for ( size_t i = 0; i < count; ++i )
+    {
+      coordinates[2 * i] = timeIndex();
+      coordinates[2 * i + 1] = indices[i];
+    }
+    std::vector<uchar> active( count );
+    if ( !dsActive().readElements( H5T_NATIVE_UCHAR, coordinates, active.data() ) )
+      return 0;
+    int *output = static_cast<int *>( buffer );
+    for ( size_t i = 0; i < count; ++i )
+      output[i] = bool( active[i] );
+    return count;
+  }
+  if ( ( !scalar && !vector ) || vector == group()->isScalar() )
+    return Dataset2D::dataAtIndices( type, indices, count, buffer );
+
+  // vector values are stored as the last dimension of size 2
+  const size_t components = vector ? 2 : 1;
+  const size_t rank = vector ? 3 : 2;
+  std::vector<hsize_t> coordinates( rank * components * count );
+  hsize_t *coordinate = coordinates.data();
+  for ( size_t i = 0; i < count; ++i )
+  {
+    for ( size_t c = 0; c < components; ++c )
+    {
+      *coordinate++ = timeIndex();
+      *coordinate++ = indices[i];
+      if ( vector )
+        *coordinate++ = c;
+    }
+  }
+
+  const size_t valuesCount = components * count;
+  if ( type == MDAL_DataType::SCALAR_FLOAT || type == MDAL_DataType::VECTOR_2D_FLOAT )
+  {
+    if ( !dsValues().readElements( H5T_NATIVE_FLOAT, coordinates, static_cast<float *>( buffer ) ) )
+      return 0;
+    return count;
+  }
+
+  std::vector<float> values( valuesCount );
+  if ( !dsValues().readElements( H5T_NATIVE_FLOAT, coordinates, values.data() ) )
+    return 0;
+  double *output = static_cast<double *>( buffer );
+  for ( size_t j = 0; j < valuesCount; ++j )
+    output[j] = double( values[j] );
+  return count;
+}
+
 size_t MDAL::XmdfDataset::activeData( size_t indexStart, size_t count, int *buffer )
 {
   std::vector<hsize_t> offsets = {timeIndex(), indexStart};
@@ -99,6 +185,11 @@ MDAL::DriverXmdf *MDAL::DriverXmdf::create()
   return new DriverXmdf();
 }
 
+bool MDAL::DriverXmdf::canReadSignature( const MDAL::FileSignature &signature )
+{
+  return signature.format() == MDAL::FileSignature::Hdf5;
+}
+
 bool MDAL::DriverXmdf::canReadDatasets( const std::string &uri )
 {
   HdfFile file( uri, HdfFile::ReadOnly );
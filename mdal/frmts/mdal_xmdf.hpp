@@ -43,6 +43,10 @@ namespace MDAL
       size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
       size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
       size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+      //! Reads the time steps by single hyperslab
+      size_t dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer ) override;
+      //! Reads the values at the indices by single element selection
+      size_t dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer ) override;
 
       const HdfDataset &dsValues() const;
       const HdfDataset &dsActive() const;
@@ -82,6 +86,7 @@ namespace MDAL
       ~DriverXmdf( ) override = default;
       DriverXmdf *create() override;
 
+      static bool canReadSignature( const FileSignature &signature );
       bool canReadDatasets( const std::string &uri ) override;
       void load( const std::string &datFile, Mesh *mesh, MDAL_Status *status ) override;
 
@@ -211,3 +211,75 @@ std::string XMLFile::content( xmlNodePtr node ) const
 
   return ret;
 }
+
+XMLStreamFile::XMLStreamFile() = default;
+
+XMLStreamFile::~XMLStreamFile()
+{
+  if ( mReader )
+    xmlFreeTextReader( mReader );
+}
+
+void XMLStreamFile::openFile( const std::string &fileName )
+{
+  mFileName = fileName;
+  mReader = xmlReaderForFile( fileName.c_str(), nullptr, 0 );
+  if ( mReader == nullptr )
+  {
+    error( "XML Document not opened successfully " + fileName );
+  }
+}
+
+bool XMLStreamFile::nextElement( int depth, const std::string &name )
+{
+  assert( mReader );
+
+  // elements at the depth or deeper are left with their subtrees
+  int ret = mIsAtElement && xmlTextReaderDepth( mReader ) >= depth ? xmlTextReaderNext( mReader ) : xmlTextReaderRead( mReader );
+  mIsAtElement = false;
+  for ( ; ret == 1; )
+  {
+    const int nodeDepth = xmlTextReaderDepth( mReader );
+    const int nodeType = xmlTextReaderNodeType( mReader );
+    if ( nodeType == XML_READER_TYPE_ELEMENT || nodeType == XML_READER_TYPE_END_ELEMENT )
+    {
+      if ( nodeDepth < depth )
+        return false;
+
+      if ( nodeType == XML_READER_TYPE_ELEMENT && nodeDepth == depth && checkEqual( xmlTextReaderConstName( mReader ), name ) )
+      {
+        mIsAtElement = true;
+        return true;
+      }
+
+      if ( nodeType == XML_READER_TYPE_ELEMENT )
+      {
+        ret = xmlTextReaderNext( mReader );
+        continue;
+      }
+    }
+    ret = xmlTextReaderRead( mReader );
+  }
+
+  if ( ret < 0 )
+    error( "XML Document not parsed successfully " + mFileName );
+  return false;
+}
+
+std::string XMLStreamFile::currentAttribute( const std::string &name ) const
+{
+  assert( mReader && mIsAtElement );
+  XMLString value( xmlTextReaderGetAttribute( mReader, XMLString( name ).get() ) );
+  if ( !value.get() )
+    return std::string();
+  return toString( value.get() );
+}
+
+xmlNodePtr XMLStreamFile::expand()
+{
+  assert( mReader && mIsAtElement );
+  xmlNodePtr node = xmlTextReaderExpand( mReader );
+  if ( node == nullptr )
+    error( "XML element not parsed successfully " + mFileName );
+  return node;
+}
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 //! C++ Wrapper around libxml2 library
 class XMLFile
@@ -65,12 +66,47 @@ class XMLFile
     //! Converts xmlString to string.
     std::string toString( const xmlChar *xmlString ) const;
 
-  private:
+  protected:
     //! Throws an error
     [[ noreturn ]] void error( const std::string &str ) const;
 
-    xmlDocPtr mXmlDoc;
+    xmlDocPtr mXmlDoc = nullptr;
     std::string mFileName;
 };
 
+/**
+ * Streaming reader of XML files too large to hold the whole tree in memory
+ *
+ * The file is read node by node by libxml2 text reader, only the subtree of the current
+ * element is expanded on request and it is freed once the reader moves on.
+ * The element and attribute helpers of XMLFile work with the expanded nodes.
+ */
+class XMLStreamFile: public XMLFile
+{
+  public:
+    XMLStreamFile();
+    ~XMLStreamFile();
+
+    //! Opens the XML file for reading from its start
+    void openFile( const std::string &fileName );
+
+    /**
+     * Moves to the next element with the name at the depth (0 for the root element),
+     * the subtrees of the other elements are skipped
+     * \returns false when the parent element or the file ends first
+     */
+    bool nextElement( int depth, const std::string &name );
+
+    //! Gets attribute of the current element, empty string when it does not have it
+    std::string currentAttribute( const std::string &name ) const;
+
+    //! Expands the current element with its subtree, valid until the reader moves
+    xmlNodePtr expand();
+
+  private:
+    xmlTextReaderPtr mReader = nullptr;
+    //! Whether the reader is on an element returned by nextElement()
+    bool mIsAtElement = false;
+};
+
 #endif // MDAL_XML_HPP
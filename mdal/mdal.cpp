@@ -5,20 +5,49 @@
 
 #include <string>
 #include <stddef.h>
+#include <stdlib.h>
 #include <limits>
 #include <assert.h>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 #include "mdal.h"
 #include "mdal_driver_manager.hpp"
 #include "mdal_data_model.hpp"
+#include "mdal_memory_data_model.hpp"
+#include "mdal_mesh_cache.hpp"
+#include "mdal_background_load.hpp"
+#include "mdal_progress.hpp"
+#include "mdal_spatial_index.hpp"
+#include "mdal_block_cache.hpp"
+#include "mdal_handle_pool.hpp"
+#include "mdal_prefetch.hpp"
+#include "mdal_quantile_sketch.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_options.hpp"
+#include "mdal_output_buffer.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_perf.hpp"
+#include "mdal_volume_iterator.hpp"
+#include "mdal_averaging.hpp"
+#include "mdal_expression.hpp"
+#include "mdal_location_conversion.hpp"
+#include "mdal_temporal_aggregate.hpp"
+#include "mdal_time_interpolation.hpp"
+#include "mdal_level_of_detail.hpp"
+#include "mdal_render_buffers.hpp"
+#include "mdal_topology.hpp"
+#include "mdal_rasterize.hpp"
+#include "mdal_contours.hpp"
 
 #define NODATA std::numeric_limits<double>::quiet_NaN()
 
 static const char *EMPTY_STR = "";
 
-static MDAL_Status sLastStatus;
+// each thread has its own status, see MDAL_LastStatus()
+static thread_local MDAL_Status sLastStatus;
 
 const char *MDAL_Version()
 {
@@ -31,14 +60,219 @@ MDAL_Status MDAL_LastStatus()
 }
 
 // helper to return string data - without having to deal with memory too much.
-// returned pointer is valid only next call. also not thread-safe.
+// returned pointer is valid only next call from the same thread.
 const char *_return_str( const std::string &str )
 {
-  static std::string lastStr;
+  static thread_local std::string lastStr;
   lastStr = str;
   return lastStr.c_str();
 }
 
+void MDAL_SetOpenOption( const char *name, const char *value )
+{
+  if ( !name )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::setOpenOption( name, value ? value : "" );
+}
+
+const char *MDAL_OpenOption( const char *name )
+{
+  if ( !name )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return EMPTY_STR;
+  }
+
+  return _return_str( MDAL::openOption( name ) );
+}
+
+void MDAL_SetCacheSize( long long bytes )
+{
+  if ( bytes < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::BlockCache::instance().setMaximumSize( static_cast<size_t>( bytes ) );
+}
+
+long long MDAL_CacheSize()
+{
+  return static_cast<long long>( MDAL::BlockCache::instance().maximumSize() );
+}
+
+long long MDAL_CacheHits()
+{
+  return MDAL::BlockCache::instance().hits();
+}
+
+long long MDAL_CacheMisses()
+{
+  return MDAL::BlockCache::instance().misses();
+}
+
+void MDAL_SetFileHandlePoolSize( int count )
+{
+  if ( count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::HandlePool::instance().setMaximumIdle( static_cast<size_t>( count ) );
+}
+
+int MDAL_FileHandlePoolSize()
+{
+  return static_cast<int>( MDAL::HandlePool::instance().maximumIdle() );
+}
+
+void MDAL_SetFileHandleLimit( int count )
+{
+  if ( count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::HandlePool::instance().setMaximumOpen( static_cast<size_t>( count ) );
+}
+
+int MDAL_FileHandleLimit()
+{
+  return static_cast<int>( MDAL::HandlePool::instance().maximumOpen() );
+}
+
+long long MDAL_FileHandleOpens()
+{
+  return MDAL::HandlePool::instance().opens();
+}
+
+long long MDAL_FileHandleReuses()
+{
+  return MDAL::HandlePool::instance().reuses();
+}
+
+long long MDAL_FileHandleReopens()
+{
+  return MDAL::HandlePool::instance().reopens();
+}
+
+void MDAL_SetPrefetchCount( int count )
+{
+  if ( count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::Prefetcher::instance().setFollowingCount( static_cast<size_t>( count ) );
+}
+
+int MDAL_PrefetchCount()
+{
+  return static_cast<int>( MDAL::Prefetcher::instance().followingCount() );
+}
+
+void MDAL_SetThreadCount( int count )
+{
+  if ( count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  MDAL::setThreadCount( static_cast<size_t>( count ) );
+}
+
+int MDAL_ThreadCount()
+{
+  return static_cast<int>( MDAL::threadCount() );
+}
+
+void MDAL_SetMeshSharing( bool enabled )
+{
+  MDAL::MeshCache::instance().setEnabled( enabled );
+}
+
+bool MDAL_MeshSharing()
+{
+  return MDAL::MeshCache::instance().isEnabled();
+}
+
+void MDAL_SetGroupReadyCallback( MDAL_GroupReadyCallback callback, void *userData )
+{
+  if ( !callback )
+  {
+    MDAL::setGroupReadyCallback( std::function<void( MDAL::DatasetGroup * )>() );
+    return;
+  }
+
+  MDAL::setGroupReadyCallback( [callback, userData]( MDAL::DatasetGroup *group )
+  {
+    callback( static_cast<DatasetGroupH>( group ), userData );
+  } );
+}
+
+void MDAL_SetProgressCallback( MDAL_ProgressCallback callback, void *userData )
+{
+  if ( !callback )
+  {
+    MDAL::setProgressCallback( MDAL::ProgressCallback() );
+    return;
+  }
+
+  MDAL::setProgressCallback( [callback, userData]( double progress )
+  {
+    return callback( progress, userData );
+  } );
+}
+
+int MDAL_GetPerfCounters( const char **names, long long *values, int size )
+{
+#ifdef HAVE_PERF_COUNTERS
+  if ( size < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  return static_cast<int>( MDAL::Perf::instance().counters( names, values, static_cast<size_t>( size ) ) );
+#else
+  MDAL_UNUSED( names );
+  MDAL_UNUSED( values );
+  MDAL_UNUSED( size );
+  return 0;
+#endif
+}
+
+void MDAL_ResetPerfCounters()
+{
+  MDAL::Perf::instance().reset();
+}
+
+void MDAL_SetTracing( bool enabled )
+{
+  MDAL::Perf::instance().setTracing( enabled );
+}
+
+void MDAL_WriteTrace( const char *path )
+{
+  if ( !path )
+  {
+    sLastStatus = MDAL_Status::Err_FailToWriteToDisk;
+    return;
+  }
+
+  if ( !MDAL::Perf::instance().writeTrace( path ) )
+    sLastStatus = MDAL_Status::Err_FailToWriteToDisk;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// DRIVERS
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -106,6 +340,18 @@ bool MDAL_DR_saveMeshCapability( DriverH driver )
   return d->hasCapability( MDAL::Capability::SaveMesh );
 }
 
+bool MDAL_DR_saveMeshToBufferCapability( DriverH driver )
+{
+  if ( !driver )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriver;
+    return false;
+  }
+
+  MDAL::Driver *d = static_cast< MDAL::Driver * >( driver );
+  return d->hasCapability( MDAL::Capability::SaveMeshToStream );
+}
+
 const char *MDAL_DR_longName( DriverH driver )
 {
   if ( !driver )
@@ -154,7 +400,19 @@ MeshH MDAL_LoadMesh( const char *meshFile )
   }
 
   std::string filename( meshFile );
-  return static_cast< MeshH >( MDAL::DriverManager::instance().load( filename, &sLastStatus ).release() );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  MDAL::MeshCache &cache = MDAL::MeshCache::instance();
+  const std::string key = cache.key( filename );
+  if ( !key.empty() )
+  {
+    if ( MDAL::Mesh *shared = cache.acquire( key ) )
+      return static_cast< MeshH >( shared );
+  }
+
+  std::unique_ptr<MDAL::Mesh> mesh = MDAL::DriverManager::instance().load( filename, &sLastStatus );
+  if ( mesh && !key.empty() )
+    cache.insert( key, mesh.get() );
+  return static_cast< MeshH >( mesh.release() );
 }
 
 void MDAL_SaveMesh( MeshH mesh, const char *meshFile, const char *driver )
@@ -187,15 +445,84 @@ void MDAL_SaveMesh( MeshH mesh, const char *meshFile, const char *driver )
   }
 
   std::string filename( meshFile );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
   MDAL::DriverManager::instance().save( static_cast< MDAL::Mesh * >( mesh ), filename, driverName, &sLastStatus );
 }
 
+int64_t MDAL_SaveMeshToBuffer( MeshH mesh, const char *driver, void **buffer )
+{
+  if ( !buffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+  *buffer = nullptr;
+
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+
+  auto d = MDAL::DriverManager::instance().driver( driver ? driver : "" );
+  if ( !d )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriver;
+    return 0;
+  }
+
+  if ( !d->hasCapability( MDAL::Capability::SaveMeshToStream ) )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
+    return 0;
+  }
+
+  if ( d->faceVerticesMaximumCount() < MDAL_M_faceVerticesMaximumCount( mesh ) )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+
+  MDAL::OutputBuffer output;
+  std::ostream stream( &output );
+  MDAL_Status status = MDAL_Status::None;
+  {
+    std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+    MDAL::DriverManager::instance().saveToStream( static_cast< MDAL::Mesh * >( mesh ), stream, driver, &status );
+  }
+  // the memory buffer fails only when it cannot grow
+  if ( status == MDAL_Status::None && !stream )
+    status = MDAL_Status::Err_NotEnoughMemory;
+  if ( status != MDAL_Status::None )
+  {
+    sLastStatus = status;
+    return 0;
+  }
+
+  const int64_t size = static_cast<int64_t>( output.size() );
+  *buffer = output.release();
+  return size;
+}
+
+void MDAL_FreeBuffer( void *buffer )
+{
+  free( buffer );
+}
+
 
 void MDAL_CloseMesh( MeshH mesh )
 {
   if ( mesh )
   {
     MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+    if ( !MDAL::MeshCache::instance().release( m ) )
+      return;
+
+    // the background load takes the library lock for each group
+    m->stopBackgroundLoad();
+
+    // drivers may close the files in the destructors
+    std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
     delete m;
   }
 }
@@ -246,6 +573,18 @@ int MDAL_M_vertexCount( MeshH mesh )
   return len;
 }
 
+int64_t MDAL_M_vertexCount64( MeshH mesh )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast<int64_t>( m->verticesCount() );
+}
+
 int MDAL_M_faceCount( MeshH mesh )
 {
   if ( !mesh )
@@ -258,7 +597,7 @@ int MDAL_M_faceCount( MeshH mesh )
   return len;
 }
 
-int MDAL_M_faceVerticesMaximumCount( MeshH mesh )
+int64_t MDAL_M_faceCount64( MeshH mesh )
 {
   if ( !mesh )
   {
@@ -266,802 +605,2349 @@ int MDAL_M_faceVerticesMaximumCount( MeshH mesh )
     return 0;
   }
   MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  int len = static_cast<int>( m->faceVerticesMaximumCount() );
-  return len;
+  return static_cast<int64_t>( m->facesCount() );
 }
 
-void MDAL_M_LoadDatasets( MeshH mesh, const char *datasetFile )
+bool MDAL_M_isReordered( MeshH mesh )
 {
-  if ( !datasetFile )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_FileNotFound;
-    return;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return false;
   }
 
+  const MDAL::MemoryMesh *m = dynamic_cast< MDAL::MemoryMesh * >( static_cast< MDAL::Mesh * >( mesh ) );
+  return m && m->isReordered();
+}
+
+int MDAL_M_handleCount( MeshH mesh )
+{
   if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return;
+    return 0;
   }
 
-  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-
-  std::string filename( datasetFile );
-  MDAL::DriverManager::instance().loadDatasets( m, datasetFile, &sLastStatus );
+  return static_cast<int>( MDAL::MeshCache::instance().handleCount( static_cast< MDAL::Mesh * >( mesh ) ) );
 }
 
-int MDAL_M_datasetGroupCount( MeshH mesh )
+int64_t MDAL_M_memoryUsage( MeshH mesh )
 {
   if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  int len = static_cast<int>( m->datasetGroups.size() );
-  return len;
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  return static_cast<int64_t>( static_cast< MDAL::Mesh * >( mesh )->memoryUsage() );
 }
 
-DatasetGroupH MDAL_M_datasetGroup( MeshH mesh, int index )
+int MDAL_M_levelOfDetailCount( MeshH mesh )
 {
   if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return nullptr;
+    return 0;
   }
 
-  if ( index < 0 )
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  return static_cast<int>( static_cast< MDAL::Mesh * >( mesh )->levelsOfDetail().levelsCount() );
+}
+
+MeshH MDAL_M_levelOfDetail( MeshH mesh, int level )
+{
+  if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return nullptr;
   }
 
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
   MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  int len = static_cast<int>( m->datasetGroups.size() );
-  if ( len <= index )
+  MDAL::MeshPyramid &pyramid = m->levelsOfDetail();
+  if ( level < 0 || static_cast<size_t>( level ) >= pyramid.levelsCount() )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    sLastStatus = MDAL_Status::Err_InvalidData;
     return nullptr;
   }
-  size_t i = static_cast<size_t>( index );
-  return static_cast< DatasetH >( m->datasetGroups[i].get() );
+
+  if ( level == 0 )
+    return mesh;
+  return static_cast< MeshH >( pyramid.level( static_cast<size_t>( level ) ).mesh.get() );
 }
 
-DatasetGroupH MDAL_M_addDatasetGroup(
-  MeshH mesh,
-  const char *name,
-  MDAL_DataLocation dataLocation,
-  bool hasScalarData,
-  DriverH driver,
-  const char *datasetGroupFile )
+double MDAL_M_levelOfDetailResolution( MeshH mesh, int level )
 {
   if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return nullptr;
+    return -1;
   }
 
-  if ( !name )
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  MDAL::MeshPyramid &pyramid = static_cast< MDAL::Mesh * >( mesh )->levelsOfDetail();
+  if ( level < 0 || static_cast<size_t>( level ) >= pyramid.levelsCount() )
   {
     sLastStatus = MDAL_Status::Err_InvalidData;
-    return nullptr;
+    return -1;
   }
+  return pyramid.resolution( static_cast<size_t>( level ) );
+}
 
-  if ( !datasetGroupFile )
+int MDAL_M_levelOfDetailAtResolution( MeshH mesh, double resolution )
+{
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_InvalidData;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return -1;
   }
 
-  if ( !driver )
+  if ( std::isnan( resolution ) )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriver;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return -1;
   }
 
-  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  MDAL::Driver *dr = static_cast< MDAL::Driver * >( driver );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  return static_cast<int>( static_cast< MDAL::Mesh * >( mesh )->levelsOfDetail().levelAtResolution( resolution ) );
+}
 
-  if ( !dr->hasWriteDatasetCapability( dataLocation ) )
-  {
-    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
-    return nullptr;
-  }
+/**
+ * Whether the mesh may be edited, false when it is shared by other handles
+ * Called with the library lock held, so no handle is added before the edit, see _detachEdited()
+ */
+static bool _canEdit( MDAL::Mesh *mesh )
+{
+  if ( MDAL::MeshCache::instance().handleCount( mesh ) <= 1 )
+    return true;
 
-  const size_t index = m->datasetGroups.size();
-  dr->createDatasetGroup( m,
-                          name,
-                          dataLocation,
-                          hasScalarData,
-                          datasetGroupFile
-                        );
-  if ( index < m->datasetGroups.size() ) // we have new dataset group
-    return static_cast< DatasetGroupH >( m->datasetGroups[ index ].get() );
-  else
-    return nullptr;
+  sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+  return false;
 }
 
-const char *MDAL_M_driverName( MeshH mesh )
+//! Detaches the edited mesh from the shared meshes, so following loads read the file again. Called after a successful edit only
+static void _detachEdited( MDAL::Mesh *mesh )
 {
-  if ( !mesh )
-  {
-    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return nullptr;
-  }
-
-  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  return _return_str( m->driverName() );
+  MDAL::MeshCache::instance().detach( mesh );
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-/// MESH VERTICES
-///////////////////////////////////////////////////////////////////////////////////////
+//! Returns handle of the group added to the mesh, the mesh is detached when the group was added
+static DatasetGroupH _addedGroup( MDAL::Mesh *mesh, MDAL::DatasetGroup *group )
+{
+  if ( group )
+    _detachEdited( mesh );
+  return static_cast< DatasetGroupH >( group );
+}
 
-MeshVertexIteratorH MDAL_M_vertexIterator( MeshH mesh )
+//! Number of the dataset groups and their datasets of the mesh, to tell whether a load added any
+static size_t _datasetsCount( const MDAL::Mesh *mesh )
 {
-  if ( !mesh )
-  {
-    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return nullptr;
-  }
-  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  std::unique_ptr<MDAL::MeshVertexIterator> it = m->readVertices();
-  return static_cast< MeshVertexIteratorH >( it.release() );
+  size_t count = mesh->datasetGroups.size();
+  for ( const std::shared_ptr<MDAL::DatasetGroup> &group : mesh->datasetGroups )
+    count += group->datasets.size();
+  return count;
 }
 
-int MDAL_VI_next( MeshVertexIteratorH iterator, int verticesCount, double *coordinates )
+static int _originalIndices( MeshH mesh, int indexStart, int count, int *buffer, bool vertices )
 {
-  if ( !iterator )
+  if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
-  size_t size = static_cast<size_t>( verticesCount );
-  if ( size == 0 )
+
+  if ( indexStart < 0 || count < 0 || !buffer )
   {
+    sLastStatus = MDAL_Status::Err_InvalidData;
     return 0;
   }
-  size_t ret = it->next( size, coordinates );
-  return static_cast<int>( ret );
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  const size_t elementsCount = vertices ? m->verticesCount() : m->facesCount();
+  const size_t start = static_cast<size_t>( indexStart );
+  if ( start >= elementsCount )
+    return 0;
+
+  const size_t copyCount = std::min( elementsCount - start, static_cast<size_t>( count ) );
+  const MDAL::MemoryMesh *memoryMesh = dynamic_cast< MDAL::MemoryMesh * >( m );
+  const MDAL::SpillVector<size_t> *order = nullptr;
+  if ( memoryMesh && memoryMesh->isReordered() )
+    order = vertices ? &memoryMesh->vertexOrder : &memoryMesh->faceOrder;
+
+  for ( size_t i = 0; i < copyCount; ++i )
+    buffer[i] = static_cast<int>( order ? ( *order )[start + i] : start + i );
+  return static_cast<int>( copyCount );
 }
 
-void MDAL_VI_close( MeshVertexIteratorH iterator )
+int MDAL_M_originalVertexIndices( MeshH mesh, int indexStart, int count, int *buffer )
 {
-  if ( iterator )
-  {
-    MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
-    delete it;
-  }
+  return _originalIndices( mesh, indexStart, count, buffer, true );
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-/// MESH FACES
-///////////////////////////////////////////////////////////////////////////////////////
+int MDAL_M_originalFaceIndices( MeshH mesh, int indexStart, int count, int *buffer )
+{
+  return _originalIndices( mesh, indexStart, count, buffer, false );
+}
 
-MeshFaceIteratorH MDAL_M_faceIterator( MeshH mesh )
+int MDAL_M_faceVerticesMaximumCount( MeshH mesh )
 {
   if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
-    return nullptr;
+    return 0;
   }
   MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
-  std::unique_ptr<MDAL::MeshFaceIterator > it = m->readFaces();
-  return static_cast< MeshFaceIteratorH >( it.release() );
+  int len = static_cast<int>( m->faceVerticesMaximumCount() );
+  return len;
 }
 
-int MDAL_FI_next( MeshFaceIteratorH iterator,
-                  int faceOffsetsBufferLen,
-                  int *faceOffsetsBuffer,
-                  int vertexIndicesBufferLen,
-                  int *vertexIndicesBuffer )
+int MDAL_M_uniformFaceVerticesCount( MeshH mesh )
 {
-  if ( !iterator )
+  if ( !mesh )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
-  size_t ret = it->next( static_cast<size_t>( faceOffsetsBufferLen ),
-                         faceOffsetsBuffer,
-                         static_cast<size_t>( vertexIndicesBufferLen ),
-                         vertexIndicesBuffer );
-  return static_cast<int>( ret );
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast<int>( m->uniformFaceVerticesCount() );
 }
 
-
-void MDAL_FI_close( MeshFaceIteratorH iterator )
+void MDAL_M_LoadDatasets( MeshH mesh, const char *datasetFile )
 {
-  if ( iterator )
+  if ( !datasetFile )
   {
-    MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
-    delete it;
+    sLastStatus = MDAL_Status::Err_FileNotFound;
+    return;
   }
-}
 
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return;
+  }
 
-///////////////////////////////////////////////////////////////////////////////////////
-/// DATASET GROUPS
-///////////////////////////////////////////////////////////////////////////////////////
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::string filename( datasetFile );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( m ) )
+    return;
 
-MeshH MDAL_G_mesh( DatasetGroupH group )
+  const size_t datasetsCount = _datasetsCount( m );
+  MDAL::DriverManager::instance().loadDatasets( m, datasetFile, &sLastStatus );
+  if ( _datasetsCount( m ) != datasetsCount )
+    _detachEdited( m );
+}
+
+void MDAL_M_LoadDatasetsBatch( MeshH mesh, int count, const char **datasetFiles )
 {
-  if ( !group )
+  if ( count < 0 || ( count > 0 && !datasetFiles ) )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_FileNotFound;
+    return;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  MDAL::Mesh *m = g->mesh();
-  return static_cast< MeshH >( m );
+
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return;
+  }
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+
+  // missing names are reported as missing files
+  std::vector<std::string> filenames;
+  for ( int i = 0; i < count; ++i )
+    filenames.push_back( datasetFiles[i] ? datasetFiles[i] : std::string() );
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( m ) )
+    return;
+
+  const size_t datasetsCount = _datasetsCount( m );
+  MDAL::DriverManager::instance().loadDatasets( m, filenames, &sLastStatus );
+  if ( _datasetsCount( m ) != datasetsCount )
+    _detachEdited( m );
 }
 
-int MDAL_G_datasetCount( DatasetGroupH group )
+int MDAL_M_datasetGroupCount( MeshH mesh )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->datasets.size() );
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  int len = static_cast<int>( m->datasetGroups.size() );
   return len;
 }
 
-DatasetH MDAL_G_dataset( DatasetGroupH group, int index )
+DatasetGroupH MDAL_M_datasetGroup( MeshH mesh, int index )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return nullptr;
   }
 
   if ( index < 0 )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return nullptr;
   }
 
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->datasets.size() );
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  int len = static_cast<int>( m->datasetGroups.size() );
   if ( len <= index )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return nullptr;
   }
   size_t i = static_cast<size_t>( index );
-  return static_cast< DatasetH >( g->datasets[i].get() );
+  return static_cast< DatasetH >( m->datasetGroups[i].get() );
 }
 
-int MDAL_G_metadataCount( DatasetGroupH group )
+DatasetGroupH MDAL_M_addDatasetGroup(
+  MeshH mesh,
+  const char *name,
+  MDAL_DataLocation dataLocation,
+  bool hasScalarData,
+  DriverH driver,
+  const char *datasetGroupFile )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return 0;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->metadata.size() );
-  return len;
-}
 
-const char *MDAL_G_metadataKey( DatasetGroupH group, int index )
-{
-  if ( !group )
+  if ( !name )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->metadata.size() );
-  if ( len <= index )
+
+  if ( !datasetGroupFile )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
   }
-  size_t i = static_cast<size_t>( index );
-  return _return_str( g->metadata[i].first );
-}
 
-const char *MDAL_G_metadataValue( DatasetGroupH group, int index )
-{
-  if ( !group )
+  if ( !driver )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    sLastStatus = MDAL_Status::Err_MissingDriver;
+    return nullptr;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->metadata.size() );
-  if ( len <= index )
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  MDAL::Driver *dr = static_cast< MDAL::Driver * >( driver );
+
+  if ( !dr->hasWriteDatasetCapability( dataLocation ) )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
+    return nullptr;
   }
-  size_t i = static_cast<size_t>( index );
-  return _return_str( g->metadata[i].second );
-}
 
-const char *MDAL_G_name( DatasetGroupH group )
-{
-  if ( !group )
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( m ) )
+    return nullptr;
+
+  const size_t index = m->datasetGroups.size();
+  dr->createDatasetGroup( m,
+                          name,
+                          dataLocation,
+                          hasScalarData,
+                          datasetGroupFile
+                        );
+  if ( index < m->datasetGroups.size() ) // we have new dataset group
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    _detachEdited( m );
+    return static_cast< DatasetGroupH >( m->datasetGroups[ index ].get() );
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return _return_str( g->name() );
+  else
+    return nullptr;
 }
 
-bool MDAL_G_hasScalarData( DatasetGroupH group )
+const char *MDAL_M_driverName( MeshH mesh )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return true;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return g->isScalar();
-}
 
-MDAL_DataLocation MDAL_G_dataLocation( DatasetGroupH group )
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return _return_str( m->driverName() );
+}
+
+int MDAL_M_sampleTimeSeries( MeshH mesh, DatasetGroupH group, double x, double y, double *buffer )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return DataInvalidLocation;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return g->dataLocation();
-}
 
-int MDAL_G_maximumVerticalLevelCount( DatasetGroupH group )
-{
   if ( !group )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
     return 0;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  int len = static_cast<int>( g->maximumVerticalLevelsCount() );
-  return len;
-}
 
-void MDAL_G_minimumMaximum( DatasetGroupH group, double *min, double *max )
-{
-  if ( !min || !max )
+  if ( !buffer )
   {
     sLastStatus = MDAL_Status::Err_InvalidData;
-    return;
+    return 0;
   }
 
-  if ( !group )
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  if ( !MDAL::supportsPointSampling( *m ) )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    *min = NODATA;
-    *max = NODATA;
-    return;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
 
   MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  MDAL::Statistics stats = g->statistics();
-  *min = stats.minimum;
-  *max = stats.maximum;
-}
-
-DatasetH MDAL_G_addDataset( DatasetGroupH group, double time, const double *values, const int *active )
-{
-  if ( !group )
+  if ( g->mesh() != m )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return nullptr;
+    return 0;
   }
 
-  if ( !values )
+  size_t sampledCount = MDAL::sampleTimeSeries( *m, *g, x, y, buffer );
+  if ( sampledCount == 0 )
   {
-    sLastStatus = MDAL_Status::Err_InvalidData;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
   }
 
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  if ( !g->isInEditMode() )
+  return static_cast<int>( sampledCount );
+}
+
+int MDAL_M_sampleTimeSeriesAtPoints( MeshH mesh, DatasetGroupH group, int pointCount, const double *x, const double *y, double *buffer )
+{
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
 
-  const std::string driverName = g->driverName();
-  std::shared_ptr<MDAL::Driver> dr = MDAL::DriverManager::instance().driver( driverName );
-  if ( !dr )
+  if ( !group )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriver;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
   }
 
-  if ( !dr->hasWriteDatasetCapability( g->dataLocation() ) )
+  if ( pointCount < 0 || ( pointCount > 0 && ( !x || !y || !buffer ) ) )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
   }
 
-  if ( g->dataLocation() == MDAL_DataLocation::DataOnVolumes3D )
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  if ( !MDAL::supportsPointSampling( *m ) )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
-    return nullptr;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
 
-  if ( active && g->dataLocation() != MDAL_DataLocation::DataOnVertices2D )
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( g->mesh() != m )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return nullptr;
+    return 0;
   }
 
-  const size_t index = g->datasets.size();
-  MDAL::RelativeTimestamp t( time, MDAL::RelativeTimestamp::hours );
-  dr->createDataset( g,
-                     t,
-                     values,
-                     active
-                   );
-  if ( index < g->datasets.size() ) // we have new dataset
-    return static_cast< DatasetGroupH >( g->datasets[ index ].get() );
-  else
-    return nullptr;
-}
-
-bool MDAL_G_isInEditMode( DatasetGroupH group )
-{
-  if ( !group )
+  size_t sampledCount = MDAL::sampleTimeSeries( *m, *g, static_cast<size_t>( pointCount ), x, y, buffer );
+  if ( sampledCount == 0 )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return true;
+    return 0;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return g->isInEditMode();
+
+  return static_cast<int>( sampledCount );
 }
 
-void MDAL_G_closeEditMode( DatasetGroupH group )
+int MDAL_G_timeSeriesAtIndices( DatasetGroupH group, int count, const int *indices, double *buffer )
 {
   if ( !group )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return;
+    return 0;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
 
-  if ( !g->isInEditMode() )
+  if ( count < 0 || ( count > 0 && ( !indices || !buffer ) ) )
   {
-    return;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
   }
 
-  g->setStatistics( MDAL::calculateStatistics( g ) );
-  g->stopEditing();
-
-  const std::string driverName = g->driverName();
-  std::shared_ptr<MDAL::Driver> dr = MDAL::DriverManager::instance().driver( driverName );
-  if ( !dr )
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  const size_t valuesCount = g->dataLocation() == MDAL_DataLocation::DataOnFaces2D ? g->mesh()->facesCount() : g->mesh()->verticesCount();
+  std::vector<size_t> requested( static_cast<size_t>( count ) );
+  for ( size_t i = 0; i < requested.size(); ++i )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriver;
-    return;
+    if ( indices[i] < 0 || static_cast<size_t>( indices[i] ) >= valuesCount )
+    {
+      sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+      return 0;
+    }
+    requested[i] = static_cast<size_t>( indices[i] );
   }
 
-  if ( !dr->hasWriteDatasetCapability( g->dataLocation() ) )
+  size_t readCount = MDAL::timeSeriesAtIndices( *g, requested.size(), requested.data(), buffer );
+  if ( readCount == 0 )
   {
-    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
-    return;
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
   }
 
-  bool error = dr->persist( g );
-  if ( error )
-  {
-    sLastStatus = MDAL_Status::Err_InvalidData;
-  }
+  return static_cast<int>( readCount );
 }
 
-const char *MDAL_G_referenceTime( DatasetGroupH group )
+///////////////////////////////////////////////////////////////////////////////////////
+/// MESH VERTICES
+///////////////////////////////////////////////////////////////////////////////////////
+
+MeshVertexIteratorH MDAL_M_vertexIterator( MeshH mesh )
 {
-  if ( !group )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return _return_str( g->referenceTime().toStandartCalendarISO8601() );
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::unique_ptr<MDAL::MeshVertexIterator> it = m->readVertices();
+  return static_cast< MeshVertexIteratorH >( it.release() );
 }
 
-void MDAL_G_setMetadata( DatasetGroupH group, const char *key, const char *val )
+int MDAL_VI_next( MeshVertexIteratorH iterator, int verticesCount, double *coordinates )
 {
-  if ( !group )
+  if ( !iterator )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
-
-  if ( !key )
+  MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
+  size_t size = static_cast<size_t>( verticesCount );
+  if ( size == 0 )
   {
-    sLastStatus = MDAL_Status::Err_InvalidData;
-    return;
+    return 0;
   }
+  size_t ret = it->next( size, coordinates );
+  return static_cast<int>( ret );
+}
 
-  if ( !val )
+int64_t MDAL_VI_next64( MeshVertexIteratorH iterator, int64_t verticesCount, double *coordinates )
+{
+  if ( !iterator )
   {
-    sLastStatus = MDAL_Status::Err_InvalidData;
-    return;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
   }
+  if ( verticesCount <= 0 )
+    return 0;
 
-  const std::string k( key );
-  const std::string v( val );
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  g->setMetadata( k, v );
+  MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
+  return static_cast<int64_t>( it->next( static_cast<size_t>( verticesCount ), coordinates ) );
 }
 
-const char *MDAL_G_driverName( DatasetGroupH group )
+void MDAL_VI_close( MeshVertexIteratorH iterator )
 {
-  if ( !group )
+  if ( iterator )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return EMPTY_STR;
+    MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
+    delete it;
   }
-  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
-  return _return_str( g->driverName() );
 }
 
-///////////////////////////////////////////////////////////////////////////////////////
-/// DATASETS
-///////////////////////////////////////////////////////////////////////////////////////
-
-DatasetGroupH MDAL_D_group( DatasetH dataset )
+MeshVertexIteratorH MDAL_M_vertexIteratorInExtent( MeshH mesh, double minX, double maxX, double minY, double maxY )
 {
-  if ( !dataset )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return nullptr;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  return static_cast< MDAL::DatasetGroup * >( d->group() );
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::vector<size_t> indices = m->vertexTree().search( MDAL::BBox( minX, maxX, minY, maxY ) );
+  MDAL::MeshVertexIterator *it = new MDAL::SelectedVerticesIterator( *m, std::move( indices ) );
+  return static_cast< MeshVertexIteratorH >( it );
 }
 
-double MDAL_D_time( DatasetH dataset )
+int MDAL_VI_count( MeshVertexIteratorH iterator )
 {
-  if ( !dataset )
+  MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
+  MDAL::SelectedVerticesIterator *selected = dynamic_cast< MDAL::SelectedVerticesIterator * >( it );
+  if ( !selected )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return NODATA;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return -1;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  return d->time( MDAL::RelativeTimestamp::hours );
+  return static_cast<int>( selected->vertexIndices().size() );
 }
 
-int MDAL_D_volumesCount( DatasetH dataset )
+int MDAL_VI_vertexIndices( MeshVertexIteratorH iterator, int indexStart, int count, int *buffer )
 {
-  if ( !dataset )
+  MDAL::MeshVertexIterator *it = static_cast< MDAL::MeshVertexIterator * >( iterator );
+  MDAL::SelectedVerticesIterator *selected = dynamic_cast< MDAL::SelectedVerticesIterator * >( it );
+  if ( !selected )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  int len = static_cast<int>( d->volumesCount() );
-  return len;
+  if ( indexStart < 0 || count < 0 || !buffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  const std::vector<size_t> &indices = selected->vertexIndices();
+  const size_t start = std::min( static_cast<size_t>( indexStart ), indices.size() );
+  const size_t copyCount = std::min( indices.size() - start, static_cast<size_t>( count ) );
+  for ( size_t i = 0; i < copyCount; ++i )
+    buffer[i] = static_cast<int>( indices[start + i] );
+  return static_cast<int>( copyCount );
 }
 
-int MDAL_D_maximumVerticalLevelCount( DatasetH dataset )
+int MDAL_M_vertexCoordinatesSoA( MeshH mesh, int indexStart, int count, double *xBuffer, double *yBuffer, double *zBuffer )
 {
-  if ( !dataset )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
     return 0;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  int len = static_cast<int>( d->maximumVerticalLevelsCount() );
-  return len;
-}
 
-int MDAL_D_valueCount( DatasetH dataset )
-{
-  if ( !dataset )
+  if ( indexStart < 0 || count < 0 )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    sLastStatus = MDAL_Status::Err_InvalidData;
     return 0;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  int len = static_cast<int>( d->valuesCount() );
-  return len;
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  size_t ret = m->vertexCoordinates( static_cast<size_t>( indexStart ),
+                                     static_cast<size_t>( count ),
+                                     xBuffer,
+                                     yBuffer,
+                                     zBuffer );
+  return static_cast<int>( ret );
 }
 
-bool MDAL_D_isValid( DatasetH dataset )
+///////////////////////////////////////////////////////////////////////////////////////
+/// MESH FACES
+///////////////////////////////////////////////////////////////////////////////////////
+
+MeshFaceIteratorH MDAL_M_faceIterator( MeshH mesh )
 {
-  if ( !dataset )
+  if ( !mesh )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return false;
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  return d->isValid();
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::unique_ptr<MDAL::MeshFaceIterator > it = m->readFaces();
+  return static_cast< MeshFaceIteratorH >( it.release() );
 }
 
-int MDAL_D_data( DatasetH dataset, int indexStart, int count, MDAL_DataType dataType, void *buffer )
+int MDAL_FI_next( MeshFaceIteratorH iterator,
+                  int faceOffsetsBufferLen,
+                  int *faceOffsetsBuffer,
+                  int vertexIndicesBufferLen,
+                  int *vertexIndicesBuffer )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
+  size_t ret = it->next( static_cast<size_t>( faceOffsetsBufferLen ),
+                         faceOffsetsBuffer,
+                         static_cast<size_t>( vertexIndicesBufferLen ),
+                         vertexIndicesBuffer );
+  return static_cast<int>( ret );
+}
+
+int64_t MDAL_FI_next64( MeshFaceIteratorH iterator,
+                        int64_t faceOffsetsBufferLen,
+                        int64_t *faceOffsetsBuffer,
+                        int64_t vertexIndicesBufferLen,
+                        int64_t *vertexIndicesBuffer )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  if ( faceOffsetsBufferLen <= 0 || vertexIndicesBufferLen <= 0 || !faceOffsetsBuffer || !vertexIndicesBuffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+  MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
+  size_t ret = it->next64( static_cast<size_t>( faceOffsetsBufferLen ),
+                           faceOffsetsBuffer,
+                           static_cast<size_t>( vertexIndicesBufferLen ),
+                           vertexIndicesBuffer );
+  return static_cast<int64_t>( ret );
+}
+
+
+void MDAL_FI_close( MeshFaceIteratorH iterator )
+{
+  if ( iterator )
+  {
+    MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
+    delete it;
+  }
+}
+
+MeshFaceIteratorH MDAL_M_faceIteratorInExtent( MeshH mesh, double minX, double maxX, double minY, double maxY )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::vector<size_t> indices = m->faceTree().search( MDAL::BBox( minX, maxX, minY, maxY ) );
+  MDAL::MeshFaceIterator *it = new MDAL::SelectedFacesIterator( *m, std::move( indices ) );
+  return static_cast< MeshFaceIteratorH >( it );
+}
+
+int MDAL_FI_count( MeshFaceIteratorH iterator )
+{
+  MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
+  MDAL::SelectedFacesIterator *selected = dynamic_cast< MDAL::SelectedFacesIterator * >( it );
+  if ( !selected )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return -1;
+  }
+  return static_cast<int>( selected->faceIndices().size() );
+}
+
+int MDAL_FI_faceIndices( MeshFaceIteratorH iterator, int indexStart, int count, int *buffer )
+{
+  MDAL::MeshFaceIterator *it = static_cast< MDAL::MeshFaceIterator * >( iterator );
+  MDAL::SelectedFacesIterator *selected = dynamic_cast< MDAL::SelectedFacesIterator * >( it );
+  if ( !selected )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  if ( indexStart < 0 || count < 0 || !buffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  const std::vector<size_t> &indices = selected->faceIndices();
+  const size_t start = std::min( static_cast<size_t>( indexStart ), indices.size() );
+  const size_t copyCount = std::min( indices.size() - start, static_cast<size_t>( count ) );
+  for ( size_t i = 0; i < copyCount; ++i )
+    buffer[i] = static_cast<int>( indices[start + i] );
+  return static_cast<int>( copyCount );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// MESH TOPOLOGY
+///////////////////////////////////////////////////////////////////////////////////////
+
+MeshAdjacencyIteratorH MDAL_M_vertexFacesIterator( MeshH mesh )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast< MeshAdjacencyIteratorH >( new MDAL::AdjacencyIterator( m->topology().vertexFaces() ) );
+}
+
+MeshAdjacencyIteratorH MDAL_M_faceNeighboursIterator( MeshH mesh )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast< MeshAdjacencyIteratorH >( new MDAL::AdjacencyIterator( m->topology().faceNeighbours() ) );
+}
+
+int MDAL_AI_next( MeshAdjacencyIteratorH iterator,
+                  int offsetsBufferLen,
+                  int *offsetsBuffer,
+                  int indicesBufferLen,
+                  int *indicesBuffer )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  if ( offsetsBufferLen < 0 || indicesBufferLen < 0 || !offsetsBuffer || !indicesBuffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+  MDAL::AdjacencyIterator *it = static_cast< MDAL::AdjacencyIterator * >( iterator );
+  size_t ret = it->next( static_cast<size_t>( offsetsBufferLen ),
+                         offsetsBuffer,
+                         static_cast<size_t>( indicesBufferLen ),
+                         indicesBuffer );
+  return static_cast<int>( ret );
+}
+
+int MDAL_AI_maximumRowSize( MeshAdjacencyIteratorH iterator )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  MDAL::AdjacencyIterator *it = static_cast< MDAL::AdjacencyIterator * >( iterator );
+  return static_cast<int>( it->maximumRowSize() );
+}
+
+void MDAL_AI_close( MeshAdjacencyIteratorH iterator )
+{
+  if ( iterator )
+  {
+    MDAL::AdjacencyIterator *it = static_cast< MDAL::AdjacencyIterator * >( iterator );
+    delete it;
+  }
+}
+
+int MDAL_M_edgeCount( MeshH mesh )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast<int>( m->topology().edgesCount() );
+}
+
+int64_t MDAL_M_edgeCount64( MeshH mesh )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  return static_cast<int64_t>( m->topology().edgesCount() );
+}
+
+int MDAL_M_edgeVertices( MeshH mesh, int indexStart, int count, int *buffer )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  if ( indexStart < 0 || count < 0 || !buffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  const MDAL::MeshTopology &topology = m->topology();
+  const size_t start = static_cast<size_t>( indexStart );
+  if ( start >= topology.edgesCount() )
+    return 0;
+
+  const size_t copyCount = std::min( topology.edgesCount() - start, static_cast<size_t>( count ) );
+  const uint32_t *edges = topology.edges().data() + 2 * start;
+  for ( size_t i = 0; i < 2 * copyCount; ++i )
+    buffer[i] = static_cast<int>( edges[i] );
+  return static_cast<int>( copyCount );
+}
+
+RenderBuffersH MDAL_M_renderBuffers( MeshH mesh, MDAL_RenderVertices layout, double originX, double originY, double originZ )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+
+  if ( ( layout != MDAL_RenderVertices::RenderSharedVertices && layout != MDAL_RenderVertices::RenderFaceCorners ) ||
+       !std::isfinite( originX ) || !std::isfinite( originY ) || !std::isfinite( originZ ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  const size_t indexLimit = std::numeric_limits<uint32_t>::max();
+  const size_t cornersCount = layout == MDAL_RenderVertices::RenderFaceCorners ?
+                              m->facesCount() * m->faceVerticesMaximumCount() : 0;
+  if ( m->verticesCount() > indexLimit || m->facesCount() > indexLimit || cornersCount > indexLimit )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  return static_cast< RenderBuffersH >( new MDAL::RenderBuffers( *m, layout, originX, originY, originZ ) );
+}
+
+int64_t MDAL_RB_vertexCount( RenderBuffersH buffers )
+{
+  if ( !buffers )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  return static_cast<int64_t>( static_cast< MDAL::RenderBuffers * >( buffers )->verticesCount() );
+}
+
+int64_t MDAL_RB_triangleCount( RenderBuffersH buffers )
+{
+  if ( !buffers )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+  return static_cast<int64_t>( static_cast< MDAL::RenderBuffers * >( buffers )->trianglesCount() );
+}
+
+const float *MDAL_RB_vertices( RenderBuffersH buffers )
+{
+  if ( !buffers )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+  return static_cast< MDAL::RenderBuffers * >( buffers )->positions();
+}
+
+const uint32_t *MDAL_RB_indices( RenderBuffersH buffers )
+{
+  if ( !buffers )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+  return static_cast< MDAL::RenderBuffers * >( buffers )->indices();
+}
+
+int64_t MDAL_RB_values( RenderBuffersH buffers,
+                        DatasetH dataset,
+                        MDAL_RenderValueType type,
+                        double minimum,
+                        double maximum,
+                        void *buffer )
+{
+  if ( !buffers )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return 0;
+  }
+
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  MDAL::RenderBuffers *rb = static_cast< MDAL::RenderBuffers * >( buffers );
+  if ( ( !buffer && rb->verticesCount() > 0 ) ||
+       ( type != MDAL_RenderValueType::RenderFloat32 && type != MDAL_RenderValueType::RenderUInt16 ) ||
+       ( type == MDAL_RenderValueType::RenderUInt16 && !( std::isfinite( minimum ) && std::isfinite( maximum ) && minimum < maximum ) ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  const MDAL_DataLocation location = d->group()->dataLocation();
+  const bool isCompatible = location == MDAL_DataLocation::DataOnVertices2D ||
+                            ( location == MDAL_DataLocation::DataOnFaces2D && rb->layout() == MDAL_RenderVertices::RenderFaceCorners );
+  if ( d->mesh() != rb->mesh() || !isCompatible )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  const size_t written = rb->values( *d, type, minimum, maximum, buffer );
+  if ( written != rb->verticesCount() )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  return static_cast<int64_t>( written );
+}
+
+void MDAL_RB_close( RenderBuffersH buffers )
+{
+  if ( buffers )
+  {
+    MDAL::RenderBuffers *rb = static_cast< MDAL::RenderBuffers * >( buffers );
+    delete rb;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// DATASET GROUPS
+///////////////////////////////////////////////////////////////////////////////////////
+
+MeshH MDAL_G_mesh( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  MDAL::Mesh *m = g->mesh();
+  return static_cast< MeshH >( m );
+}
+
+int MDAL_G_datasetCount( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return 0;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->datasets.size() );
+  return len;
+}
+
+DatasetH MDAL_G_dataset( DatasetGroupH group, int index )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  if ( index < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->datasets.size() );
+  if ( len <= index )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+  size_t i = static_cast<size_t>( index );
+  return static_cast< DatasetH >( g->datasets[i].get() );
+}
+
+int MDAL_G_metadataCount( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->metadata.size() );
+  return len;
+}
+
+const char *MDAL_G_metadataKey( DatasetGroupH group, int index )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->metadata.size() );
+  if ( len <= index )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  size_t i = static_cast<size_t>( index );
+  return _return_str( g->metadata[i].first );
+}
+
+const char *MDAL_G_metadataValue( DatasetGroupH group, int index )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->metadata.size() );
+  if ( len <= index )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  size_t i = static_cast<size_t>( index );
+  return _return_str( g->metadata[i].second );
+}
+
+const char *MDAL_G_name( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return _return_str( g->name() );
+}
+
+bool MDAL_G_hasScalarData( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return true;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return g->isScalar();
+}
+
+MDAL_DataLocation MDAL_G_dataLocation( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return DataInvalidLocation;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return g->dataLocation();
+}
+
+int MDAL_G_maximumVerticalLevelCount( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  int len = static_cast<int>( g->maximumVerticalLevelsCount() );
+  return len;
+}
+
+bool MDAL_G_isReady( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  const MDAL::BackgroundLoad *load = g->mesh()->backgroundLoad();
+  return !load || load->isReady( g );
+}
+
+bool MDAL_G_waitUntilReady( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  MDAL::BackgroundLoad *load = g->mesh()->backgroundLoad();
+  return !load || load->wait( g );
+}
+
+void MDAL_G_minimumMaximum( DatasetGroupH group, double *min, double *max )
+{
+  if ( !min || !max )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    *min = NODATA;
+    *max = NODATA;
+    return;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  MDAL::Statistics stats = g->statistics();
+  *min = stats.minimum;
+  *max = stats.maximum;
+}
+
+double MDAL_G_quantile( DatasetGroupH group, double fraction )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return NODATA;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  const MDAL::Statistics stats = g->statisticsWithSketch();
+  if ( !stats.sketch )
+    return NODATA;
+  return stats.sketch->quantile( fraction );
+}
+
+bool MDAL_G_histogram( DatasetGroupH group, double min, double max, int binCount, double *counts )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  if ( binCount < 1 || !counts )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return false;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  const MDAL::Statistics stats = g->statisticsWithSketch();
+  if ( !stats.sketch || !stats.sketch->histogram( min, max, static_cast<size_t>( binCount ), counts ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return false;
+  }
+  return true;
+}
+
+int MDAL_G_dataBlock( DatasetGroupH group,
+                      int datasetIndexStart,
+                      int datasetCount,
+                      int indexStart,
+                      int count,
+                      MDAL_DataType dataType,
+                      MDAL_DataBlockLayout layout,
+                      double *buffer )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  if ( !buffer || datasetIndexStart < 0 || datasetCount < 0 || indexStart < 0 || count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  if ( ( dataType == MDAL_DataType::SCALAR_DOUBLE && !g->isScalar() ) ||
+       ( dataType == MDAL_DataType::VECTOR_2D_DOUBLE && g->isScalar() ) ||
+       ( dataType != MDAL_DataType::SCALAR_DOUBLE && dataType != MDAL_DataType::VECTOR_2D_DOUBLE ) )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  size_t writtenValuesCount = g->dataBlock( static_cast<size_t>( datasetIndexStart ),
+                              static_cast<size_t>( datasetCount ),
+                              static_cast<size_t>( indexStart ),
+                              static_cast<size_t>( count ),
+                              layout,
+                              buffer );
+  if ( writtenValuesCount == 0 )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  return static_cast<int>( writtenValuesCount );
+}
+
+void MDAL_G_prefetch( DatasetGroupH group, int datasetIndexStart, int datasetCount )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( datasetIndexStart < 0 || datasetCount < 0 ||
+       static_cast<size_t>( datasetIndexStart ) + static_cast<size_t>( datasetCount ) > g->datasets.size() )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return;
+  }
+
+  const MDAL_DataType dataType = g->isScalar() ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  for ( int i = datasetIndexStart; i < datasetIndexStart + datasetCount; ++i )
+  {
+    MDAL::Dataset *d = g->datasets[static_cast<size_t>( i )].get();
+    if ( !d->supportsConcurrentReads() )
+      MDAL::Prefetcher::instance().prefetch( d, dataType, 0, d->valuesCount() );
+  }
+}
+
+DatasetH MDAL_G_addDataset( DatasetGroupH group, double time, const double *values, const int *active )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+
+  if ( !values )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( !g->isInEditMode() )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+
+  const std::string driverName = g->driverName();
+  std::shared_ptr<MDAL::Driver> dr = MDAL::DriverManager::instance().driver( driverName );
+  if ( !dr )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriver;
+    return nullptr;
+  }
+
+  if ( !dr->hasWriteDatasetCapability( g->dataLocation() ) )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
+    return nullptr;
+  }
+
+  if ( g->dataLocation() == MDAL_DataLocation::DataOnVolumes3D )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
+    return nullptr;
+  }
+
+  if ( active && g->dataLocation() != MDAL_DataLocation::DataOnVertices2D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  const size_t index = g->datasets.size();
+  MDAL::RelativeTimestamp t( time, MDAL::RelativeTimestamp::hours );
+  dr->createDataset( g,
+                     t,
+                     values,
+                     active
+                   );
+  if ( index < g->datasets.size() ) // we have new dataset
+    return static_cast< DatasetGroupH >( g->datasets[ index ].get() );
+  else
+    return nullptr;
+}
+
+bool MDAL_G_isInEditMode( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return true;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return g->isInEditMode();
+}
+
+void MDAL_G_closeEditMode( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+
+  if ( !g->isInEditMode() )
+  {
+    return;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  g->setStatistics( MDAL::calculateStatistics( g ) );
+  g->stopEditing();
+
+  const std::string driverName = g->driverName();
+  std::shared_ptr<MDAL::Driver> dr = MDAL::DriverManager::instance().driver( driverName );
+  if ( !dr )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriver;
+    return;
+  }
+
+  if ( !dr->hasWriteDatasetCapability( g->dataLocation() ) )
+  {
+    sLastStatus = MDAL_Status::Err_MissingDriverCapability;
+    return;
+  }
+
+  bool error;
+  {
+    MDAL_PERF_SCOPE( perfScope, "persist", MDAL::PerfCounter::Persists, MDAL::PerfCounter::PersistTime, g->name() );
+    MDAL_PERF_DRIVER_SCOPE( driverScope, driverName, "persist" );
+    error = dr->persist( g );
+  }
+  if ( error )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+  }
+}
+
+const char *MDAL_G_referenceTime( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return _return_str( g->referenceTime().toStandartCalendarISO8601() );
+}
+
+int MDAL_G_datasetIndexAtTime( DatasetGroupH group, double time )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return -1;
+  }
+
+  if ( !std::isfinite( time ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return -1;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  const size_t index = g->datasetIndexAtTime( MDAL::RelativeTimestamp( time, MDAL::RelativeTimestamp::hours ) );
+  if ( index == MDAL::DatasetGroup::NO_DATASET )
+    return -1;
+  return static_cast<int>( index );
+}
+
+void MDAL_G_setMetadata( DatasetGroupH group, const char *key, const char *val )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return;
+  }
+
+  if ( !key )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  if ( !val )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  const std::string k( key );
+  const std::string v( val );
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( g->mesh() ) )
+    return;
+  g->setMetadata( k, v );
+  _detachEdited( g->mesh() );
+}
+
+const char *MDAL_G_driverName( DatasetGroupH group )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return EMPTY_STR;
+  }
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  return _return_str( g->driverName() );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+/// DATASETS
+///////////////////////////////////////////////////////////////////////////////////////
+
+DatasetGroupH MDAL_D_group( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  return static_cast< MDAL::DatasetGroup * >( d->group() );
+}
+
+double MDAL_D_time( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return NODATA;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  return d->time( MDAL::RelativeTimestamp::hours );
+}
+
+int MDAL_D_volumesCount( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  int len = static_cast<int>( d->volumesCount() );
+  return len;
+}
+
+int64_t MDAL_D_volumesCount64( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  return static_cast<int64_t>( d->volumesCount() );
+}
+
+int MDAL_D_maximumVerticalLevelCount( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  int len = static_cast<int>( d->maximumVerticalLevelsCount() );
+  return len;
+}
+
+int MDAL_D_valueCount( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  int len = static_cast<int>( d->valuesCount() );
+  return len;
+}
+
+int64_t MDAL_D_valueCount64( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  return static_cast<int64_t>( d->valuesCount() );
+}
+
+bool MDAL_D_isValid( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  return d->isValid();
+}
+
+//! Reads values of the dataset for MDAL_D_data and MDAL_D_data64
+static size_t _data( DatasetH dataset, size_t indexStartSizeT, size_t countSizeT, MDAL_DataType dataType, void *buffer )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  MDAL::DatasetGroup *g = d->group();
+  assert( g );
+
+  MDAL::Mesh *m = d->mesh();
+  assert( m );
+
+  size_t valuesCount = 0;
+
+  // Check that we are requesting correct 1D/2D for given dataset
+  switch ( dataType )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+    case MDAL_DataType::SCALAR_FLOAT:
+      if ( !g->isScalar() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = d->valuesCount();
+      break;
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      if ( g->isScalar() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = d->valuesCount();
+      break;
+    case MDAL_DataType::ACTIVE_INTEGER:
+    case MDAL_DataType::ACTIVE_BITS:
+      if ( !d->supportsActiveFlag() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = m->facesCount();
+      break;
+    case MDAL_DataType::VERTICAL_LEVEL_COUNT_INTEGER:
+      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = m->facesCount();
+      break;
+    case MDAL_DataType::VERTICAL_LEVEL_DOUBLE:
+      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = m->facesCount() + d->volumesCount();
+      break;
+    case MDAL_DataType::FACE_INDEX_TO_VOLUME_INDEX_INTEGER:
+      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = m->facesCount();
+      break;
+    case MDAL_DataType::SCALAR_VOLUMES_DOUBLE:
+      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      if ( !g->isScalar() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = d->volumesCount();
+      break;
+    case MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE:
+      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      if ( g->isScalar() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = 2 * d->volumesCount();
+      break;
+  }
+
+  // Check that we are not reaching out of values limit
+  if ( valuesCount <= indexStartSizeT )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  if ( valuesCount < indexStartSizeT + countSizeT )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  // Repeated requests of datasets read from files may be served from the cache
+  size_t writtenValuesCount = 0;
+  MDAL::BlockCache &cache = MDAL::BlockCache::instance();
+  const bool useCache = !d->supportsConcurrentReads();
+  if ( useCache && cache.get( d, dataType, indexStartSizeT, countSizeT, buffer, &writtenValuesCount ) )
+    return writtenValuesCount;
+
+  // Request data
+  {
+    MDAL::DatasetReadLock lock( d );
+    writtenValuesCount = d->data( dataType, indexStartSizeT, countSizeT, buffer );
+  }
+
+  if ( useCache && writtenValuesCount > 0 )
+  {
+    cache.put( d, dataType, indexStartSizeT, countSizeT, buffer, writtenValuesCount );
+    // the following time steps are likely requested next
+    MDAL::Prefetcher::instance().prefetchFollowing( d, dataType, indexStartSizeT, countSizeT );
+  }
+
+  return writtenValuesCount;
+}
+
+int MDAL_D_data( DatasetH dataset, int indexStart, int count, MDAL_DataType dataType, void *buffer )
+{
+  return static_cast<int>( _data( dataset, static_cast<size_t>( indexStart ), static_cast<size_t>( count ), dataType, buffer ) );
+}
+
+int64_t MDAL_D_data64( DatasetH dataset, int64_t indexStart, int64_t count, MDAL_DataType dataType, void *buffer )
+{
+  if ( indexStart < 0 || count < 0 )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  return static_cast<int64_t>( _data( dataset, static_cast<size_t>( indexStart ), static_cast<size_t>( count ), dataType, buffer ) );
+}
+
+int MDAL_D_dataAtIndices( DatasetH dataset, int count, const int *indices, MDAL_DataType dataType, void *buffer )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  if ( count < 0 || ( count > 0 && ( !indices || !buffer ) ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  MDAL::DatasetGroup *g = d->group();
+  const bool isVectorType = dataType == MDAL_DataType::VECTOR_2D_DOUBLE || dataType == MDAL_DataType::VECTOR_2D_FLOAT;
+  size_t valuesCount = 0;
+  switch ( dataType )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+    case MDAL_DataType::SCALAR_FLOAT:
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      if ( g->isScalar() == isVectorType ||
+           ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) ) )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = d->valuesCount();
+      break;
+    case MDAL_DataType::ACTIVE_INTEGER:
+      if ( !d->supportsActiveFlag() )
+      {
+        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+        return 0;
+      }
+      valuesCount = d->mesh()->facesCount();
+      break;
+    default:
+      sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+      return 0;
+  }
+
+  std::vector<size_t> requested( static_cast<size_t>( count ) );
+  for ( size_t i = 0; i < requested.size(); ++i )
+  {
+    if ( indices[i] < 0 || static_cast<size_t>( indices[i] ) >= valuesCount )
+    {
+      sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+      return 0;
+    }
+    requested[i] = static_cast<size_t>( indices[i] );
+  }
+
+  MDAL::DatasetReadLock lock( d );
+  return static_cast<int>( d->dataAtIndices( dataType, requested.data(), requested.size(), buffer ) );
+}
+
+int MDAL_D_validIndices( DatasetH dataset, int indexStart, int count, int *buffer )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  if ( indexStart < 0 || count < 0 || ( count > 0 && !buffer ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  const MDAL_DataLocation location = d->group()->dataLocation();
+  if ( location != MDAL_DataLocation::DataOnVertices2D && location != MDAL_DataLocation::DataOnFaces2D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  std::vector<size_t> indices( static_cast<size_t>( count ) );
+  size_t written;
+  {
+    MDAL::DatasetReadLock lock( d );
+    written = d->validIndices( static_cast<size_t>( indexStart ), indices.size(), indices.data() );
+  }
+  for ( size_t i = 0; i < written; ++i )
+    buffer[i] = static_cast<int>( indices[i] );
+  return static_cast<int>( written );
+}
+
+//! Returns the memory dataset of the values held in memory for the direct access and populates stride, null otherwise
+static const MDAL::MemoryDataset2D *_memoryDataset( DatasetH dataset, int *stride )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+
+  const MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  if ( stride )
+    *stride = d->group()->isScalar() ? 1 : 2;
+  return dynamic_cast< const MDAL::MemoryDataset2D * >( d );
+}
+
+const double *MDAL_D_dataPointer( DatasetH dataset, int *stride )
+{
+  const MDAL::MemoryDataset2D *d = _memoryDataset( dataset, stride );
+  return d ? d->values() : nullptr;
+}
+
+const float *MDAL_D_dataPointerFloat( DatasetH dataset, int *stride )
+{
+  const MDAL::MemoryDataset2D *d = _memoryDataset( dataset, stride );
+  return d ? d->floatValues() : nullptr;
+}
+
+void MDAL_D_minimumMaximum( DatasetH dataset, double *min, double *max )
+{
+  if ( !min || !max )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return;
+  }
+
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    *min = NODATA;
+    *max = NODATA;
+    return;
+  }
+
+  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
+  MDAL::Statistics stats = ds->statistics();
+  *min = stats.minimum;
+  *max = stats.maximum;
+}
+
+double MDAL_D_quantile( DatasetH dataset, double fraction )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return NODATA;
+  }
+
+  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
+  const MDAL::Statistics stats = ds->statisticsWithSketch();
+  if ( !stats.sketch )
+    return NODATA;
+  return stats.sketch->quantile( fraction );
+}
+
+bool MDAL_D_histogram( DatasetH dataset, double min, double max, int binCount, double *counts )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  if ( binCount < 1 || !counts )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return false;
+  }
+
+  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
+  const MDAL::Statistics stats = ds->statisticsWithSketch();
+  if ( !stats.sketch || !stats.sketch->histogram( min, max, static_cast<size_t>( binCount ), counts ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return false;
+  }
+  return true;
+}
+
+bool MDAL_D_rasterize( DatasetH dataset, double minX, double maxY, double cellWidth, double cellHeight,
+                       int columns, int rows, float *buffer )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  if ( columns < 0 || rows < 0 || !( cellWidth > 0 ) || !( cellHeight > 0 ) || !buffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return false;
+  }
+
+  MDAL::RasterGrid grid;
+  grid.minX = minX;
+  grid.maxY = maxY;
+  grid.cellWidth = cellWidth;
+  grid.cellHeight = cellHeight;
+  grid.columns = static_cast<size_t>( columns );
+  grid.rows = static_cast<size_t>( rows );
+
+  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
+  if ( !MDAL::rasterize( *ds, grid, buffer ) )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+  return true;
+}
+
+static ContourIteratorH _contourIterator( DatasetH dataset, int levelCount, const double *levels, MDAL::ContourIterator::Type type )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+
+  const int minimumCount = type == MDAL::ContourIterator::Bands ? 2 : 1;
+  if ( levelCount < minimumCount || !levels )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  std::vector<double> levelValues( levels, levels + levelCount );
+  for ( size_t i = 0; i < levelValues.size(); ++i )
+  {
+    if ( std::isnan( levelValues[i] ) || ( i > 0 && !( levelValues[i - 1] < levelValues[i] ) ) )
+    {
+      sLastStatus = MDAL_Status::Err_InvalidData;
+      return nullptr;
+    }
+  }
+
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  if ( d->group()->dataLocation() != MDAL_DataLocation::DataOnVertices2D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
+  }
+  return static_cast< ContourIteratorH >( new MDAL::ContourIterator( *d, levelValues, type ) );
+}
+
+ContourIteratorH MDAL_D_contourLines( DatasetH dataset, int levelCount, const double *levels )
+{
+  return _contourIterator( dataset, levelCount, levels, MDAL::ContourIterator::Lines );
+}
+
+ContourIteratorH MDAL_D_contourBands( DatasetH dataset, int levelCount, const double *levels )
+{
+  return _contourIterator( dataset, levelCount, levels, MDAL::ContourIterator::Bands );
+}
+
+int MDAL_CI_next( ContourIteratorH iterator,
+                  int partCount,
+                  int *levelIndexBuffer,
+                  int *pointOffsetsBuffer,
+                  int coordinatesBufferLen,
+                  double *coordinatesBuffer )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  if ( partCount < 0 || coordinatesBufferLen < 0 || !levelIndexBuffer || !pointOffsetsBuffer || !coordinatesBuffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+  MDAL::ContourIterator *it = static_cast< MDAL::ContourIterator * >( iterator );
+  size_t ret = it->next( static_cast<size_t>( partCount ),
+                         levelIndexBuffer,
+                         pointOffsetsBuffer,
+                         static_cast<size_t>( coordinatesBufferLen ),
+                         coordinatesBuffer );
+  return static_cast<int>( ret );
+}
+
+int MDAL_CI_maximumPointCount( ContourIteratorH iterator )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::ContourIterator *it = static_cast< MDAL::ContourIterator * >( iterator );
+  return static_cast<int>( it->maximumPointCount() );
+}
+
+int MDAL_CI_partCount( ContourIteratorH iterator )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+  MDAL::ContourIterator *it = static_cast< MDAL::ContourIterator * >( iterator );
+  return static_cast<int>( it->partsCount() );
+}
+
+void MDAL_CI_close( ContourIteratorH iterator )
+{
+  if ( iterator )
+  {
+    MDAL::ContourIterator *it = static_cast< MDAL::ContourIterator * >( iterator );
+    delete it;
+  }
+}
+
+bool MDAL_D_hasActiveFlagCapability( DatasetH dataset )
+{
+  if ( !dataset )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return false;
+  }
+
+  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
+  return ds->supportsActiveFlag();
+}
+
+DatasetGroupH MDAL_G_addAveragedGroup( DatasetGroupH group,
+                                       const char *name,
+                                       MDAL_AveragingMethod method,
+                                       double startParameter,
+                                       double endParameter )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  if ( !name )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  MDAL::AveragingMethod averaging;
+  averaging.type = method;
+  averaging.startParameter = startParameter;
+  averaging.endParameter = endParameter;
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( g->mesh() ) )
+    return nullptr;
+
+  return _addedGroup( g->mesh(), MDAL::addAveragedGroup( g, averaging, name ) );
+}
+
+DatasetGroupH MDAL_G_addTemporalAggregateGroup( DatasetGroupH group,
+    const char *name,
+    MDAL_TemporalAggregate aggregate )
+{
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  if ( !name ||
+       ( aggregate != MDAL_TemporalAggregate::TemporalMaximum && aggregate != MDAL_TemporalAggregate::TemporalMinimum &&
+         aggregate != MDAL_TemporalAggregate::TemporalMean && aggregate != MDAL_TemporalAggregate::TimeOfMaximum ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D && g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) ||
+       g->datasets.empty() )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( g->mesh() ) )
+    return nullptr;
+
+  return _addedGroup( g->mesh(), MDAL::addTemporalAggregateGroup( g, aggregate, name ) );
+}
+
+DatasetGroupH MDAL_G_addConvertedGroup( DatasetGroupH group,
+                                        const char *name,
+                                        MDAL_ConversionWeighting weighting )
 {
-  if ( !dataset )
+  if ( !group )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return 0;
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
   }
-  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
-  size_t indexStartSizeT = static_cast<size_t>( indexStart );
-  size_t countSizeT = static_cast<size_t>( count );
-  MDAL::DatasetGroup *g = d->group();
-  assert( g );
 
-  MDAL::Mesh *m = d->mesh();
-  assert( m );
+  if ( !name ||
+       ( weighting != MDAL_ConversionWeighting::EqualWeights && weighting != MDAL_ConversionWeighting::AreaWeights &&
+         weighting != MDAL_ConversionWeighting::InverseDistanceWeights ) )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
 
-  size_t valuesCount = 0;
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D && g->dataLocation() != MDAL_DataLocation::DataOnFaces2D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
 
-  // Check that we are requesting correct 1D/2D for given dataset
-  switch ( dataType )
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( g->mesh() ) )
+    return nullptr;
+
+  return _addedGroup( g->mesh(), MDAL::addConvertedGroup( g, weighting, name ) );
+}
+
+DatasetGroupH MDAL_G_addTimeInterpolatedGroup( DatasetGroupH group,
+    const char *name,
+    int timeCount,
+    const double *times )
+{
+  if ( !group )
   {
-    case MDAL_DataType::SCALAR_DOUBLE:
-      if ( !g->isScalar() )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = d->valuesCount();
-      break;
-    case MDAL_DataType::VECTOR_2D_DOUBLE:
-      if ( g->isScalar() )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) && ( g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = d->valuesCount();
-      break;
-    case MDAL_DataType::ACTIVE_INTEGER:
-      if ( !d->supportsActiveFlag() )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = m->facesCount();
-      break;
-    case MDAL_DataType::VERTICAL_LEVEL_COUNT_INTEGER:
-      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = m->facesCount();
-      break;
-    case MDAL_DataType::VERTICAL_LEVEL_DOUBLE:
-      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = m->facesCount() + d->volumesCount();
-      break;
-    case MDAL_DataType::FACE_INDEX_TO_VOLUME_INDEX_INTEGER:
-      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = m->facesCount();
-      break;
-    case MDAL_DataType::SCALAR_VOLUMES_DOUBLE:
-      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      if ( !g->isScalar() )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = d->volumesCount();
-      break;
-    case MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE:
-      if ( g->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      if ( g->isScalar() )
-      {
-        sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-        return 0;
-      }
-      valuesCount = 2 * d->volumesCount();
-      break;
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
   }
 
-  // Check that we are not reaching out of values limit
-  if ( valuesCount <= indexStartSizeT )
+  if ( !name || timeCount < 0 || ( timeCount > 0 && !times ) )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return 0;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
   }
 
-  if ( valuesCount < indexStartSizeT + countSizeT )
+  const std::vector<double> timesVector( times, times + timeCount );
+  for ( double time : timesVector )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return 0;
+    if ( !std::isfinite( time ) )
+    {
+      sLastStatus = MDAL_Status::Err_InvalidData;
+      return nullptr;
+    }
   }
 
-  // Request data
-  size_t writtenValuesCount = 0;
-  switch ( dataType )
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D && g->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) ||
+       g->datasets.empty() )
   {
-    case MDAL_DataType::SCALAR_DOUBLE:
-      writtenValuesCount = d->scalarData( indexStartSizeT, countSizeT, static_cast<double *>( buffer ) );
-      break;
-    case MDAL_DataType::VECTOR_2D_DOUBLE:
-      writtenValuesCount = d->vectorData( indexStartSizeT, countSizeT, static_cast<double *>( buffer ) );
-      break;
-    case MDAL_DataType::ACTIVE_INTEGER:
-      writtenValuesCount = d->activeData( indexStartSizeT, countSizeT, static_cast<int *>( buffer ) );
-      break;
-    case MDAL_DataType::VERTICAL_LEVEL_COUNT_INTEGER:
-      writtenValuesCount = d->verticalLevelCountData( indexStartSizeT, countSizeT, static_cast<int *>( buffer ) );
-      break;
-    case MDAL_DataType::VERTICAL_LEVEL_DOUBLE:
-      writtenValuesCount = d->verticalLevelData( indexStartSizeT, countSizeT, static_cast<double *>( buffer ) );
-      break;
-    case MDAL_DataType::FACE_INDEX_TO_VOLUME_INDEX_INTEGER:
-      writtenValuesCount = d->faceToVolumeData( indexStartSizeT, countSizeT, static_cast<int *>( buffer ) );
-      break;
-    case MDAL_DataType::SCALAR_VOLUMES_DOUBLE:
-      writtenValuesCount = d->scalarVolumesData( indexStartSizeT, countSizeT, static_cast<double *>( buffer ) );
-      break;
-    case MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE:
-      writtenValuesCount = d->vectorVolumesData( indexStartSizeT, countSizeT, static_cast<double *>( buffer ) );
-      break;
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
   }
 
-  return static_cast<int>( writtenValuesCount );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( g->mesh() ) )
+    return nullptr;
+
+  return _addedGroup( g->mesh(), MDAL::addTimeInterpolatedGroup( g, timesVector, name ) );
 }
 
-void MDAL_D_minimumMaximum( DatasetH dataset, double *min, double *max )
+DatasetGroupH MDAL_G_addLevelOfDetailGroup( DatasetGroupH group,
+    int level,
+    MDAL_LevelOfDetailAggregate aggregate )
 {
-  if ( !min || !max )
+  if ( !group )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  if ( level < 0 )
   {
     sLastStatus = MDAL_Status::Err_InvalidData;
-    return;
+    return nullptr;
   }
 
-  if ( !dataset )
+  if ( aggregate != MDAL_LevelOfDetailAggregate::LevelMean && aggregate != MDAL_LevelOfDetailAggregate::LevelMaximum )
   {
-    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    *min = NODATA;
-    *max = NODATA;
-    return;
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
   }
 
-  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
-  MDAL::Statistics stats = ds->statistics();
-  *min = stats.minimum;
-  *max = stats.maximum;
+  MDAL::DatasetGroup *g = static_cast< MDAL::DatasetGroup * >( group );
+  if ( g->dataLocation() != MDAL_DataLocation::DataOnVertices2D && g->dataLocation() != MDAL_DataLocation::DataOnFaces2D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDatasetGroup;
+    return nullptr;
+  }
+
+  // the pyramid is built on the first request under its own mutex, the library is not locked meanwhile
+  const size_t levelsCount = g->mesh()->levelsOfDetail().levelsCount();
+  if ( static_cast<size_t>( level ) >= levelsCount )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+
+  if ( !_canEdit( g->mesh() ) )
+    return nullptr;
+
+  return _addedGroup( g->mesh(), MDAL::addLevelOfDetailGroup( g, static_cast<size_t>( level ), aggregate ) );
 }
 
-bool MDAL_D_hasActiveFlagCapability( DatasetH dataset )
+DatasetGroupH MDAL_M_addDerivedGroup( MeshH mesh, const char *name, const char *expression )
+{
+  if ( !mesh )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleMesh;
+    return nullptr;
+  }
+
+  if ( !name || !expression )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+
+  MDAL::Mesh *m = static_cast< MDAL::Mesh * >( mesh );
+  std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+  if ( !_canEdit( m ) )
+    return nullptr;
+
+  std::string error;
+  MDAL::DatasetGroup *group = MDAL::addDerivedGroup( m, name, expression, error );
+  if ( !group )
+  {
+    MDAL::debug( "Derived group not created: " + error );
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return nullptr;
+  }
+  _detachEdited( m );
+  return static_cast< DatasetGroupH >( group );
+}
+
+DatasetVolumeIteratorH MDAL_D_volumeIterator( DatasetH dataset )
 {
   if ( !dataset )
   {
     sLastStatus = MDAL_Status::Err_IncompatibleDataset;
-    return false;
+    return nullptr;
+  }
+  MDAL::Dataset *d = static_cast< MDAL::Dataset * >( dataset );
+  if ( d->group()->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return nullptr;
   }
+  return static_cast< DatasetVolumeIteratorH >( new MDAL::DatasetVolumeIterator( d ) );
+}
 
-  MDAL::Dataset *ds = static_cast< MDAL::Dataset * >( dataset );
-  return ds->supportsActiveFlag();
+int MDAL_VOI_next( DatasetVolumeIteratorH iterator,
+                   int faceCount,
+                   int *levelCountBuffer,
+                   int levelsBufferLen,
+                   double *levelsBuffer,
+                   int valuesBufferLen,
+                   double *valuesBuffer )
+{
+  if ( !iterator )
+  {
+    sLastStatus = MDAL_Status::Err_IncompatibleDataset;
+    return 0;
+  }
+
+  if ( faceCount <= 0 || levelsBufferLen < 0 || valuesBufferLen < 0 ||
+       !levelCountBuffer || !levelsBuffer || !valuesBuffer )
+  {
+    sLastStatus = MDAL_Status::Err_InvalidData;
+    return 0;
+  }
+
+  MDAL::DatasetVolumeIterator *it = static_cast< MDAL::DatasetVolumeIterator * >( iterator );
+  size_t ret = it->next( static_cast<size_t>( faceCount ),
+                         levelCountBuffer,
+                         static_cast<size_t>( levelsBufferLen ),
+                         levelsBuffer,
+                         static_cast<size_t>( valuesBufferLen ),
+                         valuesBuffer );
+  return static_cast<int>( ret );
 }
 
+void MDAL_VOI_close( DatasetVolumeIteratorH iterator )
+{
+  if ( iterator )
+  {
+    MDAL::DatasetVolumeIterator *it = static_cast< MDAL::DatasetVolumeIterator * >( iterator );
+    delete it;
+  }
+}
@@ -0,0 +1,307 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_averaging.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mdal_parallel.hpp"
+#include "mdal_volume_iterator.hpp"
+
+//! Number of faces averaged by one parallel task
+static const size_t BLOCK_FACES = 1024;
+
+//! Returns value of the volume containing elevation z, NaN when z is outside of the column
+static double _valueAt( double z, size_t levelCount, const double *levels, const double *values, size_t stride )
+{
+  for ( size_t i = 0; i < levelCount; ++i )
+  {
+    const double volumeTop = std::max( levels[i], levels[i + 1] );
+    const double volumeBottom = std::min( levels[i], levels[i + 1] );
+    if ( z >= volumeBottom && z <= volumeTop )
+      return values[i * stride];
+  }
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+double MDAL::averageColumn( const AveragingMethod &method,
+                            size_t levelCount,
+                            const double *levels,
+                            const double *values,
+                            size_t stride )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  if ( levelCount == 0 )
+    return nan;
+
+  if ( method.type == MDAL_AveragingMethod::SINGLE_LEVEL_FROM_TOP ||
+       method.type == MDAL_AveragingMethod::SINGLE_LEVEL_FROM_BOTTOM )
+  {
+    if ( !( method.startParameter >= 0 ) )
+      return nan;
+    const size_t level = static_cast<size_t>( method.startParameter );
+    if ( level >= levelCount )
+      return nan;
+    const bool fromTop = method.type == MDAL_AveragingMethod::SINGLE_LEVEL_FROM_TOP;
+    return values[( fromTop ? level : levelCount - 1 - level ) * stride];
+  }
+
+  const double surface = levels[0];
+  const double bed = levels[levelCount];
+  const double minParameter = std::min( method.startParameter, method.endParameter );
+  const double maxParameter = std::max( method.startParameter, method.endParameter );
+  double bottom = nan;
+  double top = nan;
+  switch ( method.type )
+  {
+    case MDAL_AveragingMethod::SIGMA:
+      bottom = bed + minParameter * ( surface - bed );
+      top = bed + maxParameter * ( surface - bed );
+      break;
+    case MDAL_AveragingMethod::DEPTH_FROM_SURFACE:
+      bottom = surface - maxParameter;
+      top = surface - minParameter;
+      break;
+    case MDAL_AveragingMethod::HEIGHT_FROM_BED:
+      bottom = bed + minParameter;
+      top = bed + maxParameter;
+      break;
+    case MDAL_AveragingMethod::ELEVATION:
+      bottom = minParameter;
+      top = maxParameter;
+      break;
+    default:
+      return nan;
+  }
+
+  // NaN parameters or levels never overlap
+  if ( !( bottom <= top ) )
+    return nan;
+
+  // range of zero thickness takes the volume with the elevation
+  if ( bottom == top )
+    return _valueAt( bottom, levelCount, levels, values, stride );
+
+  double sum = 0;
+  double thickness = 0;
+  for ( size_t i = 0; i < levelCount; ++i )
+  {
+    const double value = values[i * stride];
+    if ( std::isnan( value ) )
+      continue;
+
+    const double volumeTop = std::max( levels[i], levels[i + 1] );
+    const double volumeBottom = std::min( levels[i], levels[i + 1] );
+    const double overlap = std::min( volumeTop, top ) - std::max( volumeBottom, bottom );
+    if ( overlap > 0 )
+    {
+      sum += value * overlap;
+      thickness += overlap;
+    }
+  }
+  return thickness > 0 ? sum / thickness : nan;
+}
+
+MDAL::AveragedValuesCache::AveragedValuesCache( size_t maximumCount )
+  : mMaximumCount( maximumCount )
+{
+}
+
+MDAL::AveragedValuesCache::Values MDAL::AveragedValuesCache::get( const Dataset *dataset )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  for ( auto it = mEntries.begin(); it != mEntries.end(); ++it )
+  {
+    if ( it->first == dataset )
+    {
+      mEntries.splice( mEntries.begin(), mEntries, it );
+      return it->second;
+    }
+  }
+  return nullptr;
+}
+
+void MDAL::AveragedValuesCache::put( const Dataset *dataset, const Values &values )
+{
+  // values removed are released without the lock, readers may still hold them
+  Values removed;
+  std::lock_guard<std::mutex> lock( mMutex );
+  for ( const auto &entry : mEntries )
+  {
+    if ( entry.first == dataset )
+      return; // calculated by another thread meanwhile
+  }
+  mEntries.emplace_front( dataset, values );
+  if ( mEntries.size() > mMaximumCount )
+  {
+    removed = std::move( mEntries.back().second );
+    mEntries.pop_back();
+  }
+}
+
+void MDAL::AveragedValuesCache::remove( const Dataset *dataset )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  mEntries.remove_if( [dataset]( const std::pair<const Dataset *, Values> &entry ) { return entry.first == dataset; } );
+}
+
+const size_t MDAL::AveragedDataset2D::DATASETS_CACHED = 4;
+
+MDAL::AveragedDataset2D::AveragedDataset2D( MDAL::DatasetGroup *parent,
+    std::shared_ptr<MDAL::Dataset> source,
+    const MDAL::AveragingMethod &method,
+    std::shared_ptr<AveragedValuesCache> cache )
+  : Dataset2D( parent )
+  , mSource( source )
+  , mMethod( method )
+  , mCache( cache )
+{
+  setSupportsActiveFlag( source->supportsActiveFlag() );
+  setTime( source->time( RelativeTimestamp::hours ) );
+}
+
+MDAL::AveragedDataset2D::~AveragedDataset2D()
+{
+  mCache->remove( this );
+}
+
+bool MDAL::AveragedDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+MDAL::AveragedValuesCache::Values MDAL::AveragedDataset2D::values()
+{
+  AveragedValuesCache::Values cached = mCache->get( this );
+  if ( cached )
+    return cached;
+
+  // calculated without the lock, the reads of the source take the library lock which the caller may hold already,
+  // concurrent first requests may calculate the values twice
+  const size_t facesCount = mesh()->facesCount();
+  const bool isScalar = group()->isScalar();
+  const size_t valuesPerFace = isScalar ? 1 : 2;
+  std::shared_ptr<std::vector<double>> averaged = std::make_shared<std::vector<double>>( valuesPerFace * facesCount, std::numeric_limits<double>::quiet_NaN() );
+
+  // buffers for the whole batch of the iterator, so the batch is copied by one call
+  const size_t batchFaces = DatasetVolumeIterator::BATCH_FACES;
+  const size_t maxLevels = std::max( mSource->maximumVerticalLevelsCount(), size_t( 1 ) );
+  std::vector<int> levelCounts( batchFaces );
+  std::vector<double> levels( batchFaces * ( maxLevels + 1 ) );
+  std::vector<double> values( batchFaces * maxLevels * valuesPerFace );
+  std::vector<size_t> levelOffsets( batchFaces );
+  std::vector<size_t> valueOffsets( batchFaces );
+
+  // the source is read by the calling thread, the tasks only calculate
+  DatasetVolumeIterator it( mSource.get() );
+  size_t faceStart = 0;
+  while ( faceStart < facesCount )
+  {
+    const size_t faces = it.next( batchFaces, levelCounts.data(),
+                                  levels.size(), levels.data(),
+                                  values.size(), values.data() );
+    if ( faces == 0 )
+      break;
+
+    size_t levelOffset = 0;
+    size_t valueOffset = 0;
+    for ( size_t i = 0; i < faces; ++i )
+    {
+      levelOffsets[i] = levelOffset;
+      valueOffsets[i] = valueOffset;
+      const size_t levelCount = static_cast<size_t>( levelCounts[i] );
+      if ( levelCount > 0 )
+      {
+        levelOffset += levelCount + 1;
+        valueOffset += valuesPerFace * levelCount;
+      }
+    }
+
+    const size_t blocks = ( faces + BLOCK_FACES - 1 ) / BLOCK_FACES;
+    parallelFor( blocks, [&]( size_t block )
+    {
+      const size_t end = std::min( faces, ( block + 1 ) * BLOCK_FACES );
+      for ( size_t i = block * BLOCK_FACES; i < end; ++i )
+      {
+        const size_t levelCount = static_cast<size_t>( levelCounts[i] );
+        double *result = averaged->data() + valuesPerFace * ( faceStart + i );
+        const double *columnLevels = levels.data() + levelOffsets[i];
+        const double *columnValues = values.data() + valueOffsets[i];
+        result[0] = averageColumn( mMethod, levelCount, columnLevels, columnValues, valuesPerFace );
+        if ( !isScalar )
+          result[1] = averageColumn( mMethod, levelCount, columnLevels, columnValues + 1, valuesPerFace );
+      }
+    } );
+
+    faceStart += faces;
+  }
+
+  mCache->put( this, averaged );
+  return averaged;
+}
+
+size_t MDAL::AveragedDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  const AveragedValuesCache::Values cached = values();
+  const std::vector<double> &vals = *cached;
+  if ( ( count < 1 ) || ( indexStart >= vals.size() ) )
+    return 0;
+
+  const size_t copyValues = std::min( vals.size() - indexStart, count );
+  std::copy( vals.begin() + static_cast<std::ptrdiff_t>( indexStart ),
+             vals.begin() + static_cast<std::ptrdiff_t>( indexStart + copyValues ),
+             buffer );
+  return copyValues;
+}
+
+size_t MDAL::AveragedDataset2D::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  const AveragedValuesCache::Values cached = values();
+  const std::vector<double> &vals = *cached;
+  const size_t facesCount = vals.size() / 2;
+  if ( ( count < 1 ) || ( indexStart >= facesCount ) )
+    return 0;
+
+  const size_t copyValues = std::min( facesCount - indexStart, count );
+  std::copy( vals.begin() + static_cast<std::ptrdiff_t>( 2 * indexStart ),
+             vals.begin() + static_cast<std::ptrdiff_t>( 2 * ( indexStart + copyValues ) ),
+             buffer );
+  return copyValues;
+}
+
+size_t MDAL::AveragedDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  // faces are active when they are active in the 3D dataset
+  DatasetReadLock lock( mSource.get() );
+  return mSource->activeData( indexStart, count, buffer );
+}
+
+MDAL::DatasetGroup *MDAL::addAveragedGroup( MDAL::DatasetGroup *group, const MDAL::AveragingMethod &method, const std::string &name )
+{
+  if ( !group || group->dataLocation() != MDAL_DataLocation::DataOnVolumes3D )
+    return nullptr;
+
+  MDAL::Mesh *mesh = group->mesh();
+  std::shared_ptr<DatasetGroup> averaged = std::make_shared<DatasetGroup>( group->driverName(),
+      mesh,
+      group->uri(),
+      name );
+  averaged->setDataLocation( MDAL_DataLocation::DataOnFaces2D );
+  averaged->setIsScalar( group->isScalar() );
+  averaged->setReferenceTime( group->referenceTime() );
+
+  // statistics are calculated on the first request, that calculates the values too
+  std::shared_ptr<AveragedValuesCache> cache = std::make_shared<AveragedValuesCache>( AveragedDataset2D::DATASETS_CACHED );
+  for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    averaged->datasets.push_back( std::make_shared<AveragedDataset2D>( averaged.get(), dataset, method, cache ) );
+
+  mesh->datasetGroups.push_back( averaged );
+  return averaged.get();
+}
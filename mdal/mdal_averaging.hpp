@@ -0,0 +1,105 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_AVERAGING_HPP
+#define MDAL_AVERAGING_HPP
+
+#include <stddef.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mdal.h"
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  //! Method of the aggregation of the volumes of the face column to a single value, see MDAL_AveragingMethod
+  struct AveragingMethod
+  {
+    MDAL_AveragingMethod type = MDAL_AveragingMethod::SIGMA;
+    double startParameter = 0;
+    double endParameter = 1;
+  };
+
+  /**
+   * Aggregates the values of the column of levelCount volumes
+   *
+   * \param levels levelCount + 1 z values of the levels from the surface to the bed
+   * \param values values of the volumes from the surface, every stride-th item is used
+   * \returns NaN when no valid volume is in the range of the method
+   */
+  double averageColumn( const AveragingMethod &method,
+                        size_t levelCount,
+                        const double *levels,
+                        const double *values,
+                        size_t stride = 1 );
+
+  /**
+   * Values of the recently read datasets of an averaged group, the least recently used
+   * are removed over the maximum count
+   */
+  class AveragedValuesCache
+  {
+    public:
+      typedef std::shared_ptr<const std::vector<double>> Values;
+
+      explicit AveragedValuesCache( size_t maximumCount );
+
+      //! Returns the values of the dataset and marks them recently used, null when not cached
+      Values get( const Dataset *dataset );
+      void put( const Dataset *dataset, const Values &values );
+      void remove( const Dataset *dataset );
+
+    private:
+      std::mutex mMutex;
+      //! most recently used first
+      std::list<std::pair<const Dataset *, Values>> mEntries;
+      size_t mMaximumCount;
+  };
+
+  /**
+   * 2D dataset on faces aggregated from the volumes of 3D dataset
+   *
+   * Values are calculated for all faces on request, in parallel for the blocks of faces.
+   * The values of the last DATASETS_CACHED datasets read are kept in the cache shared by the group.
+   */
+  class AveragedDataset2D: public Dataset2D
+  {
+    public:
+      AveragedDataset2D( DatasetGroup *parent,
+                         std::shared_ptr<Dataset> source,
+                         const AveragingMethod &method,
+                         std::shared_ptr<AveragedValuesCache> cache );
+      ~AveragedDataset2D() override;
+
+      //! Number of the datasets of a group with their values kept
+      static const size_t DATASETS_CACHED;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Reads of the source are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+    private:
+      //! Returns the aggregated values, from the cache or calculated without any lock held
+      AveragedValuesCache::Values values();
+
+      std::shared_ptr<Dataset> mSource;
+      AveragingMethod mMethod;
+      std::shared_ptr<AveragedValuesCache> mCache;
+  };
+
+  /**
+   * Adds group with datasets aggregated from the datasets of 3D group to its mesh
+   * \returns the new group or nullptr when the group is not defined on volumes
+   */
+  DatasetGroup *addAveragedGroup( DatasetGroup *group, const AveragingMethod &method, const std::string &name );
+} // namespace MDAL
+#endif //MDAL_AVERAGING_HPP
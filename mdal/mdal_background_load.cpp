@@ -0,0 +1,112 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_background_load.hpp"
+
+#include <exception>
+
+#include "mdal_options.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_utils.hpp"
+
+static std::mutex sCallbackMutex;
+static std::function<void( MDAL::DatasetGroup * )> sCallback;
+
+void MDAL::setGroupReadyCallback( const std::function<void( DatasetGroup * )> &callback )
+{
+  std::lock_guard<std::mutex> lock( sCallbackMutex );
+  sCallback = callback;
+}
+
+static void _notifyReady( MDAL::DatasetGroup *group )
+{
+  std::function<void( MDAL::DatasetGroup * )> callback;
+  {
+    std::lock_guard<std::mutex> lock( sCallbackMutex );
+    callback = sCallback;
+  }
+  if ( callback )
+    callback( group );
+}
+
+MDAL::BackgroundLoad::BackgroundLoad( const DatasetGroups &groups )
+  : mGroups( groups )
+{
+  mThread = std::thread( &BackgroundLoad::run, this );
+}
+
+MDAL::BackgroundLoad::~BackgroundLoad()
+{
+  stop();
+}
+
+size_t MDAL::BackgroundLoad::groupIndex( const DatasetGroup *group ) const
+{
+  for ( size_t i = 0; i < mGroups.size(); ++i )
+  {
+    if ( mGroups[i].get() == group )
+      return i;
+  }
+  return mGroups.size();
+}
+
+bool MDAL::BackgroundLoad::isReady( const DatasetGroup *group ) const
+{
+  const size_t index = groupIndex( group );
+  std::lock_guard<std::mutex> lock( mMutex );
+  return index == mGroups.size() || index < mReadyCount;
+}
+
+bool MDAL::BackgroundLoad::wait( const DatasetGroup *group )
+{
+  const size_t index = groupIndex( group );
+  std::unique_lock<std::mutex> lock( mMutex );
+  mReadyCondition.wait( lock, [this, index] { return index == mGroups.size() || index < mReadyCount || mIsStopped; } );
+  return index == mGroups.size() || index < mReadyCount;
+}
+
+void MDAL::BackgroundLoad::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock( mMutex );
+    mIsStopped = true;
+  }
+  mReadyCondition.notify_all();
+  if ( mThread.joinable() )
+    mThread.join();
+}
+
+void MDAL::BackgroundLoad::run()
+{
+  // the statistics are calculated here even when LAZY_STATISTICS is set
+  const ScopedOpenOption eagerStatistics( OPTION_LAZY_STATISTICS, "NO" );
+  for ( const std::shared_ptr<DatasetGroup> &group : mGroups )
+  {
+    {
+      std::lock_guard<std::mutex> lock( mMutex );
+      if ( mIsStopped )
+        return;
+    }
+
+    try
+    {
+      // edits may replace the datasets and files are read with libraries that are not thread-safe
+      std::lock_guard<std::recursive_mutex> libraryLock( libraryMutex() );
+      updateStatistics( group );
+    }
+    catch ( const std::exception &e )
+    {
+      // the statistics are calculated on request then
+      debug( "Statistics of dataset group " + group->name() + " not calculated: " + e.what() );
+    }
+
+    {
+      std::lock_guard<std::mutex> lock( mMutex );
+      ++mReadyCount;
+    }
+    mReadyCondition.notify_all();
+    _notifyReady( group.get() );
+  }
+}
@@ -0,0 +1,72 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_BACKGROUND_LOAD_HPP
+#define MDAL_BACKGROUND_LOAD_HPP
+
+#include <stddef.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Calculates statistics of the dataset groups of a loaded mesh on a background thread
+   *
+   * Used with PROGRESSIVE_LOAD open option: the mesh is returned as soon as the driver
+   * has discovered its groups, loaded with lazy statistics, and the thread calculates
+   * statistics of the datasets and of the groups in order. Each group is processed with
+   * libraryMutex() held, so edits of the mesh and reads from the files wait for it.
+   * Statistics requested meanwhile are calculated on request, only once.
+   */
+  class BackgroundLoad
+  {
+    public:
+      //! Starts the thread for the groups
+      explicit BackgroundLoad( const DatasetGroups &groups );
+      //! Stops the thread, see stop()
+      ~BackgroundLoad();
+
+      BackgroundLoad( const BackgroundLoad & ) = delete;
+      BackgroundLoad &operator=( const BackgroundLoad & ) = delete;
+
+      //! Whether the group is processed, true for the groups added after the load
+      bool isReady( const DatasetGroup *group ) const;
+
+      /**
+       * Waits until the group is processed
+       * \returns false when the load is stopped before
+       */
+      bool wait( const DatasetGroup *group );
+
+      //! Skips the remaining groups and waits for the thread, the caller must not hold libraryMutex()
+      void stop();
+
+    private:
+      void run();
+
+      //! Position of the group in mGroups, their count when it is not there
+      size_t groupIndex( const DatasetGroup *group ) const;
+
+      const DatasetGroups mGroups;
+      mutable std::mutex mMutex;
+      std::condition_variable mReadyCondition;
+      //! Groups [0, mReadyCount) are processed
+      size_t mReadyCount = 0;
+      bool mIsStopped = false;
+      std::thread mThread;
+  };
+
+  /**
+   * Sets function called on the background thread once a group is processed, empty function to remove it
+   * It must not close the mesh
+   */
+  void setGroupReadyCallback( const std::function<void( DatasetGroup * )> &callback );
+} // namespace MDAL
+#endif //MDAL_BACKGROUND_LOAD_HPP
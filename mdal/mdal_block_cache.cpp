@@ -0,0 +1,160 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_block_cache.hpp"
+
+#include <limits>
+#include <string.h>
+
+MDAL::BlockCache &MDAL::BlockCache::instance()
+{
+  // never destroyed, the worker of the Prefetcher may still put a block during the exit
+  static BlockCache *sCache = new BlockCache();
+  return *sCache;
+}
+
+void MDAL::BlockCache::setMaximumSize( size_t bytes )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  mMaximumSize = bytes;
+  shrink( mMaximumSize );
+}
+
+size_t MDAL::BlockCache::maximumSize() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mMaximumSize;
+}
+
+size_t MDAL::BlockCache::size() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mSize;
+}
+
+bool MDAL::BlockCache::get( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count, void *buffer, size_t *valuesCount )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( mMaximumSize == 0 )
+    return false;
+
+  auto it = mIndex.find( Key( dataset, static_cast<int>( type ), indexStart, count ) );
+  if ( it == mIndex.end() )
+  {
+    ++mMisses;
+    return false;
+  }
+
+  // move to front
+  mBlocks.splice( mBlocks.begin(), mBlocks, it->second );
+  const Block &block = *it->second;
+  memcpy( buffer, block.data.data(), block.data.size() );
+  *valuesCount = block.valuesCount;
+  ++mHits;
+  return true;
+}
+
+bool MDAL::BlockCache::contains( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count ) const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mIndex.find( Key( dataset, static_cast<int>( type ), indexStart, count ) ) != mIndex.end();
+}
+
+void MDAL::BlockCache::put( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count, const void *buffer, size_t valuesCount )
+{
+  const size_t bytes = bufferSize( type, valuesCount );
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( bytes == 0 || bytes > mMaximumSize )
+    return;
+
+  const Key key( dataset, static_cast<int>( type ), indexStart, count );
+  auto it = mIndex.find( key );
+  if ( it != mIndex.end() )
+    removeBlock( it );
+
+  shrink( mMaximumSize - bytes );
+
+  Block block;
+  block.key = key;
+  block.data.assign( static_cast<const char *>( buffer ), static_cast<const char *>( buffer ) + bytes );
+  block.valuesCount = valuesCount;
+  mBlocks.push_front( std::move( block ) );
+  mIndex[key] = mBlocks.begin();
+  mSize += bytes;
+}
+
+void MDAL::BlockCache::remove( const Dataset *dataset )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( mIndex.empty() )
+    return;
+
+  // keys of the dataset are adjacent in the index
+  auto it = mIndex.lower_bound( Key( dataset, std::numeric_limits<int>::min(), 0, 0 ) );
+  while ( it != mIndex.end() && std::get<0>( it->first ) == dataset )
+    removeBlock( it++ );
+}
+
+long long MDAL::BlockCache::hits() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mHits;
+}
+
+long long MDAL::BlockCache::misses() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mMisses;
+}
+
+size_t MDAL::BlockCache::bufferSize( MDAL_DataType type, size_t count )
+{
+  switch ( type )
+  {
+    case MDAL_DataType::ACTIVE_BITS:
+      return ( count + 7 ) / 8;
+    default:
+      return count * valueSize( type );
+  }
+}
+
+size_t MDAL::BlockCache::valueSize( MDAL_DataType type )
+{
+  switch ( type )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+    case MDAL_DataType::VERTICAL_LEVEL_DOUBLE:
+    case MDAL_DataType::SCALAR_VOLUMES_DOUBLE:
+      return sizeof( double );
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+    case MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE:
+      return 2 * sizeof( double );
+    case MDAL_DataType::ACTIVE_INTEGER:
+    case MDAL_DataType::VERTICAL_LEVEL_COUNT_INTEGER:
+    case MDAL_DataType::FACE_INDEX_TO_VOLUME_INDEX_INTEGER:
+      return sizeof( int );
+    case MDAL_DataType::SCALAR_FLOAT:
+      return sizeof( float );
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      return 2 * sizeof( float );
+    case MDAL_DataType::ACTIVE_BITS:
+      return 0; // bits, see bufferSize()
+  }
+  return 0;
+}
+
+void MDAL::BlockCache::removeBlock( std::map<Key, Blocks::iterator>::iterator it )
+{
+  mSize -= it->second->data.size();
+  mBlocks.erase( it->second );
+  mIndex.erase( it );
+}
+
+void MDAL::BlockCache::shrink( size_t bytes )
+{
+  while ( mSize > bytes && !mBlocks.empty() )
+    removeBlock( mIndex.find( mBlocks.back().key ) );
+}
@@ -0,0 +1,92 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_BLOCK_CACHE_HPP
+#define MDAL_BLOCK_CACHE_HPP
+
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "mdal.h"
+
+namespace MDAL
+{
+  class Dataset;
+
+  /**
+   * Library-wide cache of the blocks read by MDAL_D_data from the datasets backed by files
+   *
+   * Blocks are keyed by dataset, data type, start index and count, so only requests
+   * repeated with the same range are served from the cache. When the total size of
+   * the blocks exceeds the budget, the least recently used blocks are removed.
+   * The cache is disabled (zero budget) by default.
+   */
+  class BlockCache
+  {
+    public:
+      static BlockCache &instance();
+
+      //! Sets budget in bytes, 0 disables the cache. Blocks over the budget are removed
+      void setMaximumSize( size_t bytes );
+      size_t maximumSize() const;
+
+      //! Total size of the cached blocks in bytes
+      size_t size() const;
+
+      /**
+       * Copies the cached block to buffer
+       * \returns false when the block is not cached, counted as miss when the cache is enabled
+       */
+      bool get( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count, void *buffer, size_t *valuesCount );
+
+      //! Whether the block is cached, does not change the order of blocks nor the counters
+      bool contains( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count ) const;
+
+      //! Stores valuesCount values of the block read from the dataset
+      void put( const Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count, const void *buffer, size_t valuesCount );
+
+      //! Removes all blocks of the dataset, called when the dataset is deleted
+      void remove( const Dataset *dataset );
+
+      long long hits() const;
+      long long misses() const;
+
+      //! Size of one value of the type in bytes, 0 for ACTIVE_BITS
+      static size_t valueSize( MDAL_DataType type );
+
+      //! Size of the buffer for count values of the type in bytes
+      static size_t bufferSize( MDAL_DataType type, size_t count );
+
+    private:
+      BlockCache() = default;
+
+      typedef std::tuple<const Dataset *, int, size_t, size_t> Key;
+      struct Block
+      {
+        Key key;
+        std::vector<char> data;
+        size_t valuesCount = 0;
+      };
+      typedef std::list<Block> Blocks;
+
+      void removeBlock( std::map<Key, Blocks::iterator>::iterator it );
+      void shrink( size_t bytes );
+
+      mutable std::mutex mMutex;
+      //! most recently used first
+      Blocks mBlocks;
+      std::map<Key, Blocks::iterator> mIndex;
+      size_t mMaximumSize = 0;
+      size_t mSize = 0;
+      long long mHits = 0;
+      long long mMisses = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_BLOCK_CACHE_HPP
@@ -0,0 +1,223 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_compressed_values.hpp"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+static const unsigned char RAW_BLOCK = 0;
+static const unsigned char ENCODED_BLOCK = 1;
+
+namespace
+{
+  //! Last block decompressed by the thread
+  struct DecompressedBlock
+  {
+    uint64_t id = 0;
+    size_t block = 0;
+    std::vector<unsigned char> bytes;
+  };
+
+  template <typename T> struct Bits;
+  template <> struct Bits<double> { typedef uint64_t Type; };
+  template <> struct Bits<float> { typedef uint32_t Type; };
+}
+
+static thread_local DecompressedBlock tBlock;
+
+const size_t MDAL::CompressedValues::BLOCK_VALUES;
+
+//! Raw values follow the block flag at the next multiple of 8 bytes, so they are aligned
+static size_t _rawValuesOffset( size_t blockOffset )
+{
+  return ( blockOffset + 1 + 7 ) / 8 * 8;
+}
+
+static uint64_t _nextId()
+{
+  static std::atomic<uint64_t> sNextId( 1 );
+  return sNextId++;
+}
+
+//! Encodes count values as control bytes followed by the kept bytes, returns false when it does not get smaller
+template <typename T>
+static bool _encodeBlock( const T *values, size_t count, size_t stride, std::vector<unsigned char> &out )
+{
+  typedef typename Bits<T>::Type U;
+  const size_t rawSize = count * sizeof( T );
+  const size_t start = out.size();
+  out.resize( start + count );
+  size_t control = start;
+
+  for ( size_t i = 0; i < count; ++i )
+  {
+    U bits, previous = 0;
+    memcpy( &bits, values + i, sizeof( T ) );
+    if ( i >= stride )
+      memcpy( &previous, values + i - stride, sizeof( T ) );
+    U x = bits ^ previous;
+
+    unsigned char trailing = 0;
+    unsigned char kept = 0;
+    if ( x != 0 )
+    {
+      while ( ( x & 0xFF ) == 0 )
+      {
+        x >>= 8;
+        ++trailing;
+      }
+      for ( U rest = x; rest != 0; rest >>= 8 )
+        ++kept;
+      for ( unsigned char b = 0; b < kept; ++b )
+        out.push_back( static_cast<unsigned char>( x >> ( 8 * b ) ) );
+    }
+    out[control++] = static_cast<unsigned char>( ( trailing << 4 ) | kept );
+
+    if ( out.size() - start >= rawSize )
+    {
+      out.resize( start );
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+static void _decodeBlock( const unsigned char *data, size_t count, size_t stride, T *values )
+{
+  typedef typename Bits<T>::Type U;
+  const unsigned char *payload = data + count;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const unsigned char trailing = data[i] >> 4;
+    const unsigned char kept = data[i] & 0x0F;
+    U x = 0;
+    for ( unsigned char b = 0; b < kept; ++b )
+      x |= static_cast<U>( payload[b] ) << ( 8 * ( b + trailing ) );
+    payload += kept;
+
+    U previous = 0;
+    if ( i >= stride )
+      memcpy( &previous, values + i - stride, sizeof( T ) );
+    x ^= previous;
+    memcpy( values + i, &x, sizeof( T ) );
+  }
+}
+
+MDAL::CompressedValues::CompressedValues( const double *values, size_t count, size_t stride )
+  : mCount( count )
+  , mValueSize( sizeof( double ) )
+  , mStride( stride )
+  , mId( _nextId() )
+{
+  compress( values, stride );
+}
+
+MDAL::CompressedValues::CompressedValues( const float *values, size_t count, size_t stride )
+  : mCount( count )
+  , mValueSize( sizeof( float ) )
+  , mStride( stride )
+  , mId( _nextId() )
+{
+  compress( values, stride );
+}
+
+template <typename T>
+void MDAL::CompressedValues::compress( const T *values, size_t stride )
+{
+  // blocks start at the first component of the vectors
+  static_assert( BLOCK_VALUES % 2 == 0, "blocks must hold whole vectors" );
+  assert( stride > 0 && BLOCK_VALUES % stride == 0 );
+
+  std::vector<unsigned char> data;
+  data.reserve( mCount * sizeof( T ) / 2 );
+  for ( size_t start = 0; start < mCount; start += BLOCK_VALUES )
+  {
+    const size_t count = std::min( BLOCK_VALUES, mCount - start );
+    mBlockOffsets.push_back( data.size() );
+    data.push_back( ENCODED_BLOCK );
+    if ( !_encodeBlock( values + start, count, stride, data ) )
+    {
+      data.back() = RAW_BLOCK;
+      data.resize( _rawValuesOffset( mBlockOffsets.back() ), 0 );
+      const unsigned char *raw = reinterpret_cast<const unsigned char *>( values + start );
+      data.insert( data.end(), raw, raw + count * sizeof( T ) );
+    }
+  }
+  mBlockOffsets.push_back( data.size() );
+  mData.assign( data.begin(), data.end() );
+}
+
+size_t MDAL::CompressedValues::compressedSize() const
+{
+  return mData.size() + mBlockOffsets.size() * sizeof( size_t );
+}
+
+const unsigned char *MDAL::CompressedValues::block( size_t blockIndex ) const
+{
+  const unsigned char *data = mData.data() + mBlockOffsets[blockIndex];
+  if ( data[0] == RAW_BLOCK )
+    return mData.data() + _rawValuesOffset( mBlockOffsets[blockIndex] );
+
+  if ( tBlock.id != mId || tBlock.block != blockIndex )
+  {
+    const size_t count = std::min( BLOCK_VALUES, mCount - blockIndex * BLOCK_VALUES );
+    tBlock.bytes.resize( BLOCK_VALUES * mValueSize );
+    if ( isSinglePrecision() )
+      _decodeBlock( data + 1, count, mStride, reinterpret_cast<float *>( tBlock.bytes.data() ) );
+    else
+      _decodeBlock( data + 1, count, mStride, reinterpret_cast<double *>( tBlock.bytes.data() ) );
+    tBlock.id = mId;
+    tBlock.block = blockIndex;
+  }
+  return tBlock.bytes.data();
+}
+
+template <typename T>
+void MDAL::CompressedValues::readAs( size_t index, size_t count, T *buffer ) const
+{
+  assert( index + count <= mCount );
+  while ( count > 0 )
+  {
+    const size_t blockIndex = index / BLOCK_VALUES;
+    const size_t offset = index % BLOCK_VALUES;
+    const size_t blockCount = std::min( count, BLOCK_VALUES - offset );
+    const unsigned char *values = block( blockIndex );
+    if ( isSinglePrecision() )
+    {
+      const float *input = reinterpret_cast<const float *>( values ) + offset;
+      std::copy( input, input + blockCount, buffer );
+    }
+    else
+    {
+      const double *input = reinterpret_cast<const double *>( values ) + offset;
+      for ( size_t i = 0; i < blockCount; ++i )
+        buffer[i] = static_cast<T>( input[i] );
+    }
+    buffer += blockCount;
+    index += blockCount;
+    count -= blockCount;
+  }
+}
+
+double MDAL::CompressedValues::value( size_t index ) const
+{
+  double result;
+  readAs( index, 1, &result );
+  return result;
+}
+
+void MDAL::CompressedValues::read( size_t index, size_t count, double *buffer ) const
+{
+  readAs( index, count, buffer );
+}
+
+void MDAL::CompressedValues::read( size_t index, size_t count, float *buffer ) const
+{
+  readAs( index, count, buffer );
+}
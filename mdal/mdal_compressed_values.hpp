@@ -0,0 +1,76 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_COMPRESSED_VALUES_HPP
+#define MDAL_COMPRESSED_VALUES_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "mdal_spill.hpp"
+
+namespace MDAL
+{
+  /**
+   * Losslessly compressed array of doubles or floats
+   *
+   * Values are compressed in independent blocks of BLOCK_VALUES. Each value is XORed with
+   * the value stride positions before it (the same component of the previous vector), which
+   * clears the whole value in the NaN or constant regions and the leading bytes of smooth
+   * fields, then the zero bytes at both ends of the result are dropped and a control byte
+   * per value holds the counts of the kept and dropped bytes. Blocks that do not get smaller
+   * are stored as they are.
+   *
+   * Reads decompress the blocks to the buffer of the calling thread, which keeps the last
+   * decompressed block, so sequential reads decompress each block once and concurrent reads
+   * do not need any lock.
+   */
+  class CompressedValues
+  {
+    public:
+      static const size_t BLOCK_VALUES = 4096;
+
+      //! Compresses count values, stride is 2 for vectors stored as x1, y1, ..., xN, yN
+      CompressedValues( const double *values, size_t count, size_t stride );
+      CompressedValues( const float *values, size_t count, size_t stride );
+
+      CompressedValues( const CompressedValues & ) = delete;
+      CompressedValues &operator=( const CompressedValues & ) = delete;
+
+      size_t count() const { return mCount; }
+
+      bool isSinglePrecision() const { return mValueSize == sizeof( float ); }
+
+      //! Size of the compressed data in bytes
+      size_t compressedSize() const;
+
+      double value( size_t index ) const;
+
+      //! Copies values [index, index + count) to the buffer, widened or rounded to the buffer type
+      void read( size_t index, size_t count, double *buffer ) const;
+      void read( size_t index, size_t count, float *buffer ) const;
+
+    private:
+      template <typename T>
+      void compress( const T *values, size_t stride );
+
+      //! Returns values of the block, raw blocks directly, others decompressed to the buffer of the thread
+      const unsigned char *block( size_t blockIndex ) const;
+
+      template <typename T>
+      void readAs( size_t index, size_t count, T *buffer ) const;
+
+      SpillVector<unsigned char> mData;
+      //! Offsets of the blocks in mData, with the end of the last one
+      std::vector<size_t> mBlockOffsets;
+      size_t mCount = 0;
+      size_t mValueSize = sizeof( double );
+      size_t mStride = 1;
+      //! Identifies the array in the buffers of the threads
+      uint64_t mId = 0;
+  };
+} // namespace MDAL
+#endif //MDAL_COMPRESSED_VALUES_HPP
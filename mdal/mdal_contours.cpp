@@ -0,0 +1,521 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_contours.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+
+#include "mdal_data_model.hpp"
+#include "mdal_parallel.hpp"
+
+//! Faces are binned to tiles of about TILE_FACES faces contoured in parallel
+static const size_t TILE_FACES = 4096;
+
+//! Crossing of the level with the side of triangle, the side is given by its vertices in ascending order
+struct Crossing
+{
+  uint32_t level = 0;
+  uint64_t side = 0;
+
+  bool operator<( const Crossing &other ) const
+  {
+    return level < other.level || ( level == other.level && side < other.side );
+  }
+
+  bool operator==( const Crossing &other ) const
+  {
+    return level == other.level && side == other.side;
+  }
+};
+
+//! Segment of contour line within one triangle, from start to end
+struct Segment
+{
+  Crossing start;
+  Crossing end;
+  double coordinates[4];
+};
+
+//! Polyline or polygon of the level (band) of one tile
+struct Part
+{
+  uint32_t level = 0;
+  Crossing start;
+  Crossing end;
+  bool isClosed = false;
+  std::vector<double> coordinates;
+};
+
+//! Pieces joined end to start
+struct Chain
+{
+  std::vector<size_t> pieces;
+  bool isClosed = false;
+};
+
+//! Point of the triangle with the value interpolated in it
+struct ValuePoint
+{
+  double x;
+  double y;
+  double value;
+};
+
+static const double *_coordinates( const Segment &segment, size_t &pointCount )
+{
+  pointCount = 2;
+  return segment.coordinates;
+}
+
+static const double *_coordinates( const Part &part, size_t &pointCount )
+{
+  pointCount = part.coordinates.size() / 2;
+  return part.coordinates.data();
+}
+
+/**
+ * Joins the pieces to chains, the end of each piece of the chain is the start of the next one
+ *
+ * Chains start at the pieces without previous piece, the remaining pieces form closed chains.
+ * Pieces are found by binary search in the pieces sorted by their start, so the chains
+ * depend only on the order of the pieces.
+ */
+template<typename Piece>
+static std::vector<Chain> _chains( const std::vector<Piece> &pieces )
+{
+  const size_t count = pieces.size();
+  const size_t none = std::numeric_limits<size_t>::max();
+  std::vector<size_t> byStart( count );
+  std::iota( byStart.begin(), byStart.end(), 0 );
+  std::stable_sort( byStart.begin(), byStart.end(), [&pieces]( size_t a, size_t b )
+  {
+    return pieces[a].start < pieces[b].start;
+  } );
+
+  std::vector<size_t> next( count, none );
+  std::vector<char> hasPrevious( count, 0 );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    std::vector<size_t>::const_iterator it = std::lower_bound( byStart.begin(), byStart.end(), i, [&pieces]( size_t a, size_t b )
+    {
+      return pieces[a].start < pieces[b].end;
+    } );
+    for ( ; it != byStart.end() && pieces[*it].start == pieces[i].end; ++it )
+    {
+      if ( *it != i && !hasPrevious[*it] )
+      {
+        next[i] = *it;
+        hasPrevious[*it] = 1;
+        break;
+      }
+    }
+  }
+
+  std::vector<Chain> chains;
+  std::vector<char> isUsed( count, 0 );
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    for ( size_t i = 0; i < count; ++i )
+    {
+      if ( isUsed[i] || ( pass == 0 && hasPrevious[i] ) )
+        continue;
+
+      Chain chain;
+      size_t piece = i;
+      while ( piece != none && !isUsed[piece] )
+      {
+        chain.pieces.push_back( piece );
+        isUsed[piece] = 1;
+        piece = next[piece];
+      }
+      chain.isClosed = piece == i;
+      chains.push_back( std::move( chain ) );
+    }
+  }
+  return chains;
+}
+
+//! Appends the points of the pieces of the chain, the first point of the next piece is the last of the previous one
+template<typename Piece>
+static void _chainCoordinates( const std::vector<Piece> &pieces, const Chain &chain, std::vector<double> &coordinates )
+{
+  coordinates.clear();
+  for ( size_t i = 0; i < chain.pieces.size(); ++i )
+  {
+    size_t pointCount = 0;
+    const double *points = _coordinates( pieces[chain.pieces[i]], pointCount );
+    const size_t skipped = i == 0 ? 0 : 1;
+    if ( pointCount > skipped )
+      coordinates.insert( coordinates.end(), points + 2 * skipped, points + 2 * pointCount );
+  }
+}
+
+//! Returns the crossing of the level with side ( p, q ), calculated from the lower vertex index so both triangles of the side get the same point
+static Crossing _crossing( size_t p, size_t q, uint32_t level, double levelValue,
+                           const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &values,
+                           double *point )
+{
+  const size_t a = std::min( p, q );
+  const size_t b = std::max( p, q );
+  const double t = ( levelValue - values[a] ) / ( values[b] - values[a] );
+  point[0] = x[a] + t * ( x[b] - x[a] );
+  point[1] = y[a] + t * ( y[b] - y[a] );
+
+  Crossing crossing;
+  crossing.level = level;
+  crossing.side = ( static_cast<uint64_t>( a ) << 32 ) | static_cast<uint64_t>( b );
+  return crossing;
+}
+
+//! Adds segments of all levels crossing the counter-clockwise triangle, higher values are on the right of the segments
+static void _contourTriangle( const size_t *triangle,
+                              const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &values,
+                              const std::vector<double> &levels, std::vector<Segment> &segments )
+{
+  const double minValue = std::min( values[triangle[0]], std::min( values[triangle[1]], values[triangle[2]] ) );
+  const double maxValue = std::max( values[triangle[0]], std::max( values[triangle[1]], values[triangle[2]] ) );
+
+  // levels in ( minValue, maxValue ] split the vertices
+  const size_t first = static_cast<size_t>( std::upper_bound( levels.begin(), levels.end(), minValue ) - levels.begin() );
+  const size_t last = static_cast<size_t>( std::upper_bound( levels.begin(), levels.end(), maxValue ) - levels.begin() );
+  for ( size_t level = first; level < last; ++level )
+  {
+    Segment segment;
+    for ( size_t i = 0; i < 3; ++i )
+    {
+      const size_t p = triangle[i];
+      const size_t q = triangle[( i + 1 ) % 3];
+      const bool isAbove = values[p] >= levels[level];
+      if ( isAbove == ( values[q] >= levels[level] ) )
+        continue;
+
+      // the line enters the triangle on the side going up and leaves it on the side going down
+      if ( isAbove )
+        segment.end = _crossing( p, q, static_cast<uint32_t>( level ), levels[level], x, y, values, segment.coordinates + 2 );
+      else
+        segment.start = _crossing( p, q, static_cast<uint32_t>( level ), levels[level], x, y, values, segment.coordinates );
+    }
+    segments.push_back( segment );
+  }
+}
+
+//! Clips the polygon to the part with values at or above the level (isLower) or below the level
+static void _clip( const std::vector<ValuePoint> &polygon, double level, bool isLower, std::vector<ValuePoint> &result )
+{
+  result.clear();
+  for ( size_t i = 0; i < polygon.size(); ++i )
+  {
+    const ValuePoint &current = polygon[i];
+    const ValuePoint &next = polygon[( i + 1 ) % polygon.size()];
+    const bool isCurrentInside = isLower ? current.value >= level : current.value < level;
+    const bool isNextInside = isLower ? next.value >= level : next.value < level;
+    if ( isCurrentInside )
+      result.push_back( current );
+    if ( isCurrentInside != isNextInside )
+    {
+      const double t = ( level - current.value ) / ( next.value - current.value );
+      ValuePoint point;
+      point.x = current.x + t * ( next.x - current.x );
+      point.y = current.y + t * ( next.y - current.y );
+      point.value = level;
+      result.push_back( point );
+    }
+  }
+}
+
+//! Adds polygons of the bands overlapping the counter-clockwise triangle
+static void _bandTriangle( const size_t *triangle,
+                           const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &values,
+                           const std::vector<double> &levels, std::vector<Part> &parts )
+{
+  const double minValue = std::min( values[triangle[0]], std::min( values[triangle[1]], values[triangle[2]] ) );
+  const double maxValue = std::max( values[triangle[0]], std::max( values[triangle[1]], values[triangle[2]] ) );
+
+  // bands [ levels[i], levels[i + 1] ) with levels[i] <= maxValue and levels[i + 1] > minValue
+  const size_t above = static_cast<size_t>( std::upper_bound( levels.begin(), levels.end(), minValue ) - levels.begin() );
+  const size_t first = above == 0 ? 0 : above - 1;
+  const size_t last = std::min( static_cast<size_t>( std::upper_bound( levels.begin(), levels.end(), maxValue ) - levels.begin() ),
+                                levels.size() - 1 );
+
+  std::vector<ValuePoint> polygon( 3 );
+  for ( size_t i = 0; i < 3; ++i )
+  {
+    polygon[i].x = x[triangle[i]];
+    polygon[i].y = y[triangle[i]];
+    polygon[i].value = values[triangle[i]];
+  }
+
+  std::vector<ValuePoint> clipped;
+  std::vector<ValuePoint> band;
+  for ( size_t level = first; level < last; ++level )
+  {
+    _clip( polygon, levels[level], true, clipped );
+    _clip( clipped, levels[level + 1], false, band );
+    if ( band.size() < 3 )
+      continue;
+
+    Part part;
+    part.level = static_cast<uint32_t>( level );
+    part.isClosed = true;
+    part.coordinates.reserve( 2 * band.size() );
+    for ( const ValuePoint &point : band )
+    {
+      part.coordinates.push_back( point.x );
+      part.coordinates.push_back( point.y );
+    }
+    parts.push_back( std::move( part ) );
+  }
+}
+
+MDAL::ContourIterator::ContourIterator( MDAL::Dataset &dataset, const std::vector<double> &levels, Type type )
+{
+  mPointOffsets.push_back( 0 );
+  if ( dataset.group()->dataLocation() != MDAL_DataLocation::DataOnVertices2D ||
+       levels.empty() || ( type == Bands && levels.size() < 2 ) )
+    return;
+
+  Mesh *mesh = dataset.mesh();
+  const size_t verticesCount = mesh->verticesCount();
+  std::vector<double> x( verticesCount );
+  std::vector<double> y( verticesCount );
+  double minX = std::numeric_limits<double>::max();
+  double maxX = -std::numeric_limits<double>::max();
+  double minY = std::numeric_limits<double>::max();
+  double maxY = -std::numeric_limits<double>::max();
+  {
+    const size_t blockSize = 65536;
+    std::vector<double> coordinates( 3 * blockSize );
+    std::unique_ptr<MeshVertexIterator> vertexIterator = mesh->readVertices();
+    size_t verticesRead = 0;
+    while ( verticesRead < verticesCount )
+    {
+      const size_t count = vertexIterator->next( std::min( blockSize, verticesCount - verticesRead ), coordinates.data() );
+      if ( count == 0 )
+        break;
+      for ( size_t i = 0; i < count; ++i )
+      {
+        x[verticesRead + i] = coordinates[3 * i];
+        y[verticesRead + i] = coordinates[3 * i + 1];
+        minX = std::min( minX, coordinates[3 * i] );
+        maxX = std::max( maxX, coordinates[3 * i] );
+        minY = std::min( minY, coordinates[3 * i + 1] );
+        maxY = std::max( maxY, coordinates[3 * i + 1] );
+      }
+      verticesRead += count;
+    }
+  }
+
+  const size_t facesCount = mesh->facesCount();
+  std::vector<size_t> faceOffsets( 1, 0 );
+  std::vector<size_t> faceVertices;
+  {
+    const size_t blockSize = 65536;
+    std::vector<int> offsets( std::min( std::max( facesCount, size_t( 1 ) ), blockSize ) );
+    std::vector<int> indices( offsets.size() * std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) ) );
+    std::unique_ptr<MeshFaceIterator> faceIterator = mesh->readFaces();
+    faceOffsets.reserve( facesCount + 1 );
+    while ( faceOffsets.size() <= facesCount )
+    {
+      const size_t count = faceIterator->next( offsets.size(), offsets.data(), indices.size(), indices.data() );
+      if ( count == 0 )
+        break;
+      const size_t firstIndex = faceVertices.size();
+      for ( size_t i = 0; i < static_cast<size_t>( offsets[count - 1] ); ++i )
+        faceVertices.push_back( static_cast<size_t>( indices[i] ) );
+      for ( size_t i = 0; i < count; ++i )
+        faceOffsets.push_back( firstIndex + static_cast<size_t>( offsets[i] ) );
+    }
+  }
+  const size_t facesRead = faceOffsets.size() - 1;
+
+  // values (magnitudes of vectors) and active flags
+  std::vector<double> values( verticesCount, std::numeric_limits<double>::quiet_NaN() );
+  std::vector<int> active;
+  {
+    DatasetReadLock lock( &dataset );
+    if ( dataset.group()->isScalar() )
+    {
+      dataset.scalarData( 0, verticesCount, values.data() );
+    }
+    else
+    {
+      std::vector<double> vectors( 2 * verticesCount, std::numeric_limits<double>::quiet_NaN() );
+      dataset.vectorData( 0, verticesCount, vectors.data() );
+      for ( size_t i = 0; i < verticesCount; ++i )
+        values[i] = std::sqrt( vectors[2 * i] * vectors[2 * i] + vectors[2 * i + 1] * vectors[2 * i + 1] );
+    }
+
+    if ( dataset.supportsActiveFlag() )
+    {
+      active.assign( facesRead, 1 );
+      dataset.activeData( 0, facesRead, active.data() );
+    }
+  }
+
+  // faces binned to the square tiles of the extent by their first vertex
+  const size_t tileColumns = std::max( size_t( 1 ), static_cast<size_t>( std::sqrt( static_cast<double>( facesRead / TILE_FACES ) ) ) );
+  const size_t tilesCount = tileColumns * tileColumns;
+  const double tileWidth = ( maxX - minX ) / static_cast<double>( tileColumns );
+  const double tileHeight = ( maxY - minY ) / static_cast<double>( tileColumns );
+  std::vector<size_t> faceTiles( facesRead, 0 );
+  std::vector<size_t> tileOffsets( tilesCount + 1, 0 );
+  for ( size_t f = 0; f < facesRead; ++f )
+  {
+    if ( faceOffsets[f] == faceOffsets[f + 1] || faceVertices[faceOffsets[f]] >= verticesCount )
+      continue;
+    const size_t v = faceVertices[faceOffsets[f]];
+    const size_t column = tileWidth > 0 ? std::min( tileColumns - 1, static_cast<size_t>( ( x[v] - minX ) / tileWidth ) ) : 0;
+    const size_t row = tileHeight > 0 ? std::min( tileColumns - 1, static_cast<size_t>( ( y[v] - minY ) / tileHeight ) ) : 0;
+    faceTiles[f] = row * tileColumns + column;
+    ++tileOffsets[faceTiles[f] + 1];
+  }
+  for ( size_t i = 1; i < tileOffsets.size(); ++i )
+    tileOffsets[i] += tileOffsets[i - 1];
+  std::vector<size_t> tileFaces( facesRead );
+  {
+    std::vector<size_t> position( tileOffsets.begin(), tileOffsets.end() - 1 );
+    for ( size_t f = 0; f < facesRead; ++f )
+      tileFaces[position[faceTiles[f]]++] = f;
+  }
+
+  std::vector<std::vector<Part>> tileParts( tilesCount );
+  parallelFor( tilesCount, [&]( size_t tile )
+  {
+    std::vector<Segment> segments;
+    std::vector<Part> &parts = tileParts[tile];
+    for ( size_t i = tileOffsets[tile]; i < tileOffsets[tile + 1]; ++i )
+    {
+      const size_t f = tileFaces[i];
+      if ( !active.empty() && active[f] == 0 )
+        continue;
+
+      const size_t *vertices = faceVertices.data() + faceOffsets[f];
+      const size_t count = faceOffsets[f + 1] - faceOffsets[f];
+      for ( size_t j = 1; j + 1 < count; ++j )
+      {
+        size_t triangle[3] = { vertices[0], vertices[j], vertices[j + 1] };
+        if ( triangle[0] >= verticesCount || triangle[1] >= verticesCount || triangle[2] >= verticesCount ||
+             std::isnan( values[triangle[0]] ) || std::isnan( values[triangle[1]] ) || std::isnan( values[triangle[2]] ) )
+          continue;
+
+        const double area = ( x[triangle[1]] - x[triangle[0]] ) * ( y[triangle[2]] - y[triangle[0]] ) -
+                            ( y[triangle[1]] - y[triangle[0]] ) * ( x[triangle[2]] - x[triangle[0]] );
+        if ( !( area != 0 ) )
+          continue;
+        if ( area < 0 )
+          std::swap( triangle[1], triangle[2] );
+
+        if ( type == Lines )
+          _contourTriangle( triangle, x, y, values, levels, segments );
+        else
+          _bandTriangle( triangle, x, y, values, levels, parts );
+      }
+    }
+
+    if ( type == Lines )
+    {
+      for ( const Chain &chain : _chains( segments ) )
+      {
+        Part part;
+        part.level = segments[chain.pieces.front()].start.level;
+        part.start = segments[chain.pieces.front()].start;
+        part.end = segments[chain.pieces.back()].end;
+        part.isClosed = chain.isClosed;
+        _chainCoordinates( segments, chain, part.coordinates );
+        parts.push_back( std::move( part ) );
+      }
+    }
+  } );
+
+  // closed parts are complete, open lines are joined with the lines of the other tiles
+  std::vector<Part> openLines;
+  for ( std::vector<Part> &parts : tileParts )
+  {
+    for ( Part &part : parts )
+    {
+      if ( part.isClosed )
+        addPart( static_cast<int>( part.level ), part.coordinates.data(), part.coordinates.size() / 2, true );
+      else
+        openLines.push_back( std::move( part ) );
+    }
+    parts = std::vector<Part>();
+  }
+
+  std::vector<double> coordinates;
+  for ( const Chain &chain : _chains( openLines ) )
+  {
+    _chainCoordinates( openLines, chain, coordinates );
+    addPart( static_cast<int>( openLines[chain.pieces.front()].level ), coordinates.data(), coordinates.size() / 2, chain.isClosed );
+  }
+}
+
+void MDAL::ContourIterator::addPart( int levelIndex, const double *coordinates, size_t pointCount, bool isClosed )
+{
+  const size_t start = mCoordinates.size();
+  for ( size_t i = 0; i < pointCount; ++i )
+  {
+    const double px = coordinates[2 * i];
+    const double py = coordinates[2 * i + 1];
+    if ( mCoordinates.size() > start && mCoordinates[mCoordinates.size() - 2] == px && mCoordinates.back() == py )
+      continue;
+    mCoordinates.push_back( px );
+    mCoordinates.push_back( py );
+  }
+
+  // rings end with their first point
+  size_t count = ( mCoordinates.size() - start ) / 2;
+  if ( isClosed && count > 1 && mCoordinates[start] == mCoordinates[mCoordinates.size() - 2] &&
+       mCoordinates[start + 1] == mCoordinates.back() )
+  {
+    mCoordinates.resize( mCoordinates.size() - 2 );
+    --count;
+  }
+  if ( count < ( isClosed ? 3 : 2 ) )
+  {
+    mCoordinates.resize( start );
+    return;
+  }
+  if ( isClosed )
+  {
+    mCoordinates.push_back( mCoordinates[start] );
+    mCoordinates.push_back( mCoordinates[start + 1] );
+    ++count;
+  }
+
+  mLevelIndices.push_back( levelIndex );
+  mPointOffsets.push_back( mPointOffsets.back() + count );
+  mMaximumPointCount = std::max( mMaximumPointCount, count );
+}
+
+size_t MDAL::ContourIterator::next( size_t partCount,
+                                    int *levelIndexBuffer,
+                                    int *pointOffsetsBuffer,
+                                    size_t coordinatesBufferLen,
+                                    double *coordinatesBuffer )
+{
+  size_t parts = 0;
+  size_t points = 0;
+  while ( parts < partCount && mNextPart < mLevelIndices.size() )
+  {
+    const size_t first = mPointOffsets[mNextPart];
+    const size_t count = mPointOffsets[mNextPart + 1] - first;
+    if ( 2 * ( points + count ) > coordinatesBufferLen )
+      break;
+
+    memcpy( coordinatesBuffer + 2 * points, mCoordinates.data() + 2 * first, 2 * count * sizeof( double ) );
+    points += count;
+    levelIndexBuffer[parts] = mLevelIndices[mNextPart];
+    pointOffsetsBuffer[parts] = static_cast<int>( points );
+    ++parts;
+    ++mNextPart;
+  }
+  return parts;
+}
@@ -0,0 +1,70 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_CONTOURS_HPP
+#define MDAL_CONTOURS_HPP
+
+#include <stddef.h>
+#include <vector>
+
+namespace MDAL
+{
+  class Dataset;
+
+  /**
+   * Contour lines or bands of the dataset defined on vertices of 2D mesh, see MDAL_D_contourLines()
+   *
+   * Faces are split to triangles from their first vertex and contoured by marching triangles,
+   * values are interpolated linearly along the sides. Vertex with the value equal to the level
+   * is above the level. Triangles of inactive faces or with invalid (NaN) value are skipped,
+   * vectors are contoured as magnitudes.
+   *
+   * Faces are binned to spatial tiles that are contoured in parallel for all levels in one pass
+   * over the triangles. Segments of lines are joined to polylines by the sides they cross,
+   * first in each tile, then the open polylines of all tiles. Lines are oriented with the higher
+   * values on the right. Bands are polygons of the band in each triangle, they are not dissolved.
+   * The result does not depend on the thread count and is kept by the iterator until it is closed.
+   */
+  class ContourIterator
+  {
+    public:
+      enum Type
+      {
+        Lines,
+        Bands
+      };
+
+      //! Extracts the contours of the dataset for the ascending levels, band i is between levels i and i + 1
+      ContourIterator( Dataset &dataset, const std::vector<double> &levels, Type type );
+
+      /**
+       * Writes next polylines or polygons, see MDAL_CI_next()
+       * \returns number of parts written
+       */
+      size_t next( size_t partCount,
+                   int *levelIndexBuffer,
+                   int *pointOffsetsBuffer,
+                   size_t coordinatesBufferLen,
+                   double *coordinatesBuffer );
+
+      //! Number of points of the longest part
+      size_t maximumPointCount() const { return mMaximumPointCount; }
+
+      size_t partsCount() const { return mLevelIndices.size(); }
+
+    private:
+      //! Adds the part without repeated points, drops it when it has too few points
+      void addPart( int levelIndex, const double *coordinates, size_t pointCount, bool isClosed );
+
+      std::vector<int> mLevelIndices;
+      //! end offsets of the parts in points of mCoordinates
+      std::vector<size_t> mPointOffsets;
+      std::vector<double> mCoordinates;
+      size_t mMaximumPointCount = 0;
+      size_t mNextPart = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_CONTOURS_HPP
@@ -7,9 +7,26 @@
 #include <assert.h>
 #include <math.h>
 #include <algorithm>
+#include <vector>
+#include <string.h>
 #include "mdal_utils.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_block_cache.hpp"
+#include "mdal_perf.hpp"
+#include "mdal_prefetch.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_topology.hpp"
+#include "mdal_level_of_detail.hpp"
+#include "mdal_spatial_index.hpp"
+#include "mdal_background_load.hpp"
+#include "mdal_spill.hpp"
 
-MDAL::Dataset::~Dataset() = default;
+MDAL::Dataset::~Dataset()
+{
+  // the address may be reused by another dataset
+  Prefetcher::instance().cancel( this );
+  BlockCache::instance().remove( this );
+}
 
 MDAL::Dataset::Dataset( MDAL::DatasetGroup *parent )
   : mParent( parent )
@@ -17,6 +34,124 @@ MDAL::Dataset::Dataset( MDAL::DatasetGroup *parent )
   assert( mParent );
 }
 
+size_t MDAL::Dataset::data( MDAL_DataType type, size_t indexStart, size_t count, void *buffer )
+{
+  MDAL_PERF_SCOPE( perfScope, "data", PerfCounter::DataReads, PerfCounter::DataReadTime, group()->name() );
+  size_t written = 0;
+  switch ( type )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+      written = scalarData( indexStart, count, static_cast<double *>( buffer ) );
+      break;
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+      written = vectorData( indexStart, count, static_cast<double *>( buffer ) );
+      break;
+    case MDAL_DataType::ACTIVE_INTEGER:
+      written = activeData( indexStart, count, static_cast<int *>( buffer ) );
+      break;
+    case MDAL_DataType::VERTICAL_LEVEL_COUNT_INTEGER:
+      written = verticalLevelCountData( indexStart, count, static_cast<int *>( buffer ) );
+      break;
+    case MDAL_DataType::VERTICAL_LEVEL_DOUBLE:
+      written = verticalLevelData( indexStart, count, static_cast<double *>( buffer ) );
+      break;
+    case MDAL_DataType::FACE_INDEX_TO_VOLUME_INDEX_INTEGER:
+      written = faceToVolumeData( indexStart, count, static_cast<int *>( buffer ) );
+      break;
+    case MDAL_DataType::SCALAR_VOLUMES_DOUBLE:
+      written = scalarVolumesData( indexStart, count, static_cast<double *>( buffer ) );
+      break;
+    case MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE:
+      written = vectorVolumesData( indexStart, count, static_cast<double *>( buffer ) );
+      break;
+    case MDAL_DataType::SCALAR_FLOAT:
+      written = scalarDataFloat( indexStart, count, static_cast<float *>( buffer ) );
+      break;
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      written = vectorDataFloat( indexStart, count, static_cast<float *>( buffer ) );
+      break;
+    case MDAL_DataType::ACTIVE_BITS:
+      written = activeDataBits( indexStart, count, static_cast<unsigned char *>( buffer ) );
+      break;
+  }
+
+#ifdef HAVE_PERF_COUNTERS
+  const long long bytes = static_cast<long long>( BlockCache::bufferSize( type, written ) );
+  Perf::instance().add( PerfCounter::DataReadBytes, bytes );
+  group()->dataBytesCounter()->fetch_add( bytes, std::memory_order_relaxed );
+#endif
+  return written;
+}
+
+size_t MDAL::Dataset::dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer )
+{
+  size_t valueSize = 0;
+  switch ( type )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE: valueSize = sizeof( double ); break;
+    case MDAL_DataType::VECTOR_2D_DOUBLE: valueSize = 2 * sizeof( double ); break;
+    case MDAL_DataType::SCALAR_FLOAT: valueSize = sizeof( float ); break;
+    case MDAL_DataType::VECTOR_2D_FLOAT: valueSize = 2 * sizeof( float ); break;
+    case MDAL_DataType::ACTIVE_INTEGER: valueSize = sizeof( int ); break;
+    default: return 0;
+  }
+  if ( count == 0 )
+    return 0;
+
+  // positions of the requests sorted by the index
+  std::vector<size_t> order( count );
+  for ( size_t i = 0; i < count; ++i )
+    order[i] = i;
+  std::stable_sort( order.begin(), order.end(), [indices]( size_t a, size_t b ) { return indices[a] < indices[b]; } );
+
+  // indices closer than maxGap are read in one request, the values in between are skipped
+  const size_t maxGap = 64;
+  unsigned char *out = static_cast<unsigned char *>( buffer );
+  std::vector<unsigned char> run;
+  size_t i = 0;
+  while ( i < count )
+  {
+    const size_t first = indices[order[i]];
+    size_t runEnd = i + 1;
+    while ( runEnd < count && indices[order[runEnd]] - indices[order[runEnd - 1]] <= maxGap )
+      ++runEnd;
+    const size_t runCount = indices[order[runEnd - 1]] - first + 1;
+
+    run.resize( runCount * valueSize );
+    if ( data( type, first, runCount, run.data() ) != runCount )
+      return 0;
+    for ( size_t j = i; j < runEnd; ++j )
+      memcpy( out + order[j] * valueSize, run.data() + ( indices[order[j]] - first ) * valueSize, valueSize );
+    i = runEnd;
+  }
+  return count;
+}
+
+size_t MDAL::Dataset::validIndices( size_t indexStart, size_t count, size_t *buffer )
+{
+  const bool isScalar = group()->isScalar();
+  const size_t end = std::min( valuesCount(), indexStart + count );
+  const size_t blockSize = 4096;
+  std::vector<double> values( isScalar ? blockSize : 2 * blockSize );
+  size_t written = 0;
+  for ( size_t start = indexStart; start < end; start += blockSize )
+  {
+    const size_t requested = std::min( blockSize, end - start );
+    const size_t valuesRead = isScalar ? scalarData( start, requested, values.data() ) : vectorData( start, requested, values.data() );
+    for ( size_t i = 0; i < valuesRead; ++i )
+    {
+      const bool isValid = isScalar ?
+                           !std::isnan( values[i] ) :
+                           !std::isnan( values[2 * i] ) && !std::isnan( values[2 * i + 1] );
+      if ( isValid )
+        buffer[written++] = start + i;
+    }
+    if ( valuesRead < requested )
+      break;
+  }
+  return written;
+}
+
 size_t MDAL::Dataset::valuesCount() const
 {
   const MDAL_DataLocation location = group()->dataLocation();
@@ -36,14 +171,115 @@ size_t MDAL::Dataset::activeData( size_t, size_t, int * )
   return 0;
 }
 
-MDAL::Statistics MDAL::Dataset::statistics() const
+size_t MDAL::Dataset::activeDataBits( size_t indexStart, size_t count, unsigned char *buffer )
 {
+  // pieces are whole bytes, so each piece is packed to its own bytes
+  const size_t pieceCount = 4096;
+  std::vector<int> flags( std::min( count, pieceCount ) );
+  size_t written = 0;
+  while ( written < count )
+  {
+    const size_t requested = std::min( count - written, pieceCount );
+    const size_t flagsRead = activeData( indexStart + written, requested, flags.data() );
+    MDAL::packBits( flags.data(), flagsRead, buffer + written / 8 );
+    written += flagsRead;
+    if ( flagsRead < requested )
+      break;
+  }
+  return written;
+}
+
+//! Reads doubles by pieces and rounds them to the float buffer
+template <typename Read>
+static size_t _readAsFloat( size_t indexStart, size_t count, size_t valuesPerIndex, float *buffer, Read read )
+{
+  const size_t pieceCount = 4096;
+  std::vector<double> values( std::min( count, pieceCount ) * valuesPerIndex );
+  size_t written = 0;
+  while ( written < count )
+  {
+    const size_t requested = std::min( count - written, pieceCount );
+    const size_t valuesRead = read( indexStart + written, requested, values.data() );
+    for ( size_t i = 0; i < valuesRead * valuesPerIndex; ++i )
+      buffer[written * valuesPerIndex + i] = static_cast<float>( values[i] );
+    written += valuesRead;
+    if ( valuesRead < requested )
+      break;
+  }
+  return written;
+}
+
+size_t MDAL::Dataset::scalarDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  return _readAsFloat( indexStart, count, 1, buffer, [this]( size_t start, size_t n, double * values )
+  {
+    return scalarData( start, n, values );
+  } );
+}
+
+size_t MDAL::Dataset::vectorDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  return _readAsFloat( indexStart, count, 2, buffer, [this]( size_t start, size_t n, double * values )
+  {
+    return vectorData( start, n, values );
+  } );
+}
+
+size_t MDAL::Dataset::dataBlock( size_t, size_t, size_t, double * )
+{
+  return 0;
+}
+
+MDAL::Statistics MDAL::Dataset::statistics()
+{
+  {
+    std::lock_guard<std::mutex> lock( mStatisticsMutex );
+    if ( mHasStatistics )
+      return mStatistics;
+  }
+
+  // calculated without the lock, the reads take the library lock which the caller may hold already,
+  // concurrent first requests may calculate the statistics twice, the first result is kept
+  const Statistics statistics = MDAL::calculateStatistics( this );
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  if ( !mHasStatistics )
+  {
+    mStatistics = statistics;
+    mHasStatistics = true;
+  }
   return mStatistics;
 }
 
 void MDAL::Dataset::setStatistics( const MDAL::Statistics &statistics )
 {
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
   mStatistics = statistics;
+  mHasStatistics = true;
+}
+
+bool MDAL::Dataset::hasStatistics() const
+{
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  return mHasStatistics;
+}
+
+MDAL::Statistics MDAL::Dataset::statisticsWithSketch()
+{
+  {
+    std::lock_guard<std::mutex> lock( mStatisticsMutex );
+    if ( mHasStatistics && mStatistics.sketch )
+      return mStatistics;
+  }
+
+  // calculated without the lock like statistics()
+  const Statistics statistics = MDAL::calculateStatistics( this, true );
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  if ( !mHasStatistics || !mStatistics.sketch )
+  {
+    mStatistics = statistics;
+    mHasStatistics = true;
+  }
+  return mStatistics;
 }
 
 MDAL::DatasetGroup *MDAL::Dataset::group() const
@@ -76,6 +312,16 @@ bool MDAL::Dataset::supportsActiveFlag() const
   return mSupportsActiveFlag;
 }
 
+bool MDAL::Dataset::supportsConcurrentReads() const
+{
+  return false;
+}
+
+size_t MDAL::Dataset::memoryUsage() const
+{
+  return 0;
+}
+
 void MDAL::Dataset::setSupportsActiveFlag( bool value )
 {
   mSupportsActiveFlag = value;
@@ -147,6 +393,20 @@ std::string MDAL::DatasetGroup::driverName() const
   return mDriverName;
 }
 
+std::atomic<long long> *MDAL::DatasetGroup::dataBytesCounter()
+{
+  std::atomic<long long> *counter = mDataBytesCounter.load( std::memory_order_acquire );
+  if ( !counter )
+  {
+    // concurrent first reads resolve the same counter
+    counter = Perf::instance().counter( "driver." + mDriverName + ".data_bytes" );
+    mDataBytesCounter.store( counter, std::memory_order_release );
+  }
+  return counter;
+}
+
+MDAL::DatasetGroupWriter::~DatasetGroupWriter() = default;
+
 MDAL::DatasetGroup::~DatasetGroup() = default;
 
 MDAL::DatasetGroup::DatasetGroup( const std::string &driverName,
@@ -201,14 +461,110 @@ std::string MDAL::DatasetGroup::uri() const
   return mUri;
 }
 
-MDAL::Statistics MDAL::DatasetGroup::statistics() const
+MDAL::Statistics MDAL::DatasetGroup::statistics()
 {
+  {
+    std::lock_guard<std::mutex> lock( mStatisticsMutex );
+    if ( mHasStatistics )
+      return mStatistics;
+  }
+
+  // calculated without the lock, the reads take the library lock which the caller may hold already,
+  // concurrent first requests may calculate the statistics twice, the first result is kept
+  const Statistics statistics = MDAL::calculateStatistics( this );
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  if ( !mHasStatistics )
+  {
+    mStatistics = statistics;
+    mHasStatistics = true;
+  }
   return mStatistics;
 }
 
 void MDAL::DatasetGroup::setStatistics( const Statistics &statistics )
 {
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
   mStatistics = statistics;
+  mHasStatistics = true;
+}
+
+bool MDAL::DatasetGroup::hasStatistics() const
+{
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  return mHasStatistics;
+}
+
+MDAL::Statistics MDAL::DatasetGroup::statisticsWithSketch()
+{
+  {
+    std::lock_guard<std::mutex> lock( mStatisticsMutex );
+    if ( mHasStatistics && mStatistics.sketch )
+      return mStatistics;
+  }
+
+  // calculated without the lock like statistics()
+  const Statistics statistics = MDAL::calculateStatistics( this, true );
+  std::lock_guard<std::mutex> lock( mStatisticsMutex );
+  if ( !mHasStatistics || !mStatistics.sketch )
+  {
+    mStatistics = statistics;
+    mHasStatistics = true;
+  }
+  return mStatistics;
+}
+
+size_t MDAL::DatasetGroup::dataBlock( size_t datasetIndexStart, size_t datasetCount,
+                                      size_t indexStart, size_t count,
+                                      MDAL_DataBlockLayout layout, double *buffer )
+{
+  if ( datasetCount == 0 || count == 0 || datasetIndexStart + datasetCount > datasets.size() )
+    return 0;
+
+  Dataset *first = datasets[datasetIndexStart].get();
+  if ( indexStart + count > first->valuesCount() )
+    return 0;
+
+  const bool scalar = isScalar();
+  const size_t valuesPerIndex = scalar ? 1 : 2;
+  const size_t datasetValues = count * valuesPerIndex;
+
+  // time major block is read directly to the output
+  std::vector<double> block;
+  double *blockBuffer = buffer;
+  if ( layout == IndexMajor )
+  {
+    block.resize( datasetCount * datasetValues );
+    blockBuffer = block.data();
+  }
+
+  DatasetReadLock lock( first );
+  if ( first->dataBlock( datasetCount, indexStart, count, blockBuffer ) != count )
+  {
+    for ( size_t i = 0; i < datasetCount; ++i )
+    {
+      Dataset *dataset = datasets[datasetIndexStart + i].get();
+      double *datasetBuffer = blockBuffer + i * datasetValues;
+      const size_t read = scalar ?
+                          dataset->scalarData( indexStart, count, datasetBuffer ) :
+                          dataset->vectorData( indexStart, count, datasetBuffer );
+      if ( read != count )
+        return 0;
+    }
+  }
+
+  if ( layout == IndexMajor )
+  {
+    for ( size_t i = 0; i < datasetCount; ++i )
+    {
+      for ( size_t j = 0; j < count; ++j )
+      {
+        for ( size_t k = 0; k < valuesPerIndex; ++k )
+          buffer[( j * datasetCount + i ) * valuesPerIndex + k] = block[i * datasetValues + j * valuesPerIndex + k];
+      }
+    }
+  }
+
+  return datasetCount * count;
 }
 
 MDAL::DateTime MDAL::DatasetGroup::referenceTime() const
@@ -221,6 +577,73 @@ void MDAL::DatasetGroup::setReferenceTime( const DateTime &referenceTime )
   mReferenceTime = referenceTime;
 }
 
+const size_t MDAL::DatasetGroup::NO_DATASET;
+
+void MDAL::DatasetGroup::updateTimeAxis()
+{
+  if ( mTimeAxisDatasets.size() == datasets.size() )
+    return;
+
+  std::vector<std::pair<double, size_t>> times( datasets.size() );
+  for ( size_t i = 0; i < datasets.size(); ++i )
+    times[i] = std::make_pair( datasets[i]->time( RelativeTimestamp::milliseconds ), i );
+  // stable for the datasets with equal times
+  std::sort( times.begin(), times.end() );
+
+  mTimeAxis.resize( times.size() );
+  mTimeAxisDatasets.resize( times.size() );
+  for ( size_t i = 0; i < times.size(); ++i )
+  {
+    mTimeAxis[i] = times[i].first;
+    mTimeAxisDatasets[i] = times[i].second;
+  }
+}
+
+size_t MDAL::DatasetGroup::datasetIndexAtTime( const RelativeTimestamp &time )
+{
+  std::lock_guard<std::mutex> lock( mTimeAxisMutex );
+  updateTimeAxis();
+  if ( mTimeAxis.empty() )
+    return NO_DATASET;
+
+  const double value = time.value( RelativeTimestamp::milliseconds );
+  const size_t next = static_cast<size_t>( std::lower_bound( mTimeAxis.begin(), mTimeAxis.end(), value ) - mTimeAxis.begin() );
+  if ( next == 0 )
+    return mTimeAxisDatasets.front();
+  if ( next == mTimeAxis.size() )
+    return mTimeAxisDatasets.back();
+  if ( value - mTimeAxis[next - 1] <= mTimeAxis[next] - value )
+    return mTimeAxisDatasets[next - 1];
+  return mTimeAxisDatasets[next];
+}
+
+bool MDAL::DatasetGroup::datasetsAroundTime( const RelativeTimestamp &time, size_t &before, size_t &after, double &position )
+{
+  std::lock_guard<std::mutex> lock( mTimeAxisMutex );
+  updateTimeAxis();
+  if ( mTimeAxis.empty() )
+    return false;
+
+  const double value = time.value( RelativeTimestamp::milliseconds );
+  const size_t next = static_cast<size_t>( std::upper_bound( mTimeAxis.begin(), mTimeAxis.end(), value ) - mTimeAxis.begin() );
+  position = 0;
+  if ( next == 0 )
+  {
+    before = after = mTimeAxisDatasets.front();
+  }
+  else if ( next == mTimeAxis.size() )
+  {
+    before = after = mTimeAxisDatasets.back();
+  }
+  else
+  {
+    before = mTimeAxisDatasets[next - 1];
+    after = mTimeAxisDatasets[next];
+    position = ( value - mTimeAxis[next - 1] ) / ( mTimeAxis[next] - mTimeAxis[next - 1] );
+  }
+  return true;
+}
+
 MDAL::Mesh *MDAL::DatasetGroup::mesh() const
 {
   return mParent;
@@ -253,6 +676,16 @@ void MDAL::DatasetGroup::stopEditing()
   mInEditMode = false;
 }
 
+MDAL::DatasetGroupWriter *MDAL::DatasetGroup::writer() const
+{
+  return mWriter.get();
+}
+
+void MDAL::DatasetGroup::setWriter( std::unique_ptr<MDAL::DatasetGroupWriter> writer )
+{
+  mWriter = std::move( writer );
+}
+
 MDAL_DataLocation MDAL::DatasetGroup::dataLocation() const
 {
   return mDataLocation;
@@ -286,7 +719,8 @@ MDAL::Mesh::Mesh(
   size_t faceVerticesMaximumCount,
   MDAL::BBox extent,
   const std::string &uri )
-  : mDriverName( driverName )
+  : mMemoryArena( std::make_shared<MemoryArena>() )
+  , mDriverName( driverName )
   , mVerticesCount( verticesCount )
   , mFacesCount( facesCount )
   , mFaceVerticesMaximumCount( faceVerticesMaximumCount )
@@ -295,12 +729,134 @@ MDAL::Mesh::Mesh(
 {
 }
 
+std::shared_ptr<MDAL::MemoryArena> MDAL::Mesh::memoryArena() const
+{
+  return mMemoryArena;
+}
+
+size_t MDAL::Mesh::memoryUsage() const
+{
+  size_t usage = mMemoryArena->reservedSize();
+  for ( const std::shared_ptr<DatasetGroup> &group : datasetGroups )
+  {
+    for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+      usage += dataset->memoryUsage();
+  }
+
+  std::lock_guard<std::mutex> lock( mLevelsOfDetailMutex );
+  if ( mLevelsOfDetail )
+    usage += mLevelsOfDetail->memoryUsage();
+  return usage;
+}
+
 std::string MDAL::Mesh::driverName() const
 {
   return mDriverName;
 }
 
-MDAL::Mesh::~Mesh() = default;
+MDAL::Mesh::~Mesh()
+{
+  stopBackgroundLoad();
+}
+
+void MDAL::Mesh::startBackgroundLoad()
+{
+  mBackgroundLoad.reset( new BackgroundLoad( datasetGroups ) );
+}
+
+MDAL::BackgroundLoad *MDAL::Mesh::backgroundLoad() const
+{
+  return mBackgroundLoad.get();
+}
+
+void MDAL::Mesh::stopBackgroundLoad()
+{
+  if ( mBackgroundLoad )
+    mBackgroundLoad->stop();
+}
+
+size_t MDAL::Mesh::uniformFaceVerticesCount()
+{
+  std::lock_guard<std::mutex> lock( mUniformFaceVerticesMutex );
+  if ( mIsUniformFaceVerticesKnown )
+    return mUniformFaceVerticesCount;
+
+  const size_t facesCount = this->facesCount();
+  const size_t faceVerticesMax = faceVerticesMaximumCount();
+  size_t uniformCount = facesCount > 0 ? faceVerticesMax : 0;
+  if ( uniformCount > 0 )
+  {
+    // the faces are uniform when each face has the maximum number of vertices
+    const size_t blockSize = 65536;
+    std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+    std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+    std::unique_ptr<MeshFaceIterator> faceIterator = readFaces();
+    size_t facesRead = 0;
+    while ( facesRead < facesCount && uniformCount > 0 )
+    {
+      const size_t count = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                           vertexIndices.size(), vertexIndices.data() );
+      if ( count == 0 )
+        break;
+      for ( size_t i = 0; i < count; ++i )
+      {
+        if ( static_cast<size_t>( faceOffsets[i] ) != ( i + 1 ) * faceVerticesMax )
+        {
+          uniformCount = 0;
+          break;
+        }
+      }
+      facesRead += count;
+    }
+  }
+
+  mUniformFaceVerticesCount = uniformCount;
+  mIsUniformFaceVerticesKnown = true;
+  return mUniformFaceVerticesCount;
+}
+
+const MDAL::MeshTopology &MDAL::Mesh::topology()
+{
+  std::lock_guard<std::mutex> lock( mTopologyMutex );
+  if ( !mTopology )
+    mTopology.reset( new MeshTopology( this ) );
+  return *mTopology;
+}
+
+MDAL::MeshPyramid &MDAL::Mesh::levelsOfDetail()
+{
+  std::lock_guard<std::mutex> lock( mLevelsOfDetailMutex );
+  if ( !mLevelsOfDetail )
+    mLevelsOfDetail.reset( new MeshPyramid( this ) );
+  return *mLevelsOfDetail;
+}
+
+void MDAL::Mesh::setFileEdges( std::vector<uint32_t> edges )
+{
+  assert( edges.size() % 2 == 0 );
+  mFileEdges = std::move( edges );
+}
+
+const std::vector<uint32_t> &MDAL::Mesh::fileEdges() const
+{
+  return mFileEdges;
+}
+
+const MDAL::HilbertRTree &MDAL::Mesh::faceTree()
+{
+  std::lock_guard<std::mutex> lock( mTreesMutex );
+  if ( !mFaceTree )
+    mFaceTree = buildFaceTree( *this );
+  return *mFaceTree;
+}
+
+const MDAL::HilbertRTree &MDAL::Mesh::vertexTree()
+{
+  std::lock_guard<std::mutex> lock( mTreesMutex );
+  if ( !mVertexTree )
+    mVertexTree = buildVertexTree( *this );
+  return *mVertexTree;
+}
 
 std::shared_ptr<MDAL::DatasetGroup> MDAL::Mesh::group( const std::string &name )
 {
@@ -333,6 +889,39 @@ void MDAL::Mesh::setSourceCrsFromPrjFile( const std::string &filename )
   setSourceCrs( proj );
 }
 
+size_t MDAL::Mesh::vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z )
+{
+  const size_t maxVertices = verticesCount();
+  if ( ( count < 1 ) || ( indexStart >= maxVertices ) )
+    return 0;
+
+  const size_t lastIndex = std::min( maxVertices, indexStart + count );
+  const size_t bufferLen = 2000;
+  std::vector<double> buffer( 3 * bufferLen );
+  std::unique_ptr<MDAL::MeshVertexIterator> it = readVertices();
+
+  size_t index = 0;
+  size_t written = 0;
+  while ( index < lastIndex )
+  {
+    const size_t read = it->next( std::min( bufferLen, lastIndex - index ), buffer.data() );
+    if ( read == 0 )
+      break;
+
+    for ( size_t i = 0; i < read; ++i, ++index )
+    {
+      if ( index < indexStart )
+        continue;
+
+      if ( x ) x[written] = buffer[3 * i];
+      if ( y ) y[written] = buffer[3 * i + 1];
+      if ( z ) z[written] = buffer[3 * i + 2];
+      ++written;
+    }
+  }
+  return written;
+}
+
 size_t MDAL::Mesh::verticesCount() const
 {
   return mVerticesCount;
@@ -366,3 +955,20 @@ size_t MDAL::Mesh::faceVerticesMaximumCount() const
 MDAL::MeshVertexIterator::~MeshVertexIterator() = default;
 
 MDAL::MeshFaceIterator::~MeshFaceIterator() = default;
+
+size_t MDAL::MeshFaceIterator::next64( size_t faceOffsetsBufferLen,
+                                       int64_t *faceOffsetsBuffer,
+                                       size_t vertexIndicesBufferLen,
+                                       int64_t *vertexIndicesBuffer )
+{
+  std::vector<int> offsets( faceOffsetsBufferLen );
+  std::vector<int> indices( vertexIndicesBufferLen );
+  const size_t count = next( faceOffsetsBufferLen, offsets.data(), vertexIndicesBufferLen, indices.data() );
+  if ( count == 0 )
+    return 0;
+
+  std::copy( offsets.begin(), offsets.begin() + static_cast<std::ptrdiff_t>( count ), faceOffsetsBuffer );
+  const size_t indicesCount = static_cast<size_t>( offsets[count - 1] );
+  std::copy( indices.begin(), indices.begin() + static_cast<std::ptrdiff_t>( indicesCount ), vertexIndicesBuffer );
+  return count;
+}
@@ -7,11 +7,14 @@
 #define MDAL_DATA_MODEL_HPP
 
 #include <stddef.h>
+#include <stdint.h>
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <map>
 #include <string>
 #include <limits>
+#include <mutex>
 #include "mdal.h"
 #include "mdal_datetime.hpp"
 
@@ -19,6 +22,12 @@ namespace MDAL
 {
   class DatasetGroup;
   class Mesh;
+  class MeshTopology;
+  class MeshPyramid;
+  class HilbertRTree;
+  class BackgroundLoad;
+  class MemoryArena;
+  class QuantileSketch;
 
   struct BBox
   {
@@ -35,6 +44,8 @@ namespace MDAL
   {
     double minimum = std::numeric_limits<double>::quiet_NaN();
     double maximum = std::numeric_limits<double>::quiet_NaN();
+    //! Distribution of the values (magnitudes for vectors), nullptr when not calculated
+    std::shared_ptr<const QuantileSketch> sketch;
   } Statistics;
 
   typedef std::vector< std::pair< std::string, std::string > > Metadata;
@@ -51,8 +62,14 @@ namespace MDAL
       virtual size_t scalarData( size_t indexStart, size_t count, double *buffer ) = 0;
       //! For DataOnVertices2D or DataOnFaces2D
       virtual size_t vectorData( size_t indexStart, size_t count, double *buffer ) = 0;
+      //! For DataOnVertices2D or DataOnFaces2D, rounds values read by scalarData() by default
+      virtual size_t scalarDataFloat( size_t indexStart, size_t count, float *buffer );
+      //! For DataOnVertices2D or DataOnFaces2D, rounds values read by vectorData() by default
+      virtual size_t vectorDataFloat( size_t indexStart, size_t count, float *buffer );
       //! For drivers that supports it, see supportsActiveFlag()
       virtual size_t activeData( size_t indexStart, size_t count, int *buffer );
+      //! Active flags packed to bits, see ACTIVE_BITS. Packs flags read by activeData() by default
+      virtual size_t activeDataBits( size_t indexStart, size_t count, unsigned char *buffer );
 
       //! For DataOnVolumes3D
       virtual size_t verticalLevelCountData( size_t indexStart, size_t count, int *buffer ) = 0;
@@ -65,11 +82,47 @@ namespace MDAL
       //! For DataOnVolumes3D
       virtual size_t vectorVolumesData( size_t indexStart, size_t count, double *buffer ) = 0;
 
+      /**
+       * Reads values of datasetCount datasets of the group, this one and the following ones,
+       * for DataOnVertices2D or DataOnFaces2D at once as buffer[dataset][index]
+       *
+       * Implemented by drivers storing all time steps of the group in one array,
+       * returns 0 when not supported and the datasets are read one by one then
+       */
+      virtual size_t dataBlock( size_t datasetCount, size_t indexStart, size_t count, double *buffer );
+
+      //! Reads count values of the type to buffer, calls the virtual function for the type
+      size_t data( MDAL_DataType type, size_t indexStart, size_t count, void *buffer );
+
+      /**
+       * Reads values of the type at the indices to buffer, in the order of the indices
+       * Only SCALAR_DOUBLE, SCALAR_FLOAT, VECTOR_2D_DOUBLE, VECTOR_2D_FLOAT and ACTIVE_INTEGER
+       * types are supported, indices must be valid.
+       * Default implementation reads runs of close indices by data(), drivers able to
+       * read scattered values directly (memory, HDF5 element selection) override it
+       * \returns number of values written, 0 on error
+       */
+      virtual size_t dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer );
+
+      /**
+       * Writes indices of the valid values (not NaN, both components for vectors) within
+       * [indexStart, indexStart + count) to buffer, for DataOnVertices2D or DataOnFaces2D
+       * Default implementation reads the values in blocks, sparse datasets list them from their runs
+       * \returns number of indices written, at most count
+       */
+      virtual size_t validIndices( size_t indexStart, size_t count, size_t *buffer );
+
       virtual size_t volumesCount() const = 0;
       virtual size_t maximumVerticalLevelsCount() const = 0;
 
-      Statistics statistics() const;
+      //! Returns statistics, these are calculated on first request when not set by the driver
+      Statistics statistics();
       void setStatistics( const Statistics &statistics );
+      //! Whether statistics are already set or calculated
+      bool hasStatistics() const;
+
+      //! Returns statistics with the quantile sketch, calculates them again when the sketch is missing
+      Statistics statisticsWithSketch();
 
       bool isValid() const;
 
@@ -83,12 +136,24 @@ namespace MDAL
       bool supportsActiveFlag() const;
       void setSupportsActiveFlag( bool value );
 
+      /**
+       * Whether the data can be read from several threads at once without locking
+       * False for datasets read from files, these are read with libraryMutex() held
+       */
+      virtual bool supportsConcurrentReads() const;
+
+      //! Bytes of the memory held by the dataset outside of the memory arena of its mesh, see Mesh::memoryUsage()
+      virtual size_t memoryUsage() const;
+
     private:
       RelativeTimestamp mTime;
       bool mIsValid = true;
       bool mSupportsActiveFlag = false;
       DatasetGroup *mParent = nullptr;
       Statistics mStatistics;
+      bool mHasStatistics = false;
+      //! Guards the statistics only, never held while calling other code
+      mutable std::mutex mStatisticsMutex;
   };
 
   class Dataset2D: public Dataset
@@ -131,6 +196,16 @@ namespace MDAL
 
   typedef std::vector<std::shared_ptr<Dataset>> Datasets;
 
+  /**
+   * State of the driver that writes the datasets of a group in edit mode
+   * to the file as they are added, instead of persisting them all at the end
+   */
+  class DatasetGroupWriter
+  {
+    public:
+      virtual ~DatasetGroupWriter();
+  };
+
   class DatasetGroup
   {
     public:
@@ -165,12 +240,46 @@ namespace MDAL
 
       std::string uri() const;
 
-      Statistics statistics() const;
+      //! Returns statistics, these are calculated from datasets statistics on first request when not set by the driver
+      Statistics statistics();
       void setStatistics( const Statistics &statistics );
+      //! Whether statistics are already set or calculated
+      bool hasStatistics() const;
+
+      //! Returns statistics with the quantile sketch merged from the sketches of the datasets
+      Statistics statisticsWithSketch();
+
+      /**
+       * Reads values of datasets [datasetIndexStart, datasetIndexStart + datasetCount) for
+       * indexes [indexStart, indexStart + count), 2 values per index for vector data
+       * \returns number of values written, datasetCount * count, or 0 on invalid range
+       */
+      size_t dataBlock( size_t datasetIndexStart, size_t datasetCount,
+                        size_t indexStart, size_t count,
+                        MDAL_DataBlockLayout layout, double *buffer );
 
       DateTime referenceTime() const;
       void setReferenceTime( const DateTime &referenceTime );
 
+      static const size_t NO_DATASET = std::numeric_limits<size_t>::max();
+
+      /**
+       * Index of the dataset with the time nearest to the time, the earlier one when two are equally near
+       *
+       * Binary search in the time axis of the group, the times of the datasets sorted once on the first
+       * lookup and again when datasets were added since. \returns NO_DATASET for the group without datasets
+       */
+      size_t datasetIndexAtTime( const RelativeTimestamp &time );
+
+      /**
+       * Indices of the last dataset at or before the time and the first one after it, with the position
+       * of the time between their times (0 at the first one, 1 at the second one)
+       *
+       * Both indices are of the first or the last dataset and the position is 0 for the time outside of
+       * the time range. \returns false for the group without datasets
+       */
+      bool datasetsAroundTime( const RelativeTimestamp &time, size_t &before, size_t &after, double &position );
+
       Mesh *mesh() const;
 
       size_t maximumVerticalLevelsCount() const;
@@ -179,8 +288,17 @@ namespace MDAL
       void startEditing();
       void stopEditing();
 
+      //! Writer of the group in edit mode, nullptr when the driver does not write the datasets incrementally
+      DatasetGroupWriter *writer() const;
+      void setWriter( std::unique_ptr<DatasetGroupWriter> writer );
+
+      //! driver.<driverName>.data_bytes perf counter of the reads of the datasets, resolved on the first call
+      std::atomic<long long> *dataBytesCounter();
+
     private:
       bool mInEditMode = false;
+      std::unique_ptr<DatasetGroupWriter> mWriter;
+      std::atomic<std::atomic<long long> *> mDataBytesCounter{ nullptr };
 
       const std::string mDriverName;
       Mesh *mParent = nullptr;
@@ -188,7 +306,18 @@ namespace MDAL
       MDAL_DataLocation mDataLocation = MDAL_DataLocation::DataOnVertices2D;
       std::string mUri; // file/uri from where it came
       Statistics mStatistics;
+      bool mHasStatistics = false;
+      //! Guards the statistics only, never held while calling other code
+      mutable std::mutex mStatisticsMutex;
       DateTime mReferenceTime;
+
+      //! Sorts the dataset times unless the axis is up to date, called with mTimeAxisMutex held
+      void updateTimeAxis();
+
+      std::mutex mTimeAxisMutex;
+      //! times (ms) of the datasets in ascending order and the indices of the datasets with them
+      std::vector<double> mTimeAxis;
+      std::vector<size_t> mTimeAxisDatasets;
   };
 
   typedef std::vector<std::shared_ptr<DatasetGroup>> DatasetGroups;
@@ -210,6 +339,15 @@ namespace MDAL
                            int *faceOffsetsBuffer,
                            size_t vertexIndicesBufferLen,
                            int *vertexIndicesBuffer ) = 0;
+
+      /**
+       * Same as next() with 64-bit face offsets and vertex indices, for meshes beyond 2^31 vertices or face vertices
+       * Default implementation widens the values returned by next(), iterators of large meshes override it
+       */
+      virtual size_t next64( size_t faceOffsetsBufferLen,
+                             int64_t *faceOffsetsBuffer,
+                             size_t vertexIndicesBufferLen,
+                             int64_t *vertexIndicesBuffer );
   };
 
   class Mesh
@@ -235,6 +373,14 @@ namespace MDAL
       virtual std::unique_ptr<MDAL::MeshVertexIterator> readVertices() = 0;
       virtual std::unique_ptr<MDAL::MeshFaceIterator> readFaces() = 0;
 
+      /**
+       * Copies coordinates of count vertices starting from indexStart to the separate
+       * x, y and z arrays. Any of the buffers can be null to skip that coordinate.
+       * Default implementation uses vertex iterator
+       * \returns number of vertices written
+       */
+      virtual size_t vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z );
+
       DatasetGroups datasetGroups;
 
       //! Find a dataset group by name
@@ -247,7 +393,71 @@ namespace MDAL
       std::string crs() const;
       size_t faceVerticesMaximumCount() const;
 
+      /**
+       * Number of vertices of every face when all faces have the same number of vertices
+       * (e.g. triangle or quad meshes), 0 otherwise or for mesh without faces
+       * Default implementation reads the faces on first request, meshes with faces in memory override it
+       */
+      virtual size_t uniformFaceVerticesCount();
+
+      //! Adjacency of the vertices and faces, built on first request, faces must not change afterwards
+      const MeshTopology &topology();
+
+      //! Simplified meshes for rendering at lower resolutions, built on first request, the mesh must not change afterwards
+      MeshPyramid &levelsOfDetail();
+
+      /**
+       * Sets edges read from the file, topology() takes them instead of building them from the faces
+       * Edge i connects vertices edges[2 * i] and edges[2 * i + 1]
+       */
+      void setFileEdges( std::vector<uint32_t> edges );
+      const std::vector<uint32_t> &fileEdges() const;
+
+      //! Spatial index of the bounding boxes of the faces, built on first request, faces must not change afterwards
+      const HilbertRTree &faceTree();
+
+      //! Spatial index of the vertices, built on first request, vertices must not change afterwards
+      const HilbertRTree &vertexTree();
+
+      //! Starts calculation of the statistics of the groups loaded so far on a background thread, see BackgroundLoad
+      void startBackgroundLoad();
+
+      //! Background calculation of the statistics started by the load, null when there is none
+      BackgroundLoad *backgroundLoad() const;
+
+      /**
+       * Stops the background calculation of the statistics, the caller must not hold libraryMutex()
+       * To be called before the mesh is deleted, as it reads the datasets of the derived meshes
+       */
+      void stopBackgroundLoad();
+
+      //! Arena of the arrays of the memory datasets of the mesh, kept until the mesh and all its datasets are deleted
+      std::shared_ptr<MemoryArena> memoryArena() const;
+
+      /**
+       * Bytes of the memory held by the mesh and its datasets, including the blocks spilled to temporary files
+       *
+       * The memory arena counts whole, with the space of the removed datasets and the unused rest of its chunks.
+       * Meshes and datasets read from files on request hold only their caches, which are not counted.
+       * Levels of detail count once built.
+       */
+      virtual size_t memoryUsage() const;
+
     private:
+      std::shared_ptr<MemoryArena> mMemoryArena;
+      std::unique_ptr<MeshTopology> mTopology;
+      std::mutex mTopologyMutex;
+      std::unique_ptr<MeshPyramid> mLevelsOfDetail;
+      mutable std::mutex mLevelsOfDetailMutex;
+      std::mutex mUniformFaceVerticesMutex;
+      bool mIsUniformFaceVerticesKnown = false;
+      size_t mUniformFaceVerticesCount = 0;
+      std::vector<uint32_t> mFileEdges;
+      std::unique_ptr<HilbertRTree> mFaceTree;
+      std::unique_ptr<HilbertRTree> mVertexTree;
+      std::mutex mTreesMutex;
+      std::unique_ptr<BackgroundLoad> mBackgroundLoad;
+
       const std::string mDriverName;
       size_t mVerticesCount = 0;
       size_t mFacesCount = 0;
@@ -3,6 +3,9 @@
  Copyright (C) 2018 Peter Petrik (zilolv at gmail dot com)
 */
 
+#include <assert.h>
+#include <cstdio>
+
 #include "mdal_config.hpp"
 #include "mdal_driver_manager.hpp"
 #include "frmts/mdal_2dm.hpp"
@@ -10,7 +13,16 @@
 #include "frmts/mdal_binary_dat.hpp"
 #include "frmts/mdal_selafin.hpp"
 #include "frmts/mdal_esri_tin.hpp"
+#include "frmts/mdal_snapshot.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_options.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_perf.hpp"
+#include "mdal_progress.hpp"
+#include "mdal_memory_data_model.hpp"
+#include "mdal_sparse_dataset.hpp"
+#include "mdal_statistics_cache.hpp"
+#include "mdal_reorder.hpp"
 
 #ifdef HAVE_HDF5
 #include "frmts/mdal_xmdf.hpp"
@@ -37,6 +49,108 @@
 #include "frmts/mdal_xdmf.hpp"
 #endif
 
+template<typename T>
+static MDAL::DriverDescriptor _descriptor( const std::string &name, int capabilityFlags )
+{
+  MDAL::DriverDescriptor descriptor;
+  descriptor.name = name;
+  descriptor.capabilityFlags = capabilityFlags;
+  descriptor.canReadSignature = &T::canReadSignature;
+  descriptor.create = []() -> MDAL::Driver * { return new T(); };
+  return descriptor;
+}
+
+//! Counts of the datasets of the groups, to tell the datasets added by a load from the ones loaded before
+static std::map<MDAL::DatasetGroup *, size_t> _datasetCounts( const MDAL::DatasetGroups &groups )
+{
+  std::map<MDAL::DatasetGroup *, size_t> counts;
+  for ( const std::shared_ptr<MDAL::DatasetGroup> &group : groups )
+    counts[group.get()] = group->datasets.size();
+  return counts;
+}
+
+/**
+ * Discards the groups and the datasets added by a cancelled load, groupsCount and datasetCounts
+ * are the counts before the load. Statistics of the groups loaded before are calculated again.
+ */
+static void _rollbackLoad( MDAL::Mesh *mesh, size_t groupsCount, const std::map<MDAL::DatasetGroup *, size_t> &datasetCounts )
+{
+  mesh->datasetGroups.erase( mesh->datasetGroups.begin() + static_cast<MDAL::DatasetGroups::difference_type>( groupsCount ), mesh->datasetGroups.end() );
+  for ( const std::shared_ptr<MDAL::DatasetGroup> &group : mesh->datasetGroups )
+  {
+    auto it = datasetCounts.find( group.get() );
+    if ( it == datasetCounts.end() || group->datasets.size() <= it->second )
+      continue;
+
+    group->datasets.resize( it->second );
+    if ( group->hasStatistics() )
+      group->setStatistics( MDAL::calculateStatistics( group ) );
+  }
+}
+
+/**
+ * Replaces mostly invalid memory datasets of the groups with sparse ones when SPARSE_DATASETS
+ * open option is set and compresses the rest when COMPRESS_DATASETS is set, datasets are processed in parallel
+ *
+ * Only the datasets added by the load are processed, the ones loaded before (datasetCounts of the groups
+ * before the load) may be held by the caller already and are never replaced
+ */
+static void _storeMemoryDatasets( const MDAL::DatasetGroups &groups, const std::map<MDAL::DatasetGroup *, size_t> &datasetCounts )
+{
+  const double sparseFraction = MDAL::sparseDatasetsFraction();
+  const bool compress = MDAL::openOptionAsBool( MDAL::OPTION_COMPRESS_DATASETS );
+  if ( sparseFraction < 0 && !compress )
+    return;
+
+  std::vector<std::shared_ptr<MDAL::Dataset> *> datasets;
+  for ( const std::shared_ptr<MDAL::DatasetGroup> &group : groups )
+  {
+    auto it = datasetCounts.find( group.get() );
+    const size_t firstDataset = it == datasetCounts.end() ? 0 : it->second;
+    for ( size_t i = firstDataset; i < group->datasets.size(); ++i )
+    {
+      std::shared_ptr<MDAL::Dataset> &dataset = group->datasets[i];
+      MDAL::MemoryDataset2D *memoryDataset = dynamic_cast<MDAL::MemoryDataset2D *>( dataset.get() );
+      if ( memoryDataset && !memoryDataset->isCompressed() )
+        datasets.push_back( &dataset );
+    }
+  }
+
+  MDAL::parallelFor( datasets.size(), [&datasets, sparseFraction, compress]( size_t i )
+  {
+    std::shared_ptr<MDAL::Dataset> &dataset = *datasets[i];
+    if ( sparseFraction >= 0 )
+      dataset = MDAL::sparseIfMostlyInvalid( std::static_pointer_cast<MDAL::MemoryDataset2D>( dataset ), sparseFraction );
+
+    MDAL::MemoryDataset2D *memoryDataset = dynamic_cast<MDAL::MemoryDataset2D *>( dataset.get() );
+    if ( compress && memoryDataset )
+      memoryDataset->compress();
+  } );
+}
+
+/**
+ * Reorders datasets loaded for the reordered mesh, groups that cannot be reordered are removed
+ * datasetCounts are counts of datasets of the groups before the load
+ */
+static void _reorderLoadedDatasets( MDAL::MemoryMesh *mesh, const std::map<MDAL::DatasetGroup *, size_t> &datasetCounts, MDAL_Status *status )
+{
+  MDAL::DatasetGroups &groups = mesh->datasetGroups;
+  for ( size_t i = 0; i < groups.size(); )
+  {
+    auto it = datasetCounts.find( groups[i].get() );
+    const size_t firstDataset = it == datasetCounts.end() ? 0 : it->second;
+    if ( firstDataset < groups[i]->datasets.size() &&
+         !MDAL::reorderDatasets( mesh, groups[i].get(), firstDataset ) )
+    {
+      MDAL::debug( "Dataset group " + groups[i]->name() + " on volumes cannot be loaded for reordered mesh" );
+      if ( status ) *status = MDAL_Status::Err_IncompatibleDataset;
+      groups.erase( groups.begin() + static_cast<MDAL::DatasetGroups::difference_type>( i ) );
+      continue;
+    }
+    ++i;
+  }
+}
+
 std::unique_ptr<MDAL::Mesh> MDAL::DriverManager::load( const std::string &meshFile, MDAL_Status *status ) const
 {
   std::unique_ptr<MDAL::Mesh> mesh;
@@ -47,24 +161,83 @@ std::unique_ptr<MDAL::Mesh> MDAL::DriverManager::load( const std::string &meshFi
     return std::unique_ptr<MDAL::Mesh>();
   }
 
-  for ( const auto &driver : mDrivers )
+  MDAL_PERF_SCOPE( perfScope, "load", PerfCounter::Loads, PerfCounter::LoadTime, meshFile );
+  const ProgressScope progressScope;
+  Progress &progress = Progress::current();
+  const StatisticsCache cache( meshFile );
+  const bool isProgressive = openOptionAsBool( OPTION_PROGRESSIVE_LOAD );
   {
-    if ( ( driver->hasCapability( Capability::ReadMesh ) ) &&
-         driver->canReadMesh( meshFile ) )
+    // statistics are taken from the cache or calculated in the background, there is no need to calculate them during the load
+    std::unique_ptr<ScopedOpenOption> lazyStatistics;
+    if ( cache.hasEntry() || isProgressive )
+      lazyStatistics.reset( new ScopedOpenOption( OPTION_LAZY_STATISTICS, "YES" ) );
+
+    std::shared_ptr<Driver> cachedDriver;
+    for ( const auto &driver : candidateDrivers( meshFile, Capability::ReadMesh, cachedDriver ) )
     {
-      std::unique_ptr<Driver> drv( driver->create() );
-      mesh = drv->load( meshFile, status );
-      if ( mesh ) // stop if he have the mesh
-        break;
+      if ( driver == cachedDriver || driver->canReadMesh( meshFile ) )
+      {
+        std::unique_ptr<Driver> drv( driver->create() );
+        MDAL_PERF_DRIVER_SCOPE( driverScope, driver->name(), "load" );
+        mesh = drv->load( meshFile, status );
+        if ( progress.isCancelled() )
+        {
+          mesh.reset();
+          break;
+        }
+        if ( mesh ) // stop if he have the mesh
+        {
+          cacheDriver( meshFile, Capability::ReadMesh, driver );
+          if ( openOptionAsBool( OPTION_REORDER_ELEMENTS ) )
+            reorderMesh( mesh.get() );
+          break;
+        }
+      }
     }
   }
 
+  if ( progress.isCancelled() )
+  {
+    if ( status ) *status = MDAL_Status::Err_Cancelled;
+    return std::unique_ptr<MDAL::Mesh>();
+  }
+
   if ( status && !mesh )
     *status = MDAL_Status::Err_UnknownFormat;
 
+  // statistics of the progressive load are calculated in the background, they are not stored then
+  if ( mesh && cache.isEnabled() )
+  {
+    if ( !isProgressive )
+      cache.sync( mesh->datasetGroups );
+    else if ( cache.hasEntry() )
+      cache.apply( mesh->datasetGroups );
+  }
+
+  // nothing of the new mesh has been handed out yet
+  if ( mesh )
+    _storeMemoryDatasets( mesh->datasetGroups, std::map<DatasetGroup *, size_t>() );
+
+  if ( mesh && isProgressive )
+    mesh->startBackgroundLoad();
+
+  if ( mesh )
+    progress.report( 1 );
+
   return mesh;
 }
 
+std::shared_ptr<MDAL::Driver> MDAL::DriverManager::datasetsDriver( const std::string &datasetFile ) const
+{
+  std::shared_ptr<Driver> cachedDriver;
+  for ( const auto &driver : candidateDrivers( datasetFile, Capability::ReadDatasets, cachedDriver ) )
+  {
+    if ( driver == cachedDriver || driver->canReadDatasets( datasetFile ) )
+      return driver;
+  }
+  return std::shared_ptr<Driver>();
+}
+
 void MDAL::DriverManager::loadDatasets( Mesh *mesh, const std::string &datasetFile, MDAL_Status *status ) const
 {
   if ( !MDAL::fileExists( datasetFile ) )
@@ -79,19 +252,163 @@ void MDAL::DriverManager::loadDatasets( Mesh *mesh, const std::string &datasetFi
     return;
   }
 
-  for ( const auto &driver : mDrivers )
+  const std::shared_ptr<Driver> driver = datasetsDriver( datasetFile );
+  if ( !driver )
   {
-    if ( driver->hasCapability( Capability::ReadDatasets ) &&
-         driver->canReadDatasets( datasetFile ) )
+    if ( status ) *status = MDAL_Status::Err_UnknownFormat;
+    return;
+  }
+
+  MDAL_PERF_SCOPE( perfScope, "load datasets", PerfCounter::DatasetLoads, PerfCounter::DatasetLoadTime, datasetFile );
+  const ProgressScope progressScope;
+  Progress &progress = Progress::current();
+  const StatisticsCache cache( datasetFile );
+  const size_t groupsCount = mesh->datasetGroups.size();
+  const std::map<DatasetGroup *, size_t> datasetCounts = _datasetCounts( mesh->datasetGroups );
+  {
+    // statistics are taken from the cache, there is no need to calculate them during the load
+    std::unique_ptr<ScopedOpenOption> lazyStatistics;
+    if ( cache.hasEntry() )
+      lazyStatistics.reset( new ScopedOpenOption( OPTION_LAZY_STATISTICS, "YES" ) );
+
+    // datasets already in the groups are in the order of the mesh, the others must be reordered
+    MemoryMesh *memoryMesh = dynamic_cast<MemoryMesh *>( mesh );
+
+    std::unique_ptr<Driver> drv( driver->create() );
+    MDAL_Status loadStatus = MDAL_Status::None;
     {
-      std::unique_ptr<Driver> drv( driver->create() );
-      drv->load( datasetFile, mesh, status );
+      MDAL_PERF_DRIVER_SCOPE( driverScope, driver->name(), "load_datasets" );
+      drv->load( datasetFile, mesh, &loadStatus );
+      if ( status ) *status = loadStatus;
+    }
+
+    if ( progress.isCancelled() )
+    {
+      _rollbackLoad( mesh, groupsCount, datasetCounts );
+      if ( status ) *status = MDAL_Status::Err_Cancelled;
       return;
     }
+
+    // the driver is remembered only when it read the file
+    if ( loadStatus == MDAL_Status::None )
+      cacheDriver( datasetFile, Capability::ReadDatasets, driver );
+
+    if ( memoryMesh && memoryMesh->isReordered() )
+      _reorderLoadedDatasets( memoryMesh, datasetCounts, status );
   }
 
-  if ( status )
-    *status = MDAL_Status::Err_UnknownFormat;
+  if ( cache.isEnabled() && mesh->datasetGroups.size() > groupsCount )
+  {
+    const DatasetGroups loadedGroups( mesh->datasetGroups.begin() + static_cast<DatasetGroups::difference_type>( groupsCount ), mesh->datasetGroups.end() );
+    cache.sync( loadedGroups );
+  }
+
+  // datasets may be added to the groups loaded before too
+  _storeMemoryDatasets( mesh->datasetGroups, datasetCounts );
+  progress.report( 1 );
+}
+
+void MDAL::DriverManager::loadDatasets( Mesh *mesh, const std::vector<std::string> &datasetFiles, MDAL_Status *status ) const
+{
+  if ( !mesh )
+  {
+    if ( status ) *status = MDAL_Status::Err_IncompatibleMesh;
+    return;
+  }
+
+  struct BatchFile
+  {
+    std::shared_ptr<Driver> driver;
+    std::unique_ptr<StatisticsCache> cache;
+    DatasetGroups groups;
+    MDAL_Status status = MDAL_Status::None;
+  };
+
+  const ProgressScope progressScope;
+  Progress &progress = Progress::current();
+  const size_t batchGroupsCount = mesh->datasetGroups.size();
+  const std::map<DatasetGroup *, size_t> batchDatasetCounts = _datasetCounts( mesh->datasetGroups );
+
+  // drivers are detected on this thread, probing may enter libraries that are not thread-safe
+  std::vector<BatchFile> files( datasetFiles.size() );
+  std::vector<size_t> parallelFiles;
+  for ( size_t i = 0; i < datasetFiles.size(); ++i )
+  {
+    if ( !MDAL::fileExists( datasetFiles[i] ) )
+      continue;
+
+    files[i].driver = datasetsDriver( datasetFiles[i] );
+    if ( files[i].driver && files[i].driver->supportsParallelLoad() )
+    {
+      files[i].cache.reset( new StatisticsCache( datasetFiles[i] ) );
+      parallelFiles.push_back( i );
+    }
+  }
+
+  // each file has its own driver, which collects the groups instead of adding them to the mesh
+  parallelFor( parallelFiles.size(), [&datasetFiles, &files, &parallelFiles, &progress, mesh]( size_t i )
+  {
+    // this thread holds the library lock for the workers
+    const LoadWorkerScope worker;
+    const ProgressScope workerProgress( progress );
+    if ( progress.isCancelled() )
+      return;
+
+    BatchFile &file = files[parallelFiles[i]];
+    std::unique_ptr<ScopedOpenOption> lazyStatistics;
+    if ( file.cache->hasEntry() )
+      lazyStatistics.reset( new ScopedOpenOption( OPTION_LAZY_STATISTICS, "YES" ) );
+
+    std::unique_ptr<Driver> drv( file.driver->create() );
+    drv->setLoadedGroups( &file.groups );
+    drv->load( datasetFiles[parallelFiles[i]], mesh, &file.status );
+  } );
+
+  // groups are added in the order of the files, the files of the other drivers are loaded in turn
+  if ( status ) *status = MDAL_Status::None;
+  for ( size_t i = 0; i < files.size(); ++i )
+  {
+    if ( !progress.report( static_cast<double>( i ) / static_cast<double>( files.size() ) ) )
+      break;
+
+    BatchFile &file = files[i];
+    if ( !file.cache )
+    {
+      loadDatasets( mesh, datasetFiles[i], &file.status );
+    }
+    else
+    {
+      const size_t groupsCount = mesh->datasetGroups.size();
+      MemoryMesh *memoryMesh = dynamic_cast<MemoryMesh *>( mesh );
+      const std::map<DatasetGroup *, size_t> datasetCounts = _datasetCounts( mesh->datasetGroups );
+
+      mesh->datasetGroups.insert( mesh->datasetGroups.end(), file.groups.begin(), file.groups.end() );
+      if ( file.status == MDAL_Status::None )
+        cacheDriver( datasetFiles[i], Capability::ReadDatasets, file.driver );
+      if ( memoryMesh && memoryMesh->isReordered() )
+        _reorderLoadedDatasets( memoryMesh, datasetCounts, &file.status );
+
+      if ( file.cache->isEnabled() && mesh->datasetGroups.size() > groupsCount )
+      {
+        const DatasetGroups loadedGroups( mesh->datasetGroups.begin() + static_cast<DatasetGroups::difference_type>( groupsCount ), mesh->datasetGroups.end() );
+        file.cache->sync( loadedGroups );
+      }
+    }
+
+    if ( status && file.status != MDAL_Status::None )
+      *status = file.status;
+  }
+
+  // the groups and datasets of the whole batch are discarded
+  if ( progress.isCancelled() )
+  {
+    _rollbackLoad( mesh, batchGroupsCount, batchDatasetCounts );
+    if ( status ) *status = MDAL_Status::Err_Cancelled;
+    return;
+  }
+
+  _storeMemoryDatasets( mesh->datasetGroups, batchDatasetCounts );
+  progress.report( 1 );
 }
 
 void MDAL::DriverManager::save( MDAL::Mesh *mesh, const std::string &uri, const std::string &driverName, MDAL_Status *status ) const
@@ -100,72 +417,184 @@ void MDAL::DriverManager::save( MDAL::Mesh *mesh, const std::string &uri, const
 
   std::unique_ptr<Driver> drv( selectedDriver->create() );
 
+  MDAL_PERF_SCOPE( perfScope, "save", PerfCounter::Saves, PerfCounter::SaveTime, uri );
+  MDAL_PERF_DRIVER_SCOPE( driverScope, driverName, "save" );
+  const ProgressScope progressScope;
+  Progress &progress = Progress::current();
   drv->save( uri, mesh, status );
+  if ( progress.isCancelled() )
+  {
+    // the partially written file is removed
+    std::remove( uri.c_str() );
+    if ( status ) *status = MDAL_Status::Err_Cancelled;
+    return;
+  }
+  progress.report( 1 );
+}
+
+void MDAL::DriverManager::saveToStream( MDAL::Mesh *mesh, std::ostream &stream, const std::string &driverName, MDAL_Status *status ) const
+{
+  auto selectedDriver = driver( driverName );
+
+  std::unique_ptr<Driver> drv( selectedDriver->create() );
+
+  MDAL_PERF_SCOPE( perfScope, "save", PerfCounter::Saves, PerfCounter::SaveTime, "memory" );
+  MDAL_PERF_DRIVER_SCOPE( driverScope, driverName, "save" );
+  const ProgressScope progressScope;
+  Progress &progress = Progress::current();
+  drv->saveToStream( stream, mesh, status );
+  if ( progress.isCancelled() )
+  {
+    if ( status ) *status = MDAL_Status::Err_Cancelled;
+    return;
+  }
+  progress.report( 1 );
+}
+
+std::vector<std::shared_ptr<MDAL::Driver>> MDAL::DriverManager::candidateDrivers( const std::string &uri,
+    Capability capability,
+    std::shared_ptr<MDAL::Driver> &cachedDriver ) const
+{
+  std::vector<std::shared_ptr<Driver>> candidates;
+  cachedDriver.reset();
+
+  int64_t fileSize, fileModificationTime;
+  if ( fileSizeAndModificationTime( uri, fileSize, fileModificationTime ) )
+  {
+    std::lock_guard<std::mutex> lock( mDetectedDriversMutex );
+    auto it = mDetectedDrivers.find( std::make_pair( uri, static_cast<int>( capability ) ) );
+    if ( it != mDetectedDrivers.end() &&
+         it->second.fileSize == fileSize &&
+         it->second.fileModificationTime == fileModificationTime )
+    {
+      cachedDriver = driver( it->second.driverName );
+      if ( cachedDriver )
+        candidates.push_back( cachedDriver );
+    }
+  }
+
+  // header is read once here, so drivers do not need to open the file with
+  // HDF5/NetCDF/GDAL only to find out that it is in different format
+  // only the drivers to probe are created
+  const FileSignature signature( uri );
+  std::vector<size_t> rejected;
+  for ( size_t i = 0; i < mDescriptors.size(); ++i )
+  {
+    const DriverDescriptor &descriptor = mDescriptors[i];
+    if ( !( descriptor.capabilityFlags & capability ) ||
+         ( cachedDriver && descriptor.name == cachedDriver->name() ) )
+      continue;
+
+    if ( descriptor.canReadSignature( signature ) )
+      candidates.push_back( createdDriver( i ) );
+    else
+      rejected.push_back( i );
+  }
+
+  // the classification may be wrong for unknown binary files (e.g. HDF5 with large user block)
+  if ( signature.format() == FileSignature::Unknown )
+  {
+    for ( size_t i : rejected )
+      candidates.push_back( createdDriver( i ) );
+  }
+
+  return candidates;
+}
+
+void MDAL::DriverManager::cacheDriver( const std::string &uri, Capability capability, const std::shared_ptr<MDAL::Driver> &driver ) const
+{
+  DetectedDriver detected;
+  if ( !driver || !fileSizeAndModificationTime( uri, detected.fileSize, detected.fileModificationTime ) )
+    return;
+  detected.driverName = driver->name();
+
+  // keep the cache small, it only helps with files opened repeatedly
+  const size_t maxDetectedDrivers = 1000;
+  std::lock_guard<std::mutex> lock( mDetectedDriversMutex );
+  if ( mDetectedDrivers.size() >= maxDetectedDrivers )
+    mDetectedDrivers.clear();
+  mDetectedDrivers[std::make_pair( uri, static_cast<int>( capability ) )] = detected;
 }
 
 size_t MDAL::DriverManager::driversCount() const
 {
-  return mDrivers.size();
+  return mDescriptors.size();
 }
 
 std::shared_ptr<MDAL::Driver> MDAL::DriverManager::driver( size_t index ) const
 {
-  if ( mDrivers.size() <= index )
+  if ( mDescriptors.size() <= index )
   {
     return std::shared_ptr<MDAL::Driver>();
   }
   else
   {
-    return mDrivers[index];
+    return createdDriver( index );
   }
 }
 
 std::shared_ptr<MDAL::Driver> MDAL::DriverManager::driver( const std::string &driverName ) const
 {
-  for ( const auto &dr : mDrivers )
+  for ( size_t i = 0; i < mDescriptors.size(); ++i )
   {
-    if ( dr->name() == driverName )
-      return dr;
+    if ( mDescriptors[i].name == driverName )
+      return createdDriver( i );
   }
   return std::shared_ptr<MDAL::Driver>();
 }
 
+std::shared_ptr<MDAL::Driver> MDAL::DriverManager::createdDriver( size_t index ) const
+{
+  std::lock_guard<std::mutex> lock( mDriversMutex );
+  std::shared_ptr<Driver> &drv = mDrivers[index];
+  if ( !drv )
+  {
+    const DriverDescriptor &descriptor = mDescriptors[index];
+    drv.reset( descriptor.create() );
+    assert( drv->name() == descriptor.name );
+    assert( drv->hasCapability( static_cast<Capability>( descriptor.capabilityFlags ) ) );
+  }
+  return drv;
+}
+
 MDAL::DriverManager::DriverManager()
 {
   // MESH DRIVERS
-  mDrivers.push_back( std::make_shared<MDAL::Driver2dm>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverSelafin>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverEsriTin>() );
+  mDescriptors.push_back( _descriptor<MDAL::Driver2dm>( "2DM", Capability::ReadMesh | Capability::SaveMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverSelafin>( "SELAFIN", Capability::ReadMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverEsriTin>( "ESRI_TIN", Capability::ReadMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverSnapshot>( "MDALB", Capability::ReadMesh | Capability::SaveMesh ) );
 
 #ifdef HAVE_HDF5
-  mDrivers.push_back( std::make_shared<MDAL::DriverFlo2D>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverHec2D>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverFlo2D>( "FLO2D", Capability::ReadMesh | Capability::ReadDatasets | Capability::WriteDatasetsOnFaces2D ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverHec2D>( "HEC2D", Capability::ReadMesh ) );
 #endif
 
 #ifdef HAVE_NETCDF
-  mDrivers.push_back( std::make_shared<MDAL::DriverTuflowFV>() );
-  mDrivers.push_back( std::make_shared<MDAL::Driver3Di>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverSWW>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverUgrid>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverTuflowFV>( "TUFLOWFV", Capability::ReadMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::Driver3Di>( "3Di", Capability::ReadMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverSWW>( "SWW", Capability::ReadMesh ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverUgrid>( "Ugrid", Capability::ReadMesh | Capability::SaveMesh ) );
 #endif
 
 #if defined HAVE_GDAL && defined HAVE_NETCDF
-  mDrivers.push_back( std::make_shared<MDAL::DriverGdalNetCDF>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverGdalNetCDF>( "NETCDF", Capability::ReadMesh ) );
 #endif
 
 #ifdef HAVE_GDAL
-  mDrivers.push_back( std::make_shared<MDAL::DriverGdalGrib>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverGdalGrib>( "GRIB", Capability::ReadMesh ) );
 #endif
 
   // DATASET DRIVERS
-  mDrivers.push_back( std::make_shared<MDAL::DriverAsciiDat>() );
-  mDrivers.push_back( std::make_shared<MDAL::DriverBinaryDat>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverAsciiDat>( "ASCII_DAT", Capability::ReadDatasets | Capability::WriteDatasetsOnFaces2D | Capability::WriteDatasetsOnVertices2D ) );
+  mDescriptors.push_back( _descriptor<MDAL::DriverBinaryDat>( "BINARY_DAT", Capability::ReadDatasets | Capability::WriteDatasetsOnVertices2D ) );
 #ifdef HAVE_HDF5
-  mDrivers.push_back( std::make_shared<MDAL::DriverXmdf>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverXmdf>( "XMDF", Capability::ReadDatasets ) );
 #endif
 
 #if defined HAVE_HDF5 && defined HAVE_XML
-  mDrivers.push_back( std::make_shared<MDAL::DriverXdmf>() );
+  mDescriptors.push_back( _descriptor<MDAL::DriverXdmf>( "XDMF", Capability::ReadDatasets ) );
 #endif
-}
 
+  mDrivers.resize( mDescriptors.size() );
+}
@@ -10,6 +10,8 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <stdint.h>
 
 #include "mdal.h"
 #include "mdal_data_model.hpp"
@@ -18,6 +20,23 @@
 namespace MDAL
 {
 
+  /**
+   * Lightweight record of a registered driver
+   *
+   * Holds what is needed to select the driver, the driver itself is created on first use
+   */
+  struct DriverDescriptor
+  {
+    //! Same as Driver::name()
+    std::string name;
+    //! Same as capability flags of the driver
+    int capabilityFlags;
+    //! Static Driver::canReadSignature() of the driver class
+    bool ( *canReadSignature )( const FileSignature &signature );
+    //! Creates new instance of the driver
+    Driver *( *create )();
+  };
+
   class DriverManager
   {
     public:
@@ -32,8 +51,19 @@ namespace MDAL
       std::unique_ptr< Mesh > load( const std::string &meshFile, MDAL_Status *status ) const;
       void loadDatasets( Mesh *mesh, const std::string &datasetFile, MDAL_Status *status ) const;
 
+      /**
+       * Loads the dataset files and adds their groups to the mesh in the order of the files
+       *
+       * Files of the drivers supporting parallel load are parsed at once on threadCount() threads,
+       * the others are loaded in turn. Status is the error of the last file that failed, None when all are loaded
+       */
+      void loadDatasets( Mesh *mesh, const std::vector<std::string> &datasetFiles, MDAL_Status *status ) const;
+
       void save( Mesh *mesh, const std::string &uri, const std::string &driver, MDAL_Status *status ) const;
 
+      //! Saves the mesh to the stream, the driver must have SaveMeshToStream capability
+      void saveToStream( Mesh *mesh, std::ostream &stream, const std::string &driver, MDAL_Status *status ) const;
+
       size_t driversCount() const;
       std::shared_ptr<MDAL::Driver> driver( const std::string &driverName ) const;
       std::shared_ptr<MDAL::Driver> driver( size_t index ) const;
@@ -41,7 +71,41 @@ namespace MDAL
     private:
       DriverManager();
 
-      std::vector<std::shared_ptr<MDAL::Driver>> mDrivers;
+      //! Returns driver of the descriptor with the index, creates it on first request
+      std::shared_ptr<MDAL::Driver> createdDriver( size_t index ) const;
+
+      /**
+       * Returns drivers to probe for the file with the capability, in order
+       *
+       * Driver that read the same unchanged file last time goes first and is returned in cachedDriver,
+       * then drivers accepting the file signature. Drivers rejecting the signature are
+       * added only when the signature is not recognized.
+       */
+      std::vector<std::shared_ptr<MDAL::Driver>> candidateDrivers( const std::string &uri,
+          Capability capability,
+          std::shared_ptr<MDAL::Driver> &cachedDriver ) const;
+
+      //! Returns the driver that reads datasets of the file, null when there is none, see cacheDriver()
+      std::shared_ptr<MDAL::Driver> datasetsDriver( const std::string &datasetFile ) const;
+
+      //! Remembers the driver that read the file, called after a successful load only
+      void cacheDriver( const std::string &uri, Capability capability, const std::shared_ptr<MDAL::Driver> &driver ) const;
+
+      struct DetectedDriver
+      {
+        int64_t fileSize;
+        int64_t fileModificationTime;
+        std::string driverName;
+      };
+
+      std::vector<DriverDescriptor> mDescriptors;
+
+      mutable std::mutex mDriversMutex;
+      //! Drivers created so far, indexed as mDescriptors
+      mutable std::vector<std::shared_ptr<MDAL::Driver>> mDrivers;
+
+      mutable std::mutex mDetectedDriversMutex;
+      mutable std::map<std::pair<std::string, int>, DetectedDriver> mDetectedDrivers;
   };
 
 } // namespace MDAL
@@ -0,0 +1,628 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_expression.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <string.h>
+
+#include "mdal_block_cache.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_simd.hpp"
+
+//! Number of values evaluated at once, so the stack of the evaluation stays in the cache
+static const size_t BLOCK_VALUES = 4096;
+
+//! Returns position of the first character from the position which is not a decimal digit
+static size_t _skipDigits( const std::string &text, size_t position )
+{
+  while ( position < text.size() && std::isdigit( static_cast<unsigned char>( text[position] ) ) )
+    ++position;
+  return position;
+}
+
+//! Recursive descent parser appending the operations to the program in postfix order
+class MDAL::Expression::Parser
+{
+  public:
+    Parser( const std::string &text, Expression &expression )
+      : mText( text )
+      , mExpression( expression )
+    {}
+
+    bool parse()
+    {
+      if ( !comparison() )
+        return false;
+      skipSpaces();
+      if ( mPosition < mText.size() )
+        return fail( "unexpected character" );
+      return true;
+    }
+
+  private:
+    bool fail( const std::string &message )
+    {
+      if ( mExpression.mError.empty() )
+        mExpression.mError = message + " at position " + std::to_string( mPosition );
+      return false;
+    }
+
+    void skipSpaces()
+    {
+      while ( mPosition < mText.size() && std::isspace( static_cast<unsigned char>( mText[mPosition] ) ) )
+        ++mPosition;
+    }
+
+    //! Consumes the token when it is next
+    bool accept( const char *token )
+    {
+      skipSpaces();
+      const size_t length = strlen( token );
+      if ( mText.compare( mPosition, length, token ) != 0 )
+        return false;
+      mPosition += length;
+      return true;
+    }
+
+    void emit( OperationType type )
+    {
+      Operation operation;
+      operation.type = type;
+      mExpression.mProgram.push_back( operation );
+    }
+
+    bool comparison()
+    {
+      if ( !sum() )
+        return false;
+      while ( true )
+      {
+        // two character operators first
+        OperationType type;
+        if ( accept( "<=" ) )
+          type = LessEqual;
+        else if ( accept( ">=" ) )
+          type = GreaterEqual;
+        else if ( accept( "==" ) )
+          type = Equal;
+        else if ( accept( "!=" ) )
+          type = NotEqual;
+        else if ( accept( "<" ) )
+          type = Less;
+        else if ( accept( ">" ) )
+          type = Greater;
+        else
+          return true;
+        if ( !sum() )
+          return false;
+        emit( type );
+      }
+    }
+
+    bool sum()
+    {
+      if ( !product() )
+        return false;
+      while ( true )
+      {
+        OperationType type;
+        if ( accept( "+" ) )
+          type = Add;
+        else if ( accept( "-" ) )
+          type = Subtract;
+        else
+          return true;
+        if ( !product() )
+          return false;
+        emit( type );
+      }
+    }
+
+    bool product()
+    {
+      if ( !unary() )
+        return false;
+      while ( true )
+      {
+        OperationType type;
+        if ( accept( "*" ) )
+          type = Multiply;
+        else if ( accept( "/" ) )
+          type = Divide;
+        else
+          return true;
+        if ( !unary() )
+          return false;
+        emit( type );
+      }
+    }
+
+    bool unary()
+    {
+      if ( accept( "-" ) )
+      {
+        if ( !unary() )
+          return false;
+        emit( Negate );
+        return true;
+      }
+      return power();
+    }
+
+    bool power()
+    {
+      if ( !primary() )
+        return false;
+      if ( accept( "^" ) )
+      {
+        // right associative, -a ^ b is -( a ^ b ) and a ^ -b is allowed
+        if ( !unary() )
+          return false;
+        emit( Power );
+      }
+      return true;
+    }
+
+    bool arguments( size_t count )
+    {
+      if ( !accept( "(" ) )
+        return fail( "expected (" );
+      for ( size_t i = 0; i < count; ++i )
+      {
+        if ( i > 0 && !accept( "," ) )
+          return fail( "expected ," );
+        if ( !comparison() )
+          return false;
+      }
+      if ( !accept( ")" ) )
+        return fail( "expected )" );
+      return true;
+    }
+
+    void emitInput( const std::string &name )
+    {
+      std::vector<std::string> &names = mExpression.mGroupNames;
+      const size_t index = static_cast<size_t>( std::find( names.begin(), names.end(), name ) - names.begin() );
+      if ( index == names.size() )
+        names.push_back( name );
+
+      Operation operation;
+      operation.type = Input;
+      operation.input = index;
+      mExpression.mProgram.push_back( operation );
+    }
+
+    bool primary()
+    {
+      skipSpaces();
+      if ( mPosition >= mText.size() )
+        return fail( "unexpected end" );
+
+      const char c = mText[mPosition];
+      if ( c == '(' )
+      {
+        ++mPosition;
+        if ( !comparison() )
+          return false;
+        if ( !accept( ")" ) )
+          return fail( "expected )" );
+        return true;
+      }
+
+      if ( c == '"' )
+      {
+        const size_t end = mText.find( '"', mPosition + 1 );
+        if ( end == std::string::npos )
+          return fail( "unterminated group name" );
+        emitInput( mText.substr( mPosition + 1, end - mPosition - 1 ) );
+        mPosition = end + 1;
+        return true;
+      }
+
+      if ( std::isdigit( static_cast<unsigned char>( c ) ) || c == '.' )
+      {
+        // digits [. digits] [e [+-] digits], read in the classic locale whatever the decimal separator of the process is
+        const size_t start = mPosition;
+        size_t end = _skipDigits( mText, start );
+        if ( end < mText.size() && mText[end] == '.' )
+          end = _skipDigits( mText, end + 1 );
+        if ( end < mText.size() && ( mText[end] == 'e' || mText[end] == 'E' ) )
+        {
+          size_t exponent = end + 1;
+          if ( exponent < mText.size() && ( mText[exponent] == '+' || mText[exponent] == '-' ) )
+            ++exponent;
+          const size_t exponentEnd = _skipDigits( mText, exponent );
+          if ( exponentEnd > exponent )
+            end = exponentEnd;
+        }
+
+        std::istringstream stream( mText.substr( start, end - start ) );
+        stream.imbue( std::locale::classic() );
+        double value = 0;
+        stream >> value;
+        if ( stream.fail() )
+          return fail( "invalid number" );
+        mPosition = end;
+        Operation operation;
+        operation.type = Constant;
+        operation.constant = value;
+        mExpression.mProgram.push_back( operation );
+        return true;
+      }
+
+      if ( std::isalpha( static_cast<unsigned char>( c ) ) || c == '_' )
+      {
+        const size_t start = mPosition;
+        while ( mPosition < mText.size() &&
+                ( std::isalnum( static_cast<unsigned char>( mText[mPosition] ) ) || mText[mPosition] == '_' ) )
+          ++mPosition;
+        const std::string identifier = mText.substr( start, mPosition - start );
+
+        // identifier followed by ( is a function
+        skipSpaces();
+        if ( mPosition < mText.size() && mText[mPosition] == '(' )
+        {
+          struct Function
+          {
+            const char *name;
+            size_t arguments;
+            OperationType type;
+          };
+          static const Function functions[] =
+          {
+            { "abs", 1, Abs },
+            { "sqrt", 1, Sqrt },
+            { "min", 2, Min },
+            { "max", 2, Max },
+            { "if", 3, If },
+          };
+          for ( const Function &function : functions )
+          {
+            if ( identifier == function.name )
+            {
+              if ( !arguments( function.arguments ) )
+                return false;
+              emit( function.type );
+              return true;
+            }
+          }
+          return fail( "unknown function " + identifier );
+        }
+
+        emitInput( identifier );
+        return true;
+      }
+
+      return fail( "unexpected character" );
+    }
+
+    const std::string &mText;
+    Expression &mExpression;
+    size_t mPosition = 0;
+};
+
+MDAL::Expression::Expression( const std::string &expression )
+{
+  Parser parser( expression, *this );
+  mIsValid = parser.parse();
+  if ( !mIsValid )
+  {
+    mProgram.clear();
+    mGroupNames.clear();
+    return;
+  }
+
+  size_t depth = 0;
+  for ( const Operation &operation : mProgram )
+  {
+    switch ( operation.type )
+    {
+      case Constant:
+      case Input:
+        ++depth;
+        break;
+      case Negate:
+      case Abs:
+      case Sqrt:
+        break;
+      case If:
+        depth -= 2;
+        break;
+      default:
+        --depth;
+        break;
+    }
+    mStackSize = std::max( mStackSize, depth );
+  }
+  assert( depth == 1 );
+}
+
+void MDAL::Expression::evaluate( const std::vector<const double *> &inputs, size_t count, double *result ) const
+{
+  assert( mIsValid );
+  assert( inputs.size() == mGroupNames.size() );
+
+  // the last slot of the stack is the result
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<double> stack( ( mStackSize - 1 ) * count );
+  auto slot = [&]( size_t index ) { return index == 0 ? result : stack.data() + ( index - 1 ) * count; };
+
+  size_t top = 0;
+  for ( const Operation &operation : mProgram )
+  {
+    switch ( operation.type )
+    {
+      case Constant:
+        std::fill( slot( top ), slot( top ) + count, operation.constant );
+        ++top;
+        continue;
+      case Input:
+        std::copy( inputs[operation.input], inputs[operation.input] + count, slot( top ) );
+        ++top;
+        continue;
+      default:
+        break;
+    }
+
+    double *a = slot( top - 1 );
+    switch ( operation.type )
+    {
+      case Negate:
+        for ( size_t i = 0; i < count; ++i ) a[i] = -a[i];
+        continue;
+      case Abs:
+        for ( size_t i = 0; i < count; ++i ) a[i] = std::fabs( a[i] );
+        continue;
+      case Sqrt:
+        for ( size_t i = 0; i < count; ++i ) a[i] = std::sqrt( a[i] );
+        continue;
+      case If:
+      {
+        double *condition = slot( top - 3 );
+        const double *first = slot( top - 2 );
+        for ( size_t i = 0; i < count; ++i )
+          condition[i] = std::isnan( condition[i] ) ? nan : ( condition[i] != 0 ? first[i] : a[i] );
+        top -= 2;
+        continue;
+      }
+      default:
+        break;
+    }
+
+    // binary operations, the result replaces the first operand
+    const double *b = a;
+    a = slot( top - 2 );
+    --top;
+    switch ( operation.type )
+    {
+      case Add:
+        for ( size_t i = 0; i < count; ++i ) a[i] += b[i];
+        break;
+      case Subtract:
+        subtract( a, b, count, a );
+        break;
+      case Multiply:
+        for ( size_t i = 0; i < count; ++i ) a[i] *= b[i];
+        break;
+      case Divide:
+        for ( size_t i = 0; i < count; ++i ) a[i] /= b[i];
+        break;
+      case Power:
+        for ( size_t i = 0; i < count; ++i ) a[i] = std::pow( a[i], b[i] );
+        break;
+      case Less:
+        for ( size_t i = 0; i < count; ++i ) a[i] = a[i] < b[i] ? 1 : 0;
+        break;
+      case LessEqual:
+        for ( size_t i = 0; i < count; ++i ) a[i] = a[i] <= b[i] ? 1 : 0;
+        break;
+      case Greater:
+        for ( size_t i = 0; i < count; ++i ) a[i] = a[i] > b[i] ? 1 : 0;
+        break;
+      case GreaterEqual:
+        for ( size_t i = 0; i < count; ++i ) a[i] = a[i] >= b[i] ? 1 : 0;
+        break;
+      case Equal:
+        for ( size_t i = 0; i < count; ++i ) a[i] = a[i] == b[i] ? 1 : 0;
+        break;
+      case NotEqual:
+        // NaN compares as 0 like the other comparisons
+        for ( size_t i = 0; i < count; ++i ) a[i] = ( a[i] < b[i] || a[i] > b[i] ) ? 1 : 0;
+        break;
+      case Min:
+        for ( size_t i = 0; i < count; ++i ) a[i] = std::isnan( b[i] ) ? nan : ( b[i] < a[i] ? b[i] : a[i] );
+        break;
+      case Max:
+        for ( size_t i = 0; i < count; ++i ) a[i] = std::isnan( b[i] ) ? nan : ( b[i] > a[i] ? b[i] : a[i] );
+        break;
+      default:
+        assert( false );
+        break;
+    }
+  }
+  assert( top == 1 );
+}
+
+MDAL::DerivedDataset2D::DerivedDataset2D( MDAL::DatasetGroup *parent,
+    std::shared_ptr<const MDAL::Expression> expression,
+    std::vector<std::shared_ptr<MDAL::Dataset>> sources )
+  : Dataset2D( parent )
+  , mExpression( expression )
+  , mSources( sources )
+{
+  for ( const std::shared_ptr<Dataset> &source : mSources )
+  {
+    if ( source->supportsActiveFlag() )
+      setSupportsActiveFlag( true );
+  }
+}
+
+MDAL::DerivedDataset2D::~DerivedDataset2D() = default;
+
+bool MDAL::DerivedDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+//! Reads the block of the source through the block cache when the source is backed by file
+static size_t _readSource( MDAL::Dataset *source, MDAL_DataType type, size_t indexStart, size_t count, void *buffer )
+{
+  size_t valuesCount = 0;
+  MDAL::BlockCache &cache = MDAL::BlockCache::instance();
+  const bool useCache = !source->supportsConcurrentReads();
+  if ( useCache && cache.get( source, type, indexStart, count, buffer, &valuesCount ) )
+    return valuesCount;
+
+  {
+    MDAL::DatasetReadLock lock( source );
+    valuesCount = source->data( type, indexStart, count, buffer );
+  }
+  if ( useCache && valuesCount > 0 )
+    cache.put( source, type, indexStart, count, buffer, valuesCount );
+  return valuesCount;
+}
+
+size_t MDAL::DerivedDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  const size_t valuesCount = this->valuesCount();
+  if ( indexStart >= valuesCount || count == 0 )
+    return 0;
+  count = std::min( count, valuesCount - indexStart );
+
+  const size_t blockSize = std::min( count, BLOCK_VALUES );
+  std::vector<std::vector<double>> values( mSources.size(), std::vector<double>( blockSize ) );
+  std::vector<double> vectorValues;
+  std::vector<const double *> inputs( mSources.size() );
+  for ( size_t i = 0; i < mSources.size(); ++i )
+    inputs[i] = values[i].data();
+
+  for ( size_t start = 0; start < count; start += blockSize )
+  {
+    const size_t blockCount = std::min( blockSize, count - start );
+    for ( size_t i = 0; i < mSources.size(); ++i )
+    {
+      Dataset *source = mSources[i].get();
+      std::vector<double> &sourceValues = values[i];
+      size_t read = 0;
+      if ( source->group()->isScalar() )
+      {
+        read = _readSource( source, MDAL_DataType::SCALAR_DOUBLE, indexStart + start, blockCount, sourceValues.data() );
+      }
+      else
+      {
+        vectorValues.resize( 2 * blockCount );
+        read = _readSource( source, MDAL_DataType::VECTOR_2D_DOUBLE, indexStart + start, blockCount, vectorValues.data() );
+        magnitude( vectorValues.data(), read, sourceValues.data() );
+      }
+      std::fill( sourceValues.begin() + static_cast<std::ptrdiff_t>( read ), sourceValues.begin() + static_cast<std::ptrdiff_t>( blockCount ),
+                 std::numeric_limits<double>::quiet_NaN() );
+    }
+    mExpression->evaluate( inputs, blockCount, buffer + start );
+  }
+  return count;
+}
+
+size_t MDAL::DerivedDataset2D::vectorData( size_t, size_t, double * )
+{
+  assert( false ); //checked in C API interface, derived groups are scalar
+  return 0;
+}
+
+size_t MDAL::DerivedDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  std::fill( buffer, buffer + count, 1 );
+  std::vector<int> active( count );
+  for ( const std::shared_ptr<Dataset> &source : mSources )
+  {
+    if ( !source->supportsActiveFlag() )
+      continue;
+
+    const size_t read = _readSource( source.get(), MDAL_DataType::ACTIVE_INTEGER, indexStart, count, active.data() );
+    for ( size_t i = 0; i < read; ++i )
+      buffer[i] = buffer[i] && active[i];
+  }
+  return count;
+}
+
+MDAL::DatasetGroup *MDAL::addDerivedGroup( MDAL::Mesh *mesh, const std::string &name, const std::string &expressionText, std::string &error )
+{
+  std::shared_ptr<Expression> expression = std::make_shared<Expression>( expressionText );
+  if ( !expression->isValid() )
+  {
+    error = expression->error();
+    return nullptr;
+  }
+  if ( expression->groupNames().empty() )
+  {
+    error = "expression uses no group";
+    return nullptr;
+  }
+
+  // groups with more datasets define the time steps
+  std::vector<std::shared_ptr<DatasetGroup>> groups;
+  const DatasetGroup *timeGroup = nullptr;
+  for ( const std::string &groupName : expression->groupNames() )
+  {
+    std::shared_ptr<DatasetGroup> group = mesh->group( groupName );
+    if ( !group )
+    {
+      error = "unknown group " + groupName;
+      return nullptr;
+    }
+    if ( group->datasets.empty() )
+    {
+      error = "group " + groupName + " has no datasets";
+      return nullptr;
+    }
+    if ( ( group->dataLocation() != MDAL_DataLocation::DataOnVertices2D && group->dataLocation() != MDAL_DataLocation::DataOnFaces2D ) ||
+         ( !groups.empty() && group->dataLocation() != groups.front()->dataLocation() ) )
+    {
+      error = "groups must be all defined on vertices or all on faces";
+      return nullptr;
+    }
+    if ( group->datasets.size() > 1 )
+    {
+      if ( timeGroup && timeGroup->datasets.size() != group->datasets.size() )
+      {
+        error = "groups have different number of datasets";
+        return nullptr;
+      }
+      timeGroup = group.get();
+    }
+    groups.push_back( group );
+  }
+  if ( !timeGroup )
+    timeGroup = groups.front().get();
+
+  std::shared_ptr<DatasetGroup> derived = std::make_shared<DatasetGroup>( mesh->driverName(),
+                                          mesh,
+                                          mesh->uri(),
+                                          name );
+  derived->setDataLocation( groups.front()->dataLocation() );
+  derived->setIsScalar( true );
+  derived->setReferenceTime( timeGroup->referenceTime() );
+  derived->setMetadata( "expression", expressionText );
+
+  for ( size_t step = 0; step < timeGroup->datasets.size(); ++step )
+  {
+    std::vector<std::shared_ptr<Dataset>> sources;
+    for ( const std::shared_ptr<DatasetGroup> &group : groups )
+      sources.push_back( group->datasets.size() > 1 ? group->datasets[step] : group->datasets.front() );
+
+    std::shared_ptr<DerivedDataset2D> dataset = std::make_shared<DerivedDataset2D>( derived.get(), expression, sources );
+    dataset->setTime( timeGroup->datasets[step]->time( RelativeTimestamp::hours ) );
+    derived->datasets.push_back( dataset );
+  }
+
+  mesh->datasetGroups.push_back( derived );
+  return derived.get();
+}
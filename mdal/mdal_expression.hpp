@@ -0,0 +1,135 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_EXPRESSION_HPP
+#define MDAL_EXPRESSION_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Arithmetic expression over the dataset groups of the mesh, compiled to a program
+   * of operations on whole blocks of values
+   *
+   * Grammar, from the lowest precedence:
+   * - comparisons <, <=, >, >=, ==, != giving 1 or 0
+   * - + and -
+   * - * and /
+   * - ^ (power, right associative) and unary -
+   * - numbers, group names, functions abs(x), sqrt(x), min(a, b), max(a, b),
+   *   if(condition, a, b) and parentheses
+   *
+   * Group names are identifiers ([A-Za-z_][A-Za-z0-9_]*) or any name in double quotes.
+   * Vector groups are used as their magnitudes. NaN values propagate through the operations,
+   * comparisons with NaN are 0.
+   */
+  class Expression
+  {
+    public:
+      //! Parses the expression, groups are referenced by their index in groupNames()
+      explicit Expression( const std::string &expression );
+
+      bool isValid() const { return mIsValid; }
+
+      //! Description of the first syntax error
+      const std::string &error() const { return mError; }
+
+      //! Names of the groups used in the expression, in the order of the first use
+      const std::vector<std::string> &groupNames() const { return mGroupNames; }
+
+      /**
+       * Evaluates the expression for count values
+       * \param inputs count values of each group of groupNames()
+       * \param result count values
+       */
+      void evaluate( const std::vector<const double *> &inputs, size_t count, double *result ) const;
+
+    private:
+      enum OperationType
+      {
+        Constant,
+        Input,
+        Negate,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual,
+        Abs,
+        Sqrt,
+        Min,
+        Max,
+        If
+      };
+
+      //! Operations are in postfix order, each pops its operands and pushes the result
+      struct Operation
+      {
+        OperationType type;
+        double constant = 0;
+        size_t input = 0;
+      };
+
+      class Parser;
+
+      std::vector<Operation> mProgram;
+      std::vector<std::string> mGroupNames;
+      //! Maximum number of values on the stack during the evaluation
+      size_t mStackSize = 0;
+      bool mIsValid = false;
+      std::string mError;
+  };
+
+  /**
+   * Dataset of the derived group evaluated from the datasets of the groups of the expression
+   *
+   * Nothing is stored, each request reads the same range of the sources in blocks and evaluates
+   * the expression. Sources backed by files are read through the BlockCache. The dataset
+   * is active where all sources with active flag are active.
+   */
+  class DerivedDataset2D: public Dataset2D
+  {
+    public:
+      DerivedDataset2D( DatasetGroup *parent,
+                        std::shared_ptr<const Expression> expression,
+                        std::vector<std::shared_ptr<Dataset>> sources );
+      ~DerivedDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Reads of the sources are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+    private:
+      std::shared_ptr<const Expression> mExpression;
+      std::vector<std::shared_ptr<Dataset>> mSources;
+  };
+
+  /**
+   * Adds scalar group of datasets evaluated from the expression to the mesh
+   *
+   * All groups of the expression must be defined on vertices or on faces of the mesh.
+   * Groups with single dataset are used for every time step, others must have the same
+   * number of datasets, the times are taken from the first of them.
+   * \param error set to the reason when the group is not created
+   * \returns the new group or nullptr
+   */
+  DatasetGroup *addDerivedGroup( Mesh *mesh, const std::string &name, const std::string &expression, std::string &error );
+} // namespace MDAL
+#endif //MDAL_EXPRESSION_HPP
@@ -0,0 +1,96 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_file_signature.hpp"
+
+#include <fstream>
+#include <string.h>
+
+#include "mdal_remote.hpp"
+#include "mdal_utils.hpp"
+
+static const char HDF5_MAGIC[] = "\x89HDF\r\n\x1a\n";
+static const size_t HDF5_MAGIC_SIZE = 8;
+
+static MDAL::FileSignature::Format _detectFormat( const std::string &header )
+{
+  if ( header.empty() )
+    return MDAL::FileSignature::Unknown;
+
+  // HDF5 signature may be after user block, located on power of 2 offsets from 512
+  for ( size_t offset = 0; offset + HDF5_MAGIC_SIZE <= header.size(); offset = ( offset == 0 ) ? 512 : offset * 2 )
+  {
+    if ( header.compare( offset, HDF5_MAGIC_SIZE, HDF5_MAGIC, HDF5_MAGIC_SIZE ) == 0 )
+      return MDAL::FileSignature::Hdf5;
+  }
+
+  if ( header.size() >= 4 && header.compare( 0, 3, "CDF" ) == 0 &&
+       ( header[3] == '\x01' || header[3] == '\x02' || header[3] == '\x05' ) )
+    return MDAL::FileSignature::NetCDF;
+
+  if ( header.compare( 0, 4, "GRIB" ) == 0 )
+    return MDAL::FileSignature::Grib;
+
+  if ( memchr( header.data(), '\0', header.size() ) == nullptr )
+    return MDAL::FileSignature::Text;
+
+  return MDAL::FileSignature::Unknown;
+}
+
+MDAL::FileSignature::FileSignature( const std::string &uri )
+{
+  const size_t dotPos = uri.find_last_of( '.' );
+  const size_t sepPos = uri.find_last_of( "/\\" );
+  if ( dotPos != std::string::npos && ( sepPos == std::string::npos || dotPos > sepPos ) )
+    mExtension = MDAL::toLower( uri.substr( dotPos + 1 ) );
+
+  if ( isRemoteUri( uri ) )
+  {
+    std::shared_ptr<RemoteFile> remote = RemoteFile::open( uri );
+    if ( remote )
+    {
+      char buffer[HEADER_SIZE];
+      mHeader.assign( buffer, remote->read( 0, HEADER_SIZE, buffer ) );
+    }
+    mFormat = _detectFormat( mHeader );
+    return;
+  }
+
+  std::ifstream in( uri, std::ifstream::in | std::ifstream::binary );
+  if ( in )
+  {
+    char buffer[HEADER_SIZE];
+    in.read( buffer, HEADER_SIZE );
+    mHeader.assign( buffer, static_cast<size_t>( in.gcount() ) );
+  }
+
+  mFormat = _detectFormat( mHeader );
+}
+
+MDAL::FileSignature::Format MDAL::FileSignature::format() const
+{
+  return mFormat;
+}
+
+const std::string &MDAL::FileSignature::header() const
+{
+  return mHeader;
+}
+
+std::string MDAL::FileSignature::headerLine() const
+{
+  const size_t end = mHeader.find( '\n' );
+  return mHeader.substr( 0, end );
+}
+
+const std::string &MDAL::FileSignature::extension() const
+{
+  return mExtension;
+}
+
+bool MDAL::FileSignature::startsWith( const std::string &bytes ) const
+{
+  return mHeader.compare( 0, bytes.size(), bytes ) == 0;
+}
@@ -0,0 +1,59 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_FILE_SIGNATURE_HPP
+#define MDAL_FILE_SIGNATURE_HPP
+
+#include <stddef.h>
+#include <string>
+
+namespace MDAL
+{
+  /**
+   * Leading bytes of the file, read once for all drivers
+   *
+   * The container format is recognized from the magic bytes, so DriverManager
+   * can skip the drivers that certainly cannot read the file without opening
+   * it with HDF5, NetCDF or GDAL libraries.
+   */
+  class FileSignature
+  {
+    public:
+      enum Format
+      {
+        Unknown = 0, //!< binary file with no recognized signature, or not readable
+        Text, //!< no null bytes in the header
+        Hdf5, //!< HDF5 signature at offset 0, 512, 1024 or 2048
+        NetCDF, //!< CDF classic or 64-bit offset formats, note NetCDF4 is Hdf5
+        Grib //!< GRIB edition 1 or 2
+      };
+
+      //! Maximum number of bytes read from the file
+      static const size_t HEADER_SIZE = 4096;
+
+      explicit FileSignature( const std::string &uri );
+
+      Format format() const;
+
+      //! Up to HEADER_SIZE leading bytes of the file
+      const std::string &header() const;
+
+      //! First line of the header, without the line ending
+      std::string headerLine() const;
+
+      //! Lowercase extension of the file without the dot, e.g. "2dm"
+      const std::string &extension() const;
+
+      //! Whether the header starts with the given bytes
+      bool startsWith( const std::string &bytes ) const;
+
+    private:
+      Format mFormat = Unknown;
+      std::string mHeader;
+      std::string mExtension;
+  };
+
+} // namespace MDAL
+#endif //MDAL_FILE_SIGNATURE_HPP
@@ -0,0 +1,218 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_handle_pool.hpp"
+
+#include <stdint.h>
+#include <chrono>
+
+#include "mdal_utils.hpp"
+
+const int MDAL::HandlePool::MAXIMUM_WAIT_SECONDS = 10;
+
+MDAL::HandlePool &MDAL::HandlePool::instance()
+{
+  // never destroyed, the handles of the meshes still open may be released during the exit
+  static HandlePool *sPool = new HandlePool();
+  return *sPool;
+}
+
+std::shared_ptr<void> MDAL::HandlePool::acquire( const std::string &kind, const std::string &path, const Opener &open )
+{
+  int64_t size, modificationTime;
+  if ( !fileSizeAndModificationTime( path, size, modificationTime ) )
+    return open();
+
+  const std::string key = kind + "\n" + path + "\n" + std::to_string( size ) + "\n" + std::to_string( modificationTime );
+  const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds( MAXIMUM_WAIT_SECONDS );
+  std::vector<std::shared_ptr<void>> closed;
+  std::unique_lock<std::mutex> lock( mMutex );
+  for ( ;; )
+  {
+    auto it = mEntries.find( key );
+    if ( it != mEntries.end() )
+    {
+      std::shared_ptr<void> handle = it->second.inUse.lock();
+      if ( handle )
+      {
+        ++mReuses;
+        return handle;
+      }
+
+      if ( it->second.idle )
+      {
+        ++mReuses;
+        mIdle.erase( it->second.recent );
+        std::shared_ptr<void> idle = std::move( it->second.idle );
+        return share( key, idle );
+      }
+    }
+
+    const bool isOpening = it != mEntries.end() && it->second.isOpening;
+    const bool isFull = mMaximumOpen > 0 && mOpenCount >= mMaximumOpen;
+    if ( !isOpening && isFull && !mIdle.empty() )
+    {
+      // the least recently used idle handle makes the room
+      shrink( mIdle.size() - 1, closed );
+      continue;
+    }
+    if ( !isOpening && !isFull )
+      break;
+
+    // wait for the open of the file by another thread, or for a handle released at the limit
+    if ( mChanged.wait_until( lock, deadline ) == std::cv_status::timeout )
+    {
+      MDAL::debug( "Too many files open, " + path + " could not be opened" );
+      return nullptr;
+    }
+  }
+
+  // the open may be slow (e.g. network file systems), other files are acquired meanwhile
+  mEntries[key].isOpening = true;
+  ++mOpenCount;
+  lock.unlock();
+  closed.clear();
+  std::shared_ptr<void> opened = open();
+  lock.lock();
+
+  auto it = mEntries.find( key );
+  it->second.isOpening = false;
+  mChanged.notify_all();
+  if ( !opened )
+  {
+    --mOpenCount;
+    if ( !it->second.idle && it->second.inUse.expired() )
+      mEntries.erase( it );
+    return opened;
+  }
+
+  ++mOpens;
+  if ( !mOpenedKeys.insert( key ).second )
+    ++mReopens;
+  return share( key, opened );
+}
+
+std::shared_ptr<void> MDAL::HandlePool::share( const std::string &key, const std::shared_ptr<void> &handle )
+{
+  std::shared_ptr<void> shared( handle.get(), [this, key, handle]( void * )
+  {
+    release( key, handle );
+  } );
+  mEntries[key].inUse = shared;
+  return shared;
+}
+
+void MDAL::HandlePool::release( const std::string &key, std::shared_ptr<void> handle )
+{
+  std::vector<std::shared_ptr<void>> closed;
+  {
+    std::lock_guard<std::mutex> lock( mMutex );
+    auto it = mEntries.find( key );
+    // another handle of the file may be idle already, when it was opened again meanwhile
+    if ( it != mEntries.end() && mMaximumIdle > 0 && !it->second.idle )
+    {
+      it->second.idle = handle;
+      mIdle.push_front( key );
+      it->second.recent = mIdle.begin();
+      shrink( mMaximumIdle, closed );
+    }
+    else
+    {
+      --mOpenCount;
+      if ( it != mEntries.end() && !it->second.idle && !it->second.isOpening && it->second.inUse.expired() )
+        mEntries.erase( it );
+    }
+  }
+  // handles not kept are closed without the lock, before the waiting opens continue
+  handle.reset();
+  closed.clear();
+  mChanged.notify_all();
+}
+
+void MDAL::HandlePool::shrink( size_t count, std::vector<std::shared_ptr<void>> &closed )
+{
+  while ( mIdle.size() > count )
+  {
+    auto it = mEntries.find( mIdle.back() );
+    mIdle.pop_back();
+    closed.push_back( std::move( it->second.idle ) );
+    --mOpenCount;
+    if ( it->second.inUse.expired() && !it->second.isOpening )
+      mEntries.erase( it );
+  }
+}
+
+void MDAL::HandlePool::closeIdle( const std::string &kind, const std::string &path )
+{
+  std::vector<std::shared_ptr<void>> closed;
+  std::lock_guard<std::mutex> lock( mMutex );
+  const std::string prefix = kind + "\n" + path + "\n";
+  for ( auto it = mEntries.lower_bound( prefix ); it != mEntries.end() && MDAL::startsWith( it->first, prefix ); )
+  {
+    if ( it->second.idle )
+    {
+      mIdle.erase( it->second.recent );
+      closed.push_back( std::move( it->second.idle ) );
+      --mOpenCount;
+    }
+    if ( it->second.inUse.expired() && !it->second.isOpening )
+      it = mEntries.erase( it );
+    else
+      ++it;
+  }
+  mChanged.notify_all();
+}
+
+void MDAL::HandlePool::setMaximumIdle( size_t count )
+{
+  std::vector<std::shared_ptr<void>> closed;
+  std::lock_guard<std::mutex> lock( mMutex );
+  mMaximumIdle = count;
+  shrink( count, closed );
+  mChanged.notify_all();
+}
+
+size_t MDAL::HandlePool::maximumIdle() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mMaximumIdle;
+}
+
+void MDAL::HandlePool::setMaximumOpen( size_t count )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  mMaximumOpen = count;
+  mChanged.notify_all();
+}
+
+size_t MDAL::HandlePool::maximumOpen() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mMaximumOpen;
+}
+
+size_t MDAL::HandlePool::openCount() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mOpenCount;
+}
+
+long long MDAL::HandlePool::opens() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mOpens;
+}
+
+long long MDAL::HandlePool::reuses() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mReuses;
+}
+
+long long MDAL::HandlePool::reopens() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mReopens;
+}
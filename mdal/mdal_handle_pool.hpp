@@ -0,0 +1,108 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_HANDLE_POOL_HPP
+#define MDAL_HANDLE_POOL_HPP
+
+#include <stddef.h>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace MDAL
+{
+  /**
+   * Process-wide pool of the handles of files opened for reading, see MDAL_SetFileHandlePoolSize()
+   *
+   * Loads of the same unchanged file (same path, size and modification time) share one open
+   * handle while any mesh or dataset holds it. Handles released by all their users are kept
+   * open for the following loads up to the limit of idle handles, the least recently used
+   * are closed over the limit. Handles in use are never closed by the pool.
+   *
+   * The total number of the pooled handles (in use, idle or being opened) can be limited too,
+   * the least recently used idle handles are closed to open a new one at the limit. When all
+   * handles are in use, the open waits until another user releases a handle and fails after
+   * MAXIMUM_WAIT_SECONDS. Files are opened without the lock, concurrent loads of the same file
+   * wait for its single open.
+   */
+  class HandlePool
+  {
+    public:
+      //! Opens the file, returns pointer owning the handle or null on failure
+      typedef std::function<std::shared_ptr<void>()> Opener;
+
+      static HandlePool &instance();
+
+      /**
+       * Returns the open handle of the file of the kind (e.g. "HDF5"), opened by open() when there is none
+       * Files that cannot be stat'ed are opened without pooling, null when open() fails
+       */
+      std::shared_ptr<void> acquire( const std::string &kind, const std::string &path, const Opener &open );
+
+      //! Closes the idle handles of the file, e.g. before it is opened for writing
+      void closeIdle( const std::string &kind, const std::string &path );
+
+      //! Sets maximum number of idle handles kept open, 0 closes handles with their last user
+      void setMaximumIdle( size_t count );
+      size_t maximumIdle() const;
+
+      //! Sets maximum number of the handles open at once, 0 for no limit
+      void setMaximumOpen( size_t count );
+      size_t maximumOpen() const;
+
+      //! Number of the pooled handles open at the moment
+      size_t openCount() const;
+
+      //! Time the open of a file waits for a handle released at the maximum of open handles
+      static const int MAXIMUM_WAIT_SECONDS;
+
+      //! Number of files opened since the library was loaded
+      long long opens() const;
+      //! Number of requests served by a handle already open
+      long long reuses() const;
+      //! Number of opens of the files that were open before
+      long long reopens() const;
+
+    private:
+      HandlePool() = default;
+
+      //! Called when the last user of the handle releases it
+      void release( const std::string &key, std::shared_ptr<void> handle );
+      //! Returns the handle given to the users, releasing it back to the pool
+      std::shared_ptr<void> share( const std::string &key, const std::shared_ptr<void> &handle );
+      //! Moves idle handles over the count to closed, to be closed without the lock
+      void shrink( size_t count, std::vector<std::shared_ptr<void>> &closed );
+
+      struct Entry
+      {
+        std::weak_ptr<void> inUse;
+        std::shared_ptr<void> idle;
+        std::list<std::string>::iterator recent;
+        //! The file is being opened by a thread without the lock
+        bool isOpening = false;
+      };
+
+      mutable std::mutex mMutex;
+      //! Notified when a handle is opened, released or closed
+      std::condition_variable mChanged;
+      std::map<std::string, Entry> mEntries;
+      //! keys of the idle handles, most recently used first
+      std::list<std::string> mIdle;
+      std::set<std::string> mOpenedKeys;
+      size_t mMaximumIdle = 0;
+      size_t mMaximumOpen = 0;
+      size_t mOpenCount = 0;
+      long long mOpens = 0;
+      long long mReuses = 0;
+      long long mReopens = 0;
+  };
+} // namespace MDAL
+#endif //MDAL_HANDLE_POOL_HPP
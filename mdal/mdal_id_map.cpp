@@ -0,0 +1,123 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_id_map.hpp"
+
+#include <algorithm>
+
+const size_t MDAL::IdToIndexMap::NOT_FOUND;
+const size_t MDAL::IdToIndexMap::MAX_DENSE_RATIO;
+const size_t MDAL::IdToIndexMap::EMPTY;
+
+bool MDAL::IdToIndexMap::insert( size_t id, size_t index )
+{
+  if ( id == EMPTY )
+  {
+    if ( mEmptyIdIndex != NOT_FOUND )
+      return false;
+    mEmptyIdIndex = index;
+    ++mSize;
+    mMaximumId = id;
+    return true;
+  }
+
+  if ( mIsDense )
+  {
+    if ( id < mDense.size() )
+    {
+      if ( mDense[id] != NOT_FOUND )
+        return false;
+      mDense[id] = index;
+      ++mSize;
+      mMaximumId = std::max( mMaximumId, id );
+      return true;
+    }
+    toHashTable();
+  }
+
+  // keep load factor under 1/2
+  if ( 2 * ( mSize + 1 ) > mKeys.size() )
+    rehash( std::max( size_t( 16 ), 2 * mKeys.size() ) );
+
+  size_t slot = hash( id );
+  while ( mKeys[slot] != EMPTY )
+  {
+    if ( mKeys[slot] == id )
+      return false;
+    slot = ( slot + 1 ) & mMask;
+  }
+
+  mKeys[slot] = id;
+  mValues[slot] = index;
+  ++mSize;
+  mMaximumId = std::max( mMaximumId, id );
+  return true;
+}
+
+void MDAL::IdToIndexMap::optimize()
+{
+  if ( mIsDense || mSize == 0 )
+    return;
+
+  if ( mEmptyIdIndex != NOT_FOUND || mMaximumId / MAX_DENSE_RATIO >= mSize )
+    return;
+
+  std::vector<size_t> dense( mMaximumId + 1, NOT_FOUND );
+  for ( size_t slot = 0; slot < mKeys.size(); ++slot )
+  {
+    if ( mKeys[slot] != EMPTY )
+      dense[mKeys[slot]] = mValues[slot];
+  }
+
+  mDense.swap( dense );
+  mIsDense = true;
+  std::vector<size_t>().swap( mKeys );
+  std::vector<size_t>().swap( mValues );
+  mMask = 0;
+  mShift = 64;
+}
+
+void MDAL::IdToIndexMap::rehash( size_t capacity )
+{
+  std::vector<size_t> keys( capacity, EMPTY );
+  std::vector<size_t> values( capacity );
+  mKeys.swap( keys );
+  mValues.swap( values );
+  mMask = capacity - 1;
+  mShift = 64;
+  for ( size_t c = capacity; c > 1; c >>= 1 )
+    --mShift;
+
+  for ( size_t i = 0; i < keys.size(); ++i )
+  {
+    if ( keys[i] == EMPTY )
+      continue;
+
+    size_t slot = hash( keys[i] );
+    while ( mKeys[slot] != EMPTY )
+      slot = ( slot + 1 ) & mMask;
+    mKeys[slot] = keys[i];
+    mValues[slot] = values[i];
+  }
+}
+
+void MDAL::IdToIndexMap::toHashTable()
+{
+  std::vector<size_t> dense;
+  dense.swap( mDense );
+  mIsDense = false;
+
+  size_t capacity = 16;
+  while ( capacity < 2 * ( mSize + 1 ) )
+    capacity *= 2;
+
+  mSize = ( mEmptyIdIndex != NOT_FOUND ) ? 1 : 0;
+  rehash( capacity );
+  for ( size_t id = 0; id < dense.size(); ++id )
+  {
+    if ( dense[id] != NOT_FOUND )
+      insert( id, dense[id] );
+  }
+}
@@ -0,0 +1,93 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_ID_MAP_HPP
+#define MDAL_ID_MAP_HPP
+
+#include <stddef.h>
+#include <limits>
+#include <vector>
+
+namespace MDAL
+{
+  /**
+   * Map of native IDs of the elements to their indexes, e.g. for formats with gaps in vertex IDs
+   *
+   * Stored in a dense table indexed by ID when the IDs are dense enough (see optimize()),
+   * in an open addressing hash table with linear probing otherwise. Both give O(1) lookups.
+   */
+  class IdToIndexMap
+  {
+    public:
+      static const size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+      //! Maps id to index, returns false and keeps the mapped index when the id is already present
+      bool insert( size_t id, size_t index );
+
+      //! Returns index of the id or NOT_FOUND
+      size_t find( size_t id ) const
+      {
+        if ( id == EMPTY )
+          return mEmptyIdIndex;
+
+        if ( mIsDense )
+          return id < mDense.size() ? mDense[id] : NOT_FOUND;
+
+        // the map holding only the EMPTY id has no table
+        if ( mKeys.empty() )
+          return NOT_FOUND;
+
+        for ( size_t slot = hash( id ); ; slot = ( slot + 1 ) & mMask )
+        {
+          const size_t key = mKeys[slot];
+          if ( key == id )
+            return mValues[slot];
+          if ( key == EMPTY )
+            return NOT_FOUND;
+        }
+      }
+
+      size_t size() const { return mSize; }
+      bool empty() const { return mSize == 0; }
+
+      //! Returns maximum id in the map, 0 for empty map
+      size_t maximumId() const { return mMaximumId; }
+
+      //! Converts the map to the dense table when it takes at most MAX_DENSE_RATIO slots per item
+      void optimize();
+
+    private:
+      //! Maximum ratio of the dense table length and the number of items
+      static const size_t MAX_DENSE_RATIO = 4;
+      static const size_t EMPTY = std::numeric_limits<size_t>::max();
+
+      size_t hash( size_t id ) const
+      {
+        // Fibonacci hashing, the high bits are well mixed
+        const unsigned long long h = static_cast<unsigned long long>( id ) * 11400714819323198485ull;
+        return static_cast<size_t>( h >> mShift ) & mMask;
+      }
+
+      //! Rebuilds the hash table with capacity slots (power of 2)
+      void rehash( size_t capacity );
+      void toHashTable();
+
+      bool mIsDense = false;
+      std::vector<size_t> mDense;
+
+      std::vector<size_t> mKeys;
+      std::vector<size_t> mValues;
+      size_t mMask = 0;
+      unsigned mShift = 64;
+
+      //! Index of the id equal to EMPTY marker, which cannot be stored in the tables
+      size_t mEmptyIdIndex = NOT_FOUND;
+
+      size_t mSize = 0;
+      size_t mMaximumId = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_ID_MAP_HPP
@@ -0,0 +1,601 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_level_of_detail.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "mdal_parallel.hpp"
+#include "mdal_utils.hpp"
+
+//! Number of fine elements gathered from the source by one read
+static const size_t BLOCK_ELEMENTS = 65536;
+
+//! Maximum number of cell sizes tried for the levels
+static const size_t MAX_LEVELS = 32;
+
+static const uint32_t NO_ELEMENT = std::numeric_limits<uint32_t>::max();
+
+const size_t MDAL::MeshPyramid::MIN_LEVEL_FACES = 256;
+
+//! Fills rows from the row of each item, items are added in ascending order, items without row are skipped
+static void _buildRows( const std::vector<uint32_t> &itemRows, size_t rowsCount, MDAL::AdjacencyRows &rows )
+{
+  rows.offsets.assign( rowsCount + 1, 0 );
+  for ( uint32_t row : itemRows )
+  {
+    if ( row != NO_ELEMENT )
+      ++rows.offsets[row + 1];
+  }
+  for ( size_t row = 0; row < rowsCount; ++row )
+    rows.offsets[row + 1] += rows.offsets[row];
+
+  rows.items.resize( rows.offsets[rowsCount] );
+  std::vector<size_t> position( rows.offsets.begin(), rows.offsets.end() - 1 );
+  for ( size_t item = 0; item < itemRows.size(); ++item )
+  {
+    if ( itemRows[item] != NO_ELEMENT )
+      rows.items[position[itemRows[item]]++] = static_cast<uint32_t>( item );
+  }
+}
+
+static const uint64_t NO_CELL = std::numeric_limits<uint64_t>::max();
+
+//! Vertices and faces of the last clustered level (or the full mesh), which the next level clusters
+struct ClusterBase
+{
+  //! Column and row of the cell of the next level of each vertex, NO_CELL column for the vertices without valid coordinates
+  std::vector<uint64_t> columns;
+  std::vector<uint64_t> rows;
+  //! Sums of the coordinates of the vertices of the full mesh merged to each vertex and their count
+  std::vector<double> sumX;
+  std::vector<double> sumY;
+  std::vector<double> sumZ;
+  std::vector<uint32_t> counts;
+  MDAL::AdjacencyRows faces;
+  //! Vertex and face of each vertex and face of the full mesh, NO_ELEMENT when it is in none
+  std::vector<uint32_t> fineVertices;
+  std::vector<uint32_t> fineFaces;
+};
+
+/**
+ * Clusters the vertices of the base in the cells of the next level and maps the faces of the base to the clusters,
+ * mappings of the full mesh are composed with the mappings of the base. \returns false when the level has no faces
+ */
+static bool _clusterLevel( const ClusterBase &base, ClusterBase &next )
+{
+  // vertices are ordered by cells row by row, vertices of a cell become one vertex
+  const size_t baseVerticesCount = base.counts.size();
+  std::vector<uint32_t> order;
+  order.reserve( baseVerticesCount );
+  for ( size_t v = 0; v < baseVerticesCount; ++v )
+  {
+    if ( base.columns[v] != NO_CELL )
+      order.push_back( static_cast<uint32_t>( v ) );
+  }
+  std::sort( order.begin(), order.end(), [&base]( uint32_t a, uint32_t b )
+  {
+    return base.rows[a] != base.rows[b] ? base.rows[a] < base.rows[b] : base.columns[a] < base.columns[b];
+  } );
+
+  std::vector<uint32_t> vertexClusters( baseVerticesCount, NO_ELEMENT );
+  for ( size_t i = 0; i < order.size(); )
+  {
+    const uint64_t column = base.columns[order[i]];
+    const uint64_t row = base.rows[order[i]];
+    const uint32_t cluster = static_cast<uint32_t>( next.counts.size() );
+    double sum[3] = { 0, 0, 0 };
+    uint32_t count = 0;
+    for ( ; i < order.size() && base.columns[order[i]] == column && base.rows[order[i]] == row; ++i )
+    {
+      const uint32_t v = order[i];
+      vertexClusters[v] = cluster;
+      sum[0] += base.sumX[v];
+      sum[1] += base.sumY[v];
+      sum[2] += base.sumZ[v];
+      count += base.counts[v];
+    }
+    // cells of the next level nest, each holds 2 x 2 cells of this level
+    next.columns.push_back( column / 2 );
+    next.rows.push_back( row / 2 );
+    next.sumX.push_back( sum[0] );
+    next.sumY.push_back( sum[1] );
+    next.sumZ.push_back( sum[2] );
+    next.counts.push_back( count );
+  }
+  if ( next.counts.size() < 3 )
+    return false;
+
+  // faces mapped to cycles of clusters, the same cycle from any start is one face
+  const size_t baseFacesCount = base.faces.rowsCount();
+  MDAL::AdjacencyRows cycles;
+  cycles.offsets.push_back( 0 );
+  std::vector<uint32_t> cycleFaces;
+  std::vector<uint32_t> clusters;
+  for ( size_t f = 0; f < baseFacesCount; ++f )
+  {
+    const uint32_t *face = base.faces.row( f );
+    clusters.clear();
+    for ( size_t j = 0; j < base.faces.rowSize( f ); ++j )
+    {
+      const uint32_t cluster = face[j] < baseVerticesCount ? vertexClusters[face[j]] : NO_ELEMENT;
+      if ( cluster != NO_ELEMENT && ( clusters.empty() || clusters.back() != cluster ) )
+        clusters.push_back( cluster );
+    }
+    while ( clusters.size() > 1 && clusters.back() == clusters.front() )
+      clusters.pop_back();
+    if ( clusters.size() < 3 )
+      continue;
+
+    std::rotate( clusters.begin(), std::min_element( clusters.begin(), clusters.end() ), clusters.end() );
+    cycles.items.insert( cycles.items.end(), clusters.begin(), clusters.end() );
+    cycles.offsets.push_back( cycles.items.size() );
+    cycleFaces.push_back( static_cast<uint32_t>( f ) );
+  }
+
+  // equal cycles are adjacent when sorted, the first of them in the order of the faces makes the face of the level
+  const size_t cyclesCount = cycles.rowsCount();
+  std::vector<uint32_t> cycleOrder( cyclesCount );
+  for ( size_t c = 0; c < cyclesCount; ++c )
+    cycleOrder[c] = static_cast<uint32_t>( c );
+  auto compareCycles = [&cycles]( uint32_t a, uint32_t b )
+  {
+    if ( cycles.rowSize( a ) != cycles.rowSize( b ) )
+      return cycles.rowSize( a ) < cycles.rowSize( b ) ? -1 : 1;
+    for ( size_t j = 0; j < cycles.rowSize( a ); ++j )
+    {
+      if ( cycles.row( a )[j] != cycles.row( b )[j] )
+        return cycles.row( a )[j] < cycles.row( b )[j] ? -1 : 1;
+    }
+    return 0;
+  };
+  std::sort( cycleOrder.begin(), cycleOrder.end(), [&compareCycles]( uint32_t a, uint32_t b )
+  {
+    const int comparison = compareCycles( a, b );
+    return comparison != 0 ? comparison < 0 : a < b;
+  } );
+  std::vector<uint32_t> firstCycles( cyclesCount );
+  for ( size_t i = 0; i < cyclesCount; ++i )
+  {
+    const bool isFirst = i == 0 || compareCycles( cycleOrder[i - 1], cycleOrder[i] ) != 0;
+    firstCycles[cycleOrder[i]] = isFirst ? cycleOrder[i] : firstCycles[cycleOrder[i - 1]];
+  }
+
+  std::vector<uint32_t> baseLevelFaces( baseFacesCount, NO_ELEMENT );
+  std::vector<uint32_t> cycleLevelFaces( cyclesCount, NO_ELEMENT );
+  std::vector<uint32_t> clusterFaces( next.counts.size(), NO_ELEMENT );
+  next.faces.offsets.push_back( 0 );
+  for ( size_t c = 0; c < cyclesCount; ++c )
+  {
+    if ( firstCycles[c] == c )
+    {
+      const uint32_t index = static_cast<uint32_t>( next.faces.rowsCount() );
+      const uint32_t *cycle = cycles.row( c );
+      next.faces.items.insert( next.faces.items.end(), cycle, cycle + cycles.rowSize( c ) );
+      next.faces.offsets.push_back( next.faces.items.size() );
+      for ( size_t j = 0; j < cycles.rowSize( c ); ++j )
+      {
+        if ( clusterFaces[cycle[j]] == NO_ELEMENT )
+          clusterFaces[cycle[j]] = index;
+      }
+      cycleLevelFaces[c] = index;
+    }
+    else
+    {
+      cycleLevelFaces[c] = cycleLevelFaces[firstCycles[c]];
+    }
+    baseLevelFaces[cycleFaces[c]] = cycleLevelFaces[c];
+  }
+  if ( next.faces.rowsCount() == 0 )
+    return false;
+
+  // collapsed faces go to the first face of the level with any of their clusters
+  for ( size_t f = 0; f < baseFacesCount; ++f )
+  {
+    if ( baseLevelFaces[f] != NO_ELEMENT )
+      continue;
+    const uint32_t *face = base.faces.row( f );
+    for ( size_t j = 0; j < base.faces.rowSize( f ) && baseLevelFaces[f] == NO_ELEMENT; ++j )
+    {
+      const uint32_t cluster = face[j] < baseVerticesCount ? vertexClusters[face[j]] : NO_ELEMENT;
+      if ( cluster != NO_ELEMENT )
+        baseLevelFaces[f] = clusterFaces[cluster];
+    }
+  }
+
+  next.fineVertices.resize( base.fineVertices.size() );
+  for ( size_t i = 0; i < base.fineVertices.size(); ++i )
+    next.fineVertices[i] = base.fineVertices[i] == NO_ELEMENT ? NO_ELEMENT : vertexClusters[base.fineVertices[i]];
+  next.fineFaces.resize( base.fineFaces.size() );
+  for ( size_t i = 0; i < base.fineFaces.size(); ++i )
+    next.fineFaces[i] = base.fineFaces[i] == NO_ELEMENT ? NO_ELEMENT : baseLevelFaces[base.fineFaces[i]];
+  return true;
+}
+
+//! Makes the level of the clustered vertices and faces, vertices at the mean of their vertices of the full mesh
+static std::unique_ptr<MDAL::LevelOfDetail> _buildLevel( MDAL::Mesh *mesh, const ClusterBase &clustered, double cellSize )
+{
+  MDAL::Vertices vertices( clustered.counts.size() );
+  for ( size_t v = 0; v < vertices.size(); ++v )
+  {
+    const double count = static_cast<double>( clustered.counts[v] );
+    vertices[v].x = clustered.sumX[v] / count;
+    vertices[v].y = clustered.sumY[v] / count;
+    vertices[v].z = clustered.sumZ[v] / count;
+  }
+
+  MDAL::CompressedFaces faces;
+  std::vector<size_t> face;
+  for ( size_t f = 0; f < clustered.faces.rowsCount(); ++f )
+  {
+    face.assign( clustered.faces.row( f ), clustered.faces.row( f ) + clustered.faces.rowSize( f ) );
+    faces.addFace( face );
+  }
+
+  std::unique_ptr<MDAL::LevelOfDetail> level( new MDAL::LevelOfDetail );
+  level->resolution = cellSize;
+  level->mesh.reset( new MDAL::MemoryMesh( mesh->driverName(),
+                     vertices.size(),
+                     faces.size(),
+                     clustered.faces.maximumRowSize(),
+                     MDAL::computeExtent( vertices ),
+                     mesh->uri() ) );
+  level->mesh->setSourceCrs( mesh->crs() );
+  level->mesh->vertices = vertices;
+  level->mesh->faces = std::move( faces );
+  _buildRows( clustered.fineVertices, level->mesh->verticesCount(), level->fineVertices );
+  _buildRows( clustered.fineFaces, level->mesh->facesCount(), level->fineFaces );
+  return level;
+}
+
+MDAL::MeshPyramid::MeshPyramid( MDAL::Mesh *mesh )
+{
+  assert( mesh->verticesCount() < std::numeric_limits<uint32_t>::max() );
+  assert( mesh->facesCount() < std::numeric_limits<uint32_t>::max() );
+
+  const size_t verticesCount = mesh->verticesCount();
+  const size_t facesCount = mesh->facesCount();
+  if ( verticesCount == 0 || facesCount <= MIN_LEVEL_FACES )
+    return;
+
+  std::vector<double> x( verticesCount );
+  std::vector<double> y( verticesCount );
+  std::vector<double> z( verticesCount );
+  if ( mesh->vertexCoordinates( 0, verticesCount, x.data(), y.data(), z.data() ) != verticesCount )
+    return;
+
+  BBox extent( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+               std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+  size_t validCount = 0;
+  for ( size_t i = 0; i < verticesCount; ++i )
+  {
+    if ( !std::isfinite( x[i] ) || !std::isfinite( y[i] ) )
+      continue;
+    extent.minX = std::min( extent.minX, x[i] );
+    extent.maxX = std::max( extent.maxX, x[i] );
+    extent.minY = std::min( extent.minY, y[i] );
+    extent.maxY = std::max( extent.maxY, y[i] );
+    ++validCount;
+  }
+  const double area = validCount > 0 ? ( extent.maxX - extent.minX ) * ( extent.maxY - extent.minY ) : 0;
+  if ( !( area > 0 ) )
+    return;
+
+  // the cells of the first level hold about four vertices of evenly spread mesh
+  double cellSize = 2 * std::sqrt( area / static_cast<double>( validCount ) );
+
+  ClusterBase base;
+  base.columns.assign( verticesCount, NO_CELL );
+  base.rows.assign( verticesCount, NO_CELL );
+  base.counts.assign( verticesCount, 1 );
+  base.fineVertices.resize( verticesCount );
+  for ( size_t i = 0; i < verticesCount; ++i )
+  {
+    base.fineVertices[i] = static_cast<uint32_t>( i );
+    if ( std::isfinite( x[i] ) && std::isfinite( y[i] ) )
+    {
+      base.columns[i] = static_cast<uint64_t>( ( x[i] - extent.minX ) / cellSize );
+      base.rows[i] = static_cast<uint64_t>( ( y[i] - extent.minY ) / cellSize );
+    }
+  }
+  base.sumX = std::move( x );
+  base.sumY = std::move( y );
+  base.sumZ = std::move( z );
+
+  const size_t blockSize = 65536;
+  const size_t faceVerticesMax = std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) );
+  std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+  std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+  std::unique_ptr<MeshFaceIterator> faceIterator = mesh->readFaces();
+  AdjacencyRows &faces = base.faces;
+  faces.offsets.reserve( facesCount + 1 );
+  faces.offsets.push_back( 0 );
+  while ( faces.rowsCount() < facesCount )
+  {
+    const size_t facesRead = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                             vertexIndices.size(), vertexIndices.data() );
+    if ( facesRead == 0 )
+      break;
+
+    const size_t firstIndex = faces.items.size();
+    for ( size_t i = 0; i < static_cast<size_t>( faceOffsets[facesRead - 1] ); ++i )
+      faces.items.push_back( static_cast<uint32_t>( vertexIndices[i] ) );
+    for ( size_t i = 0; i < facesRead; ++i )
+      faces.offsets.push_back( firstIndex + static_cast<size_t>( faceOffsets[i] ) );
+  }
+  base.fineFaces.resize( faces.rowsCount() );
+  for ( size_t f = 0; f < base.fineFaces.size(); ++f )
+    base.fineFaces[f] = static_cast<uint32_t>( f );
+
+  // each level clusters the previous one, skipped or not, so only the first one goes through all vertices and faces
+  size_t previousFacesCount = faces.rowsCount();
+  for ( size_t i = 0; i < MAX_LEVELS && previousFacesCount > MIN_LEVEL_FACES; ++i, cellSize *= 2 )
+  {
+    ClusterBase next;
+    if ( !_clusterLevel( base, next ) )
+      break;
+    base = std::move( next );
+
+    const size_t levelFacesCount = base.faces.rowsCount();
+    if ( levelFacesCount * 10 >= previousFacesCount * 9 )
+      continue;
+
+    previousFacesCount = levelFacesCount;
+    mLevels.push_back( _buildLevel( mesh, base, cellSize ) );
+  }
+}
+
+MDAL::MeshPyramid::~MeshPyramid() = default;
+
+MDAL::LevelOfDetail &MDAL::MeshPyramid::level( size_t index )
+{
+  assert( index > 0 && index < levelsCount() );
+  return *mLevels[index - 1];
+}
+
+double MDAL::MeshPyramid::resolution( size_t index ) const
+{
+  assert( index < levelsCount() );
+  return index == 0 ? 0 : mLevels[index - 1]->resolution;
+}
+
+size_t MDAL::MeshPyramid::levelAtResolution( double resolution ) const
+{
+  for ( size_t index = mLevels.size(); index > 0; --index )
+  {
+    if ( mLevels[index - 1]->resolution <= resolution )
+      return index;
+  }
+  return 0;
+}
+
+size_t MDAL::MeshPyramid::memoryUsage() const
+{
+  size_t usage = 0;
+  for ( const std::unique_ptr<LevelOfDetail> &level : mLevels )
+  {
+    usage += level->mesh->memoryUsage();
+    usage += ( level->fineVertices.offsets.capacity() + level->fineFaces.offsets.capacity() ) * sizeof( size_t ) +
+             ( level->fineVertices.items.capacity() + level->fineFaces.items.capacity() ) * sizeof( uint32_t );
+  }
+  return usage;
+}
+
+MDAL::LevelOfDetailDataset2D::LevelOfDetailDataset2D( MDAL::DatasetGroup *parent,
+    std::shared_ptr<MDAL::Dataset> source,
+    const MDAL::LevelOfDetail &level,
+    MDAL_LevelOfDetailAggregate aggregate )
+  : Dataset2D( parent )
+  , mSource( source )
+  , mLevel( level )
+  , mAggregate( aggregate )
+{
+  setSupportsActiveFlag( mSource->supportsActiveFlag() );
+  setTime( mSource->time( RelativeTimestamp::hours ) );
+}
+
+MDAL::LevelOfDetailDataset2D::~LevelOfDetailDataset2D() = default;
+
+bool MDAL::LevelOfDetailDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+size_t MDAL::LevelOfDetailDataset2D::aggregate( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer )
+{
+  const bool isOnVertices = group()->dataLocation() == MDAL_DataLocation::DataOnVertices2D;
+  const AdjacencyRows &rows = isOnVertices ? mLevel.fineVertices : mLevel.fineFaces;
+  if ( indexStart >= rows.rowsCount() )
+    return 0;
+  count = std::min( count, rows.rowsCount() - indexStart );
+
+  const MDAL_DataType type = valuesPerElement == 1 ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const bool skipInactive = !isOnVertices && mSource->supportsActiveFlag();
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<size_t> indices;
+  std::vector<double> values;
+  std::vector<int> active;
+  for ( size_t blockStart = 0; blockStart < count; )
+  {
+    // whole rows up to the block size, at least one row
+    size_t blockEnd = blockStart + 1;
+    while ( blockEnd < count && rows.offsets[indexStart + blockEnd + 1] - rows.offsets[indexStart + blockStart] <= BLOCK_ELEMENTS )
+      ++blockEnd;
+    const size_t firstItem = rows.offsets[indexStart + blockStart];
+    const size_t itemsCount = rows.offsets[indexStart + blockEnd] - firstItem;
+
+    indices.assign( rows.items.begin() + static_cast<std::ptrdiff_t>( firstItem ),
+                    rows.items.begin() + static_cast<std::ptrdiff_t>( firstItem + itemsCount ) );
+    values.resize( valuesPerElement * itemsCount );
+    active.assign( itemsCount, 1 );
+    size_t read;
+    {
+      DatasetReadLock lock( mSource.get() );
+      read = itemsCount > 0 ? mSource->dataAtIndices( type, indices.data(), itemsCount, values.data() ) : 0;
+      if ( read == itemsCount && skipInactive && itemsCount > 0 &&
+           mSource->dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, indices.data(), itemsCount, active.data() ) != itemsCount )
+        std::fill( active.begin(), active.end(), 1 );
+    }
+    if ( read != itemsCount )
+      std::fill( values.begin(), values.end(), nan );
+
+    for ( size_t r = blockStart; r < blockEnd; ++r )
+    {
+      const size_t begin = rows.offsets[indexStart + r] - firstItem;
+      const size_t end = rows.offsets[indexStart + r + 1] - firstItem;
+      double *result = buffer + valuesPerElement * r;
+      double sum[2] = { 0, 0 };
+      double maximum = -std::numeric_limits<double>::max();
+      size_t validCount = 0;
+      for ( size_t item = begin; item < end; ++item )
+      {
+        const double *value = values.data() + valuesPerElement * item;
+        const double magnitude = valuesPerElement == 1 ? value[0] : value[0] * value[0] + value[1] * value[1];
+        if ( !active[item] || std::isnan( magnitude ) )
+          continue;
+
+        if ( mAggregate == MDAL_LevelOfDetailAggregate::LevelMaximum )
+        {
+          if ( validCount > 0 && magnitude <= maximum )
+            continue;
+          maximum = magnitude;
+          for ( size_t j = 0; j < valuesPerElement; ++j )
+            result[j] = value[j];
+        }
+        else
+        {
+          for ( size_t j = 0; j < valuesPerElement; ++j )
+            sum[j] += value[j];
+        }
+        ++validCount;
+      }
+
+      for ( size_t j = 0; j < valuesPerElement; ++j )
+      {
+        if ( validCount == 0 )
+          result[j] = nan;
+        else if ( mAggregate == MDAL_LevelOfDetailAggregate::LevelMean )
+          result[j] = sum[j] / static_cast<double>( validCount );
+      }
+    }
+    blockStart = blockEnd;
+  }
+  return count;
+}
+
+size_t MDAL::LevelOfDetailDataset2D::cachedData( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer )
+{
+  const bool isOnVertices = group()->dataLocation() == MDAL_DataLocation::DataOnVertices2D;
+  const size_t elementsCount = ( isOnVertices ? mLevel.fineVertices : mLevel.fineFaces ).rowsCount();
+  if ( indexStart >= elementsCount )
+    return 0;
+  count = std::min( count, elementsCount - indexStart );
+
+  std::unique_lock<std::mutex> lock( mCacheMutex );
+  if ( mValues.empty() )
+  {
+    // aggregated without the lock, the reads of the source take the library lock which the caller may hold already,
+    // concurrent first requests may aggregate twice, the first result is kept
+    lock.unlock();
+    std::vector<double> values( valuesPerElement * elementsCount );
+    aggregate( 0, elementsCount, valuesPerElement, values.data() );
+    lock.lock();
+    if ( mValues.empty() )
+      mValues = std::move( values );
+  }
+  std::copy( mValues.begin() + static_cast<std::ptrdiff_t>( valuesPerElement * indexStart ),
+             mValues.begin() + static_cast<std::ptrdiff_t>( valuesPerElement * ( indexStart + count ) ),
+             buffer );
+  return count;
+}
+
+size_t MDAL::LevelOfDetailDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return cachedData( indexStart, count, 1, buffer );
+}
+
+size_t MDAL::LevelOfDetailDataset2D::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return cachedData( indexStart, count, 2, buffer );
+}
+
+size_t MDAL::LevelOfDetailDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  const AdjacencyRows &rows = mLevel.fineFaces;
+  if ( indexStart >= rows.rowsCount() )
+    return 0;
+  count = std::min( count, rows.rowsCount() - indexStart );
+
+  std::unique_lock<std::mutex> lock( mCacheMutex );
+  if ( mActive.empty() )
+  {
+    // read without the lock like the values
+    lock.unlock();
+    const size_t itemsCount = rows.items.size();
+    std::vector<int> active( itemsCount, 1 );
+    if ( mSource->supportsActiveFlag() && itemsCount > 0 )
+    {
+      const std::vector<size_t> indices( rows.items.begin(), rows.items.end() );
+      DatasetReadLock readLock( mSource.get() );
+      if ( mSource->dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, indices.data(), itemsCount, active.data() ) != itemsCount )
+        std::fill( active.begin(), active.end(), 1 );
+    }
+
+    // face of the level is active with any of its fine faces
+    std::vector<int> levelActive( rows.rowsCount(), 0 );
+    for ( size_t r = 0; r < rows.rowsCount(); ++r )
+    {
+      for ( size_t item = rows.offsets[r]; item < rows.offsets[r + 1] && !levelActive[r]; ++item )
+        levelActive[r] = active[item] ? 1 : 0;
+    }
+    lock.lock();
+    if ( mActive.empty() )
+      mActive = std::move( levelActive );
+  }
+  std::copy( mActive.begin() + static_cast<std::ptrdiff_t>( indexStart ),
+             mActive.begin() + static_cast<std::ptrdiff_t>( indexStart + count ),
+             buffer );
+  return count;
+}
+
+MDAL::DatasetGroup *MDAL::addLevelOfDetailGroup( MDAL::DatasetGroup *group, size_t level, MDAL_LevelOfDetailAggregate aggregate )
+{
+  if ( !group )
+    return nullptr;
+
+  if ( group->dataLocation() != MDAL_DataLocation::DataOnVertices2D && group->dataLocation() != MDAL_DataLocation::DataOnFaces2D )
+    return nullptr;
+
+  if ( aggregate != MDAL_LevelOfDetailAggregate::LevelMean && aggregate != MDAL_LevelOfDetailAggregate::LevelMaximum )
+    return nullptr;
+
+  MeshPyramid &pyramid = group->mesh()->levelsOfDetail();
+  if ( level >= pyramid.levelsCount() )
+    return nullptr;
+  if ( level == 0 )
+    return group;
+
+  LevelOfDetail &levelOfDetail = pyramid.level( level );
+  MDAL::Mesh *mesh = levelOfDetail.mesh.get();
+  std::shared_ptr<DatasetGroup> aggregated = std::make_shared<DatasetGroup>( group->driverName(),
+      mesh,
+      group->uri(),
+      group->name() );
+  aggregated->setDataLocation( group->dataLocation() );
+  aggregated->setIsScalar( group->isScalar() );
+  aggregated->setReferenceTime( group->referenceTime() );
+
+  for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    aggregated->datasets.push_back( std::make_shared<LevelOfDetailDataset2D>( aggregated.get(), dataset, levelOfDetail, aggregate ) );
+
+  mesh->datasetGroups.push_back( aggregated );
+  return aggregated.get();
+}
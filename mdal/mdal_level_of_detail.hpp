@@ -0,0 +1,124 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_LEVEL_OF_DETAIL_HPP
+#define MDAL_LEVEL_OF_DETAIL_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mdal.h"
+#include "mdal_data_model.hpp"
+#include "mdal_memory_data_model.hpp"
+#include "mdal_topology.hpp"
+
+namespace MDAL
+{
+  //! Simplified mesh of the pyramid with the mapping of its elements to the elements of the full mesh
+  struct LevelOfDetail
+  {
+    std::unique_ptr<MemoryMesh> mesh;
+    //! Size of the cells the vertices were clustered by
+    double resolution = 0;
+    //! Vertices of the full mesh merged to each vertex of the level
+    AdjacencyRows fineVertices;
+    //! Faces of the full mesh covered by each face of the level, every face of the full mesh is in one row at most
+    AdjacencyRows fineFaces;
+  };
+
+  /**
+   * Hierarchy of simplified meshes for rendering at lower resolutions, built by Mesh::levelsOfDetail() on first request
+   *
+   * Levels are built by vertex clustering: the vertices of the full mesh are binned to square cells
+   * of the resolution of the level and each occupied cell becomes one vertex at the mean of its vertices.
+   * Faces keep their vertices mapped to the cells, faces collapsed to less than three cells are merged
+   * to a face of the level sharing their cell, faces mapped to the same cells are merged to one.
+   * The cells of the first level are twice the mean spacing of the vertices and double with each level,
+   * so the cells of the levels nest. Cell size not reducing the faces by a tenth is skipped, levels are
+   * added until the level has few faces or all vertices fall to one cell.
+   * Level 0 is the full mesh, which is not stored in the pyramid.
+   * Vertex and face indices must fit into 32 bits.
+   */
+  class MeshPyramid
+  {
+    public:
+      explicit MeshPyramid( Mesh *mesh );
+      ~MeshPyramid();
+
+      //! Number of the levels including the full mesh
+      size_t levelsCount() const { return mLevels.size() + 1; }
+
+      //! Simplified level, 1 <= index < levelsCount()
+      LevelOfDetail &level( size_t index );
+
+      //! Size of the cells of the level, 0 for the full mesh
+      double resolution( size_t index ) const;
+
+      //! Coarsest level with resolution not larger than the resolution, 0 when no simplified level matches
+      size_t levelAtResolution( double resolution ) const;
+
+      //! Bytes held by the levels, their datasets and the mappings
+      size_t memoryUsage() const;
+
+      //! No coarser level is built from a level with this number of faces or less
+      static const size_t MIN_LEVEL_FACES;
+
+    private:
+      std::vector<std::unique_ptr<LevelOfDetail>> mLevels;
+  };
+
+  /**
+   * 2D dataset of a level of the pyramid with the values of the dataset of the full mesh aggregated
+   * over the fine elements of each element of the level
+   *
+   * The first read gathers the values of the fine elements of all elements by Dataset::dataAtIndices(),
+   * the aggregated values (and active flags) of the level are kept by the dataset for the next reads.
+   * Invalid values and values on inactive faces are skipped, element without valid values is NaN.
+   * Vectors are averaged by components for the mean, the maximum takes the vector of the largest magnitude.
+   * The face of the level is active when any of its fine faces is active.
+   */
+  class LevelOfDetailDataset2D: public Dataset2D
+  {
+    public:
+      LevelOfDetailDataset2D( DatasetGroup *parent,
+                              std::shared_ptr<Dataset> source,
+                              const LevelOfDetail &level,
+                              MDAL_LevelOfDetailAggregate aggregate );
+      ~LevelOfDetailDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Reads of the source are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+    private:
+      //! Aggregates count elements from indexStart, valuesPerElement is 1 for scalars or 2 for vectors
+      size_t aggregate( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer );
+
+      //! Copies count values from indexStart of the aggregated values, which are aggregated on the first call
+      size_t cachedData( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer );
+
+      std::shared_ptr<Dataset> mSource;
+      const LevelOfDetail &mLevel;
+      MDAL_LevelOfDetailAggregate mAggregate;
+
+      //! Guards the cached values only, not held while the source is read
+      std::mutex mCacheMutex;
+      std::vector<double> mValues;
+      std::vector<int> mActive;
+  };
+
+  /**
+   * Adds group with the datasets of the group aggregated to the level of the pyramid of its mesh, see LevelOfDetailDataset2D
+   * The group is added to the mesh of the level and removed with the mesh of the group
+   * \returns the new group, the group itself for level 0 or nullptr when the group is not defined on vertices or faces
+   */
+  DatasetGroup *addLevelOfDetailGroup( DatasetGroup *group, size_t level, MDAL_LevelOfDetailAggregate aggregate );
+} // namespace MDAL
+#endif //MDAL_LEVEL_OF_DETAIL_HPP
@@ -0,0 +1,409 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_location_conversion.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "mdal_parallel.hpp"
+
+//! Number of target elements converted from one read of the source
+static const size_t BLOCK_ELEMENTS = 65536;
+//! Number of elements (faces or vertices) processed by one parallel task
+static const size_t TASK_ELEMENTS = 2048;
+
+MDAL::LocationConversion::LocationConversion( MDAL::Mesh *mesh, MDAL_DataLocation targetLocation, MDAL_ConversionWeighting weighting )
+  : mMesh( mesh )
+  , mTargetLocation( targetLocation )
+  , mWeighting( weighting )
+{
+  assert( targetLocation == MDAL_DataLocation::DataOnVertices2D || targetLocation == MDAL_DataLocation::DataOnFaces2D );
+}
+
+const MDAL::AdjacencyRows &MDAL::LocationConversion::rows()
+{
+  calculate();
+  if ( mTargetLocation == MDAL_DataLocation::DataOnFaces2D )
+    return mFaceRows;
+  return mMesh->topology().vertexFaces();
+}
+
+const MDAL::SpillVector<double> &MDAL::LocationConversion::weights()
+{
+  calculate();
+  return mWeights;
+}
+
+void MDAL::LocationConversion::calculate()
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( mIsCalculated )
+    return;
+
+  AdjacencyRows faces;
+  SpillVector<double> faceWeights;
+  calculateFaceWeights( faces, faceWeights );
+
+  if ( mTargetLocation == MDAL_DataLocation::DataOnFaces2D )
+  {
+    mFaceRows = std::move( faces );
+    mWeights = std::move( faceWeights );
+    mIsCalculated = true;
+    return;
+  }
+
+  // weights of the faces of the vertices, in the order of the vertex faces of the topology
+  const AdjacencyRows &vertexFaces = mMesh->topology().vertexFaces();
+  const size_t verticesCount = vertexFaces.rowsCount();
+  const size_t facesCount = faces.rowsCount();
+  mWeights.assign( vertexFaces.items.size(), 0 );
+  const size_t tasks = ( facesCount + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+  parallelFor( tasks, [&]( size_t task )
+  {
+    // each face writes only its own items of the vertex rows
+    const size_t end = std::min( facesCount, ( task + 1 ) * TASK_ELEMENTS );
+    for ( size_t f = task * TASK_ELEMENTS; f < end; ++f )
+    {
+      const uint32_t *face = faces.row( f );
+      const double *weights = faceWeights.data() + faces.offsets[f];
+      for ( size_t j = 0; j < faces.rowSize( f ); ++j )
+      {
+        const uint32_t v = face[j];
+        if ( v >= verticesCount )
+          continue;
+        const uint32_t *vertexRow = vertexFaces.row( v );
+        const uint32_t *item = std::lower_bound( vertexRow, vertexRow + vertexFaces.rowSize( v ), static_cast<uint32_t>( f ) );
+        mWeights[vertexFaces.offsets[v] + static_cast<size_t>( item - vertexRow )] += weights[j];
+      }
+    }
+  } );
+
+  mIsCalculated = true;
+}
+
+void MDAL::LocationConversion::calculateFaceWeights( MDAL::AdjacencyRows &faces, MDAL::SpillVector<double> &weights )
+{
+  const size_t verticesCount = mMesh->verticesCount();
+  const size_t facesCount = mMesh->facesCount();
+  const size_t blockSize = 65536;
+
+  std::vector<double> x( verticesCount );
+  std::vector<double> y( verticesCount );
+  if ( mWeighting != MDAL_ConversionWeighting::EqualWeights )
+  {
+    std::vector<double> coordinates( 3 * std::min( verticesCount, blockSize ) );
+    std::unique_ptr<MeshVertexIterator> vertexIterator = mMesh->readVertices();
+    size_t vertexStart = 0;
+    while ( vertexStart < verticesCount )
+    {
+      const size_t verticesRead = vertexIterator->next( std::min( blockSize, verticesCount - vertexStart ), coordinates.data() );
+      if ( verticesRead == 0 )
+        break;
+      for ( size_t i = 0; i < verticesRead; ++i )
+      {
+        x[vertexStart + i] = coordinates[3 * i];
+        y[vertexStart + i] = coordinates[3 * i + 1];
+      }
+      vertexStart += verticesRead;
+    }
+  }
+
+  const size_t faceVerticesMax = std::max( mMesh->faceVerticesMaximumCount(), size_t( 1 ) );
+  std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+  std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+  std::unique_ptr<MeshFaceIterator> faceIterator = mMesh->readFaces();
+  faces.offsets.reserve( facesCount + 1 );
+  faces.offsets.push_back( 0 );
+  while ( faces.rowsCount() < facesCount )
+  {
+    const size_t facesRead = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                             vertexIndices.size(), vertexIndices.data() );
+    if ( facesRead == 0 )
+      break;
+
+    const size_t firstIndex = faces.items.size();
+    for ( size_t i = 0; i < static_cast<size_t>( faceOffsets[facesRead - 1] ); ++i )
+      faces.items.push_back( static_cast<uint32_t>( vertexIndices[i] ) );
+    for ( size_t i = 0; i < facesRead; ++i )
+      faces.offsets.push_back( firstIndex + static_cast<size_t>( faceOffsets[i] ) );
+  }
+
+  weights.assign( faces.items.size(), 1 );
+  if ( mWeighting == MDAL_ConversionWeighting::EqualWeights )
+    return;
+
+  const size_t tasks = ( faces.rowsCount() + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+  parallelFor( tasks, [&]( size_t task )
+  {
+    const size_t end = std::min( faces.rowsCount(), ( task + 1 ) * TASK_ELEMENTS );
+    for ( size_t f = task * TASK_ELEMENTS; f < end; ++f )
+    {
+      const uint32_t *face = faces.row( f );
+      const size_t n = faces.rowSize( f );
+      double *faceWeights = weights.data() + faces.offsets[f];
+
+      // centre of the face is the mean of its vertices
+      double centreX = 0;
+      double centreY = 0;
+      size_t validCount = 0;
+      for ( size_t j = 0; j < n; ++j )
+      {
+        if ( face[j] >= verticesCount )
+          continue;
+        centreX += x[face[j]];
+        centreY += y[face[j]];
+        ++validCount;
+      }
+      if ( validCount == 0 )
+        continue;
+      centreX /= static_cast<double>( validCount );
+      centreY /= static_cast<double>( validCount );
+
+      if ( mWeighting == MDAL_ConversionWeighting::AreaWeights )
+      {
+        // the part of the face closest to the vertex is half of the triangles of the centre and both sides of the vertex
+        double total = 0;
+        for ( size_t j = 0; j < n; ++j )
+        {
+          const uint32_t previous = face[( j + n - 1 ) % n];
+          const uint32_t next = face[( j + 1 ) % n];
+          if ( face[j] >= verticesCount || previous >= verticesCount || next >= verticesCount )
+          {
+            faceWeights[j] = 0;
+            continue;
+          }
+          const double dx = x[face[j]] - centreX;
+          const double dy = y[face[j]] - centreY;
+          const double previousArea = std::fabs( ( x[previous] - centreX ) * dy - ( y[previous] - centreY ) * dx );
+          const double nextArea = std::fabs( dx * ( y[next] - centreY ) - dy * ( x[next] - centreX ) );
+          faceWeights[j] = ( previousArea + nextArea ) / 4;
+          total += faceWeights[j];
+        }
+        // degenerate face takes the mean of its vertices
+        if ( !( total > 0 ) )
+        {
+          for ( size_t j = 0; j < n; ++j )
+            faceWeights[j] = face[j] < verticesCount ? 1 : 0;
+        }
+      }
+      else
+      {
+        // vertex in the centre takes the whole weight
+        bool hasCentreVertex = false;
+        for ( size_t j = 0; j < n; ++j )
+        {
+          if ( face[j] >= verticesCount )
+          {
+            faceWeights[j] = 0;
+            continue;
+          }
+          const double distance = std::hypot( x[face[j]] - centreX, y[face[j]] - centreY );
+          hasCentreVertex = hasCentreVertex || distance == 0;
+          faceWeights[j] = distance > 0 ? 1 / distance : 0;
+        }
+        if ( hasCentreVertex )
+        {
+          for ( size_t j = 0; j < n; ++j )
+            faceWeights[j] = ( face[j] < verticesCount && x[face[j]] == centreX && y[face[j]] == centreY ) ? 1 : 0;
+        }
+      }
+    }
+  } );
+}
+
+MDAL::ConvertedDataset2D::ConvertedDataset2D( MDAL::DatasetGroup *parent,
+    std::shared_ptr<MDAL::Dataset> source,
+    std::shared_ptr<MDAL::LocationConversion> conversion )
+  : Dataset2D( parent )
+  , mSource( source )
+  , mConversion( conversion )
+{
+  setSupportsActiveFlag( source->supportsActiveFlag() );
+  setTime( source->time( RelativeTimestamp::hours ) );
+}
+
+MDAL::ConvertedDataset2D::~ConvertedDataset2D() = default;
+
+bool MDAL::ConvertedDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+size_t MDAL::ConvertedDataset2D::convert( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer )
+{
+  const AdjacencyRows &rows = mConversion->rows();
+  const SpillVector<double> &weights = mConversion->weights();
+  const size_t elementsCount = rows.rowsCount();
+  if ( indexStart >= elementsCount || count == 0 )
+    return 0;
+  count = std::min( count, elementsCount - indexStart );
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const bool toFaces = mConversion->targetLocation() == MDAL_DataLocation::DataOnFaces2D;
+  const bool useActive = mSource->supportsActiveFlag();
+  const MDAL_DataType type = valuesPerElement == 1 ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const size_t sourceValuesCount = mSource->valuesCount();
+  std::vector<size_t> sourceIndices;
+  std::vector<uint32_t> positions;
+  std::vector<double> values;
+  std::vector<int> active;
+
+  for ( size_t blockStart = indexStart; blockStart < indexStart + count; blockStart += BLOCK_ELEMENTS )
+  {
+    const size_t blockEnd = std::min( indexStart + count, blockStart + BLOCK_ELEMENTS );
+    double *result = buffer + valuesPerElement * ( blockStart - indexStart );
+
+    // the block gathers only the distinct source elements of its items, wherever they are in the source
+    const size_t firstItem = rows.offsets[blockStart];
+    const size_t itemsCount = rows.offsets[blockEnd] - firstItem;
+    sourceIndices.clear();
+    for ( size_t i = 0; i < itemsCount; ++i )
+    {
+      const size_t item = rows.items[firstItem + i];
+      if ( item < sourceValuesCount )
+        sourceIndices.push_back( item );
+    }
+    std::sort( sourceIndices.begin(), sourceIndices.end() );
+    sourceIndices.erase( std::unique( sourceIndices.begin(), sourceIndices.end() ), sourceIndices.end() );
+
+    // position of the source value of each item, items out of the source point past the gathered values
+    positions.resize( itemsCount );
+    for ( size_t i = 0; i < itemsCount; ++i )
+    {
+      const size_t item = rows.items[firstItem + i];
+      positions[i] = static_cast<uint32_t>( item < sourceValuesCount ?
+                                            std::lower_bound( sourceIndices.begin(), sourceIndices.end(), item ) - sourceIndices.begin() :
+                                            sourceIndices.size() );
+    }
+
+    const size_t sourceCount = sourceIndices.size();
+    values.assign( valuesPerElement * ( sourceCount + 1 ), nan );
+    {
+      DatasetReadLock lock( mSource.get() );
+      if ( sourceCount > 0 && mSource->dataAtIndices( type, sourceIndices.data(), sourceCount, values.data() ) != sourceCount )
+        std::fill( values.begin(), values.end(), nan );
+
+      // active flags are on faces, the target faces of the block or the gathered source faces
+      if ( useActive )
+      {
+        if ( toFaces )
+        {
+          active.resize( blockEnd - blockStart );
+          const size_t activeRead = mSource->activeData( blockStart, active.size(), active.data() );
+          std::fill( active.begin() + static_cast<std::ptrdiff_t>( activeRead ), active.end(), 0 );
+        }
+        else
+        {
+          active.assign( sourceCount + 1, 0 );
+          if ( sourceCount > 0 && mSource->dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, sourceIndices.data(), sourceCount, active.data() ) != sourceCount )
+            std::fill( active.begin(), active.end(), 0 );
+        }
+      }
+    }
+
+    const size_t tasks = ( blockEnd - blockStart + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+    parallelFor( tasks, [&]( size_t task )
+    {
+      const size_t taskStart = blockStart + task * TASK_ELEMENTS;
+      const size_t taskEnd = std::min( blockEnd, taskStart + TASK_ELEMENTS );
+      for ( size_t e = taskStart; e < taskEnd; ++e )
+      {
+        double *value = result + valuesPerElement * ( e - blockStart );
+        if ( useActive && toFaces && !active[e - blockStart] )
+        {
+          std::fill( value, value + valuesPerElement, nan );
+          continue;
+        }
+
+        const uint32_t *itemPositions = positions.data() + ( rows.offsets[e] - firstItem );
+        const double *itemWeights = weights.data() + rows.offsets[e];
+        double sumX = 0;
+        double sumY = 0;
+        double sumWeights = 0;
+        for ( size_t j = 0; j < rows.rowSize( e ); ++j )
+        {
+          const size_t s = itemPositions[j];
+          if ( useActive && !toFaces && !active[s] )
+            continue;
+          const double *sourceValue = values.data() + valuesPerElement * s;
+          if ( std::isnan( sourceValue[0] ) || ( valuesPerElement == 2 && std::isnan( sourceValue[1] ) ) )
+            continue;
+          sumX += itemWeights[j] * sourceValue[0];
+          if ( valuesPerElement == 2 )
+            sumY += itemWeights[j] * sourceValue[1];
+          sumWeights += itemWeights[j];
+        }
+
+        if ( sumWeights > 0 )
+        {
+          value[0] = sumX / sumWeights;
+          if ( valuesPerElement == 2 )
+            value[1] = sumY / sumWeights;
+        }
+        else
+          std::fill( value, value + valuesPerElement, nan );
+      }
+    } );
+  }
+  return count;
+}
+
+size_t MDAL::ConvertedDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return convert( indexStart, count, 1, buffer );
+}
+
+size_t MDAL::ConvertedDataset2D::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return convert( indexStart, count, 2, buffer );
+}
+
+size_t MDAL::ConvertedDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  // active flags are defined on faces for both locations
+  DatasetReadLock lock( mSource.get() );
+  return mSource->activeData( indexStart, count, buffer );
+}
+
+MDAL::DatasetGroup *MDAL::addConvertedGroup( MDAL::DatasetGroup *group, MDAL_ConversionWeighting weighting, const std::string &name )
+{
+  if ( !group )
+    return nullptr;
+
+  if ( weighting != MDAL_ConversionWeighting::EqualWeights && weighting != MDAL_ConversionWeighting::AreaWeights &&
+       weighting != MDAL_ConversionWeighting::InverseDistanceWeights )
+    return nullptr;
+
+  MDAL_DataLocation targetLocation;
+  if ( group->dataLocation() == MDAL_DataLocation::DataOnVertices2D )
+    targetLocation = MDAL_DataLocation::DataOnFaces2D;
+  else if ( group->dataLocation() == MDAL_DataLocation::DataOnFaces2D )
+    targetLocation = MDAL_DataLocation::DataOnVertices2D;
+  else
+    return nullptr;
+
+  MDAL::Mesh *mesh = group->mesh();
+  std::shared_ptr<DatasetGroup> converted = std::make_shared<DatasetGroup>( group->driverName(),
+      mesh,
+      group->uri(),
+      name );
+  converted->setDataLocation( targetLocation );
+  converted->setIsScalar( group->isScalar() );
+  converted->setReferenceTime( group->referenceTime() );
+
+  // weights are calculated on the first read of any dataset of the group
+  std::shared_ptr<LocationConversion> conversion = std::make_shared<LocationConversion>( mesh, targetLocation, weighting );
+  for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    converted->datasets.push_back( std::make_shared<ConvertedDataset2D>( converted.get(), dataset, conversion ) );
+
+  mesh->datasetGroups.push_back( converted );
+  return converted.get();
+}
@@ -0,0 +1,100 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_LOCATION_CONVERSION_HPP
+#define MDAL_LOCATION_CONVERSION_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "mdal.h"
+#include "mdal_data_model.hpp"
+#include "mdal_spill.hpp"
+#include "mdal_topology.hpp"
+
+namespace MDAL
+{
+  /**
+   * Weights of the conversion between the values on vertices and on faces of the mesh
+   *
+   * The weight of the pair of the face and its vertex is used in both directions:
+   * the face value is the weighted mean of its vertices, the vertex value is the weighted
+   * mean of its faces. Weights are calculated for the direction of the group on the first
+   * request, shared by all datasets of the group and kept until the mesh is closed.
+   */
+  class LocationConversion
+  {
+    public:
+      LocationConversion( Mesh *mesh, MDAL_DataLocation targetLocation, MDAL_ConversionWeighting weighting );
+
+      MDAL_DataLocation targetLocation() const { return mTargetLocation; }
+
+      /**
+       * Rows of the target elements with the source elements to average, calculated on the first call
+       *
+       * Vertices of the faces for the target on faces, faces of the vertices (see MeshTopology::vertexFaces())
+       * for the target on vertices
+       */
+      const AdjacencyRows &rows();
+
+      //! Weights of the items of rows()
+      const SpillVector<double> &weights();
+
+    private:
+      void calculate();
+
+      //! Reads the faces and the weights of their vertices
+      void calculateFaceWeights( AdjacencyRows &faces, SpillVector<double> &weights );
+
+      Mesh *mMesh = nullptr;
+      MDAL_DataLocation mTargetLocation;
+      MDAL_ConversionWeighting mWeighting;
+
+      std::mutex mMutex;
+      bool mIsCalculated = false;
+      AdjacencyRows mFaceRows;
+      SpillVector<double> mWeights;
+  };
+
+  /**
+   * 2D dataset on vertices converted from the dataset on faces or the opposite
+   *
+   * Nothing is stored, each request converts the range in blocks of target elements: the distinct
+   * source elements used by the block are gathered by Dataset::dataAtIndices() and averaged in parallel
+   * for the parts of the block. Invalid (NaN in any component) values and values on inactive faces
+   * are skipped, elements without valid values are NaN. The active flags are the flags of the source, both are defined on faces.
+   */
+  class ConvertedDataset2D: public Dataset2D
+  {
+    public:
+      ConvertedDataset2D( DatasetGroup *parent,
+                          std::shared_ptr<Dataset> source,
+                          std::shared_ptr<LocationConversion> conversion );
+      ~ConvertedDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Reads of the source are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+    private:
+      //! Converts count target values from indexStart, valuesPerElement is 1 for scalars or 2 for vectors
+      size_t convert( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer );
+
+      std::shared_ptr<Dataset> mSource;
+      std::shared_ptr<LocationConversion> mConversion;
+  };
+
+  /**
+   * Adds group with the datasets of the group converted from vertices to faces or from faces to vertices
+   * \returns the new group or nullptr when the group is not defined on vertices or faces or the weighting is unknown
+   */
+  DatasetGroup *addConvertedGroup( DatasetGroup *group, MDAL_ConversionWeighting weighting, const std::string &name );
+} // namespace MDAL
+#endif //MDAL_LOCATION_CONVERSION_HPP
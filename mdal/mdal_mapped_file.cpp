@@ -0,0 +1,189 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_mapped_file.hpp"
+
+#include <fstream>
+
+#include "mdal_perf.hpp"
+#include "mdal_remote.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MDAL::MappedFile::MappedFile( const std::string &fileName )
+{
+  if ( isRemoteUri( fileName ) )
+    mIsValid = readRemote( fileName );
+  else
+    mIsValid = map( fileName ) || read( fileName );
+  MDAL_PERF_ADD( PerfCounter::MappedFileBytes, static_cast<long long>( mSize ) );
+}
+
+MDAL::MappedFile::~MappedFile()
+{
+  unmap();
+}
+
+bool MDAL::MappedFile::isValid() const
+{
+  return mIsValid;
+}
+
+const char *MDAL::MappedFile::data() const
+{
+  return mData;
+}
+
+size_t MDAL::MappedFile::size() const
+{
+  return mSize;
+}
+
+#ifdef _WIN32
+
+bool MDAL::MappedFile::map( const std::string &fileName )
+{
+  HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+  if ( file == INVALID_HANDLE_VALUE )
+    return false;
+
+  LARGE_INTEGER fileSize;
+  if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 )
+  {
+    // empty files cannot be mapped
+    CloseHandle( file );
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+  if ( !mapping )
+  {
+    CloseHandle( file );
+    return false;
+  }
+
+  void *view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  if ( !view )
+  {
+    CloseHandle( mapping );
+    CloseHandle( file );
+    return false;
+  }
+
+  mFileHandle = file;
+  mMappingHandle = mapping;
+  mData = static_cast<const char *>( view );
+  mSize = static_cast<size_t>( fileSize.QuadPart );
+  mIsMapped = true;
+  return true;
+}
+
+void MDAL::MappedFile::unmap()
+{
+  if ( mIsMapped )
+  {
+    UnmapViewOfFile( mData );
+    CloseHandle( mMappingHandle );
+    CloseHandle( mFileHandle );
+    mIsMapped = false;
+  }
+  mData = nullptr;
+}
+
+#else
+
+bool MDAL::MappedFile::map( const std::string &fileName )
+{
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    return false;
+
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+  {
+    // empty files cannot be mapped
+    close( fd );
+    return false;
+  }
+
+  const size_t fileSize = static_cast<size_t>( st.st_size );
+  void *addr = mmap( nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+  // the mapping keeps its own reference to the file
+  close( fd );
+  if ( addr == MAP_FAILED )
+    return false;
+
+#ifdef POSIX_MADV_SEQUENTIAL
+  posix_madvise( addr, fileSize, POSIX_MADV_SEQUENTIAL );
+#endif
+
+  mData = static_cast<const char *>( addr );
+  mSize = fileSize;
+  mIsMapped = true;
+  return true;
+}
+
+void MDAL::MappedFile::unmap()
+{
+  if ( mIsMapped )
+  {
+    munmap( const_cast<char *>( mData ), mSize );
+    mIsMapped = false;
+  }
+  mData = nullptr;
+}
+
+#endif
+
+bool MDAL::MappedFile::read( const std::string &fileName )
+{
+  std::ifstream in( fileName, std::ifstream::in | std::ifstream::binary );
+  if ( !in )
+    return false;
+
+  in.seekg( 0, std::ios::end );
+  const std::streamoff fileSize = in.tellg();
+  if ( fileSize < 0 )
+    return false;
+  in.seekg( 0, std::ios::beg );
+
+  mBuffer.resize( static_cast<size_t>( fileSize ) );
+  if ( fileSize > 0 && !in.read( mBuffer.data(), fileSize ) )
+    return false;
+
+  mData = mBuffer.empty() ? nullptr : mBuffer.data();
+  mSize = mBuffer.size();
+  return true;
+}
+
+bool MDAL::MappedFile::readRemote( const std::string &uri )
+{
+  std::shared_ptr<RemoteFile> remote = RemoteFile::open( uri );
+  if ( !remote )
+    return false;
+
+  // the blocks fetched by the format detection of the shared file are not requested again
+  mBuffer.resize( static_cast<size_t>( remote->size() ) );
+  if ( remote->read( 0, mBuffer.size(), mBuffer.data() ) != mBuffer.size() )
+    return false;
+
+  mData = mBuffer.empty() ? nullptr : mBuffer.data();
+  mSize = mBuffer.size();
+  return true;
+}
@@ -0,0 +1,62 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_MAPPED_FILE_HPP
+#define MDAL_MAPPED_FILE_HPP
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace MDAL
+{
+  /**
+   * Read-only view of the whole file content
+   *
+   * The file is memory-mapped, so the operating system pages the content
+   * on demand and no copy is made. If the mapping is not possible
+   * (e.g. unsupported file system), the content is read to the memory.
+   * Remote files (see isRemoteUri()) are always read to the memory.
+   *
+   * The buffer is NOT null terminated
+   */
+  class MappedFile
+  {
+    public:
+      explicit MappedFile( const std::string &fileName );
+      ~MappedFile();
+
+      MappedFile( const MappedFile & ) = delete;
+      MappedFile &operator=( const MappedFile & ) = delete;
+
+      //! Whether the file was opened successfully
+      bool isValid() const;
+
+      //! Pointer to the first byte of the file, nullptr for empty or invalid file
+      const char *data() const;
+
+      //! Size of the file in bytes
+      size_t size() const;
+
+    private:
+      bool map( const std::string &fileName );
+      bool read( const std::string &fileName );
+      bool readRemote( const std::string &uri );
+      void unmap();
+
+      const char *mData = nullptr;
+      size_t mSize = 0;
+      bool mIsValid = false;
+      bool mIsMapped = false;
+      std::vector<char> mBuffer; // used only when the mapping fails or for remote files
+
+#ifdef _WIN32
+      void *mFileHandle = nullptr;
+      void *mMappingHandle = nullptr;
+#endif
+  };
+
+} // namespace MDAL
+#endif //MDAL_MAPPED_FILE_HPP
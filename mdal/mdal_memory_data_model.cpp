@@ -9,36 +9,120 @@
 #include <cstring>
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include "mdal_utils.hpp"
+#include "mdal_options.hpp"
+#include "mdal_spatial_index.hpp"
+#include "mdal_regular_grid_mesh.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_simd.hpp"
 
 MDAL::MemoryDataset2D::MemoryDataset2D( MDAL::DatasetGroup *grp, bool hasActiveFlag )
   : Dataset2D( grp )
-  , mValues( group()->isScalar() ? valuesCount() : 2 * valuesCount(),
-             std::numeric_limits<double>::quiet_NaN() )
+  , mArena( grp->mesh()->memoryArena() )
+  , mSinglePrecision( MDAL::openOptionAsBool( MDAL::OPTION_SINGLE_PRECISION ) )
 {
+  const size_t count = group()->isScalar() ? valuesCount() : 2 * valuesCount();
+  if ( mSinglePrecision )
+    mFloatValues = SpillVector<float>( count, std::numeric_limits<float>::quiet_NaN(), arenaAllocator<float>() );
+  else
+    mValues = SpillVector<double>( count, std::numeric_limits<double>::quiet_NaN(), arenaAllocator<double>() );
+
   setSupportsActiveFlag( hasActiveFlag );
   if ( hasActiveFlag )
   {
     assert( grp->dataLocation() == MDAL_DataLocation::DataOnVertices2D );
-    mActive = std::vector<int>( mesh()->facesCount(), 1 );
+    mActive = SpillVector<unsigned char>( ( mesh()->facesCount() + 7 ) / 8, 0xFF, arenaAllocator<unsigned char>() );
   }
 }
 
 MDAL::MemoryDataset2D::~MemoryDataset2D() = default;
 
+bool MDAL::MemoryDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
 size_t MDAL::MemoryDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
 {
   assert( supportsActiveFlag() );
-  size_t nValues = mActive.size();
+  size_t nValues = mesh()->facesCount();
 
   if ( ( count < 1 ) || ( indexStart >= nValues ) )
     return 0;
 
   size_t copyValues = std::min( nValues - indexStart, count );
-  memcpy( buffer, mActive.data() + indexStart, copyValues * sizeof( int ) );
+  MDAL::unpackBits( mActive.data(), indexStart, copyValues, buffer );
   return copyValues;
 }
 
+size_t MDAL::MemoryDataset2D::activeDataBits( size_t indexStart, size_t count, unsigned char *buffer )
+{
+  assert( supportsActiveFlag() );
+  size_t nValues = mesh()->facesCount();
+
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  MDAL::copyBits( mActive.data(), nValues, indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+template <typename HasAllValues>
+void MDAL::MemoryDataset2D::deactivateFaces( size_t facesCount, HasAllValues hasAllValues )
+{
+  // blocks are whole bytes of flags, so no byte is written by two threads
+  const size_t blockFaces = 1 << 16;
+  const size_t blockCount = ( facesCount + blockFaces - 1 ) / blockFaces;
+
+  parallelFor( blockCount, [this, facesCount, blockFaces, &hasAllValues]( size_t block )
+  {
+    const size_t blockEnd = std::min( facesCount, ( block + 1 ) * blockFaces );
+    for ( size_t idx = block * blockFaces; idx < blockEnd; idx += 8 )
+    {
+      unsigned char invalid = 0;
+      const size_t n = std::min( blockEnd - idx, size_t( 8 ) );
+      for ( size_t j = 0; j < n; ++j )
+      {
+        if ( !hasAllValues( idx + j ) )
+          invalid |= static_cast<unsigned char>( 1 << j );
+      }
+      mActive[idx / 8] &= static_cast<unsigned char>( ~invalid ); //NOT ACTIVE
+    }
+  } );
+}
+
+struct MDAL::MemoryDataset2D::ActivateFacesKernel
+{
+  ActivateFacesKernel( MemoryDataset2D &dataset, const CompressedFaces &faces, bool isScalar )
+    : dataset( dataset ), faces( faces ), isScalar( isScalar )
+  {}
+
+  template<size_t N>
+  void operator()( FaceArity<N> )
+  {
+    const CompressedFaces &faces = this->faces;
+    const MemoryDataset2D &dataset = this->dataset;
+    const bool isScalar = this->isScalar;
+    this->dataset.deactivateFaces( faces.size(), [&faces, &dataset, isScalar]( size_t idx )
+    {
+      size_t count = 0;
+      const size_t start = faces.faceRange<N>( idx, count );
+      for ( size_t i = 0; i < count; ++i )
+      {
+        if ( !dataset.hasValue( faces.vertexIndexAt( start + i ), isScalar ) )
+          return false;
+      }
+      return true;
+    } );
+  }
+
+  MemoryDataset2D &dataset;
+  const CompressedFaces &faces;
+  bool isScalar;
+};
+
 void MDAL::MemoryDataset2D::activateFaces( MDAL::MemoryMesh *mesh )
 {
   assert( mesh );
@@ -48,54 +132,142 @@ void MDAL::MemoryDataset2D::activateFaces( MDAL::MemoryMesh *mesh )
   bool isScalar = group()->isScalar();
 
   // Activate only Faces that do all Vertex's outputs with some data
-  const size_t nFaces = mesh->facesCount();
+  const CompressedFaces &faces = mesh->faces;
+  assert( faces.size() == mesh->facesCount() );
+
+  ActivateFacesKernel kernel( *this, faces, isScalar );
+  dispatchFaceArity( faces.uniformVerticesCount(), kernel );
+}
 
-  for ( unsigned int idx = 0; idx < nFaces; ++idx )
+void MDAL::MemoryDataset2D::activateFaces( const MDAL::RegularGridMesh *mesh )
+{
+  assert( mesh );
+  assert( supportsActiveFlag() );
+  assert( group()->dataLocation() == MDAL_DataLocation::DataOnVertices2D );
+
+  const bool isScalar = group()->isScalar();
+  deactivateFaces( mesh->facesCount(), [this, mesh, isScalar]( size_t idx )
   {
-    Face elem = mesh->faces.at( idx );
-    for ( size_t i = 0; i < elem.size(); ++i )
+    size_t indices[4];
+    mesh->faceVertices( idx, indices );
+    for ( size_t i = 0; i < 4; ++i )
     {
-      const size_t vertexIndex = elem[i];
-      if ( isScalar )
-      {
-        const double val = mValues[vertexIndex];
-        if ( std::isnan( val ) )
-        {
-          mActive[idx] = 0; //NOT ACTIVE
-          break;
-        }
-      }
-      else
-      {
-        const double x = mValues[2 * vertexIndex];
-        const double y = mValues[2 * vertexIndex + 1];
-        if ( std::isnan( x ) || std::isnan( y ) )
-        {
-          mActive[idx] = 0; //NOT ACTIVE
-          break;
-        }
-      }
+      if ( !hasValue( indices[i], isScalar ) )
+        return false;
     }
-  }
+    return true;
+  } );
 }
 
 void MDAL::MemoryDataset2D::setActive( const int *activeBuffer )
 {
   assert( supportsActiveFlag() );
-  memcpy( mActive.data(), activeBuffer, sizeof( int ) * mesh()->facesCount() );
+  MDAL::packBits( activeBuffer, mesh()->facesCount(), mActive.data() );
+}
+
+void MDAL::MemoryDataset2D::compress()
+{
+  if ( mCompressed )
+    return;
+
+  const size_t stride = group()->isScalar() ? 1 : 2;
+  if ( mSinglePrecision )
+  {
+    mCompressed.reset( new CompressedValues( mFloatValues.data(), mFloatValues.size(), stride ) );
+    SpillVector<float>( arenaAllocator<float>() ).swap( mFloatValues );
+  }
+  else
+  {
+    mCompressed.reset( new CompressedValues( mValues.data(), mValues.size(), stride ) );
+    SpillVector<double>( arenaAllocator<double>() ).swap( mValues );
+  }
+}
+
+void MDAL::MemoryDataset2D::decompress()
+{
+  if ( !mCompressed )
+    return;
+
+  if ( mSinglePrecision )
+  {
+    mFloatValues = SpillVector<float>( mCompressed->count(), 0, arenaAllocator<float>() );
+    mCompressed->read( 0, mFloatValues.size(), mFloatValues.data() );
+  }
+  else
+  {
+    mValues = SpillVector<double>( mCompressed->count(), 0, arenaAllocator<double>() );
+    mCompressed->read( 0, mValues.size(), mValues.data() );
+  }
+  mCompressed.reset();
+}
+
+void MDAL::MemoryDataset2D::setValues( const double *values )
+{
+  decompress();
+  if ( mSinglePrecision )
+    std::copy( values, values + mFloatValues.size(), mFloatValues.begin() );
+  else
+    memcpy( mValues.data(), values, mValues.size() * sizeof( double ) );
+}
+
+template <typename T>
+static void _reorderValues( MDAL::SpillVector<T> &values, const size_t *order, size_t components )
+{
+  if ( values.empty() )
+    return;
+
+  MDAL::SpillVector<T> reordered( values.size(), T(), values.get_allocator() );
+  const size_t count = values.size() / components;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    for ( size_t c = 0; c < components; ++c )
+      reordered[components * i + c] = values[components * order[i] + c];
+  }
+  values.swap( reordered );
+}
+
+void MDAL::MemoryDataset2D::reorder( const size_t *valueOrder, const size_t *faceOrder )
+{
+  decompress();
+  const size_t components = group()->isScalar() ? 1 : 2;
+  _reorderValues( mValues, valueOrder, components );
+  _reorderValues( mFloatValues, valueOrder, components );
+
+  if ( mActive.empty() )
+    return;
+
+  const size_t facesCount = mesh()->facesCount();
+  SpillVector<unsigned char> reordered( mActive.size(), 0, mActive.get_allocator() );
+  for ( size_t i = 0; i < facesCount; ++i )
+  {
+    if ( active( faceOrder[i] ) )
+      reordered[i / 8] |= static_cast<unsigned char>( 1 << ( i % 8 ) );
+  }
+  mActive.swap( reordered );
+}
+
+template <typename T>
+void MDAL::MemoryDataset2D::readValues( size_t index, size_t count, T *buffer ) const
+{
+  if ( mCompressed )
+    mCompressed->read( index, count, buffer );
+  else if ( mSinglePrecision )
+    std::copy( mFloatValues.data() + index, mFloatValues.data() + index + count, buffer );
+  else
+    std::copy( mValues.data() + index, mValues.data() + index + count, buffer );
 }
 
 size_t MDAL::MemoryDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
 {
   assert( group()->isScalar() ); //checked in C API interface
   size_t nValues = valuesCount();
-  assert( mValues.size() == nValues );
+  assert( storedValuesCount() == nValues );
 
   if ( ( count < 1 ) || ( indexStart >= nValues ) )
     return 0;
 
   size_t copyValues = std::min( nValues - indexStart, count );
-  memcpy( buffer, mValues.data() + indexStart, copyValues * sizeof( double ) );
+  readValues( indexStart, copyValues, buffer );
   return copyValues;
 }
 
@@ -103,16 +275,85 @@ size_t MDAL::MemoryDataset2D::vectorData( size_t indexStart, size_t count, doubl
 {
   assert( !group()->isScalar() ); //checked in C API interface
   size_t nValues = valuesCount();
-  assert( mValues.size() == nValues * 2 );
+  assert( storedValuesCount() == nValues * 2 );
 
   if ( ( count < 1 ) || ( indexStart >= nValues ) )
     return 0;
 
   size_t copyValues = std::min( nValues - indexStart, count );
-  memcpy( buffer, mValues.data() + 2 * indexStart, 2 * copyValues * sizeof( double ) );
+  readValues( 2 * indexStart, 2 * copyValues, buffer );
   return copyValues;
 }
 
+size_t MDAL::MemoryDataset2D::scalarDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  readValues( indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+size_t MDAL::MemoryDataset2D::vectorDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  size_t nValues = valuesCount();
+
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  size_t copyValues = std::min( nValues - indexStart, count );
+  readValues( 2 * indexStart, 2 * copyValues, buffer );
+  return copyValues;
+}
+
+template <typename T>
+void MDAL::MemoryDataset2D::gatherValues( const size_t *indices, size_t count, size_t components, T *buffer ) const
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    for ( size_t c = 0; c < components; ++c )
+      buffer[components * i + c] = static_cast<T>( storedValue( components * indices[i] + c ) );
+  }
+}
+
+size_t MDAL::MemoryDataset2D::memoryUsage() const
+{
+  return mCompressed ? mCompressed->compressedSize() : 0;
+}
+
+size_t MDAL::MemoryDataset2D::dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer )
+{
+  switch ( type )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+      gatherValues( indices, count, 1, static_cast<double *>( buffer ) );
+      return count;
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+      gatherValues( indices, count, 2, static_cast<double *>( buffer ) );
+      return count;
+    case MDAL_DataType::SCALAR_FLOAT:
+      gatherValues( indices, count, 1, static_cast<float *>( buffer ) );
+      return count;
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      gatherValues( indices, count, 2, static_cast<float *>( buffer ) );
+      return count;
+    case MDAL_DataType::ACTIVE_INTEGER:
+    {
+      int *active = static_cast<int *>( buffer );
+      for ( size_t i = 0; i < count; ++i )
+        active[i] = this->active( indices[i] );
+      return count;
+    }
+    default:
+      return Dataset2D::dataAtIndices( type, indices, count, buffer );
+  }
+}
+
 MDAL::MemoryMesh::MemoryMesh( const std::string &driverName,
                               size_t verticesCount,
                               size_t facesCount,
@@ -142,6 +383,43 @@ std::unique_ptr<MDAL::MeshFaceIterator> MDAL::MemoryMesh::readFaces()
 
 MDAL::MemoryMesh::~MemoryMesh() = default;
 
+const MDAL::FaceSpatialIndex &MDAL::MemoryMesh::spatialIndex()
+{
+  std::lock_guard<std::mutex> lock( mSpatialIndexMutex );
+  if ( !mSpatialIndex )
+    mSpatialIndex.reset( new FaceSpatialIndex( *this ) );
+  return *mSpatialIndex;
+}
+
+size_t MDAL::MemoryMesh::memoryUsage() const
+{
+  return Mesh::memoryUsage() + vertices.memoryUsage() + faces.memoryUsage() +
+         ( vertexOrder.capacity() + faceOrder.capacity() ) * sizeof( size_t );
+}
+
+size_t MDAL::MemoryMesh::uniformFaceVerticesCount()
+{
+  return faces.uniformVerticesCount();
+}
+
+size_t MDAL::MemoryMesh::vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z )
+{
+  const size_t maxVertices = verticesCount();
+  assert( vertices.size() == maxVertices );
+
+  if ( ( count < 1 ) || ( indexStart >= maxVertices ) )
+    return 0;
+
+  const size_t copyValues = std::min( maxVertices - indexStart, count );
+  if ( x )
+    memcpy( x, vertices.x() + indexStart, copyValues * sizeof( double ) );
+  if ( y )
+    memcpy( y, vertices.y() + indexStart, copyValues * sizeof( double ) );
+  if ( z )
+    memcpy( z, vertices.z() + indexStart, copyValues * sizeof( double ) );
+  return copyValues;
+}
+
 MDAL::MemoryMeshVertexIterator::MemoryMeshVertexIterator( const MDAL::MemoryMesh *mesh )
   : mMemoryMesh( mesh )
 {
@@ -163,26 +441,22 @@ size_t MDAL::MemoryMeshVertexIterator::next( size_t vertexCount, double *coordin
   if ( mLastVertexIndex >= maxVertices )
     return 0;
 
-  size_t i = 0;
+  const VertexArrays &vertices = mMemoryMesh->vertices;
+  assert( vertices.size() == maxVertices );
+  const double *x = vertices.x() + mLastVertexIndex;
+  const double *y = vertices.y() + mLastVertexIndex;
+  const double *z = vertices.z() + mLastVertexIndex;
 
-  while ( true )
+  const size_t count = std::min( vertexCount, maxVertices - mLastVertexIndex );
+  for ( size_t i = 0; i < count; ++i )
   {
-    if ( mLastVertexIndex + i >= maxVertices )
-      break;
-
-    if ( i >= vertexCount )
-      break;
-
-    const Vertex v = mMemoryMesh->vertices[mLastVertexIndex + i];
-    coordinates[3 * i] = v.x;
-    coordinates[3 * i + 1] = v.y;
-    coordinates[3 * i + 2] = v.z;
-
-    ++i;
+    coordinates[3 * i] = x[i];
+    coordinates[3 * i + 1] = y[i];
+    coordinates[3 * i + 2] = z[i];
   }
 
-  mLastVertexIndex += i;
-  return i;
+  mLastVertexIndex += count;
+  return count;
 }
 
 MDAL::MemoryMeshFaceIterator::MemoryMeshFaceIterator( const MDAL::MemoryMesh *mesh )
@@ -192,19 +466,39 @@ MDAL::MemoryMeshFaceIterator::MemoryMeshFaceIterator( const MDAL::MemoryMesh *me
 
 MDAL::MemoryMeshFaceIterator::~MemoryMeshFaceIterator() = default;
 
-size_t MDAL::MemoryMeshFaceIterator::next(
-  size_t faceOffsetsBufferLen, int *faceOffsetsBuffer,
-  size_t vertexIndicesBufferLen, int *vertexIndicesBuffer )
+template <typename T>
+size_t MDAL::MemoryMeshFaceIterator::nextFaces(
+  size_t faceOffsetsBufferLen, T *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, T *vertexIndicesBuffer )
 {
   assert( mMemoryMesh );
   assert( faceOffsetsBuffer );
   assert( vertexIndicesBuffer );
 
+  const CompressedFaces &faces = mMemoryMesh->faces;
   size_t maxFaces = mMemoryMesh->facesCount();
+  assert( faces.size() == maxFaces );
   size_t faceVerticesMaximumCount = mMemoryMesh->faceVerticesMaximumCount();
   size_t vertexIndex = 0;
   size_t faceIndex = 0;
 
+  if ( mLastFaceIndex >= maxFaces )
+    return 0;
+
+  const size_t firstVertexOffset = faces.faceOffset( mLastFaceIndex );
+
+  // faces of the same size have fixed stride, the batch is taken at once
+  const size_t uniformCount = faces.uniformVerticesCount();
+  if ( uniformCount > 0 )
+  {
+    faceIndex = std::min( std::min( faceOffsetsBufferLen, vertexIndicesBufferLen / uniformCount ), maxFaces - mLastFaceIndex );
+    for ( size_t i = 0; i < faceIndex; ++i )
+      faceOffsetsBuffer[i] = static_cast<T>( ( i + 1 ) * uniformCount );
+    faces.copyVertexIndices( firstVertexOffset, faceIndex * uniformCount, vertexIndicesBuffer );
+    mLastFaceIndex += faceIndex;
+    return faceIndex;
+  }
+
   while ( true )
   {
     if ( vertexIndex + faceVerticesMaximumCount > vertexIndicesBufferLen )
@@ -216,19 +510,284 @@ size_t MDAL::MemoryMeshFaceIterator::next(
     if ( mLastFaceIndex + faceIndex >= maxFaces )
       break;
 
-    const Face f = mMemoryMesh->faces[mLastFaceIndex + faceIndex];
-    for ( size_t faceVertexIndex = 0; faceVertexIndex < f.size(); ++faceVertexIndex )
-    {
-      assert( vertexIndex < vertexIndicesBufferLen );
-      vertexIndicesBuffer[vertexIndex] = static_cast<int>( f[faceVertexIndex] );
-      ++vertexIndex;
-    }
+    // offsets are relative to the first face returned in this batch
+    vertexIndex = faces.faceOffset( mLastFaceIndex + faceIndex + 1 ) - firstVertexOffset;
+    assert( vertexIndex <= vertexIndicesBufferLen );
 
     assert( faceIndex < faceOffsetsBufferLen );
-    faceOffsetsBuffer[faceIndex] = static_cast<int>( vertexIndex );
+    faceOffsetsBuffer[faceIndex] = static_cast<T>( vertexIndex );
     ++faceIndex;
   }
 
+  // vertex indices of all returned faces are continuous in the storage
+  faces.copyVertexIndices( firstVertexOffset, vertexIndex, vertexIndicesBuffer );
+
   mLastFaceIndex += faceIndex;
   return faceIndex;
 }
+
+size_t MDAL::MemoryMeshFaceIterator::next(
+  size_t faceOffsetsBufferLen, int *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, int *vertexIndicesBuffer )
+{
+  return nextFaces( faceOffsetsBufferLen, faceOffsetsBuffer, vertexIndicesBufferLen, vertexIndicesBuffer );
+}
+
+size_t MDAL::MemoryMeshFaceIterator::next64(
+  size_t faceOffsetsBufferLen, int64_t *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, int64_t *vertexIndicesBuffer )
+{
+  return nextFaces( faceOffsetsBufferLen, faceOffsetsBuffer, vertexIndicesBufferLen, vertexIndicesBuffer );
+}
+
+MDAL::VertexArrays::VertexArrays() = default;
+
+MDAL::VertexArrays &MDAL::VertexArrays::operator=( const MDAL::Vertices &vertices )
+{
+  assign( vertices );
+  return *this;
+}
+
+void MDAL::VertexArrays::assign( const MDAL::Vertices &vertices )
+{
+  resize( vertices.size() );
+  for ( size_t i = 0; i < vertices.size(); ++i )
+  {
+    const Vertex &v = vertices[i];
+    mX[i] = v.x;
+    mY[i] = v.y;
+    mZ[i] = v.z;
+  }
+}
+
+void MDAL::VertexArrays::resize( size_t count )
+{
+  mX.resize( count );
+  mY.resize( count );
+  mZ.resize( count );
+}
+
+void MDAL::VertexArrays::reserve( size_t count )
+{
+  mX.reserve( count );
+  mY.reserve( count );
+  mZ.reserve( count );
+}
+
+void MDAL::VertexArrays::clear()
+{
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+}
+
+void MDAL::VertexArrays::append( const MDAL::VertexArrays &other )
+{
+  mX.insert( mX.end(), other.mX.begin(), other.mX.end() );
+  mY.insert( mY.end(), other.mY.begin(), other.mY.end() );
+  mZ.insert( mZ.end(), other.mZ.begin(), other.mZ.end() );
+}
+
+size_t MDAL::VertexArrays::memoryUsage() const
+{
+  return ( mX.capacity() + mY.capacity() + mZ.capacity() ) * sizeof( double );
+}
+
+MDAL::CompressedFaces::CompressedFaces()
+  : mOffsets( 1, 0 )
+{
+}
+
+MDAL::CompressedFaces &MDAL::CompressedFaces::operator=( const MDAL::Faces &faces )
+{
+  assign( faces );
+  return *this;
+}
+
+void MDAL::CompressedFaces::assign( const MDAL::Faces &faces )
+{
+  clear();
+
+  size_t indicesCount = 0;
+  for ( const Face &face : faces )
+    indicesCount += face.size();
+
+  reserve( faces.size(), indicesCount );
+  for ( const Face &face : faces )
+    addFace( face );
+}
+
+void MDAL::CompressedFaces::setVertexIndex( size_t faceIndex, size_t i, size_t vertexIndex )
+{
+  assert( i < faceVerticesCount( faceIndex ) );
+  const size_t position = faceOffset( faceIndex ) + i;
+
+  if ( !mIsWide && vertexIndex > std::numeric_limits<uint32_t>::max() )
+    widen();
+
+  if ( mIsWide )
+    mWideIndices[position] = vertexIndex;
+  else
+    mIndices[position] = static_cast<uint32_t>( vertexIndex );
+}
+
+MDAL::Face MDAL::CompressedFaces::face( size_t faceIndex ) const
+{
+  const size_t count = faceVerticesCount( faceIndex );
+  Face ret( count );
+  for ( size_t i = 0; i < count; ++i )
+    ret[i] = vertexIndex( faceIndex, i );
+  return ret;
+}
+
+void MDAL::CompressedFaces::addFace( const size_t *vertexIndices, size_t count )
+{
+  if ( !mIsWide )
+  {
+    for ( size_t i = 0; i < count; ++i )
+    {
+      if ( vertexIndices[i] > std::numeric_limits<uint32_t>::max() )
+      {
+        widen();
+        break;
+      }
+    }
+  }
+
+  if ( mIsWide )
+  {
+    mWideIndices.insert( mWideIndices.end(), vertexIndices, vertexIndices + count );
+  }
+  else
+  {
+    for ( size_t i = 0; i < count; ++i )
+      mIndices.push_back( static_cast<uint32_t>( vertexIndices[i] ) );
+  }
+
+  if ( mIsUniform )
+  {
+    if ( mFacesCount == 0 )
+      mUniformCount = count;
+    else if ( count != mUniformCount )
+      buildOffsets();
+  }
+  if ( !mIsUniform )
+    mOffsets.push_back( mOffsets.back() + count );
+  ++mFacesCount;
+}
+
+void MDAL::CompressedFaces::addFace( const MDAL::Face &face )
+{
+  addFace( face.data(), face.size() );
+}
+
+void MDAL::CompressedFaces::reserve( size_t facesCount, size_t indicesCount )
+{
+  if ( !mIsUniform )
+    mOffsets.reserve( facesCount + 1 );
+  if ( mIsWide )
+    mWideIndices.reserve( indicesCount );
+  else
+    mIndices.reserve( indicesCount );
+}
+
+void MDAL::CompressedFaces::clear()
+{
+  mOffsets.assign( 1, 0 );
+  mIndices.clear();
+  mWideIndices.clear();
+  mIsWide = false;
+  mFacesCount = 0;
+  mIsUniform = true;
+  mUniformCount = 0;
+}
+
+void MDAL::CompressedFaces::append( const MDAL::CompressedFaces &other )
+{
+  if ( other.empty() )
+    return;
+
+  if ( !mIsWide && other.mIsWide )
+    widen();
+
+  if ( mIsUniform && other.mIsUniform && ( empty() || mUniformCount == other.mUniformCount ) )
+  {
+    mUniformCount = other.mUniformCount;
+  }
+  else
+  {
+    if ( mIsUniform )
+      buildOffsets();
+    const size_t indicesOffset = indicesCount();
+    mOffsets.reserve( mOffsets.size() + other.size() );
+    for ( size_t i = 1; i <= other.size(); ++i )
+      mOffsets.push_back( indicesOffset + other.faceOffset( i ) );
+  }
+  mFacesCount += other.mFacesCount;
+
+  if ( !mIsWide )
+    mIndices.insert( mIndices.end(), other.mIndices.begin(), other.mIndices.end() );
+  else if ( other.mIsWide )
+    mWideIndices.insert( mWideIndices.end(), other.mWideIndices.begin(), other.mWideIndices.end() );
+  else
+    mWideIndices.insert( mWideIndices.end(), other.mIndices.begin(), other.mIndices.end() );
+}
+
+void MDAL::CompressedFaces::copyVertexIndices( size_t start, size_t count, int *buffer ) const
+{
+  assert( start + count <= indicesCount() );
+
+  if ( mIsWide )
+  {
+    for ( size_t i = 0; i < count; ++i )
+      buffer[i] = static_cast<int>( mWideIndices[start + i] );
+  }
+  else
+  {
+    // same representation for indices that fit into int
+    static_assert( sizeof( uint32_t ) == sizeof( int ), "unexpected size of int" );
+    if ( count > 0 )
+      memcpy( buffer, mIndices.data() + start, count * sizeof( int ) );
+  }
+}
+
+void MDAL::CompressedFaces::copyVertexIndices( size_t start, size_t count, int64_t *buffer ) const
+{
+  assert( start + count <= indicesCount() );
+
+  if ( mIsWide )
+  {
+    for ( size_t i = 0; i < count; ++i )
+      buffer[i] = static_cast<int64_t>( mWideIndices[start + i] );
+  }
+  else
+  {
+    for ( size_t i = 0; i < count; ++i )
+      buffer[i] = static_cast<int64_t>( mIndices[start + i] );
+  }
+}
+
+size_t MDAL::CompressedFaces::memoryUsage() const
+{
+  return mOffsets.capacity() * sizeof( size_t ) + mIndices.capacity() * sizeof( uint32_t ) +
+         mWideIndices.capacity() * sizeof( size_t );
+}
+
+void MDAL::CompressedFaces::buildOffsets()
+{
+  assert( mIsUniform );
+  mOffsets.resize( mFacesCount + 1 );
+  for ( size_t i = 0; i <= mFacesCount; ++i )
+    mOffsets[i] = i * mUniformCount;
+  mIsUniform = false;
+  mUniformCount = 0;
+}
+
+void MDAL::CompressedFaces::widen()
+{
+  assert( !mIsWide );
+  mWideIndices.reserve( std::max( mIndices.capacity(), mIndices.size() ) );
+  mWideIndices.assign( mIndices.begin(), mIndices.end() );
+  SpillVector<uint32_t>().swap( mIndices );
+  mIsWide = true;
+}
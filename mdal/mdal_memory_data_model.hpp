@@ -7,17 +7,24 @@
 #define MDAL_MEMORY_DATA_MODEL_HPP
 
 #include <stddef.h>
+#include <stdint.h>
 #include <assert.h>
+#include <cmath>
 #include <vector>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <string>
 #include "mdal.h"
 #include "mdal_data_model.hpp"
+#include "mdal_compressed_values.hpp"
+#include "mdal_spill.hpp"
 
 namespace MDAL
 {
   class MemoryMesh;
+  class RegularGridMesh;
+  class FaceSpatialIndex;
 
   typedef struct
   {
@@ -31,6 +38,221 @@ namespace MDAL
   typedef std::vector<Vertex> Vertices;
   typedef std::vector<Face> Faces;
 
+  /**
+   * Structure of arrays storage of the mesh vertices
+   *
+   * X, Y and Z coordinates are stored in separate continuous arrays
+   */
+  class VertexArrays
+  {
+    public:
+      VertexArrays();
+
+      //! Replaces the content with the vertices
+      VertexArrays &operator=( const Vertices &vertices );
+      void assign( const Vertices &vertices );
+
+      size_t size() const { return mX.size(); }
+      bool empty() const { return mX.empty(); }
+
+      //! Read-only pointers to the coordinates arrays
+      const double *x() const { return mX.data(); }
+      const double *y() const { return mY.data(); }
+      const double *z() const { return mZ.data(); }
+
+      //! Returns copy of the vertex
+      Vertex operator[]( size_t index ) const
+      {
+        assert( index < size() );
+        Vertex v;
+        v.x = mX[index];
+        v.y = mY[index];
+        v.z = mZ[index];
+        return v;
+      }
+
+      void setVertex( size_t index, const Vertex &vertex )
+      {
+        assert( index < size() );
+        mX[index] = vertex.x;
+        mY[index] = vertex.y;
+        mZ[index] = vertex.z;
+      }
+
+      void push_back( const Vertex &vertex )
+      {
+        mX.push_back( vertex.x );
+        mY.push_back( vertex.y );
+        mZ.push_back( vertex.z );
+      }
+
+      void resize( size_t count );
+      void reserve( size_t count );
+      void clear();
+
+      //! Appends all vertices of other
+      void append( const VertexArrays &other );
+
+      //! Bytes allocated for the coordinates
+      size_t memoryUsage() const;
+
+    private:
+      SpillVector<double> mX;
+      SpillVector<double> mY;
+      SpillVector<double> mZ;
+  };
+
+  /**
+   * Compressed row storage of the mesh faces
+   *
+   * Vertex indices of all faces are stored in a single continuous array
+   * and face i consists of the indices at positions faceOffset( i ) ... faceOffset( i + 1 ) - 1
+   *
+   * Indices are stored as 32-bit integers, storage is switched to 64-bit
+   * integers only when some index does not fit
+   *
+   * While all faces have the same number of vertices (triangle or quad meshes), the array
+   * has fixed stride and no offsets are stored, the offsets are built when a face of other size is added
+   */
+  class CompressedFaces
+  {
+    public:
+      CompressedFaces();
+
+      //! Replaces the content with the faces
+      CompressedFaces &operator=( const Faces &faces );
+      void assign( const Faces &faces );
+
+      //! Number of faces
+      size_t size() const { return mFacesCount; }
+      bool empty() const { return size() == 0; }
+
+      //! Total number of vertex indices of all faces
+      size_t indicesCount() const { return mIsUniform ? mFacesCount * mUniformCount : mOffsets.back(); }
+
+      //! Number of vertices of every face when all faces have the same number of vertices, 0 otherwise
+      size_t uniformVerticesCount() const { return mIsUniform ? mUniformCount : 0; }
+
+      //! Position of the first vertex index of the face, faceOffset( size() ) == indicesCount()
+      size_t faceOffset( size_t faceIndex ) const
+      {
+        assert( faceIndex <= mFacesCount );
+        return mIsUniform ? faceIndex * mUniformCount : mOffsets[faceIndex];
+      }
+
+      size_t faceVerticesCount( size_t faceIndex ) const
+      {
+        assert( faceIndex < mFacesCount );
+        return mIsUniform ? mUniformCount : mOffsets[faceIndex + 1] - mOffsets[faceIndex];
+      }
+
+      /**
+       * Position of the first vertex index of the face and the number of its vertices
+       *
+       * Kernels specialized by dispatchFaceArity() for faces of N vertices get constant
+       * stride and count, N = 0 is the general case
+       */
+      template<size_t N>
+      size_t faceRange( size_t faceIndex, size_t &count ) const
+      {
+        if ( N > 0 )
+        {
+          assert( mIsUniform && mUniformCount == N );
+          count = N;
+          return faceIndex * N;
+        }
+        count = faceVerticesCount( faceIndex );
+        return faceOffset( faceIndex );
+      }
+
+      //! Vertex index stored on position in the continuous array of indices
+      size_t vertexIndexAt( size_t position ) const
+      {
+        assert( position < indicesCount() );
+        return mIsWide ? mWideIndices[position] : mIndices[position];
+      }
+
+      //! Index of the i-th vertex of the face
+      size_t vertexIndex( size_t faceIndex, size_t i ) const
+      {
+        assert( i < faceVerticesCount( faceIndex ) );
+        return vertexIndexAt( faceOffset( faceIndex ) + i );
+      }
+
+      void setVertexIndex( size_t faceIndex, size_t i, size_t vertexIndex );
+
+      //! Returns copy of the face
+      Face face( size_t faceIndex ) const;
+
+      void addFace( const size_t *vertexIndices, size_t count );
+      void addFace( const Face &face );
+
+      void reserve( size_t facesCount, size_t indicesCount );
+      void clear();
+
+      //! Appends all faces of other, vertex indices are copied as they are
+      void append( const CompressedFaces &other );
+
+      //! Whether the indices are stored as 64-bit integers
+      bool hasWideIndices() const { return mIsWide; }
+
+      //! Bytes allocated for the indices and the offsets
+      size_t memoryUsage() const;
+
+      /**
+       * Copies indices on positions [start, start + count) to the buffer
+       * Indices must fit into int
+       */
+      void copyVertexIndices( size_t start, size_t count, int *buffer ) const;
+      void copyVertexIndices( size_t start, size_t count, int64_t *buffer ) const;
+
+    private:
+      void widen();
+
+      //! Builds the offsets of the faces, so faces of any size can be added
+      void buildOffsets();
+
+      size_t mFacesCount = 0;
+      //! Offsets of the faces, only the first 0 while the faces are uniform
+      SpillVector<size_t> mOffsets;
+      SpillVector<uint32_t> mIndices;
+      SpillVector<size_t> mWideIndices;
+      bool mIsWide = false;
+      bool mIsUniform = true;
+      //! Number of vertices of the faces while uniform, set by the first face
+      size_t mUniformCount = 0;
+  };
+
+  //! Number of vertices of the faces handled by kernel specialized by dispatchFaceArity()
+  template<size_t N>
+  struct FaceArity
+  {
+    static const size_t count = N;
+  };
+
+  /**
+   * Calls kernel( FaceArity<3>() ) for triangle meshes, kernel( FaceArity<4>() ) for quad meshes
+   * and kernel( FaceArity<0>() ) otherwise, so the loops over the face vertices in the kernel
+   * have constant count and stride (see CompressedFaces::faceRange())
+   * \param uniformVerticesCount number of vertices of all faces, 0 for faces of different size
+   */
+  template<typename Kernel>
+  void dispatchFaceArity( size_t uniformVerticesCount, Kernel &kernel )
+  {
+    switch ( uniformVerticesCount )
+    {
+      case 3:
+        kernel( FaceArity<3>() );
+        break;
+      case 4:
+        kernel( FaceArity<4>() );
+        break;
+      default:
+        kernel( FaceArity<0>() );
+        break;
+    }
+  }
+
   /**
    * The MemoryDataset stores all the data in the memory
    */
@@ -45,12 +267,19 @@ namespace MDAL
 
       //! Returns 0 for datasets that does not support active flags
       size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+      //! Copies the stored bits without expansion to integers
+      size_t activeDataBits( size_t indexStart, size_t count, unsigned char *buffer ) override;
+
+      //! Data are only copied from the memory
+      bool supportsConcurrentReads() const override;
 
       /**
-       * Loop through all faces and activate those which has all 4 values on vertices valid
+       * Loop through all faces and deactivate those which has any value on vertices invalid
+       * Blocks of faces of large meshes are processed in parallel
        * Dataset must support active flags and be defined on vertices
        */
       void activateFaces( MDAL::MemoryMesh *mesh );
+      void activateFaces( const MDAL::RegularGridMesh *mesh );
 
       /**
        * Sets active flag for index
@@ -63,8 +292,12 @@ namespace MDAL
       void setActive( size_t index, int stat )
       {
         assert( supportsActiveFlag() );
-        assert( mActive.size() > index );
-        mActive[index] = stat;
+        assert( mActive.size() > index / 8 );
+        const unsigned char bit = static_cast<unsigned char>( 1 << ( index % 8 ) );
+        if ( stat )
+          mActive[index / 8] |= bit;
+        else
+          mActive[index / 8] &= static_cast<unsigned char>( ~bit );
       }
 
       void setActive( const int *activeBuffer );
@@ -72,70 +305,163 @@ namespace MDAL
       int active( size_t index ) const
       {
         assert( supportsActiveFlag() );
-        assert( mActive.size() > index );
-        return mActive[index];
+        assert( mActive.size() > index / 8 );
+        return ( mActive[index / 8] >> ( index % 8 ) ) & 1;
       }
 
       void setScalarValue( size_t index, double value )
       {
-        assert( mValues.size() > index );
+        assert( storedValuesCount() > index );
         assert( group()->isScalar() );
-        mValues[index] = value;
+        setStoredValue( index, value );
       }
 
       void setVectorValue( size_t index, double x, double y )
       {
-        assert( mValues.size() > 2 * index + 1 );
+        assert( storedValuesCount() > 2 * index + 1 );
         assert( !group()->isScalar() );
-        mValues[2 * index] = x;
-        mValues[2 * index + 1] = y;
+        setStoredValue( 2 * index, x );
+        setStoredValue( 2 * index + 1, y );
       }
 
       void setValueX( size_t index, double x )
       {
-        assert( mValues.size() > 2 * index );
+        assert( storedValuesCount() > 2 * index );
         assert( !group()->isScalar() );
 
-        mValues[2 * index] = x;
+        setStoredValue( 2 * index, x );
       }
 
       void setValueY( size_t index, double x )
       {
-        assert( mValues.size() > 2 * index + 1 );
+        assert( storedValuesCount() > 2 * index + 1 );
         assert( !group()->isScalar() );
-        mValues[2 * index + 1] = x;
+        setStoredValue( 2 * index + 1, x );
       }
 
       double valueX( size_t index ) const
       {
-        assert( mValues.size() > 2 * index + 1 );
+        assert( storedValuesCount() > 2 * index + 1 );
         assert( !group()->isScalar() );
-        return mValues[2 * index];
+        return storedValue( 2 * index );
       }
 
       double valueY( size_t index ) const
       {
-        assert( mValues.size() > 2 * index + 1 );
+        assert( storedValuesCount() > 2 * index + 1 );
         assert( !group()->isScalar() );
-        return mValues[2 * index + 1];
+        return storedValue( 2 * index + 1 );
       }
 
       double scalarValue( size_t index ) const
       {
-        assert( mValues.size() > index );
+        assert( storedValuesCount() > index );
         assert( group()->isScalar() );
-        return mValues[index];
+        return storedValue( index );
       }
 
-      //! Returns pointer to internal buffer with values
-      //! Never null, already allocated
+      /**
+       * Copies all values of the dataset from the buffer
+       * for vector datasets in form x1, y1, ..., xN, yN
+       */
+      void setValues( const double *values );
+
+      /**
+       * Reorders values and active flags after the elements of the mesh were reordered
+       * Value i is taken from index valueOrder[i] and active flag i from index faceOrder[i]
+       */
+      void reorder( const size_t *valueOrder, const size_t *faceOrder );
+
+      //! Whether the values are stored as floats, see SINGLE_PRECISION open option
+      bool isSinglePrecision() const { return mSinglePrecision; }
+
+      /**
+       * Compresses the values to blocks decompressed on read, see COMPRESS_DATASETS open option
+       * The values must not be set afterwards, setValues() and reorder() decompress them back
+       */
+      void compress();
+
+      //! Whether the values are compressed
+      bool isCompressed() const { return static_cast<bool>( mCompressed ); }
+
+      //! Returns pointer to internal buffer with values, null for single precision or compressed datasets
       //! for vector datasets in form x1, y1, ..., xN, yN
-      double *values()
+      const double *values() const
       {
-        return mValues.data();
+        return mSinglePrecision || mCompressed ? nullptr : mValues.data();
       }
 
+      //! Returns pointer to internal buffer with values of single precision datasets, null otherwise or for compressed datasets
+      const float *floatValues() const
+      {
+        return !mSinglePrecision || mCompressed ? nullptr : mFloatValues.data();
+      }
+
+      size_t scalarDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+      size_t vectorDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+
+      //! Values are gathered directly from the memory
+      size_t dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer ) override;
+
+      //! Compressed values, the other arrays are in the memory arena of the mesh
+      size_t memoryUsage() const override;
+
     private:
+      template <typename T>
+      void gatherValues( const size_t *indices, size_t count, size_t components, T *buffer ) const;
+
+      //! Allocator of the arrays in the memory arena of the mesh
+      template <typename T>
+      SpillAllocator<T> arenaAllocator() const { return SpillAllocator<T>( mArena.get() ); }
+
+      size_t storedValuesCount() const
+      {
+        if ( mCompressed )
+          return mCompressed->count();
+        return mSinglePrecision ? mFloatValues.size() : mValues.size();
+      }
+
+      double storedValue( size_t index ) const
+      {
+        if ( mCompressed )
+          return mCompressed->value( index );
+        return mSinglePrecision ? static_cast<double>( mFloatValues[index] ) : mValues[index];
+      }
+
+      //! Whether the value on the vertex is valid, both components for vectors
+      bool hasValue( size_t vertexIndex, bool isScalar ) const
+      {
+        if ( isScalar )
+          return !std::isnan( storedValue( vertexIndex ) );
+        return !std::isnan( storedValue( 2 * vertexIndex ) ) && !std::isnan( storedValue( 2 * vertexIndex + 1 ) );
+      }
+
+      void setStoredValue( size_t index, double value )
+      {
+        assert( !mCompressed );
+        if ( mSinglePrecision )
+          mFloatValues[index] = static_cast<float>( value );
+        else
+          mValues[index] = value;
+      }
+
+      //! Copies values from index to the buffer widened to T or rounded to T
+      template <typename T>
+      void readValues( size_t index, size_t count, T *buffer ) const;
+
+      /**
+       * Clears active flags of the faces for which hasAllValues( faceIndex ) is false
+       * Blocks of whole bytes of flags are processed in parallel
+       */
+      template <typename HasAllValues>
+      void deactivateFaces( size_t facesCount, HasAllValues hasAllValues );
+
+      //! Deactivates faces with vertices without value, specialized for faces of N vertices by dispatchFaceArity()
+      struct ActivateFacesKernel;
+
+      //! Holds the arena until the arrays are freed, declared before them
+      std::shared_ptr<MemoryArena> mArena;
+
       /**
        * Stores vector2d/scalar data for dataset in form
        * scalars: x1, x2, x3, ..., xN
@@ -148,17 +474,28 @@ namespace MDAL
        *   - vertex count if isOnVertices & isScalar
        *   - face count * 2 if isOnFaces & isVector
        *   - vertex count * 2 if isOnVertices & isVector
+       *
+       * empty for single precision datasets, mFloatValues are used instead
        */
-      std::vector<double> mValues;
+      SpillVector<double> mValues;
+      //! Values of single precision datasets, same layout as mValues
+      SpillVector<float> mFloatValues;
+      bool mSinglePrecision = false;
+      //! Compressed values, mValues and mFloatValues are empty then
+      std::unique_ptr<CompressedValues> mCompressed;
+
+      //! Restores the values from the compressed ones
+      void decompress();
 
       /**
-       * Active flag, whether the face is active or not (disabled)
+       * Active flags packed to bits, whether the face is active or not (disabled),
+       * bit i % 8 of byte i / 8 is the flag of face i
        * Only make sense for dataset defined on vertices
        * For dataset defined on faces, this is empty vector
        *
        * Values are initialized by default to 1 (active)
        */
-      std::vector<int> mActive;
+      SpillVector<unsigned char> mActive;
   };
 
   class MemoryMesh: public Mesh
@@ -175,8 +512,31 @@ namespace MDAL
       std::unique_ptr<MDAL::MeshVertexIterator> readVertices() override;
       std::unique_ptr<MDAL::MeshFaceIterator> readFaces() override;
 
-      Vertices vertices;
-      Faces faces;
+      size_t vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z ) override;
+
+      size_t uniformFaceVerticesCount() override;
+
+      //! Vertices, faces and the original orders of the elements with the datasets
+      size_t memoryUsage() const override;
+
+      //! Spatial index of the faces, built on first request, vertices and faces must not change afterwards
+      const FaceSpatialIndex &spatialIndex();
+
+      VertexArrays vertices;
+      CompressedFaces faces;
+
+      /**
+       * Indices of the vertices and faces in the source file, empty when the elements
+       * were not reordered on load (see REORDER_ELEMENTS open option)
+       */
+      SpillVector<size_t> vertexOrder;
+      SpillVector<size_t> faceOrder;
+
+      bool isReordered() const { return !vertexOrder.empty() || !faceOrder.empty(); }
+
+    private:
+      std::unique_ptr<FaceSpatialIndex> mSpatialIndex;
+      std::mutex mSpatialIndexMutex;
   };
 
   class MemoryMeshVertexIterator: public MeshVertexIterator
@@ -203,9 +563,19 @@ namespace MDAL
                    size_t vertexIndicesBufferLen,
                    int *vertexIndicesBuffer ) override;
 
+      size_t next64( size_t faceOffsetsBufferLen,
+                     int64_t *faceOffsetsBuffer,
+                     size_t vertexIndicesBufferLen,
+                     int64_t *vertexIndicesBuffer ) override;
+
       const MemoryMesh *mMemoryMesh;
       size_t mLastFaceIndex = 0;
 
+    private:
+      template <typename T>
+      size_t nextFaces( size_t faceOffsetsBufferLen, T *faceOffsetsBuffer,
+                        size_t vertexIndicesBufferLen, T *vertexIndicesBuffer );
+
   };
 } // namespace MDAL
 #endif //MDAL_MEMORY_DATA_MODEL_HPP
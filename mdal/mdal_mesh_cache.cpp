@@ -0,0 +1,102 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_mesh_cache.hpp"
+
+#include <stdint.h>
+
+#include "mdal_options.hpp"
+#include "mdal_utils.hpp"
+
+MDAL::MeshCache &MDAL::MeshCache::instance()
+{
+  static MeshCache sCache;
+  return sCache;
+}
+
+void MDAL::MeshCache::setEnabled( bool enabled )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  mEnabled = enabled;
+}
+
+bool MDAL::MeshCache::isEnabled() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mEnabled;
+}
+
+std::string MDAL::MeshCache::key( const std::string &meshFile ) const
+{
+  if ( !isEnabled() )
+    return std::string();
+
+  int64_t size, modificationTime;
+  if ( !fileSizeAndModificationTime( meshFile, size, modificationTime ) )
+    return std::string();
+
+  // the options change the loaded mesh, e.g. reordered elements or single precision values
+  return meshFile + "\n" + std::to_string( size ) + "\n" + std::to_string( modificationTime ) + "\n" + openOptionsString();
+}
+
+MDAL::Mesh *MDAL::MeshCache::acquire( const std::string &key )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  auto it = mMeshes.find( key );
+  if ( it == mMeshes.end() )
+    return nullptr;
+
+  ++mEntries[it->second].handles;
+  return it->second;
+}
+
+void MDAL::MeshCache::insert( const std::string &key, Mesh *mesh )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( mMeshes.count( key ) )
+    return;
+
+  mMeshes[key] = mesh;
+  Entry &entry = mEntries[mesh];
+  entry.key = key;
+  entry.handles = 1;
+}
+
+bool MDAL::MeshCache::release( Mesh *mesh )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  auto it = mEntries.find( mesh );
+  if ( it == mEntries.end() )
+    return true;
+
+  if ( --it->second.handles > 0 )
+    return false;
+
+  mMeshes.erase( it->second.key );
+  mEntries.erase( it );
+  return true;
+}
+
+bool MDAL::MeshCache::detach( Mesh *mesh )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  auto it = mEntries.find( mesh );
+  if ( it == mEntries.end() )
+    return true;
+
+  if ( it->second.handles > 1 )
+    return false;
+
+  mMeshes.erase( it->second.key );
+  mEntries.erase( it );
+  return true;
+}
+
+size_t MDAL::MeshCache::handleCount( const Mesh *mesh ) const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  auto it = mEntries.find( mesh );
+  return it == mEntries.end() ? 1 : it->second.handles;
+}
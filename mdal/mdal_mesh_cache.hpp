@@ -0,0 +1,73 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_MESH_CACHE_HPP
+#define MDAL_MESH_CACHE_HPP
+
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace MDAL
+{
+  class Mesh;
+
+  /**
+   * Meshes shared by the loads of the same file, see MDAL_SetMeshSharing()
+   *
+   * While any handle of the mesh is open, loads of the unchanged file (same path, size
+   * and modification time) with the same open options return the loaded mesh and count
+   * another handle of it. The mesh is deleted with its last handle.
+   *
+   * Shared meshes are immutable: an edit is refused while the mesh has other handles,
+   * the only handle is detached from the cache first, so the following loads read the file
+   * again and do not see the edit.
+   */
+  class MeshCache
+  {
+    public:
+      static MeshCache &instance();
+
+      void setEnabled( bool enabled );
+      bool isEnabled() const;
+
+      //! Returns the key of the file loaded with the current open options, empty when the cache is disabled or the file does not exist
+      std::string key( const std::string &meshFile ) const;
+
+      //! Returns the mesh cached with the key and counts another handle of it, null when there is none
+      Mesh *acquire( const std::string &key );
+
+      //! Caches the loaded mesh with the key, with a single handle
+      void insert( const std::string &key, Mesh *mesh );
+
+      //! Removes a handle of the mesh, returns true when the caller deletes it (last handle or the mesh is not cached)
+      bool release( Mesh *mesh );
+
+      /**
+       * Detaches the mesh to be edited from the cache
+       * \returns false when the mesh has other handles and must not be edited
+       */
+      bool detach( Mesh *mesh );
+
+      //! Number of open handles of the mesh, 1 for the meshes not in the cache
+      size_t handleCount( const Mesh *mesh ) const;
+
+    private:
+      MeshCache() = default;
+
+      struct Entry
+      {
+        std::string key;
+        size_t handles = 0;
+      };
+
+      mutable std::mutex mMutex;
+      bool mEnabled = false;
+      std::map<std::string, Mesh *> mMeshes;
+      std::map<const Mesh *, Entry> mEntries;
+  };
+} // namespace MDAL
+#endif //MDAL_MESH_CACHE_HPP
@@ -0,0 +1,102 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_options.hpp"
+
+#include <map>
+#include <mutex>
+
+#include "mdal_utils.hpp"
+
+static std::mutex &_optionsMutex()
+{
+  static std::mutex sMutex;
+  return sMutex;
+}
+
+static std::map<std::string, std::string> &_options()
+{
+  static std::map<std::string, std::string> sOptions;
+  return sOptions;
+}
+
+//! Options overridden by ScopedOpenOption, no locking needed
+static std::map<std::string, std::string> &_threadOptions()
+{
+  static thread_local std::map<std::string, std::string> sThreadOptions;
+  return sThreadOptions;
+}
+
+void MDAL::setOpenOption( const std::string &name, const std::string &value )
+{
+  std::lock_guard<std::mutex> lock( _optionsMutex() );
+  if ( value.empty() )
+    _options().erase( name );
+  else
+    _options()[name] = value;
+}
+
+std::string MDAL::openOption( const std::string &name )
+{
+  auto threadIt = _threadOptions().find( name );
+  if ( threadIt != _threadOptions().end() )
+    return threadIt->second;
+
+  std::lock_guard<std::mutex> lock( _optionsMutex() );
+  auto it = _options().find( name );
+  if ( it == _options().end() )
+    return std::string();
+  return it->second;
+}
+
+bool MDAL::openOptionAsBool( const std::string &name, bool defaultValue )
+{
+  const std::string value = MDAL::toLower( MDAL::trim( openOption( name ) ) );
+  if ( value.empty() )
+    return defaultValue;
+
+  return value == "yes" || value == "true" || value == "on" || value == "1";
+}
+
+std::string MDAL::openOptionsString()
+{
+  std::map<std::string, std::string> options;
+  {
+    std::lock_guard<std::mutex> lock( _optionsMutex() );
+    options = _options();
+  }
+  for ( const auto &option : _threadOptions() )
+  {
+    if ( option.second.empty() )
+      options.erase( option.first );
+    else
+      options[option.first] = option.second;
+  }
+
+  std::string result;
+  for ( const auto &option : options )
+    result += option.first + "=" + option.second + "\n";
+  return result;
+}
+
+MDAL::ScopedOpenOption::ScopedOpenOption( const std::string &name, const std::string &value )
+  : mName( name )
+{
+  auto it = _threadOptions().find( name );
+  if ( it != _threadOptions().end() )
+  {
+    mHadOverride = true;
+    mPreviousValue = it->second;
+  }
+  _threadOptions()[name] = value;
+}
+
+MDAL::ScopedOpenOption::~ScopedOpenOption()
+{
+  if ( mHadOverride )
+    _threadOptions()[mName] = mPreviousValue;
+  else
+    _threadOptions().erase( mName );
+}
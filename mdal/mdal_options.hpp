@@ -0,0 +1,79 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_OPTIONS_HPP
+#define MDAL_OPTIONS_HPP
+
+#include <string>
+
+namespace MDAL
+{
+  //! Calculate statistics on first request instead of during the load (YES/NO)
+  const char *const OPTION_LAZY_STATISTICS = "LAZY_STATISTICS";
+  //! Build quantile sketches of the values together with the minimum and maximum (YES/NO)
+  const char *const OPTION_QUANTILE_SKETCH = "QUANTILE_SKETCH";
+  //! Directory where the calculated statistics are cached between the loads
+  const char *const OPTION_STATISTICS_CACHE_DIR = "STATISTICS_CACHE_DIR";
+  //! Maximum size of HDF5 chunk cache of one dataset in bytes
+  const char *const OPTION_HDF5_CHUNK_CACHE_SIZE = "HDF5_CHUNK_CACHE_SIZE";
+  //! Bytes of large mesh and dataset arrays kept on the heap, the following ones are mapped from temporary files
+  const char *const OPTION_MEMORY_BUDGET = "MEMORY_BUDGET";
+  //! Directory of the temporary files used over MEMORY_BUDGET, system temporary directory by default
+  const char *const OPTION_SPILL_DIR = "SPILL_DIR";
+  //! Store values of the memory datasets as floats (YES/NO)
+  const char *const OPTION_SINGLE_PRECISION = "SINGLE_PRECISION";
+  //! Compress values of the memory datasets once they are loaded or created (YES/NO)
+  const char *const OPTION_COMPRESS_DATASETS = "COMPRESS_DATASETS";
+  //! Maximum fraction of valid values of the memory datasets stored sparse (0-1), not set by default
+  const char *const OPTION_SPARSE_DATASETS = "SPARSE_DATASETS";
+  //! Deflate level of the time step values written to HDF5 files (1-9)
+  const char *const OPTION_HDF5_DEFLATE_LEVEL = "HDF5_DEFLATE_LEVEL";
+  //! Sort vertices and faces of meshes held in memory along the Hilbert curve on load (YES/NO)
+  const char *const OPTION_REORDER_ELEMENTS = "REORDER_ELEMENTS";
+  //! Return loaded meshes once their groups are discovered, statistics are calculated in the background (YES/NO)
+  const char *const OPTION_PROGRESSIVE_LOAD = "PROGRESSIVE_LOAD";
+  //! Size in bytes of the blocks fetched from the remote files
+  const char *const OPTION_REMOTE_BLOCK_SIZE = "REMOTE_BLOCK_SIZE";
+  //! Maximum size in bytes of the blocks cached for one remote file, 0 disables the cache
+  const char *const OPTION_REMOTE_CACHE_SIZE = "REMOTE_CACHE_SIZE";
+  //! Number of blocks fetched ahead of the sequential reads of the remote files
+  const char *const OPTION_REMOTE_READAHEAD = "REMOTE_READAHEAD";
+  //! Endpoint of the s3:// uris, e.g. for S3 compatible storage, path-style urls are used when set
+  const char *const OPTION_S3_ENDPOINT = "S3_ENDPOINT";
+
+  //! Sets library-wide option used by drivers when loading meshes and datasets
+  //! Empty value removes the option
+  void setOpenOption( const std::string &name, const std::string &value );
+
+  //! Returns value of the option or empty string if not set
+  std::string openOption( const std::string &name );
+
+  //! Returns option value interpreted as boolean (YES/TRUE/ON/1), defaultValue if not set
+  bool openOptionAsBool( const std::string &name, bool defaultValue = false );
+
+  //! Returns all options seen by the current thread as name=value lines, sorted by name
+  std::string openOptionsString();
+
+  /**
+   * Overrides the option for the current thread for the lifetime of the object
+   * Other threads still see the value set by setOpenOption()
+   */
+  class ScopedOpenOption
+  {
+    public:
+      ScopedOpenOption( const std::string &name, const std::string &value );
+      ~ScopedOpenOption();
+
+      ScopedOpenOption( const ScopedOpenOption & ) = delete;
+      ScopedOpenOption &operator=( const ScopedOpenOption & ) = delete;
+
+    private:
+      std::string mName;
+      std::string mPreviousValue;
+      bool mHadOverride = false;
+  };
+
+} // namespace MDAL
+#endif //MDAL_OPTIONS_HPP
@@ -0,0 +1,105 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_output_buffer.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+//! Capacity of the first allocation, doubled as the buffer grows
+static const size_t INITIAL_CAPACITY = 64 * 1024;
+
+MDAL::OutputBuffer::OutputBuffer() = default;
+
+MDAL::OutputBuffer::~OutputBuffer()
+{
+  free( mData );
+}
+
+size_t MDAL::OutputBuffer::size() const
+{
+  return mSize;
+}
+
+char *MDAL::OutputBuffer::release()
+{
+  char *data = mFailed ? nullptr : mData;
+  if ( mFailed )
+    free( mData );
+  mData = nullptr;
+  mCapacity = 0;
+  mSize = 0;
+  mPosition = 0;
+  mFailed = false;
+  return data;
+}
+
+bool MDAL::OutputBuffer::reserve( size_t count )
+{
+  if ( mFailed )
+    return false;
+
+  const size_t required = mPosition + count;
+  if ( required <= mCapacity )
+    return true;
+
+  const size_t capacity = std::max( required, std::max( 2 * mCapacity, INITIAL_CAPACITY ) );
+  char *data = static_cast<char *>( realloc( mData, capacity ) );
+  if ( !data )
+  {
+    mFailed = true;
+    return false;
+  }
+  mData = data;
+  mCapacity = capacity;
+  return true;
+}
+
+MDAL::OutputBuffer::int_type MDAL::OutputBuffer::overflow( int_type c )
+{
+  if ( traits_type::eq_int_type( c, traits_type::eof() ) )
+    return traits_type::not_eof( c );
+
+  const char ch = traits_type::to_char_type( c );
+  return xsputn( &ch, 1 ) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize MDAL::OutputBuffer::xsputn( const char *data, std::streamsize count )
+{
+  if ( count <= 0 )
+    return 0;
+
+  const size_t bytes = static_cast<size_t>( count );
+  if ( !reserve( bytes ) )
+    return 0;
+
+  // seeking beyond the end leaves zeros in between
+  if ( mPosition > mSize )
+    memset( mData + mSize, 0, mPosition - mSize );
+  memcpy( mData + mPosition, data, bytes );
+  mPosition += bytes;
+  mSize = std::max( mSize, mPosition );
+  return count;
+}
+
+MDAL::OutputBuffer::pos_type MDAL::OutputBuffer::seekoff( off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode )
+{
+  off_type base = 0;
+  if ( direction == std::ios_base::cur )
+    base = static_cast<off_type>( mPosition );
+  else if ( direction == std::ios_base::end )
+    base = static_cast<off_type>( mSize );
+  return seekpos( pos_type( base + offset ), mode );
+}
+
+MDAL::OutputBuffer::pos_type MDAL::OutputBuffer::seekpos( pos_type position, std::ios_base::openmode mode )
+{
+  if ( !( mode & std::ios_base::out ) || off_type( position ) < 0 )
+    return pos_type( off_type( -1 ) );
+
+  mPosition = static_cast<size_t>( off_type( position ) );
+  return position;
+}
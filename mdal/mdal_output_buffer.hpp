@@ -0,0 +1,52 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_OUTPUT_BUFFER_HPP
+#define MDAL_OUTPUT_BUFFER_HPP
+
+#include <stddef.h>
+#include <streambuf>
+
+namespace MDAL
+{
+  /**
+   * Growable memory buffer of an output stream, so the writers save to the memory instead of a file
+   *
+   * The writers may seek back, e.g. to write a header at the end, the size is the end of the furthest write.
+   * The memory is allocated by malloc, so release() passes it to the caller to be freed by free().
+   */
+  class OutputBuffer: public std::streambuf
+  {
+    public:
+      OutputBuffer();
+      ~OutputBuffer() override;
+
+      OutputBuffer( const OutputBuffer & ) = delete;
+      OutputBuffer &operator=( const OutputBuffer & ) = delete;
+
+      //! Number of bytes written
+      size_t size() const;
+
+      //! Returns the written data and leaves the buffer empty, null when nothing was written or the allocation failed
+      char *release();
+
+    protected:
+      int_type overflow( int_type c ) override;
+      std::streamsize xsputn( const char *data, std::streamsize count ) override;
+      pos_type seekoff( off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode mode ) override;
+      pos_type seekpos( pos_type position, std::ios_base::openmode mode ) override;
+
+    private:
+      //! Makes room for count bytes at the position, returns false when the allocation fails
+      bool reserve( size_t count );
+
+      char *mData = nullptr;
+      size_t mCapacity = 0;
+      size_t mSize = 0;
+      size_t mPosition = 0;
+      bool mFailed = false;
+  };
+} // namespace MDAL
+#endif //MDAL_OUTPUT_BUFFER_HPP
@@ -0,0 +1,130 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdlib.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+
+static std::atomic<size_t> sThreadCount( 0 );
+
+static size_t _defaultThreadCount()
+{
+  const char *env = getenv( "MDAL_NUM_THREADS" );
+  if ( env && *env )
+  {
+    const int count = atoi( env );
+    if ( count > 0 )
+      return static_cast<size_t>( count );
+  }
+  return std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+size_t MDAL::threadCount()
+{
+  const size_t count = sThreadCount;
+  if ( count > 0 )
+    return count;
+
+  static const size_t sDefaultThreadCount = _defaultThreadCount();
+  return sDefaultThreadCount;
+}
+
+void MDAL::setThreadCount( size_t count )
+{
+  sThreadCount = count;
+}
+
+void MDAL::parallelFor( size_t count, const std::function<void( size_t )> &task )
+{
+  const size_t threads = std::min( count, threadCount() );
+  if ( threads <= 1 )
+  {
+    for ( size_t i = 0; i < count; ++i )
+      task( i );
+    return;
+  }
+
+  std::atomic<size_t> next( 0 );
+  std::atomic<bool> failed( false );
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  auto worker = [&]()
+  {
+    while ( !failed )
+    {
+      const size_t i = next++;
+      if ( i >= count )
+        return;
+
+      try
+      {
+        task( i );
+      }
+      catch ( ... )
+      {
+        std::lock_guard<std::mutex> lock( errorMutex );
+        if ( !error )
+          error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve( threads - 1 );
+  try
+  {
+    for ( size_t t = 1; t < threads; ++t )
+      workers.emplace_back( worker );
+  }
+  catch ( std::system_error & )
+  {
+    // not able to start more threads, continue with the ones we have
+  }
+  worker();
+  for ( std::thread &t : workers )
+    t.join();
+
+  if ( error )
+    std::rethrow_exception( error );
+}
+
+std::recursive_mutex &MDAL::libraryMutex()
+{
+  // never destroyed, the worker of the Prefetcher may still hold it during the exit
+  static std::recursive_mutex *sMutex = new std::recursive_mutex();
+  return *sMutex;
+}
+
+//! Whether the thread is in LoadWorkerScope
+static thread_local bool tIsLoadWorker = false;
+
+MDAL::DatasetReadLock::DatasetReadLock( Dataset *dataset )
+  : mLock( libraryMutex(), std::defer_lock )
+{
+  if ( !tIsLoadWorker && ( !dataset || !dataset->supportsConcurrentReads() ) )
+    mLock.lock();
+}
+
+MDAL::LoadWorkerScope::LoadWorkerScope()
+  : mWasWorker( tIsLoadWorker )
+{
+  tIsLoadWorker = true;
+}
+
+MDAL::LoadWorkerScope::~LoadWorkerScope()
+{
+  tIsLoadWorker = mWasWorker;
+}
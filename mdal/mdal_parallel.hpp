@@ -0,0 +1,79 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_PARALLEL_HPP
+#define MDAL_PARALLEL_HPP
+
+#include <stddef.h>
+#include <functional>
+#include <mutex>
+
+namespace MDAL
+{
+  class Dataset;
+
+  //! Returns maximum number of threads used for parallel tasks, at least 1
+  size_t threadCount();
+
+  /**
+   * Sets maximum number of threads used for parallel tasks
+   * 0 restores the default: MDAL_NUM_THREADS environment variable or number of cores
+   */
+  void setThreadCount( size_t count );
+
+  /**
+   * Runs task( index ) for every index in [0, count)
+   *
+   * Indexes are distributed dynamically among up to threadCount() threads,
+   * the calling thread works too. Returns when all tasks are finished.
+   * The first exception thrown by a task is rethrown in the calling thread,
+   * remaining tasks are not started.
+   */
+  void parallelFor( size_t count, const std::function<void( size_t )> &task );
+
+  /**
+   * Lock serializing the calls into the libraries that are not thread-safe
+   *
+   * HDF5, NetCDF, GDAL and libxml2 builds commonly used are not thread-safe,
+   * so loading, saving, editing and closing of meshes as well as reading of
+   * the datasets backed by files are done with this lock held.
+   */
+  std::recursive_mutex &libraryMutex();
+
+  /**
+   * Holds libraryMutex() for the lifetime unless the dataset supports concurrent reads
+   * or the thread is in LoadWorkerScope
+   */
+  class DatasetReadLock
+  {
+    public:
+      explicit DatasetReadLock( Dataset *dataset );
+
+    private:
+      std::unique_lock<std::recursive_mutex> mLock;
+  };
+
+  /**
+   * Marks the calling thread as a worker of a parallel load for the lifetime
+   *
+   * The thread that started the load holds libraryMutex(), while the worker reads only
+   * the datasets it has just loaded, which no other thread can reach yet, so DatasetReadLock
+   * does not take the lock there. The worker must not use any library that is not thread-safe.
+   */
+  class LoadWorkerScope
+  {
+    public:
+      LoadWorkerScope();
+      ~LoadWorkerScope();
+
+      LoadWorkerScope( const LoadWorkerScope & ) = delete;
+      LoadWorkerScope &operator=( const LoadWorkerScope & ) = delete;
+
+    private:
+      bool mWasWorker = false;
+  };
+
+} // namespace MDAL
+#endif //MDAL_PARALLEL_HPP
@@ -0,0 +1,206 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_perf.hpp"
+
+#include <chrono>
+#include <fstream>
+
+#include "mdal_utils.hpp"
+
+//! Names of the counters in the order of PerfCounter
+static const char *const COUNTER_NAMES[] =
+{
+  "load.count",
+  "load.time_us",
+  "load_datasets.count",
+  "load_datasets.time_us",
+  "save.count",
+  "save.time_us",
+  "persist.count",
+  "persist.time_us",
+  "data.reads",
+  "data.bytes",
+  "data.time_us",
+  "statistics.count",
+  "statistics.time_us",
+  "hdf5.reads",
+  "hdf5.bytes",
+  "netcdf.reads",
+  "netcdf.bytes",
+  "mapped_file.bytes",
+};
+static_assert( sizeof( COUNTER_NAMES ) / sizeof( COUNTER_NAMES[0] ) == static_cast<size_t>( MDAL::PerfCounter::Count ),
+               "names of all counters" );
+
+//! Small sequential id of the calling thread for the trace events
+static size_t _threadId()
+{
+  static std::atomic<size_t> sNextId( 1 );
+  static thread_local size_t tId = sNextId++;
+  return tId;
+}
+
+static std::string _escapeJson( const std::string &str )
+{
+  std::string ret;
+  for ( char c : str )
+  {
+    if ( c == '"' || c == '\\' )
+      ret.push_back( '\\' );
+    if ( static_cast<unsigned char>( c ) < 0x20 )
+      continue;
+    ret.push_back( c );
+  }
+  return ret;
+}
+
+MDAL::Perf &MDAL::Perf::instance()
+{
+  static Perf sPerf;
+  return sPerf;
+}
+
+void MDAL::Perf::add( PerfCounter counter, long long value )
+{
+  mCounters[static_cast<size_t>( counter )].fetch_add( value, std::memory_order_relaxed );
+}
+
+void MDAL::Perf::add( const std::string &name, long long value )
+{
+  counter( name )->fetch_add( value, std::memory_order_relaxed );
+}
+
+std::atomic<long long> *MDAL::Perf::counter( const std::string &name )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  std::unique_ptr<std::atomic<long long>> &counter = mNamedCounters[name];
+  if ( !counter )
+    counter.reset( new std::atomic<long long>( 0 ) );
+  return counter.get();
+}
+
+size_t MDAL::Perf::counters( const char **names, long long *values, size_t capacity ) const
+{
+  const size_t fixedCount = static_cast<size_t>( PerfCounter::Count );
+  for ( size_t i = 0; i < fixedCount && i < capacity; ++i )
+  {
+    if ( names )
+      names[i] = COUNTER_NAMES[i];
+    if ( values )
+      values[i] = mCounters[i].load( std::memory_order_relaxed );
+  }
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  size_t i = fixedCount;
+  for ( const auto &it : mNamedCounters )
+  {
+    if ( i < capacity )
+    {
+      if ( names )
+        names[i] = it.first.c_str();
+      if ( values )
+        values[i] = it.second->load( std::memory_order_relaxed );
+    }
+    ++i;
+  }
+  return i;
+}
+
+void MDAL::Perf::reset()
+{
+  for ( std::atomic<long long> &counter : mCounters )
+    counter.store( 0 );
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  for ( auto &it : mNamedCounters )
+    it.second->store( 0 );
+  mTraceEvents.clear();
+}
+
+void MDAL::Perf::setTracing( bool enabled )
+{
+  mIsTracing = enabled;
+}
+
+bool MDAL::Perf::isTracing() const
+{
+  return mIsTracing;
+}
+
+void MDAL::Perf::addTraceEvent( const char *name, const std::string &detail, long long start, long long duration )
+{
+  const size_t thread = _threadId();
+  std::lock_guard<std::mutex> lock( mMutex );
+  mTraceEvents.push_back( TraceEvent{ name, detail, start, duration, thread } );
+}
+
+bool MDAL::Perf::writeTrace( const std::string &path ) const
+{
+  std::ofstream out( path, std::ofstream::out | std::ofstream::trunc );
+  if ( !out )
+    return false;
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  out << "{\"traceEvents\":[";
+  for ( size_t i = 0; i < mTraceEvents.size(); ++i )
+  {
+    const TraceEvent &event = mTraceEvents[i];
+    if ( i > 0 )
+      out << ",";
+    out << "\n{\"name\":\"" << event.name << "\",\"cat\":\"mdal\",\"ph\":\"X\""
+        << ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+        << ",\"pid\":1,\"tid\":" << event.thread;
+    if ( !event.detail.empty() )
+      out << ",\"args\":{\"detail\":\"" << _escapeJson( event.detail ) << "\"}";
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  return out.good();
+}
+
+long long MDAL::Perf::now()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+MDAL::PerfScope::PerfScope( const char *name, PerfCounter counter, PerfCounter timeCounter, const std::string &detail )
+  : mName( name )
+  , mCounter( counter )
+  , mTimeCounter( timeCounter )
+  , mStart( Perf::now() )
+{
+  Perf &perf = Perf::instance();
+  if ( perf.isTracing() )
+    mDetail = detail;
+}
+
+MDAL::PerfScope::~PerfScope()
+{
+  const long long duration = elapsed();
+  Perf &perf = Perf::instance();
+  perf.add( mCounter, 1 );
+  perf.add( mTimeCounter, duration );
+  if ( perf.isTracing() )
+    perf.addTraceEvent( mName, mDetail, mStart, duration );
+}
+
+long long MDAL::PerfScope::elapsed() const
+{
+  return Perf::now() - mStart;
+}
+
+MDAL::PerfDriverScope::PerfDriverScope( const std::string &driverName, const char *operation )
+  : mPrefix( "driver." + driverName + "." + operation )
+  , mStart( Perf::now() )
+{
+}
+
+MDAL::PerfDriverScope::~PerfDriverScope()
+{
+  Perf &perf = Perf::instance();
+  perf.add( mPrefix + ".count", 1 );
+  perf.add( mPrefix + ".time_us", Perf::now() - mStart );
+}
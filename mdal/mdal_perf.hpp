@@ -0,0 +1,163 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_PERF_HPP
+#define MDAL_PERF_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mdal_config.hpp"
+
+namespace MDAL
+{
+  //! Library-wide counters, see MDAL_GetPerfCounters()
+  enum class PerfCounter
+  {
+    Loads = 0,
+    LoadTime,
+    DatasetLoads,
+    DatasetLoadTime,
+    Saves,
+    SaveTime,
+    Persists,
+    PersistTime,
+    DataReads,
+    DataReadBytes,
+    DataReadTime,
+    StatisticsCalculations,
+    StatisticsTime,
+    Hdf5Reads,
+    Hdf5ReadBytes,
+    NetCDFReads,
+    NetCDFReadBytes,
+    MappedFileBytes,
+    Count
+  };
+
+  /**
+   * Performance counters and trace events of the library
+   *
+   * Named counters (e.g. per driver) are created on first use and kept with zero value on reset,
+   * so their names stay valid. Trace events of the scopes are recorded only while the tracing
+   * is enabled and written in Chrome trace format.
+   *
+   * The library is instrumented by the macros below, which expand to nothing unless MDAL
+   * is built with ENABLE_PERF_COUNTERS, so there are no counters nor events then.
+   */
+  class Perf
+  {
+    public:
+      static Perf &instance();
+
+      void add( PerfCounter counter, long long value );
+
+      //! Adds value to the named counter, which is created on first use
+      void add( const std::string &name, long long value );
+
+      /**
+       * Returns the named counter, which is created on first use. The counter stays valid for the lifetime
+       * of the library, so the callers on hot paths resolve it once and add to it without the lookup
+       */
+      std::atomic<long long> *counter( const std::string &name );
+
+      /**
+       * Copies up to capacity counter names and values
+       * \returns number of the counters
+       */
+      size_t counters( const char **names, long long *values, size_t capacity ) const;
+
+      //! Sets all counters to zero, removes the recorded trace events
+      void reset();
+
+      void setTracing( bool enabled );
+      bool isTracing() const;
+
+      //! Records complete event of the name and the duration, times in microseconds
+      void addTraceEvent( const char *name, const std::string &detail, long long start, long long duration );
+
+      //! Writes recorded events as Chrome trace JSON, returns false when the file cannot be written
+      bool writeTrace( const std::string &path ) const;
+
+      //! Microseconds of the steady clock
+      static long long now();
+
+    private:
+      Perf() = default;
+
+      struct TraceEvent
+      {
+        const char *name;
+        std::string detail;
+        long long start;
+        long long duration;
+        size_t thread;
+      };
+
+      std::atomic<long long> mCounters[static_cast<size_t>( PerfCounter::Count )] = {};
+      std::atomic<bool> mIsTracing{ false };
+
+      mutable std::mutex mMutex;
+      //! values are allocated once, so the names (keys) and values stay valid
+      std::map<std::string, std::unique_ptr<std::atomic<long long>>> mNamedCounters;
+      std::vector<TraceEvent> mTraceEvents;
+  };
+
+  /**
+   * Counts the scope in the counter and its duration in the time counter (microseconds),
+   * records the trace event of the scope when the tracing is enabled
+   */
+  class PerfScope
+  {
+    public:
+      PerfScope( const char *name, PerfCounter counter, PerfCounter timeCounter, const std::string &detail = std::string() );
+      ~PerfScope();
+
+      PerfScope( const PerfScope & ) = delete;
+      PerfScope &operator=( const PerfScope & ) = delete;
+
+      //! Microseconds since the start of the scope
+      long long elapsed() const;
+
+    private:
+      const char *mName;
+      PerfCounter mCounter;
+      PerfCounter mTimeCounter;
+      std::string mDetail;
+      long long mStart;
+  };
+
+  //! Counts the scope and its duration in driver.<driverName>.<operation>.count and .time_us counters
+  class PerfDriverScope
+  {
+    public:
+      PerfDriverScope( const std::string &driverName, const char *operation );
+      ~PerfDriverScope();
+
+      PerfDriverScope( const PerfDriverScope & ) = delete;
+      PerfDriverScope &operator=( const PerfDriverScope & ) = delete;
+
+    private:
+      std::string mPrefix;
+      long long mStart;
+  };
+} // namespace MDAL
+
+#ifdef HAVE_PERF_COUNTERS
+#define MDAL_PERF_SCOPE( variable, name, counter, timeCounter, detail ) MDAL::PerfScope variable( name, counter, timeCounter, detail )
+#define MDAL_PERF_DRIVER_SCOPE( variable, driverName, operation ) MDAL::PerfDriverScope variable( driverName, operation )
+#define MDAL_PERF_ADD( counter, value ) MDAL::Perf::instance().add( counter, value )
+#else
+#define MDAL_PERF_SCOPE( variable, name, counter, timeCounter, detail )
+#define MDAL_PERF_DRIVER_SCOPE( variable, driverName, operation )
+#define MDAL_PERF_ADD( counter, value )
+#endif
+
+#endif //MDAL_PERF_HPP
@@ -0,0 +1,131 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_pipeline.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+#include "mdal_parallel.hpp"
+
+//! Number of vertices or faces in a chunk read ahead for the writers
+static const size_t PIPELINE_CHUNK_SIZE = 65536;
+//! Number of chunks read ahead for the writers
+static const size_t PIPELINE_CHUNKS = 4;
+
+MDAL::PipelinedVertexIterator::PipelinedVertexIterator( std::unique_ptr<MDAL::MeshVertexIterator> source, size_t chunkSize, size_t maximumChunks )
+  : mSource( std::move( source ) )
+{
+  MeshVertexIterator *sourceIterator = mSource.get();
+  chunkSize = std::max( chunkSize, static_cast<size_t>( 1 ) );
+  mPipeline.reset( new ChunkPipeline<std::vector<double>>( [sourceIterator, chunkSize]( std::vector<double> &chunk )
+  {
+    chunk.resize( 3 * chunkSize );
+    const size_t count = sourceIterator->next( chunkSize, chunk.data() );
+    chunk.resize( 3 * count );
+    return count > 0;
+  }, maximumChunks ) );
+}
+
+MDAL::PipelinedVertexIterator::~PipelinedVertexIterator() = default;
+
+size_t MDAL::PipelinedVertexIterator::next( size_t vertexCount, double *coordinates )
+{
+  size_t copied = 0;
+  while ( copied < vertexCount )
+  {
+    if ( mChunkPosition == mChunk.size() )
+    {
+      mChunkPosition = 0;
+      if ( !mPipeline->next( mChunk ) )
+      {
+        mChunk.clear();
+        break;
+      }
+    }
+
+    const size_t count = std::min( vertexCount - copied, ( mChunk.size() - mChunkPosition ) / 3 );
+    memcpy( coordinates + 3 * copied, mChunk.data() + mChunkPosition, 3 * count * sizeof( double ) );
+    mChunkPosition += 3 * count;
+    copied += count;
+  }
+  return copied;
+}
+
+MDAL::PipelinedFaceIterator::PipelinedFaceIterator( std::unique_ptr<MDAL::MeshFaceIterator> source, size_t chunkSize, size_t faceVerticesMaximumCount, size_t maximumChunks )
+  : mSource( std::move( source ) )
+{
+  MeshFaceIterator *sourceIterator = mSource.get();
+  chunkSize = std::max( chunkSize, static_cast<size_t>( 1 ) );
+  const size_t indicesSize = chunkSize * std::max( faceVerticesMaximumCount, static_cast<size_t>( 1 ) );
+  mPipeline.reset( new ChunkPipeline<Chunk>( [sourceIterator, chunkSize, indicesSize]( Chunk & chunk )
+  {
+    chunk.faceOffsets.resize( chunkSize );
+    chunk.vertexIndices.resize( indicesSize );
+    const size_t count = sourceIterator->next( chunkSize, chunk.faceOffsets.data(), indicesSize, chunk.vertexIndices.data() );
+    chunk.faceOffsets.resize( count );
+    chunk.vertexIndices.resize( count > 0 ? static_cast<size_t>( chunk.faceOffsets.back() ) : 0 );
+    return count > 0;
+  }, maximumChunks ) );
+}
+
+MDAL::PipelinedFaceIterator::~PipelinedFaceIterator() = default;
+
+size_t MDAL::PipelinedFaceIterator::next( size_t faceOffsetsBufferLen, int *faceOffsetsBuffer, size_t vertexIndicesBufferLen, int *vertexIndicesBuffer )
+{
+  size_t faces = 0;
+  size_t indices = 0;
+  while ( faces < faceOffsetsBufferLen )
+  {
+    if ( mChunkPosition == mChunk.faceOffsets.size() )
+    {
+      mChunkPosition = 0;
+      if ( !mPipeline->next( mChunk ) )
+      {
+        mChunk = Chunk();
+        break;
+      }
+    }
+
+    // copy whole faces while they fit to the buffers
+    const size_t chunkStart = mChunkPosition == 0 ? 0 : static_cast<size_t>( mChunk.faceOffsets[mChunkPosition - 1] );
+    size_t end = mChunkPosition;
+    while ( end < mChunk.faceOffsets.size() && faces + ( end - mChunkPosition ) < faceOffsetsBufferLen &&
+            indices + static_cast<size_t>( mChunk.faceOffsets[end] ) - chunkStart <= vertexIndicesBufferLen )
+      ++end;
+    if ( end == mChunkPosition )
+      break;
+
+    const size_t chunkEnd = static_cast<size_t>( mChunk.faceOffsets[end - 1] );
+    memcpy( vertexIndicesBuffer + indices, mChunk.vertexIndices.data() + chunkStart, ( chunkEnd - chunkStart ) * sizeof( int ) );
+    for ( size_t i = mChunkPosition; i < end; ++i )
+      faceOffsetsBuffer[faces++] = static_cast<int>( indices + static_cast<size_t>( mChunk.faceOffsets[i] ) - chunkStart );
+    indices += chunkEnd - chunkStart;
+    mChunkPosition = end;
+  }
+  return faces;
+}
+
+//! Whether the source of the writer is worth reading ahead on a worker thread
+static bool _isPipelined( size_t count )
+{
+  return MDAL::threadCount() > 1 && count > PIPELINE_CHUNK_SIZE;
+}
+
+std::unique_ptr<MDAL::MeshVertexIterator> MDAL::readVerticesPipelined( Mesh *mesh )
+{
+  if ( !_isPipelined( mesh->verticesCount() ) )
+    return mesh->readVertices();
+
+  return std::unique_ptr<MeshVertexIterator>( new PipelinedVertexIterator( mesh->readVertices(), PIPELINE_CHUNK_SIZE, PIPELINE_CHUNKS ) );
+}
+
+std::unique_ptr<MDAL::MeshFaceIterator> MDAL::readFacesPipelined( Mesh *mesh )
+{
+  if ( !_isPipelined( mesh->facesCount() ) )
+    return mesh->readFaces();
+
+  return std::unique_ptr<MeshFaceIterator>( new PipelinedFaceIterator( mesh->readFaces(), PIPELINE_CHUNK_SIZE, mesh->faceVerticesMaximumCount(), PIPELINE_CHUNKS ) );
+}
@@ -0,0 +1,175 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_PIPELINE_HPP
+#define MDAL_PIPELINE_HPP
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Bounded queue of chunks filled by a producer on a worker thread
+   *
+   * The producer is called until it returns false, at most maximumChunks chunks
+   * wait for the consumer, so the memory stays bounded for any size of the source.
+   * Exception thrown by the producer is rethrown to the consumer by next().
+   */
+  template<typename Chunk>
+  class ChunkPipeline
+  {
+    public:
+      typedef std::function<bool( Chunk & )> Producer;
+
+      ChunkPipeline( Producer producer, size_t maximumChunks )
+        : mProducer( producer )
+        , mMaximumChunks( std::max( maximumChunks, static_cast<size_t>( 1 ) ) )
+      {
+        mThread = std::thread( &ChunkPipeline::run, this );
+      }
+
+      ~ChunkPipeline()
+      {
+        {
+          std::lock_guard<std::mutex> lock( mMutex );
+          mIsStopped = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+      }
+
+      ChunkPipeline( const ChunkPipeline & ) = delete;
+      ChunkPipeline &operator=( const ChunkPipeline & ) = delete;
+
+      //! Waits for the next chunk, returns false at the end of the source
+      bool next( Chunk &chunk )
+      {
+        std::unique_lock<std::mutex> lock( mMutex );
+        mCondition.wait( lock, [this] { return !mChunks.empty() || mIsFinished; } );
+        if ( mChunks.empty() )
+        {
+          if ( mError )
+            std::rethrow_exception( mError );
+          return false;
+        }
+        chunk = std::move( mChunks.front() );
+        mChunks.pop_front();
+        lock.unlock();
+        mCondition.notify_all();
+        return true;
+      }
+
+    private:
+      void run()
+      {
+        try
+        {
+          while ( true )
+          {
+            Chunk chunk;
+            if ( !mProducer( chunk ) )
+              break;
+
+            std::unique_lock<std::mutex> lock( mMutex );
+            mCondition.wait( lock, [this] { return mChunks.size() < mMaximumChunks || mIsStopped; } );
+            if ( mIsStopped )
+              break;
+            mChunks.push_back( std::move( chunk ) );
+            lock.unlock();
+            mCondition.notify_all();
+          }
+        }
+        catch ( ... )
+        {
+          std::lock_guard<std::mutex> lock( mMutex );
+          mError = std::current_exception();
+        }
+
+        {
+          std::lock_guard<std::mutex> lock( mMutex );
+          mIsFinished = true;
+        }
+        mCondition.notify_all();
+      }
+
+      Producer mProducer;
+      size_t mMaximumChunks;
+      std::mutex mMutex;
+      std::condition_variable mCondition;
+      std::deque<Chunk> mChunks;
+      bool mIsStopped = false;
+      bool mIsFinished = false;
+      std::exception_ptr mError;
+      std::thread mThread;
+  };
+
+  /**
+   * Vertex iterator reading the source iterator ahead on a worker thread, in chunks of chunkSize vertices
+   *
+   * Used by the writers, so the reads of the source mesh overlap with the formatting and writing
+   * of the output. The source iterator must not use the libraries that are not thread-safe,
+   * as the writing thread holds libraryMutex(); iterators of all meshes read memory or mapped files.
+   */
+  class PipelinedVertexIterator: public MeshVertexIterator
+  {
+    public:
+      PipelinedVertexIterator( std::unique_ptr<MeshVertexIterator> source, size_t chunkSize, size_t maximumChunks );
+      ~PipelinedVertexIterator() override;
+
+      size_t next( size_t vertexCount, double *coordinates ) override;
+
+    private:
+      std::unique_ptr<MeshVertexIterator> mSource;
+      std::vector<double> mChunk;
+      size_t mChunkPosition = 0;
+      std::unique_ptr<ChunkPipeline<std::vector<double>>> mPipeline;
+  };
+
+  //! Face iterator reading the source iterator ahead on a worker thread, see PipelinedVertexIterator
+  class PipelinedFaceIterator: public MeshFaceIterator
+  {
+    public:
+      PipelinedFaceIterator( std::unique_ptr<MeshFaceIterator> source, size_t chunkSize, size_t faceVerticesMaximumCount, size_t maximumChunks );
+      ~PipelinedFaceIterator() override;
+
+      size_t next( size_t faceOffsetsBufferLen,
+                   int *faceOffsetsBuffer,
+                   size_t vertexIndicesBufferLen,
+                   int *vertexIndicesBuffer ) override;
+
+    private:
+      struct Chunk
+      {
+        //! end offsets of the faces in vertexIndices
+        std::vector<int> faceOffsets;
+        std::vector<int> vertexIndices;
+      };
+
+      std::unique_ptr<MeshFaceIterator> mSource;
+      Chunk mChunk;
+      size_t mChunkPosition = 0;
+      std::unique_ptr<ChunkPipeline<Chunk>> mPipeline;
+  };
+
+  /**
+   * Returns vertex iterator of the mesh for the writers, reading ahead on a worker thread
+   * when there are more threads available and the mesh is larger than one chunk
+   */
+  std::unique_ptr<MeshVertexIterator> readVerticesPipelined( Mesh *mesh );
+
+  //! Returns face iterator of the mesh for the writers, see readVerticesPipelined()
+  std::unique_ptr<MeshFaceIterator> readFacesPipelined( Mesh *mesh );
+} // namespace MDAL
+#endif //MDAL_PIPELINE_HPP
@@ -0,0 +1,145 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_prefetch.hpp"
+
+#include <vector>
+
+#include "mdal_block_cache.hpp"
+#include "mdal_data_model.hpp"
+#include "mdal_parallel.hpp"
+
+MDAL::Prefetcher &MDAL::Prefetcher::instance()
+{
+  // never destroyed, the worker is not joined during the exit, where the threads may be gone already
+  // (e.g. library unloaded on Windows), it is left waiting or finishes its block on the objects never destroyed either
+  static Prefetcher *sPrefetcher = new Prefetcher();
+  return *sPrefetcher;
+}
+
+void MDAL::Prefetcher::setFollowingCount( size_t count )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  mFollowingCount = count;
+}
+
+size_t MDAL::Prefetcher::followingCount() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mFollowingCount;
+}
+
+void MDAL::Prefetcher::prefetchFollowing( Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count )
+{
+  const size_t followingCount = this->followingCount();
+  if ( followingCount == 0 )
+    return;
+
+  // datasets are added and removed only with the library lock
+  std::lock_guard<std::recursive_mutex> libraryLock( libraryMutex() );
+  const DatasetGroup *group = dataset->group();
+  const size_t datasetCount = group->datasets.size();
+  for ( size_t i = 0; i < datasetCount; ++i )
+  {
+    if ( group->datasets[i].get() != dataset )
+      continue;
+
+    for ( size_t j = i + 1; j < datasetCount && j <= i + followingCount; ++j )
+    {
+      Dataset *following = group->datasets[j].get();
+      if ( !following->supportsConcurrentReads() )
+        prefetch( following, type, indexStart, count );
+    }
+    return;
+  }
+}
+
+void MDAL::Prefetcher::prefetch( Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count )
+{
+  BlockCache &cache = BlockCache::instance();
+  if ( cache.maximumSize() == 0 || cache.contains( dataset, type, indexStart, count ) )
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock( mMutex );
+    if ( mStop )
+      return;
+
+    for ( const Task &task : mTasks )
+    {
+      if ( task.dataset == dataset && task.type == type && task.indexStart == indexStart && task.count == count )
+        return;
+    }
+
+    Task task;
+    task.dataset = dataset;
+    task.type = type;
+    task.indexStart = indexStart;
+    task.count = count;
+    mTasks.push_back( task );
+
+    if ( !mThread.joinable() )
+      mThread = std::thread( &Prefetcher::run, this );
+  }
+  mCondition.notify_all();
+}
+
+void MDAL::Prefetcher::cancel( const Dataset *dataset )
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  for ( auto it = mTasks.begin(); it != mTasks.end(); )
+  {
+    if ( it->dataset == dataset )
+      it = mTasks.erase( it );
+    else
+      ++it;
+  }
+
+  if ( mCurrent == dataset )
+    mCurrentCancelled = true;
+}
+
+void MDAL::Prefetcher::wait()
+{
+  std::unique_lock<std::mutex> lock( mMutex );
+  mCondition.wait( lock, [this] { return mTasks.empty() && !mCurrent; } );
+}
+
+void MDAL::Prefetcher::run()
+{
+  std::unique_lock<std::mutex> lock( mMutex );
+  while ( true )
+  {
+    mCondition.wait( lock, [this] { return mStop || !mTasks.empty(); } );
+    if ( mStop )
+      return;
+
+    const Task task = mTasks.front();
+    mTasks.pop_front();
+    mCurrent = task.dataset;
+    mCurrentCancelled = false;
+    lock.unlock();
+
+    {
+      // datasets are deleted only with the library lock, check it was not meanwhile
+      std::lock_guard<std::recursive_mutex> libraryLock( libraryMutex() );
+      lock.lock();
+      const bool cancelled = mCurrentCancelled;
+      lock.unlock();
+
+      BlockCache &cache = BlockCache::instance();
+      if ( !cancelled && !cache.contains( task.dataset, task.type, task.indexStart, task.count ) )
+      {
+        std::vector<char> buffer( BlockCache::bufferSize( task.type, task.count ) );
+        const size_t valuesCount = task.dataset->data( task.type, task.indexStart, task.count, buffer.data() );
+        cache.put( task.dataset, task.type, task.indexStart, task.count, buffer.data(), valuesCount );
+      }
+    }
+
+    lock.lock();
+    mCurrent = nullptr;
+    mCondition.notify_all();
+  }
+}
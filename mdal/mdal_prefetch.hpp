@@ -0,0 +1,76 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_PREFETCH_HPP
+#define MDAL_PREFETCH_HPP
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "mdal.h"
+
+namespace MDAL
+{
+  class Dataset;
+
+  /**
+   * Reads blocks of datasets backed by files to BlockCache on a background thread
+   *
+   * The worker reads with libraryMutex() held, like the other reads from files.
+   * Datasets cancel their pending blocks when they are deleted, which happens
+   * only with libraryMutex() held too, so the worker never reads deleted dataset.
+   * Nothing is read when the cache is disabled. The prefetcher is never destroyed,
+   * the worker is not stopped at the exit.
+   */
+  class Prefetcher
+  {
+    public:
+      static Prefetcher &instance();
+
+      //! Sets number of the following datasets read after a dataset of the group is read, 0 disables it
+      void setFollowingCount( size_t count );
+      size_t followingCount() const;
+
+      //! Schedules the same block of the datasets following the dataset in its group
+      void prefetchFollowing( Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count );
+
+      //! Schedules the block of the dataset, the dataset must be backed by a file
+      void prefetch( Dataset *dataset, MDAL_DataType type, size_t indexStart, size_t count );
+
+      //! Removes the pending blocks of the dataset
+      void cancel( const Dataset *dataset );
+
+      //! Waits till all scheduled blocks are read
+      void wait();
+
+    private:
+      Prefetcher() = default;
+
+      struct Task
+      {
+        Dataset *dataset;
+        MDAL_DataType type;
+        size_t indexStart;
+        size_t count;
+      };
+
+      void run();
+
+      mutable std::mutex mMutex;
+      std::condition_variable mCondition;
+      std::deque<Task> mTasks;
+      std::thread mThread;
+      bool mStop = false;
+      //! dataset read by the worker now, nullptr when idle
+      const Dataset *mCurrent = nullptr;
+      bool mCurrentCancelled = false;
+      size_t mFollowingCount = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_PREFETCH_HPP
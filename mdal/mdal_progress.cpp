@@ -0,0 +1,79 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_progress.hpp"
+
+#include <algorithm>
+
+#include "mdal.h"
+
+//! Callback of the operations started on the thread
+static thread_local MDAL::ProgressCallback tCallback;
+//! Progress of the operation running on the thread, null when there is none
+static thread_local MDAL::Progress *tProgress = nullptr;
+
+void MDAL::setProgressCallback( const ProgressCallback &callback )
+{
+  tCallback = callback;
+}
+
+MDAL::Progress::Progress( const ProgressCallback &callback )
+  : mCallback( callback )
+  , mThread( std::this_thread::get_id() )
+  , mIsCancelled( false )
+{
+}
+
+MDAL::Progress &MDAL::Progress::current()
+{
+  static Progress sNone{ ProgressCallback() };
+  return tProgress ? *tProgress : sNone;
+}
+
+bool MDAL::Progress::report( double fraction )
+{
+  if ( mIsCancelled )
+    return false;
+
+  if ( !mCallback || std::this_thread::get_id() != mThread )
+    return true;
+
+  mFraction = std::max( mFraction, std::min( std::max( fraction, 0.0 ), 1.0 ) );
+  if ( !mCallback( mFraction ) )
+    mIsCancelled = true;
+  return !mIsCancelled;
+}
+
+void MDAL::Progress::reportOrThrow( double fraction )
+{
+  if ( !report( fraction ) )
+    throw MDAL_Status::Err_Cancelled;
+}
+
+bool MDAL::Progress::isCancelled() const
+{
+  return mIsCancelled;
+}
+
+MDAL::ProgressScope::ProgressScope()
+  : mPrevious( tProgress )
+{
+  if ( !tProgress )
+  {
+    mProgress.reset( new Progress( tCallback ) );
+    tProgress = mProgress.get();
+  }
+}
+
+MDAL::ProgressScope::ProgressScope( Progress &progress )
+  : mPrevious( tProgress )
+{
+  tProgress = &progress;
+}
+
+MDAL::ProgressScope::~ProgressScope()
+{
+  tProgress = mPrevious;
+}
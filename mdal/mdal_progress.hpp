@@ -0,0 +1,79 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_PROGRESS_HPP
+#define MDAL_PROGRESS_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace MDAL
+{
+  //! Receives fraction (0-1) of the operation done, returns false to cancel it
+  typedef std::function<bool( double )> ProgressCallback;
+
+  //! Sets callback of the loads and saves started on the calling thread, empty function removes it
+  void setProgressCallback( const ProgressCallback &callback );
+
+  /**
+   * Progress and cancellation of a load or save, see MDAL_SetProgressCallback()
+   *
+   * Drivers report the fraction done at chunk granularity from their main loops and stop
+   * with Err_Cancelled status when report() returns false. The callback is called only
+   * on the thread that started the operation, reports from the workers of parallelFor()
+   * just check the cancellation.
+   */
+  class Progress
+  {
+    public:
+      explicit Progress( const ProgressCallback &callback );
+
+      //! Progress of the operation running on the calling thread, one that is never cancelled when there is none
+      static Progress &current();
+
+      /**
+       * Reports fraction (0-1) of the operation done, fractions lower than the last one are not passed on
+       * \returns false when the operation is cancelled
+       */
+      bool report( double fraction );
+
+      //! Same as report(), throws Err_Cancelled status when cancelled, for the drivers handling the errors as thrown statuses
+      void reportOrThrow( double fraction );
+
+      //! Whether the callback has cancelled the operation, can be called from any thread
+      bool isCancelled() const;
+
+    private:
+      ProgressCallback mCallback;
+      std::thread::id mThread;
+      double mFraction = 0;
+      std::atomic<bool> mIsCancelled;
+  };
+
+  /**
+   * Makes progress current on the calling thread for the lifetime
+   *
+   * The default constructor starts progress of a new operation with the callback of the thread,
+   * unless an operation is running on the thread already (e.g. the loads of a batch).
+   * The other makes the progress of the operation current on its workers.
+   */
+  class ProgressScope
+  {
+    public:
+      ProgressScope();
+      explicit ProgressScope( Progress &progress );
+      ~ProgressScope();
+
+      ProgressScope( const ProgressScope & ) = delete;
+      ProgressScope &operator=( const ProgressScope & ) = delete;
+
+    private:
+      std::unique_ptr<Progress> mProgress;
+      Progress *mPrevious = nullptr;
+  };
+} // namespace MDAL
+#endif //MDAL_PROGRESS_HPP
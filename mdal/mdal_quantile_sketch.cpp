@@ -0,0 +1,192 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_quantile_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "mdal_simd.hpp"
+
+MDAL::QuantileSketch::QuantileSketch( size_t k )
+  : mK( std::max<size_t>( k, 8 ) )
+  , mLevels( 1 )
+  , mMinimum( std::numeric_limits<double>::quiet_NaN() )
+  , mMaximum( std::numeric_limits<double>::quiet_NaN() )
+{
+}
+
+size_t MDAL::QuantileSketch::capacity( size_t level ) const
+{
+  const size_t depth = mLevels.size() - 1 - level;
+  const double capacity = std::ceil( static_cast<double>( mK ) * std::pow( 2.0 / 3.0, static_cast<double>( depth ) ) );
+  return std::max<size_t>( 2, static_cast<size_t>( capacity ) );
+}
+
+size_t MDAL::QuantileSketch::itemsCount() const
+{
+  size_t count = 0;
+  for ( const std::vector<double> &level : mLevels )
+    count += level.size();
+  return count;
+}
+
+size_t MDAL::QuantileSketch::totalCapacity() const
+{
+  size_t total = 0;
+  for ( size_t level = 0; level < mLevels.size(); ++level )
+    total += capacity( level );
+  return total;
+}
+
+void MDAL::QuantileSketch::compress()
+{
+  while ( itemsCount() >= totalCapacity() )
+  {
+    for ( size_t level = 0; level < mLevels.size(); ++level )
+    {
+      if ( mLevels[level].size() < capacity( level ) )
+        continue;
+
+      if ( level + 1 == mLevels.size() )
+        mLevels.emplace_back();
+
+      std::vector<double> &items = mLevels[level];
+      std::vector<double> &next = mLevels[level + 1];
+      std::sort( items.begin(), items.end() );
+
+      // odd item stays on the level, every other of the rest is promoted
+      const size_t kept = items.size() % 2;
+      const size_t offset = static_cast<size_t>( mCompactions++ % 2 );
+      for ( size_t i = kept + offset; i < items.size(); i += 2 )
+        next.push_back( items[i] );
+      items.resize( kept );
+      break;
+    }
+  }
+}
+
+void MDAL::QuantileSketch::add( const double *values, size_t count )
+{
+  double min, max;
+  if ( !minMax( values, count, min, max ) )
+    return;
+
+  if ( std::isnan( mMinimum ) || min < mMinimum )
+    mMinimum = min;
+  if ( std::isnan( mMaximum ) || max > mMaximum )
+    mMaximum = max;
+
+  size_t i = 0;
+  while ( i < count )
+  {
+    // fill the free capacity, then compact
+    size_t freeItems = totalCapacity() - itemsCount();
+    std::vector<double> &items = mLevels[0];
+    for ( ; i < count && freeItems > 0; ++i )
+    {
+      if ( std::isnan( values[i] ) )
+        continue;
+      items.push_back( values[i] );
+      --freeItems;
+    }
+    if ( freeItems == 0 )
+      compress();
+  }
+}
+
+void MDAL::QuantileSketch::merge( const QuantileSketch &other )
+{
+  if ( other.count() == 0 )
+    return;
+
+  if ( std::isnan( mMinimum ) || other.mMinimum < mMinimum )
+    mMinimum = other.mMinimum;
+  if ( std::isnan( mMaximum ) || other.mMaximum > mMaximum )
+    mMaximum = other.mMaximum;
+
+  if ( mLevels.size() < other.mLevels.size() )
+    mLevels.resize( other.mLevels.size() );
+  for ( size_t level = 0; level < other.mLevels.size(); ++level )
+    mLevels[level].insert( mLevels[level].end(), other.mLevels[level].begin(), other.mLevels[level].end() );
+
+  compress();
+}
+
+uint64_t MDAL::QuantileSketch::count() const
+{
+  uint64_t count = 0;
+  for ( size_t level = 0; level < mLevels.size(); ++level )
+    count += static_cast<uint64_t>( mLevels[level].size() ) << level;
+  return count;
+}
+
+double MDAL::QuantileSketch::quantile( double fraction ) const
+{
+  const uint64_t total = count();
+  if ( total == 0 || std::isnan( fraction ) )
+    return std::numeric_limits<double>::quiet_NaN();
+
+  if ( fraction <= 0 )
+    return mMinimum;
+  if ( fraction >= 1 )
+    return mMaximum;
+
+  std::vector<std::pair<double, uint64_t>> weighted;
+  weighted.reserve( itemsCount() );
+  for ( size_t level = 0; level < mLevels.size(); ++level )
+  {
+    for ( double value : mLevels[level] )
+      weighted.emplace_back( value, uint64_t( 1 ) << level );
+  }
+  std::sort( weighted.begin(), weighted.end() );
+
+  const double rank = fraction * static_cast<double>( total );
+  uint64_t cumulative = 0;
+  for ( const std::pair<double, uint64_t> &item : weighted )
+  {
+    cumulative += item.second;
+    if ( static_cast<double>( cumulative ) >= rank )
+      return std::min( std::max( item.first, mMinimum ), mMaximum );
+  }
+  return mMaximum;
+}
+
+bool MDAL::QuantileSketch::histogram( double minimum, double maximum, size_t binCount, double *counts ) const
+{
+  if ( binCount == 0 || !counts || !std::isfinite( minimum ) || !std::isfinite( maximum ) || minimum > maximum )
+    return false;
+
+  std::fill( counts, counts + binCount, 0.0 );
+  const double width = ( maximum - minimum ) / static_cast<double>( binCount );
+  for ( size_t level = 0; level < mLevels.size(); ++level )
+  {
+    const double weight = static_cast<double>( uint64_t( 1 ) << level );
+    for ( double value : mLevels[level] )
+    {
+      if ( value < minimum || value > maximum )
+        continue;
+
+      // constant range has all values in the first bin
+      size_t bin = width > 0 ? static_cast<size_t>( ( value - minimum ) / width ) : 0;
+      if ( bin >= binCount )
+        bin = binCount - 1;
+      counts[bin] += weight;
+    }
+  }
+  return true;
+}
+
+void MDAL::QuantileSketch::setLevels( const std::vector<std::vector<double>> &levels, double minimum, double maximum )
+{
+  mLevels = levels;
+  if ( mLevels.empty() )
+    mLevels.resize( 1 );
+  mMinimum = minimum;
+  mMaximum = maximum;
+  mCompactions = 0;
+}
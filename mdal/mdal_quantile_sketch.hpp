@@ -0,0 +1,86 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_QUANTILE_SKETCH_HPP
+#define MDAL_QUANTILE_SKETCH_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace MDAL
+{
+  /**
+   * Mergeable sketch of the distribution of the values (KLL sketch)
+   *
+   * Values are kept in levels, an item of level i stands for 2^i values. When a level
+   * is full, it is sorted and every other item is promoted to the next level, so the sketch
+   * holds about 3 * k items regardless of the count of the values. The rank error
+   * of the quantiles is about 1.7 / k of the count. The compactions alternate
+   * the kept items deterministically, so the same values always give the same sketch.
+   * Sketches with the same k are merged without the loss of the accuracy.
+   */
+  class QuantileSketch
+  {
+    public:
+      explicit QuantileSketch( size_t k = 256 );
+
+      //! Adds the values, NaN values are skipped
+      void add( const double *values, size_t count );
+
+      //! Adds values of the other sketch
+      void merge( const QuantileSketch &other );
+
+      //! Number of the values added
+      uint64_t count() const;
+
+      //! Minimum added value, NaN for empty sketch
+      double minimum() const { return mMinimum; }
+
+      //! Maximum added value, NaN for empty sketch
+      double maximum() const { return mMaximum; }
+
+      /**
+       * Returns the value with the rank fraction * count(), fraction is clamped to [0, 1]
+       * Fractions 0 and 1 return exact minimum and maximum. NaN for empty sketch
+       */
+      double quantile( double fraction ) const;
+
+      /**
+       * Counts the values in binCount bins of the same width between minimum and maximum
+       * The last bin includes maximum, values outside of the range are not counted,
+       * for minimum equal to maximum the values equal to it are in the first bin.
+       * The counts are exact while the sketch has no compacted level (count() <= k)
+       * \returns false for invalid range or binCount
+       */
+      bool histogram( double minimum, double maximum, size_t binCount, double *counts ) const;
+
+      size_t k() const { return mK; }
+
+      //! Items of the levels, each item of level i stands for 2^i values
+      const std::vector<std::vector<double>> &levels() const { return mLevels; }
+
+      //! Restores the sketch from the items of the levels, e.g. read from the statistics cache
+      void setLevels( const std::vector<std::vector<double>> &levels, double minimum, double maximum );
+
+    private:
+      //! Capacity of the level, levels below the top one are smaller by 2/3 each
+      size_t capacity( size_t level ) const;
+
+      size_t itemsCount() const;
+      size_t totalCapacity() const;
+
+      //! Compacts the lowest full level until the items fit into the capacity
+      void compress();
+
+      size_t mK;
+      std::vector<std::vector<double>> mLevels;
+      double mMinimum;
+      double mMaximum;
+      //! Alternates the offset of the kept items between compactions
+      uint64_t mCompactions = 0;
+  };
+} // namespace MDAL
+#endif //MDAL_QUANTILE_SKETCH_HPP
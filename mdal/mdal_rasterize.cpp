@@ -0,0 +1,303 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_rasterize.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_spatial_index.hpp"
+
+//! Tiles of TILE_SIZE x TILE_SIZE cells are rasterized in parallel
+static const size_t TILE_SIZE = 64;
+
+//! Range of the cells with center inside the bounding box of a face, empty when first > last
+struct CellRange
+{
+  size_t firstColumn = 1;
+  size_t lastColumn = 0;
+  size_t firstRow = 1;
+  size_t lastRow = 0;
+
+  bool isEmpty() const { return firstColumn > lastColumn || firstRow > lastRow; }
+};
+
+//! Returns false when [min, max] contains no cell center of [0, count)
+static bool _cellSpan( double min, double max, size_t count, size_t &first, size_t &last )
+{
+  // cell i has center at i + 0.5
+  const double firstCell = std::ceil( min - 0.5 );
+  const double lastCell = std::floor( max - 0.5 );
+  if ( !( firstCell <= lastCell ) || lastCell < 0 || firstCell >= static_cast<double>( count ) )
+    return false;
+  first = static_cast<size_t>( std::max( firstCell, 0.0 ) );
+  last = static_cast<size_t>( std::min( lastCell, static_cast<double>( count - 1 ) ) );
+  return true;
+}
+
+//! Returns cells of the bounding box of the face, empty range for faces with invalid vertices
+static CellRange _cellRange( const std::vector<double> &px, const std::vector<double> &py, const size_t *vertices, size_t count,
+                             const MDAL::RasterGrid &grid )
+{
+  double minX = std::numeric_limits<double>::max();
+  double maxX = -std::numeric_limits<double>::max();
+  double minY = std::numeric_limits<double>::max();
+  double maxY = -std::numeric_limits<double>::max();
+  for ( size_t i = 0; i < count; ++i )
+  {
+    if ( vertices[i] >= px.size() )
+      return CellRange();
+    minX = std::min( minX, px[vertices[i]] );
+    maxX = std::max( maxX, px[vertices[i]] );
+    minY = std::min( minY, py[vertices[i]] );
+    maxY = std::max( maxY, py[vertices[i]] );
+  }
+
+  CellRange range;
+  if ( !_cellSpan( minX, maxX, grid.columns, range.firstColumn, range.lastColumn ) ||
+       !_cellSpan( minY, maxY, grid.rows, range.firstRow, range.lastRow ) )
+    return CellRange();
+  return range;
+}
+
+/**
+ * Reads the values of the dataset at the elements, magnitudes for vectors, and the active flags
+ * of the faces if the dataset supports them
+ * \returns false when the values could not be read
+ */
+static bool _readValues( MDAL::Dataset &dataset, const std::vector<size_t> &elements, const std::vector<size_t> &faces,
+                         std::vector<double> &values, std::vector<int> &active )
+{
+  const size_t count = elements.size();
+  MDAL::DatasetReadLock lock( &dataset );
+  if ( dataset.group()->isScalar() )
+  {
+    values.assign( count, std::numeric_limits<double>::quiet_NaN() );
+    if ( count > 0 && dataset.dataAtIndices( MDAL_DataType::SCALAR_DOUBLE, elements.data(), count, values.data() ) != count )
+      return false;
+  }
+  else
+  {
+    std::vector<double> vectors( 2 * count, std::numeric_limits<double>::quiet_NaN() );
+    if ( count > 0 && dataset.dataAtIndices( MDAL_DataType::VECTOR_2D_DOUBLE, elements.data(), count, vectors.data() ) != count )
+      return false;
+    values.resize( count );
+    for ( size_t i = 0; i < count; ++i )
+      values[i] = std::sqrt( vectors[2 * i] * vectors[2 * i] + vectors[2 * i + 1] * vectors[2 * i + 1] );
+  }
+
+  if ( dataset.supportsActiveFlag() )
+  {
+    active.assign( faces.size(), 1 );
+    if ( !faces.empty() && dataset.dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, faces.data(), faces.size(), active.data() ) != faces.size() )
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Rasterizes triangle a, b, c with values va, vb, vc to the cells of the range
+ * Coordinates are in cells of the grid, cell ( i, j ) has center at ( i + 0.5, j + 0.5 )
+ */
+static void _rasterizeTriangle( double ax, double ay, double bx, double by, double cx, double cy,
+                                double va, double vb, double vc, const CellRange &range,
+                                const MDAL::RasterGrid &grid, float *buffer )
+{
+  double area = ( bx - ax ) * ( cy - ay ) - ( by - ay ) * ( cx - ax );
+  if ( !( area != 0 ) )
+    return;
+
+  // counter-clockwise in cell coordinates, so all edge functions are positive inside
+  if ( area < 0 )
+  {
+    std::swap( bx, cx );
+    std::swap( by, cy );
+    std::swap( vb, vc );
+    area = -area;
+  }
+
+  // edge opposite to the vertex is its barycentric weight multiplied by area
+  const double steps[3] = { -( cy - by ), -( ay - cy ), -( by - ay ) };
+  const double slope1 = ( vb - va ) / area;
+  const double slope2 = ( vc - va ) / area;
+  const double x = static_cast<double>( range.firstColumn ) + 0.5;
+  for ( size_t row = range.firstRow; row <= range.lastRow; ++row )
+  {
+    const double y = static_cast<double>( row ) + 0.5;
+    const double edges[3] =
+    {
+      ( cx - bx ) * ( y - by ) - ( cy - by ) * ( x - bx ),
+      ( ax - cx ) * ( y - cy ) - ( ay - cy ) * ( x - cx ),
+      ( bx - ax ) * ( y - ay ) - ( by - ay ) * ( x - ax )
+    };
+    MDAL::triangleSpan( edges, steps, va, slope1, slope2,
+                        range.lastColumn - range.firstColumn + 1,
+                        buffer + row * grid.columns + range.firstColumn );
+  }
+}
+
+bool MDAL::rasterize( Dataset &dataset, const RasterGrid &grid, float *buffer )
+{
+  DatasetGroup *group = dataset.group();
+  Mesh *mesh = dataset.mesh();
+  const bool onVertices = group->dataLocation() == MDAL_DataLocation::DataOnVertices2D;
+  if ( !onVertices && group->dataLocation() != MDAL_DataLocation::DataOnFaces2D )
+    return false;
+
+  std::fill( buffer, buffer + grid.columns * grid.rows, std::numeric_limits<float>::quiet_NaN() );
+  if ( grid.columns == 0 || grid.rows == 0 || !( grid.cellWidth > 0 ) || !( grid.cellHeight > 0 ) )
+    return true;
+
+  // only the faces intersecting the grid are read, with their vertices and values
+  const BBox extent( grid.minX, grid.minX + static_cast<double>( grid.columns ) * grid.cellWidth,
+                     grid.maxY - static_cast<double>( grid.rows ) * grid.cellHeight, grid.maxY );
+  SelectedFacesIterator faceIterator( *mesh, mesh->faceTree().search( extent ) );
+  const std::vector<size_t> &faces = faceIterator.faceIndices();
+  const size_t facesRead = faces.size();
+  if ( facesRead == 0 )
+    return true;
+
+  std::vector<size_t> faceOffsets( 1, 0 );
+  std::vector<size_t> faceVertices;
+  {
+    const size_t blockSize = 65536;
+    std::vector<int> offsets( std::min( facesRead, blockSize ) );
+    std::vector<int> indices( offsets.size() * std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) ) );
+    faceOffsets.reserve( facesRead + 1 );
+    while ( faceOffsets.size() <= facesRead )
+    {
+      const size_t count = faceIterator.next( offsets.size(), offsets.data(), indices.size(), indices.data() );
+      if ( count == 0 )
+        return false;
+      const size_t firstIndex = faceVertices.size();
+      for ( size_t i = 0; i < static_cast<size_t>( offsets[count - 1] ); ++i )
+        faceVertices.push_back( static_cast<size_t>( indices[i] ) );
+      for ( size_t i = 0; i < count; ++i )
+        faceOffsets.push_back( firstIndex + static_cast<size_t>( offsets[i] ) );
+    }
+  }
+
+  // vertices of the faces, face vertices are mapped to their position, invalid ones past the end
+  const size_t meshVerticesCount = mesh->verticesCount();
+  std::vector<size_t> vertexIndices;
+  vertexIndices.reserve( faceVertices.size() );
+  for ( size_t vertex : faceVertices )
+  {
+    if ( vertex < meshVerticesCount )
+      vertexIndices.push_back( vertex );
+  }
+  std::sort( vertexIndices.begin(), vertexIndices.end() );
+  vertexIndices.erase( std::unique( vertexIndices.begin(), vertexIndices.end() ), vertexIndices.end() );
+  const size_t verticesCount = vertexIndices.size();
+  for ( size_t &vertex : faceVertices )
+  {
+    if ( vertex < meshVerticesCount )
+      vertex = static_cast<size_t>( std::lower_bound( vertexIndices.begin(), vertexIndices.end(), vertex ) - vertexIndices.begin() );
+    else
+      vertex = verticesCount;
+  }
+
+  // vertices in the cell coordinates of the grid
+  SelectedVerticesIterator vertexIterator( *mesh, std::move( vertexIndices ) );
+  std::vector<double> px( verticesCount );
+  std::vector<double> py( verticesCount );
+  {
+    std::vector<double> coordinates( 3 * verticesCount );
+    if ( vertexIterator.next( verticesCount, coordinates.data() ) != verticesCount )
+      return false;
+    for ( size_t i = 0; i < verticesCount; ++i )
+    {
+      px[i] = ( coordinates[3 * i] - grid.minX ) / grid.cellWidth;
+      py[i] = ( grid.maxY - coordinates[3 * i + 1] ) / grid.cellHeight;
+    }
+  }
+
+  // values and active flags are indexed by the position of the vertex or face
+  std::vector<double> values;
+  std::vector<int> active;
+  if ( !_readValues( dataset, onVertices ? vertexIterator.vertexIndices() : faces, faces, values, active ) )
+    return false;
+
+  // faces of each tile, in ascending order
+  const size_t tileColumns = ( grid.columns + TILE_SIZE - 1 ) / TILE_SIZE;
+  const size_t tileRows = ( grid.rows + TILE_SIZE - 1 ) / TILE_SIZE;
+  std::vector<CellRange> faceRanges( facesRead );
+  parallelFor( ( facesRead + TILE_SIZE * TILE_SIZE - 1 ) / ( TILE_SIZE * TILE_SIZE ), [&]( size_t block )
+  {
+    const size_t end = std::min( facesRead, ( block + 1 ) * TILE_SIZE * TILE_SIZE );
+    for ( size_t f = block * TILE_SIZE * TILE_SIZE; f < end; ++f )
+    {
+      const bool isActive = active.empty() || active[f] != 0;
+      if ( isActive )
+        faceRanges[f] = _cellRange( px, py, faceVertices.data() + faceOffsets[f],
+                                    faceOffsets[f + 1] - faceOffsets[f], grid );
+    }
+  } );
+
+  std::vector<size_t> tileOffsets( tileColumns * tileRows + 1, 0 );
+  for ( const CellRange &range : faceRanges )
+  {
+    if ( range.isEmpty() )
+      continue;
+    for ( size_t tileRow = range.firstRow / TILE_SIZE; tileRow <= range.lastRow / TILE_SIZE; ++tileRow )
+      for ( size_t tileColumn = range.firstColumn / TILE_SIZE; tileColumn <= range.lastColumn / TILE_SIZE; ++tileColumn )
+        ++tileOffsets[tileRow * tileColumns + tileColumn + 1];
+  }
+  for ( size_t i = 1; i < tileOffsets.size(); ++i )
+    tileOffsets[i] += tileOffsets[i - 1];
+
+  std::vector<size_t> tileFaces( tileOffsets.back() );
+  {
+    std::vector<size_t> position( tileOffsets.begin(), tileOffsets.end() - 1 );
+    for ( size_t f = 0; f < facesRead; ++f )
+    {
+      const CellRange &range = faceRanges[f];
+      if ( range.isEmpty() )
+        continue;
+      for ( size_t tileRow = range.firstRow / TILE_SIZE; tileRow <= range.lastRow / TILE_SIZE; ++tileRow )
+        for ( size_t tileColumn = range.firstColumn / TILE_SIZE; tileColumn <= range.lastColumn / TILE_SIZE; ++tileColumn )
+          tileFaces[position[tileRow * tileColumns + tileColumn]++] = f;
+    }
+  }
+
+  // tiles are taken by the threads as they finish the previous ones, large tiles do not stall the others
+  parallelFor( tileColumns * tileRows, [&]( size_t tile )
+  {
+    const size_t tileRow = tile / tileColumns;
+    const size_t tileColumn = tile % tileColumns;
+    for ( size_t i = tileOffsets[tile]; i < tileOffsets[tile + 1]; ++i )
+    {
+      const size_t f = tileFaces[i];
+      CellRange range = faceRanges[f];
+      range.firstColumn = std::max( range.firstColumn, tileColumn * TILE_SIZE );
+      range.lastColumn = std::min( range.lastColumn, ( tileColumn + 1 ) * TILE_SIZE - 1 );
+      range.firstRow = std::max( range.firstRow, tileRow * TILE_SIZE );
+      range.lastRow = std::min( range.lastRow, ( tileRow + 1 ) * TILE_SIZE - 1 );
+
+      const size_t *vertices = faceVertices.data() + faceOffsets[f];
+      const size_t count = faceOffsets[f + 1] - faceOffsets[f];
+      for ( size_t j = 1; j + 1 < count; ++j )
+      {
+        const size_t a = vertices[0];
+        const size_t b = vertices[j];
+        const size_t c = vertices[j + 1];
+        if ( onVertices )
+          _rasterizeTriangle( px[a], py[a], px[b], py[b], px[c], py[c],
+                              values[a], values[b], values[c], range, grid, buffer );
+        else
+          _rasterizeTriangle( px[a], py[a], px[b], py[b], px[c], py[c],
+                              values[f], values[f], values[f], range, grid, buffer );
+      }
+    }
+  } );
+
+  return true;
+}
@@ -0,0 +1,45 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_RASTERIZE_HPP
+#define MDAL_RASTERIZE_HPP
+
+#include <stddef.h>
+
+namespace MDAL
+{
+  class Dataset;
+
+  //! Raster of columns x rows cells, cell ( 0, 0 ) is in the top left corner ( minX, maxY )
+  struct RasterGrid
+  {
+    double minX = 0;
+    double maxY = 0;
+    double cellWidth = 1;
+    double cellHeight = 1;
+    size_t columns = 0;
+    size_t rows = 0;
+  };
+
+  /**
+   * Rasterizes the dataset defined on vertices or faces of 2D mesh to the grid
+   *
+   * Cells are sampled at their centers. Values on vertices are interpolated linearly
+   * within triangles of the faces (faces are split to triangles from their first vertex),
+   * values on faces are constant within the face, vectors are rasterized as magnitudes.
+   * Cells outside of the mesh or in inactive faces are NaN.
+   *
+   * Only the faces found by the spatial index of the mesh in the extent of the grid are read,
+   * with the values of their vertices or of the faces themselves.
+   * Faces are binned to tiles of the grid and the tiles are rasterized in parallel,
+   * each cell is written by one thread only, so the result does not depend on the thread count.
+   *
+   * \param buffer columns * rows values, row by row from the top one
+   * \returns false when the dataset is not defined on vertices or faces of 2D mesh
+   */
+  bool rasterize( Dataset &dataset, const RasterGrid &grid, float *buffer );
+
+} // namespace MDAL
+#endif //MDAL_RASTERIZE_HPP
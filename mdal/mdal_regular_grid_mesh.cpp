@@ -0,0 +1,241 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_regular_grid_mesh.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+const size_t MDAL::RegularGridMesh::NO_FACE;
+
+static size_t _facesCount( size_t columns, size_t rows )
+{
+  if ( columns < 2 || rows < 2 )
+    return 0;
+  return ( columns - 1 ) * ( rows - 1 );
+}
+
+//! Extent of the pixel centers, the grid is affine so the corner pixels bound it
+static MDAL::BBox _gridExtent( size_t columns, size_t rows, const double *gt )
+{
+  MDAL::BBox extent( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+                     std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+  if ( columns == 0 || rows == 0 )
+    return MDAL::BBox( 0, 0, 0, 0 );
+
+  const double cs[2] = { 0.5, static_cast<double>( columns ) - 0.5 };
+  const double rs[2] = { 0.5, static_cast<double>( rows ) - 0.5 };
+  for ( double c : cs )
+  {
+    for ( double r : rs )
+    {
+      const double x = gt[0] + c * gt[1] + r * gt[2];
+      const double y = gt[3] + c * gt[4] + r * gt[5];
+      extent.minX = std::min( extent.minX, x );
+      extent.maxX = std::max( extent.maxX, x );
+      extent.minY = std::min( extent.minY, y );
+      extent.maxY = std::max( extent.maxY, y );
+    }
+  }
+  return extent;
+}
+
+MDAL::RegularGridMesh::RegularGridMesh( const std::string &driverName,
+                                        size_t columns,
+                                        size_t rows,
+                                        const double *geoTransform,
+                                        const std::string &uri )
+  : MDAL::Mesh( driverName,
+                columns * rows,
+                _facesCount( columns, rows ),
+                4, //maximum quads
+                _gridExtent( columns, rows, geoTransform ),
+                uri )
+  , mColumns( columns )
+  , mRows( rows )
+{
+  std::copy( geoTransform, geoTransform + 6, mGT );
+
+  const double det = mGT[1] * mGT[5] - mGT[2] * mGT[4];
+  if ( det != 0 )
+  {
+    mInverse[0] = mGT[5] / det;
+    mInverse[1] = -mGT[2] / det;
+    mInverse[2] = -mGT[4] / det;
+    mInverse[3] = mGT[1] / det;
+  }
+  else
+  {
+    // degenerated transform, no point is inside
+    std::fill( mInverse, mInverse + 4, std::numeric_limits<double>::quiet_NaN() );
+  }
+}
+
+MDAL::RegularGridMesh::~RegularGridMesh() = default;
+
+std::unique_ptr<MDAL::MeshVertexIterator> MDAL::RegularGridMesh::readVertices()
+{
+  std::unique_ptr<MDAL::MeshVertexIterator> it( new RegularGridMeshVertexIterator( this ) );
+  return it;
+}
+
+std::unique_ptr<MDAL::MeshFaceIterator> MDAL::RegularGridMesh::readFaces()
+{
+  std::unique_ptr<MDAL::MeshFaceIterator> it( new RegularGridMeshFaceIterator( this ) );
+  return it;
+}
+
+size_t MDAL::RegularGridMesh::uniformFaceVerticesCount()
+{
+  return facesCount() > 0 ? 4 : 0;
+}
+
+size_t MDAL::RegularGridMesh::vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z )
+{
+  const size_t maxVertices = verticesCount();
+  if ( ( count < 1 ) || ( indexStart >= maxVertices ) )
+    return 0;
+
+  const size_t copyValues = std::min( maxVertices - indexStart, count );
+  size_t column = indexStart % mColumns;
+  size_t row = indexStart / mColumns;
+  for ( size_t i = 0; i < copyValues; ++i )
+  {
+    double vx, vy;
+    vertex( column, row, vx, vy );
+    if ( x )
+      x[i] = vx;
+    if ( y )
+      y[i] = vy;
+    if ( z )
+      z[i] = 0.0;
+
+    if ( ++column == mColumns )
+    {
+      column = 0;
+      ++row;
+    }
+  }
+  return copyValues;
+}
+
+void MDAL::RegularGridMesh::faceVertices( size_t faceIndex, size_t *indices ) const
+{
+  assert( faceIndex < facesCount() );
+  const size_t column = faceIndex % ( mColumns - 1 );
+  const size_t row = faceIndex / ( mColumns - 1 );
+  indices[0] = column + 1 + mColumns * ( row + 1 );
+  indices[1] = column + mColumns * ( row + 1 );
+  indices[2] = column + mColumns * row;
+  indices[3] = column + 1 + mColumns * row;
+}
+
+size_t MDAL::RegularGridMesh::faceAt( double x, double y ) const
+{
+  if ( facesCount() == 0 )
+    return NO_FACE;
+
+  // position in the grid of the pixel centers
+  const double dx = x - mGT[0];
+  const double dy = y - mGT[3];
+  const double column = mInverse[0] * dx + mInverse[1] * dy - 0.5;
+  const double row = mInverse[2] * dx + mInverse[3] * dy - 0.5;
+
+  const double maxColumn = static_cast<double>( mColumns - 1 );
+  const double maxRow = static_cast<double>( mRows - 1 );
+  if ( !( column >= 0 && column <= maxColumn && row >= 0 && row <= maxRow ) )
+    return NO_FACE;
+
+  // points on the last column or row belong to the last face
+  const size_t faceColumn = std::min( static_cast<size_t>( column ), mColumns - 2 );
+  const size_t faceRow = std::min( static_cast<size_t>( row ), mRows - 2 );
+  return faceRow * ( mColumns - 1 ) + faceColumn;
+}
+
+MDAL::RegularGridMeshVertexIterator::RegularGridMeshVertexIterator( const MDAL::RegularGridMesh *mesh )
+  : mMesh( mesh )
+{
+}
+
+MDAL::RegularGridMeshVertexIterator::~RegularGridMeshVertexIterator() = default;
+
+size_t MDAL::RegularGridMeshVertexIterator::next( size_t vertexCount, double *coordinates )
+{
+  assert( mMesh );
+  assert( coordinates );
+
+  const size_t maxVertices = mMesh->verticesCount();
+  if ( mLastVertexIndex >= maxVertices )
+    return 0;
+
+  const size_t count = std::min( vertexCount, maxVertices - mLastVertexIndex );
+  const size_t columns = mMesh->columns();
+  size_t column = mLastVertexIndex % columns;
+  size_t row = mLastVertexIndex / columns;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    mMesh->vertex( column, row, coordinates[3 * i], coordinates[3 * i + 1] );
+    coordinates[3 * i + 2] = 0.0;
+
+    if ( ++column == columns )
+    {
+      column = 0;
+      ++row;
+    }
+  }
+
+  mLastVertexIndex += count;
+  return count;
+}
+
+MDAL::RegularGridMeshFaceIterator::RegularGridMeshFaceIterator( const MDAL::RegularGridMesh *mesh )
+  : mMesh( mesh )
+{
+}
+
+MDAL::RegularGridMeshFaceIterator::~RegularGridMeshFaceIterator() = default;
+
+template <typename T>
+size_t MDAL::RegularGridMeshFaceIterator::nextFaces(
+  size_t faceOffsetsBufferLen, T *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, T *vertexIndicesBuffer )
+{
+  assert( mMesh );
+  assert( faceOffsetsBuffer );
+  assert( vertexIndicesBuffer );
+
+  const size_t maxFaces = mMesh->facesCount();
+  if ( mLastFaceIndex >= maxFaces )
+    return 0;
+
+  const size_t count = std::min( std::min( faceOffsetsBufferLen, vertexIndicesBufferLen / 4 ),
+                                 maxFaces - mLastFaceIndex );
+  size_t indices[4];
+  for ( size_t i = 0; i < count; ++i )
+  {
+    mMesh->faceVertices( mLastFaceIndex + i, indices );
+    for ( size_t j = 0; j < 4; ++j )
+      vertexIndicesBuffer[4 * i + j] = static_cast<T>( indices[j] );
+    faceOffsetsBuffer[i] = static_cast<T>( 4 * ( i + 1 ) );
+  }
+
+  mLastFaceIndex += count;
+  return count;
+}
+
+size_t MDAL::RegularGridMeshFaceIterator::next(
+  size_t faceOffsetsBufferLen, int *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, int *vertexIndicesBuffer )
+{
+  return nextFaces( faceOffsetsBufferLen, faceOffsetsBuffer, vertexIndicesBufferLen, vertexIndicesBuffer );
+}
+
+size_t MDAL::RegularGridMeshFaceIterator::next64(
+  size_t faceOffsetsBufferLen, int64_t *faceOffsetsBuffer,
+  size_t vertexIndicesBufferLen, int64_t *vertexIndicesBuffer )
+{
+  return nextFaces( faceOffsetsBufferLen, faceOffsetsBuffer, vertexIndicesBufferLen, vertexIndicesBuffer );
+}
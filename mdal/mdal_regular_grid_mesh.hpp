@@ -0,0 +1,115 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_REGULAR_GRID_MESH_HPP
+#define MDAL_REGULAR_GRID_MESH_HPP
+
+#include <stddef.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Mesh of the raster with vertices in the pixel centers and quad faces between them
+   *
+   * Only the affine transform and the raster size are stored, the vertices
+   * and faces are generated when read. Vertex of the pixel (column, row) has
+   * index row * columns + column and face between pixels (column, row) and
+   * (column + 1, row + 1) has index row * ( columns - 1 ) + column.
+   */
+  class RegularGridMesh: public Mesh
+  {
+    public:
+      static const size_t NO_FACE = std::numeric_limits<size_t>::max();
+
+      /**
+       * \param geoTransform affine transform of the raster as returned by GDALGetGeoTransform(),
+       *        x = gt[0] + column * gt[1] + row * gt[2], y = gt[3] + column * gt[4] + row * gt[5]
+       */
+      RegularGridMesh( const std::string &driverName,
+                       size_t columns,
+                       size_t rows,
+                       const double *geoTransform,
+                       const std::string &uri );
+      ~RegularGridMesh() override;
+
+      std::unique_ptr<MDAL::MeshVertexIterator> readVertices() override;
+      std::unique_ptr<MDAL::MeshFaceIterator> readFaces() override;
+
+      size_t vertexCoordinates( size_t indexStart, size_t count, double *x, double *y, double *z ) override;
+
+      //! All faces are quads
+      size_t uniformFaceVerticesCount() override;
+
+      //! Number of pixels in the row
+      size_t columns() const { return mColumns; }
+      //! Number of pixel rows
+      size_t rows() const { return mRows; }
+
+      //! Coordinates of the vertex in the center of the pixel
+      void vertex( size_t column, size_t row, double &x, double &y ) const
+      {
+        const double c = static_cast<double>( column ) + 0.5;
+        const double r = static_cast<double>( row ) + 0.5;
+        x = mGT[0] + c * mGT[1] + r * mGT[2];
+        y = mGT[3] + c * mGT[4] + r * mGT[5];
+      }
+
+      //! Copies 4 vertex indices of the face to indices, in the same order as the faces are read
+      void faceVertices( size_t faceIndex, size_t *indices ) const;
+
+      //! Returns index of a face containing the point in constant time, NO_FACE when the point is outside of the mesh
+      size_t faceAt( double x, double y ) const;
+
+    private:
+      size_t mColumns;
+      size_t mRows;
+      double mGT[6];
+      //! inverse of the affine transform without translation
+      double mInverse[4];
+  };
+
+  class RegularGridMeshVertexIterator: public MeshVertexIterator
+  {
+    public:
+      RegularGridMeshVertexIterator( const RegularGridMesh *mesh );
+      ~RegularGridMeshVertexIterator() override;
+
+      size_t next( size_t vertexCount, double *coordinates ) override;
+
+    private:
+      const RegularGridMesh *mMesh;
+      size_t mLastVertexIndex = 0;
+  };
+
+  class RegularGridMeshFaceIterator: public MeshFaceIterator
+  {
+    public:
+      RegularGridMeshFaceIterator( const RegularGridMesh *mesh );
+      ~RegularGridMeshFaceIterator() override;
+
+      size_t next( size_t faceOffsetsBufferLen,
+                   int *faceOffsetsBuffer,
+                   size_t vertexIndicesBufferLen,
+                   int *vertexIndicesBuffer ) override;
+
+      size_t next64( size_t faceOffsetsBufferLen,
+                     int64_t *faceOffsetsBuffer,
+                     size_t vertexIndicesBufferLen,
+                     int64_t *vertexIndicesBuffer ) override;
+
+    private:
+      template <typename T>
+      size_t nextFaces( size_t faceOffsetsBufferLen, T *faceOffsetsBuffer,
+                        size_t vertexIndicesBufferLen, T *vertexIndicesBuffer );
+
+      const RegularGridMesh *mMesh;
+      size_t mLastFaceIndex = 0;
+  };
+} // namespace MDAL
+#endif //MDAL_REGULAR_GRID_MESH_HPP
@@ -0,0 +1,329 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_remote.hpp"
+
+#include <string.h>
+#include <algorithm>
+
+#include "mdal_config.hpp"
+#include "mdal_options.hpp"
+#include "mdal_utils.hpp"
+
+#ifdef HAVE_CURL
+#include <curl/curl.h>
+#endif
+
+bool MDAL::isRemoteUri( const std::string &uri )
+{
+  return startsWith( uri, "http://", CaseInsensitive ) ||
+         startsWith( uri, "https://", CaseInsensitive ) ||
+         startsWith( uri, "s3://", CaseInsensitive );
+}
+
+std::string MDAL::remoteUrl( const std::string &uri )
+{
+  if ( !startsWith( uri, "s3://", CaseInsensitive ) )
+    return uri;
+
+  const std::string path = uri.substr( 5 );
+  const std::string endpoint = openOption( OPTION_S3_ENDPOINT );
+  if ( !endpoint.empty() )
+    return ( endsWith( endpoint, "/" ) ? endpoint : endpoint + "/" ) + path;
+
+  const size_t slash = path.find( '/' );
+  const std::string bucket = path.substr( 0, slash );
+  const std::string key = slash == std::string::npos ? std::string() : path.substr( slash + 1 );
+  return "https://" + bucket + ".s3.amazonaws.com/" + key;
+}
+
+MDAL::RangeSource::~RangeSource() = default;
+
+const size_t MDAL::RemoteFile::KEPT_FILES = 2;
+
+#ifdef HAVE_CURL
+
+//! Size of the fetched blocks when not set by REMOTE_BLOCK_SIZE option
+static const size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+//! Budget of the cached blocks of one file when not set by REMOTE_CACHE_SIZE option
+static const size_t DEFAULT_CACHE_SIZE = 64 * 1024 * 1024;
+//! Number of blocks fetched ahead of the sequential reads when not set by REMOTE_READAHEAD option
+static const size_t DEFAULT_READAHEAD_BLOCKS = 4;
+
+static size_t _sizeOption( const char *name, size_t defaultValue )
+{
+  const std::string option = MDAL::openOption( name );
+  if ( option.empty() )
+    return defaultValue;
+  return MDAL::toSizeT( option );
+}
+
+namespace
+{
+  //! Range requests of an http(s) url by libcurl
+  class CurlRangeSource: public MDAL::RangeSource
+  {
+    public:
+      explicit CurlRangeSource( const std::string &url )
+        : mUrl( url )
+      {
+        static std::once_flag sInit;
+        std::call_once( sInit, []() { curl_global_init( CURL_GLOBAL_DEFAULT ); } );
+        mCurl = curl_easy_init();
+      }
+
+      ~CurlRangeSource() override
+      {
+        if ( mCurl )
+          curl_easy_cleanup( mCurl );
+      }
+
+      int64_t size() override
+      {
+        if ( !mCurl )
+          return -1;
+
+        curl_easy_reset( mCurl );
+        curl_easy_setopt( mCurl, CURLOPT_URL, mUrl.c_str() );
+        curl_easy_setopt( mCurl, CURLOPT_NOBODY, 1L );
+        curl_easy_setopt( mCurl, CURLOPT_FOLLOWLOCATION, 1L );
+        if ( curl_easy_perform( mCurl ) != CURLE_OK || responseCode() != 200 )
+          return -1;
+
+        curl_off_t length = -1;
+        if ( curl_easy_getinfo( mCurl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length ) != CURLE_OK )
+          return -1;
+        return static_cast<int64_t>( length );
+      }
+
+      size_t read( uint64_t offset, size_t count, char *buffer ) override
+      {
+        if ( !mCurl || count == 0 )
+          return 0;
+
+        Transfer transfer{ buffer, count, 0, false };
+        const std::string range = std::to_string( offset ) + "-" + std::to_string( offset + count - 1 );
+        curl_easy_reset( mCurl );
+        curl_easy_setopt( mCurl, CURLOPT_URL, mUrl.c_str() );
+        curl_easy_setopt( mCurl, CURLOPT_FOLLOWLOCATION, 1L );
+        curl_easy_setopt( mCurl, CURLOPT_RANGE, range.c_str() );
+        curl_easy_setopt( mCurl, CURLOPT_WRITEFUNCTION, &CurlRangeSource::write );
+        curl_easy_setopt( mCurl, CURLOPT_WRITEDATA, &transfer );
+        // the transfer of the content over the range is aborted by the write function, the buffer is full then
+        const CURLcode result = curl_easy_perform( mCurl );
+        if ( result != CURLE_OK && !( result == CURLE_WRITE_ERROR && transfer.isAborted ) )
+          return 0;
+
+        // servers ignoring the range send the whole content, usable only from the start
+        const long code = responseCode();
+        if ( code != 206 && !( code == 200 && offset == 0 ) )
+          return 0;
+        return transfer.written;
+      }
+
+    private:
+      struct Transfer
+      {
+        char *buffer;
+        size_t capacity;
+        size_t written;
+        bool isAborted;
+      };
+
+      static size_t write( char *data, size_t size, size_t count, void *userData )
+      {
+        Transfer *transfer = static_cast<Transfer *>( userData );
+        const size_t bytes = std::min( size * count, transfer->capacity - transfer->written );
+        memcpy( transfer->buffer + transfer->written, data, bytes );
+        transfer->written += bytes;
+        // returning less than received aborts the transfer of the content over the range
+        if ( bytes < size * count )
+          transfer->isAborted = true;
+        return bytes;
+      }
+
+      long responseCode()
+      {
+        long code = 0;
+        curl_easy_getinfo( mCurl, CURLINFO_RESPONSE_CODE, &code );
+        return code;
+      }
+
+      std::string mUrl;
+      CURL *mCurl = nullptr;
+  };
+}
+
+#endif
+
+MDAL::RemoteFile::RemoteFile( std::unique_ptr<RangeSource> source, size_t blockSize, size_t maximumSize, size_t readaheadBlocks )
+  : mSource( std::move( source ) )
+  , mBlockSize( std::max( blockSize, static_cast<size_t>( 1 ) ) )
+  , mReadaheadBlocks( readaheadBlocks )
+{
+  const int64_t size = mSource->size();
+  mSize = size > 0 ? static_cast<uint64_t>( size ) : 0;
+  // the blocks of a read are copied before caching, so zero budget only disables the cache
+  mMaximumBlocks = maximumSize / mBlockSize;
+}
+
+MDAL::RemoteFile::~RemoteFile() = default;
+
+std::shared_ptr<MDAL::RemoteFile> MDAL::RemoteFile::open( const std::string &uri )
+{
+  if ( !isRemoteUri( uri ) )
+    return nullptr;
+
+#ifdef HAVE_CURL
+  const size_t blockSize = _sizeOption( OPTION_REMOTE_BLOCK_SIZE, DEFAULT_BLOCK_SIZE );
+  const size_t cacheSize = _sizeOption( OPTION_REMOTE_CACHE_SIZE, DEFAULT_CACHE_SIZE );
+  const size_t readaheadBlocks = _sizeOption( OPTION_REMOTE_READAHEAD, DEFAULT_READAHEAD_BLOCKS );
+  const std::string key = uri + '\n' + std::to_string( blockSize ) + '\n' + std::to_string( cacheSize ) + '\n' + std::to_string( readaheadBlocks );
+
+  // most recently used first
+  static std::mutex sMutex;
+  static std::list<std::pair<std::string, std::shared_ptr<RemoteFile>>> sKept;
+  {
+    std::lock_guard<std::mutex> lock( sMutex );
+    for ( auto it = sKept.begin(); it != sKept.end(); ++it )
+    {
+      if ( it->first == key )
+      {
+        sKept.splice( sKept.begin(), sKept, it );
+        return sKept.front().second;
+      }
+    }
+  }
+
+  // the size request is sent without the lock, so the opens of other files do not wait for it
+  std::unique_ptr<RangeSource> source( new CurlRangeSource( remoteUrl( uri ) ) );
+  if ( source->size() < 0 )
+    return nullptr;
+  std::shared_ptr<RemoteFile> file( new RemoteFile( std::move( source ), blockSize, cacheSize, readaheadBlocks ) );
+
+  std::lock_guard<std::mutex> lock( sMutex );
+  for ( const auto &kept : sKept )
+  {
+    if ( kept.first == key )
+      return kept.second; // opened by another thread meanwhile
+  }
+  sKept.emplace_front( key, file );
+  if ( sKept.size() > KEPT_FILES )
+    sKept.pop_back();
+  return file;
+#else
+  debug( "Remote files are not supported, MDAL is built without libcurl" );
+  return nullptr;
+#endif
+}
+
+uint64_t MDAL::RemoteFile::size() const
+{
+  return mSize;
+}
+
+const std::vector<char> *MDAL::RemoteFile::cachedBlock( uint64_t block )
+{
+  auto it = mIndex.find( block );
+  if ( it == mIndex.end() )
+    return nullptr;
+
+  mBlocks.splice( mBlocks.begin(), mBlocks, it->second );
+  return &it->second->second;
+}
+
+void MDAL::RemoteFile::insertBlock( uint64_t block, std::vector<char> &&data )
+{
+  if ( mMaximumBlocks == 0 || mIndex.count( block ) )
+    return;
+
+  mBlocks.emplace_front( block, std::move( data ) );
+  mIndex[block] = mBlocks.begin();
+  while ( mBlocks.size() > mMaximumBlocks )
+  {
+    mIndex.erase( mBlocks.back().first );
+    mBlocks.pop_back();
+  }
+}
+
+size_t MDAL::RemoteFile::read( uint64_t offset, size_t count, char *buffer )
+{
+  if ( offset >= mSize || count == 0 )
+    return 0;
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  count = static_cast<size_t>( std::min<uint64_t>( count, mSize - offset ) );
+  const uint64_t blocksCount = ( mSize + mBlockSize - 1 ) / mBlockSize;
+  const uint64_t firstBlock = offset / mBlockSize;
+  const uint64_t lastBlock = ( offset + count - 1 ) / mBlockSize;
+  const bool isSequential = firstBlock == mNextBlock || firstBlock + 1 == mNextBlock;
+
+  size_t copied = 0;
+  uint64_t block = firstBlock;
+  while ( block <= lastBlock )
+  {
+    const uint64_t blockStart = block * mBlockSize;
+    const size_t from = static_cast<size_t>( std::max( offset, blockStart ) - blockStart );
+
+    const std::vector<char> *cached = cachedBlock( block );
+    if ( cached )
+    {
+      const size_t bytes = std::min( cached->size() - std::min( from, cached->size() ), count - copied );
+      memcpy( buffer + copied, cached->data() + from, bytes );
+      copied += bytes;
+      ++block;
+      continue;
+    }
+
+    // fetch the run of missing blocks of the read, and the following ones for sequential reads, in one request
+    uint64_t end = block + 1;
+    while ( end <= lastBlock && !mIndex.count( end ) )
+      ++end;
+    if ( isSequential && end > lastBlock )
+    {
+      const uint64_t readaheadEnd = std::min( blocksCount, lastBlock + 1 + mReadaheadBlocks );
+      while ( end < readaheadEnd && !mIndex.count( end ) )
+        ++end;
+    }
+
+    const size_t fetchSize = static_cast<size_t>( std::min<uint64_t>( end * mBlockSize, mSize ) - blockStart );
+    std::vector<char> fetched( fetchSize );
+    const size_t fetchedSize = mSource->read( blockStart, fetchSize, fetched.data() );
+    ++mRangeRequests;
+    mFetchedBytes += static_cast<long long>( fetchedSize );
+
+    const size_t available = fetchedSize > from ? fetchedSize - from : 0;
+    const size_t bytes = std::min( available, count - copied );
+    memcpy( buffer + copied, fetched.data() + from, bytes );
+    copied += bytes;
+
+    // cache only the complete blocks, short read ends the read
+    for ( uint64_t b = block; b < end; ++b )
+    {
+      const size_t start = static_cast<size_t>( ( b - block ) * mBlockSize );
+      const size_t blockBytes = static_cast<size_t>( std::min<uint64_t>( mBlockSize, mSize - b * mBlockSize ) );
+      if ( start + blockBytes > fetchedSize )
+        break;
+      insertBlock( b, std::vector<char>( fetched.begin() + start, fetched.begin() + start + blockBytes ) );
+    }
+    if ( fetchedSize < fetchSize )
+      break;
+
+    block = std::min( end, lastBlock + 1 );
+  }
+
+  mNextBlock = lastBlock + 1;
+  return copied;
+}
+
+long long MDAL::RemoteFile::rangeRequests() const
+{
+  return mRangeRequests;
+}
+
+long long MDAL::RemoteFile::fetchedBytes() const
+{
+  return mFetchedBytes;
+}
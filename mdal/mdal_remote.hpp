@@ -0,0 +1,110 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_REMOTE_HPP
+#define MDAL_REMOTE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MDAL
+{
+  //! Whether the uri is a remote resource (http://, https:// or s3://)
+  bool isRemoteUri( const std::string &uri );
+
+  /**
+   * Returns the http(s) url of the remote uri
+   *
+   * s3://bucket/key is mapped to https://bucket.s3.amazonaws.com/key, or to
+   * endpoint/bucket/key when S3_ENDPOINT open option is set. Requests are not signed,
+   * so only the public objects are readable.
+   */
+  std::string remoteUrl( const std::string &uri );
+
+  //! Source of the byte ranges of a remote resource
+  class RangeSource
+  {
+    public:
+      virtual ~RangeSource();
+
+      //! Size of the resource in bytes, negative when it is not available
+      virtual int64_t size() = 0;
+
+      //! Reads count bytes from offset to the buffer, returns number of bytes read
+      virtual size_t read( uint64_t offset, size_t count, char *buffer ) = 0;
+  };
+
+  /**
+   * Read-only remote file read by byte ranges
+   *
+   * The ranges are fetched in blocks, kept in a least recently used cache up to the budget.
+   * When the reads continue where the previous one ended, the following blocks are fetched
+   * ahead in the same request, so the sequential reads do not pay the latency for each block.
+   */
+  class RemoteFile
+  {
+    public:
+      RemoteFile( std::unique_ptr<RangeSource> source, size_t blockSize, size_t maximumSize, size_t readaheadBlocks );
+      ~RemoteFile();
+
+      RemoteFile( const RemoteFile & ) = delete;
+      RemoteFile &operator=( const RemoteFile & ) = delete;
+
+      /**
+       * Opens the remote uri with REMOTE_BLOCK_SIZE, REMOTE_CACHE_SIZE and REMOTE_READAHEAD open options
+       *
+       * The file is shared by the opens of the same uri and options, the recently opened files are kept open
+       * after their last use, so the existence check, the format detection and the load of the file
+       * share the connection and the cached blocks and do not send the size request again.
+       * \returns null when the uri is not remote, not reachable or MDAL is built without libcurl
+       */
+      static std::shared_ptr<RemoteFile> open( const std::string &uri );
+
+      //! Number of the remote files kept open after their last use
+      static const size_t KEPT_FILES;
+
+      //! Size of the file in bytes
+      uint64_t size() const;
+
+      //! Reads count bytes from offset to the buffer, returns number of bytes read
+      size_t read( uint64_t offset, size_t count, char *buffer );
+
+      //! Number of range requests sent to the source
+      long long rangeRequests() const;
+
+      //! Number of bytes fetched from the source
+      long long fetchedBytes() const;
+
+    private:
+      typedef std::list<std::pair<uint64_t, std::vector<char>>> Blocks;
+
+      //! Returns cached block and marks it recently used, null when not cached
+      const std::vector<char> *cachedBlock( uint64_t block );
+      void insertBlock( uint64_t block, std::vector<char> &&data );
+
+      std::unique_ptr<RangeSource> mSource;
+      uint64_t mSize = 0;
+      size_t mBlockSize = 0;
+      size_t mMaximumBlocks = 0;
+      size_t mReadaheadBlocks = 0;
+
+      std::mutex mMutex;
+      //! most recently used first
+      Blocks mBlocks;
+      std::map<uint64_t, Blocks::iterator> mIndex;
+      //! Block following the last read, where the sequential read continues, none before the first read
+      uint64_t mNextBlock = std::numeric_limits<uint64_t>::max();
+      long long mRangeRequests = 0;
+      long long mFetchedBytes = 0;
+  };
+} // namespace MDAL
+#endif //MDAL_REMOTE_HPP
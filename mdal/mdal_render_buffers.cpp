@@ -0,0 +1,246 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_render_buffers.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+#include "mdal_memory_data_model.hpp"
+#include "mdal_parallel.hpp"
+
+//! Number of render vertices filled from one read of the dataset
+static const size_t BLOCK_ELEMENTS = 65536;
+//! Number of elements (faces or render vertices) processed by one parallel task
+static const size_t TASK_ELEMENTS = 2048;
+
+const uint16_t MDAL::RenderBuffers::NODATA_UINT16 = std::numeric_limits<uint16_t>::max();
+
+//! Fan-triangulates the faces to the index buffer, specialized for faces of N vertices
+struct TriangulationKernel
+{
+  TriangulationKernel( const MDAL::CompressedFaces &faces,
+                       const std::vector<size_t> &triangleOffsets,
+                       bool isFaceCorners,
+                       uint32_t *indices,
+                       uint32_t *cornerVertices,
+                       uint32_t *cornerFaces )
+    : faces( faces )
+    , triangleOffsets( triangleOffsets )
+    , isFaceCorners( isFaceCorners )
+    , indices( indices )
+    , cornerVertices( cornerVertices )
+    , cornerFaces( cornerFaces )
+  {}
+
+  template<size_t N>
+  void operator()( MDAL::FaceArity<N> )
+  {
+    const size_t facesCount = faces.size();
+    const size_t tasks = ( facesCount + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+    MDAL::parallelFor( tasks, [&]( size_t task )
+    {
+      const size_t end = std::min( facesCount, ( task + 1 ) * TASK_ELEMENTS );
+      for ( size_t f = task * TASK_ELEMENTS; f < end; ++f )
+      {
+        size_t count = 0;
+        const size_t start = faces.faceRange<N>( f, count );
+        if ( isFaceCorners )
+        {
+          for ( size_t i = 0; i < count; ++i )
+          {
+            cornerVertices[start + i] = static_cast<uint32_t>( faces.vertexIndexAt( start + i ) );
+            cornerFaces[start + i] = static_cast<uint32_t>( f );
+          }
+        }
+
+        // render vertex of the corner is the mesh vertex or the position of the corner
+        uint32_t *triangle = indices + 3 * triangleOffsets[f];
+        const uint32_t first = static_cast<uint32_t>( isFaceCorners ? start : faces.vertexIndexAt( start ) );
+        for ( size_t i = 1; i + 1 < count; ++i, triangle += 3 )
+        {
+          triangle[0] = first;
+          triangle[1] = static_cast<uint32_t>( isFaceCorners ? start + i : faces.vertexIndexAt( start + i ) );
+          triangle[2] = static_cast<uint32_t>( isFaceCorners ? start + i + 1 : faces.vertexIndexAt( start + i + 1 ) );
+        }
+      }
+    } );
+  }
+
+  const MDAL::CompressedFaces &faces;
+  const std::vector<size_t> &triangleOffsets;
+  bool isFaceCorners;
+  uint32_t *indices;
+  uint32_t *cornerVertices;
+  uint32_t *cornerFaces;
+};
+
+//! Reads all faces of the mesh that does not hold them in memory
+static void _readFaces( MDAL::Mesh &mesh, MDAL::CompressedFaces &faces )
+{
+  const size_t blockSize = 65536;
+  const size_t facesCount = mesh.facesCount();
+  std::vector<int> offsets( std::min( std::max( facesCount, size_t( 1 ) ), blockSize ) );
+  std::vector<int> indices( offsets.size() * std::max( mesh.faceVerticesMaximumCount(), size_t( 1 ) ) );
+  std::vector<size_t> face;
+  std::unique_ptr<MDAL::MeshFaceIterator> iterator = mesh.readFaces();
+  while ( faces.size() < facesCount )
+  {
+    const size_t count = iterator->next( offsets.size(), offsets.data(), indices.size(), indices.data() );
+    if ( count == 0 )
+      break;
+    for ( size_t i = 0; i < count; ++i )
+    {
+      const size_t start = i == 0 ? 0 : static_cast<size_t>( offsets[i - 1] );
+      face.assign( indices.begin() + static_cast<std::ptrdiff_t>( start ), indices.begin() + offsets[i] );
+      faces.addFace( face.data(), face.size() );
+    }
+  }
+}
+
+MDAL::RenderBuffers::RenderBuffers( MDAL::Mesh &mesh, MDAL_RenderVertices layout, double originX, double originY, double originZ )
+  : mMesh( &mesh )
+  , mLayout( layout )
+{
+  assert( mesh.verticesCount() <= std::numeric_limits<uint32_t>::max() );
+  assert( mesh.facesCount() <= std::numeric_limits<uint32_t>::max() );
+
+  // faces and vertices of memory meshes are used in place
+  MemoryMesh *memoryMesh = dynamic_cast<MemoryMesh *>( &mesh );
+  CompressedFaces readFaces;
+  std::vector<double> readX;
+  std::vector<double> readY;
+  std::vector<double> readZ;
+  const size_t verticesCount = mesh.verticesCount();
+  if ( !memoryMesh )
+  {
+    _readFaces( mesh, readFaces );
+    readX.assign( verticesCount, std::numeric_limits<double>::quiet_NaN() );
+    readY.assign( verticesCount, std::numeric_limits<double>::quiet_NaN() );
+    readZ.assign( verticesCount, std::numeric_limits<double>::quiet_NaN() );
+    mesh.vertexCoordinates( 0, verticesCount, readX.data(), readY.data(), readZ.data() );
+  }
+  const CompressedFaces &faces = memoryMesh ? memoryMesh->faces : readFaces;
+  const double *x = memoryMesh ? memoryMesh->vertices.x() : readX.data();
+  const double *y = memoryMesh ? memoryMesh->vertices.y() : readY.data();
+  const double *z = memoryMesh ? memoryMesh->vertices.z() : readZ.data();
+
+  const bool isFaceCorners = layout == MDAL_RenderVertices::RenderFaceCorners;
+  assert( !isFaceCorners || faces.indicesCount() <= std::numeric_limits<uint32_t>::max() );
+  std::vector<size_t> triangleOffsets( faces.size() + 1, 0 );
+  for ( size_t f = 0; f < faces.size(); ++f )
+  {
+    const size_t count = faces.faceVerticesCount( f );
+    triangleOffsets[f + 1] = triangleOffsets[f] + ( count > 2 ? count - 2 : 0 );
+  }
+
+  mIndices.resize( 3 * triangleOffsets.back() );
+  if ( isFaceCorners )
+  {
+    mCornerVertices.resize( faces.indicesCount() );
+    mCornerFaces.resize( faces.indicesCount() );
+  }
+  TriangulationKernel kernel( faces, triangleOffsets, isFaceCorners, mIndices.data(), mCornerVertices.data(), mCornerFaces.data() );
+  dispatchFaceArity( faces.uniformVerticesCount(), kernel );
+
+  // positions of the render vertices, corners with invalid vertex are NaN
+  const size_t renderVerticesCount = isFaceCorners ? mCornerVertices.size() : verticesCount;
+  mPositions.resize( 3 * renderVerticesCount );
+  const size_t tasks = ( renderVerticesCount + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+  parallelFor( tasks, [&]( size_t task )
+  {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const size_t end = std::min( renderVerticesCount, ( task + 1 ) * TASK_ELEMENTS );
+    for ( size_t i = task * TASK_ELEMENTS; i < end; ++i )
+    {
+      const size_t v = isFaceCorners ? mCornerVertices[i] : i;
+      float *position = mPositions.data() + 3 * i;
+      if ( v >= verticesCount )
+      {
+        position[0] = position[1] = position[2] = nan;
+        continue;
+      }
+      position[0] = static_cast<float>( x[v] - originX );
+      position[1] = static_cast<float>( y[v] - originY );
+      position[2] = static_cast<float>( z[v] - originZ );
+    }
+  } );
+}
+
+size_t MDAL::RenderBuffers::values( MDAL::Dataset &dataset, MDAL_RenderValueType type, double minimum, double maximum, void *buffer ) const
+{
+  const DatasetGroup *group = dataset.group();
+  const bool isFaceCorners = mLayout == MDAL_RenderVertices::RenderFaceCorners;
+  const bool isOnFaces = group->dataLocation() == MDAL_DataLocation::DataOnFaces2D;
+  if ( dataset.mesh() != mMesh || ( !isOnFaces && group->dataLocation() != MDAL_DataLocation::DataOnVertices2D ) ||
+       ( isOnFaces && !isFaceCorners ) )
+    return 0;
+
+  const size_t valuesPerElement = group->isScalar() ? 1 : 2;
+  const MDAL_DataType dataType = valuesPerElement == 1 ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const bool readActive = isFaceCorners && dataset.supportsActiveFlag();
+  const double scale = 65534 / ( maximum - minimum );
+  const size_t count = verticesCount();
+  std::vector<size_t> indices;
+  std::vector<double> values;
+  std::vector<int> active;
+  for ( size_t blockStart = 0; blockStart < count; blockStart += BLOCK_ELEMENTS )
+  {
+    const size_t blockCount = std::min( count - blockStart, BLOCK_ELEMENTS );
+    values.resize( valuesPerElement * blockCount );
+    active.assign( blockCount, 1 );
+    size_t read;
+    {
+      DatasetReadLock lock( &dataset );
+      if ( isFaceCorners )
+      {
+        const SpillVector<uint32_t> &elements = isOnFaces ? mCornerFaces : mCornerVertices;
+        indices.assign( elements.begin() + static_cast<std::ptrdiff_t>( blockStart ),
+                        elements.begin() + static_cast<std::ptrdiff_t>( blockStart + blockCount ) );
+        read = dataset.dataAtIndices( dataType, indices.data(), blockCount, values.data() );
+        if ( read == blockCount && readActive )
+        {
+          std::transform( mCornerFaces.begin() + static_cast<std::ptrdiff_t>( blockStart ),
+                          mCornerFaces.begin() + static_cast<std::ptrdiff_t>( blockStart + blockCount ),
+                          indices.begin(), []( uint32_t face ) { return static_cast<size_t>( face ); } );
+          read = dataset.dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, indices.data(), blockCount, active.data() );
+        }
+      }
+      else
+        read = dataset.data( dataType, blockStart, blockCount, values.data() );
+    }
+    if ( read != blockCount )
+      return 0;
+
+    const size_t tasks = ( blockCount + TASK_ELEMENTS - 1 ) / TASK_ELEMENTS;
+    parallelFor( tasks, [&]( size_t task )
+    {
+      const size_t end = std::min( blockCount, ( task + 1 ) * TASK_ELEMENTS );
+      for ( size_t i = task * TASK_ELEMENTS; i < end; ++i )
+      {
+        const double *value = values.data() + valuesPerElement * i;
+        double renderValue = valuesPerElement == 1 ? value[0] : std::sqrt( value[0] * value[0] + value[1] * value[1] );
+        if ( !active[i] )
+          renderValue = std::numeric_limits<double>::quiet_NaN();
+
+        if ( type == MDAL_RenderValueType::RenderFloat32 )
+        {
+          static_cast<float *>( buffer )[blockStart + i] = static_cast<float>( renderValue );
+          continue;
+        }
+
+        uint16_t quantized = NODATA_UINT16;
+        if ( !std::isnan( renderValue ) )
+          quantized = static_cast<uint16_t>( std::min( std::max( std::round( ( renderValue - minimum ) * scale ), 0.0 ), 65534.0 ) );
+        static_cast<uint16_t *>( buffer )[blockStart + i] = quantized;
+      }
+    } );
+  }
+  return count;
+}
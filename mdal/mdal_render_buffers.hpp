@@ -0,0 +1,70 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_RENDER_BUFFERS_HPP
+#define MDAL_RENDER_BUFFERS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mdal.h"
+#include "mdal_spill.hpp"
+
+namespace MDAL
+{
+  class Mesh;
+  class Dataset;
+
+  /**
+   * Vertex and triangle index buffers of 2D mesh for the upload to GPU, see MDAL_M_renderBuffers()
+   *
+   * Faces are fan-triangulated from their first vertex in parallel, triangles of face i follow the triangles
+   * of face i - 1. Positions are single precision relative to the origin, so the precision is kept for
+   * coordinates far from zero. Render vertices are either the vertices of the mesh, or the corners
+   * of the faces in the order of the faces, which carry the values on faces without interpolation.
+   * Faces of memory meshes are read directly, by kernels specialized for triangle and quad meshes.
+   * Vertex and face indices must fit into 32 bits.
+   */
+  class RenderBuffers
+  {
+    public:
+      RenderBuffers( Mesh &mesh, MDAL_RenderVertices layout, double originX, double originY, double originZ );
+
+      Mesh *mesh() const { return mMesh; }
+      MDAL_RenderVertices layout() const { return mLayout; }
+
+      size_t verticesCount() const { return mPositions.size() / 3; }
+      size_t trianglesCount() const { return mIndices.size() / 3; }
+
+      //! x, y, z of the render vertices relative to the origin
+      const float *positions() const { return mPositions.data(); }
+
+      //! Indices of the render vertices of the triangles, counter-clockwise for counter-clockwise faces
+      const uint32_t *indices() const { return mIndices.data(); }
+
+      /**
+       * Writes value of the dataset for each render vertex to the buffer, vectors as magnitudes
+       *
+       * Invalid values and values of inactive faces (face corners only) are NaN, or 65535 for
+       * UInt16 values, which map range minimum to maximum linearly to 0 to 65534.
+       * The dataset must be on vertices of the mesh, or on faces for face corners.
+       * \returns number of values written, 0 on error
+       */
+      size_t values( Dataset &dataset, MDAL_RenderValueType type, double minimum, double maximum, void *buffer ) const;
+
+      //! Value of UInt16 values for invalid values
+      static const uint16_t NODATA_UINT16;
+
+    private:
+      Mesh *mMesh = nullptr;
+      MDAL_RenderVertices mLayout;
+      SpillVector<float> mPositions;
+      SpillVector<uint32_t> mIndices;
+      //! Vertex and face of each face corner, empty for shared vertices
+      SpillVector<uint32_t> mCornerVertices;
+      SpillVector<uint32_t> mCornerFaces;
+  };
+} // namespace MDAL
+#endif //MDAL_RENDER_BUFFERS_HPP
@@ -0,0 +1,230 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_reorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "mdal_memory_data_model.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_utils.hpp"
+
+uint32_t MDAL::hilbertIndex( uint32_t x, uint32_t y )
+{
+  const uint32_t n = 1u << 16;
+  uint32_t d = 0;
+  for ( uint32_t s = n / 2; s > 0; s /= 2 )
+  {
+    const uint32_t rx = ( x & s ) > 0 ? 1 : 0;
+    const uint32_t ry = ( y & s ) > 0 ? 1 : 0;
+    d += s * s * ( ( 3 * rx ) ^ ry );
+
+    // rotate the quadrant, so the curve continues in the lower bits
+    if ( ry == 0 )
+    {
+      if ( rx == 1 )
+      {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap( x, y );
+    }
+  }
+  return d;
+}
+
+//! Maps the coordinate from [min, max] to the cells of the Hilbert curve grid
+static uint32_t _gridCell( double value, double min, double max )
+{
+  if ( !( max > min ) || std::isnan( value ) )
+    return 0;
+  const double cell = ( value - min ) / ( max - min ) * 65535.0;
+  return static_cast<uint32_t>( std::min( std::max( cell, 0.0 ), 65535.0 ) );
+}
+
+//! Returns indices sorted by the keys, ties keep the original order
+static MDAL::SpillVector<size_t> _sortedOrder( std::vector<std::pair<uint32_t, size_t>> &keys )
+{
+  std::sort( keys.begin(), keys.end() );
+  MDAL::SpillVector<size_t> order( keys.size() );
+  for ( size_t i = 0; i < keys.size(); ++i )
+    order[i] = keys[i].second;
+  return order;
+}
+
+static bool _isReorderable( const MDAL::DatasetGroup *group )
+{
+  return group->dataLocation() == MDAL_DataLocation::DataOnVertices2D ||
+         group->dataLocation() == MDAL_DataLocation::DataOnFaces2D;
+}
+
+bool MDAL::reorderMesh( MDAL::Mesh *mesh )
+{
+  MemoryMesh *memoryMesh = dynamic_cast<MemoryMesh *>( mesh );
+  if ( !memoryMesh || memoryMesh->isReordered() )
+    return false;
+
+  for ( const std::shared_ptr<DatasetGroup> &group : mesh->datasetGroups )
+  {
+    if ( !_isReorderable( group.get() ) )
+      return false;
+  }
+
+  const VertexArrays &vertices = memoryMesh->vertices;
+  const CompressedFaces &faces = memoryMesh->faces;
+  const size_t verticesCount = vertices.size();
+  const size_t facesCount = faces.size();
+  const BBox extent = mesh->extent();
+
+  // vertices by their position, faces by their centroid
+  std::vector<std::pair<uint32_t, size_t>> keys( verticesCount );
+  parallelFor( verticesCount, [&]( size_t i )
+  {
+    keys[i] = std::make_pair( hilbertIndex( _gridCell( vertices.x()[i], extent.minX, extent.maxX ),
+                                            _gridCell( vertices.y()[i], extent.minY, extent.maxY ) ), i );
+  } );
+  SpillVector<size_t> vertexOrder = _sortedOrder( keys );
+
+  keys.resize( facesCount );
+  parallelFor( facesCount, [&]( size_t i )
+  {
+    double x = 0;
+    double y = 0;
+    const size_t count = faces.faceVerticesCount( i );
+    for ( size_t j = 0; j < count; ++j )
+    {
+      const size_t vertexIndex = faces.vertexIndex( i, j );
+      x += vertices.x()[vertexIndex];
+      y += vertices.y()[vertexIndex];
+    }
+    if ( count > 0 )
+    {
+      x /= static_cast<double>( count );
+      y /= static_cast<double>( count );
+    }
+    keys[i] = std::make_pair( hilbertIndex( _gridCell( x, extent.minX, extent.maxX ),
+                                            _gridCell( y, extent.minY, extent.maxY ) ), i );
+  } );
+  SpillVector<size_t> faceOrder = _sortedOrder( keys );
+  keys = std::vector<std::pair<uint32_t, size_t>>();
+
+  // new position of each original vertex, to renumber the face vertices
+  SpillVector<size_t> newVertexIndex( verticesCount );
+  for ( size_t i = 0; i < verticesCount; ++i )
+    newVertexIndex[vertexOrder[i]] = i;
+
+  VertexArrays reorderedVertices;
+  reorderedVertices.resize( verticesCount );
+  for ( size_t i = 0; i < verticesCount; ++i )
+    reorderedVertices.setVertex( i, vertices[vertexOrder[i]] );
+
+  CompressedFaces reorderedFaces;
+  reorderedFaces.reserve( facesCount, faces.indicesCount() );
+  std::vector<size_t> face;
+  for ( size_t i = 0; i < facesCount; ++i )
+  {
+    const size_t originalFace = faceOrder[i];
+    face.resize( faces.faceVerticesCount( originalFace ) );
+    for ( size_t j = 0; j < face.size(); ++j )
+      face[j] = newVertexIndex[faces.vertexIndex( originalFace, j )];
+    reorderedFaces.addFace( face.data(), face.size() );
+  }
+
+  // edges read from the file reference the original vertices
+  std::vector<uint32_t> edges = mesh->fileEdges();
+  for ( uint32_t &vertexIndex : edges )
+    vertexIndex = static_cast<uint32_t>( newVertexIndex[vertexIndex] );
+  mesh->setFileEdges( std::move( edges ) );
+
+  memoryMesh->vertices = std::move( reorderedVertices );
+  memoryMesh->faces = std::move( reorderedFaces );
+  memoryMesh->vertexOrder.swap( vertexOrder );
+  memoryMesh->faceOrder.swap( faceOrder );
+
+  for ( const std::shared_ptr<DatasetGroup> &group : mesh->datasetGroups )
+    reorderDatasets( memoryMesh, group.get(), 0 );
+
+  return true;
+}
+
+//! Reads the dataset to memory dataset in the order of the reordered mesh
+static std::shared_ptr<MDAL::MemoryDataset2D> _reorderedCopy( MDAL::MemoryMesh *mesh, MDAL::DatasetGroup *group,
+    MDAL::Dataset *dataset, const size_t *valueOrder )
+{
+  const bool onVertices = group->dataLocation() == MDAL_DataLocation::DataOnVertices2D;
+  const bool hasActiveFlag = dataset->supportsActiveFlag();
+  std::shared_ptr<MDAL::MemoryDataset2D> copy = std::make_shared<MDAL::MemoryDataset2D>( group, hasActiveFlag && onVertices );
+  copy->setTime( dataset->time( MDAL::RelativeTimestamp::hours ) );
+
+  const size_t count = dataset->valuesCount();
+  const size_t components = group->isScalar() ? 1 : 2;
+  std::vector<double> values( components * count, std::numeric_limits<double>::quiet_NaN() );
+  if ( group->isScalar() )
+    dataset->scalarData( 0, count, values.data() );
+  else
+    dataset->vectorData( 0, count, values.data() );
+
+  std::vector<int> active;
+  if ( hasActiveFlag )
+  {
+    active.resize( mesh->facesCount(), 1 );
+    dataset->activeData( 0, active.size(), active.data() );
+  }
+
+  std::vector<double> reordered( values.size() );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    for ( size_t c = 0; c < components; ++c )
+      reordered[components * i + c] = values[components * valueOrder[i] + c];
+    // memory datasets on faces have no active flags, inactive faces have no value then
+    if ( hasActiveFlag && !onVertices && active[valueOrder[i]] == 0 )
+      std::fill( reordered.begin() + static_cast<std::ptrdiff_t>( components * i ),
+                 reordered.begin() + static_cast<std::ptrdiff_t>( components * ( i + 1 ) ),
+                 std::numeric_limits<double>::quiet_NaN() );
+  }
+  copy->setValues( reordered.data() );
+
+  if ( hasActiveFlag && onVertices )
+  {
+    std::vector<int> reorderedActive( active.size() );
+    for ( size_t i = 0; i < active.size(); ++i )
+      reorderedActive[i] = active[mesh->faceOrder[i]];
+    copy->setActive( reorderedActive.data() );
+  }
+
+  if ( dataset->hasStatistics() )
+    copy->setStatistics( dataset->statistics() );
+  return copy;
+}
+
+bool MDAL::reorderDatasets( MDAL::MemoryMesh *mesh, MDAL::DatasetGroup *group, size_t firstDataset )
+{
+  if ( !_isReorderable( group ) )
+    return false;
+
+  const size_t *valueOrder = group->dataLocation() == MDAL_DataLocation::DataOnVertices2D ?
+                             mesh->vertexOrder.data() : mesh->faceOrder.data();
+
+  // datasets backed by files are read with the library lock held, in memory ones in parallel
+  std::vector<MemoryDataset2D *> memoryDatasets;
+  for ( size_t i = firstDataset; i < group->datasets.size(); ++i )
+  {
+    MemoryDataset2D *memoryDataset = dynamic_cast<MemoryDataset2D *>( group->datasets[i].get() );
+    if ( memoryDataset )
+      memoryDatasets.push_back( memoryDataset );
+    else
+      group->datasets[i] = _reorderedCopy( mesh, group, group->datasets[i].get(), valueOrder );
+  }
+
+  parallelFor( memoryDatasets.size(), [&]( size_t i )
+  {
+    memoryDatasets[i]->reorder( valueOrder, mesh->faceOrder.data() );
+  } );
+  return true;
+}
@@ -0,0 +1,43 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_REORDER_HPP
+#define MDAL_REORDER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace MDAL
+{
+  class Mesh;
+  class MemoryMesh;
+  class DatasetGroup;
+
+  //! Returns position of the cell (x, y) of 65536 x 65536 grid on the Hilbert curve filling the grid
+  uint32_t hilbertIndex( uint32_t x, uint32_t y );
+
+  /**
+   * Sorts vertices and faces of the memory mesh along the Hilbert curve over the mesh extent
+   *
+   * Elements close in space get close indices, so kernels iterating faces and
+   * looking up their vertices hit the cache. The original indices are kept in
+   * MemoryMesh::vertexOrder and MemoryMesh::faceOrder and the datasets of the mesh
+   * are reordered too, see reorderDatasets().
+   *
+   * Returns false and keeps the mesh unchanged when it is not a MemoryMesh
+   * or has dataset groups on volumes
+   */
+  bool reorderMesh( Mesh *mesh );
+
+  /**
+   * Reorders datasets [firstDataset, datasetCount) of the group loaded for the reordered mesh
+   *
+   * Datasets held in memory are reordered in place, the other ones are read to memory.
+   * Returns false for groups on volumes, these cannot be reordered
+   */
+  bool reorderDatasets( MemoryMesh *mesh, DatasetGroup *group, size_t firstDataset );
+
+} // namespace MDAL
+#endif //MDAL_REORDER_HPP
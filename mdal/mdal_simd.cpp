@@ -0,0 +1,1154 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_simd.hpp"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#define MDAL_SIMD_SSE2
+#include <emmintrin.h>
+#if ( defined(__GNUC__) || defined(__clang__) ) && ( defined(__x86_64__) || defined(__i386__) )
+// AVX2 version is compiled with target attribute and chosen at runtime
+#define MDAL_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MDAL_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// NOTE: comparisons of the form ( v < min ) ? v : min are false for NaN, so NaN
+// values are skipped. This is also exactly the semantic of SSE/AVX minpd/maxpd
+// when the accumulator is the second operand and of NEON fminnm/fmaxnm.
+
+static const double sPositiveInf = std::numeric_limits<double>::infinity();
+static const double sNegativeInf = -std::numeric_limits<double>::infinity();
+
+static inline void _accumulate( double value, double &min, double &max )
+{
+  min = ( value < min ) ? value : min;
+  max = ( value > max ) ? value : max;
+}
+
+static bool _finish( double &min, double &max )
+{
+  // no valid value seen at all
+  if ( min == sPositiveInf && max == sNegativeInf )
+  {
+    min = std::numeric_limits<double>::quiet_NaN();
+    max = std::numeric_limits<double>::quiet_NaN();
+    return false;
+  }
+  return true;
+}
+
+static void _minMaxScalar( const double *values, size_t count, double &min, double &max )
+{
+  for ( size_t i = 0; i < count; ++i )
+    _accumulate( values[i], min, max );
+}
+
+static void _minMaxSquaredMagnitudeScalar( const double *xyValues, size_t count, double &min, double &max )
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const double x = xyValues[2 * i];
+    const double y = xyValues[2 * i + 1];
+    _accumulate( x * x + y * y, min, max );
+  }
+}
+
+static const double sNaN = std::numeric_limits<double>::quiet_NaN();
+static const double sEpsilon = std::numeric_limits<double>::epsilon();
+
+static void _subtractScalar( const double *a, const double *b, size_t count, double *result )
+{
+  for ( size_t i = 0; i < count; ++i )
+    result[i] = a[i] - b[i];
+}
+
+static void _joinScalar( const double *x, const double *y, size_t count, double *xyResult )
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const bool isValid = !std::isnan( x[i] ) && !std::isnan( y[i] );
+    xyResult[2 * i] = isValid ? x[i] : sNaN;
+    xyResult[2 * i + 1] = isValid ? y[i] : sNaN;
+  }
+}
+
+static void _flowVelocityScalar( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result )
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const double d = h[i] - z[i];
+    if ( std::fabs( d ) < sEpsilon )
+    {
+      result[i] = sNaN;
+      continue;
+    }
+    const double vx = qx[i] / d;
+    const double vy = qy[i] / d;
+    result[i] = std::sqrt( vx * vx + vy * vy );
+  }
+}
+
+static void _magnitudeScalar( const double *xyValues, size_t count, double *result )
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const double x = xyValues[2 * i];
+    const double y = xyValues[2 * i + 1];
+    result[i] = std::sqrt( x * x + y * y );
+  }
+}
+
+static void _accumulateTimeStepScalar( const double *values, size_t count, double time,
+                                       double *minimum, double *maximum, double *timeOfMaximum,
+                                       double *sum, double *validCount )
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const double value = values[i];
+    if ( maximum && value > maximum[i] )
+    {
+      maximum[i] = value;
+      if ( timeOfMaximum )
+        timeOfMaximum[i] = time;
+    }
+    if ( minimum && value < minimum[i] )
+      minimum[i] = value;
+    if ( !std::isnan( value ) )
+    {
+      if ( sum )
+        sum[i] += value;
+      validCount[i] += 1;
+    }
+  }
+}
+
+#if defined MDAL_SIMD_SSE2 || defined MDAL_SIMD_NEON
+//! Accumulator from the index, nullptr for the accumulator not used
+static double *_accumulatorAt( double *accumulator, size_t index )
+{
+  return accumulator ? accumulator + index : nullptr;
+}
+#endif
+
+static void _floatToDoubleScalar( const float *values, size_t count, double *result )
+{
+  for ( size_t i = 0; i < count; ++i )
+    result[i] = static_cast<double>( values[i] );
+}
+
+static void _byteSwapScalar( unsigned char *bytes, size_t valueSize, size_t count )
+{
+  for ( size_t i = 0; i < count; ++i )
+    std::reverse( bytes + i * valueSize, bytes + ( i + 1 ) * valueSize );
+}
+
+static void _packBitsScalar( const int *values, size_t count, unsigned char *bits )
+{
+  for ( size_t i = 0; i < count; i += 8 )
+  {
+    unsigned char byte = 0;
+    const size_t n = std::min( count - i, size_t( 8 ) );
+    for ( size_t j = 0; j < n; ++j )
+      byte |= static_cast<unsigned char>( ( values[i + j] != 0 ) << j );
+    bits[i / 8] = byte;
+  }
+}
+
+static void _unpackBitsScalar( const unsigned char *bits, size_t count, int *result )
+{
+  for ( size_t i = 0; i < count; ++i )
+    result[i] = ( bits[i / 8] >> ( i % 8 ) ) & 1;
+}
+
+static size_t _triangleSpanScalar( const double *edges, const double *steps, double base, double slope1, double slope2,
+                                   size_t first, size_t count, float *result )
+{
+  size_t covered = 0;
+  for ( size_t i = first; i < count; ++i )
+  {
+    const double position = static_cast<double>( i );
+    const double e0 = edges[0] + position * steps[0];
+    const double e1 = edges[1] + position * steps[1];
+    const double e2 = edges[2] + position * steps[2];
+    if ( e0 >= 0 && e1 >= 0 && e2 >= 0 )
+    {
+      result[i] = static_cast<float>( base + ( e1 * slope1 + e2 * slope2 ) );
+      ++covered;
+    }
+  }
+  return covered;
+}
+
+#ifdef MDAL_SIMD_SSE2
+static void _minMaxSSE2( const double *values, size_t count, double &min, double &max )
+{
+  __m128d vmin = _mm_set1_pd( min );
+  __m128d vmax = _mm_set1_pd( max );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const __m128d v = _mm_loadu_pd( values + i );
+    vmin = _mm_min_pd( v, vmin );
+    vmax = _mm_max_pd( v, vmax );
+  }
+  double mins[2], maxs[2];
+  _mm_storeu_pd( mins, vmin );
+  _mm_storeu_pd( maxs, vmax );
+  for ( size_t j = 0; j < 2; ++j )
+  {
+    min = ( mins[j] < min ) ? mins[j] : min;
+    max = ( maxs[j] > max ) ? maxs[j] : max;
+  }
+  _minMaxScalar( values + i, count - i, min, max );
+}
+
+static void _minMaxSquaredMagnitudeSSE2( const double *xyValues, size_t count, double &min, double &max )
+{
+  __m128d vmin = _mm_set1_pd( min );
+  __m128d vmax = _mm_set1_pd( max );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const __m128d a = _mm_loadu_pd( xyValues + 2 * i ); // x0, y0
+    const __m128d b = _mm_loadu_pd( xyValues + 2 * i + 2 ); // x1, y1
+    const __m128d a2 = _mm_mul_pd( a, a );
+    const __m128d b2 = _mm_mul_pd( b, b );
+    // x0^2 + y0^2, x1^2 + y1^2
+    const __m128d m = _mm_add_pd( _mm_unpacklo_pd( a2, b2 ), _mm_unpackhi_pd( a2, b2 ) );
+    vmin = _mm_min_pd( m, vmin );
+    vmax = _mm_max_pd( m, vmax );
+  }
+  double mins[2], maxs[2];
+  _mm_storeu_pd( mins, vmin );
+  _mm_storeu_pd( maxs, vmax );
+  for ( size_t j = 0; j < 2; ++j )
+  {
+    min = ( mins[j] < min ) ? mins[j] : min;
+    max = ( maxs[j] > max ) ? maxs[j] : max;
+  }
+  _minMaxSquaredMagnitudeScalar( xyValues + 2 * i, count - i, min, max );
+}
+
+static void _subtractSSE2( const double *a, const double *b, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+    _mm_storeu_pd( result + i, _mm_sub_pd( _mm_loadu_pd( a + i ), _mm_loadu_pd( b + i ) ) );
+  _subtractScalar( a + i, b + i, count - i, result + i );
+}
+
+static void _joinSSE2( const double *x, const double *y, size_t count, double *xyResult )
+{
+  const __m128d nan = _mm_set1_pd( sNaN );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    __m128d vx = _mm_loadu_pd( x + i );
+    __m128d vy = _mm_loadu_pd( y + i );
+    const __m128d isValid = _mm_cmpord_pd( vx, vy );
+    vx = _mm_or_pd( _mm_and_pd( isValid, vx ), _mm_andnot_pd( isValid, nan ) );
+    vy = _mm_or_pd( _mm_and_pd( isValid, vy ), _mm_andnot_pd( isValid, nan ) );
+    _mm_storeu_pd( xyResult + 2 * i, _mm_unpacklo_pd( vx, vy ) );
+    _mm_storeu_pd( xyResult + 2 * i + 2, _mm_unpackhi_pd( vx, vy ) );
+  }
+  _joinScalar( x + i, y + i, count - i, xyResult + 2 * i );
+}
+
+static void _flowVelocitySSE2( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result )
+{
+  const __m128d nan = _mm_set1_pd( sNaN );
+  const __m128d eps = _mm_set1_pd( sEpsilon );
+  const __m128d signMask = _mm_set1_pd( -0.0 );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const __m128d d = _mm_sub_pd( _mm_loadu_pd( h + i ), _mm_loadu_pd( z + i ) );
+    const __m128d vx = _mm_div_pd( _mm_loadu_pd( qx + i ), d );
+    const __m128d vy = _mm_div_pd( _mm_loadu_pd( qy + i ), d );
+    const __m128d v = _mm_sqrt_pd( _mm_add_pd( _mm_mul_pd( vx, vx ), _mm_mul_pd( vy, vy ) ) );
+    const __m128d isZero = _mm_cmplt_pd( _mm_andnot_pd( signMask, d ), eps );
+    _mm_storeu_pd( result + i, _mm_or_pd( _mm_andnot_pd( isZero, v ), _mm_and_pd( isZero, nan ) ) );
+  }
+  _flowVelocityScalar( qx + i, qy + i, h + i, z + i, count - i, result + i );
+}
+
+static void _magnitudeSSE2( const double *xyValues, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const __m128d a = _mm_loadu_pd( xyValues + 2 * i ); // x0, y0
+    const __m128d b = _mm_loadu_pd( xyValues + 2 * i + 2 ); // x1, y1
+    const __m128d x = _mm_unpacklo_pd( a, b );
+    const __m128d y = _mm_unpackhi_pd( a, b );
+    _mm_storeu_pd( result + i, _mm_sqrt_pd( _mm_add_pd( _mm_mul_pd( x, x ), _mm_mul_pd( y, y ) ) ) );
+  }
+  _magnitudeScalar( xyValues + 2 * i, count - i, result + i );
+}
+
+static void _accumulateTimeStepSSE2( const double *values, size_t count, double time,
+                                     double *minimum, double *maximum, double *timeOfMaximum,
+                                     double *sum, double *validCount )
+{
+  const __m128d t = _mm_set1_pd( time );
+  const __m128d one = _mm_set1_pd( 1.0 );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    // comparisons are false for NaN, so NaN values change nothing
+    const __m128d v = _mm_loadu_pd( values + i );
+    if ( maximum )
+    {
+      const __m128d max = _mm_loadu_pd( maximum + i );
+      const __m128d isGreater = _mm_cmpgt_pd( v, max );
+      _mm_storeu_pd( maximum + i, _mm_or_pd( _mm_and_pd( isGreater, v ), _mm_andnot_pd( isGreater, max ) ) );
+      if ( timeOfMaximum )
+      {
+        const __m128d tmax = _mm_loadu_pd( timeOfMaximum + i );
+        _mm_storeu_pd( timeOfMaximum + i, _mm_or_pd( _mm_and_pd( isGreater, t ), _mm_andnot_pd( isGreater, tmax ) ) );
+      }
+    }
+    if ( minimum )
+    {
+      const __m128d min = _mm_loadu_pd( minimum + i );
+      const __m128d isLess = _mm_cmplt_pd( v, min );
+      _mm_storeu_pd( minimum + i, _mm_or_pd( _mm_and_pd( isLess, v ), _mm_andnot_pd( isLess, min ) ) );
+    }
+    const __m128d isValid = _mm_cmpord_pd( v, v );
+    if ( sum )
+      _mm_storeu_pd( sum + i, _mm_add_pd( _mm_loadu_pd( sum + i ), _mm_and_pd( isValid, v ) ) );
+    _mm_storeu_pd( validCount + i, _mm_add_pd( _mm_loadu_pd( validCount + i ), _mm_and_pd( isValid, one ) ) );
+  }
+  _accumulateTimeStepScalar( values + i, count - i, time, _accumulatorAt( minimum, i ), _accumulatorAt( maximum, i ),
+                             _accumulatorAt( timeOfMaximum, i ), _accumulatorAt( sum, i ), validCount + i );
+}
+
+static void _floatToDoubleSSE2( const float *values, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const __m128 v = _mm_castsi128_ps( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( values + i ) ) );
+    _mm_storeu_pd( result + i, _mm_cvtps_pd( v ) );
+  }
+  _floatToDoubleScalar( values + i, count - i, result + i );
+}
+
+// SSE2 has no byte shuffle, bytes are swapped in 16-bit words and words are reordered
+template<size_t ValueSize>
+static void _byteSwapSSE2( unsigned char *bytes, size_t count )
+{
+  const size_t size = ValueSize * count;
+  size_t i = 0;
+  for ( ; i + 16 <= size; i += 16 )
+  {
+    __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i *>( bytes + i ) );
+    v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+    if ( ValueSize == 4 )
+      v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xB1 ), 0xB1 ); // 1, 0, 3, 2
+    else if ( ValueSize == 8 )
+      v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0x1B ), 0x1B ); // 3, 2, 1, 0
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( bytes + i ), v );
+  }
+  _byteSwapScalar( bytes + i, ValueSize, ( size - i ) / ValueSize );
+}
+
+static void _packBitsSSE2( const int *values, size_t count, unsigned char *bits )
+{
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const __m128i isZeroLow = _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i *>( values + i ) ), zero );
+    const __m128i isZeroHigh = _mm_cmpeq_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i *>( values + i + 4 ) ), zero );
+    const int zeroMask = _mm_movemask_ps( _mm_castsi128_ps( isZeroLow ) ) | ( _mm_movemask_ps( _mm_castsi128_ps( isZeroHigh ) ) << 4 );
+    bits[i / 8] = static_cast<unsigned char>( ~zeroMask );
+  }
+  _packBitsScalar( values + i, count - i, bits + i / 8 );
+}
+
+static void _unpackBitsSSE2( const unsigned char *bits, size_t count, int *result )
+{
+  const __m128i maskLow = _mm_setr_epi32( 1, 2, 4, 8 );
+  const __m128i maskHigh = _mm_setr_epi32( 16, 32, 64, 128 );
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const __m128i byte = _mm_set1_epi32( bits[i / 8] );
+    // all bits set where the bit is set, shifted to 1
+    const __m128i low = _mm_cmpeq_epi32( _mm_and_si128( byte, maskLow ), maskLow );
+    const __m128i high = _mm_cmpeq_epi32( _mm_and_si128( byte, maskHigh ), maskHigh );
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( result + i ), _mm_srli_epi32( low, 31 ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i *>( result + i + 4 ), _mm_srli_epi32( high, 31 ) );
+  }
+  _unpackBitsScalar( bits + i / 8, count - i, result + i );
+}
+
+static size_t _triangleSpanSSE2( const double *edges, const double *steps, double base, double slope1, double slope2,
+                                 size_t count, float *result )
+{
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d two = _mm_set1_pd( 2 );
+  const __m128d vbase = _mm_set1_pd( base );
+  const __m128d vslope1 = _mm_set1_pd( slope1 );
+  const __m128d vslope2 = _mm_set1_pd( slope2 );
+  __m128d position = _mm_setr_pd( 0, 1 );
+  size_t covered = 0;
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2, position = _mm_add_pd( position, two ) )
+  {
+    const __m128d e0 = _mm_add_pd( _mm_set1_pd( edges[0] ), _mm_mul_pd( position, _mm_set1_pd( steps[0] ) ) );
+    const __m128d e1 = _mm_add_pd( _mm_set1_pd( edges[1] ), _mm_mul_pd( position, _mm_set1_pd( steps[1] ) ) );
+    const __m128d e2 = _mm_add_pd( _mm_set1_pd( edges[2] ), _mm_mul_pd( position, _mm_set1_pd( steps[2] ) ) );
+    const __m128d inside = _mm_and_pd( _mm_cmpge_pd( e0, zero ), _mm_and_pd( _mm_cmpge_pd( e1, zero ), _mm_cmpge_pd( e2, zero ) ) );
+    const int mask = _mm_movemask_pd( inside );
+    if ( mask == 0 )
+      continue;
+
+    const __m128d value = _mm_add_pd( vbase, _mm_add_pd( _mm_mul_pd( e1, vslope1 ), _mm_mul_pd( e2, vslope2 ) ) );
+    float values[4];
+    _mm_storeu_ps( values, _mm_cvtpd_ps( value ) );
+    for ( int j = 0; j < 2; ++j )
+    {
+      if ( mask & ( 1 << j ) )
+      {
+        result[i + static_cast<size_t>( j )] = values[j];
+        ++covered;
+      }
+    }
+  }
+  return covered + _triangleSpanScalar( edges, steps, base, slope1, slope2, i, count, result );
+}
+#endif
+
+#ifdef MDAL_SIMD_AVX2
+__attribute__( ( target( "avx2" ) ) )
+static void _minMaxAVX2( const double *values, size_t count, double &min, double &max )
+{
+  __m256d vmin = _mm256_set1_pd( min );
+  __m256d vmax = _mm256_set1_pd( max );
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const __m256d v = _mm256_loadu_pd( values + i );
+    vmin = _mm256_min_pd( v, vmin );
+    vmax = _mm256_max_pd( v, vmax );
+  }
+  double mins[4], maxs[4];
+  _mm256_storeu_pd( mins, vmin );
+  _mm256_storeu_pd( maxs, vmax );
+  for ( size_t j = 0; j < 4; ++j )
+  {
+    min = ( mins[j] < min ) ? mins[j] : min;
+    max = ( maxs[j] > max ) ? maxs[j] : max;
+  }
+  _minMaxScalar( values + i, count - i, min, max );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _minMaxSquaredMagnitudeAVX2( const double *xyValues, size_t count, double &min, double &max )
+{
+  __m256d vmin = _mm256_set1_pd( min );
+  __m256d vmax = _mm256_set1_pd( max );
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const __m256d a = _mm256_loadu_pd( xyValues + 2 * i ); // x0, y0, x1, y1
+    const __m256d b = _mm256_loadu_pd( xyValues + 2 * i + 4 ); // x2, y2, x3, y3
+    // order of the magnitudes does not matter for min/max
+    const __m256d m = _mm256_hadd_pd( _mm256_mul_pd( a, a ), _mm256_mul_pd( b, b ) );
+    vmin = _mm256_min_pd( m, vmin );
+    vmax = _mm256_max_pd( m, vmax );
+  }
+  double mins[4], maxs[4];
+  _mm256_storeu_pd( mins, vmin );
+  _mm256_storeu_pd( maxs, vmax );
+  for ( size_t j = 0; j < 4; ++j )
+  {
+    min = ( mins[j] < min ) ? mins[j] : min;
+    max = ( maxs[j] > max ) ? maxs[j] : max;
+  }
+  _minMaxSquaredMagnitudeScalar( xyValues + 2 * i, count - i, min, max );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _subtractAVX2( const double *a, const double *b, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+    _mm256_storeu_pd( result + i, _mm256_sub_pd( _mm256_loadu_pd( a + i ), _mm256_loadu_pd( b + i ) ) );
+  _subtractScalar( a + i, b + i, count - i, result + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _joinAVX2( const double *x, const double *y, size_t count, double *xyResult )
+{
+  const __m256d nan = _mm256_set1_pd( sNaN );
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    __m256d vx = _mm256_loadu_pd( x + i );
+    __m256d vy = _mm256_loadu_pd( y + i );
+    const __m256d isValid = _mm256_cmp_pd( vx, vy, _CMP_ORD_Q );
+    vx = _mm256_blendv_pd( nan, vx, isValid );
+    vy = _mm256_blendv_pd( nan, vy, isValid );
+    const __m256d lo = _mm256_unpacklo_pd( vx, vy ); // x0, y0, x2, y2
+    const __m256d hi = _mm256_unpackhi_pd( vx, vy ); // x1, y1, x3, y3
+    _mm256_storeu_pd( xyResult + 2 * i, _mm256_permute2f128_pd( lo, hi, 0x20 ) );
+    _mm256_storeu_pd( xyResult + 2 * i + 4, _mm256_permute2f128_pd( lo, hi, 0x31 ) );
+  }
+  _joinScalar( x + i, y + i, count - i, xyResult + 2 * i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _flowVelocityAVX2( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result )
+{
+  const __m256d nan = _mm256_set1_pd( sNaN );
+  const __m256d eps = _mm256_set1_pd( sEpsilon );
+  const __m256d signMask = _mm256_set1_pd( -0.0 );
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const __m256d d = _mm256_sub_pd( _mm256_loadu_pd( h + i ), _mm256_loadu_pd( z + i ) );
+    const __m256d vx = _mm256_div_pd( _mm256_loadu_pd( qx + i ), d );
+    const __m256d vy = _mm256_div_pd( _mm256_loadu_pd( qy + i ), d );
+    const __m256d v = _mm256_sqrt_pd( _mm256_add_pd( _mm256_mul_pd( vx, vx ), _mm256_mul_pd( vy, vy ) ) );
+    const __m256d isZero = _mm256_cmp_pd( _mm256_andnot_pd( signMask, d ), eps, _CMP_LT_OQ );
+    _mm256_storeu_pd( result + i, _mm256_blendv_pd( v, nan, isZero ) );
+  }
+  _flowVelocityScalar( qx + i, qy + i, h + i, z + i, count - i, result + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _magnitudeAVX2( const double *xyValues, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const __m256d a = _mm256_loadu_pd( xyValues + 2 * i ); // x0, y0, x1, y1
+    const __m256d b = _mm256_loadu_pd( xyValues + 2 * i + 4 ); // x2, y2, x3, y3
+    // squared magnitudes in order 0, 2, 1, 3 are permuted back
+    const __m256d m = _mm256_hadd_pd( _mm256_mul_pd( a, a ), _mm256_mul_pd( b, b ) );
+    _mm256_storeu_pd( result + i, _mm256_sqrt_pd( _mm256_permute4x64_pd( m, 0xD8 ) ) );
+  }
+  _magnitudeScalar( xyValues + 2 * i, count - i, result + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _accumulateTimeStepAVX2( const double *values, size_t count, double time,
+                                     double *minimum, double *maximum, double *timeOfMaximum,
+                                     double *sum, double *validCount )
+{
+  const __m256d t = _mm256_set1_pd( time );
+  const __m256d one = _mm256_set1_pd( 1.0 );
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    const __m256d v = _mm256_loadu_pd( values + i );
+    if ( maximum )
+    {
+      const __m256d isGreater = _mm256_cmp_pd( v, _mm256_loadu_pd( maximum + i ), _CMP_GT_OQ );
+      _mm256_storeu_pd( maximum + i, _mm256_blendv_pd( _mm256_loadu_pd( maximum + i ), v, isGreater ) );
+      if ( timeOfMaximum )
+        _mm256_storeu_pd( timeOfMaximum + i, _mm256_blendv_pd( _mm256_loadu_pd( timeOfMaximum + i ), t, isGreater ) );
+    }
+    if ( minimum )
+    {
+      const __m256d isLess = _mm256_cmp_pd( v, _mm256_loadu_pd( minimum + i ), _CMP_LT_OQ );
+      _mm256_storeu_pd( minimum + i, _mm256_blendv_pd( _mm256_loadu_pd( minimum + i ), v, isLess ) );
+    }
+    const __m256d isValid = _mm256_cmp_pd( v, v, _CMP_ORD_Q );
+    if ( sum )
+      _mm256_storeu_pd( sum + i, _mm256_add_pd( _mm256_loadu_pd( sum + i ), _mm256_and_pd( isValid, v ) ) );
+    _mm256_storeu_pd( validCount + i, _mm256_add_pd( _mm256_loadu_pd( validCount + i ), _mm256_and_pd( isValid, one ) ) );
+  }
+  _accumulateTimeStepScalar( values + i, count - i, time, _accumulatorAt( minimum, i ), _accumulatorAt( maximum, i ),
+                             _accumulatorAt( timeOfMaximum, i ), _accumulatorAt( sum, i ), validCount + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _floatToDoubleAVX2( const float *values, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4 )
+    _mm256_storeu_pd( result + i, _mm256_cvtps_pd( _mm_loadu_ps( values + i ) ) );
+  _floatToDoubleScalar( values + i, count - i, result + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _byteSwapAVX2( unsigned char *bytes, size_t valueSize, size_t count )
+{
+  // shuffle within the 128-bit lanes reversing each group of valueSize bytes
+  char mask[32];
+  for ( size_t j = 0; j < 32; ++j )
+  {
+    const size_t laneByte = j % 16;
+    mask[j] = static_cast<char>( laneByte - laneByte % valueSize + valueSize - 1 - laneByte % valueSize );
+  }
+  const __m256i shuffle = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( mask ) );
+
+  const size_t size = valueSize * count;
+  size_t i = 0;
+  for ( ; i + 32 <= size; i += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i *>( bytes + i ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( bytes + i ), _mm256_shuffle_epi8( v, shuffle ) );
+  }
+  _byteSwapScalar( bytes + i, valueSize, ( size - i ) / valueSize );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _packBitsAVX2( const int *values, size_t count, unsigned char *bits )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const __m256i isZero = _mm256_cmpeq_epi32( _mm256_loadu_si256( reinterpret_cast<const __m256i *>( values + i ) ), zero );
+    bits[i / 8] = static_cast<unsigned char>( ~_mm256_movemask_ps( _mm256_castsi256_ps( isZero ) ) );
+  }
+  _packBitsScalar( values + i, count - i, bits + i / 8 );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static void _unpackBitsAVX2( const unsigned char *bits, size_t count, int *result )
+{
+  const __m256i mask = _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const __m256i isSet = _mm256_cmpeq_epi32( _mm256_and_si256( _mm256_set1_epi32( bits[i / 8] ), mask ), mask );
+    _mm256_storeu_si256( reinterpret_cast<__m256i *>( result + i ), _mm256_srli_epi32( isSet, 31 ) );
+  }
+  _unpackBitsScalar( bits + i / 8, count - i, result + i );
+}
+
+__attribute__( ( target( "avx2" ) ) )
+static size_t _triangleSpanAVX2( const double *edges, const double *steps, double base, double slope1, double slope2,
+                                 size_t count, float *result )
+{
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d four = _mm256_set1_pd( 4 );
+  const __m256d vbase = _mm256_set1_pd( base );
+  const __m256d vslope1 = _mm256_set1_pd( slope1 );
+  const __m256d vslope2 = _mm256_set1_pd( slope2 );
+  // lanes 0, 2, 4, 6 of the 64-bit mask hold the 32-bit mask of the floats
+  const __m256i lowHalves = _mm256_setr_epi32( 0, 2, 4, 6, 0, 0, 0, 0 );
+  __m256d position = _mm256_setr_pd( 0, 1, 2, 3 );
+  size_t covered = 0;
+  size_t i = 0;
+  for ( ; i + 4 <= count; i += 4, position = _mm256_add_pd( position, four ) )
+  {
+    const __m256d e0 = _mm256_add_pd( _mm256_set1_pd( edges[0] ), _mm256_mul_pd( position, _mm256_set1_pd( steps[0] ) ) );
+    const __m256d e1 = _mm256_add_pd( _mm256_set1_pd( edges[1] ), _mm256_mul_pd( position, _mm256_set1_pd( steps[1] ) ) );
+    const __m256d e2 = _mm256_add_pd( _mm256_set1_pd( edges[2] ), _mm256_mul_pd( position, _mm256_set1_pd( steps[2] ) ) );
+    const __m256d inside = _mm256_and_pd( _mm256_cmp_pd( e0, zero, _CMP_GE_OQ ),
+                                          _mm256_and_pd( _mm256_cmp_pd( e1, zero, _CMP_GE_OQ ), _mm256_cmp_pd( e2, zero, _CMP_GE_OQ ) ) );
+    const int mask = _mm256_movemask_pd( inside );
+    if ( mask == 0 )
+      continue;
+
+    const __m256d value = _mm256_add_pd( vbase, _mm256_add_pd( _mm256_mul_pd( e1, vslope1 ), _mm256_mul_pd( e2, vslope2 ) ) );
+    const __m128i floatMask = _mm256_castsi256_si128( _mm256_permutevar8x32_epi32( _mm256_castpd_si256( inside ), lowHalves ) );
+    _mm_maskstore_ps( result + i, floatMask, _mm256_cvtpd_ps( value ) );
+    covered += static_cast<size_t>( __builtin_popcount( static_cast<unsigned>( mask ) ) );
+  }
+  return covered + _triangleSpanScalar( edges, steps, base, slope1, slope2, i, count, result );
+}
+
+static bool _hasAVX2()
+{
+  static const bool sHasAVX2 = __builtin_cpu_supports( "avx2" );
+  return sHasAVX2;
+}
+#endif
+
+#ifdef MDAL_SIMD_NEON
+static void _minMaxNEON( const double *values, size_t count, double &min, double &max )
+{
+  float64x2_t vmin = vdupq_n_f64( min );
+  float64x2_t vmax = vdupq_n_f64( max );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2_t v = vld1q_f64( values + i );
+    vmin = vminnmq_f64( v, vmin );
+    vmax = vmaxnmq_f64( v, vmax );
+  }
+  min = vminvq_f64( vmin );
+  max = vmaxvq_f64( vmax );
+  _minMaxScalar( values + i, count - i, min, max );
+}
+
+static void _minMaxSquaredMagnitudeNEON( const double *xyValues, size_t count, double &min, double &max )
+{
+  float64x2_t vmin = vdupq_n_f64( min );
+  float64x2_t vmax = vdupq_n_f64( max );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2x2_t xy = vld2q_f64( xyValues + 2 * i ); // deinterleaved x and y
+    const float64x2_t m = vaddq_f64( vmulq_f64( xy.val[0], xy.val[0] ), vmulq_f64( xy.val[1], xy.val[1] ) );
+    vmin = vminnmq_f64( m, vmin );
+    vmax = vmaxnmq_f64( m, vmax );
+  }
+  min = vminvq_f64( vmin );
+  max = vmaxvq_f64( vmax );
+  _minMaxSquaredMagnitudeScalar( xyValues + 2 * i, count - i, min, max );
+}
+
+static void _subtractNEON( const double *a, const double *b, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+    vst1q_f64( result + i, vsubq_f64( vld1q_f64( a + i ), vld1q_f64( b + i ) ) );
+  _subtractScalar( a + i, b + i, count - i, result + i );
+}
+
+static void _joinNEON( const double *x, const double *y, size_t count, double *xyResult )
+{
+  const float64x2_t nan = vdupq_n_f64( sNaN );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2_t vx = vld1q_f64( x + i );
+    const float64x2_t vy = vld1q_f64( y + i );
+    const uint64x2_t isValid = vandq_u64( vceqq_f64( vx, vx ), vceqq_f64( vy, vy ) );
+    float64x2x2_t xy;
+    xy.val[0] = vbslq_f64( isValid, vx, nan );
+    xy.val[1] = vbslq_f64( isValid, vy, nan );
+    vst2q_f64( xyResult + 2 * i, xy ); // interleaved x and y
+  }
+  _joinScalar( x + i, y + i, count - i, xyResult + 2 * i );
+}
+
+static void _flowVelocityNEON( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result )
+{
+  const float64x2_t nan = vdupq_n_f64( sNaN );
+  const float64x2_t eps = vdupq_n_f64( sEpsilon );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2_t d = vsubq_f64( vld1q_f64( h + i ), vld1q_f64( z + i ) );
+    const float64x2_t vx = vdivq_f64( vld1q_f64( qx + i ), d );
+    const float64x2_t vy = vdivq_f64( vld1q_f64( qy + i ), d );
+    const float64x2_t v = vsqrtq_f64( vaddq_f64( vmulq_f64( vx, vx ), vmulq_f64( vy, vy ) ) );
+    vst1q_f64( result + i, vbslq_f64( vcltq_f64( vabsq_f64( d ), eps ), nan, v ) );
+  }
+  _flowVelocityScalar( qx + i, qy + i, h + i, z + i, count - i, result + i );
+}
+
+static void _magnitudeNEON( const double *xyValues, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2x2_t xy = vld2q_f64( xyValues + 2 * i ); // deinterleaved x and y
+    vst1q_f64( result + i, vsqrtq_f64( vaddq_f64( vmulq_f64( xy.val[0], xy.val[0] ), vmulq_f64( xy.val[1], xy.val[1] ) ) ) );
+  }
+  _magnitudeScalar( xyValues + 2 * i, count - i, result + i );
+}
+
+static void _accumulateTimeStepNEON( const double *values, size_t count, double time,
+                                     double *minimum, double *maximum, double *timeOfMaximum,
+                                     double *sum, double *validCount )
+{
+  const float64x2_t t = vdupq_n_f64( time );
+  const float64x2_t zero = vdupq_n_f64( 0.0 );
+  const float64x2_t one = vdupq_n_f64( 1.0 );
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+  {
+    const float64x2_t v = vld1q_f64( values + i );
+    if ( maximum )
+    {
+      const uint64x2_t isGreater = vcgtq_f64( v, vld1q_f64( maximum + i ) );
+      vst1q_f64( maximum + i, vbslq_f64( isGreater, v, vld1q_f64( maximum + i ) ) );
+      if ( timeOfMaximum )
+        vst1q_f64( timeOfMaximum + i, vbslq_f64( isGreater, t, vld1q_f64( timeOfMaximum + i ) ) );
+    }
+    if ( minimum )
+    {
+      const uint64x2_t isLess = vcltq_f64( v, vld1q_f64( minimum + i ) );
+      vst1q_f64( minimum + i, vbslq_f64( isLess, v, vld1q_f64( minimum + i ) ) );
+    }
+    const uint64x2_t isValid = vceqq_f64( v, v );
+    if ( sum )
+      vst1q_f64( sum + i, vaddq_f64( vld1q_f64( sum + i ), vbslq_f64( isValid, v, zero ) ) );
+    vst1q_f64( validCount + i, vaddq_f64( vld1q_f64( validCount + i ), vbslq_f64( isValid, one, zero ) ) );
+  }
+  _accumulateTimeStepScalar( values + i, count - i, time, _accumulatorAt( minimum, i ), _accumulatorAt( maximum, i ),
+                             _accumulatorAt( timeOfMaximum, i ), _accumulatorAt( sum, i ), validCount + i );
+}
+
+static void _floatToDoubleNEON( const float *values, size_t count, double *result )
+{
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2 )
+    vst1q_f64( result + i, vcvt_f64_f32( vld1_f32( values + i ) ) );
+  _floatToDoubleScalar( values + i, count - i, result + i );
+}
+
+static void _byteSwapNEON( unsigned char *bytes, size_t valueSize, size_t count )
+{
+  const size_t size = valueSize * count;
+  size_t i = 0;
+  for ( ; i + 16 <= size; i += 16 )
+  {
+    const uint8x16_t v = vld1q_u8( bytes + i );
+    vst1q_u8( bytes + i, valueSize == 2 ? vrev16q_u8( v ) : ( valueSize == 4 ? vrev32q_u8( v ) : vrev64q_u8( v ) ) );
+  }
+  _byteSwapScalar( bytes + i, valueSize, ( size - i ) / valueSize );
+}
+
+static void _packBitsNEON( const int *values, size_t count, unsigned char *bits )
+{
+  const uint32_t weightsLow[4] = {1, 2, 4, 8};
+  const uint32_t weightsHigh[4] = {16, 32, 64, 128};
+  const uint32x4_t low = vld1q_u32( weightsLow );
+  const uint32x4_t high = vld1q_u32( weightsHigh );
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const uint32x4_t a = vreinterpretq_u32_s32( vld1q_s32( values + i ) );
+    const uint32x4_t b = vreinterpretq_u32_s32( vld1q_s32( values + i + 4 ) );
+    // vtst sets all bits of the lanes that are not zero
+    const uint32_t byte = vaddvq_u32( vandq_u32( vtstq_u32( a, a ), low ) ) + vaddvq_u32( vandq_u32( vtstq_u32( b, b ), high ) );
+    bits[i / 8] = static_cast<unsigned char>( byte );
+  }
+  _packBitsScalar( values + i, count - i, bits + i / 8 );
+}
+
+static void _unpackBitsNEON( const unsigned char *bits, size_t count, int *result )
+{
+  const uint32_t weightsLow[4] = {1, 2, 4, 8};
+  const uint32_t weightsHigh[4] = {16, 32, 64, 128};
+  const uint32x4_t low = vld1q_u32( weightsLow );
+  const uint32x4_t high = vld1q_u32( weightsHigh );
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 )
+  {
+    const uint32x4_t byte = vdupq_n_u32( bits[i / 8] );
+    vst1q_s32( result + i, vreinterpretq_s32_u32( vshrq_n_u32( vtstq_u32( byte, low ), 31 ) ) );
+    vst1q_s32( result + i + 4, vreinterpretq_s32_u32( vshrq_n_u32( vtstq_u32( byte, high ), 31 ) ) );
+  }
+  _unpackBitsScalar( bits + i / 8, count - i, result + i );
+}
+
+static size_t _triangleSpanNEON( const double *edges, const double *steps, double base, double slope1, double slope2,
+                                 size_t count, float *result )
+{
+  const float64x2_t zero = vdupq_n_f64( 0 );
+  const float64x2_t two = vdupq_n_f64( 2 );
+  const double firstPositions[2] = {0, 1};
+  float64x2_t position = vld1q_f64( firstPositions );
+  size_t covered = 0;
+  size_t i = 0;
+  for ( ; i + 2 <= count; i += 2, position = vaddq_f64( position, two ) )
+  {
+    // no fused multiply-add, to give the same results as the scalar version
+    const float64x2_t e0 = vaddq_f64( vdupq_n_f64( edges[0] ), vmulq_f64( position, vdupq_n_f64( steps[0] ) ) );
+    const float64x2_t e1 = vaddq_f64( vdupq_n_f64( edges[1] ), vmulq_f64( position, vdupq_n_f64( steps[1] ) ) );
+    const float64x2_t e2 = vaddq_f64( vdupq_n_f64( edges[2] ), vmulq_f64( position, vdupq_n_f64( steps[2] ) ) );
+    const uint64x2_t inside = vandq_u64( vcgeq_f64( e0, zero ), vandq_u64( vcgeq_f64( e1, zero ), vcgeq_f64( e2, zero ) ) );
+    const float64x2_t value = vaddq_f64( vdupq_n_f64( base ),
+                                         vaddq_f64( vmulq_f64( e1, vdupq_n_f64( slope1 ) ), vmulq_f64( e2, vdupq_n_f64( slope2 ) ) ) );
+    if ( vgetq_lane_u64( inside, 0 ) )
+    {
+      result[i] = static_cast<float>( vgetq_lane_f64( value, 0 ) );
+      ++covered;
+    }
+    if ( vgetq_lane_u64( inside, 1 ) )
+    {
+      result[i + 1] = static_cast<float>( vgetq_lane_f64( value, 1 ) );
+      ++covered;
+    }
+  }
+  return covered + _triangleSpanScalar( edges, steps, base, slope1, slope2, i, count, result );
+}
+#endif
+
+const char *MDAL::simdInstructionSet()
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    return "AVX2";
+  return "SSE2";
+#elif defined MDAL_SIMD_SSE2
+  return "SSE2";
+#elif defined MDAL_SIMD_NEON
+  return "NEON";
+#else
+  return "None";
+#endif
+}
+
+bool MDAL::minMax( const double *values, size_t count, double &min, double &max )
+{
+  min = sPositiveInf;
+  max = sNegativeInf;
+
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _minMaxAVX2( values, count, min, max );
+  else
+    _minMaxSSE2( values, count, min, max );
+#elif defined MDAL_SIMD_SSE2
+  _minMaxSSE2( values, count, min, max );
+#elif defined MDAL_SIMD_NEON
+  _minMaxNEON( values, count, min, max );
+#else
+  _minMaxScalar( values, count, min, max );
+#endif
+
+  return _finish( min, max );
+}
+
+bool MDAL::minMaxSquaredMagnitude( const double *xyValues, size_t count, double &min, double &max )
+{
+  min = sPositiveInf;
+  max = sNegativeInf;
+
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _minMaxSquaredMagnitudeAVX2( xyValues, count, min, max );
+  else
+    _minMaxSquaredMagnitudeSSE2( xyValues, count, min, max );
+#elif defined MDAL_SIMD_SSE2
+  _minMaxSquaredMagnitudeSSE2( xyValues, count, min, max );
+#elif defined MDAL_SIMD_NEON
+  _minMaxSquaredMagnitudeNEON( xyValues, count, min, max );
+#else
+  _minMaxSquaredMagnitudeScalar( xyValues, count, min, max );
+#endif
+
+  return _finish( min, max );
+}
+
+void MDAL::subtract( const double *a, const double *b, size_t count, double *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _subtractAVX2( a, b, count, result );
+  else
+    _subtractSSE2( a, b, count, result );
+#elif defined MDAL_SIMD_SSE2
+  _subtractSSE2( a, b, count, result );
+#elif defined MDAL_SIMD_NEON
+  _subtractNEON( a, b, count, result );
+#else
+  _subtractScalar( a, b, count, result );
+#endif
+}
+
+void MDAL::join( const double *x, const double *y, size_t count, double *xyResult )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _joinAVX2( x, y, count, xyResult );
+  else
+    _joinSSE2( x, y, count, xyResult );
+#elif defined MDAL_SIMD_SSE2
+  _joinSSE2( x, y, count, xyResult );
+#elif defined MDAL_SIMD_NEON
+  _joinNEON( x, y, count, xyResult );
+#else
+  _joinScalar( x, y, count, xyResult );
+#endif
+}
+
+void MDAL::flowVelocity( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _flowVelocityAVX2( qx, qy, h, z, count, result );
+  else
+    _flowVelocitySSE2( qx, qy, h, z, count, result );
+#elif defined MDAL_SIMD_SSE2
+  _flowVelocitySSE2( qx, qy, h, z, count, result );
+#elif defined MDAL_SIMD_NEON
+  _flowVelocityNEON( qx, qy, h, z, count, result );
+#else
+  _flowVelocityScalar( qx, qy, h, z, count, result );
+#endif
+}
+
+void MDAL::magnitude( const double *xyValues, size_t count, double *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _magnitudeAVX2( xyValues, count, result );
+  else
+    _magnitudeSSE2( xyValues, count, result );
+#elif defined MDAL_SIMD_SSE2
+  _magnitudeSSE2( xyValues, count, result );
+#elif defined MDAL_SIMD_NEON
+  _magnitudeNEON( xyValues, count, result );
+#else
+  _magnitudeScalar( xyValues, count, result );
+#endif
+}
+
+void MDAL::accumulateTimeStep( const double *values, size_t count, double time,
+                               double *minimum, double *maximum, double *timeOfMaximum,
+                               double *sum, double *validCount )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _accumulateTimeStepAVX2( values, count, time, minimum, maximum, timeOfMaximum, sum, validCount );
+  else
+    _accumulateTimeStepSSE2( values, count, time, minimum, maximum, timeOfMaximum, sum, validCount );
+#elif defined MDAL_SIMD_SSE2
+  _accumulateTimeStepSSE2( values, count, time, minimum, maximum, timeOfMaximum, sum, validCount );
+#elif defined MDAL_SIMD_NEON
+  _accumulateTimeStepNEON( values, count, time, minimum, maximum, timeOfMaximum, sum, validCount );
+#else
+  _accumulateTimeStepScalar( values, count, time, minimum, maximum, timeOfMaximum, sum, validCount );
+#endif
+}
+
+void MDAL::floatToDouble( const float *values, size_t count, double *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _floatToDoubleAVX2( values, count, result );
+  else
+    _floatToDoubleSSE2( values, count, result );
+#elif defined MDAL_SIMD_SSE2
+  _floatToDoubleSSE2( values, count, result );
+#elif defined MDAL_SIMD_NEON
+  _floatToDoubleNEON( values, count, result );
+#else
+  _floatToDoubleScalar( values, count, result );
+#endif
+}
+
+void MDAL::byteSwap( void *values, size_t valueSize, size_t count )
+{
+  unsigned char *bytes = static_cast<unsigned char *>( values );
+  if ( valueSize != 2 && valueSize != 4 && valueSize != 8 )
+  {
+    _byteSwapScalar( bytes, valueSize, count );
+    return;
+  }
+
+#if defined MDAL_SIMD_SSE2
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+  {
+    _byteSwapAVX2( bytes, valueSize, count );
+    return;
+  }
+#endif
+  if ( valueSize == 2 )
+    _byteSwapSSE2<2>( bytes, count );
+  else if ( valueSize == 4 )
+    _byteSwapSSE2<4>( bytes, count );
+  else
+    _byteSwapSSE2<8>( bytes, count );
+#elif defined MDAL_SIMD_NEON
+  _byteSwapNEON( bytes, valueSize, count );
+#else
+  _byteSwapScalar( bytes, valueSize, count );
+#endif
+}
+
+void MDAL::packBits( const int *values, size_t count, unsigned char *bits )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _packBitsAVX2( values, count, bits );
+  else
+    _packBitsSSE2( values, count, bits );
+#elif defined MDAL_SIMD_SSE2
+  _packBitsSSE2( values, count, bits );
+#elif defined MDAL_SIMD_NEON
+  _packBitsNEON( values, count, bits );
+#else
+  _packBitsScalar( values, count, bits );
+#endif
+}
+
+void MDAL::unpackBits( const unsigned char *bits, size_t count, int *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    _unpackBitsAVX2( bits, count, result );
+  else
+    _unpackBitsSSE2( bits, count, result );
+#elif defined MDAL_SIMD_SSE2
+  _unpackBitsSSE2( bits, count, result );
+#elif defined MDAL_SIMD_NEON
+  _unpackBitsNEON( bits, count, result );
+#else
+  _unpackBitsScalar( bits, count, result );
+#endif
+}
+
+void MDAL::unpackBits( const unsigned char *bits, size_t start, size_t count, int *result )
+{
+  // flags up to the byte boundary one by one, then whole bytes are expanded
+  size_t i = 0;
+  for ( ; i < count && ( start + i ) % 8 != 0; ++i )
+    result[i] = ( bits[( start + i ) / 8] >> ( ( start + i ) % 8 ) ) & 1;
+  if ( i < count )
+    unpackBits( bits + ( start + i ) / 8, count - i, result + i );
+}
+
+void MDAL::copyBits( const unsigned char *bits, size_t bitsCount, size_t start, size_t count, unsigned char *result )
+{
+  if ( count == 0 )
+    return;
+
+  const size_t bytesCount = ( count + 7 ) / 8;
+  const size_t storedBytes = ( bitsCount + 7 ) / 8;
+  const size_t firstByte = start / 8;
+  const unsigned shift = start % 8;
+
+  if ( shift == 0 )
+  {
+    memcpy( result, bits + firstByte, bytesCount );
+  }
+  else
+  {
+    // each output byte is made of the end of one stored byte and the start of the next one
+    for ( size_t i = 0; i < bytesCount; ++i )
+    {
+      unsigned byte = bits[firstByte + i] >> shift;
+      if ( firstByte + i + 1 < storedBytes )
+        byte |= static_cast<unsigned>( bits[firstByte + i + 1] ) << ( 8 - shift );
+      result[i] = static_cast<unsigned char>( byte );
+    }
+  }
+
+  // unused bits of the last byte are zero
+  if ( count % 8 != 0 )
+    result[bytesCount - 1] &= static_cast<unsigned char>( ( 1 << ( count % 8 ) ) - 1 );
+}
+
+size_t MDAL::triangleSpan( const double *edges, const double *steps, double base, double slope1, double slope2,
+                           size_t count, float *result )
+{
+#if defined MDAL_SIMD_AVX2
+  if ( _hasAVX2() )
+    return _triangleSpanAVX2( edges, steps, base, slope1, slope2, count, result );
+  return _triangleSpanSSE2( edges, steps, base, slope1, slope2, count, result );
+#elif defined MDAL_SIMD_SSE2
+  return _triangleSpanSSE2( edges, steps, base, slope1, slope2, count, result );
+#elif defined MDAL_SIMD_NEON
+  return _triangleSpanNEON( edges, steps, base, slope1, slope2, count, result );
+#else
+  return _triangleSpanScalar( edges, steps, base, slope1, slope2, 0, count, result );
+#endif
+}
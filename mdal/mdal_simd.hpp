@@ -0,0 +1,106 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_SIMD_HPP
+#define MDAL_SIMD_HPP
+
+#include <stddef.h>
+
+/**
+ * Vectorized kernels for the hot loops
+ *
+ * The best available instruction set (AVX2 or SSE2 on x86, NEON on ARM64)
+ * is chosen at runtime, with scalar fallback for other platforms.
+ * All kernels give exactly the same results as their scalar versions.
+ */
+namespace MDAL
+{
+  //! Returns name of the instruction set used by the kernels, e.g. "AVX2"
+  const char *simdInstructionSet();
+
+  /**
+   * Finds minimum and maximum of the values, NaN values are skipped
+   * \returns false if there is no valid value (min and max are set to NaN)
+   */
+  bool minMax( const double *values, size_t count, double &min, double &max );
+
+  /**
+   * Finds minimum and maximum of the squared magnitudes (x * x + y * y)
+   * of the vectors stored as x1, y1, ..., xN, yN. Vectors with any NaN component are skipped
+   * \returns false if there is no valid value (min and max are set to NaN)
+   */
+  bool minMaxSquaredMagnitude( const double *xyValues, size_t count, double &min, double &max );
+
+  //! Sets result[i] = a[i] - b[i], result may be one of the inputs
+  void subtract( const double *a, const double *b, size_t count, double *result );
+
+  /**
+   * Interleaves x and y values to xyResult as x1, y1, ..., xN, yN
+   * Both components are NaN when any of them is NaN
+   */
+  void join( const double *x, const double *y, size_t count, double *xyResult );
+
+  /**
+   * Sets result[i] = sqrt( ( qx[i] / d )^2 + ( qy[i] / d )^2 ) where d = h[i] - z[i],
+   * i.e. magnitude of the velocity from the specific discharge and the water depth.
+   * Result is NaN when d is zero within the double precision epsilon
+   */
+  void flowVelocity( const double *qx, const double *qy, const double *h, const double *z, size_t count, double *result );
+
+  //! Sets result[i] = sqrt( x * x + y * y ) of the vectors stored as x1, y1, ..., xN, yN
+  void magnitude( const double *xyValues, size_t count, double *result );
+
+  /**
+   * Adds values of one time step at the time to the accumulators of the temporal aggregation
+   *
+   * For each valid value the minimum and maximum are updated, timeOfMaximum is set to the time
+   * when the maximum increases (so the first time of the maximum is kept), the value is added
+   * to sum and validCount is incremented. NaN values are skipped.
+   * minimum, maximum, timeOfMaximum and sum may be nullptr when not needed, timeOfMaximum requires maximum.
+   */
+  void accumulateTimeStep( const double *values, size_t count, double time,
+                           double *minimum, double *maximum, double *timeOfMaximum,
+                           double *sum, double *validCount );
+
+  //! Sets result[i] = values[i] converted to double
+  void floatToDouble( const float *values, size_t count, double *result );
+
+  /**
+   * Reverses the byte order of count values of valueSize bytes in place,
+   * values of 2, 4 and 8 bytes are vectorized
+   */
+  void byteSwap( void *values, size_t valueSize, size_t count );
+
+  /**
+   * Packs flags to bits, bit i % 8 of bits[i / 8] is set when values[i] is not zero
+   * Writes ( count + 7 ) / 8 bytes, unused bits of the last byte are zero
+   */
+  void packBits( const int *values, size_t count, unsigned char *bits );
+
+  //! Sets result[i] to bit i % 8 of bits[i / 8] (0 or 1)
+  void unpackBits( const unsigned char *bits, size_t count, int *result );
+
+  //! Sets result[i] to bit ( start + i ) % 8 of bits[( start + i ) / 8], start does not need to be a multiple of 8
+  void unpackBits( const unsigned char *bits, size_t start, size_t count, int *result );
+
+  /**
+   * Copies bits [start, start + count) of the array of bitsCount bits to the beginning of result
+   * Writes ( count + 7 ) / 8 bytes, unused bits of the last byte are zero
+   */
+  void copyBits( const unsigned char *bits, size_t bitsCount, size_t start, size_t count, unsigned char *result );
+
+  /**
+   * Rasterizes count pixels of a row of the triangle
+   *
+   * Edge function k of pixel i is edges[k] + i * steps[k], the pixel is covered by the triangle
+   * when all three are >= 0. Covered pixels are set to base + ( e1 * slope1 + e2 * slope2 )
+   * converted to float, the other pixels are kept.
+   * \returns number of covered pixels
+   */
+  size_t triangleSpan( const double *edges, const double *steps, double base, double slope1, double slope2,
+                       size_t count, float *result );
+
+} // namespace MDAL
+#endif //MDAL_SIMD_HPP
@@ -0,0 +1,281 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_sparse_dataset.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mdal_memory_data_model.hpp"
+#include "mdal_options.hpp"
+#include "mdal_utils.hpp"
+#include "mdal_simd.hpp"
+
+//! Number of values read from the dense dataset at once
+static const size_t BLOCK_VALUES = 4096;
+
+//! Reads count values starting at indexStart, components per index
+static size_t _readDense( MDAL::Dataset &dataset, bool isScalar, size_t indexStart, size_t count, double *buffer )
+{
+  return isScalar ? dataset.scalarData( indexStart, count, buffer ) : dataset.vectorData( indexStart, count, buffer );
+}
+
+static bool _hasAnyValue( const double *values, size_t components )
+{
+  for ( size_t c = 0; c < components; ++c )
+  {
+    if ( !std::isnan( values[c] ) )
+      return true;
+  }
+  return false;
+}
+
+MDAL::SparseDataset2D::SparseDataset2D( MDAL::Dataset &dense )
+  : Dataset2D( dense.group() )
+  , mArena( dense.mesh()->memoryArena() )
+  , mComponents( dense.group()->isScalar() ? 1 : 2 )
+  , mValues( SpillAllocator<double>( mArena.get() ) )
+  , mActive( SpillAllocator<unsigned char>( mArena.get() ) )
+{
+  setTime( dense.time( RelativeTimestamp::hours ) );
+  setSupportsActiveFlag( dense.supportsActiveFlag() );
+
+  const bool isScalar = mComponents == 1;
+  const size_t count = valuesCount();
+  std::vector<double> block( BLOCK_VALUES * mComponents );
+  size_t storedCount = 0;
+  bool isInRun = false;
+  for ( size_t start = 0; start < count; start += BLOCK_VALUES )
+  {
+    const size_t blockCount = _readDense( dense, isScalar, start, std::min( BLOCK_VALUES, count - start ), block.data() );
+    for ( size_t i = 0; i < blockCount; ++i )
+    {
+      const double *values = block.data() + i * mComponents;
+      const bool isStored = _hasAnyValue( values, mComponents );
+      if ( isStored )
+      {
+        if ( !isInRun )
+        {
+          mRunStarts.push_back( start + i );
+          mRunOffsets.push_back( storedCount );
+        }
+        mValues.insert( mValues.end(), values, values + mComponents );
+        ++storedCount;
+      }
+      isInRun = isStored;
+    }
+    // unreadable rest stays NaN
+    if ( blockCount < std::min( BLOCK_VALUES, count - start ) )
+      break;
+  }
+  mRunOffsets.push_back( storedCount );
+  mValues.shrink_to_fit();
+
+  if ( supportsActiveFlag() )
+  {
+    const size_t facesCount = mesh()->facesCount();
+    mActive.resize( ( facesCount + 7 ) / 8, 0 );
+    dense.activeDataBits( 0, facesCount, mActive.data() );
+  }
+
+  if ( dense.hasStatistics() )
+    setStatistics( dense.statistics() );
+}
+
+MDAL::SparseDataset2D::~SparseDataset2D() = default;
+
+size_t MDAL::SparseDataset2D::memoryUsage() const
+{
+  return ( mRunStarts.capacity() + mRunOffsets.capacity() ) * sizeof( size_t );
+}
+
+bool MDAL::SparseDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+size_t MDAL::SparseDataset2D::storedCount() const
+{
+  return mRunOffsets.back();
+}
+
+size_t MDAL::SparseDataset2D::findRun( size_t index ) const
+{
+  const std::vector<size_t>::const_iterator it = std::upper_bound( mRunStarts.begin(), mRunStarts.end(), index );
+  if ( it == mRunStarts.begin() )
+    return 0;
+
+  const size_t run = static_cast<size_t>( it - mRunStarts.begin() ) - 1;
+  const size_t runLength = mRunOffsets[run + 1] - mRunOffsets[run];
+  return index < mRunStarts[run] + runLength ? run : run + 1;
+}
+
+template <typename T>
+size_t MDAL::SparseDataset2D::readValues( size_t indexStart, size_t count, T *buffer ) const
+{
+  const size_t nValues = valuesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  const size_t end = indexStart + copyValues;
+  std::fill( buffer, buffer + copyValues * mComponents, std::numeric_limits<T>::quiet_NaN() );
+
+  for ( size_t run = findRun( indexStart ); run < mRunStarts.size() && mRunStarts[run] < end; ++run )
+  {
+    const size_t runStart = mRunStarts[run];
+    const size_t runEnd = runStart + mRunOffsets[run + 1] - mRunOffsets[run];
+    const size_t from = std::max( runStart, indexStart );
+    const size_t to = std::min( runEnd, end );
+    const double *input = mValues.data() + ( mRunOffsets[run] + from - runStart ) * mComponents;
+    T *output = buffer + ( from - indexStart ) * mComponents;
+    for ( size_t i = 0; i < ( to - from ) * mComponents; ++i )
+      output[i] = static_cast<T>( input[i] );
+  }
+  return copyValues;
+}
+
+size_t MDAL::SparseDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return readValues( indexStart, count, buffer );
+}
+
+size_t MDAL::SparseDataset2D::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return readValues( indexStart, count, buffer );
+}
+
+size_t MDAL::SparseDataset2D::scalarDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return readValues( indexStart, count, buffer );
+}
+
+size_t MDAL::SparseDataset2D::vectorDataFloat( size_t indexStart, size_t count, float *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return readValues( indexStart, count, buffer );
+}
+
+size_t MDAL::SparseDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  assert( supportsActiveFlag() );
+  const size_t nValues = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  MDAL::unpackBits( mActive.data(), indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+size_t MDAL::SparseDataset2D::activeDataBits( size_t indexStart, size_t count, unsigned char *buffer )
+{
+  assert( supportsActiveFlag() );
+  const size_t nValues = mesh()->facesCount();
+  if ( ( count < 1 ) || ( indexStart >= nValues ) )
+    return 0;
+
+  const size_t copyValues = std::min( nValues - indexStart, count );
+  MDAL::copyBits( mActive.data(), nValues, indexStart, copyValues, buffer );
+  return copyValues;
+}
+
+template <typename T>
+void MDAL::SparseDataset2D::gatherValues( const size_t *indices, size_t count, T *buffer ) const
+{
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const size_t run = findRun( indices[i] );
+    const bool isStored = run < mRunStarts.size() && mRunStarts[run] <= indices[i];
+    for ( size_t c = 0; c < mComponents; ++c )
+    {
+      buffer[mComponents * i + c] = isStored ?
+                                    static_cast<T>( mValues[( mRunOffsets[run] + indices[i] - mRunStarts[run] ) * mComponents + c] ) :
+                                    std::numeric_limits<T>::quiet_NaN();
+    }
+  }
+}
+
+size_t MDAL::SparseDataset2D::dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer )
+{
+  switch ( type )
+  {
+    case MDAL_DataType::SCALAR_DOUBLE:
+    case MDAL_DataType::VECTOR_2D_DOUBLE:
+      gatherValues( indices, count, static_cast<double *>( buffer ) );
+      return count;
+    case MDAL_DataType::SCALAR_FLOAT:
+    case MDAL_DataType::VECTOR_2D_FLOAT:
+      gatherValues( indices, count, static_cast<float *>( buffer ) );
+      return count;
+    case MDAL_DataType::ACTIVE_INTEGER:
+    {
+      int *flags = static_cast<int *>( buffer );
+      for ( size_t i = 0; i < count; ++i )
+        flags[i] = ( mActive[indices[i] / 8] >> ( indices[i] % 8 ) ) & 1;
+      return count;
+    }
+    default:
+      return 0;
+  }
+}
+
+size_t MDAL::SparseDataset2D::validIndices( size_t indexStart, size_t count, size_t *buffer )
+{
+  const size_t end = std::min( valuesCount(), indexStart + count );
+  size_t written = 0;
+  for ( size_t run = findRun( indexStart ); run < mRunStarts.size() && mRunStarts[run] < end; ++run )
+  {
+    const size_t runStart = mRunStarts[run];
+    const size_t runEnd = runStart + mRunOffsets[run + 1] - mRunOffsets[run];
+    for ( size_t index = std::max( runStart, indexStart ); index < std::min( runEnd, end ); ++index )
+    {
+      // runs hold vectors with any valid component
+      const double *values = mValues.data() + ( mRunOffsets[run] + index - runStart ) * mComponents;
+      if ( mComponents == 1 || ( !std::isnan( values[0] ) && !std::isnan( values[1] ) ) )
+        buffer[written++] = index;
+    }
+  }
+  return written;
+}
+
+double MDAL::sparseDatasetsFraction()
+{
+  const std::string fraction = openOption( OPTION_SPARSE_DATASETS );
+  if ( fraction.empty() )
+    return -1;
+  return toDouble( fraction );
+}
+
+std::shared_ptr<MDAL::Dataset> MDAL::sparseIfMostlyInvalid( const std::shared_ptr<MemoryDataset2D> &dataset, double maximumValidFraction )
+{
+  const size_t count = dataset->valuesCount();
+  if ( count == 0 )
+    return dataset;
+
+  const bool isScalar = dataset->group()->isScalar();
+  const size_t components = isScalar ? 1 : 2;
+  const size_t maximumStored = static_cast<size_t>( maximumValidFraction * static_cast<double>( count ) );
+  std::vector<double> block( BLOCK_VALUES * components );
+  size_t storedCount = 0;
+  for ( size_t start = 0; start < count && storedCount <= maximumStored; start += BLOCK_VALUES )
+  {
+    const size_t blockCount = _readDense( *dataset, isScalar, start, std::min( BLOCK_VALUES, count - start ), block.data() );
+    for ( size_t i = 0; i < blockCount; ++i )
+    {
+      if ( _hasAnyValue( block.data() + i * components, components ) )
+        ++storedCount;
+    }
+  }
+
+  if ( storedCount > maximumStored )
+    return dataset;
+  return std::make_shared<SparseDataset2D>( *dataset );
+}
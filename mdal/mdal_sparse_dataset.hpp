@@ -0,0 +1,85 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_SPARSE_DATASET_HPP
+#define MDAL_SPARSE_DATASET_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+#include "mdal_spill.hpp"
+
+namespace MDAL
+{
+  class MemoryDataset2D;
+
+  /**
+   * Dataset held in memory as the runs of valid values only
+   *
+   * Suits the results with most values NaN, e.g. dry faces of flood models: the runs
+   * of indices with any valid component are stored as their start and the values packed
+   * one after another, the rest is expanded to NaN on read. Active flags are kept as bits.
+   * Valid indices are listed from the runs, without reading the values.
+   */
+  class SparseDataset2D: public Dataset2D
+  {
+    public:
+      //! Copies values, active flags, time and statistics of the dense dataset, the caller is responsible for locking
+      explicit SparseDataset2D( Dataset &dense );
+      ~SparseDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t scalarDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+      size_t vectorDataFloat( size_t indexStart, size_t count, float *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+      size_t activeDataBits( size_t indexStart, size_t count, unsigned char *buffer ) override;
+      size_t dataAtIndices( MDAL_DataType type, const size_t *indices, size_t count, void *buffer ) override;
+      size_t validIndices( size_t indexStart, size_t count, size_t *buffer ) override;
+
+      //! Data are only copied from the memory
+      bool supportsConcurrentReads() const override;
+
+      //! Number of the indices stored in the runs
+      size_t storedCount() const;
+
+      //! Starts of the runs, the values and the active flags are in the memory arena of the mesh
+      size_t memoryUsage() const override;
+
+    private:
+      //! Returns index of the run containing index or the first run after it
+      size_t findRun( size_t index ) const;
+
+      //! Copies values of [indexStart, indexStart + count) to the buffer, NaN outside of the runs
+      template <typename T>
+      size_t readValues( size_t indexStart, size_t count, T *buffer ) const;
+
+      template <typename T>
+      void gatherValues( const size_t *indices, size_t count, T *buffer ) const;
+
+      //! Holds the arena until the arrays are freed, declared before them
+      std::shared_ptr<MemoryArena> mArena;
+      size_t mComponents = 1;
+      //! First index of each run
+      std::vector<size_t> mRunStarts;
+      //! Position of the first index of each run in the packed indices, with the total count at the end
+      std::vector<size_t> mRunOffsets;
+      //! Values of the indices of the runs, mComponents per index
+      SpillVector<double> mValues;
+      SpillVector<unsigned char> mActive;
+  };
+
+  //! Maximum fraction of valid values of the sparse datasets from SPARSE_DATASETS open option, negative when not set
+  double sparseDatasetsFraction();
+
+  /**
+   * Returns sparse copy of the dataset when the fraction of its indices with any valid
+   * component is at most maximumValidFraction, otherwise the dataset itself
+   */
+  std::shared_ptr<Dataset> sparseIfMostlyInvalid( const std::shared_ptr<MemoryDataset2D> &dataset, double maximumValidFraction );
+} // namespace MDAL
+#endif //MDAL_SPARSE_DATASET_HPP
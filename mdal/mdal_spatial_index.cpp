@@ -0,0 +1,822 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_spatial_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "mdal_memory_data_model.hpp"
+#include "mdal_regular_grid_mesh.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_reorder.hpp"
+
+const size_t MDAL::FaceSpatialIndex::NO_FACE;
+const size_t MDAL::HilbertRTree::NODE_SIZE;
+
+//! Computes bounding boxes of the faces as minX, minY, maxX, maxY, specialized for faces of N vertices
+struct FaceBoundsKernel
+{
+  FaceBoundsKernel( const MDAL::CompressedFaces &faces, const double *vx, const double *vy, double *bounds )
+    : faces( faces ), vx( vx ), vy( vy ), bounds( bounds )
+  {}
+
+  template<size_t N>
+  void operator()( MDAL::FaceArity<N> )
+  {
+    for ( size_t f = 0; f < faces.size(); ++f )
+    {
+      double *b = bounds + 4 * f;
+      b[0] = b[1] = std::numeric_limits<double>::max();
+      b[2] = b[3] = -std::numeric_limits<double>::max();
+      size_t count = 0;
+      const size_t start = faces.faceRange<N>( f, count );
+      for ( size_t i = 0; i < count; ++i )
+      {
+        const size_t v = faces.vertexIndexAt( start + i );
+        b[0] = std::min( b[0], vx[v] );
+        b[1] = std::min( b[1], vy[v] );
+        b[2] = std::max( b[2], vx[v] );
+        b[3] = std::max( b[3], vy[v] );
+      }
+    }
+  }
+
+  const MDAL::CompressedFaces &faces;
+  const double *vx;
+  const double *vy;
+  double *bounds;
+};
+
+MDAL::FaceSpatialIndex::FaceSpatialIndex( const MemoryMesh &mesh )
+  : mMesh( mesh )
+{
+  const CompressedFaces &faces = mesh.faces;
+  const size_t facesCount = faces.size();
+  const double *vx = mesh.vertices.x();
+  const double *vy = mesh.vertices.y();
+  if ( facesCount == 0 || mesh.vertices.empty() )
+    return;
+
+  // bounding boxes of the faces as minX, minY, maxX, maxY
+  std::vector<double> bounds( 4 * facesCount );
+  FaceBoundsKernel kernel( faces, vx, vy, bounds.data() );
+  dispatchFaceArity( faces.uniformVerticesCount(), kernel );
+
+  mMinX = mMinY = std::numeric_limits<double>::max();
+  mMaxX = mMaxY = -std::numeric_limits<double>::max();
+  for ( size_t f = 0; f < facesCount; ++f )
+  {
+    const double *b = &bounds[4 * f];
+    if ( b[0] > b[2] )
+      continue; // face without vertices
+
+    mMinX = std::min( mMinX, b[0] );
+    mMinY = std::min( mMinY, b[1] );
+    mMaxX = std::max( mMaxX, b[2] );
+    mMaxY = std::max( mMaxY, b[3] );
+  }
+
+  if ( mMinX > mMaxX )
+    return;
+
+  // roughly one face per cell
+  const double width = mMaxX - mMinX;
+  const double height = mMaxY - mMinY;
+  double cellSize = std::sqrt( width * height / static_cast<double>( facesCount ) );
+  if ( !( cellSize > 0 ) )
+    cellSize = std::max( width, height ) / static_cast<double>( facesCount );
+
+  if ( cellSize > 0 )
+  {
+    mColumns = std::min( static_cast<size_t>( width / cellSize ) + 1, facesCount );
+    mRows = std::min( static_cast<size_t>( height / cellSize ) + 1, facesCount );
+  }
+  else
+  {
+    mColumns = 1;
+    mRows = 1;
+  }
+  mCellWidth = width / static_cast<double>( mColumns );
+  mCellHeight = height / static_cast<double>( mRows );
+
+  // counting sort of the faces to the cells
+  mCellOffsets.assign( mColumns * mRows + 1, 0 );
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    for ( size_t f = 0; f < facesCount; ++f )
+    {
+      const double *b = &bounds[4 * f];
+      if ( b[0] > b[2] )
+        continue;
+
+      const size_t column0 = cellColumn( b[0] );
+      const size_t column1 = cellColumn( b[2] );
+      const size_t row0 = cellRow( b[1] );
+      const size_t row1 = cellRow( b[3] );
+      for ( size_t row = row0; row <= row1; ++row )
+      {
+        for ( size_t column = column0; column <= column1; ++column )
+        {
+          const size_t cell = row * mColumns + column;
+          if ( pass == 0 )
+            ++mCellOffsets[cell + 1];
+          else
+            mCellFaces[mCellOffsets[cell]++] = f;
+        }
+      }
+    }
+
+    if ( pass == 0 )
+    {
+      for ( size_t cell = 0; cell < mColumns * mRows; ++cell )
+        mCellOffsets[cell + 1] += mCellOffsets[cell];
+      mCellFaces.resize( mCellOffsets.back() );
+    }
+    else
+    {
+      // offsets were moved to the end of each cell by filling, shift them back
+      for ( size_t cell = mColumns * mRows; cell > 0; --cell )
+        mCellOffsets[cell] = mCellOffsets[cell - 1];
+      mCellOffsets[0] = 0;
+    }
+  }
+}
+
+size_t MDAL::FaceSpatialIndex::cellColumn( double x ) const
+{
+  if ( !( mCellWidth > 0 ) || x <= mMinX )
+    return 0;
+  return std::min( static_cast<size_t>( ( x - mMinX ) / mCellWidth ), mColumns - 1 );
+}
+
+size_t MDAL::FaceSpatialIndex::cellRow( double y ) const
+{
+  if ( !( mCellHeight > 0 ) || y <= mMinY )
+    return 0;
+  return std::min( static_cast<size_t>( ( y - mMinY ) / mCellHeight ), mRows - 1 );
+}
+
+size_t MDAL::FaceSpatialIndex::faceAt( double x, double y ) const
+{
+  if ( mColumns == 0 || !( x >= mMinX && x <= mMaxX && y >= mMinY && y <= mMaxY ) )
+    return NO_FACE;
+
+  const size_t cell = cellRow( y ) * mColumns + cellColumn( x );
+  for ( size_t i = mCellOffsets[cell]; i < mCellOffsets[cell + 1]; ++i )
+  {
+    if ( faceContains( mCellFaces[i], x, y ) )
+      return mCellFaces[i];
+  }
+
+  return NO_FACE;
+}
+
+bool MDAL::FaceSpatialIndex::faceContains( size_t faceIndex, double x, double y ) const
+{
+  const CompressedFaces &faces = mMesh.faces;
+  const double *vx = mMesh.vertices.x();
+  const double *vy = mMesh.vertices.y();
+  const size_t start = faces.faceOffset( faceIndex );
+  const size_t count = faces.faceVerticesCount( faceIndex );
+
+  // crossing number test
+  bool inside = false;
+  for ( size_t i = 0, j = count - 1; i < count; j = i++ )
+  {
+    const size_t vi = faces.vertexIndexAt( start + i );
+    const size_t vj = faces.vertexIndexAt( start + j );
+    if ( ( ( vy[vi] > y ) != ( vy[vj] > y ) ) &&
+         ( x < ( vx[vj] - vx[vi] ) * ( y - vy[vi] ) / ( vy[vj] - vy[vi] ) + vx[vi] ) )
+      inside = !inside;
+  }
+  return inside;
+}
+
+/**
+ * Finds triangle of the face fan containing the point and barycentric weights of its vertices
+ * For points on the edges or slightly outside due to rounding the closest triangle is used
+ * \param vx, vy coordinates of the count face vertices, in the face order
+ * \param triangle positions of the triangle vertices within the face
+ */
+static void _triangleWeights( const double *vx, const double *vy, size_t count, double x, double y,
+                              size_t *triangle, double *weights )
+{
+  triangle[0] = triangle[1] = triangle[2] = 0;
+  weights[0] = 1;
+  weights[1] = weights[2] = 0;
+
+  double bestMinWeight = -std::numeric_limits<double>::max();
+  for ( size_t j = 1; j + 1 < count; ++j )
+  {
+    const size_t v1 = 0;
+    const size_t v2 = j;
+    const size_t v3 = j + 1;
+    const double det = ( vy[v2] - vy[v3] ) * ( vx[v1] - vx[v3] ) + ( vx[v3] - vx[v2] ) * ( vy[v1] - vy[v3] );
+    if ( det == 0 )
+      continue;
+
+    const double l1 = ( ( vy[v2] - vy[v3] ) * ( x - vx[v3] ) + ( vx[v3] - vx[v2] ) * ( y - vy[v3] ) ) / det;
+    const double l2 = ( ( vy[v3] - vy[v1] ) * ( x - vx[v3] ) + ( vx[v1] - vx[v3] ) * ( y - vy[v3] ) ) / det;
+    const double l3 = 1 - l1 - l2;
+    const double minWeight = std::min( l1, std::min( l2, l3 ) );
+    if ( minWeight > bestMinWeight )
+    {
+      bestMinWeight = minWeight;
+      triangle[0] = v1;
+      triangle[1] = v2;
+      triangle[2] = v3;
+      weights[0] = l1;
+      weights[1] = l2;
+      weights[2] = l3;
+    }
+  }
+}
+
+namespace
+{
+  //! Face containing the sampled point and the vertices interpolated within it
+  struct PointSample
+  {
+    size_t face = MDAL::FaceSpatialIndex::NO_FACE;
+    size_t vertices[3] = {0, 0, 0};
+    double weights[3] = {1, 0, 0};
+  };
+}
+
+//! Finds the face containing the point and weights of the vertices, face is NO_FACE outside of the mesh
+static void _locatePoint( MDAL::Mesh &mesh, double x, double y, PointSample &sample )
+{
+  size_t faceVertices[4];
+  double vx[4];
+  double vy[4];
+  size_t count = 0;
+  std::vector<size_t> polygonVertices;
+  std::vector<double> polygonX;
+  std::vector<double> polygonY;
+  const size_t *vertices = faceVertices;
+  const double *verticesX = vx;
+  const double *verticesY = vy;
+
+  if ( MDAL::RegularGridMesh *grid = dynamic_cast<MDAL::RegularGridMesh *>( &mesh ) )
+  {
+    sample.face = grid->faceAt( x, y );
+    if ( sample.face == MDAL::RegularGridMesh::NO_FACE )
+      return;
+
+    count = 4;
+    grid->faceVertices( sample.face, faceVertices );
+    for ( size_t i = 0; i < count; ++i )
+      grid->vertex( faceVertices[i] % grid->columns(), faceVertices[i] / grid->columns(), vx[i], vy[i] );
+  }
+  else
+  {
+    MDAL::MemoryMesh *memoryMesh = static_cast<MDAL::MemoryMesh *>( &mesh );
+    sample.face = memoryMesh->spatialIndex().faceAt( x, y );
+    if ( sample.face == MDAL::FaceSpatialIndex::NO_FACE )
+      return;
+
+    const MDAL::CompressedFaces &faces = memoryMesh->faces;
+    count = faces.faceVerticesCount( sample.face );
+    polygonVertices.resize( count );
+    polygonX.resize( count );
+    polygonY.resize( count );
+    for ( size_t i = 0; i < count; ++i )
+    {
+      polygonVertices[i] = faces.vertexIndex( sample.face, i );
+      polygonX[i] = memoryMesh->vertices.x()[polygonVertices[i]];
+      polygonY[i] = memoryMesh->vertices.y()[polygonVertices[i]];
+    }
+    vertices = polygonVertices.data();
+    verticesX = polygonX.data();
+    verticesY = polygonY.data();
+  }
+
+  size_t triangle[3];
+  _triangleWeights( verticesX, verticesY, count, x, y, triangle, sample.weights );
+  for ( size_t k = 0; k < 3; ++k )
+    sample.vertices[k] = vertices[triangle[k]];
+}
+
+//! Samples the group in the face of the sample
+static size_t _sampleFace( MDAL::DatasetGroup &group, const PointSample &sample, double *buffer )
+{
+  const size_t datasetCount = group.datasets.size();
+  const size_t valuesPerIndex = group.isScalar() ? 1 : 2;
+  const size_t valuesCount = datasetCount * valuesPerIndex;
+
+  if ( group.dataLocation() == MDAL_DataLocation::DataOnFaces2D )
+  {
+    if ( group.dataBlock( 0, datasetCount, sample.face, 1, MDAL_DataBlockLayout::TimeMajor, buffer ) != datasetCount )
+      return 0;
+  }
+  else
+  {
+    // time series of the 3 vertices only
+    std::vector<double> values( valuesCount );
+    std::fill( buffer, buffer + valuesCount, 0.0 );
+    for ( size_t k = 0; k < 3; ++k )
+    {
+      if ( group.dataBlock( 0, datasetCount, sample.vertices[k], 1, MDAL_DataBlockLayout::TimeMajor, values.data() ) != datasetCount )
+        return 0;
+      for ( size_t i = 0; i < valuesCount; ++i )
+        buffer[i] += sample.weights[k] * values[i];
+    }
+  }
+
+  for ( size_t i = 0; i < datasetCount; ++i )
+  {
+    MDAL::Dataset *dataset = group.datasets[i].get();
+    if ( !dataset->supportsActiveFlag() )
+      continue;
+
+    int active = 1;
+    {
+      MDAL::DatasetReadLock lock( dataset );
+      if ( dataset->activeData( sample.face, 1, &active ) != 1 )
+        active = 1;
+    }
+    if ( !active )
+      std::fill( buffer + i * valuesPerIndex, buffer + ( i + 1 ) * valuesPerIndex, std::numeric_limits<double>::quiet_NaN() );
+  }
+
+  return datasetCount;
+}
+
+/**
+ * Reads the values of all datasets of the group needed by the samples, one gather per dataset,
+ * and writes the time series of each sample to the buffer, sample after sample
+ * With interpolate the values are weighted from the 3 vertices of the sample and samples
+ * without face are outside of the mesh, otherwise the value at the first vertex is taken.
+ * Values of samples in inactive faces and outside of the mesh are NaN
+ */
+static size_t _sampleAll( MDAL::DatasetGroup &group, const std::vector<PointSample> &samples, bool interpolate, double *buffer )
+{
+  const size_t datasetCount = group.datasets.size();
+  const size_t valuesPerIndex = group.isScalar() ? 1 : 2;
+  const size_t seriesSize = datasetCount * valuesPerIndex;
+  const MDAL_DataType type = group.isScalar() ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const size_t pointsPerSample = interpolate ? 3 : 1;
+
+  // every value or face is read once, even if shared by many samples
+  std::vector<size_t> valueIndices;
+  std::vector<size_t> faceIndices;
+  for ( const PointSample &sample : samples )
+  {
+    if ( interpolate && sample.face == MDAL::FaceSpatialIndex::NO_FACE )
+      continue;
+    valueIndices.insert( valueIndices.end(), sample.vertices, sample.vertices + pointsPerSample );
+    if ( sample.face != MDAL::FaceSpatialIndex::NO_FACE )
+      faceIndices.push_back( sample.face );
+  }
+  std::sort( valueIndices.begin(), valueIndices.end() );
+  valueIndices.erase( std::unique( valueIndices.begin(), valueIndices.end() ), valueIndices.end() );
+  std::sort( faceIndices.begin(), faceIndices.end() );
+  faceIndices.erase( std::unique( faceIndices.begin(), faceIndices.end() ), faceIndices.end() );
+
+  auto position = []( const std::vector<size_t> &indices, size_t index )
+  {
+    return static_cast<size_t>( std::lower_bound( indices.begin(), indices.end(), index ) - indices.begin() );
+  };
+
+  // datasets are processed concurrently, the lock serializes the drivers not supporting it
+  std::atomic<bool> failed( false );
+  MDAL::parallelFor( datasetCount, [&]( size_t i )
+  {
+    MDAL::Dataset *dataset = group.datasets[i].get();
+    std::vector<double> values( valueIndices.size() * valuesPerIndex );
+    std::vector<int> active;
+    {
+      MDAL::DatasetReadLock lock( dataset );
+      if ( !valueIndices.empty() &&
+           dataset->dataAtIndices( type, valueIndices.data(), valueIndices.size(), values.data() ) != valueIndices.size() )
+      {
+        failed = true;
+        return;
+      }
+      if ( dataset->supportsActiveFlag() && !faceIndices.empty() )
+      {
+        active.resize( faceIndices.size() );
+        if ( dataset->dataAtIndices( MDAL_DataType::ACTIVE_INTEGER, faceIndices.data(), faceIndices.size(), active.data() ) != active.size() )
+          active.clear();
+      }
+    }
+
+    for ( size_t s = 0; s < samples.size(); ++s )
+    {
+      const PointSample &sample = samples[s];
+      double *out = buffer + s * seriesSize + i * valuesPerIndex;
+      const bool outside = interpolate && sample.face == MDAL::FaceSpatialIndex::NO_FACE;
+      const bool inactive = !outside && !active.empty() && sample.face != MDAL::FaceSpatialIndex::NO_FACE &&
+                            active[position( faceIndices, sample.face )] == 0;
+      for ( size_t c = 0; c < valuesPerIndex; ++c )
+      {
+        if ( outside || inactive )
+        {
+          out[c] = std::numeric_limits<double>::quiet_NaN();
+          continue;
+        }
+        double value = 0;
+        for ( size_t k = 0; k < pointsPerSample; ++k )
+          value += sample.weights[k] * values[position( valueIndices, sample.vertices[k] ) * valuesPerIndex + c];
+        out[c] = value;
+      }
+    }
+  } );
+
+  return failed ? 0 : datasetCount;
+}
+
+bool MDAL::supportsPointSampling( const Mesh &mesh )
+{
+  return dynamic_cast<const MemoryMesh *>( &mesh ) || dynamic_cast<const RegularGridMesh *>( &mesh );
+}
+
+static bool _isSampledLocation( const MDAL::DatasetGroup &group )
+{
+  const MDAL_DataLocation location = group.dataLocation();
+  return location == MDAL_DataLocation::DataOnVertices2D || location == MDAL_DataLocation::DataOnFaces2D;
+}
+
+size_t MDAL::sampleTimeSeries( Mesh &mesh, DatasetGroup &group, double x, double y, double *buffer )
+{
+  if ( !_isSampledLocation( group ) || !supportsPointSampling( mesh ) )
+    return 0;
+
+  const size_t datasetCount = group.datasets.size();
+  if ( datasetCount == 0 )
+    return 0;
+
+  const size_t valuesPerIndex = group.isScalar() ? 1 : 2;
+  std::fill( buffer, buffer + datasetCount * valuesPerIndex, std::numeric_limits<double>::quiet_NaN() );
+
+  PointSample sample;
+  _locatePoint( mesh, x, y, sample );
+  if ( sample.face == FaceSpatialIndex::NO_FACE )
+    return datasetCount;
+
+  return _sampleFace( group, sample, buffer );
+}
+
+size_t MDAL::sampleTimeSeries( Mesh &mesh, DatasetGroup &group, size_t pointCount, const double *x, const double *y, double *buffer )
+{
+  if ( !_isSampledLocation( group ) || !supportsPointSampling( mesh ) || group.datasets.empty() )
+    return 0;
+
+  // the index is built before the parallel search
+  if ( MemoryMesh *memoryMesh = dynamic_cast<MemoryMesh *>( &mesh ) )
+    memoryMesh->spatialIndex();
+
+  const bool onFaces = group.dataLocation() == MDAL_DataLocation::DataOnFaces2D;
+  std::vector<PointSample> samples( pointCount );
+  parallelFor( pointCount, [&]( size_t i )
+  {
+    _locatePoint( mesh, x[i], y[i], samples[i] );
+    if ( onFaces )
+    {
+      samples[i].vertices[0] = samples[i].vertices[1] = samples[i].vertices[2] = samples[i].face;
+      samples[i].weights[0] = 1;
+      samples[i].weights[1] = samples[i].weights[2] = 0;
+    }
+  } );
+
+  return _sampleAll( group, samples, true, buffer );
+}
+
+size_t MDAL::timeSeriesAtIndices( DatasetGroup &group, size_t count, const size_t *indices, double *buffer )
+{
+  if ( !_isSampledLocation( group ) || group.datasets.empty() )
+    return 0;
+
+  const bool onFaces = group.dataLocation() == MDAL_DataLocation::DataOnFaces2D;
+  std::vector<PointSample> samples( count );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    samples[i].vertices[0] = indices[i];
+    if ( onFaces )
+      samples[i].face = indices[i];
+  }
+
+  return _sampleAll( group, samples, false, buffer );
+}
+
+static bool _intersects( const MDAL::BBox &a, const MDAL::BBox &b )
+{
+  return !( a.maxX < b.minX || a.minX > b.maxX || a.maxY < b.minY || a.minY > b.maxY );
+}
+
+static bool _isValid( const MDAL::BBox &box )
+{
+  return !std::isnan( box.minX ) && !std::isnan( box.maxX ) && !std::isnan( box.minY ) && !std::isnan( box.maxY );
+}
+
+//! Maps the coordinate from [min, max] to the cells of the Hilbert curve grid
+static uint32_t _hilbertCell( double value, double min, double max )
+{
+  if ( !( max > min ) )
+    return 0;
+  const double cell = ( value - min ) / ( max - min ) * 65535.0;
+  return static_cast<uint32_t>( std::min( std::max( cell, 0.0 ), 65535.0 ) );
+}
+
+MDAL::HilbertRTree::HilbertRTree( const std::vector<BBox> &boxes )
+{
+  BBox extent( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+               std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+  for ( const BBox &box : boxes )
+  {
+    if ( !_isValid( box ) )
+      continue;
+    extent.minX = std::min( extent.minX, box.minX );
+    extent.maxX = std::max( extent.maxX, box.maxX );
+    extent.minY = std::min( extent.minY, box.minY );
+    extent.maxY = std::max( extent.maxY, box.maxY );
+  }
+
+  // leaves sorted by the position of the box center on the curve
+  std::vector<std::pair<uint32_t, size_t>> keys;
+  keys.reserve( boxes.size() );
+  for ( size_t i = 0; i < boxes.size(); ++i )
+  {
+    const BBox &box = boxes[i];
+    if ( !_isValid( box ) )
+      continue;
+    const double x = ( box.minX + box.maxX ) / 2;
+    const double y = ( box.minY + box.maxY ) / 2;
+    keys.push_back( std::make_pair( hilbertIndex( _hilbertCell( x, extent.minX, extent.maxX ),
+                                    _hilbertCell( y, extent.minY, extent.maxY ) ), i ) );
+  }
+  std::sort( keys.begin(), keys.end() );
+
+  if ( keys.empty() )
+    return;
+
+  // the tree has about 1 / ( NODE_SIZE - 1 ) nodes more than the leaves
+  mNodes.reserve( keys.size() + keys.size() / ( NODE_SIZE - 1 ) + 1 );
+  mLeafBoxes.resize( keys.size() );
+  for ( size_t i = 0; i < keys.size(); ++i )
+  {
+    mLeafBoxes[i] = keys[i].second;
+    mNodes.push_back( boxes[keys[i].second] );
+  }
+
+  mLevelOffsets.push_back( 0 );
+  mLevelOffsets.push_back( mNodes.size() );
+  while ( mLevelOffsets.back() - mLevelOffsets[mLevelOffsets.size() - 2] > 1 )
+  {
+    const size_t levelStart = mLevelOffsets[mLevelOffsets.size() - 2];
+    const size_t levelEnd = mLevelOffsets.back();
+    for ( size_t first = levelStart; first < levelEnd; first += NODE_SIZE )
+    {
+      BBox node = mNodes[first];
+      for ( size_t child = first + 1; child < std::min( first + NODE_SIZE, levelEnd ); ++child )
+      {
+        node.minX = std::min( node.minX, mNodes[child].minX );
+        node.maxX = std::max( node.maxX, mNodes[child].maxX );
+        node.minY = std::min( node.minY, mNodes[child].minY );
+        node.maxY = std::max( node.maxY, mNodes[child].maxY );
+      }
+      mNodes.push_back( node );
+    }
+    mLevelOffsets.push_back( mNodes.size() );
+  }
+}
+
+std::vector<size_t> MDAL::HilbertRTree::search( const BBox &extent ) const
+{
+  std::vector<size_t> result;
+  if ( mNodes.empty() )
+    return result;
+
+  // nodes to visit as ( level, position within the level )
+  std::vector<std::pair<size_t, size_t>> stack;
+  stack.push_back( std::make_pair( mLevelOffsets.size() - 2, 0 ) );
+  while ( !stack.empty() )
+  {
+    const size_t level = stack.back().first;
+    const size_t node = stack.back().second;
+    stack.pop_back();
+    if ( !_intersects( mNodes[mLevelOffsets[level] + node], extent ) )
+      continue;
+
+    if ( level == 0 )
+    {
+      result.push_back( mLeafBoxes[node] );
+      continue;
+    }
+
+    const size_t childrenCount = mLevelOffsets[level] - mLevelOffsets[level - 1];
+    for ( size_t child = node * NODE_SIZE; child < std::min( ( node + 1 ) * NODE_SIZE, childrenCount ); ++child )
+      stack.push_back( std::make_pair( level - 1, child ) );
+  }
+
+  std::sort( result.begin(), result.end() );
+  return result;
+}
+
+//! Reads x and y coordinates of all vertices
+static void _vertexCoordinates( MDAL::Mesh &mesh, std::vector<double> &x, std::vector<double> &y )
+{
+  const size_t count = mesh.verticesCount();
+  x.assign( count, std::numeric_limits<double>::quiet_NaN() );
+  y.assign( count, std::numeric_limits<double>::quiet_NaN() );
+  mesh.vertexCoordinates( 0, count, x.data(), y.data(), nullptr );
+}
+
+/**
+ * Reads all faces of the mesh in blocks, calls function( faceIndex, vertices, count ) for each face
+ * Faces of memory meshes are accessed directly
+ */
+template<typename Function>
+static void _forEachFace( MDAL::Mesh &mesh, Function function )
+{
+  if ( MDAL::MemoryMesh *memoryMesh = dynamic_cast<MDAL::MemoryMesh *>( &mesh ) )
+  {
+    const MDAL::CompressedFaces &faces = memoryMesh->faces;
+    std::vector<int> vertices;
+    for ( size_t f = 0; f < faces.size(); ++f )
+    {
+      vertices.resize( faces.faceVerticesCount( f ) );
+      for ( size_t i = 0; i < vertices.size(); ++i )
+        vertices[i] = static_cast<int>( faces.vertexIndex( f, i ) );
+      function( f, vertices.data(), vertices.size() );
+    }
+    return;
+  }
+
+  const size_t blockSize = 65536;
+  const size_t facesCount = mesh.facesCount();
+  std::vector<int> offsets( std::min( std::max( facesCount, size_t( 1 ) ), blockSize ) );
+  std::vector<int> indices( offsets.size() * std::max( mesh.faceVerticesMaximumCount(), size_t( 1 ) ) );
+  std::unique_ptr<MDAL::MeshFaceIterator> iterator = mesh.readFaces();
+  size_t faceIndex = 0;
+  while ( faceIndex < facesCount )
+  {
+    const size_t count = iterator->next( offsets.size(), offsets.data(), indices.size(), indices.data() );
+    if ( count == 0 )
+      break;
+    for ( size_t i = 0; i < count; ++i, ++faceIndex )
+    {
+      const size_t start = i == 0 ? 0 : static_cast<size_t>( offsets[i - 1] );
+      function( faceIndex, indices.data() + start, static_cast<size_t>( offsets[i] ) - start );
+    }
+  }
+}
+
+std::unique_ptr<MDAL::HilbertRTree> MDAL::buildFaceTree( Mesh &mesh )
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  _vertexCoordinates( mesh, x, y );
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<BBox> boxes( mesh.facesCount(), BBox( nan, nan, nan, nan ) );
+  _forEachFace( mesh, [&]( size_t faceIndex, const int *vertices, size_t count )
+  {
+    if ( faceIndex >= boxes.size() || count == 0 )
+      return;
+    BBox box( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+              std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+    for ( size_t i = 0; i < count; ++i )
+    {
+      // faces with invalid vertices are not indexed
+      if ( vertices[i] < 0 || static_cast<size_t>( vertices[i] ) >= x.size() )
+        return;
+      const size_t v = static_cast<size_t>( vertices[i] );
+      box.minX = std::min( box.minX, x[v] );
+      box.maxX = std::max( box.maxX, x[v] );
+      box.minY = std::min( box.minY, y[v] );
+      box.maxY = std::max( box.maxY, y[v] );
+    }
+    boxes[faceIndex] = box;
+  } );
+  return std::unique_ptr<HilbertRTree>( new HilbertRTree( boxes ) );
+}
+
+std::unique_ptr<MDAL::HilbertRTree> MDAL::buildVertexTree( Mesh &mesh )
+{
+  std::vector<double> x;
+  std::vector<double> y;
+  _vertexCoordinates( mesh, x, y );
+
+  std::vector<BBox> boxes( x.size() );
+  for ( size_t i = 0; i < x.size(); ++i )
+    boxes[i] = BBox( x[i], x[i], y[i], y[i] );
+  return std::unique_ptr<HilbertRTree>( new HilbertRTree( boxes ) );
+}
+
+MDAL::SelectedFacesIterator::SelectedFacesIterator( Mesh &mesh, std::vector<size_t> faceIndices )
+  : mFaceIndices( std::move( faceIndices ) )
+{
+  mOffsets.reserve( mFaceIndices.size() + 1 );
+  mOffsets.push_back( 0 );
+  size_t next = 0;
+
+  // faces of memory meshes are copied directly, only the selected ones
+  if ( MDAL::MemoryMesh *memoryMesh = dynamic_cast<MDAL::MemoryMesh *>( &mesh ) )
+  {
+    const MDAL::CompressedFaces &faces = memoryMesh->faces;
+    for ( ; next < mFaceIndices.size() && mFaceIndices[next] < faces.size(); ++next )
+    {
+      size_t count = 0;
+      const size_t start = faces.faceRange<0>( mFaceIndices[next], count );
+      for ( size_t i = 0; i < count; ++i )
+        mVertices.push_back( static_cast<int>( faces.vertexIndexAt( start + i ) ) );
+      mOffsets.push_back( mVertices.size() );
+    }
+    mFaceIndices.resize( next );
+    return;
+  }
+
+  // other meshes are read in order up to the last selected face, indices are in ascending order
+  if ( mFaceIndices.empty() )
+    return;
+  const size_t blockSize = 65536;
+  const size_t facesCount = std::min( mesh.facesCount(), mFaceIndices.back() + 1 );
+  std::vector<int> offsets( std::min( std::max( facesCount, size_t( 1 ) ), blockSize ) );
+  std::vector<int> indices( offsets.size() * std::max( mesh.faceVerticesMaximumCount(), size_t( 1 ) ) );
+  std::unique_ptr<MDAL::MeshFaceIterator> iterator = mesh.readFaces();
+  size_t faceIndex = 0;
+  while ( faceIndex < facesCount && next < mFaceIndices.size() )
+  {
+    const size_t count = iterator->next( std::min( offsets.size(), facesCount - faceIndex ), offsets.data(), indices.size(), indices.data() );
+    if ( count == 0 )
+      break;
+    for ( size_t i = 0; i < count; ++i, ++faceIndex )
+    {
+      if ( next >= mFaceIndices.size() || mFaceIndices[next] != faceIndex )
+        continue;
+      const size_t start = i == 0 ? 0 : static_cast<size_t>( offsets[i - 1] );
+      mVertices.insert( mVertices.end(), indices.data() + start, indices.data() + offsets[i] );
+      mOffsets.push_back( mVertices.size() );
+      ++next;
+    }
+  }
+  mFaceIndices.resize( next );
+}
+
+size_t MDAL::SelectedFacesIterator::next( size_t faceOffsetsBufferLen,
+    int *faceOffsetsBuffer,
+    size_t vertexIndicesBufferLen,
+    int *vertexIndicesBuffer )
+{
+  size_t faceCount = 0;
+  size_t vertexCount = 0;
+  while ( mPosition < mFaceIndices.size() && faceCount < faceOffsetsBufferLen )
+  {
+    const size_t count = mOffsets[mPosition + 1] - mOffsets[mPosition];
+    if ( vertexCount + count > vertexIndicesBufferLen )
+      break;
+
+    std::copy( mVertices.begin() + static_cast<std::ptrdiff_t>( mOffsets[mPosition] ),
+               mVertices.begin() + static_cast<std::ptrdiff_t>( mOffsets[mPosition + 1] ),
+               vertexIndicesBuffer + vertexCount );
+    vertexCount += count;
+    faceOffsetsBuffer[faceCount] = static_cast<int>( vertexCount );
+    ++faceCount;
+    ++mPosition;
+  }
+  return faceCount;
+}
+
+MDAL::SelectedVerticesIterator::SelectedVerticesIterator( Mesh &mesh, std::vector<size_t> vertexIndices )
+  : mVertexIndices( std::move( vertexIndices ) )
+{
+  mCoordinates.resize( 3 * mVertexIndices.size() );
+  std::vector<double> x( 1 );
+  std::vector<double> y( 1 );
+  std::vector<double> z( 1 );
+  size_t i = 0;
+  while ( i < mVertexIndices.size() )
+  {
+    // consecutive vertices are read at once
+    size_t runEnd = i + 1;
+    while ( runEnd < mVertexIndices.size() && mVertexIndices[runEnd] == mVertexIndices[runEnd - 1] + 1 )
+      ++runEnd;
+    const size_t count = runEnd - i;
+    x.resize( count );
+    y.resize( count );
+    z.resize( count );
+    mesh.vertexCoordinates( mVertexIndices[i], count, x.data(), y.data(), z.data() );
+    for ( size_t j = 0; j < count; ++j )
+    {
+      mCoordinates[3 * ( i + j )] = x[j];
+      mCoordinates[3 * ( i + j ) + 1] = y[j];
+      mCoordinates[3 * ( i + j ) + 2] = z[j];
+    }
+    i = runEnd;
+  }
+}
+
+size_t MDAL::SelectedVerticesIterator::next( size_t vertexCount, double *coordinates )
+{
+  const size_t count = std::min( vertexCount, mVertexIndices.size() - mPosition );
+  std::copy( mCoordinates.begin() + static_cast<std::ptrdiff_t>( 3 * mPosition ),
+             mCoordinates.begin() + static_cast<std::ptrdiff_t>( 3 * ( mPosition + count ) ),
+             coordinates );
+  mPosition += count;
+  return count;
+}
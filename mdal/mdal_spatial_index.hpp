@@ -0,0 +1,169 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_SPATIAL_INDEX_HPP
+#define MDAL_SPATIAL_INDEX_HPP
+
+#include <stddef.h>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  class MemoryMesh;
+
+  /**
+   * Uniform grid over the bounding boxes of the mesh faces
+   *
+   * Each cell holds indexes of the faces whose bounding box intersects it,
+   * the grid has roughly as many cells as there are faces. The index keeps
+   * reference to the mesh, so it must not outlive it.
+   */
+  class FaceSpatialIndex
+  {
+    public:
+      static const size_t NO_FACE = std::numeric_limits<size_t>::max();
+
+      explicit FaceSpatialIndex( const MemoryMesh &mesh );
+
+      //! Returns index of a face containing the point, NO_FACE when the point is outside of the mesh
+      size_t faceAt( double x, double y ) const;
+
+    private:
+      bool faceContains( size_t faceIndex, double x, double y ) const;
+      size_t cellColumn( double x ) const;
+      size_t cellRow( double y ) const;
+
+      const MemoryMesh &mMesh;
+      double mMinX = 0;
+      double mMinY = 0;
+      double mMaxX = 0;
+      double mMaxY = 0;
+      double mCellWidth = 1;
+      double mCellHeight = 1;
+      size_t mColumns = 0;
+      size_t mRows = 0;
+      //! faces in cell i are mCellFaces[mCellOffsets[i]] ... mCellFaces[mCellOffsets[i + 1] - 1]
+      std::vector<size_t> mCellOffsets;
+      std::vector<size_t> mCellFaces;
+  };
+
+  /**
+   * Samples values of all datasets of the group at the point
+   *
+   * Values on faces are taken from the face containing the point, values on vertices
+   * are interpolated linearly within triangle of the face (faces are split to triangles
+   * from their first vertex). Only values of the face or its vertices are read.
+   * Values are NaN when the point is outside of the mesh or the face is not active.
+   * Faces of memory meshes are found by their spatial index, faces of regular grid meshes directly.
+   *
+   * \param buffer datasets count values for scalar groups, 2 * datasets count for vector groups
+   * \returns number of datasets sampled, 0 on error, for unsupported mesh or when the group is not defined on vertices or faces
+   */
+  size_t sampleTimeSeries( Mesh &mesh, DatasetGroup &group, double x, double y, double *buffer );
+
+  /**
+   * Samples values of all datasets of the group at many points, see sampleTimeSeries()
+   *
+   * The points are located in parallel and each dataset is read once by single
+   * Dataset::dataAtIndices() call for all points, datasets are read concurrently
+   * when the driver allows.
+   *
+   * \param buffer time series of the points one after another, pointCount * datasets count values
+   *               for scalar groups, 2 * pointCount * datasets count for vector groups
+   * \returns number of datasets sampled, 0 on error, for unsupported mesh or when the group is not defined on vertices or faces
+   */
+  size_t sampleTimeSeries( Mesh &mesh, DatasetGroup &group, size_t pointCount, const double *x, const double *y, double *buffer );
+
+  /**
+   * Reads values of all datasets of the group at the vertices or faces (by the data location of the group)
+   *
+   * Like the sampling at points, each dataset is read once for all indices. Values on inactive faces are NaN.
+   * Indices must be valid.
+   *
+   * \param buffer time series of the indices one after another, the same layout as for sampleTimeSeries()
+   * \returns number of datasets read, 0 on error or when the group is not defined on vertices or faces
+   */
+  size_t timeSeriesAtIndices( DatasetGroup &group, size_t count, const size_t *indices, double *buffer );
+
+  //! Whether sampleTimeSeries() supports the mesh
+  bool supportsPointSampling( const Mesh &mesh );
+
+  /**
+   * Packed R-tree over bounding boxes sorted along the Hilbert curve of their centers
+   *
+   * The tree is built bottom-up at once, each node holds up to NODE_SIZE children
+   * and all levels are stored in one array, so it takes little more memory than the boxes.
+   * Unlike FaceSpatialIndex it works for any mesh and for extents of any size.
+   */
+  class HilbertRTree
+  {
+    public:
+      static const size_t NODE_SIZE = 16;
+
+      //! Builds the tree, boxes with NaN coordinates are never found
+      explicit HilbertRTree( const std::vector<BBox> &boxes );
+
+      //! Returns indices of the boxes intersecting the extent, boundary included, in ascending order
+      std::vector<size_t> search( const BBox &extent ) const;
+
+    private:
+      //! Boxes of the nodes level by level, the leaves (the boxes in Hilbert order) first
+      std::vector<BBox> mNodes;
+      //! Index of the box of each leaf
+      std::vector<size_t> mLeafBoxes;
+      //! Position of the first node of each level in mNodes, the last item is the nodes count
+      std::vector<size_t> mLevelOffsets;
+  };
+
+  //! Builds the tree over the bounding boxes of the mesh faces
+  std::unique_ptr<HilbertRTree> buildFaceTree( Mesh &mesh );
+
+  //! Builds the tree over the mesh vertices
+  std::unique_ptr<HilbertRTree> buildVertexTree( Mesh &mesh );
+
+  //! Iterates faces of the mesh with the given indices, see MDAL_M_faceIteratorInExtent()
+  class SelectedFacesIterator: public MeshFaceIterator
+  {
+    public:
+      SelectedFacesIterator( Mesh &mesh, std::vector<size_t> faceIndices );
+
+      size_t next( size_t faceOffsetsBufferLen,
+                   int *faceOffsetsBuffer,
+                   size_t vertexIndicesBufferLen,
+                   int *vertexIndicesBuffer ) override;
+
+      const std::vector<size_t> &faceIndices() const { return mFaceIndices; }
+
+    private:
+      std::vector<size_t> mFaceIndices;
+      //! vertices of face i are mVertices[mOffsets[i]] ... mVertices[mOffsets[i + 1] - 1]
+      std::vector<size_t> mOffsets;
+      std::vector<int> mVertices;
+      size_t mPosition = 0;
+  };
+
+  //! Iterates vertices of the mesh with the given indices, see MDAL_M_vertexIteratorInExtent()
+  class SelectedVerticesIterator: public MeshVertexIterator
+  {
+    public:
+      SelectedVerticesIterator( Mesh &mesh, std::vector<size_t> vertexIndices );
+
+      size_t next( size_t vertexCount, double *coordinates ) override;
+
+      const std::vector<size_t> &vertexIndices() const { return mVertexIndices; }
+
+    private:
+      std::vector<size_t> mVertexIndices;
+      //! x, y, z of the vertices
+      std::vector<double> mCoordinates;
+      size_t mPosition = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_SPATIAL_INDEX_HPP
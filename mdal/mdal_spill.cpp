@@ -0,0 +1,334 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_spill.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include <string>
+
+#include "mdal_options.hpp"
+#include "mdal_utils.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+  struct SpilledBlock
+  {
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = nullptr;
+    HANDLE mapping = nullptr;
+#endif
+  };
+
+  struct SpillState
+  {
+    std::mutex mutex;
+    size_t heapSize = 0;
+    size_t spilledSize = 0;
+    std::map<void *, SpilledBlock> spilledBlocks;
+  };
+}
+
+static SpillState &_state()
+{
+  static SpillState sState;
+  return sState;
+}
+
+//! Returns the budget in bytes, 0 when not set
+static size_t _memoryBudget()
+{
+  const std::string budget = MDAL::openOption( MDAL::OPTION_MEMORY_BUDGET );
+  if ( budget.empty() )
+    return 0;
+  return MDAL::toSizeT( budget );
+}
+
+static std::string _spillDir()
+{
+  std::string dir = MDAL::openOption( MDAL::OPTION_SPILL_DIR );
+  if ( !dir.empty() )
+    return dir;
+
+#ifdef _WIN32
+  char path[MAX_PATH + 1];
+  const DWORD length = GetTempPathA( MAX_PATH + 1, path );
+  if ( length > 0 && length <= MAX_PATH )
+    return std::string( path, length );
+  return ".";
+#else
+  const char *tmpDir = getenv( "TMPDIR" );
+  return ( tmpDir && *tmpDir ) ? std::string( tmpDir ) : std::string( "/tmp" );
+#endif
+}
+
+#ifdef _WIN32
+
+static void *_mapTemporary( size_t bytes, SpilledBlock &block )
+{
+  const std::string dir = _spillDir();
+  char fileName[MAX_PATH + 1];
+  if ( GetTempFileNameA( dir.c_str(), "mdl", 0, fileName ) == 0 )
+    return nullptr;
+
+  // the file is deleted when the last handle is closed
+  HANDLE file = CreateFileA( fileName, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr );
+  if ( file == INVALID_HANDLE_VALUE )
+  {
+    DeleteFileA( fileName );
+    return nullptr;
+  }
+
+  const unsigned long long size = bytes;
+  HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READWRITE,
+                                       static_cast<DWORD>( size >> 32 ), static_cast<DWORD>( size & 0xFFFFFFFF ), nullptr );
+  if ( !mapping )
+  {
+    CloseHandle( file );
+    return nullptr;
+  }
+
+  void *view = MapViewOfFile( mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes );
+  if ( !view )
+  {
+    CloseHandle( mapping );
+    CloseHandle( file );
+    return nullptr;
+  }
+
+  block.file = file;
+  block.mapping = mapping;
+  return view;
+}
+
+static void _unmapTemporary( void *view, const SpilledBlock &block )
+{
+  UnmapViewOfFile( view );
+  CloseHandle( block.mapping );
+  CloseHandle( block.file );
+}
+
+#else
+
+static void *_mapTemporary( size_t bytes, SpilledBlock & )
+{
+  std::string fileName = MDAL::pathJoin( _spillDir(), "mdal_spill_XXXXXX" );
+  int fd = mkstemp( &fileName[0] );
+  if ( fd < 0 )
+    return nullptr;
+
+  // the mapping keeps the deleted file alive
+  unlink( fileName.c_str() );
+  void *addr = MAP_FAILED;
+  if ( ftruncate( fd, static_cast<off_t>( bytes ) ) == 0 )
+    addr = mmap( nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+  close( fd );
+
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+
+static void _unmapTemporary( void *addr, const SpilledBlock &block )
+{
+  munmap( addr, block.size );
+}
+
+#endif
+
+void *MDAL::spillAllocate( size_t bytes )
+{
+  SpillState &state = _state();
+  const size_t budget = _memoryBudget();
+  {
+    std::lock_guard<std::mutex> lock( state.mutex );
+    if ( budget == 0 || state.heapSize + bytes <= budget )
+    {
+      void *block = ::operator new( bytes );
+      state.heapSize += bytes;
+      return block;
+    }
+  }
+
+  SpilledBlock block;
+  block.size = bytes;
+  void *addr = _mapTemporary( bytes, block );
+
+  std::lock_guard<std::mutex> lock( state.mutex );
+  if ( !addr )
+  {
+    MDAL::debug( "Unable to map temporary file in " + _spillDir() + ", allocating on the heap" );
+    void *heapBlock = ::operator new( bytes );
+    state.heapSize += bytes;
+    return heapBlock;
+  }
+
+  state.spilledBlocks[addr] = block;
+  state.spilledSize += bytes;
+  return addr;
+}
+
+void MDAL::spillDeallocate( void *block, size_t bytes )
+{
+  if ( !block )
+    return;
+
+  SpillState &state = _state();
+  std::unique_lock<std::mutex> lock( state.mutex );
+  auto it = state.spilledBlocks.find( block );
+  if ( it == state.spilledBlocks.end() )
+  {
+    state.heapSize -= bytes;
+    lock.unlock();
+    ::operator delete( block );
+    return;
+  }
+
+  const SpilledBlock spilled = it->second;
+  state.spilledBlocks.erase( it );
+  state.spilledSize -= spilled.size;
+  lock.unlock();
+  _unmapTemporary( block, spilled );
+}
+
+size_t MDAL::heapBlocksSize()
+{
+  SpillState &state = _state();
+  std::lock_guard<std::mutex> lock( state.mutex );
+  return state.heapSize;
+}
+
+size_t MDAL::spilledSize()
+{
+  SpillState &state = _state();
+  std::lock_guard<std::mutex> lock( state.mutex );
+  return state.spilledSize;
+}
+
+//! Alignment of the arrays allocated from the arena
+static const size_t ARENA_ALIGNMENT = 16;
+//! Size of the first chunk of the arena, the next ones are doubled
+static const size_t ARENA_INITIAL_CHUNK_SIZE = 64 * 1024;
+static const size_t ARENA_MAXIMUM_CHUNK_SIZE = 8 * 1024 * 1024;
+
+static size_t _arenaBlockSize( size_t bytes )
+{
+  return std::max( ARENA_ALIGNMENT, ( bytes + ARENA_ALIGNMENT - 1 ) / ARENA_ALIGNMENT * ARENA_ALIGNMENT );
+}
+
+static void *_allocateBlock( size_t bytes )
+{
+  if ( bytes < MDAL::MIN_SPILL_BLOCK_SIZE )
+    return ::operator new( bytes );
+  return MDAL::spillAllocate( bytes );
+}
+
+static void _deallocateBlock( void *block, size_t bytes )
+{
+  if ( bytes < MDAL::MIN_SPILL_BLOCK_SIZE )
+    ::operator delete( block );
+  else
+    MDAL::spillDeallocate( block, bytes );
+}
+
+MDAL::MemoryArena::MemoryArena() = default;
+
+MDAL::MemoryArena::~MemoryArena()
+{
+  for ( const std::pair<char *, size_t> &chunk : mChunks )
+    _deallocateBlock( chunk.first, chunk.second );
+}
+
+void *MDAL::MemoryArena::allocate( size_t bytes )
+{
+  if ( bytes > static_cast<size_t>( -1 ) - ARENA_ALIGNMENT )
+    throw std::bad_alloc();
+
+  const size_t size = _arenaBlockSize( bytes );
+  if ( size >= MIN_SPILL_BLOCK_SIZE )
+  {
+    void *block = spillAllocate( size );
+    std::lock_guard<std::mutex> lock( mMutex );
+    mLargeSize += size;
+    mUsedSize += size;
+    return block;
+  }
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  auto freeBlocks = mFreeBlocks.find( size );
+  if ( freeBlocks != mFreeBlocks.end() && !freeBlocks->second.empty() )
+  {
+    void *block = freeBlocks->second.back();
+    freeBlocks->second.pop_back();
+    mUsedSize += size;
+    return block;
+  }
+
+  if ( mFreeSize < size )
+  {
+    // the rest of the last chunk is left unused
+    const size_t lastSize = mChunks.empty() ? 0 : mChunks.back().second;
+    const size_t chunkSize = std::max( size, std::min( std::max( 2 * lastSize, ARENA_INITIAL_CHUNK_SIZE ), ARENA_MAXIMUM_CHUNK_SIZE ) );
+    char *chunk = static_cast<char *>( _allocateBlock( chunkSize ) );
+    mChunks.push_back( std::make_pair( chunk, chunkSize ) );
+    mChunksSize += chunkSize;
+    mFree = chunk;
+    mFreeSize = chunkSize;
+  }
+
+  void *block = mFree;
+  mFree += size;
+  mFreeSize -= size;
+  mUsedSize += size;
+  return block;
+}
+
+void MDAL::MemoryArena::deallocate( void *block, size_t bytes )
+{
+  if ( !block )
+    return;
+
+  const size_t size = _arenaBlockSize( bytes );
+  if ( size >= MIN_SPILL_BLOCK_SIZE )
+  {
+    spillDeallocate( block, size );
+    std::lock_guard<std::mutex> lock( mMutex );
+    mLargeSize -= size;
+    mUsedSize -= size;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock( mMutex );
+  mFreeBlocks[size].push_back( block );
+  mUsedSize -= size;
+}
+
+size_t MDAL::MemoryArena::reservedSize() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mChunksSize + mLargeSize;
+}
+
+size_t MDAL::MemoryArena::usedSize() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mUsedSize;
+}
@@ -0,0 +1,145 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_SPILL_HPP
+#define MDAL_SPILL_HPP
+
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace MDAL
+{
+  //! Blocks smaller than this are always allocated on the heap
+  const size_t MIN_SPILL_BLOCK_SIZE = 1024 * 1024;
+
+  /**
+   * Allocates block of at least MIN_SPILL_BLOCK_SIZE bytes
+   *
+   * When the MEMORY_BUDGET open option is set and the large blocks on the heap
+   * would exceed it, the block is mapped from a deleted temporary file in the
+   * SPILL_DIR directory (system temporary directory by default), so the operating
+   * system can write it out instead of keeping it in the memory.
+   * Falls back to the heap when the mapping fails. Throws std::bad_alloc.
+   */
+  void *spillAllocate( size_t bytes );
+
+  //! Frees block allocated by spillAllocate()
+  void spillDeallocate( void *block, size_t bytes );
+
+  //! Bytes of the large blocks currently allocated on the heap
+  size_t heapBlocksSize();
+
+  //! Bytes of the blocks currently mapped from the temporary files
+  size_t spilledSize();
+
+  /**
+   * Storage of the arrays of the memory datasets of one mesh
+   *
+   * Arrays smaller than MIN_SPILL_BLOCK_SIZE are carved from chunks growing from 64 kB to 8 MB,
+   * the chunks of MIN_SPILL_BLOCK_SIZE and more allocated by spillAllocate(), so thousands of small
+   * dataset arrays do not fragment the heap and they are all released at once with the arena.
+   * Freed arrays are kept in lists by their size and reused by the next array of the same size,
+   * which is the usual case for the datasets of one mesh. Larger arrays are allocated by spillAllocate()
+   * directly and only counted. Thread-safe.
+   */
+  class MemoryArena
+  {
+    public:
+      MemoryArena();
+      ~MemoryArena();
+
+      MemoryArena( const MemoryArena & ) = delete;
+      MemoryArena &operator=( const MemoryArena & ) = delete;
+
+      //! Returns block of at least bytes aligned for any type. Throws std::bad_alloc
+      void *allocate( size_t bytes );
+      //! Returns the block to the arena, the memory is released only with the arena unless the block is large
+      void deallocate( void *block, size_t bytes );
+
+      //! Bytes held by the arena, its chunks and the large arrays allocated through it
+      size_t reservedSize() const;
+      //! Bytes of the arrays currently allocated from the arena
+      size_t usedSize() const;
+
+    private:
+      mutable std::mutex mMutex;
+      //! chunks with their sizes
+      std::vector<std::pair<char *, size_t>> mChunks;
+      //! free end of the last chunk
+      char *mFree = nullptr;
+      size_t mFreeSize = 0;
+      //! freed small arrays by their size
+      std::map<size_t, std::vector<void *>> mFreeBlocks;
+      size_t mChunksSize = 0;
+      size_t mLargeSize = 0;
+      size_t mUsedSize = 0;
+  };
+
+  /**
+   * Allocator of the large arrays of meshes and memory datasets
+   *
+   * Small arrays go to the heap directly, the large ones through spillAllocate().
+   * Allocator constructed with an arena allocates all arrays from the arena, the arena
+   * is propagated to the vectors moved or swapped with it.
+   */
+  template <typename T>
+  class SpillAllocator
+  {
+    public:
+      typedef T value_type;
+      typedef std::true_type propagate_on_container_move_assignment;
+      typedef std::true_type propagate_on_container_swap;
+
+      SpillAllocator() = default;
+      explicit SpillAllocator( MemoryArena *arena ): mArena( arena ) {}
+      template <typename U> SpillAllocator( const SpillAllocator<U> &other ): mArena( other.arena() ) {}
+
+      T *allocate( size_t n )
+      {
+        if ( n > static_cast<size_t>( -1 ) / sizeof( T ) )
+          throw std::bad_alloc();
+
+        const size_t bytes = n * sizeof( T );
+        if ( mArena )
+          return static_cast<T *>( mArena->allocate( bytes ) );
+        if ( bytes < MIN_SPILL_BLOCK_SIZE )
+          return static_cast<T *>( ::operator new( bytes ) );
+        return static_cast<T *>( spillAllocate( bytes ) );
+      }
+
+      void deallocate( T *p, size_t n )
+      {
+        const size_t bytes = n * sizeof( T );
+        if ( mArena )
+          mArena->deallocate( p, bytes );
+        else if ( bytes < MIN_SPILL_BLOCK_SIZE )
+          ::operator delete( p );
+        else
+          spillDeallocate( p, bytes );
+      }
+
+      //! Arena of the arrays, nullptr for arrays allocated on their own
+      MemoryArena *arena() const { return mArena; }
+
+    private:
+      MemoryArena *mArena = nullptr;
+  };
+
+  template <typename T, typename U>
+  bool operator==( const SpillAllocator<T> &a, const SpillAllocator<U> &b ) { return a.arena() == b.arena(); }
+
+  template <typename T, typename U>
+  bool operator!=( const SpillAllocator<T> &a, const SpillAllocator<U> &b ) { return a.arena() != b.arena(); }
+
+  template <typename T>
+  using SpillVector = std::vector<T, SpillAllocator<T>>;
+
+} // namespace MDAL
+#endif //MDAL_SPILL_HPP
@@ -0,0 +1,322 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_statistics_cache.hpp"
+
+#include <fstream>
+#include <stdio.h>
+#include <string.h>
+
+#include "mdal_options.hpp"
+#include "mdal_quantile_sketch.hpp"
+#include "mdal_utils.hpp"
+
+static const char CACHE_MAGIC[8] = { 'M', 'D', 'A', 'L', 'S', 'T', 'A', '2' };
+static const uint32_t MAX_CACHED_SKETCH_ITEMS = 1 << 20;
+static const uint32_t MAX_CACHED_STRING_LENGTH = 1 << 20;
+
+//! FNV-1a, stable between the platforms and runs unlike std::hash
+static uint64_t _hash( const std::string &str )
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for ( char c : str )
+  {
+    hash ^= static_cast<unsigned char>( c );
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+template<typename T>
+static void _write( std::ofstream &out, const T &value )
+{
+  out.write( reinterpret_cast<const char *>( &value ), sizeof( T ) );
+}
+
+static void _writeString( std::ofstream &out, const std::string &str )
+{
+  _write( out, static_cast<uint32_t>( str.size() ) );
+  out.write( str.data(), static_cast<std::streamsize>( str.size() ) );
+}
+
+template<typename T>
+static bool _read( std::ifstream &in, T &value )
+{
+  return static_cast<bool>( in.read( reinterpret_cast<char *>( &value ), sizeof( T ) ) );
+}
+
+static bool _readString( std::ifstream &in, std::string &str )
+{
+  uint32_t length;
+  if ( !_read( in, length ) || length > MAX_CACHED_STRING_LENGTH )
+    return false;
+  str.resize( length );
+  return length == 0 || static_cast<bool>( in.read( &str[0], length ) );
+}
+
+//! Writes minimum, maximum and the quantile sketch if there is one
+static void _writeStatistics( std::ofstream &out, const MDAL::Statistics &statistics )
+{
+  _write( out, statistics.minimum );
+  _write( out, statistics.maximum );
+  _write( out, static_cast<uint8_t>( statistics.sketch ? 1 : 0 ) );
+  if ( !statistics.sketch )
+    return;
+
+  const MDAL::QuantileSketch &sketch = *statistics.sketch;
+  _write( out, static_cast<uint32_t>( sketch.k() ) );
+  _write( out, sketch.minimum() );
+  _write( out, sketch.maximum() );
+  _write( out, static_cast<uint32_t>( sketch.levels().size() ) );
+  for ( const std::vector<double> &level : sketch.levels() )
+  {
+    _write( out, static_cast<uint32_t>( level.size() ) );
+    out.write( reinterpret_cast<const char *>( level.data() ), static_cast<std::streamsize>( level.size() * sizeof( double ) ) );
+  }
+}
+
+static bool _readStatistics( std::ifstream &in, MDAL::Statistics &statistics )
+{
+  uint8_t hasSketch;
+  if ( !_read( in, statistics.minimum ) ||
+       !_read( in, statistics.maximum ) ||
+       !_read( in, hasSketch ) )
+    return false;
+
+  if ( hasSketch == 0 )
+    return true;
+
+  uint32_t k, levelCount;
+  double minimum, maximum;
+  if ( !_read( in, k ) || !_read( in, minimum ) || !_read( in, maximum ) ||
+       !_read( in, levelCount ) || levelCount > 64 )
+    return false;
+
+  std::vector<std::vector<double>> levels( levelCount );
+  for ( std::vector<double> &level : levels )
+  {
+    uint32_t size;
+    if ( !_read( in, size ) || size > MAX_CACHED_SKETCH_ITEMS )
+      return false;
+    level.resize( size );
+    if ( size > 0 && !in.read( reinterpret_cast<char *>( level.data() ), static_cast<std::streamsize>( size * sizeof( double ) ) ) )
+      return false;
+  }
+
+  std::shared_ptr<MDAL::QuantileSketch> sketch = std::make_shared<MDAL::QuantileSketch>( k );
+  sketch->setLevels( levels, minimum, maximum );
+  statistics.sketch = sketch;
+  return true;
+}
+
+MDAL::StatisticsCache::StatisticsCache( const std::string &uri )
+  : mUri( uri )
+{
+  const std::string dir = openOption( OPTION_STATISTICS_CACHE_DIR );
+  if ( dir.empty() )
+    return;
+
+  if ( !fileSizeAndModificationTime( uri, mFileSize, mFileModificationTime ) )
+    return;
+
+  char name[32];
+  snprintf( name, sizeof( name ), "%016llx.mdalstats", static_cast<unsigned long long>( _hash( uri ) ) );
+  mCacheFile = pathJoin( dir, name );
+
+  mHasEntry = read();
+  if ( !mHasEntry )
+    mGroups.clear();
+}
+
+bool MDAL::StatisticsCache::isEnabled() const
+{
+  return !mCacheFile.empty();
+}
+
+bool MDAL::StatisticsCache::hasEntry() const
+{
+  return mHasEntry;
+}
+
+bool MDAL::StatisticsCache::read()
+{
+  std::ifstream in( mCacheFile, std::ifstream::in | std::ifstream::binary );
+  if ( !in )
+    return false;
+
+  char magic[sizeof( CACHE_MAGIC )];
+  if ( !in.read( magic, sizeof( magic ) ) || memcmp( magic, CACHE_MAGIC, sizeof( magic ) ) != 0 )
+    return false;
+
+  // different file with the same hash or the file has changed
+  std::string uri;
+  int64_t fileSize, fileModificationTime;
+  if ( !_readString( in, uri ) || uri != mUri ||
+       !_read( in, fileSize ) || fileSize != mFileSize ||
+       !_read( in, fileModificationTime ) || fileModificationTime != mFileModificationTime )
+    return false;
+
+  uint32_t groupCount;
+  if ( !_read( in, groupCount ) )
+    return false;
+
+  for ( uint32_t i = 0; i < groupCount; ++i )
+  {
+    GroupEntry group;
+    uint8_t isScalar;
+    int32_t location;
+    uint32_t datasetCount;
+    if ( !_readString( in, group.name ) ||
+         !_read( in, location ) ||
+         !_read( in, isScalar ) ||
+         !_readString( in, group.referenceTime ) ||
+         !_readStatistics( in, group.statistics ) ||
+         !_read( in, datasetCount ) )
+      return false;
+
+    group.location = location;
+    group.isScalar = isScalar != 0;
+
+    for ( uint32_t j = 0; j < datasetCount; ++j )
+    {
+      DatasetEntry dataset;
+      if ( !_read( in, dataset.time ) ||
+           !_readStatistics( in, dataset.statistics ) )
+        return false;
+      group.datasets.push_back( dataset );
+    }
+    mGroups.push_back( group );
+  }
+
+  return true;
+}
+
+bool MDAL::StatisticsCache::apply( const DatasetGroups &groups ) const
+{
+  if ( !mHasEntry || groups.size() != mGroups.size() )
+    return false;
+
+  // check the whole layout first, so either all or nothing is set
+  for ( size_t i = 0; i < groups.size(); ++i )
+  {
+    const std::shared_ptr<DatasetGroup> &group = groups[i];
+    const GroupEntry &entry = mGroups[i];
+    if ( group->name() != entry.name ||
+         static_cast<int>( group->dataLocation() ) != entry.location ||
+         group->isScalar() != entry.isScalar ||
+         group->referenceTime().toStandartCalendarISO8601() != entry.referenceTime ||
+         group->datasets.size() != entry.datasets.size() )
+      return false;
+
+    for ( size_t j = 0; j < group->datasets.size(); ++j )
+    {
+      if ( group->datasets[j]->time( RelativeTimestamp::hours ) != entry.datasets[j].time )
+        return false;
+    }
+  }
+
+  for ( size_t i = 0; i < groups.size(); ++i )
+  {
+    const std::shared_ptr<DatasetGroup> &group = groups[i];
+    const GroupEntry &entry = mGroups[i];
+    for ( size_t j = 0; j < group->datasets.size(); ++j )
+      group->datasets[j]->setStatistics( entry.datasets[j].statistics );
+    group->setStatistics( entry.statistics );
+  }
+
+  return true;
+}
+
+void MDAL::StatisticsCache::store( const DatasetGroups &groups ) const
+{
+  if ( !isEnabled() || groups.empty() )
+    return;
+
+  for ( const std::shared_ptr<DatasetGroup> &group : groups )
+  {
+    if ( !group->hasStatistics() )
+      return;
+
+    for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    {
+      if ( !dataset->hasStatistics() )
+        return;
+    }
+  }
+
+  // write to temporary file first, so concurrent readers never see partial entry
+  const std::string tmpFile = mCacheFile + ".tmp";
+  {
+    std::ofstream out( tmpFile, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc );
+    if ( !out )
+    {
+      MDAL::debug( "Unable to write statistics cache " + tmpFile );
+      return;
+    }
+
+    out.write( CACHE_MAGIC, sizeof( CACHE_MAGIC ) );
+    _writeString( out, mUri );
+    _write( out, mFileSize );
+    _write( out, mFileModificationTime );
+    _write( out, static_cast<uint32_t>( groups.size() ) );
+
+    for ( const std::shared_ptr<DatasetGroup> &group : groups )
+    {
+      const Statistics groupStatistics = group->statistics();
+      _writeString( out, group->name() );
+      _write( out, static_cast<int32_t>( group->dataLocation() ) );
+      _write( out, static_cast<uint8_t>( group->isScalar() ? 1 : 0 ) );
+      _writeString( out, group->referenceTime().toStandartCalendarISO8601() );
+      _writeStatistics( out, groupStatistics );
+      _write( out, static_cast<uint32_t>( group->datasets.size() ) );
+
+      for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+      {
+        const Statistics datasetStatistics = dataset->statistics();
+        _write( out, dataset->time( RelativeTimestamp::hours ) );
+        _writeStatistics( out, datasetStatistics );
+      }
+    }
+
+    if ( !out )
+    {
+      out.close();
+      remove( tmpFile.c_str() );
+      return;
+    }
+  }
+
+#ifdef _WIN32
+  // rename does not replace existing file on Windows
+  remove( mCacheFile.c_str() );
+#endif
+  if ( rename( tmpFile.c_str(), mCacheFile.c_str() ) != 0 )
+    remove( tmpFile.c_str() );
+}
+
+void MDAL::StatisticsCache::sync( const DatasetGroups &groups ) const
+{
+  if ( !mHasEntry )
+  {
+    store( groups );
+    return;
+  }
+
+  if ( apply( groups ) )
+    return;
+
+  // the groups were loaded with lazy statistics for the stale entry
+  for ( const std::shared_ptr<DatasetGroup> &group : groups )
+  {
+    for ( const std::shared_ptr<Dataset> &dataset : group->datasets )
+    {
+      if ( !dataset->hasStatistics() )
+        dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+    }
+    if ( !group->hasStatistics() )
+      group->setStatistics( MDAL::calculateStatistics( group ) );
+  }
+  store( groups );
+}
@@ -0,0 +1,85 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_STATISTICS_CACHE_HPP
+#define MDAL_STATISTICS_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Persistent cache of the dataset group statistics of a single file
+   *
+   * Enabled when STATISTICS_CACHE_DIR open option is set. Each file has one entry
+   * in the directory, which is valid while uri, size and modification time of the file
+   * do not change. Apart from statistics, the entry holds the group layout
+   * (names, locations, reference times, dataset times) used to check that it
+   * matches the loaded groups. Quantile sketches are stored with the statistics
+   * when they are built during the load (QUANTILE_SKETCH open option).
+   */
+  class StatisticsCache
+  {
+    public:
+      //! Reads the cache entry for the file if the cache is enabled
+      explicit StatisticsCache( const std::string &uri );
+
+      //! Whether STATISTICS_CACHE_DIR open option is set and the file exists
+      bool isEnabled() const;
+
+      //! Whether there is a valid entry for the file
+      bool hasEntry() const;
+
+      /**
+       * Sets the cached statistics to the groups and their datasets
+       * \returns false if the entry does not match the groups, nothing is set then
+       */
+      bool apply( const DatasetGroups &groups ) const;
+
+      /**
+       * Stores statistics of the groups
+       * Skipped when any group or dataset has no statistics calculated yet
+       */
+      void store( const DatasetGroups &groups ) const;
+
+      /**
+       * Applies the entry to the loaded groups, or replaces the entry not matching them (or missing)
+       * with their statistics. The statistics skipped by the load with the stale entry are calculated then.
+       */
+      void sync( const DatasetGroups &groups ) const;
+
+    private:
+      struct DatasetEntry
+      {
+        double time = 0;
+        Statistics statistics;
+      };
+
+      struct GroupEntry
+      {
+        std::string name;
+        int location = 0;
+        bool isScalar = true;
+        std::string referenceTime;
+        Statistics statistics;
+        std::vector<DatasetEntry> datasets;
+      };
+
+      bool read();
+
+      std::string mUri;
+      std::string mCacheFile;
+      int64_t mFileSize = -1;
+      int64_t mFileModificationTime = -1;
+      bool mHasEntry = false;
+      std::vector<GroupEntry> mGroups;
+  };
+
+} // namespace MDAL
+#endif //MDAL_STATISTICS_CACHE_HPP
@@ -0,0 +1,236 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_temporal_aggregate.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mdal_parallel.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_topology.hpp"
+
+//! Number of values accumulated by one parallel task
+static const size_t BLOCK_VALUES = 16384;
+
+MDAL::TemporalAggregateDataset2D::TemporalAggregateDataset2D( MDAL::DatasetGroup *parent,
+    const MDAL::DatasetGroup &source,
+    MDAL_TemporalAggregate aggregate )
+  : Dataset2D( parent )
+  , mSources( source.datasets )
+  , mSourceIsScalar( source.isScalar() )
+  , mAggregate( aggregate )
+{
+  // the aggregate is valid at the end of the run
+  if ( !mSources.empty() )
+    setTime( mSources.back()->time( RelativeTimestamp::hours ) );
+}
+
+MDAL::TemporalAggregateDataset2D::~TemporalAggregateDataset2D() = default;
+
+bool MDAL::TemporalAggregateDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+void MDAL::TemporalAggregateDataset2D::maskInactiveVertices( const std::vector<int> &activeFaces, double *values )
+{
+  // vertices without faces keep their values
+  const AdjacencyRows &vertexFaces = mesh()->topology().vertexFaces();
+  const size_t verticesCount = vertexFaces.rowsCount();
+  const size_t blocks = ( verticesCount + BLOCK_VALUES - 1 ) / BLOCK_VALUES;
+  parallelFor( blocks, [&]( size_t block )
+  {
+    const size_t end = std::min( verticesCount, ( block + 1 ) * BLOCK_VALUES );
+    for ( size_t v = block * BLOCK_VALUES; v < end; ++v )
+    {
+      const uint32_t *faces = vertexFaces.row( v );
+      const size_t count = vertexFaces.rowSize( v );
+      bool isActive = count == 0;
+      for ( size_t j = 0; j < count && !isActive; ++j )
+        isActive = faces[j] < activeFaces.size() && activeFaces[faces[j]] != 0;
+      if ( !isActive )
+        values[v] = std::numeric_limits<double>::quiet_NaN();
+    }
+  } );
+}
+
+size_t MDAL::TemporalAggregateDataset2D::memoryUsage() const
+{
+  std::lock_guard<std::mutex> lock( mMutex );
+  return mValues.capacity() * sizeof( double );
+}
+
+const std::vector<double> &MDAL::TemporalAggregateDataset2D::values()
+{
+  {
+    std::lock_guard<std::mutex> lock( mMutex );
+    if ( mIsCalculated )
+      return mValues;
+  }
+
+  // calculated without the lock, the reads of the sources take the library lock which the caller may hold already,
+  // concurrent first requests may calculate the values twice, the first result is kept and never changed
+  std::vector<double> calculated = calculateValues();
+  std::lock_guard<std::mutex> lock( mMutex );
+  if ( !mIsCalculated )
+  {
+    mValues = std::move( calculated );
+    mIsCalculated = true;
+  }
+  return mValues;
+}
+
+std::vector<double> MDAL::TemporalAggregateDataset2D::calculateValues()
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const size_t count = valuesCount();
+  const bool onFaces = group()->dataLocation() == MDAL_DataLocation::DataOnFaces2D;
+  const size_t valuesPerIndex = mSourceIsScalar ? 1 : 2;
+
+  // only the accumulators of the aggregate are allocated
+  const bool hasMaximum = mAggregate == MDAL_TemporalAggregate::TemporalMaximum || mAggregate == MDAL_TemporalAggregate::TimeOfMaximum;
+  std::vector<double> minimum( mAggregate == MDAL_TemporalAggregate::TemporalMinimum ? count : 0, std::numeric_limits<double>::infinity() );
+  std::vector<double> maximum( hasMaximum ? count : 0, -std::numeric_limits<double>::infinity() );
+  std::vector<double> timeOfMaximum( mAggregate == MDAL_TemporalAggregate::TimeOfMaximum ? count : 0, nan );
+  std::vector<double> sum( mAggregate == MDAL_TemporalAggregate::TemporalMean ? count : 0, 0.0 );
+  std::vector<double> validCount( count, 0.0 );
+  double *minimumData = minimum.empty() ? nullptr : minimum.data();
+  double *maximumData = maximum.empty() ? nullptr : maximum.data();
+  double *timeOfMaximumData = timeOfMaximum.empty() ? nullptr : timeOfMaximum.data();
+  double *sumData = sum.empty() ? nullptr : sum.data();
+
+  // one time step is held at a time
+  std::vector<double> stepValues( valuesPerIndex * count );
+  std::vector<double> magnitudes( mSourceIsScalar ? 0 : count );
+  std::vector<int> activeFaces;
+  for ( const std::shared_ptr<Dataset> &source : mSources )
+  {
+    std::fill( stepValues.begin(), stepValues.end(), nan );
+    activeFaces.clear();
+    {
+      DatasetReadLock readLock( source.get() );
+      if ( mSourceIsScalar )
+        source->scalarData( 0, count, stepValues.data() );
+      else
+        source->vectorData( 0, count, stepValues.data() );
+
+      if ( source->supportsActiveFlag() )
+      {
+        activeFaces.assign( mesh()->facesCount(), 1 );
+        source->activeData( 0, activeFaces.size(), activeFaces.data() );
+      }
+    }
+
+    double *values = stepValues.data();
+    if ( !mSourceIsScalar )
+    {
+      magnitude( stepValues.data(), count, magnitudes.data() );
+      values = magnitudes.data();
+    }
+
+    if ( !activeFaces.empty() )
+    {
+      if ( onFaces )
+      {
+        for ( size_t i = 0; i < count; ++i )
+        {
+          if ( activeFaces[i] == 0 )
+            values[i] = nan;
+        }
+      }
+      else
+      {
+        maskInactiveVertices( activeFaces, values );
+      }
+    }
+
+    const double time = source->time( RelativeTimestamp::hours );
+    const size_t blocks = ( count + BLOCK_VALUES - 1 ) / BLOCK_VALUES;
+    parallelFor( blocks, [&]( size_t block )
+    {
+      const size_t start = block * BLOCK_VALUES;
+      const size_t blockCount = std::min( count, start + BLOCK_VALUES ) - start;
+      accumulateTimeStep( values + start, blockCount, time,
+                          minimumData ? minimumData + start : nullptr,
+                          maximumData ? maximumData + start : nullptr,
+                          timeOfMaximumData ? timeOfMaximumData + start : nullptr,
+                          sumData ? sumData + start : nullptr,
+                          validCount.data() + start );
+    } );
+  }
+
+  std::vector<double> result( count );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    const bool isValid = validCount[i] > 0;
+    switch ( mAggregate )
+    {
+      case MDAL_TemporalAggregate::TemporalMaximum:
+        result[i] = isValid ? maximum[i] : nan;
+        break;
+      case MDAL_TemporalAggregate::TemporalMinimum:
+        result[i] = isValid ? minimum[i] : nan;
+        break;
+      case MDAL_TemporalAggregate::TemporalMean:
+        result[i] = isValid ? sum[i] / validCount[i] : nan;
+        break;
+      case MDAL_TemporalAggregate::TimeOfMaximum:
+        result[i] = timeOfMaximum[i];
+        break;
+    }
+  }
+  return result;
+}
+
+size_t MDAL::TemporalAggregateDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  const std::vector<double> &vals = values();
+  if ( ( count < 1 ) || ( indexStart >= vals.size() ) )
+    return 0;
+
+  const size_t copyValues = std::min( vals.size() - indexStart, count );
+  std::copy( vals.begin() + static_cast<std::ptrdiff_t>( indexStart ),
+             vals.begin() + static_cast<std::ptrdiff_t>( indexStart + copyValues ),
+             buffer );
+  return copyValues;
+}
+
+size_t MDAL::TemporalAggregateDataset2D::vectorData( size_t, size_t, double * )
+{
+  assert( false ); //checked in C API interface, the aggregates are scalar
+  return 0;
+}
+
+MDAL::DatasetGroup *MDAL::addTemporalAggregateGroup( MDAL::DatasetGroup *group, MDAL_TemporalAggregate aggregate, const std::string &name )
+{
+  if ( !group || group->datasets.empty() )
+    return nullptr;
+
+  if ( aggregate != MDAL_TemporalAggregate::TemporalMaximum && aggregate != MDAL_TemporalAggregate::TemporalMinimum &&
+       aggregate != MDAL_TemporalAggregate::TemporalMean && aggregate != MDAL_TemporalAggregate::TimeOfMaximum )
+    return nullptr;
+
+  const MDAL_DataLocation location = group->dataLocation();
+  if ( location != MDAL_DataLocation::DataOnVertices2D && location != MDAL_DataLocation::DataOnFaces2D )
+    return nullptr;
+
+  MDAL::Mesh *mesh = group->mesh();
+  std::shared_ptr<DatasetGroup> aggregated = std::make_shared<DatasetGroup>( group->driverName(),
+      mesh,
+      group->uri(),
+      name );
+  aggregated->setDataLocation( location );
+  aggregated->setIsScalar( true );
+  aggregated->setReferenceTime( group->referenceTime() );
+
+  // statistics are calculated on the first request, that calculates the values too
+  aggregated->datasets.push_back( std::make_shared<TemporalAggregateDataset2D>( aggregated.get(), *group, aggregate ) );
+
+  mesh->datasetGroups.push_back( aggregated );
+  return aggregated.get();
+}
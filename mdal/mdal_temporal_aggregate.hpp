@@ -0,0 +1,73 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_TEMPORAL_AGGREGATE_HPP
+#define MDAL_TEMPORAL_AGGREGATE_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mdal.h"
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * Scalar dataset aggregated over all datasets (time steps) of the source group
+   *
+   * Values are calculated on the first request by a single pass over the source datasets,
+   * only one time step is held in memory. Each time step is read at once and accumulated
+   * by vectorized kernel in parallel for the blocks of values. Vectors are aggregated
+   * as magnitudes, values on inactive faces (or on vertices of inactive faces only) are skipped,
+   * values never valid are NaN. The result is kept until the mesh is closed.
+   */
+  class TemporalAggregateDataset2D: public Dataset2D
+  {
+    public:
+      TemporalAggregateDataset2D( DatasetGroup *parent,
+                                  const DatasetGroup &source,
+                                  MDAL_TemporalAggregate aggregate );
+      ~TemporalAggregateDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+
+      //! Reads of the source are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+      //! The aggregated values once calculated
+      size_t memoryUsage() const override;
+
+    private:
+      //! Returns the aggregated values, calculates them on the first call
+      const std::vector<double> &values();
+
+      //! Aggregates the source datasets, called without the lock
+      std::vector<double> calculateValues();
+
+      //! Sets values of the vertices used only by inactive faces to NaN
+      void maskInactiveVertices( const std::vector<int> &activeFaces, double *values );
+
+      std::vector<std::shared_ptr<Dataset>> mSources;
+      bool mSourceIsScalar = true;
+      MDAL_TemporalAggregate mAggregate;
+
+      //! Guards the values only, not held while the sources are read
+      mutable std::mutex mMutex;
+      bool mIsCalculated = false;
+      std::vector<double> mValues;
+  };
+
+  /**
+   * Adds group with single dataset aggregated over the datasets of the group to its mesh
+   * \returns the new group or nullptr when the group is not defined on vertices or faces, has no datasets
+   * or the aggregate is unknown
+   */
+  DatasetGroup *addTemporalAggregateGroup( DatasetGroup *group, MDAL_TemporalAggregate aggregate, const std::string &name );
+} // namespace MDAL
+#endif //MDAL_TEMPORAL_AGGREGATE_HPP
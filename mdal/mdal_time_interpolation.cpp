@@ -0,0 +1,148 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_time_interpolation.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+
+#include "mdal_parallel.hpp"
+
+//! Number of elements blended from one read of the later dataset
+static const size_t BLOCK_ELEMENTS = 65536;
+
+MDAL::TimeInterpolatedDataset2D::TimeInterpolatedDataset2D( MDAL::DatasetGroup *parent,
+    std::shared_ptr<MDAL::Dataset> before,
+    std::shared_ptr<MDAL::Dataset> after,
+    double position,
+    const MDAL::RelativeTimestamp &time )
+  : Dataset2D( parent )
+  , mBefore( before )
+  , mAfter( after )
+  , mPosition( position )
+{
+  if ( mPosition <= 0 )
+    mAfter = mBefore;
+  else if ( mPosition >= 1 )
+    mBefore = mAfter;
+  setSupportsActiveFlag( mBefore->supportsActiveFlag() || mAfter->supportsActiveFlag() );
+  setTime( time );
+}
+
+MDAL::TimeInterpolatedDataset2D::~TimeInterpolatedDataset2D() = default;
+
+bool MDAL::TimeInterpolatedDataset2D::supportsConcurrentReads() const
+{
+  return true;
+}
+
+size_t MDAL::TimeInterpolatedDataset2D::interpolate( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer )
+{
+  const MDAL_DataType type = valuesPerElement == 1 ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  size_t read;
+  {
+    DatasetReadLock lock( mBefore.get() );
+    read = mBefore->data( type, indexStart, count, buffer );
+  }
+  if ( mBefore == mAfter || read == 0 )
+    return read;
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  std::vector<double> after( valuesPerElement * std::min( read, BLOCK_ELEMENTS ) );
+  for ( size_t blockStart = 0; blockStart < read; blockStart += BLOCK_ELEMENTS )
+  {
+    const size_t blockCount = std::min( read - blockStart, BLOCK_ELEMENTS );
+    size_t afterRead;
+    {
+      DatasetReadLock lock( mAfter.get() );
+      afterRead = mAfter->data( type, indexStart + blockStart, blockCount, after.data() );
+    }
+    std::fill( after.begin() + static_cast<std::ptrdiff_t>( valuesPerElement * afterRead ), after.end(), nan );
+
+    // NaN in either dataset stays NaN
+    double *values = buffer + valuesPerElement * blockStart;
+    const size_t valuesCount = valuesPerElement * blockCount;
+    for ( size_t i = 0; i < valuesCount; ++i )
+      values[i] += mPosition * ( after[i] - values[i] );
+  }
+  return read;
+}
+
+size_t MDAL::TimeInterpolatedDataset2D::scalarData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( group()->isScalar() ); //checked in C API interface
+  return interpolate( indexStart, count, 1, buffer );
+}
+
+size_t MDAL::TimeInterpolatedDataset2D::vectorData( size_t indexStart, size_t count, double *buffer )
+{
+  assert( !group()->isScalar() ); //checked in C API interface
+  return interpolate( indexStart, count, 2, buffer );
+}
+
+size_t MDAL::TimeInterpolatedDataset2D::activeData( size_t indexStart, size_t count, int *buffer )
+{
+  // faces of the dataset without active flags are active
+  const size_t facesCount = mesh()->facesCount();
+  if ( indexStart >= facesCount )
+    return 0;
+  count = std::min( count, facesCount - indexStart );
+  std::fill( buffer, buffer + count, 1 );
+
+  std::vector<int> active;
+  const size_t sourcesCount = mBefore == mAfter ? 1 : 2;
+  for ( size_t source = 0; source < sourcesCount; ++source )
+  {
+    Dataset *dataset = source == 0 ? mBefore.get() : mAfter.get();
+    if ( !dataset->supportsActiveFlag() )
+      continue;
+
+    active.resize( count );
+    size_t read;
+    {
+      DatasetReadLock lock( dataset );
+      read = dataset->activeData( indexStart, count, active.data() );
+    }
+    for ( size_t i = 0; i < read; ++i )
+      buffer[i] = buffer[i] && active[i];
+  }
+  return count;
+}
+
+MDAL::DatasetGroup *MDAL::addTimeInterpolatedGroup( MDAL::DatasetGroup *group, const std::vector<double> &times, const std::string &name )
+{
+  if ( !group || group->datasets.empty() )
+    return nullptr;
+
+  if ( group->dataLocation() != MDAL_DataLocation::DataOnVertices2D && group->dataLocation() != MDAL_DataLocation::DataOnFaces2D )
+    return nullptr;
+
+  MDAL::Mesh *mesh = group->mesh();
+  std::shared_ptr<DatasetGroup> interpolated = std::make_shared<DatasetGroup>( group->driverName(),
+      mesh,
+      group->uri(),
+      name );
+  interpolated->setDataLocation( group->dataLocation() );
+  interpolated->setIsScalar( group->isScalar() );
+  interpolated->setReferenceTime( group->referenceTime() );
+
+  for ( double time : times )
+  {
+    const RelativeTimestamp timestamp( time, RelativeTimestamp::hours );
+    size_t before = 0;
+    size_t after = 0;
+    double position = 0;
+    group->datasetsAroundTime( timestamp, before, after, position );
+    interpolated->datasets.push_back( std::make_shared<TimeInterpolatedDataset2D>( interpolated.get(),
+                                      group->datasets[before],
+                                      group->datasets[after],
+                                      position,
+                                      timestamp ) );
+  }
+
+  mesh->datasetGroups.push_back( interpolated );
+  return interpolated.get();
+}
@@ -0,0 +1,63 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_TIME_INTERPOLATION_HPP
+#define MDAL_TIME_INTERPOLATION_HPP
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+
+namespace MDAL
+{
+  /**
+   * 2D dataset interpolated linearly in time between two datasets of the group
+   *
+   * Nothing is stored, each request reads the same range of both datasets and blends them,
+   * the value is invalid (NaN) when either of them is. The face is active when it is active
+   * in both datasets. At the time of a dataset (or outside of the time range of the group)
+   * only that dataset is read.
+   */
+  class TimeInterpolatedDataset2D: public Dataset2D
+  {
+    public:
+      /**
+       * \param before dataset at or before the time
+       * \param after dataset after the time, the same as before when there is only one to read
+       * \param position of the time between the times of the datasets, 0 at before, 1 at after
+       */
+      TimeInterpolatedDataset2D( DatasetGroup *parent,
+                                 std::shared_ptr<Dataset> before,
+                                 std::shared_ptr<Dataset> after,
+                                 double position,
+                                 const RelativeTimestamp &time );
+      ~TimeInterpolatedDataset2D() override;
+
+      size_t scalarData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t vectorData( size_t indexStart, size_t count, double *buffer ) override;
+      size_t activeData( size_t indexStart, size_t count, int *buffer ) override;
+
+      //! Reads of the sources are serialized by the dataset itself
+      bool supportsConcurrentReads() const override;
+
+    private:
+      //! Blends count elements from indexStart, valuesPerElement is 1 for scalars or 2 for vectors
+      size_t interpolate( size_t indexStart, size_t count, size_t valuesPerElement, double *buffer );
+
+      std::shared_ptr<Dataset> mBefore;
+      std::shared_ptr<Dataset> mAfter;
+      double mPosition = 0;
+  };
+
+  /**
+   * Adds group with the datasets of the group interpolated at the times (in hours), see TimeInterpolatedDataset2D
+   * \returns the new group or nullptr when the group is not defined on vertices or faces or has no datasets
+   */
+  DatasetGroup *addTimeInterpolatedGroup( DatasetGroup *group, const std::vector<double> &times, const std::string &name );
+} // namespace MDAL
+#endif //MDAL_TIME_INTERPOLATION_HPP
@@ -0,0 +1,276 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_topology.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "mdal_data_model.hpp"
+#include "mdal_parallel.hpp"
+
+//! Faces are processed in blocks by the parallel loops
+static const size_t BLOCK_FACES = 4096;
+
+size_t MDAL::AdjacencyRows::maximumRowSize() const
+{
+  size_t maximum = 0;
+  for ( size_t i = 0; i < rowsCount(); ++i )
+    maximum = std::max( maximum, rowSize( i ) );
+  return maximum;
+}
+
+//! Sorts chunks of the keys in parallel and merges them pairwise
+static void _parallelSort( MDAL::SpillVector<uint64_t> &keys )
+{
+  const size_t chunks = std::max( size_t( 1 ), std::min( MDAL::threadCount(), keys.size() / 65536 ) );
+  std::vector<size_t> bounds( chunks + 1 );
+  for ( size_t i = 0; i <= chunks; ++i )
+    bounds[i] = keys.size() / chunks * i;
+  bounds[chunks] = keys.size();
+
+  MDAL::parallelFor( chunks, [&]( size_t i )
+  {
+    std::sort( keys.begin() + static_cast<std::ptrdiff_t>( bounds[i] ), keys.begin() + static_cast<std::ptrdiff_t>( bounds[i + 1] ) );
+  } );
+
+  for ( size_t width = 1; width < chunks; width *= 2 )
+  {
+    const size_t pairs = ( chunks + 2 * width - 1 ) / ( 2 * width );
+    MDAL::parallelFor( pairs, [&]( size_t pair )
+    {
+      const size_t first = 2 * width * pair;
+      const size_t middle = std::min( first + width, chunks );
+      const size_t last = std::min( first + 2 * width, chunks );
+      if ( middle < last )
+        std::inplace_merge( keys.begin() + static_cast<std::ptrdiff_t>( bounds[first] ),
+                            keys.begin() + static_cast<std::ptrdiff_t>( bounds[middle] ),
+                            keys.begin() + static_cast<std::ptrdiff_t>( bounds[last] ) );
+    } );
+  }
+}
+
+MDAL::MeshTopology::MeshTopology( MDAL::Mesh *mesh )
+{
+  assert( mesh->verticesCount() <= std::numeric_limits<uint32_t>::max() );
+  assert( mesh->facesCount() <= std::numeric_limits<uint32_t>::max() );
+
+  // faces are read once for all relations
+  const size_t facesCount = mesh->facesCount();
+  const size_t blockSize = 65536;
+  const size_t faceVerticesMax = std::max( mesh->faceVerticesMaximumCount(), size_t( 1 ) );
+  std::vector<int> faceOffsets( std::min( facesCount, blockSize ) );
+  std::vector<int> vertexIndices( faceOffsets.size() * faceVerticesMax );
+  std::unique_ptr<MeshFaceIterator> faceIterator = mesh->readFaces();
+  mFaces.offsets.reserve( facesCount + 1 );
+  mFaces.offsets.push_back( 0 );
+  while ( mFaces.rowsCount() < facesCount )
+  {
+    const size_t facesRead = faceIterator->next( faceOffsets.size(), faceOffsets.data(),
+                             vertexIndices.size(), vertexIndices.data() );
+    if ( facesRead == 0 )
+      break;
+
+    const size_t firstIndex = mFaces.items.size();
+    for ( size_t i = 0; i < static_cast<size_t>( faceOffsets[facesRead - 1] ); ++i )
+      mFaces.items.push_back( static_cast<uint32_t>( vertexIndices[i] ) );
+    for ( size_t i = 0; i < facesRead; ++i )
+      mFaces.offsets.push_back( firstIndex + static_cast<size_t>( faceOffsets[i] ) );
+  }
+
+  buildVertexFaces( mesh->verticesCount() );
+  buildFaceNeighbours();
+
+  const std::vector<uint32_t> &fileEdges = mesh->fileEdges();
+  if ( fileEdges.empty() )
+    buildEdges();
+  else
+    mEdges.assign( fileEdges.begin(), fileEdges.end() );
+
+  mFaces = AdjacencyRows();
+}
+
+void MDAL::MeshTopology::buildVertexFaces( size_t verticesCount )
+{
+  // faces are added in ascending order, vertex repeated in the face is counted once
+  const uint32_t noFace = std::numeric_limits<uint32_t>::max();
+  SpillVector<uint32_t> lastFace( verticesCount, noFace );
+  mVertexFaces.offsets.assign( verticesCount + 1, 0 );
+  for ( size_t f = 0; f < mFaces.rowsCount(); ++f )
+  {
+    const uint32_t *face = mFaces.row( f );
+    for ( size_t j = 0; j < mFaces.rowSize( f ); ++j )
+    {
+      if ( face[j] >= verticesCount || lastFace[face[j]] == f )
+        continue;
+      lastFace[face[j]] = static_cast<uint32_t>( f );
+      ++mVertexFaces.offsets[face[j] + 1];
+    }
+  }
+
+  for ( size_t v = 0; v < verticesCount; ++v )
+    mVertexFaces.offsets[v + 1] += mVertexFaces.offsets[v];
+
+  mVertexFaces.items.resize( mVertexFaces.offsets[verticesCount] );
+  SpillVector<size_t> position( mVertexFaces.offsets.begin(), mVertexFaces.offsets.end() - 1 );
+  std::fill( lastFace.begin(), lastFace.end(), noFace );
+  for ( size_t f = 0; f < mFaces.rowsCount(); ++f )
+  {
+    const uint32_t *face = mFaces.row( f );
+    for ( size_t j = 0; j < mFaces.rowSize( f ); ++j )
+    {
+      if ( face[j] >= verticesCount || lastFace[face[j]] == f )
+        continue;
+      lastFace[face[j]] = static_cast<uint32_t>( f );
+      mVertexFaces.items[position[face[j]]++] = static_cast<uint32_t>( f );
+    }
+  }
+}
+
+void MDAL::MeshTopology::buildFaceNeighbours()
+{
+  const size_t facesCount = mFaces.rowsCount();
+  const size_t verticesCount = mVertexFaces.rowsCount();
+
+  // other faces using both vertices of any side of the face, sorted and unique
+  auto neighbours = [this, verticesCount]( size_t f, std::vector<uint32_t> &result )
+  {
+    result.clear();
+    const uint32_t *face = mFaces.row( f );
+    const size_t count = mFaces.rowSize( f );
+    for ( size_t j = 0; j < count; ++j )
+    {
+      const uint32_t a = face[j];
+      const uint32_t b = face[( j + 1 ) % count];
+      if ( a == b || a >= verticesCount || b >= verticesCount )
+        continue;
+
+      const uint32_t *facesA = mVertexFaces.row( a );
+      const uint32_t *facesB = mVertexFaces.row( b );
+      const uint32_t *endA = facesA + mVertexFaces.rowSize( a );
+      const uint32_t *endB = facesB + mVertexFaces.rowSize( b );
+      while ( facesA != endA && facesB != endB )
+      {
+        if ( *facesA < *facesB )
+          ++facesA;
+        else if ( *facesB < *facesA )
+          ++facesB;
+        else
+        {
+          if ( *facesA != f )
+            result.push_back( *facesA );
+          ++facesA;
+          ++facesB;
+        }
+      }
+    }
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+  };
+
+  // the neighbours are found twice, to count them and to store them, so no locking is needed
+  const size_t blockCount = ( facesCount + BLOCK_FACES - 1 ) / BLOCK_FACES;
+  mFaceNeighbours.offsets.assign( facesCount + 1, 0 );
+  parallelFor( blockCount, [&]( size_t block )
+  {
+    std::vector<uint32_t> result;
+    const size_t end = std::min( facesCount, ( block + 1 ) * BLOCK_FACES );
+    for ( size_t f = block * BLOCK_FACES; f < end; ++f )
+    {
+      neighbours( f, result );
+      mFaceNeighbours.offsets[f + 1] = result.size();
+    }
+  } );
+
+  for ( size_t f = 0; f < facesCount; ++f )
+    mFaceNeighbours.offsets[f + 1] += mFaceNeighbours.offsets[f];
+
+  mFaceNeighbours.items.resize( mFaceNeighbours.offsets[facesCount] );
+  parallelFor( blockCount, [&]( size_t block )
+  {
+    std::vector<uint32_t> result;
+    const size_t end = std::min( facesCount, ( block + 1 ) * BLOCK_FACES );
+    for ( size_t f = block * BLOCK_FACES; f < end; ++f )
+    {
+      neighbours( f, result );
+      std::copy( result.begin(), result.end(), mFaceNeighbours.items.begin() + static_cast<std::ptrdiff_t>( mFaceNeighbours.offsets[f] ) );
+    }
+  } );
+}
+
+void MDAL::MeshTopology::buildEdges()
+{
+  // every side of every face as ( lower vertex, higher vertex ) key, sorted and unique
+  const size_t facesCount = mFaces.rowsCount();
+  SpillVector<uint64_t> keys( mFaces.items.size() );
+  const size_t blockCount = ( facesCount + BLOCK_FACES - 1 ) / BLOCK_FACES;
+  parallelFor( blockCount, [&]( size_t block )
+  {
+    const size_t end = std::min( facesCount, ( block + 1 ) * BLOCK_FACES );
+    for ( size_t f = block * BLOCK_FACES; f < end; ++f )
+    {
+      const uint32_t *face = mFaces.row( f );
+      const size_t count = mFaces.rowSize( f );
+      for ( size_t j = 0; j < count; ++j )
+      {
+        const uint64_t a = face[j];
+        const uint64_t b = face[( j + 1 ) % count];
+        // degenerate sides get invalid key, removed after the sort
+        keys[mFaces.offsets[f] + j] = a == b ? std::numeric_limits<uint64_t>::max() :
+                                      ( std::min( a, b ) << 32 ) | std::max( a, b );
+      }
+    }
+  } );
+
+  _parallelSort( keys );
+  keys.erase( std::unique( keys.begin(), keys.end() ), keys.end() );
+  if ( !keys.empty() && keys.back() == std::numeric_limits<uint64_t>::max() )
+    keys.pop_back();
+
+  mEdges.resize( 2 * keys.size() );
+  for ( size_t i = 0; i < keys.size(); ++i )
+  {
+    mEdges[2 * i] = static_cast<uint32_t>( keys[i] >> 32 );
+    mEdges[2 * i + 1] = static_cast<uint32_t>( keys[i] & 0xFFFFFFFF );
+  }
+}
+
+MDAL::AdjacencyIterator::AdjacencyIterator( const MDAL::AdjacencyRows &rows )
+  : mRows( rows )
+  , mMaximumRowSize( rows.maximumRowSize() )
+{
+}
+
+size_t MDAL::AdjacencyIterator::next( size_t offsetsBufferLen,
+                                      int *offsetsBuffer,
+                                      size_t indicesBufferLen,
+                                      int *indicesBuffer )
+{
+  assert( offsetsBuffer );
+  assert( indicesBuffer );
+
+  const size_t rowsCount = mRows.rowsCount();
+  size_t row = 0;
+  size_t index = 0;
+  while ( mLastRow + row < rowsCount && row < offsetsBufferLen )
+  {
+    const size_t rowSize = mRows.rowSize( mLastRow + row );
+    if ( index + rowSize > indicesBufferLen )
+      break;
+
+    const uint32_t *items = mRows.row( mLastRow + row );
+    for ( size_t i = 0; i < rowSize; ++i )
+      indicesBuffer[index + i] = static_cast<int>( items[i] );
+    index += rowSize;
+
+    // offsets are relative to the first row returned in this batch
+    offsetsBuffer[row] = static_cast<int>( index );
+    ++row;
+  }
+
+  mLastRow += row;
+  return row;
+}
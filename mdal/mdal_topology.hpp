@@ -0,0 +1,104 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_TOPOLOGY_HPP
+#define MDAL_TOPOLOGY_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "mdal_spill.hpp"
+
+namespace MDAL
+{
+  class Mesh;
+
+  /**
+   * Relation stored in compressed rows
+   *
+   * Row i consists of the items at positions offsets[i] ... offsets[i + 1] - 1
+   */
+  struct AdjacencyRows
+  {
+    SpillVector<size_t> offsets;
+    SpillVector<uint32_t> items;
+
+    size_t rowsCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    size_t rowSize( size_t row ) const
+    {
+      assert( row + 1 < offsets.size() );
+      return offsets[row + 1] - offsets[row];
+    }
+
+    const uint32_t *row( size_t row ) const
+    {
+      assert( row < offsets.size() );
+      return items.data() + offsets[row];
+    }
+
+    //! Number of items of the longest row
+    size_t maximumRowSize() const;
+  };
+
+  /**
+   * Adjacency of the vertices and faces of the mesh, built by Mesh::topology() on first request
+   *
+   * Vertex faces and face neighbours are found from the faces in parallel, edges are
+   * taken from the file when the driver set them (see Mesh::setFileEdges()), otherwise
+   * they are built by parallel sort of the sides of all faces.
+   * Vertex and face indices must fit into 32 bits.
+   */
+  class MeshTopology
+  {
+    public:
+      explicit MeshTopology( Mesh *mesh );
+
+      //! Faces using the vertex, in ascending order
+      const AdjacencyRows &vertexFaces() const { return mVertexFaces; }
+
+      //! Faces sharing a side with the face, in ascending order
+      const AdjacencyRows &faceNeighbours() const { return mFaceNeighbours; }
+
+      size_t edgesCount() const { return mEdges.size() / 2; }
+
+      //! Vertex indices of the edges, edge i connects vertices edges()[2 * i] and edges()[2 * i + 1]
+      const SpillVector<uint32_t> &edges() const { return mEdges; }
+
+    private:
+      void buildVertexFaces( size_t verticesCount );
+      void buildFaceNeighbours();
+      void buildEdges();
+
+      //! Faces of the mesh read for the build, released afterwards
+      AdjacencyRows mFaces;
+
+      AdjacencyRows mVertexFaces;
+      AdjacencyRows mFaceNeighbours;
+      SpillVector<uint32_t> mEdges;
+  };
+
+  //! Iterates the rows of the relation, see MDAL_AI_next()
+  class AdjacencyIterator
+  {
+    public:
+      explicit AdjacencyIterator( const AdjacencyRows &rows );
+
+      size_t next( size_t offsetsBufferLen,
+                   int *offsetsBuffer,
+                   size_t indicesBufferLen,
+                   int *indicesBuffer );
+
+      size_t maximumRowSize() const { return mMaximumRowSize; }
+
+    private:
+      const AdjacencyRows &mRows;
+      size_t mMaximumRowSize = 0;
+      size_t mLastRow = 0;
+  };
+
+} // namespace MDAL
+#endif //MDAL_TOPOLOGY_HPP
@@ -4,24 +4,61 @@
 */
 
 #include "mdal_utils.hpp"
+#include "mdal_options.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_perf.hpp"
+#include "mdal_quantile_sketch.hpp"
+#include "mdal_remote.hpp"
+#include "mdal_simd.hpp"
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <iomanip>
+#include <locale>
 #include <math.h>
 #include <assert.h>
 #include <cmath>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 bool MDAL::fileExists( const std::string &filename )
 {
+  if ( isRemoteUri( filename ) )
+    return RemoteFile::open( filename ) != nullptr;
+
   std::ifstream in( filename );
   return in.good();
 }
 
+bool MDAL::fileSizeAndModificationTime( const std::string &filename, int64_t &size, int64_t &modificationTime )
+{
+#ifdef _WIN32
+  struct _stat64 st;
+  if ( _stat64( filename.c_str(), &st ) != 0 )
+    return false;
+#else
+  struct stat st;
+  if ( stat( filename.c_str(), &st ) != 0 )
+    return false;
+#endif
+  size = static_cast<int64_t>( st.st_size );
+  // nanoseconds where available, so a file rewritten within the same second is seen as changed
+#if defined(__APPLE__)
+  modificationTime = static_cast<int64_t>( st.st_mtimespec.tv_sec ) * 1000000000 + static_cast<int64_t>( st.st_mtimespec.tv_nsec );
+#elif defined(_WIN32)
+  modificationTime = static_cast<int64_t>( st.st_mtime ) * 1000000000;
+#else
+  modificationTime = static_cast<int64_t>( st.st_mtim.tv_sec ) * 1000000000 + static_cast<int64_t>( st.st_mtim.tv_nsec );
+#endif
+  return true;
+}
+
 std::string MDAL::readFileToString( const std::string &filename )
 {
   if ( MDAL::fileExists( filename ) )
@@ -104,6 +141,55 @@ std::vector<std::string> MDAL::split( const std::string &str,
   return list;
 }
 
+static bool _isWhiteSpace( char c )
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+MDAL::StringSpan MDAL::nextLine( const char *&ptr, const char *end )
+{
+  StringSpan line;
+  line.begin = ptr;
+  const char *lineEnd = static_cast<const char *>( memchr( ptr, '\n', static_cast<size_t>( end - ptr ) ) );
+  if ( lineEnd )
+  {
+    line.end = lineEnd;
+    ptr = lineEnd + 1;
+  }
+  else
+  {
+    line.end = end;
+    ptr = end;
+  }
+  return line;
+}
+
+size_t MDAL::split( const char *begin, const char *end, StringSpan *tokens, size_t maxTokens )
+{
+  size_t count = 0;
+  const char *ptr = begin;
+  while ( true )
+  {
+    while ( ptr < end && _isWhiteSpace( *ptr ) )
+      ++ptr;
+
+    if ( ptr == end )
+      break;
+
+    const char *tokenBegin = ptr;
+    while ( ptr < end && !_isWhiteSpace( *ptr ) )
+      ++ptr;
+
+    if ( count < maxTokens )
+    {
+      tokens[count].begin = tokenBegin;
+      tokens[count].end = ptr;
+    }
+    ++count;
+  }
+  return count;
+}
+
 size_t MDAL::toSizeT( const std::string &str )
 {
   int i = atoi( str.c_str() );
@@ -125,6 +211,158 @@ double MDAL::toDouble( const std::string &str )
   return atof( str.c_str() );
 }
 
+size_t MDAL::toSizeT( const char *begin, const char *end )
+{
+  const char *ptr = begin;
+  if ( ptr < end && ( *ptr == '+' || *ptr == '-' ) )
+  {
+    if ( *ptr == '-' ) // consistent with atoi return
+      return 0;
+    ++ptr;
+  }
+
+  size_t value = 0;
+  while ( ptr < end && *ptr >= '0' && *ptr <= '9' )
+  {
+    value = value * 10 + static_cast<size_t>( *ptr - '0' );
+    ++ptr;
+  }
+  return value;
+}
+
+int MDAL::toInt( const char *begin, const char *end )
+{
+  const char *ptr = begin;
+  bool negative = false;
+  if ( ptr < end && ( *ptr == '+' || *ptr == '-' ) )
+  {
+    negative = ( *ptr == '-' );
+    ++ptr;
+  }
+
+  long long value = 0;
+  while ( ptr < end && *ptr >= '0' && *ptr <= '9' )
+  {
+    // clamped as strtol does, atoi behaviour on overflow is undefined
+    if ( value <= std::numeric_limits<int>::max() )
+      value = value * 10 + ( *ptr - '0' );
+    ++ptr;
+  }
+  value = negative ? -value : value;
+  value = std::max<long long>( std::min<long long>( value, std::numeric_limits<int>::max() ), std::numeric_limits<int>::min() );
+  return static_cast<int>( value );
+}
+
+static double _toDoubleFallback( const char *begin, const char *end )
+{
+  const size_t len = static_cast<size_t>( end - begin );
+  char buffer[64];
+  if ( len < sizeof( buffer ) )
+  {
+    memcpy( buffer, begin, len );
+    buffer[len] = '\0';
+    return atof( buffer );
+  }
+  return atof( std::string( begin, end ).c_str() );
+}
+
+double MDAL::toDouble( const char *begin, const char *end )
+{
+  // powers of 10 that are exactly representable in double
+  static const double sPowersOf10[] =
+  {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const int maxExactExponent = 22;
+  const uint64_t maxExactMantissa = static_cast<uint64_t>( 1 ) << 53;
+
+  const char *ptr = begin;
+  bool negative = false;
+  if ( ptr < end && ( *ptr == '+' || *ptr == '-' ) )
+  {
+    negative = ( *ptr == '-' );
+    ++ptr;
+  }
+
+  uint64_t mantissa = 0;
+  int significantDigits = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+
+  while ( ptr < end && *ptr >= '0' && *ptr <= '9' )
+  {
+    hasDigits = true;
+    if ( mantissa != 0 || *ptr != '0' )
+    {
+      if ( ++significantDigits > 19 )
+        return _toDoubleFallback( begin, end );
+      mantissa = mantissa * 10 + static_cast<uint64_t>( *ptr - '0' );
+    }
+    ++ptr;
+  }
+
+  if ( ptr < end && *ptr == '.' )
+  {
+    ++ptr;
+    while ( ptr < end && *ptr >= '0' && *ptr <= '9' )
+    {
+      hasDigits = true;
+      if ( mantissa != 0 || *ptr != '0' )
+      {
+        if ( ++significantDigits > 19 )
+          return _toDoubleFallback( begin, end );
+        mantissa = mantissa * 10 + static_cast<uint64_t>( *ptr - '0' );
+      }
+      --exponent;
+      ++ptr;
+    }
+  }
+
+  if ( !hasDigits )
+    return _toDoubleFallback( begin, end );
+
+  if ( ptr < end && ( *ptr == 'e' || *ptr == 'E' ) )
+  {
+    ++ptr;
+    bool negativeExponent = false;
+    if ( ptr < end && ( *ptr == '+' || *ptr == '-' ) )
+    {
+      negativeExponent = ( *ptr == '-' );
+      ++ptr;
+    }
+    if ( ptr == end || *ptr < '0' || *ptr > '9' )
+      return _toDoubleFallback( begin, end );
+
+    int explicitExponent = 0;
+    while ( ptr < end && *ptr >= '0' && *ptr <= '9' )
+    {
+      if ( explicitExponent < 10000 )
+        explicitExponent = explicitExponent * 10 + ( *ptr - '0' );
+      ++ptr;
+    }
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  // trailing characters (nan, inf, hex, ...) or value not exactly representable
+  if ( ptr != end || mantissa > maxExactMantissa )
+    return _toDoubleFallback( begin, end );
+
+  double value = static_cast<double>( mantissa );
+  if ( mantissa != 0 )
+  {
+    if ( exponent < -maxExactExponent || exponent > maxExactExponent )
+      return _toDoubleFallback( begin, end );
+
+    if ( exponent < 0 )
+      value /= sPowersOf10[-exponent];
+    else
+      value *= sPowersOf10[exponent];
+  }
+
+  return negative ? -value : value;
+}
+
 int MDAL::toInt( const std::string &str )
 {
   return atoi( str.c_str() );
@@ -331,6 +569,22 @@ MDAL::BBox MDAL::computeExtent( const MDAL::Vertices &vertices )
   return b;
 }
 
+MDAL::BBox MDAL::computeExtent( const MDAL::VertexArrays &vertices )
+{
+  BBox b;
+
+  if ( vertices.empty() )
+    return b;
+
+  const double *x = vertices.x();
+  const double *y = vertices.y();
+  b.minX = *std::min_element( x, x + vertices.size() );
+  b.maxX = *std::max_element( x, x + vertices.size() );
+  b.minY = *std::min_element( y, y + vertices.size() );
+  b.maxY = *std::max_element( y, y + vertices.size() );
+  return b;
+}
+
 bool MDAL::equals( double val1, double val2, double eps )
 {
   return fabs( val1 - val2 ) < eps;
@@ -398,50 +652,56 @@ std::string MDAL::getCurrentTimeStamp()
   return s;
 }
 
-MDAL::Statistics _calculateStatistics( const std::vector<double> &values, size_t count, bool isVector )
+//! Adds the values (magnitudes for vectors) to the sketch, which finds their minimum and maximum too
+static void _addToSketch( const double *values, size_t count, bool isVector, MDAL::QuantileSketch &sketch )
 {
-  MDAL::Statistics ret;
+  if ( !isVector )
+  {
+    sketch.add( values, count );
+    return;
+  }
 
-  double min = std::numeric_limits<double>::quiet_NaN();
-  double max = std::numeric_limits<double>::quiet_NaN();
-  bool firstIteration = true;
+  const size_t blockSize = 4096;
+  double magnitudes[blockSize];
+  for ( size_t start = 0; start < count; start += blockSize )
+  {
+    const size_t blockCount = std::min( blockSize, count - start );
+    MDAL::magnitude( values + 2 * start, blockCount, magnitudes );
+    sketch.add( magnitudes, blockCount );
+  }
+}
 
-  for ( size_t i = 0; i < count; ++i )
+static MDAL::Statistics _statisticsOfSketch( const std::shared_ptr<MDAL::QuantileSketch> &sketch )
+{
+  MDAL::Statistics ret;
+  ret.minimum = sketch->minimum();
+  ret.maximum = sketch->maximum();
+  ret.sketch = sketch;
+  return ret;
+}
+
+static MDAL::Statistics _calculateStatistics( const double *values, size_t count, bool isVector, bool withSketch )
+{
+  if ( withSketch )
   {
-    double magnitude;
-    if ( isVector )
-    {
-      double x = values[2 * i];
-      double y = values[2 * i + 1];
-      if ( std::isnan( x ) || std::isnan( y ) )
-        continue;
-      magnitude = sqrt( x * x + y * y );
-    }
-    else
-    {
-      double x = values[i];
-      if ( std::isnan( x ) )
-        continue;
-      magnitude = x;
-    }
+    std::shared_ptr<MDAL::QuantileSketch> sketch = std::make_shared<MDAL::QuantileSketch>();
+    _addToSketch( values, count, isVector, *sketch );
+    return _statisticsOfSketch( sketch );
+  }
 
-    if ( firstIteration )
-    {
-      firstIteration = false;
-      min = magnitude;
-      max = magnitude;
-    }
-    else
-    {
-      if ( magnitude < min )
-      {
-        min = magnitude;
-      }
-      if ( magnitude > max )
-      {
-        max = magnitude;
-      }
-    }
+  MDAL::Statistics ret;
+
+  double min, max;
+  if ( isVector )
+  {
+    // compare squared magnitudes, sqrt is monotonic so it is enough to apply it on the result
+    MDAL::minMaxSquaredMagnitude( values, count, min, max );
+    min = sqrt( min );
+    max = sqrt( max );
+  }
+  else
+  {
+    MDAL::minMax( values, count, min, max );
   }
 
   ret.minimum = min;
@@ -455,6 +715,11 @@ MDAL::Statistics MDAL::calculateStatistics( std::shared_ptr<MDAL::DatasetGroup>
 }
 
 MDAL::Statistics MDAL::calculateStatistics( DatasetGroup *grp )
+{
+  return calculateStatistics( grp, false );
+}
+
+MDAL::Statistics MDAL::calculateStatistics( DatasetGroup *grp, bool withSketch )
 {
   Statistics ret;
   if ( !grp )
@@ -462,7 +727,7 @@ MDAL::Statistics MDAL::calculateStatistics( DatasetGroup *grp )
 
   for ( std::shared_ptr<Dataset> ds : grp->datasets )
   {
-    MDAL::Statistics dsStats = ds->statistics();
+    MDAL::Statistics dsStats = withSketch ? ds->statisticsWithSketch() : ds->statistics();
     combineStatistics( ret, dsStats );
   }
   return ret;
@@ -470,54 +735,194 @@ MDAL::Statistics MDAL::calculateStatistics( DatasetGroup *grp )
 
 MDAL::Statistics MDAL::calculateStatistics( std::shared_ptr<Dataset> dataset )
 {
-  Statistics ret;
-  if ( !dataset )
-    return ret;
+  return calculateStatistics( dataset.get() );
+}
+
+//! Reads the dataset in chunks, the caller is responsible for locking
+static MDAL::Statistics _calculateDatasetStatistics( MDAL::Dataset *dataset, bool withSketch )
+{
+  MDAL::Statistics ret;
+  std::shared_ptr<MDAL::QuantileSketch> sketch;
+  if ( withSketch )
+    sketch = std::make_shared<MDAL::QuantileSketch>();
 
   bool isVector = !dataset->group()->isScalar();
   bool is3D = dataset->group()->dataLocation() == MDAL_DataLocation::DataOnVolumes3D;
   size_t bufLen = 2000;
   std::vector<double> buffer( isVector ? bufLen * 2 : bufLen );
 
+  const size_t valuesCount = dataset->valuesCount();
   size_t i = 0;
-  while ( i < dataset->valuesCount() )
+  while ( i < valuesCount )
   {
+    // drivers expect the range within the values, as checked by the C API
+    const size_t readCount = std::min( bufLen, valuesCount - i );
     size_t valsRead;
     if ( is3D )
     {
       if ( isVector )
       {
-        valsRead = dataset->vectorVolumesData( i, bufLen, buffer.data() );
+        valsRead = dataset->vectorVolumesData( i, readCount, buffer.data() );
       }
       else
       {
-        valsRead = dataset->scalarVolumesData( i, bufLen, buffer.data() );
+        valsRead = dataset->scalarVolumesData( i, readCount, buffer.data() );
       }
     }
     else
     {
       if ( isVector )
       {
-        valsRead = dataset->vectorData( i, bufLen, buffer.data() );
+        valsRead = dataset->vectorData( i, readCount, buffer.data() );
       }
       else
       {
-        valsRead = dataset->scalarData( i, bufLen, buffer.data() );
+        valsRead = dataset->scalarData( i, readCount, buffer.data() );
       }
     }
     if ( valsRead == 0 )
-      return ret;
+      break;
 
-    MDAL::Statistics dsStats = _calculateStatistics( buffer, valsRead, isVector );
-    combineStatistics( ret, dsStats );
+    if ( sketch )
+    {
+      _addToSketch( buffer.data(), valsRead, isVector, *sketch );
+    }
+    else
+    {
+      MDAL::Statistics dsStats = _calculateStatistics( buffer.data(), valsRead, isVector, false );
+      combineStatistics( ret, dsStats );
+    }
     i += valsRead;
   }
 
-  return ret;
+  return sketch ? _statisticsOfSketch( sketch ) : ret;
+}
+
+MDAL::Statistics MDAL::calculateStatistics( Dataset *dataset )
+{
+  return calculateStatistics( dataset, openOptionAsBool( OPTION_QUANTILE_SKETCH ) );
+}
+
+MDAL::Statistics MDAL::calculateStatistics( Dataset *dataset, bool withSketch )
+{
+  if ( !dataset )
+    return Statistics();
+
+  MDAL_PERF_SCOPE( perfScope, "statistics", PerfCounter::StatisticsCalculations, PerfCounter::StatisticsTime, dataset->group()->name() );
+  // values of double precision memory datasets are read directly, without copy
+  MemoryDataset2D *memoryDataset = dynamic_cast<MemoryDataset2D *>( dataset );
+  if ( memoryDataset && memoryDataset->values() )
+    return _calculateStatistics( memoryDataset->values(), memoryDataset->valuesCount(), !dataset->group()->isScalar(), withSketch );
+
+  DatasetReadLock lock( dataset );
+  return _calculateDatasetStatistics( dataset, withSketch );
+}
+
+MDAL::Statistics MDAL::calculateStatistics( const double *values, size_t count, bool isVector )
+{
+  return _calculateStatistics( values, count, isVector, openOptionAsBool( OPTION_QUANTILE_SKETCH ) );
+}
+
+void MDAL::updateStatistics( std::shared_ptr<DatasetGroup> grp )
+{
+  updateStatistics( grp.get() );
+}
+
+void MDAL::updateStatistics( DatasetGroup *grp )
+{
+  if ( !grp || openOptionAsBool( OPTION_LAZY_STATISTICS ) )
+    return;
+
+  // options may be overridden for the calling thread only, so they are not read by the workers
+  const bool withSketch = openOptionAsBool( OPTION_QUANTILE_SKETCH );
+
+  // Only in-memory datasets are safe to be read concurrently,
+  // the other datasets read from the file and the underlying libraries are not thread-safe
+  std::vector<std::shared_ptr<Dataset>> memoryDatasets;
+  size_t memoryValuesCount = 0;
+  for ( const std::shared_ptr<Dataset> &ds : grp->datasets )
+  {
+    // already calculated by the driver
+    if ( ds->hasStatistics() )
+      continue;
+
+    if ( dynamic_cast<MemoryDataset2D *>( ds.get() ) )
+    {
+      memoryDatasets.push_back( ds );
+      memoryValuesCount += ds->valuesCount();
+    }
+    else
+    {
+      ds->setStatistics( calculateStatistics( ds.get(), withSketch ) );
+    }
+  }
+
+  // for small groups, it is faster to not start the threads at all
+  const size_t minValuesCountForThreads = 1000000;
+  if ( memoryValuesCount < minValuesCountForThreads )
+  {
+    for ( const std::shared_ptr<Dataset> &ds : memoryDatasets )
+      ds->setStatistics( calculateStatistics( ds.get(), withSketch ) );
+  }
+  else
+  {
+    parallelFor( memoryDatasets.size(), [&memoryDatasets, withSketch]( size_t i )
+    {
+      memoryDatasets[i]->setStatistics( calculateStatistics( memoryDatasets[i].get(), withSketch ) );
+    } );
+  }
+
+  grp->setStatistics( calculateStatistics( grp ) );
+}
+
+void MDAL::updateStatistics( std::shared_ptr<Dataset> dataset )
+{
+  if ( !dataset || openOptionAsBool( OPTION_LAZY_STATISTICS ) )
+    return;
+
+  dataset->setStatistics( calculateStatistics( dataset ) );
+}
+
+void MDAL::updateStatisticsInParallel( const std::vector<std::shared_ptr<Dataset>> &datasets )
+{
+  if ( openOptionAsBool( OPTION_LAZY_STATISTICS ) )
+    return;
+
+  const bool withSketch = openOptionAsBool( OPTION_QUANTILE_SKETCH );
+
+  // the calling thread holds the library lock for the workers, which must not take it
+  parallelFor( datasets.size(), [&datasets, withSketch]( size_t i )
+  {
+    Dataset *dataset = datasets[i].get();
+    if ( dataset->hasStatistics() )
+      return;
+
+    if ( dynamic_cast<MemoryDataset2D *>( dataset ) )
+      dataset->setStatistics( calculateStatistics( dataset, withSketch ) );
+    else
+      dataset->setStatistics( _calculateDatasetStatistics( dataset, withSketch ) );
+  } );
 }
 
 void MDAL::combineStatistics( MDAL::Statistics &main, const MDAL::Statistics &other )
 {
+  // main without values takes the sketch of the other, the sketch is dropped when other values are not sketched
+  if ( main.sketch && other.sketch )
+  {
+    std::shared_ptr<QuantileSketch> merged = std::make_shared<QuantileSketch>( *main.sketch );
+    merged->merge( *other.sketch );
+    main.sketch = merged;
+  }
+  else if ( other.sketch )
+  {
+    if ( std::isnan( main.minimum ) && std::isnan( main.maximum ) )
+      main.sketch = other.sketch;
+  }
+  else if ( !std::isnan( other.minimum ) )
+  {
+    main.sketch.reset();
+  }
+
   if ( std::isnan( main.minimum ) ||
        ( !std::isnan( other.minimum ) && ( main.minimum > other.minimum ) ) )
   {
@@ -531,7 +936,8 @@ void MDAL::combineStatistics( MDAL::Statistics &main, const MDAL::Statistics &ot
   }
 }
 
-void MDAL::addBedElevationDatasetGroup( MDAL::Mesh *mesh, const Vertices &vertices )
+//! Adds scalar dataset group defined on vertices with single dataset
+static void _addVertexScalarDatasetGroup( MDAL::Mesh *mesh, const double *values, size_t count, const std::string &name )
 {
   if ( !mesh )
     return;
@@ -539,27 +945,40 @@ void MDAL::addBedElevationDatasetGroup( MDAL::Mesh *mesh, const Vertices &vertic
   if ( 0 == mesh->facesCount() )
     return;
 
-  std::shared_ptr<DatasetGroup> group = std::make_shared< DatasetGroup >(
-                                          mesh->driverName(),
-                                          mesh,
-                                          mesh->uri(),
-                                          "Bed Elevation"
-                                        );
+  std::shared_ptr<MDAL::DatasetGroup> group = std::make_shared< MDAL::DatasetGroup >(
+        mesh->driverName(),
+        mesh,
+        mesh->uri(),
+        name
+      );
   group->setDataLocation( MDAL_DataLocation::DataOnVertices2D );
   group->setIsScalar( true );
 
-  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group.get() );
+  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MDAL::MemoryDataset2D >( group.get() );
   dataset->setTime( 0.0 );
-  for ( size_t i = 0; i < vertices.size(); ++i )
-  {
-    dataset->setScalarValue( i, vertices[i].z );
-  }
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+  assert( dataset->valuesCount() == count );
+  if ( count > 0 )
+    dataset->setValues( values );
+  MDAL::updateStatistics( dataset );
   group->datasets.push_back( dataset );
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+  MDAL::updateStatistics( group );
   mesh->datasetGroups.push_back( group );
 }
 
+void MDAL::addBedElevationDatasetGroup( MDAL::Mesh *mesh, const Vertices &vertices )
+{
+  std::vector<double> elevations( vertices.size() );
+  for ( size_t i = 0; i < vertices.size(); ++i )
+    elevations[i] = vertices[i].z;
+
+  _addVertexScalarDatasetGroup( mesh, elevations.data(), elevations.size(), "Bed Elevation" );
+}
+
+void MDAL::addBedElevationDatasetGroup( MDAL::Mesh *mesh, const VertexArrays &vertices )
+{
+  _addVertexScalarDatasetGroup( mesh, vertices.z(), vertices.size(), "Bed Elevation" );
+}
+
 void MDAL::addFaceScalarDatasetGroup( MDAL::Mesh *mesh,
                                       const std::vector<double> &values,
                                       const std::string &name )
@@ -586,10 +1005,10 @@ void MDAL::addFaceScalarDatasetGroup( MDAL::Mesh *mesh,
 
   std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared< MemoryDataset2D >( group.get() );
   dataset->setTime( 0.0 );
-  memcpy( dataset->values(), values.data(), sizeof( double )*values.size() );
-  dataset->setStatistics( MDAL::calculateStatistics( dataset ) );
+  dataset->setValues( values.data() );
+  MDAL::updateStatistics( dataset );
   group->datasets.push_back( dataset );
-  group->setStatistics( MDAL::calculateStatistics( group ) );
+  MDAL::updateStatistics( group );
   mesh->datasetGroups.push_back( group );
 }
 
@@ -600,6 +1019,11 @@ bool MDAL::isNativeLittleEndian()
   return ( *( char * )&n == 1 );
 }
 
+void MDAL::changeEndianness( void *values, size_t valueSize, size_t count )
+{
+  MDAL::byteSwap( values, valueSize, count );
+}
+
 std::string MDAL::coordinateToString( double coordinate, int precision )
 {
 
@@ -638,6 +1062,105 @@ std::string MDAL::doubleToString( double value, int precision )
   return oss.str();
 }
 
+static size_t _unsignedToChars( uint64_t value, char *buffer )
+{
+  char digits[MDAL::MAX_NUMBER_CHARS];
+  size_t count = 0;
+  do
+  {
+    digits[count++] = static_cast<char>( '0' + value % 10 );
+    value /= 10;
+  }
+  while ( value > 0 );
+
+  for ( size_t i = 0; i < count; ++i )
+    buffer[i] = digits[count - 1 - i];
+  return count;
+}
+
+static std::ostringstream _classicOutputStream()
+{
+  std::ostringstream stream;
+  stream.imbue( std::locale::classic() );
+  return stream;
+}
+
+static std::istringstream _classicInputStream()
+{
+  std::istringstream stream;
+  stream.imbue( std::locale::classic() );
+  return stream;
+}
+
+size_t MDAL::doubleToChars( double value, char *buffer )
+{
+  // fast path for values with a few decimal digits, e.g. coordinates
+  // m / 10^d is correctly rounded as the parsing of the decimal text, so the check is exact
+  static const double powers[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+  static const size_t maxDecimals = sizeof( powers ) / sizeof( powers[0] ) - 1;
+  const double absValue = std::fabs( value );
+  if ( absValue < 1e15 )
+  {
+    for ( size_t decimals = 0; decimals <= maxDecimals; ++decimals )
+    {
+      const double scaled = absValue * powers[decimals];
+      if ( scaled >= 9007199254740992.0 ) // 2^53
+        break;
+
+      const uint64_t mantissa = static_cast<uint64_t>( scaled + 0.5 );
+      if ( static_cast<double>( mantissa ) / powers[decimals] != absValue )
+        continue;
+
+      size_t length = 0;
+      if ( std::signbit( value ) && mantissa != 0 )
+        buffer[length++] = '-';
+      const uint64_t divisor = static_cast<uint64_t>( powers[decimals] );
+      length += _unsignedToChars( mantissa / divisor, buffer + length );
+      if ( decimals > 0 )
+      {
+        buffer[length++] = '.';
+        uint64_t fraction = mantissa % divisor;
+        for ( size_t i = decimals; i > 0; --i )
+        {
+          buffer[length + i - 1] = static_cast<char>( '0' + fraction % 10 );
+          fraction /= 10;
+        }
+        length += decimals;
+      }
+      return length;
+    }
+  }
+
+  // streams in the classic locale, the decimal separator of the C locale of the process may differ
+  static thread_local std::ostringstream tOutput = _classicOutputStream();
+  static thread_local std::istringstream tInput = _classicInputStream();
+  std::string text;
+  // 15 significant digits are exact for most of the values, 17 always round-trips
+  for ( int precision = 15; precision <= 17; ++precision )
+  {
+    tOutput.str( std::string() );
+    tOutput << std::setprecision( precision ) << value;
+    text = tOutput.str();
+    if ( !std::isfinite( value ) )
+      break;
+
+    double parsed = 0;
+    tInput.clear();
+    tInput.str( text );
+    if ( ( tInput >> parsed ) && parsed == value )
+      break;
+  }
+
+  const size_t length = std::min( text.size(), MAX_NUMBER_CHARS );
+  memcpy( buffer, text.data(), length );
+  return length;
+}
+
+size_t MDAL::sizeTToChars( size_t value, char *buffer )
+{
+  return _unsignedToChars( value, buffer );
+}
+
 std::string MDAL::prependZero( const std::string &str, size_t length )
 {
   if ( length <= str.size() )
@@ -9,6 +9,7 @@
 #include <string>
 #include <vector>
 #include <stddef.h>
+#include <stdint.h>
 #include <limits>
 #include <sstream>
 #include <fstream>
@@ -39,6 +40,8 @@ namespace MDAL
 
   /** Return whether file exists */
   bool fileExists( const std::string &filename );
+  /** Gets file size in bytes and modification time in nanoseconds, returns false if the file does not exist */
+  bool fileSizeAndModificationTime( const std::string &filename, int64_t &size, int64_t &modificationTime );
   std::string baseName( const std::string &filename );
   std::string dirName( const std::string &filename );
   std::string pathJoin( const std::string &path1, const std::string &path2 );
@@ -71,6 +74,26 @@ namespace MDAL
   double toDouble( const std::string &str );
   bool toBool( const std::string &str );
 
+  /**
+   * Parses unsigned integer from the characters [begin, end) without any allocation
+   * Return 0 if not possible to convert (consistent with toSizeT( const std::string & ))
+   */
+  size_t toSizeT( const char *begin, const char *end );
+
+  /**
+   * Parses number from the characters [begin, end) without any allocation
+   * Common decimal notations are converted in place, exactly; anything else
+   * falls back to atof, so the result is always the same as toDouble( const std::string & )
+   * Return 0 if not possible to convert
+   */
+  double toDouble( const char *begin, const char *end );
+
+  /**
+   * Parses integer from the characters [begin, end) without any allocation
+   * Return 0 if not possible to convert (consistent with toInt( const std::string & ))
+   */
+  int toInt( const char *begin, const char *end );
+
   //! Returns the string with a adapted format to coordinate
   //! precision is the number of digits after the digital point if fabs(value)>180 (seems to not be a geographic coordinate)
   //! precision+6 is the number of digits after the digital point if fabs(value)<=180 (could be a geographic coordinate)
@@ -80,6 +103,19 @@ namespace MDAL
   //! precision is the number of signifiant digits
   std::string doubleToString( double value, int precision = 6 );
 
+  //! Maximum number of characters written by doubleToChars() and sizeTToChars()
+  const size_t MAX_NUMBER_CHARS = 32;
+
+  /**
+   * Writes the shortest representation of the value with up to 17 significant digits
+   * which reads back to the same double, returns number of characters written
+   * No terminating null is written, the buffer must hold MAX_NUMBER_CHARS characters
+   */
+  size_t doubleToChars( double value, char *buffer );
+
+  //! Writes decimal digits of the value without allocation, returns number of characters written
+  size_t sizeTToChars( size_t value, char *buffer );
+
   /**
    * Splits by deliminer and skips empty parts.
    * Faster than version with std::string
@@ -89,6 +125,25 @@ namespace MDAL
   //! Splits by deliminer and skips empty parts
   std::vector<std::string> split( const std::string &str, const std::string &delimiter );
 
+  //! Range [begin, end) of characters in a text buffer, used to parse text without copies
+  struct StringSpan
+  {
+    const char *begin;
+    const char *end;
+  };
+
+  /**
+   * Returns the line starting at ptr without the end of line character
+   * and moves ptr to the beginning of the next line (or to end)
+   */
+  StringSpan nextLine( const char *&ptr, const char *end );
+
+  /**
+   * Splits [begin, end) by white spaces and skips empty parts without any allocation
+   * Stores up to maxTokens tokens, returns the count of all tokens on the line
+   */
+  size_t split( const char *begin, const char *end, StringSpan *tokens, size_t maxTokens );
+
   std::string join( const std::vector<std::string> parts, const std::string &delimiter );
 
   //! Right trim
@@ -108,6 +163,7 @@ namespace MDAL
 
   // extent
   BBox computeExtent( const Vertices &vertices );
+  BBox computeExtent( const VertexArrays &vertices );
 
   // time
   //! Returns a delimiter to get time in hours
@@ -116,18 +172,52 @@ namespace MDAL
   std::string getCurrentTimeStamp();
 
   // statistics
+  /**
+   * Combines other statistics to the main ones
+   * Quantile sketches are merged, main keeps no sketch when any of the combined statistics with values has none
+   */
   void combineStatistics( Statistics &main, const Statistics &other );
 
   //! Calculates statistics for dataset group
   Statistics calculateStatistics( std::shared_ptr<DatasetGroup> grp );
   Statistics calculateStatistics( DatasetGroup *grp );
+  //! Calculates statistics for dataset group, with sketch merged from the sketches of the datasets when withSketch is set
+  Statistics calculateStatistics( DatasetGroup *grp, bool withSketch );
 
-  //! Calculates statistics for dataset
+  //! Calculates statistics for dataset, with quantile sketch when QUANTILE_SKETCH open option is set
   Statistics calculateStatistics( std::shared_ptr<Dataset> dataset );
+  Statistics calculateStatistics( Dataset *dataset );
+  //! Calculates statistics for dataset, the sketch is built in the same pass over the values as the minimum and maximum
+  Statistics calculateStatistics( Dataset *dataset, bool withSketch );
+
+  //! Calculates statistics of the values, interleaved x and y for vectors, with quantile sketch when QUANTILE_SKETCH open option is set
+  Statistics calculateStatistics( const double *values, size_t count, bool isVector );
+
+  /**
+   * Calculates and sets statistics for all datasets of the group and for the group itself
+   * In-memory datasets of large groups are processed in parallel
+   *
+   * Does nothing when LAZY_STATISTICS open option is set, statistics are calculated on first request then
+   */
+  void updateStatistics( std::shared_ptr<DatasetGroup> grp );
+  void updateStatistics( DatasetGroup *grp );
+
+  //! Calculates and sets statistics for dataset, does nothing when LAZY_STATISTICS open option is set
+  void updateStatistics( std::shared_ptr<Dataset> dataset );
+
+  /**
+   * Calculates and sets statistics for the datasets on threadCount() threads
+   *
+   * To be used by drivers during the load only: the calling thread must hold libraryMutex()
+   * which the worker threads do not take, so the datasets must serialize the calls into
+   * the underlying library by themselves. Does nothing when LAZY_STATISTICS open option is set.
+   */
+  void updateStatisticsInParallel( const std::vector<std::shared_ptr<Dataset>> &datasets );
 
   // mesh & datasets
   //! Adds bed elevatiom dataset group to mesh
   void addBedElevationDatasetGroup( MDAL::Mesh *mesh, const Vertices &vertices );
+  void addBedElevationDatasetGroup( MDAL::Mesh *mesh, const VertexArrays &vertices );
   //! Adds altitude dataset group to mesh
   void addFaceScalarDatasetGroup( MDAL::Mesh *mesh, const std::vector<double> &values, const std::string &name );
 
@@ -146,6 +236,31 @@ namespace MDAL
     return true;
   }
 
+  //! Reverses the byte order of count 2, 4 or 8 bytes wide values in place
+  void changeEndianness( void *values, size_t valueSize, size_t count );
+
+  template<typename T>
+  void changeEndianness( T *values, size_t count )
+  {
+    changeEndianness( static_cast<void *>( values ), sizeof( T ), count );
+  }
+
+  /**
+   * Reads up to count values by a single read of the stream, option to change the endianness is provided
+   * \returns number of complete values read
+   */
+  template<typename T>
+  size_t readValues( T *values, size_t count, std::ifstream &in, bool changeEndianness = false )
+  {
+    in.read( reinterpret_cast<char *>( values ), static_cast<std::streamsize>( count * sizeof( T ) ) );
+    const size_t valuesRead = static_cast<size_t>( in.gcount() ) / sizeof( T );
+
+    if ( changeEndianness )
+      MDAL::changeEndianness( values, valuesRead );
+
+    return valuesRead;
+  }
+
   //! Prepend 0 to string to have n char
   std::string prependZero( const std::string &str, size_t length );
 
@@ -0,0 +1,132 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include "mdal_volume_iterator.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <limits>
+
+#include "mdal_data_model.hpp"
+#include "mdal_parallel.hpp"
+
+const size_t MDAL::DatasetVolumeIterator::BATCH_FACES;
+
+MDAL::DatasetVolumeIterator::DatasetVolumeIterator( MDAL::Dataset *dataset )
+  : mDataset( dataset )
+  , mIsScalar( dataset->group()->isScalar() )
+  , mFacesCount( dataset->mesh()->facesCount() )
+{
+}
+
+bool MDAL::DatasetVolumeIterator::readBatch()
+{
+  const size_t count = std::min( BATCH_FACES, mFacesCount - mFaceIndex );
+  mBatchStart = mFaceIndex;
+  mLevelCounts.resize( count );
+  mFaceToVolume.resize( count );
+  mLevels.clear();
+  mValues.clear();
+
+  DatasetReadLock lock( mDataset );
+  if ( mDataset->verticalLevelCountData( mBatchStart, count, mLevelCounts.data() ) != count ||
+       mDataset->faceToVolumeData( mBatchStart, count, mFaceToVolume.data() ) != count )
+  {
+    mLevelCounts.clear();
+    return false;
+  }
+
+  // the columns of the faces are usually consecutive, but take the whole range anyway
+  size_t volumesStart = std::numeric_limits<size_t>::max();
+  size_t volumesEnd = 0;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    if ( mLevelCounts[i] <= 0 )
+      continue;
+    if ( mFaceToVolume[i] < 0 )
+    {
+      mLevelCounts.clear();
+      return false;
+    }
+    const size_t first = static_cast<size_t>( mFaceToVolume[i] );
+    volumesStart = std::min( volumesStart, first );
+    volumesEnd = std::max( volumesEnd, first + static_cast<size_t>( mLevelCounts[i] ) );
+  }
+
+  if ( volumesEnd == 0 )
+    return true;
+
+  // z values of the face i begin at index faceToVolume[i] + i and have one item more than volumes
+  mVolumesStart = volumesStart;
+  mLevelsStart = volumesStart + mBatchStart;
+  const size_t volumesCount = volumesEnd - volumesStart;
+  const size_t levelsCount = volumesCount + count;
+  mLevels.resize( levelsCount );
+  mValues.resize( mIsScalar ? volumesCount : 2 * volumesCount );
+
+  const size_t levelsRead = mDataset->verticalLevelData( mLevelsStart, levelsCount, mLevels.data() );
+  const size_t valuesRead = mIsScalar ?
+                            mDataset->scalarVolumesData( mVolumesStart, volumesCount, mValues.data() ) :
+                            mDataset->vectorVolumesData( mVolumesStart, volumesCount, mValues.data() );
+  mLevels.resize( levelsRead );
+  if ( valuesRead != volumesCount )
+  {
+    mLevelCounts.clear();
+    return false;
+  }
+  return true;
+}
+
+size_t MDAL::DatasetVolumeIterator::next( size_t faceCount,
+    int *levelCounts,
+    size_t levelsBufferLen,
+    double *levels,
+    size_t valuesBufferLen,
+    double *values )
+{
+  assert( levelCounts );
+
+  const size_t valuesPerVolume = mIsScalar ? 1 : 2;
+  size_t faces = 0;
+  size_t levelsWritten = 0;
+  size_t valuesWritten = 0;
+  while ( faces < faceCount && mFaceIndex < mFacesCount )
+  {
+    if ( mFaceIndex < mBatchStart || mFaceIndex >= mBatchStart + mLevelCounts.size() )
+    {
+      if ( !readBatch() )
+        break;
+    }
+
+    const size_t i = mFaceIndex - mBatchStart;
+    const size_t levelCount = static_cast<size_t>( std::max( mLevelCounts[i], 0 ) );
+    if ( levelCount > 0 )
+    {
+      const size_t faceLevels = levelCount + 1;
+      const size_t faceValues = valuesPerVolume * levelCount;
+      if ( levelsWritten + faceLevels > levelsBufferLen || valuesWritten + faceValues > valuesBufferLen )
+        break;
+
+      const size_t levelsOffset = static_cast<size_t>( mFaceToVolume[i] ) + mFaceIndex - mLevelsStart;
+      const size_t valuesOffset = valuesPerVolume * ( static_cast<size_t>( mFaceToVolume[i] ) - mVolumesStart );
+      if ( levelsOffset + faceLevels > mLevels.size() )
+        break;
+
+      std::copy( mLevels.begin() + static_cast<std::ptrdiff_t>( levelsOffset ),
+                 mLevels.begin() + static_cast<std::ptrdiff_t>( levelsOffset + faceLevels ),
+                 levels + levelsWritten );
+      std::copy( mValues.begin() + static_cast<std::ptrdiff_t>( valuesOffset ),
+                 mValues.begin() + static_cast<std::ptrdiff_t>( valuesOffset + faceValues ),
+                 values + valuesWritten );
+      levelsWritten += faceLevels;
+      valuesWritten += faceValues;
+    }
+
+    levelCounts[faces] = static_cast<int>( levelCount );
+    ++faces;
+    ++mFaceIndex;
+  }
+  return faces;
+}
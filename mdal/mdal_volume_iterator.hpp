@@ -0,0 +1,65 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#ifndef MDAL_VOLUME_ITERATOR_HPP
+#define MDAL_VOLUME_ITERATOR_HPP
+
+#include <stddef.h>
+#include <vector>
+
+namespace MDAL
+{
+  class Dataset;
+
+  /**
+   * Iterator over the columns of volumes of 3D dataset (DataOnVolumes3D)
+   *
+   * For every 2D face returns the number of its vertical levels, the z values of
+   * its levels and the values of its volumes. The data are read from the dataset
+   * for large batches of consecutive faces, where each index space (level counts,
+   * level z values and volume values) is requested once by a single range.
+   */
+  class DatasetVolumeIterator
+  {
+    public:
+      //! Number of faces read from the dataset at once
+      static const size_t BATCH_FACES = 1 << 14;
+
+      DatasetVolumeIterator( Dataset *dataset );
+
+      /**
+       * Copies data of the next faces to the buffers
+       *
+       * Face with n > 0 levels writes n + 1 z values and n (scalar) or 2 * n (vector) values,
+       * face without levels writes nothing. Stops when the next face does not fit
+       * to one of the buffers, faceCount faces are written or the faces are exhausted.
+       * \returns number of faces written
+       */
+      size_t next( size_t faceCount,
+                   int *levelCounts,
+                   size_t levelsBufferLen,
+                   double *levels,
+                   size_t valuesBufferLen,
+                   double *values );
+
+    private:
+      //! Reads the batch of faces starting at mFaceIndex, returns false on error
+      bool readBatch();
+
+      Dataset *mDataset;
+      bool mIsScalar;
+      size_t mFacesCount;
+      size_t mFaceIndex = 0;
+
+      size_t mBatchStart = 0;
+      std::vector<int> mLevelCounts;
+      std::vector<int> mFaceToVolume;
+      size_t mLevelsStart = 0;
+      std::vector<double> mLevels;
+      size_t mVolumesStart = 0;
+      std::vector<double> mValues;
+  };
+} // namespace MDAL
+#endif //MDAL_VOLUME_ITERATOR_HPP
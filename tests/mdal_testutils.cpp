@@ -183,6 +183,39 @@ bool compareVectors( const std::vector<double> &a, const std::vector<double> &b
   return true;
 }
 
+bool compareDataBlock( DatasetGroupH group, int datasetIndexStart, int datasetCount, int indexStart, int count )
+{
+  const bool scalar = MDAL_G_hasScalarData( group );
+  const MDAL_DataType dataType = scalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const int valuesPerIndex = scalar ? 1 : 2;
+  const size_t blockSize = static_cast<size_t>( datasetCount * count * valuesPerIndex );
+
+  std::vector<double> timeMajor( blockSize );
+  std::vector<double> indexMajor( blockSize );
+  if ( MDAL_G_dataBlock( group, datasetIndexStart, datasetCount, indexStart, count, dataType, MDAL_DataBlockLayout::TimeMajor, timeMajor.data() ) != datasetCount * count )
+    return false;
+  if ( MDAL_G_dataBlock( group, datasetIndexStart, datasetCount, indexStart, count, dataType, MDAL_DataBlockLayout::IndexMajor, indexMajor.data() ) != datasetCount * count )
+    return false;
+
+  std::vector<double> expectedTimeMajor;
+  std::vector<double> expectedIndexMajor( blockSize );
+  for ( int i = 0; i < datasetCount; ++i )
+  {
+    DatasetH ds = MDAL_G_dataset( group, datasetIndexStart + i );
+    std::vector<double> values( static_cast<size_t>( count * valuesPerIndex ) );
+    if ( MDAL_D_data( ds, indexStart, count, dataType, values.data() ) != count )
+      return false;
+    expectedTimeMajor.insert( expectedTimeMajor.end(), values.begin(), values.end() );
+    for ( int j = 0; j < count; ++j )
+    {
+      for ( int k = 0; k < valuesPerIndex; ++k )
+        expectedIndexMajor[static_cast<size_t>( ( j * datasetCount + i ) * valuesPerIndex + k )] = values[static_cast<size_t>( j * valuesPerIndex + k )];
+    }
+  }
+
+  return compareVectors( timeMajor, expectedTimeMajor ) && compareVectors( indexMajor, expectedIndexMajor );
+}
+
 bool compareMeshFrames( MeshH meshA, MeshH meshB )
 {
   // Vertices
@@ -54,6 +54,9 @@ double getValue3DY( DatasetH dataset, int index );
 bool compareVectors( const std::vector<double> &a, const std::vector<double> &b );
 bool compareVectors( const std::vector<int> &a, const std::vector<int> &b );
 
+//! Compare values read by MDAL_G_dataBlock in both layouts with the values read by MDAL_D_data
+bool compareDataBlock( DatasetGroupH group, int datasetIndexStart, int datasetCount, int indexStart, int count );
+
 //! Same vertices (coords), faces and connectivity between them
 bool compareMeshFrames( MeshH meshA, MeshH meshB );
 
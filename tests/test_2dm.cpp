@@ -3,11 +3,22 @@
  Copyright (C) 2018 Peter Petrik (zilolv at gmail dot com)
 */
 #include "gtest/gtest.h"
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <string>
 
 //mdal
 #include "mdal.h"
 #include "mdal_testutils.hpp"
 #include "mdal_utils.hpp"
+#include "mdal_data_model.hpp"
+#include "mdal_memory_data_model.hpp"
+#include "mdal_spill.hpp"
 
 TEST( Mesh2DMTest, MissingFile )
 {
@@ -57,6 +68,7 @@ void _test_QuadAndTriangleFile( const std::string  &path )
 
   int maxCount = MDAL_M_faceVerticesMaximumCount( m );
   EXPECT_EQ( maxCount, 4 );
+  EXPECT_EQ( 0, MDAL_M_uniformFaceVerticesCount( m ) );
 
   std::string driverName = MDAL_M_driverName( m );
   EXPECT_EQ( driverName, "2DM" );
@@ -156,6 +168,7 @@ TEST( Mesh2DMTest, RegularGridFile )
   EXPECT_EQ( 4, f_v_count ); //quad
   int f_v = getFaceVerticesIndexAt( m, 0, 0 );
   EXPECT_EQ( 0, f_v );
+  EXPECT_EQ( 4, MDAL_M_uniformFaceVerticesCount( m ) );
 
   MDAL_CloseMesh( m );
 }
@@ -276,6 +289,81 @@ TEST( Mesh2DMTest, Basement3CellElevationTest )
 }
 
 
+TEST( Mesh2DMTest, ParallelParsing )
+{
+  // large enough to be split to several chunks
+  const int columns = 760;
+  const int rows = 760;
+  const int gap = 10; // IDs of the second half of the vertices are shifted
+  std::string path = tmp_file( "/parallel_parsing.2dm" );
+  FILE *file = fopen( path.c_str(), "w" );
+  ASSERT_NE( file, nullptr );
+  fprintf( file, "MESH2D\n" );
+  const auto vertexID = [&]( int index ) { return index + 1 + ( index >= columns * rows / 2 ? gap : 0 ); };
+  for ( int i = 0; i < columns * rows; ++i )
+    fprintf( file, "ND %d %d.25 %d.5 %d.125\n", vertexID( i ), i % columns, i / columns, i % 7 );
+  int faceID = 1;
+  for ( int r = 0; r + 1 < rows; ++r )
+  {
+    for ( int c = 0; c + 1 < columns; ++c )
+    {
+      const int v = r * columns + c;
+      fprintf( file, "E4Q %d %d %d %d %d 1\n", faceID++, vertexID( v ), vertexID( v + 1 ), vertexID( v + columns + 1 ), vertexID( v + columns ) );
+    }
+  }
+  fclose( file );
+
+  const int defaultThreadCount = MDAL_ThreadCount();
+  std::vector<double> firstCoordinates;
+  std::vector<int> firstIndices;
+  for ( int threads : { 1, 4 } )
+  {
+    MDAL_SetThreadCount( threads );
+    EXPECT_EQ( threads, MDAL_ThreadCount() );
+
+    MeshH m = MDAL_LoadMesh( path.c_str() );
+    ASSERT_NE( m, nullptr );
+    EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+    EXPECT_EQ( columns * rows, MDAL_M_vertexCount( m ) );
+    EXPECT_EQ( ( columns - 1 ) * ( rows - 1 ), MDAL_M_faceCount( m ) );
+
+    const int v = columns * rows / 2 + 3;
+    EXPECT_DOUBLE_EQ( v % columns + 0.25, getVertexXCoordinatesAt( m, v ) );
+    EXPECT_DOUBLE_EQ( v / columns + 0.5, getVertexYCoordinatesAt( m, v ) );
+    EXPECT_DOUBLE_EQ( v % 7 + 0.125, getVertexZCoordinatesAt( m, v ) );
+
+    const int f = ( rows - 2 ) * ( columns - 1 );
+    EXPECT_EQ( ( rows - 2 ) * columns, getFaceVerticesIndexAt( m, f, 0 ) );
+    EXPECT_EQ( ( rows - 1 ) * columns, getFaceVerticesIndexAt( m, f, 3 ) );
+
+    std::vector<double> coordinates = getCoordinates( m, columns * rows );
+    std::vector<int> indices;
+    MeshFaceIteratorH it = MDAL_M_faceIterator( m );
+    std::vector<int> offsets( 1024 );
+    std::vector<int> block( 4 * 1024 );
+    int count;
+    while ( ( count = MDAL_FI_next( it, 1024, offsets.data(), 4 * 1024, block.data() ) ) > 0 )
+      indices.insert( indices.end(), block.begin(), block.begin() + offsets[count - 1] );
+    MDAL_FI_close( it );
+    MDAL_CloseMesh( m );
+
+    if ( firstCoordinates.empty() )
+    {
+      firstCoordinates = coordinates;
+      firstIndices = indices;
+    }
+    else
+    {
+      EXPECT_TRUE( coordinates == firstCoordinates );
+      EXPECT_TRUE( indices == firstIndices );
+    }
+  }
+  MDAL_SetThreadCount( 0 );
+  EXPECT_EQ( defaultThreadCount, MDAL_ThreadCount() );
+
+  std::remove( path.c_str() );
+}
+
 TEST( Mesh2DMTest, SaveMeshToFile )
 {
   //test driver capability
@@ -297,6 +385,993 @@ TEST( Mesh2DMTest, SaveMeshToFile )
   std::remove( fileNameToSave.c_str() );
 }
 
+TEST( Mesh2DMTest, SaveMeshToBuffer )
+{
+  EXPECT_TRUE( MDAL_DR_saveMeshToBufferCapability( MDAL_driverFromName( "2DM" ) ) );
+  EXPECT_FALSE( MDAL_DR_saveMeshToBufferCapability( MDAL_driverFromName( "ASCII_DAT" ) ) );
+
+  std::string pathSource = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH mesh = MDAL_LoadMesh( pathSource.c_str() );
+  ASSERT_NE( mesh, nullptr );
+
+  void *buffer = nullptr;
+  EXPECT_EQ( 0, MDAL_SaveMeshToBuffer( mesh, "ASCII_DAT", &buffer ) );
+  EXPECT_EQ( MDAL_Status::Err_MissingDriverCapability, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, buffer );
+
+  // the same content as the saved file
+  const int64_t size = MDAL_SaveMeshToBuffer( mesh, "2DM", &buffer );
+  ASSERT_GT( size, 0 );
+  ASSERT_NE( nullptr, buffer );
+  std::string fileName = tmp_file( "/quad_and_triangle_bufferTest.2dm" );
+  MDAL_SaveMesh( mesh, fileName.c_str(), "2DM" );
+  MDAL_CloseMesh( mesh );
+
+  std::ifstream in( fileName, std::ifstream::binary );
+  const std::string content( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+  EXPECT_EQ( content, std::string( static_cast<const char *>( buffer ), static_cast<size_t>( size ) ) );
+  MDAL_FreeBuffer( buffer );
+
+  in.close();
+  std::remove( fileName.c_str() );
+}
+
+
+TEST( Mesh2DMTest, ReorderElements )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  std::string datasetPath = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  MeshH reference = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( reference, nullptr );
+  EXPECT_FALSE( MDAL_M_isReordered( reference ) );
+
+  MDAL_SetOpenOption( "REORDER_ELEMENTS", "YES" );
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetOpenOption( "REORDER_ELEMENTS", "" );
+  ASSERT_NE( mesh, nullptr );
+  EXPECT_TRUE( MDAL_M_isReordered( mesh ) );
+
+  // datasets loaded after the mesh are reordered too
+  MDAL_M_LoadDatasets( reference, datasetPath.c_str() );
+  MDAL_M_LoadDatasets( mesh, datasetPath.c_str() );
+  ASSERT_EQ( MDAL_M_datasetGroupCount( reference ), MDAL_M_datasetGroupCount( mesh ) );
+
+  const int vertexCount = MDAL_M_vertexCount( mesh );
+  const int faceCount = MDAL_M_faceCount( mesh );
+  std::vector<int> vertexOrder( static_cast<size_t>( vertexCount ) );
+  std::vector<int> faceOrder( static_cast<size_t>( faceCount ) );
+  EXPECT_EQ( vertexCount, MDAL_M_originalVertexIndices( mesh, 0, vertexCount, vertexOrder.data() ) );
+  EXPECT_EQ( faceCount, MDAL_M_originalFaceIndices( mesh, 0, faceCount, faceOrder.data() ) );
+
+  bool isIdentity = true;
+  for ( int i = 0; i < vertexCount; ++i )
+    isIdentity = isIdentity && vertexOrder[static_cast<size_t>( i )] == i;
+  EXPECT_FALSE( isIdentity );
+
+  const std::vector<double> referenceCoordinates = getCoordinates( reference, vertexCount );
+  const std::vector<double> coordinates = getCoordinates( mesh, vertexCount );
+  for ( size_t i = 0; i < static_cast<size_t>( vertexCount ); ++i )
+  {
+    const size_t original = static_cast<size_t>( vertexOrder[i] );
+    EXPECT_DOUBLE_EQ( referenceCoordinates[3 * original], coordinates[3 * i] );
+    EXPECT_DOUBLE_EQ( referenceCoordinates[3 * original + 1], coordinates[3 * i + 1] );
+    EXPECT_DOUBLE_EQ( referenceCoordinates[3 * original + 2], coordinates[3 * i + 2] );
+  }
+
+  for ( int i = 0; i < faceCount; i += 7 )
+  {
+    const int original = faceOrder[static_cast<size_t>( i )];
+    ASSERT_EQ( getFaceVerticesCountAt( reference, original ), getFaceVerticesCountAt( mesh, i ) );
+    for ( int j = 0; j < getFaceVerticesCountAt( mesh, i ); ++j )
+      EXPECT_EQ( getFaceVerticesIndexAt( reference, original, j ),
+                 vertexOrder[static_cast<size_t>( getFaceVerticesIndexAt( mesh, i, j ) )] );
+  }
+
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( mesh ); ++g )
+  {
+    DatasetGroupH referenceGroup = MDAL_M_datasetGroup( reference, g );
+    DatasetGroupH group = MDAL_M_datasetGroup( mesh, g );
+    ASSERT_EQ( MDAL_G_datasetCount( referenceGroup ), MDAL_G_datasetCount( group ) );
+    const bool onVertices = MDAL_G_dataLocation( group ) == MDAL_DataLocation::DataOnVertices2D;
+    const std::vector<int> &order = onVertices ? vertexOrder : faceOrder;
+
+    DatasetH referenceDataset = MDAL_G_dataset( referenceGroup, MDAL_G_datasetCount( group ) - 1 );
+    DatasetH dataset = MDAL_G_dataset( group, MDAL_G_datasetCount( group ) - 1 );
+    for ( int i = 0; i < MDAL_D_valueCount( dataset ); ++i )
+    {
+      const double expected = getValue( referenceDataset, order[static_cast<size_t>( i )] );
+      const double value = getValue( dataset, i );
+      EXPECT_TRUE( ( std::isnan( expected ) && std::isnan( value ) ) || expected == value );
+    }
+    if ( MDAL_D_hasActiveFlagCapability( dataset ) )
+    {
+      for ( int i = 0; i < faceCount; ++i )
+        EXPECT_EQ( getActive( referenceDataset, faceOrder[static_cast<size_t>( i )] ), getActive( dataset, i ) );
+    }
+  }
+
+  MDAL_CloseMesh( mesh );
+  MDAL_CloseMesh( reference );
+}
+
+TEST( Mesh2DMTest, Topology )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  // quad and triangle share the side 2-4
+  ASSERT_EQ( 6, MDAL_M_edgeCount( m ) );
+  std::vector<int> edges( 12 );
+  EXPECT_EQ( 6, MDAL_M_edgeVertices( m, 0, 6, edges.data() ) );
+  EXPECT_EQ( std::vector<int>( { 0, 1, 0, 4, 1, 2, 1, 3, 2, 3, 3, 4 } ), edges );
+  EXPECT_EQ( 2, MDAL_M_edgeVertices( m, 4, 10, edges.data() ) );
+  EXPECT_EQ( 0, MDAL_M_edgeVertices( m, 6, 1, edges.data() ) );
+
+  std::vector<int> offsets( 5 );
+  std::vector<int> indices( 10 );
+  MeshAdjacencyIteratorH it = MDAL_M_vertexFacesIterator( m );
+  EXPECT_EQ( 2, MDAL_AI_maximumRowSize( it ) );
+  // buffer for 3 faces only, the last vertex is returned by the next call
+  EXPECT_EQ( 2, MDAL_AI_next( it, 5, offsets.data(), 3, indices.data() ) );
+  EXPECT_EQ( 1, offsets[0] );
+  EXPECT_EQ( 3, offsets[1] );
+  EXPECT_EQ( std::vector<int>( { 0, 0, 1 } ), std::vector<int>( indices.begin(), indices.begin() + 3 ) );
+  EXPECT_EQ( 3, MDAL_AI_next( it, 5, offsets.data(), 10, indices.data() ) );
+  EXPECT_EQ( std::vector<int>( { 1, 3, 4 } ), std::vector<int>( offsets.begin(), offsets.begin() + 3 ) );
+  EXPECT_EQ( std::vector<int>( { 1, 0, 1, 0 } ), std::vector<int>( indices.begin(), indices.begin() + 4 ) );
+  EXPECT_EQ( 0, MDAL_AI_next( it, 5, offsets.data(), 10, indices.data() ) );
+  MDAL_AI_close( it );
+
+  it = MDAL_M_faceNeighboursIterator( m );
+  EXPECT_EQ( 2, MDAL_AI_next( it, 5, offsets.data(), 10, indices.data() ) );
+  EXPECT_EQ( 1, offsets[0] );
+  EXPECT_EQ( 2, offsets[1] );
+  EXPECT_EQ( 1, indices[0] );
+  EXPECT_EQ( 0, indices[1] );
+  MDAL_AI_close( it );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, TopologyOfLargeMesh )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  // Euler formula for the connected planar mesh without holes
+  EXPECT_EQ( MDAL_M_vertexCount( m ) + MDAL_M_faceCount( m ) - 1, MDAL_M_edgeCount( m ) );
+
+  // neighbour relation is symmetric
+  const int faceCount = MDAL_M_faceCount( m );
+  std::vector<int> offsets( static_cast<size_t>( faceCount ) );
+  std::vector<int> indices( 4 * static_cast<size_t>( faceCount ) );
+  MeshAdjacencyIteratorH it = MDAL_M_faceNeighboursIterator( m );
+  EXPECT_EQ( 4, MDAL_AI_maximumRowSize( it ) );
+  EXPECT_EQ( faceCount, MDAL_AI_next( it, faceCount, offsets.data(), static_cast<int>( indices.size() ), indices.data() ) );
+  MDAL_AI_close( it );
+
+  std::vector<std::vector<int>> neighbours( static_cast<size_t>( faceCount ) );
+  for ( size_t f = 0; f < neighbours.size(); ++f )
+    neighbours[f].assign( indices.begin() + ( f == 0 ? 0 : offsets[f - 1] ), indices.begin() + offsets[f] );
+  for ( size_t f = 0; f < neighbours.size(); ++f )
+  {
+    for ( int n : neighbours[f] )
+    {
+      const std::vector<int> &other = neighbours[static_cast<size_t>( n )];
+      EXPECT_NE( std::find( other.begin(), other.end(), static_cast<int>( f ) ), other.end() );
+    }
+  }
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, IteratorsInExtent )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  std::string datasetPath = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  MDAL_M_LoadDatasets( m, datasetPath.c_str() );
+
+  double minX, maxX, minY, maxY;
+  MDAL_M_extent( m, &minX, &maxX, &minY, &maxY );
+  const double extentMinX = minX + ( maxX - minX ) * 0.3;
+  const double extentMaxX = minX + ( maxX - minX ) * 0.45;
+  const double extentMinY = minY + ( maxY - minY ) * 0.5;
+  const double extentMaxY = minY + ( maxY - minY ) * 0.7;
+
+  // vertices, compared with all vertices of the mesh
+  const int vertexCount = MDAL_M_vertexCount( m );
+  const std::vector<double> coordinates = getCoordinates( m, vertexCount );
+  std::vector<int> expectedVertices;
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    const double x = coordinates[3 * static_cast<size_t>( i )];
+    const double y = coordinates[3 * static_cast<size_t>( i ) + 1];
+    if ( x >= extentMinX && x <= extentMaxX && y >= extentMinY && y <= extentMaxY )
+      expectedVertices.push_back( i );
+  }
+  ASSERT_FALSE( expectedVertices.empty() );
+
+  MeshVertexIteratorH vertexIterator = MDAL_M_vertexIteratorInExtent( m, extentMinX, extentMaxX, extentMinY, extentMaxY );
+  ASSERT_EQ( static_cast<int>( expectedVertices.size() ), MDAL_VI_count( vertexIterator ) );
+  std::vector<int> vertexIndices( expectedVertices.size() );
+  EXPECT_EQ( MDAL_VI_count( vertexIterator ), MDAL_VI_vertexIndices( vertexIterator, 0, MDAL_VI_count( vertexIterator ), vertexIndices.data() ) );
+  EXPECT_EQ( expectedVertices, vertexIndices );
+  std::vector<double> vertexCoordinates( 3 * expectedVertices.size() );
+  EXPECT_EQ( MDAL_VI_count( vertexIterator ), MDAL_VI_next( vertexIterator, MDAL_VI_count( vertexIterator ) + 10, vertexCoordinates.data() ) );
+  for ( size_t i = 0; i < expectedVertices.size(); ++i )
+    EXPECT_DOUBLE_EQ( coordinates[3 * static_cast<size_t>( expectedVertices[i] ) + 2], vertexCoordinates[3 * i + 2] );
+  EXPECT_EQ( 0, MDAL_VI_next( vertexIterator, 10, vertexCoordinates.data() ) );
+  MDAL_VI_close( vertexIterator );
+
+  // faces, compared with the bounding boxes of all faces
+  const int faceCount = MDAL_M_faceCount( m );
+  std::vector<int> expectedFaces;
+  for ( int f = 0; f < faceCount; ++f )
+  {
+    double faceMinX = std::numeric_limits<double>::max(), faceMaxX = -std::numeric_limits<double>::max();
+    double faceMinY = std::numeric_limits<double>::max(), faceMaxY = -std::numeric_limits<double>::max();
+    for ( int j = 0; j < getFaceVerticesCountAt( m, f ); ++j )
+    {
+      const size_t v = static_cast<size_t>( getFaceVerticesIndexAt( m, f, j ) );
+      faceMinX = std::min( faceMinX, coordinates[3 * v] );
+      faceMaxX = std::max( faceMaxX, coordinates[3 * v] );
+      faceMinY = std::min( faceMinY, coordinates[3 * v + 1] );
+      faceMaxY = std::max( faceMaxY, coordinates[3 * v + 1] );
+    }
+    if ( faceMaxX >= extentMinX && faceMinX <= extentMaxX && faceMaxY >= extentMinY && faceMinY <= extentMaxY )
+      expectedFaces.push_back( f );
+  }
+
+  MeshFaceIteratorH faceIterator = MDAL_M_faceIteratorInExtent( m, extentMinX, extentMaxX, extentMinY, extentMaxY );
+  ASSERT_EQ( static_cast<int>( expectedFaces.size() ), MDAL_FI_count( faceIterator ) );
+  std::vector<int> faceIndices( expectedFaces.size() );
+  EXPECT_EQ( MDAL_FI_count( faceIterator ), MDAL_FI_faceIndices( faceIterator, 0, 1000000, faceIndices.data() ) );
+  EXPECT_EQ( expectedFaces, faceIndices );
+  EXPECT_EQ( 1, MDAL_FI_faceIndices( faceIterator, MDAL_FI_count( faceIterator ) - 1, 10, faceIndices.data() ) );
+
+  // small buffers, faces are returned in several batches
+  std::vector<int> offsets( 7 );
+  std::vector<int> vertices( 7 * 4 );
+  size_t faceCountRead = 0;
+  while ( true )
+  {
+    const int count = MDAL_FI_next( faceIterator, 7, offsets.data(), 26, vertices.data() );
+    if ( count == 0 )
+      break;
+    for ( int i = 0; i < count; ++i )
+    {
+      const int face = expectedFaces[faceCountRead++];
+      const int start = i == 0 ? 0 : offsets[static_cast<size_t>( i ) - 1];
+      ASSERT_EQ( getFaceVerticesCountAt( m, face ), offsets[static_cast<size_t>( i )] - start );
+      for ( int j = 0; j < getFaceVerticesCountAt( m, face ); ++j )
+        EXPECT_EQ( getFaceVerticesIndexAt( m, face, j ), vertices[static_cast<size_t>( start + j )] );
+    }
+  }
+  EXPECT_EQ( expectedFaces.size(), faceCountRead );
+  MDAL_FI_close( faceIterator );
+
+  // plain iterators have no indices
+  faceIterator = MDAL_M_faceIterator( m );
+  EXPECT_EQ( -1, MDAL_FI_count( faceIterator ) );
+  MDAL_FI_close( faceIterator );
+
+  // values gathered at the indices, in any order
+  DatasetH dataset = MDAL_G_dataset( MDAL_M_datasetGroup( m, 1 ), 0 );
+  std::vector<int> indices( expectedVertices.rbegin(), expectedVertices.rend() );
+  if ( MDAL_G_dataLocation( MDAL_M_datasetGroup( m, 1 ) ) == MDAL_DataLocation::DataOnFaces2D )
+    indices.assign( expectedFaces.rbegin(), expectedFaces.rend() );
+  indices.push_back( indices.front() );
+  std::vector<double> values( indices.size() );
+  EXPECT_EQ( static_cast<int>( indices.size() ), MDAL_D_dataAtIndices( dataset, static_cast<int>( indices.size() ), indices.data(), MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  for ( size_t i = 0; i < indices.size(); ++i )
+  {
+    const double expected = getValue( dataset, indices[i] );
+    EXPECT_TRUE( ( std::isnan( expected ) && std::isnan( values[i] ) ) || expected == values[i] );
+  }
+  std::vector<int> invalid( 1, -1 );
+  EXPECT_EQ( 0, MDAL_D_dataAtIndices( dataset, 1, invalid.data(), MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( 0, MDAL_D_dataAtIndices( dataset, 1, indices.data(), MDAL_DataType::VECTOR_2D_DOUBLE, values.data() ) );
+
+  if ( MDAL_D_hasActiveFlagCapability( dataset ) )
+  {
+    std::vector<int> active( expectedFaces.size() );
+    EXPECT_EQ( static_cast<int>( active.size() ), MDAL_D_dataAtIndices( dataset, static_cast<int>( active.size() ), expectedFaces.data(), MDAL_DataType::ACTIVE_INTEGER, active.data() ) );
+    for ( size_t i = 0; i < active.size(); ++i )
+      EXPECT_EQ( getActive( dataset, expectedFaces[i] ), active[i] );
+  }
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, Api64 )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  std::string datasetPath = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  MDAL_M_LoadDatasets( m, datasetPath.c_str() );
+
+  const int vertexCount = MDAL_M_vertexCount( m );
+  const int faceCount = MDAL_M_faceCount( m );
+  EXPECT_EQ( vertexCount, MDAL_M_vertexCount64( m ) );
+  EXPECT_EQ( faceCount, MDAL_M_faceCount64( m ) );
+  EXPECT_EQ( MDAL_M_edgeCount( m ), MDAL_M_edgeCount64( m ) );
+
+  // vertices and faces are the same as of the int iterators
+  const std::vector<double> coordinates = getCoordinates( m, vertexCount );
+  MeshVertexIteratorH vertexIterator = MDAL_M_vertexIterator( m );
+  std::vector<double> coordinates64( coordinates.size() );
+  EXPECT_EQ( vertexCount, MDAL_VI_next64( vertexIterator, vertexCount, coordinates64.data() ) );
+  EXPECT_EQ( coordinates, coordinates64 );
+  MDAL_VI_close( vertexIterator );
+
+  std::vector<int> offsets( faceCount );
+  std::vector<int> vertices( 4 * faceCount );
+  MeshFaceIteratorH faceIterator = MDAL_M_faceIterator( m );
+  EXPECT_EQ( faceCount, MDAL_FI_next( faceIterator, faceCount, offsets.data(), 4 * faceCount, vertices.data() ) );
+  MDAL_FI_close( faceIterator );
+
+  // in several batches, offsets are relative to the batch
+  std::vector<int64_t> offsets64;
+  std::vector<int64_t> vertices64;
+  std::vector<int64_t> batchOffsets( 100 );
+  std::vector<int64_t> batchVertices( 400 );
+  faceIterator = MDAL_M_faceIterator( m );
+  while ( int64_t count = MDAL_FI_next64( faceIterator, 100, batchOffsets.data(), 400, batchVertices.data() ) )
+  {
+    const int64_t base = vertices64.size();
+    for ( int64_t i = 0; i < count; ++i )
+      offsets64.push_back( base + batchOffsets[i] );
+    vertices64.insert( vertices64.end(), batchVertices.begin(), batchVertices.begin() + batchOffsets[count - 1] );
+  }
+  MDAL_FI_close( faceIterator );
+  EXPECT_EQ( std::vector<int64_t>( offsets.begin(), offsets.end() ), offsets64 );
+  EXPECT_EQ( std::vector<int64_t>( vertices.begin(), vertices.begin() + offsets.back() ), vertices64 );
+
+  // faces in extent are widened from the int iterator
+  double minX, maxX, minY, maxY;
+  MDAL_M_extent( m, &minX, &maxX, &minY, &maxY );
+  faceIterator = MDAL_M_faceIteratorInExtent( m, minX, maxX, minY, maxY );
+  std::vector<int64_t> extentOffsets( faceCount );
+  std::vector<int64_t> extentVertices( 4 * faceCount );
+  EXPECT_EQ( faceCount, MDAL_FI_next64( faceIterator, faceCount, extentOffsets.data(), 4 * faceCount, extentVertices.data() ) );
+  EXPECT_EQ( offsets64, extentOffsets );
+  extentVertices.resize( extentOffsets.back() );
+  EXPECT_EQ( vertices64, extentVertices );
+  MDAL_FI_close( faceIterator );
+
+  faceIterator = MDAL_M_faceIterator( m );
+  EXPECT_EQ( 0, MDAL_FI_next64( faceIterator, 0, batchOffsets.data(), 400, batchVertices.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  MDAL_FI_close( faceIterator );
+
+  DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 1 ), 0 );
+  const int valueCount = MDAL_D_valueCount( ds );
+  EXPECT_EQ( valueCount, MDAL_D_valueCount64( ds ) );
+  std::vector<double> values( valueCount ), values64( valueCount );
+  EXPECT_EQ( valueCount - 5, MDAL_D_data( ds, 5, valueCount - 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( valueCount - 5, MDAL_D_data64( ds, 5, valueCount - 5, MDAL_DataType::SCALAR_DOUBLE, values64.data() ) );
+  EXPECT_EQ( values, values64 );
+  EXPECT_EQ( 0, MDAL_D_data64( ds, -1, 5, MDAL_DataType::SCALAR_DOUBLE, values64.data() ) );
+  EXPECT_EQ( 0, MDAL_D_data64( ds, 0, valueCount + 1, MDAL_DataType::SCALAR_DOUBLE, values64.data() ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, SharedMeshes )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  std::string datasetPath = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  EXPECT_FALSE( MDAL_MeshSharing() );
+  MDAL_SetMeshSharing( true );
+  EXPECT_TRUE( MDAL_MeshSharing() );
+
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  MeshH shared = MDAL_LoadMesh( path.c_str() );
+  EXPECT_EQ( m, shared );
+  EXPECT_EQ( 2, MDAL_M_handleCount( m ) );
+
+  // other open options load other mesh
+  MDAL_SetOpenOption( "REORDER_ELEMENTS", "YES" );
+  MeshH reordered = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetOpenOption( "REORDER_ELEMENTS", "" );
+  EXPECT_NE( m, reordered );
+  EXPECT_TRUE( MDAL_M_isReordered( reordered ) );
+  MDAL_CloseMesh( reordered );
+
+  // edits are refused while the mesh has other handles
+  const int groupCount = MDAL_M_datasetGroupCount( m );
+  MDAL_M_LoadDatasets( m, datasetPath.c_str() );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleMesh, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_M_addDerivedGroup( m, "double", "2 * [Bed Elevation]" ) );
+  EXPECT_EQ( groupCount, MDAL_M_datasetGroupCount( m ) );
+
+  // failed edit of the only handle keeps it shared
+  MDAL_CloseMesh( shared );
+  EXPECT_EQ( 1, MDAL_M_handleCount( m ) );
+  EXPECT_EQ( nullptr, MDAL_M_addDerivedGroup( m, "invalid", "2 * [Missing Group]" ) );
+  MDAL_M_LoadDatasets( m, "non/existent/file.dat" );
+  shared = MDAL_LoadMesh( path.c_str() );
+  EXPECT_EQ( m, shared );
+  MDAL_CloseMesh( shared );
+
+  // the only handle is detached, the following loads read the file again
+  EXPECT_EQ( 1, MDAL_M_handleCount( m ) );
+  MDAL_M_LoadDatasets( m, datasetPath.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_LT( groupCount, MDAL_M_datasetGroupCount( m ) );
+  MeshH other = MDAL_LoadMesh( path.c_str() );
+  EXPECT_NE( m, other );
+  EXPECT_EQ( groupCount, MDAL_M_datasetGroupCount( other ) );
+  EXPECT_EQ( 1, MDAL_M_handleCount( other ) );
+  MDAL_CloseMesh( other );
+  MDAL_CloseMesh( m );
+
+  // handles opened before disabling are still counted
+  m = MDAL_LoadMesh( path.c_str() );
+  shared = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetMeshSharing( false );
+  other = MDAL_LoadMesh( path.c_str() );
+  EXPECT_NE( m, other );
+  MDAL_CloseMesh( other );
+  MDAL_CloseMesh( shared );
+  EXPECT_EQ( 1, MDAL_M_handleCount( m ) );
+  MDAL_CloseMesh( m );
+}
+
+struct ProgressRecord
+{
+  std::vector<double> fractions;
+  bool cancel = false;
+};
+
+static bool _recordProgress( double progress, void *userData )
+{
+  ProgressRecord *record = static_cast<ProgressRecord *>( userData );
+  record->fractions.push_back( progress );
+  return !record->cancel;
+}
+
+TEST( Mesh2DMTest, ProgressAndCancel )
+{
+  // enough lines for several reports during the parsing
+  const int columns = 200;
+  const int rows = 200;
+  std::string path = tmp_file( "/progress.2dm" );
+  std::string savedPath = tmp_file( "/progress_saved.2dm" );
+  FILE *file = fopen( path.c_str(), "w" );
+  ASSERT_NE( file, nullptr );
+  fprintf( file, "MESH2D\n" );
+  for ( int i = 0; i < columns * rows; ++i )
+    fprintf( file, "ND %d %d %d 1\n", i + 1, i % columns, i / columns );
+  int faceID = 1;
+  for ( int r = 0; r + 1 < rows; ++r )
+  {
+    for ( int c = 0; c + 1 < columns; ++c )
+    {
+      const int v = r * columns + c + 1;
+      fprintf( file, "E4Q %d %d %d %d %d 1\n", faceID++, v, v + 1, v + columns + 1, v + columns );
+    }
+  }
+  fclose( file );
+
+  // the callback is called on the calling thread only
+  MDAL_SetThreadCount( 1 );
+  ProgressRecord record;
+  MDAL_SetProgressCallback( _recordProgress, &record );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  ASSERT_GT( record.fractions.size(), 1u );
+  EXPECT_TRUE( std::is_sorted( record.fractions.begin(), record.fractions.end() ) );
+  EXPECT_DOUBLE_EQ( 1.0, record.fractions.back() );
+
+  record.cancel = true;
+  record.fractions.clear();
+  MDAL_SaveMesh( m, savedPath.c_str(), "2DM" );
+  EXPECT_EQ( MDAL_Status::Err_Cancelled, MDAL_LastStatus() );
+  EXPECT_EQ( 1u, record.fractions.size() );
+  // no truncated file is left
+  EXPECT_FALSE( fileExists( savedPath ) );
+  MDAL_CloseMesh( m );
+
+  record.fractions.clear();
+  m = MDAL_LoadMesh( path.c_str() );
+  EXPECT_EQ( m, nullptr );
+  EXPECT_EQ( MDAL_Status::Err_Cancelled, MDAL_LastStatus() );
+  EXPECT_EQ( 1u, record.fractions.size() );
+
+  MDAL_SetProgressCallback( nullptr, nullptr );
+  record.fractions.clear();
+  m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_TRUE( record.fractions.empty() );
+  MDAL_CloseMesh( m );
+  MDAL_SetThreadCount( 0 );
+
+  std::remove( path.c_str() );
+  std::remove( savedPath.c_str() );
+}
+
+static std::map<std::string, long long> _perfCounters()
+{
+  std::map<std::string, long long> counters;
+  const int count = MDAL_GetPerfCounters( nullptr, nullptr, 0 );
+  std::vector<const char *> names( static_cast<size_t>( count ) );
+  std::vector<long long> values( static_cast<size_t>( count ) );
+  EXPECT_EQ( count, MDAL_GetPerfCounters( names.data(), values.data(), count ) );
+  for ( int i = 0; i < count; ++i )
+    counters[names[static_cast<size_t>( i )]] = values[static_cast<size_t>( i )];
+  return counters;
+}
+
+TEST( Mesh2DMTest, PerfCounters )
+{
+  MDAL_ResetPerfCounters();
+  std::map<std::string, long long> counters = _perfCounters();
+  if ( counters.empty() )
+    return; // built without ENABLE_PERF_COUNTERS
+  EXPECT_EQ( 0, counters["load.count"] );
+
+  MDAL_SetTracing( true );
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  std::string datPath = test_file( "/ascii_dat/quad_and_triangle_vertex_scalar.dat" );
+  MDAL_M_LoadDatasets( m, datPath.c_str() );
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  ASSERT_NE( g, nullptr );
+  DatasetH ds = MDAL_G_dataset( g, 0 );
+  double values[5];
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_DOUBLE, values ) );
+  MDAL_SetTracing( false );
+
+  counters = _perfCounters();
+  EXPECT_EQ( 1, counters["load.count"] );
+  EXPECT_EQ( 1, counters["load_datasets.count"] );
+  EXPECT_EQ( 1, counters["driver.2DM.load.count"] );
+  EXPECT_EQ( 1, counters["driver.ASCII_DAT.load_datasets.count"] );
+  EXPECT_GT( counters["mapped_file.bytes"], 0 );
+  EXPECT_GE( counters["data.reads"], 1 );
+  EXPECT_GE( counters["data.bytes"], 5 * static_cast<long long>( sizeof( double ) ) );
+  EXPECT_GE( counters["driver.ASCII_DAT.data_bytes"], 5 * static_cast<long long>( sizeof( double ) ) );
+  MDAL_CloseMesh( m );
+
+  std::string tracePath = tmp_file( "/perf_trace.json" );
+  MDAL_WriteTrace( tracePath.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  const std::string trace = MDAL::readFileToString( tracePath );
+  EXPECT_TRUE( MDAL::startsWith( trace, "{\"traceEvents\":[" ) );
+  EXPECT_TRUE( MDAL::contains( trace, "\"name\":\"load\"" ) );
+  EXPECT_TRUE( MDAL::contains( trace, "\"name\":\"data\"" ) );
+
+  MDAL_ResetPerfCounters();
+  counters = _perfCounters();
+  EXPECT_EQ( 0, counters["load.count"] );
+  EXPECT_EQ( 0, counters["driver.2DM.load.count"] );
+  MDAL_WriteTrace( tracePath.c_str() );
+  EXPECT_FALSE( MDAL::contains( MDAL::readFileToString( tracePath ), "\"name\":\"load\"" ) );
+  std::remove( tracePath.c_str() );
+
+  MDAL_WriteTrace( "non/existent/dir/trace.json" );
+  EXPECT_EQ( MDAL_Status::Err_FailToWriteToDisk, MDAL_LastStatus() );
+}
+
+TEST( Mesh2DMTest, ConvertedGroups )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  DatasetGroupH bed = MDAL_M_datasetGroup( m, 0 );
+  ASSERT_EQ( std::string( "Bed Elevation" ), std::string( MDAL_G_name( bed ) ) );
+
+  // vertices to faces
+  DatasetGroupH faceMean = MDAL_G_addConvertedGroup( bed, "face mean", MDAL_ConversionWeighting::EqualWeights );
+  ASSERT_NE( faceMean, nullptr );
+  EXPECT_EQ( MDAL_DataLocation::DataOnFaces2D, MDAL_G_dataLocation( faceMean ) );
+  EXPECT_TRUE( MDAL_G_hasScalarData( faceMean ) );
+  DatasetH ds = MDAL_G_dataset( faceMean, 0 );
+  EXPECT_EQ( 2, MDAL_D_valueCount( ds ) );
+  EXPECT_DOUBLE_EQ( 27.5, getValue( ds, 0 ) );
+  EXPECT_DOUBLE_EQ( 40, getValue( ds, 1 ) );
+
+  // parts of the square are equal, the triangle is split by its centre in thirds
+  DatasetGroupH faceArea = MDAL_G_addConvertedGroup( bed, "face area", MDAL_ConversionWeighting::AreaWeights );
+  ds = MDAL_G_dataset( faceArea, 0 );
+  EXPECT_DOUBLE_EQ( 27.5, getValue( ds, 0 ) );
+  EXPECT_DOUBLE_EQ( 40, getValue( ds, 1 ) );
+
+  DatasetGroupH faceDistance = MDAL_G_addConvertedGroup( bed, "face distance", MDAL_ConversionWeighting::InverseDistanceWeights );
+  ds = MDAL_G_dataset( faceDistance, 0 );
+  const double nearWeight = 1 / std::hypot( 1000.0 / 3, 1000.0 / 3 );
+  const double farWeight = 1 / std::hypot( 2000.0 / 3, 1000.0 / 3 );
+  EXPECT_DOUBLE_EQ( 27.5, getValue( ds, 0 ) );
+  EXPECT_NEAR( ( 30 * nearWeight + ( 40 + 50 ) * farWeight ) / ( nearWeight + 2 * farWeight ), getValue( ds, 1 ), 1e-9 );
+
+  // faces to vertices, the shared vertex takes a quarter of the square and a third of the triangle
+  DatasetGroupH vertexMean = MDAL_G_addConvertedGroup( faceMean, "vertex mean", MDAL_ConversionWeighting::EqualWeights );
+  ASSERT_NE( vertexMean, nullptr );
+  EXPECT_EQ( MDAL_DataLocation::DataOnVertices2D, MDAL_G_dataLocation( vertexMean ) );
+  ds = MDAL_G_dataset( vertexMean, 0 );
+  EXPECT_EQ( 5, MDAL_D_valueCount( ds ) );
+  std::vector<double> values( 5 );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( std::vector<double>( { 27.5, 33.75, 40, 33.75, 27.5 } ), values );
+
+  DatasetGroupH vertexArea = MDAL_G_addConvertedGroup( faceMean, "vertex area", MDAL_ConversionWeighting::AreaWeights );
+  ds = MDAL_G_dataset( vertexArea, 0 );
+  EXPECT_EQ( 2, MDAL_D_data( ds, 1, 2, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_DOUBLE_EQ( 32.5, values[0] );
+  EXPECT_DOUBLE_EQ( 40, values[1] );
+
+  // invalid source values are skipped
+  DatasetGroupH withNan = MDAL_M_addDerivedGroup( m, "with nan", "if(\"face mean\" > 30, 0 / 0, \"face mean\")" );
+  ASSERT_NE( withNan, nullptr );
+  DatasetGroupH vertexNan = MDAL_G_addConvertedGroup( withNan, "vertex nan", MDAL_ConversionWeighting::EqualWeights );
+  ds = MDAL_G_dataset( vertexNan, 0 );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_DOUBLE_EQ( 27.5, values[1] );
+  EXPECT_TRUE( std::isnan( values[2] ) );
+
+  // vectors invalid in either component are skipped
+  std::string datPath = tmp_file( "/quad_and_triangle_converted_vectors.dat" );
+  DatasetGroupH vectors = MDAL_M_addDatasetGroup( m, "vectors", MDAL_DataLocation::DataOnFaces2D, false,
+                          MDAL_driverFromName( "ASCII_DAT" ), datPath.c_str() );
+  ASSERT_NE( vectors, nullptr );
+  const std::vector<double> vectorValues = { 1, 2, 3, std::numeric_limits<double>::quiet_NaN() };
+  ASSERT_NE( nullptr, MDAL_G_addDataset( vectors, 0.0, vectorValues.data(), nullptr ) );
+  MDAL_G_closeEditMode( vectors );
+  DatasetGroupH vertexVectors = MDAL_G_addConvertedGroup( vectors, "vertex vectors", MDAL_ConversionWeighting::EqualWeights );
+  ds = MDAL_G_dataset( vertexVectors, 0 );
+  std::vector<double> vertexVectorValues( 10 );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::VECTOR_2D_DOUBLE, vertexVectorValues.data() ) );
+  EXPECT_DOUBLE_EQ( 1, vertexVectorValues[2] );
+  EXPECT_DOUBLE_EQ( 2, vertexVectorValues[3] );
+  EXPECT_TRUE( std::isnan( vertexVectorValues[4] ) );
+  EXPECT_TRUE( std::isnan( vertexVectorValues[5] ) );
+
+  EXPECT_EQ( nullptr, MDAL_G_addConvertedGroup( bed, nullptr, MDAL_ConversionWeighting::EqualWeights ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_G_addConvertedGroup( bed, "unknown", static_cast<MDAL_ConversionWeighting>( 5 ) ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+  std::remove( datPath.c_str() );
+}
+
+TEST( Mesh2DMTest, Contours )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  DatasetH bed = MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 0 );
+
+  // higher values are on the right of the lines
+  const double levels[3] = { 25, 45, 60 };
+  ContourIteratorH it = MDAL_D_contourLines( bed, 3, levels );
+  ASSERT_NE( it, nullptr );
+  EXPECT_EQ( 2, MDAL_CI_partCount( it ) );
+  EXPECT_EQ( 4, MDAL_CI_maximumPointCount( it ) );
+  std::vector<int> levelIndices( 2 );
+  std::vector<int> offsets( 2 );
+  std::vector<double> coordinates( 14 );
+  EXPECT_EQ( 2, MDAL_CI_next( it, 2, levelIndices.data(), offsets.data(), 14, coordinates.data() ) );
+  EXPECT_EQ( std::vector<int>( { 0, 1 } ), levelIndices );
+  EXPECT_EQ( std::vector<int>( { 3, 7 } ), offsets );
+  const std::vector<double> expected =
+  {
+    1500, 2000, 1000 + 1000.0 / 6, 2000 + 1000.0 / 6, 1375, 3000,
+    2500, 2500, 2000, 2750, 1000 + 5000.0 / 6, 2000 + 5000.0 / 6, 1875, 3000
+  };
+  for ( size_t i = 0; i < expected.size(); ++i )
+    EXPECT_DOUBLE_EQ( expected[i], coordinates[i] );
+  EXPECT_EQ( 0, MDAL_CI_next( it, 2, levelIndices.data(), offsets.data(), 14, coordinates.data() ) );
+  MDAL_CI_close( it );
+
+  // each of the 3 triangles is split by the level between the bands to 3 and 4 sided parts
+  const double bandLevels[3] = { 0, 35, 100 };
+  it = MDAL_D_contourBands( bed, 3, bandLevels );
+  ASSERT_NE( it, nullptr );
+  EXPECT_EQ( 6, MDAL_CI_partCount( it ) );
+  EXPECT_EQ( 5, MDAL_CI_maximumPointCount( it ) );
+
+  // invalid levels and datasets
+  const double descending[2] = { 45, 25 };
+  EXPECT_EQ( nullptr, MDAL_D_contourLines( bed, 2, descending ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_D_contourBands( bed, 1, levels ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  DatasetGroupH faceGroup = MDAL_G_addConvertedGroup( MDAL_M_datasetGroup( m, 0 ), "faces", MDAL_ConversionWeighting::EqualWeights );
+  EXPECT_EQ( nullptr, MDAL_D_contourLines( MDAL_G_dataset( faceGroup, 0 ), 3, levels ) );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleDataset, MDAL_LastStatus() );
+
+  MDAL_CI_close( it );
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, MemoryUsage )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  const int64_t meshUsage = MDAL_M_memoryUsage( m );
+  // vertices, faces and the bed elevation at least
+  const int64_t verticesCount = MDAL_M_vertexCount( m );
+  EXPECT_GT( meshUsage, verticesCount * 4 * static_cast<int64_t>( sizeof( double ) ) );
+
+  // datasets read from the file on request are not counted
+  std::string datPath = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  const int groupsCount = MDAL_M_datasetGroupCount( m );
+  MDAL_M_LoadDatasets( m, datPath.c_str() );
+  ASSERT_GT( MDAL_M_datasetGroupCount( m ), groupsCount );
+  DatasetGroupH g = MDAL_M_datasetGroup( m, groupsCount );
+  EXPECT_EQ( meshUsage, MDAL_M_memoryUsage( m ) );
+
+  // the calculated values held in memory are
+  DatasetGroupH maximum = MDAL_G_addTemporalAggregateGroup( g, "max", MDAL_TemporalAggregate::TemporalMaximum );
+  ASSERT_NE( maximum, nullptr );
+  EXPECT_EQ( meshUsage, MDAL_M_memoryUsage( m ) );
+  getValue( MDAL_G_dataset( maximum, 0 ), 0 );
+  EXPECT_EQ( meshUsage + verticesCount * static_cast<int64_t>( sizeof( double ) ), MDAL_M_memoryUsage( m ) );
+
+  // the bed elevation is the only memory dataset, added memory dataset is allocated from the arena too
+  MDAL::Mesh *mesh = static_cast<MDAL::Mesh *>( m );
+  const std::shared_ptr<MDAL::MemoryArena> arena = mesh->memoryArena();
+  const size_t valueBytes = static_cast<size_t>( verticesCount ) * sizeof( double );
+  EXPECT_EQ( valueBytes, arena->usedSize() );
+  std::shared_ptr<MDAL::DatasetGroup> added = std::make_shared<MDAL::DatasetGroup>( "test", mesh, path, "added" );
+  added->setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  mesh->datasetGroups.push_back( added );
+  added->datasets.push_back( std::make_shared<MDAL::MemoryDataset2D>( added.get(), false ) );
+  EXPECT_EQ( 2 * valueBytes, arena->usedSize() );
+  EXPECT_GE( MDAL_M_memoryUsage( m ), meshUsage + verticesCount * static_cast<int64_t>( sizeof( double ) ) );
+
+  // the space of the removed dataset is reused
+  added->datasets.clear();
+  EXPECT_EQ( valueBytes, arena->usedSize() );
+  added->datasets.push_back( std::make_shared<MDAL::MemoryDataset2D>( added.get(), false ) );
+  EXPECT_EQ( 2 * valueBytes, arena->usedSize() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, TimeInterpolation )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  std::string datPath = tmp_file( "/quad_and_triangle_timeInterpolation.dat" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  // time steps are added out of order
+  DatasetGroupH g = MDAL_M_addDatasetGroup( m, "levels", MDAL_DataLocation::DataOnVertices2D, true,
+                    MDAL_driverFromName( "ASCII_DAT" ), datPath.c_str() );
+  ASSERT_NE( g, nullptr );
+  std::vector<double> values = { 1, 2, 3, 4, 5 };
+  std::vector<int> active = { 1, 0 };
+  MDAL_G_addDataset( g, 0.0, values.data(), active.data() );
+  for ( double &value : values )
+    value *= 3;
+  active = { 1, 1 };
+  MDAL_G_addDataset( g, 2.0, values.data(), active.data() );
+  for ( double &value : values )
+    value *= 2.0 / 3;
+  MDAL_G_addDataset( g, 1.0, values.data(), active.data() );
+  MDAL_G_closeEditMode( g );
+  ASSERT_EQ( 3, MDAL_G_datasetCount( g ) );
+
+  // nearest time step, the earlier one in the middle
+  const std::vector<double> times = { -5, 0.4, 0.5, 0.6, 1.9, 10 };
+  const std::vector<double> nearest = { 0, 0, 0, 1, 2, 2 };
+  for ( size_t i = 0; i < times.size(); ++i )
+  {
+    const int index = MDAL_G_datasetIndexAtTime( g, times[i] );
+    ASSERT_GE( index, 0 );
+    EXPECT_DOUBLE_EQ( nearest[i], MDAL_D_time( MDAL_G_dataset( g, index ) ) );
+  }
+  EXPECT_EQ( -1, MDAL_G_datasetIndexAtTime( g, std::numeric_limits<double>::quiet_NaN() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  const std::vector<double> interpolationTimes = { 0.5, 1.5, -1, 3 };
+  DatasetGroupH interpolated = MDAL_G_addTimeInterpolatedGroup( g, "interpolated", 4, interpolationTimes.data() );
+  ASSERT_NE( interpolated, nullptr );
+  EXPECT_EQ( MDAL_DataLocation::DataOnVertices2D, MDAL_G_dataLocation( interpolated ) );
+  ASSERT_EQ( 4, MDAL_G_datasetCount( interpolated ) );
+
+  DatasetH ds = MDAL_G_dataset( interpolated, 0 );
+  EXPECT_DOUBLE_EQ( 0.5, MDAL_D_time( ds ) );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( std::vector<double>( { 1.5, 3, 4.5, 6, 7.5 } ), values );
+  // active in both time steps only
+  EXPECT_EQ( 1, getActive( ds, 0 ) );
+  EXPECT_EQ( 0, getActive( ds, 1 ) );
+
+  ds = MDAL_G_dataset( interpolated, 1 );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( std::vector<double>( { 2.5, 5, 7.5, 10, 12.5 } ), values );
+  EXPECT_EQ( 1, getActive( ds, 1 ) );
+
+  // outside of the time range
+  EXPECT_DOUBLE_EQ( 1, getValue( MDAL_G_dataset( interpolated, 2 ), 0 ) );
+  EXPECT_EQ( 0, getActive( MDAL_G_dataset( interpolated, 2 ), 1 ) );
+  EXPECT_DOUBLE_EQ( 15, getValue( MDAL_G_dataset( interpolated, 3 ), 4 ) );
+
+  EXPECT_EQ( nullptr, MDAL_G_addTimeInterpolatedGroup( g, "interpolated", 1, nullptr ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, LevelsOfDetail )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  const int64_t meshUsage = MDAL_M_memoryUsage( m );
+
+  const int levelsCount = MDAL_M_levelOfDetailCount( m );
+  ASSERT_GE( levelsCount, 3 );
+  EXPECT_GT( MDAL_M_memoryUsage( m ), meshUsage );
+  EXPECT_EQ( m, MDAL_M_levelOfDetail( m, 0 ) );
+  EXPECT_DOUBLE_EQ( 0, MDAL_M_levelOfDetailResolution( m, 0 ) );
+  EXPECT_EQ( nullptr, MDAL_M_levelOfDetail( m, levelsCount ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( -1, MDAL_M_levelOfDetailResolution( m, -1 ) );
+
+  // each level has less faces and cells of double size
+  for ( int level = 1; level < levelsCount; ++level )
+  {
+    MeshH coarse = MDAL_M_levelOfDetail( m, level );
+    MeshH fine = MDAL_M_levelOfDetail( m, level - 1 );
+    ASSERT_NE( coarse, nullptr );
+    EXPECT_LT( MDAL_M_faceCount( coarse ), MDAL_M_faceCount( fine ) );
+    EXPECT_LT( MDAL_M_vertexCount( coarse ), MDAL_M_vertexCount( fine ) );
+    EXPECT_EQ( level, MDAL_M_levelOfDetailAtResolution( m, MDAL_M_levelOfDetailResolution( m, level ) ) );
+    if ( level > 1 )
+    {
+      EXPECT_DOUBLE_EQ( 2 * MDAL_M_levelOfDetailResolution( m, level - 1 ), MDAL_M_levelOfDetailResolution( m, level ) );
+    }
+  }
+  EXPECT_EQ( 0, MDAL_M_levelOfDetailAtResolution( m, 0 ) );
+  EXPECT_EQ( levelsCount - 1, MDAL_M_levelOfDetailAtResolution( m, 1e10 ) );
+  EXPECT_EQ( 1, MDAL_M_levelOfDetailCount( MDAL_M_levelOfDetail( m, levelsCount - 1 ) ) );
+
+  // bed elevation aggregated to the vertices of the level
+  DatasetGroupH bed = MDAL_M_datasetGroup( m, 0 );
+  ASSERT_NE( bed, nullptr );
+  EXPECT_EQ( bed, MDAL_G_addLevelOfDetailGroup( bed, 0, MDAL_LevelOfDetailAggregate::LevelMean ) );
+  EXPECT_EQ( nullptr, MDAL_G_addLevelOfDetailGroup( bed, levelsCount, MDAL_LevelOfDetailAggregate::LevelMean ) );
+  EXPECT_EQ( nullptr, MDAL_G_addLevelOfDetailGroup( bed, 1, static_cast<MDAL_LevelOfDetailAggregate>( 7 ) ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  MeshH level = MDAL_M_levelOfDetail( m, 1 );
+  DatasetGroupH mean = MDAL_G_addLevelOfDetailGroup( bed, 1, MDAL_LevelOfDetailAggregate::LevelMean );
+  DatasetGroupH maximum = MDAL_G_addLevelOfDetailGroup( bed, 1, MDAL_LevelOfDetailAggregate::LevelMaximum );
+  ASSERT_NE( mean, nullptr );
+  ASSERT_NE( maximum, nullptr );
+  EXPECT_EQ( level, MDAL_G_mesh( mean ) );
+  EXPECT_EQ( 2, MDAL_M_datasetGroupCount( level ) );
+  EXPECT_EQ( std::string( MDAL_G_name( bed ) ), std::string( MDAL_G_name( mean ) ) );
+  EXPECT_EQ( MDAL_DataLocation::DataOnVertices2D, MDAL_G_dataLocation( mean ) );
+
+  const int verticesCount = MDAL_M_vertexCount( m );
+  std::vector<double> values( static_cast<size_t>( verticesCount ) );
+  ASSERT_EQ( verticesCount, MDAL_D_data( MDAL_G_dataset( bed, 0 ), 0, verticesCount, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  const double bedMaximum = *std::max_element( values.begin(), values.end() );
+  const double bedMinimum = *std::min_element( values.begin(), values.end() );
+
+  const int levelVerticesCount = MDAL_M_vertexCount( level );
+  std::vector<double> meanValues( static_cast<size_t>( levelVerticesCount ) );
+  std::vector<double> maximumValues( static_cast<size_t>( levelVerticesCount ) );
+  ASSERT_EQ( levelVerticesCount, MDAL_D_data( MDAL_G_dataset( mean, 0 ), 0, levelVerticesCount, MDAL_DataType::SCALAR_DOUBLE, meanValues.data() ) );
+  ASSERT_EQ( levelVerticesCount, MDAL_D_data( MDAL_G_dataset( maximum, 0 ), 0, levelVerticesCount, MDAL_DataType::SCALAR_DOUBLE, maximumValues.data() ) );
+  for ( int i = 0; i < levelVerticesCount; ++i )
+  {
+    EXPECT_GE( meanValues[i], bedMinimum );
+    EXPECT_GE( maximumValues[i], meanValues[i] );
+  }
+  // partial reads of the values kept after the first read
+  std::vector<double> partValues( 3 );
+  ASSERT_EQ( 3, MDAL_D_data( MDAL_G_dataset( mean, 0 ), levelVerticesCount - 3, 3, MDAL_DataType::SCALAR_DOUBLE, partValues.data() ) );
+  EXPECT_EQ( std::vector<double>( meanValues.end() - 3, meanValues.end() ), partValues );
+  EXPECT_DOUBLE_EQ( bedMaximum, *std::max_element( maximumValues.begin(), maximumValues.end() ) );
+
+  // faces of the level cover all faces of the mesh
+  DatasetGroupH onFaces = MDAL_G_addConvertedGroup( bed, "bed on faces", MDAL_ConversionWeighting::EqualWeights );
+  ASSERT_NE( onFaces, nullptr );
+  DatasetGroupH facesMaximum = MDAL_G_addLevelOfDetailGroup( onFaces, 1, MDAL_LevelOfDetailAggregate::LevelMaximum );
+  ASSERT_NE( facesMaximum, nullptr );
+  EXPECT_EQ( MDAL_DataLocation::DataOnFaces2D, MDAL_G_dataLocation( facesMaximum ) );
+  const int facesCount = MDAL_M_faceCount( m );
+  const int levelFacesCount = MDAL_M_faceCount( level );
+  values.resize( static_cast<size_t>( facesCount ) );
+  maximumValues.resize( static_cast<size_t>( levelFacesCount ) );
+  ASSERT_EQ( facesCount, MDAL_D_data( MDAL_G_dataset( onFaces, 0 ), 0, facesCount, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  ASSERT_EQ( levelFacesCount, MDAL_D_data( MDAL_G_dataset( facesMaximum, 0 ), 0, levelFacesCount, MDAL_DataType::SCALAR_DOUBLE, maximumValues.data() ) );
+  EXPECT_DOUBLE_EQ( *std::max_element( values.begin(), values.end() ), *std::max_element( maximumValues.begin(), maximumValues.end() ) );
+  EXPECT_EQ( MDAL_D_hasActiveFlagCapability( MDAL_G_dataset( onFaces, 0 ) ), MDAL_D_hasActiveFlagCapability( MDAL_G_dataset( facesMaximum, 0 ) ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( Mesh2DMTest, RenderBuffers )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  std::string datPath = tmp_file( "/quad_and_triangle_renderBuffers.dat" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  DatasetH bed = MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 0 );
+  ASSERT_NE( bed, nullptr );
+
+  // mesh vertices relative to the origin
+  RenderBuffersH rb = MDAL_M_renderBuffers( m, MDAL_RenderVertices::RenderSharedVertices, 1000, 2000, 10 );
+  ASSERT_NE( rb, nullptr );
+  ASSERT_EQ( 5, MDAL_RB_vertexCount( rb ) );
+  ASSERT_EQ( 3, MDAL_RB_triangleCount( rb ) );
+  const float *positions = MDAL_RB_vertices( rb );
+  EXPECT_EQ( std::vector<float>( { 0, 0, 10, 1000, 0, 20, 2000, 0, 30, 1000, 1000, 40, 0, 1000, 0 } ),
+             std::vector<float>( positions, positions + 15 ) );
+  const uint32_t *indices = MDAL_RB_indices( rb );
+  EXPECT_EQ( std::vector<uint32_t>( { 0, 1, 3, 0, 3, 4, 1, 2, 3 } ), std::vector<uint32_t>( indices, indices + 9 ) );
+
+  std::vector<float> floatValues( 5 );
+  EXPECT_EQ( 5, MDAL_RB_values( rb, bed, MDAL_RenderValueType::RenderFloat32, 0, 0, floatValues.data() ) );
+  EXPECT_EQ( std::vector<float>( { 20, 30, 40, 50, 10 } ), floatValues );
+  std::vector<uint16_t> quantized( 5 );
+  EXPECT_EQ( 5, MDAL_RB_values( rb, bed, MDAL_RenderValueType::RenderUInt16, 10, 50, quantized.data() ) );
+  EXPECT_EQ( std::vector<uint16_t>( { 16384, 32767, 49151, 65534, 0 } ), quantized );
+  EXPECT_EQ( 0, MDAL_RB_values( rb, bed, MDAL_RenderValueType::RenderUInt16, 50, 10, quantized.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( 0, MDAL_RB_values( rb, bed, static_cast<MDAL_RenderValueType>( 7 ), 0, 0, floatValues.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  // values on faces need face corners
+  DatasetGroupH onFaces = MDAL_G_addConvertedGroup( MDAL_M_datasetGroup( m, 0 ), "bed on faces", MDAL_ConversionWeighting::EqualWeights );
+  ASSERT_NE( onFaces, nullptr );
+  DatasetH faceBed = MDAL_G_dataset( onFaces, 0 );
+  EXPECT_EQ( 0, MDAL_RB_values( rb, faceBed, MDAL_RenderValueType::RenderFloat32, 0, 0, floatValues.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleDataset, MDAL_LastStatus() );
+  MDAL_RB_close( rb );
+
+  rb = MDAL_M_renderBuffers( m, MDAL_RenderVertices::RenderFaceCorners, 0, 0, 0 );
+  ASSERT_NE( rb, nullptr );
+  ASSERT_EQ( 7, MDAL_RB_vertexCount( rb ) );
+  ASSERT_EQ( 3, MDAL_RB_triangleCount( rb ) );
+  indices = MDAL_RB_indices( rb );
+  EXPECT_EQ( std::vector<uint32_t>( { 0, 1, 2, 0, 2, 3, 4, 5, 6 } ), std::vector<uint32_t>( indices, indices + 9 ) );
+  positions = MDAL_RB_vertices( rb );
+  EXPECT_EQ( std::vector<float>( { 2000, 2000, 30 } ), std::vector<float>( positions + 12, positions + 15 ) );
+
+  floatValues.resize( 7 );
+  EXPECT_EQ( 7, MDAL_RB_values( rb, faceBed, MDAL_RenderValueType::RenderFloat32, 0, 0, floatValues.data() ) );
+  EXPECT_EQ( std::vector<float>( { 27.5, 27.5, 27.5, 27.5, 40, 40, 40 } ), floatValues );
+  EXPECT_EQ( 7, MDAL_RB_values( rb, bed, MDAL_RenderValueType::RenderFloat32, 0, 0, floatValues.data() ) );
+  EXPECT_EQ( std::vector<float>( { 20, 30, 50, 10, 30, 40, 50 } ), floatValues );
+
+  // corners of inactive faces are invalid
+  DatasetGroupH g = MDAL_M_addDatasetGroup( m, "active", MDAL_DataLocation::DataOnVertices2D, true,
+                    MDAL_driverFromName( "ASCII_DAT" ), datPath.c_str() );
+  ASSERT_NE( g, nullptr );
+  std::vector<double> values = { 1, 2, 3, 4, 5 };
+  std::vector<int> active = { 1, 0 };
+  MDAL_G_addDataset( g, 0.0, values.data(), active.data() );
+  MDAL_G_closeEditMode( g );
+  quantized.resize( 7 );
+  EXPECT_EQ( 7, MDAL_RB_values( rb, MDAL_G_dataset( g, 0 ), MDAL_RenderValueType::RenderUInt16, 1, 5, quantized.data() ) );
+  EXPECT_EQ( std::vector<uint16_t>( { 0, 16384, 49151, 65534, 65535, 65535, 65535 } ), quantized );
+  MDAL_RB_close( rb );
+
+  EXPECT_EQ( nullptr, MDAL_M_renderBuffers( m, MDAL_RenderVertices::RenderSharedVertices, std::numeric_limits<double>::quiet_NaN(), 0, 0 ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_M_renderBuffers( m, static_cast<MDAL_RenderVertices>( 7 ), 0, 0, 0 ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
 
 int main( int argc, char **argv )
 {
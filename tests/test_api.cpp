@@ -5,6 +5,7 @@
 #include "gtest/gtest.h"
 #include <limits>
 #include <cmath>
+#include <thread>
 
 //mdal
 #include "mdal.h"
@@ -13,6 +14,44 @@
 TEST( ApiTest, GlobalApi )
 {
   EXPECT_NE( MDAL_Version(), std::string( "" ) );
+
+  MDAL_SetFileHandlePoolSize( -1 );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( 0, MDAL_FileHandlePoolSize() );
+}
+
+TEST( ApiTest, OpenOptionsApi )
+{
+  EXPECT_EQ( std::string( "" ), std::string( MDAL_OpenOption( "LAZY_STATISTICS" ) ) );
+
+  MDAL_SetOpenOption( "LAZY_STATISTICS", "YES" );
+  EXPECT_EQ( std::string( "YES" ), std::string( MDAL_OpenOption( "LAZY_STATISTICS" ) ) );
+
+  MDAL_SetOpenOption( "LAZY_STATISTICS", nullptr );
+  EXPECT_EQ( std::string( "" ), std::string( MDAL_OpenOption( "LAZY_STATISTICS" ) ) );
+
+  MDAL_SetOpenOption( nullptr, "YES" );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( std::string( "" ), std::string( MDAL_OpenOption( nullptr ) ) );
+}
+
+TEST( ApiTest, StatusPerThread )
+{
+  MDAL_Status mainStatus = MDAL_LastStatus();
+  MDAL_Status initialStatus = MDAL_Status::Err_UnknownFormat;
+  MDAL_Status errorStatus = MDAL_Status::None;
+
+  std::thread thread( [&]()
+  {
+    initialStatus = MDAL_LastStatus();
+    MDAL_LoadMesh( nullptr );
+    errorStatus = MDAL_LastStatus();
+  } );
+  thread.join();
+
+  EXPECT_EQ( MDAL_Status::None, initialStatus );
+  EXPECT_EQ( MDAL_Status::Err_FileNotFound, errorStatus );
+  EXPECT_EQ( mainStatus, MDAL_LastStatus() );
 }
 
 TEST( ApiTest, DriversApi )
@@ -54,14 +93,45 @@ TEST( ApiTest, MeshApi )
   EXPECT_TRUE( std::isnan( a ) );
 
   EXPECT_EQ( MDAL_M_vertexCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_vertexCount64( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_handleCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_memoryUsage( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_levelOfDetailCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_levelOfDetail( nullptr, 0 ), nullptr );
+  EXPECT_EQ( MDAL_M_levelOfDetailResolution( nullptr, 0 ), -1 );
+  EXPECT_EQ( MDAL_M_levelOfDetailAtResolution( nullptr, 1 ), -1 );
+  EXPECT_EQ( MDAL_M_renderBuffers( nullptr, MDAL_RenderVertices::RenderSharedVertices, 0, 0, 0 ), nullptr );
+  EXPECT_EQ( MDAL_RB_vertexCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_RB_triangleCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_RB_vertices( nullptr ), nullptr );
+  EXPECT_EQ( MDAL_RB_indices( nullptr ), nullptr );
+  EXPECT_EQ( MDAL_RB_values( nullptr, nullptr, MDAL_RenderValueType::RenderFloat32, 0, 0, nullptr ), 0 );
+  MDAL_RB_close( nullptr );
   EXPECT_EQ( MDAL_M_faceCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_faceCount64( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_edgeCount64( nullptr ), 0 );
   EXPECT_EQ( MDAL_M_faceVerticesMaximumCount( nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_uniformFaceVerticesCount( nullptr ), 0 );
   MDAL_M_LoadDatasets( nullptr, nullptr );
+  MDAL_M_LoadDatasetsBatch( nullptr, 0, nullptr );
   EXPECT_EQ( MDAL_M_datasetGroupCount( nullptr ), 0 );
   EXPECT_EQ( MDAL_M_datasetGroup( nullptr, 0 ), nullptr );
   EXPECT_EQ( MDAL_M_addDatasetGroup( nullptr, nullptr, MDAL_DataLocation::DataOnVertices2D, true, nullptr, nullptr ), nullptr );
   EXPECT_EQ( MDAL_M_addDatasetGroup( nullptr, nullptr, MDAL_DataLocation::DataOnVolumes3D, true, nullptr, nullptr ), nullptr );
   EXPECT_EQ( MDAL_M_driverName( nullptr ), nullptr );
+  EXPECT_EQ( MDAL_M_sampleTimeSeries( nullptr, nullptr, 0, 0, nullptr ), 0 );
+  EXPECT_EQ( MDAL_M_sampleTimeSeriesAtPoints( nullptr, nullptr, 0, nullptr, nullptr, nullptr ), 0 );
+  EXPECT_EQ( MDAL_G_addTemporalAggregateGroup( nullptr, "max", MDAL_TemporalAggregate::TemporalMaximum ), nullptr );
+  EXPECT_EQ( MDAL_G_addConvertedGroup( nullptr, "name", MDAL_ConversionWeighting::EqualWeights ), nullptr );
+  EXPECT_EQ( MDAL_G_addTimeInterpolatedGroup( nullptr, "name", 0, nullptr ), nullptr );
+  EXPECT_EQ( MDAL_G_datasetIndexAtTime( nullptr, 0 ), -1 );
+  EXPECT_EQ( MDAL_G_addLevelOfDetailGroup( nullptr, 0, MDAL_LevelOfDetailAggregate::LevelMean ), nullptr );
+  EXPECT_EQ( MDAL_M_addDerivedGroup( nullptr, "name", "1" ), nullptr );
+  EXPECT_FALSE( MDAL_D_rasterize( nullptr, 0, 0, 1, 1, 1, 1, nullptr ) );
+  EXPECT_EQ( MDAL_D_contourLines( nullptr, 0, nullptr ), nullptr );
+  EXPECT_EQ( MDAL_CI_next( nullptr, 0, nullptr, nullptr, 0, nullptr ), 0 );
+  EXPECT_EQ( MDAL_CI_partCount( nullptr ), 0 );
+  MDAL_CI_close( nullptr );
 }
 
 void _populateFaces( MeshH m, std::vector<int> &ret, size_t faceOffsetsBufferLen, size_t vertexIndicesBufferLen )
@@ -150,6 +220,7 @@ TEST( ApiTest, FacesApi )
   // Some wrong calls tests
   EXPECT_EQ( MDAL_M_vertexIterator( nullptr ), nullptr );
   EXPECT_EQ( MDAL_VI_next( nullptr, 0, nullptr ), 0 );
+  EXPECT_EQ( MDAL_VI_next64( nullptr, 0, nullptr ), 0 );
 }
 
 void _populateVertices( MeshH m, std::vector<double> &ret, size_t itemsLen )
@@ -215,11 +286,32 @@ TEST( ApiTest, VerticesApi )
 
     compareVectors( refCoors, coords );
   }
+
+  {
+    int vertexCount = MDAL_M_vertexCount( m );
+    std::vector<double> x( static_cast<size_t>( vertexCount ) );
+    std::vector<double> y( static_cast<size_t>( vertexCount ) );
+    std::vector<double> z( static_cast<size_t>( vertexCount ) );
+    EXPECT_EQ( vertexCount, MDAL_M_vertexCoordinatesSoA( m, 0, vertexCount, x.data(), y.data(), z.data() ) );
+    for ( size_t i = 0; i < static_cast<size_t>( vertexCount ); ++i )
+    {
+      EXPECT_DOUBLE_EQ( refCoors[3 * i], x[i] );
+      EXPECT_DOUBLE_EQ( refCoors[3 * i + 1], y[i] );
+      EXPECT_DOUBLE_EQ( refCoors[3 * i + 2], z[i] );
+    }
+
+    // partial reads, skipped axis
+    EXPECT_EQ( 3, MDAL_M_vertexCoordinatesSoA( m, vertexCount - 3, 10, nullptr, y.data(), nullptr ) );
+    EXPECT_DOUBLE_EQ( refCoors[3 * static_cast<size_t>( vertexCount - 1 ) + 1], y[2] );
+    EXPECT_EQ( 0, MDAL_M_vertexCoordinatesSoA( m, vertexCount, 1, x.data(), y.data(), z.data() ) );
+  }
   MDAL_CloseMesh( m );
 
   // Some wrong calls tests
+  EXPECT_EQ( MDAL_M_vertexCoordinatesSoA( nullptr, 0, 1, nullptr, nullptr, nullptr ), 0 );
   EXPECT_EQ( MDAL_M_faceIterator( nullptr ), nullptr );
   EXPECT_EQ( MDAL_FI_next( nullptr, 0, nullptr, 0, nullptr ), 0 );
+  EXPECT_EQ( MDAL_FI_next64( nullptr, 0, nullptr, 0, nullptr ), 0 );
 }
 
 TEST( ApiTest, GroupsApi )
@@ -235,8 +327,15 @@ TEST( ApiTest, GroupsApi )
   EXPECT_EQ( 0, MDAL_G_maximumVerticalLevelCount( nullptr ) );
   EXPECT_EQ( MDAL_G_dataLocation( nullptr ), MDAL_DataLocation::DataInvalidLocation );
   double a, b;
+  EXPECT_FALSE( MDAL_G_isReady( nullptr ) );
+  MDAL_SetProgressCallback( nullptr, nullptr );
+  EXPECT_FALSE( MDAL_G_waitUntilReady( nullptr ) );
   MDAL_G_minimumMaximum( nullptr, &a, &b );
   EXPECT_TRUE( std::isnan( a ) );
+  EXPECT_TRUE( std::isnan( MDAL_G_quantile( nullptr, 0.5 ) ) );
+  EXPECT_FALSE( MDAL_G_histogram( nullptr, 0, 1, 1, &a ) );
+  EXPECT_EQ( MDAL_G_dataBlock( nullptr, 0, 1, 0, 1, MDAL_DataType::SCALAR_DOUBLE, MDAL_DataBlockLayout::TimeMajor, &a ), 0 );
+  EXPECT_EQ( MDAL_G_timeSeriesAtIndices( nullptr, 0, nullptr, &a ), 0 );
 
   EXPECT_EQ( MDAL_G_addDataset( nullptr, 0, nullptr, nullptr ), nullptr );
   EXPECT_EQ( MDAL_G_isInEditMode( nullptr ), true );
@@ -256,6 +355,15 @@ TEST( ApiTest, DatasetsApi )
   double a, b;
   MDAL_D_minimumMaximum( nullptr, &a, &b );
   EXPECT_TRUE( std::isnan( a ) );
+  EXPECT_TRUE( std::isnan( MDAL_D_quantile( nullptr, 0.5 ) ) );
+  EXPECT_FALSE( MDAL_D_histogram( nullptr, 0, 1, 1, &a ) );
+  int index;
+  EXPECT_EQ( MDAL_D_validIndices( nullptr, 0, 1, &index ), 0 );
+  EXPECT_EQ( MDAL_D_dataPointer( nullptr, &index ), nullptr );
+  EXPECT_EQ( MDAL_D_dataPointerFloat( nullptr, nullptr ), nullptr );
+  EXPECT_EQ( MDAL_D_valueCount64( nullptr ), 0 );
+  EXPECT_EQ( MDAL_D_volumesCount64( nullptr ), 0 );
+  EXPECT_EQ( MDAL_D_data64( nullptr, 0, 1, MDAL_DataType::SCALAR_DOUBLE, &a ), 0 );
   // do not crash is enough for this
   MDAL_D_minimumMaximum( nullptr, &a, nullptr );
   MDAL_D_minimumMaximum( nullptr, nullptr, &b );
@@ -4,6 +4,10 @@
 */
 #include "gtest/gtest.h"
 #include <string>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <vector>
 
 //mdal
 #include "mdal.h"
@@ -116,6 +120,38 @@ TEST( MeshAsciiDatTest, QuadAndTriangleFaceScalarFileWithNumberingGaps )
   MDAL_CloseMesh( m );
 }
 
+TEST( MeshAsciiDatTest, LazyStatistics )
+{
+  MDAL_SetOpenOption( "LAZY_STATISTICS", "YES" );
+
+  std::string meshPath = test_file( "/2dm/mesh_with_numbering_gaps.2dm" );
+  MeshH m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  std::string path = test_file( "/ascii_dat/mesh_with_numbering_gaps_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  ASSERT_EQ( 2, MDAL_M_datasetGroupCount( m ) );
+
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  ASSERT_NE( g, nullptr );
+
+  // group statistics first, so datasets statistics are calculated on request too
+  double min, max;
+  MDAL_G_minimumMaximum( g, &min, &max );
+  EXPECT_DOUBLE_EQ( 1, min );
+  EXPECT_DOUBLE_EQ( 10, max );
+
+  DatasetH ds = MDAL_G_dataset( g, 0 );
+  ASSERT_NE( ds, nullptr );
+  MDAL_D_minimumMaximum( ds, &min, &max );
+  EXPECT_DOUBLE_EQ( 1, min );
+  EXPECT_DOUBLE_EQ( 5, max );
+
+  MDAL_CloseMesh( m );
+  MDAL_SetOpenOption( "LAZY_STATISTICS", nullptr );
+}
+
 TEST( XdmfTest, MeshNumberedFrom0 )
 {
   std::string path = test_file( "/xdmf/simple/simpleXFMD.2dm" );
@@ -265,6 +301,197 @@ TEST( MeshAsciiDatTest, QuadAndTriangleFaceVectorFile )
   MDAL_CloseMesh( m );
 }
 
+TEST( MeshAsciiDatTest, DataBlock )
+{
+  std::string path = test_file( "/2dm/mesh_with_numbering_gaps.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/ascii_dat/mesh_with_numbering_gaps_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  ASSERT_EQ( 2, MDAL_M_datasetGroupCount( m ) );
+
+  // datasets are read one by one, each parses its time step again
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  const int datasetCount = MDAL_G_datasetCount( g );
+  const int valueCount = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+  ASSERT_GT( datasetCount, 1 );
+  ASSERT_GT( valueCount, 2 );
+  EXPECT_TRUE( compareDataBlock( g, 0, datasetCount, 0, valueCount ) );
+  EXPECT_TRUE( compareDataBlock( g, 1, datasetCount - 1, 1, valueCount - 2 ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshAsciiDatTest, SampleTimeSeries )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/ascii_dat/quad_and_triangle_els_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  ASSERT_EQ( 2, MDAL_M_datasetGroupCount( m ) );
+
+  // bed elevation on vertices, interpolated within triangles
+  DatasetGroupH bed = MDAL_M_datasetGroup( m, 0 );
+  double value = 0;
+  EXPECT_EQ( 1, MDAL_M_sampleTimeSeries( m, bed, 1500, 2500, &value ) );
+  EXPECT_DOUBLE_EQ( 35, value );
+  EXPECT_EQ( 1, MDAL_M_sampleTimeSeries( m, bed, 7000.0 / 3.0, 7000.0 / 3.0, &value ) );
+  EXPECT_DOUBLE_EQ( 40, value );
+  EXPECT_EQ( 1, MDAL_M_sampleTimeSeries( m, bed, 500, 2500, &value ) );
+  EXPECT_TRUE( std::isnan( value ) );
+
+  // values on faces
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  const int datasetCount = MDAL_G_datasetCount( g );
+  std::vector<double> values( static_cast<size_t>( datasetCount ) );
+  EXPECT_EQ( datasetCount, MDAL_M_sampleTimeSeries( m, g, 1200, 2800, values.data() ) );
+  for ( int i = 0; i < datasetCount; ++i )
+    EXPECT_DOUBLE_EQ( getValue( MDAL_G_dataset( g, i ), 0 ), values[static_cast<size_t>( i )] );
+  EXPECT_EQ( datasetCount, MDAL_M_sampleTimeSeries( m, g, 2600, 2200, values.data() ) );
+  for ( int i = 0; i < datasetCount; ++i )
+    EXPECT_DOUBLE_EQ( getValue( MDAL_G_dataset( g, i ), 1 ), values[static_cast<size_t>( i )] );
+
+  EXPECT_EQ( 0, MDAL_M_sampleTimeSeries( m, nullptr, 1500, 2500, values.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleDataset, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshAsciiDatTest, SampleTimeSeriesAtPoints )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/ascii_dat/quad_and_triangle_els_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( 2, MDAL_M_datasetGroupCount( m ) );
+
+  // points inside both faces, outside of the mesh and repeated
+  const std::vector<double> x = { 1500, 7000.0 / 3.0, 500, 1200, 2600, 1500 };
+  const std::vector<double> y = { 2500, 7000.0 / 3.0, 2500, 2800, 2200, 2500 };
+  const int pointCount = static_cast<int>( x.size() );
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( m ); ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    const size_t datasetCount = static_cast<size_t>( MDAL_G_datasetCount( group ) );
+    std::vector<double> values( x.size() * datasetCount );
+    ASSERT_EQ( static_cast<int>( datasetCount ), MDAL_M_sampleTimeSeriesAtPoints( m, group, pointCount, x.data(), y.data(), values.data() ) );
+
+    std::vector<double> expected( datasetCount );
+    for ( size_t p = 0; p < x.size(); ++p )
+    {
+      MDAL_M_sampleTimeSeries( m, group, x[p], y[p], expected.data() );
+      for ( size_t i = 0; i < datasetCount; ++i )
+      {
+        const double value = values[p * datasetCount + i];
+        if ( std::isnan( expected[i] ) )
+          EXPECT_TRUE( std::isnan( value ) );
+        else
+          EXPECT_NEAR( expected[i], value, 1e-9 );
+      }
+    }
+  }
+
+  // values at the faces
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  const int datasetCount = MDAL_G_datasetCount( g );
+  const std::vector<int> faces = { 1, 0, 1 };
+  std::vector<double> values( faces.size() * static_cast<size_t>( datasetCount ) );
+  ASSERT_EQ( datasetCount, MDAL_G_timeSeriesAtIndices( g, 3, faces.data(), values.data() ) );
+  for ( size_t f = 0; f < faces.size(); ++f )
+  {
+    for ( int i = 0; i < datasetCount; ++i )
+      EXPECT_DOUBLE_EQ( getValue( MDAL_G_dataset( g, i ), faces[f] ), values[f * static_cast<size_t>( datasetCount ) + static_cast<size_t>( i )] );
+  }
+
+  const std::vector<int> invalid = { 2 };
+  EXPECT_EQ( 0, MDAL_G_timeSeriesAtIndices( g, 1, invalid.data(), values.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleDataset, MDAL_LastStatus() );
+  EXPECT_EQ( 0, MDAL_M_sampleTimeSeriesAtPoints( m, g, -1, x.data(), y.data(), values.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshAsciiDatTest, Rasterize )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/ascii_dat/quad_and_triangle_els_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( 2, MDAL_M_datasetGroupCount( m ) );
+
+  // grid over the mesh and beyond, cells of 50 x 40 and more than one tile
+  const double minX = 900;
+  const double maxY = 3100;
+  const int columns = 50;
+  const int rows = 70;
+  std::vector<float> raster( static_cast<size_t>( columns * rows ) );
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( m ); ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    DatasetH dataset = MDAL_G_dataset( group, 0 );
+    ASSERT_TRUE( MDAL_D_rasterize( dataset, minX, maxY, 50, 40, columns, rows, raster.data() ) );
+
+    int covered = 0;
+    for ( int row = 0; row < rows; ++row )
+    {
+      for ( int column = 0; column < columns; ++column )
+      {
+        // cells on the faces boundary may be sampled from either face
+        const double x = minX + 50 * ( column + 0.5 );
+        const double y = maxY - 40 * ( row + 0.5 );
+        if ( x == 2000 || y == 2000 || y == 3000 || std::fabs( x + y - 5000 ) < 1e-6 )
+          continue;
+
+        std::vector<double> values( static_cast<size_t>( MDAL_G_datasetCount( group ) ) );
+        ASSERT_NE( 0, MDAL_M_sampleTimeSeries( m, group, x, y, values.data() ) );
+        const float value = raster[static_cast<size_t>( row * columns + column )];
+        if ( std::isnan( values[0] ) )
+        {
+          EXPECT_TRUE( std::isnan( value ) );
+        }
+        else
+        {
+          EXPECT_NEAR( values[0], value, 1e-4 );
+          ++covered;
+        }
+      }
+    }
+    EXPECT_GT( covered, 0 );
+
+    // window of the grid reads only its faces and matches the cells of the whole grid
+    const int firstColumn = 7;
+    const int firstRow = 9;
+    const int windowColumns = 20;
+    const int windowRows = 30;
+    std::vector<float> window( static_cast<size_t>( windowColumns * windowRows ) );
+    ASSERT_TRUE( MDAL_D_rasterize( dataset, minX + 50 * firstColumn, maxY - 40 * firstRow, 50, 40,
+                                   windowColumns, windowRows, window.data() ) );
+    for ( int row = 0; row < windowRows; ++row )
+    {
+      for ( int column = 0; column < windowColumns; ++column )
+      {
+        const float expected = raster[static_cast<size_t>( ( firstRow + row ) * columns + firstColumn + column )];
+        const float value = window[static_cast<size_t>( row * windowColumns + column )];
+        if ( std::isnan( expected ) )
+          EXPECT_TRUE( std::isnan( value ) );
+        else
+          EXPECT_FLOAT_EQ( expected, value );
+      }
+    }
+  }
+
+  EXPECT_FALSE( MDAL_D_rasterize( MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 0 ), minX, maxY, 0, 40, columns, rows, raster.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
 TEST( MeshAsciiDatTest, QuadAndTriangleVertexScalarFile )
 {
   MeshH m = mesh();
@@ -578,6 +805,12 @@ TEST( MeshAsciiDatTest, WriteScalarVertexTest )
     ASSERT_EQ( 2, MDAL_G_datasetCount( g ) );
     ASSERT_EQ( g, MDAL_D_group( MDAL_G_dataset( g, 0 ) ) );
 
+    // written time steps are read back from the file
+    DatasetH ds = MDAL_G_dataset( g, 1 );
+    EXPECT_DOUBLE_EQ( 1.0, MDAL_D_time( ds ) );
+    EXPECT_DOUBLE_EQ( 5, getValue( ds, 4 ) );
+    EXPECT_EQ( 0, getActive( ds, 1 ) );
+
     MDAL_CloseMesh( m );
   }
 
@@ -633,6 +866,39 @@ TEST( MeshAsciiDatTest, WriteScalarVertexTest )
   }
 }
 
+TEST( MeshAsciiDatTest, WriteExactValues )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  std::string scalarPath = tmp_file( "/2dm_WriteExactValues.dat" );
+  std::vector<double> vals = {0.1, 1.0 / 3.0, -2.5e-20, 123456789.123456789, 7};
+
+  {
+    MeshH m = MDAL_LoadMesh( path.c_str() );
+    ASSERT_NE( m, nullptr );
+    DatasetGroupH g = MDAL_M_addDatasetGroup( m, "exactGrp", MDAL_DataLocation::DataOnVertices2D, true,
+                      MDAL_driverFromName( "ASCII_DAT" ), scalarPath.c_str() );
+    ASSERT_NE( g, nullptr );
+    MDAL_G_addDataset( g, 1.0, vals.data(), nullptr );
+
+    // values read back from the file are the added ones, statistics match them
+    DatasetH ds = MDAL_G_dataset( g, 0 );
+    for ( int i = 0; i < 5; ++i )
+      EXPECT_EQ( vals[static_cast<size_t>( i )], getValue( ds, i ) );
+    double min, max;
+    MDAL_D_minimumMaximum( ds, &min, &max );
+    EXPECT_EQ( -2.5e-20, min );
+    EXPECT_EQ( 123456789.123456789, max );
+
+    // the group is not closed, the file is terminated when the mesh is closed
+    MDAL_CloseMesh( m );
+  }
+
+  std::ifstream in( scalarPath );
+  std::string content( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+  ASSERT_GE( content.size(), 5u );
+  EXPECT_EQ( "ENDDS", content.substr( content.size() - 5 ) );
+}
+
 TEST( MeshAsciiDatTest, WriteScalarFaceTest )
 {
   std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
@@ -876,6 +1142,11 @@ TEST( MeshAsciiDatTest, WriteVectorFaceTest )
     ASSERT_EQ( 2, MDAL_G_datasetCount( g ) );
     ASSERT_EQ( g, MDAL_D_group( MDAL_G_dataset( g, 0 ) ) );
 
+    // written time steps are read back from the file
+    DatasetH ds = MDAL_G_dataset( g, 1 );
+    EXPECT_DOUBLE_EQ( 2, getValueX( ds, 1 ) );
+    EXPECT_DOUBLE_EQ( 2, getValueY( ds, 1 ) );
+
     MDAL_CloseMesh( m );
   }
 
@@ -1024,6 +1295,83 @@ TEST( MeshAsciiDatTest, WriteVectorVertexTestNoActive )
   }
 }
 
+TEST( MeshAsciiDatTest, LoadDatasetsBatch )
+{
+  const std::vector<std::string> paths =
+  {
+    test_file( "/ascii_dat/quad_and_triangle_els_scalar.dat" ),
+    test_file( "/ascii_dat/quad_and_triangle_els_vector.dat" ),
+    test_file( "/ascii_dat/not_a_data_file.dat" ),
+    test_file( "/binary_dat/quad_and_triangle_binary.dat" ),
+    test_file( "/ascii_dat/quad_and_triangle_vertex_scalar.dat" ),
+    test_file( "/ascii_dat/quad_and_triangle_vertex_vector.dat" ),
+    test_file( "/ascii_dat/missing_file.dat" )
+  };
+
+  MeshH sequential = mesh();
+  for ( const std::string &path : paths )
+    MDAL_M_LoadDatasets( sequential, path.c_str() );
+
+  std::vector<const char *> files;
+  for ( const std::string &path : paths )
+    files.push_back( path.c_str() );
+
+  const int defaultThreadCount = MDAL_ThreadCount();
+  for ( int threads : { 1, 4 } )
+  {
+    MDAL_SetThreadCount( threads );
+    MeshH m = mesh();
+    MDAL_M_LoadDatasetsBatch( m, static_cast<int>( files.size() ), files.data() );
+    // the last file that failed
+    EXPECT_EQ( MDAL_Status::Err_FileNotFound, MDAL_LastStatus() );
+
+    // groups are in the order of the files
+    ASSERT_EQ( MDAL_M_datasetGroupCount( sequential ), MDAL_M_datasetGroupCount( m ) );
+    for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+    {
+      DatasetGroupH expectedGroup = MDAL_M_datasetGroup( sequential, i );
+      DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+      EXPECT_EQ( std::string( MDAL_G_name( expectedGroup ) ), std::string( MDAL_G_name( g ) ) );
+      ASSERT_EQ( MDAL_G_datasetCount( expectedGroup ), MDAL_G_datasetCount( g ) );
+      EXPECT_EQ( MDAL_G_hasScalarData( expectedGroup ), MDAL_G_hasScalarData( g ) );
+
+      const int valuesPerIndex = MDAL_G_hasScalarData( g ) ? 1 : 2;
+      const MDAL_DataType type = MDAL_G_hasScalarData( g ) ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+      for ( int d = 0; d < MDAL_G_datasetCount( g ); ++d )
+      {
+        DatasetH expectedDataset = MDAL_G_dataset( expectedGroup, d );
+        DatasetH ds = MDAL_G_dataset( g, d );
+        const int count = MDAL_D_valueCount( ds );
+        ASSERT_EQ( MDAL_D_valueCount( expectedDataset ), count );
+        EXPECT_DOUBLE_EQ( MDAL_D_time( expectedDataset ), MDAL_D_time( ds ) );
+
+        std::vector<double> expectedValues( static_cast<size_t>( count * valuesPerIndex ) );
+        std::vector<double> values( expectedValues.size() );
+        EXPECT_EQ( count, MDAL_D_data( expectedDataset, 0, count, type, expectedValues.data() ) );
+        EXPECT_EQ( count, MDAL_D_data( ds, 0, count, type, values.data() ) );
+        for ( size_t v = 0; v < values.size(); ++v )
+        {
+          if ( std::isnan( expectedValues[v] ) )
+            EXPECT_TRUE( std::isnan( values[v] ) );
+          else
+            EXPECT_DOUBLE_EQ( expectedValues[v], values[v] );
+        }
+      }
+    }
+    MDAL_CloseMesh( m );
+  }
+  MDAL_SetThreadCount( 0 );
+  EXPECT_EQ( defaultThreadCount, MDAL_ThreadCount() );
+
+  MeshH m = mesh();
+  MDAL_M_LoadDatasetsBatch( m, 2, files.data() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( 3, MDAL_M_datasetGroupCount( m ) );
+  MDAL_CloseMesh( m );
+
+  MDAL_CloseMesh( sequential );
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
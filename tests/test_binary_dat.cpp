@@ -4,6 +4,7 @@
 */
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 //mdal
 #include "mdal.h"
@@ -68,6 +69,12 @@ TEST( MeshBinaryDatTest, QuadAndTriangleFile )
   value = getValue( ds, 1 );
   EXPECT_DOUBLE_EQ( 2, value );
 
+  // floats are read as they are stored in the file
+  std::vector<float> floatValues( 5 );
+  EXPECT_EQ( 5, MDAL_D_data( ds, 0, 5, MDAL_DataType::SCALAR_FLOAT, floatValues.data() ) );
+  EXPECT_FLOAT_EQ( 1, floatValues[0] );
+  EXPECT_FLOAT_EQ( 2, floatValues[1] );
+
   MDAL_CloseMesh( m );
 }
 
@@ -118,6 +125,22 @@ TEST( MeshBinaryDatTest, RegularGridVectorFile )
   double time = MDAL_D_time( ds );
   EXPECT_TRUE( compareDurationInHours( time, 4.1666666666 ) );
 
+  // values are read from the file offsets of the time steps
+  EXPECT_TRUE( compareDataBlock( g, 48, 4, 900, 200 ) );
+
+  // repeated reads are served from the cache
+  MDAL_SetCacheSize( 1024 * 1024 );
+  EXPECT_EQ( 1024 * 1024, MDAL_CacheSize() );
+  const long long hits = MDAL_CacheHits();
+  std::vector<double> values( 2 * 100 );
+  std::vector<double> cached( 2 * 100 );
+  ASSERT_EQ( 100, MDAL_D_data( ds, 900, 100, MDAL_DataType::VECTOR_2D_DOUBLE, values.data() ) );
+  ASSERT_EQ( 100, MDAL_D_data( ds, 900, 100, MDAL_DataType::VECTOR_2D_DOUBLE, cached.data() ) );
+  EXPECT_EQ( hits + 1, MDAL_CacheHits() );
+  EXPECT_TRUE( compareVectors( values, cached ) );
+  MDAL_SetCacheSize( 0 );
+  EXPECT_EQ( 0, MDAL_CacheSize() );
+
   MDAL_CloseMesh( m );
 }
 
@@ -220,6 +243,12 @@ TEST( MeshBinaryDatTest, WriteScalarTest )
     ASSERT_EQ( 2, MDAL_G_datasetCount( g ) );
     ASSERT_EQ( g, MDAL_D_group( MDAL_G_dataset( g, 0 ) ) );
 
+    // written time steps are read back from the file
+    DatasetH ds = MDAL_G_dataset( g, 1 );
+    EXPECT_DOUBLE_EQ( 1.0, MDAL_D_time( ds ) );
+    EXPECT_DOUBLE_EQ( 5, getValue( ds, 4 ) );
+    EXPECT_EQ( 1, getActive( ds, 1 ) );
+
     MDAL_CloseMesh( m );
   }
 
@@ -269,6 +298,31 @@ TEST( MeshBinaryDatTest, WriteScalarTest )
   }
 }
 
+TEST( MeshBinaryDatTest, WriteStatisticsOfStoredValues )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  std::string scalarPath = tmp_file( "/2dm_WriteStatisticsOfStoredValues.dat" );
+  std::vector<double> vals = {0.1, 0.2, 0.3, 0.4, 0.7};
+
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  DatasetGroupH g = MDAL_M_addDatasetGroup( m, "floatGrp", MDAL_DataLocation::DataOnVertices2D, true,
+                    MDAL_driverFromName( "BINARY_DAT" ), scalarPath.c_str() );
+  ASSERT_NE( g, nullptr );
+  MDAL_G_addDataset( g, 0.1, vals.data(), nullptr );
+
+  // values are stored as float, statistics match the values read back
+  DatasetH ds = MDAL_G_dataset( g, 0 );
+  EXPECT_EQ( static_cast<double>( 0.1f ), getValue( ds, 0 ) );
+  double min, max;
+  MDAL_D_minimumMaximum( ds, &min, &max );
+  EXPECT_EQ( static_cast<double>( 0.1f ), min );
+  EXPECT_EQ( static_cast<double>( 0.7f ), max );
+
+  MDAL_G_closeEditMode( g );
+  MDAL_CloseMesh( m );
+}
+
 TEST( MeshBinaryDatTest, WriteVectorTest )
 {
   std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
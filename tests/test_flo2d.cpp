@@ -3,6 +3,7 @@
  Copyright (C) 2018 Peter Petrik (zilolv at gmail dot com)
 */
 #include "gtest/gtest.h"
+#include <string.h>
 #include <string>
 #include <vector>
 #include <cmath>
@@ -62,6 +63,10 @@ TEST( MeshFlo2dTest, WriteBarnHDF5_New )
     ASSERT_FALSE( MDAL_G_isInEditMode( g ) );
     ASSERT_EQ( 2, MDAL_G_datasetCount( g ) );
 
+    // written time steps are read back from the file
+    EXPECT_DOUBLE_EQ( 1.0, MDAL_D_time( MDAL_G_dataset( g, 1 ) ) );
+    EXPECT_DOUBLE_EQ( 1.1000000238418579, getValue( MDAL_G_dataset( g, 1 ), 2 ) );
+
     // add vector group
     DatasetGroupH gV = MDAL_M_addDatasetGroup(
                          m,
@@ -131,6 +136,8 @@ TEST( MeshFlo2dTest, WriteBarnHDF5_New )
 
       double value = getValue( ds, 2 );
       EXPECT_DOUBLE_EQ( 1.1000000238418579, value );
+
+      EXPECT_DOUBLE_EQ( 1.0, MDAL_D_time( MDAL_G_dataset( g, 1 ) ) );
     }
 
     // vector group
@@ -359,6 +366,64 @@ TEST( MeshFlo2dTest, WriteBarnHDF5_Append )
   deleteFile( fplainFile );
 }
 
+TEST( MeshFlo2dTest, WriteBarnHDF5_AppendToOpenedFile )
+{
+  std::string cadtsFile = tmp_file( "/CADPTS.DAT" );
+  std::string fplainFile = tmp_file( "/FPLAIN.DAT" );
+  std::string appendedFile = tmp_file( "/TIMDEP.HDF5" );
+
+  //prepare
+  deleteFile( cadtsFile );
+  deleteFile( fplainFile );
+  deleteFile( appendedFile );
+
+  copy( test_file( "/flo2d/BarnHDF5/TIMDEP.HDF5" ), appendedFile );
+  copy( test_file( "/flo2d/BarnHDF5/CADPTS.DAT" ), cadtsFile );
+  copy( test_file( "/flo2d/BarnHDF5/FPLAIN.DAT" ), fplainFile );
+
+  size_t f_count = 521;
+  std::vector<double> valsScalar( f_count, 1.0 );
+
+  {
+    // the datasets of the mesh are read from the file to which the group is added
+    MeshH m = MDAL_LoadMesh( appendedFile.c_str() );
+    ASSERT_NE( m, nullptr );
+    ASSERT_EQ( 5, MDAL_M_datasetGroupCount( m ) );
+    DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 1 ), 0 );
+    EXPECT_DOUBLE_EQ( 4262.8798828125, getValue( ds, 1 ) );
+
+    DatasetGroupH g = MDAL_M_addDatasetGroup(
+                        m,
+                        "scalarGrp",
+                        MDAL_DataLocation::DataOnFaces2D,
+                        true,
+                        MDAL_driverFromName( "FLO2D" ),
+                        appendedFile.c_str()
+                      );
+    ASSERT_NE( g, nullptr );
+    MDAL_G_addDataset( g, 0.0, valsScalar.data(), nullptr );
+    MDAL_G_closeEditMode( g );
+    EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+    // the file is opened again for reading
+    EXPECT_DOUBLE_EQ( 4262.8798828125, getValue( ds, 1 ) );
+    MDAL_CloseMesh( m );
+  }
+
+  {
+    MeshH m = MDAL_LoadMesh( appendedFile.c_str() );
+    ASSERT_NE( m, nullptr );
+    ASSERT_EQ( 6, MDAL_M_datasetGroupCount( m ) );
+    DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 5 ), 0 );
+    EXPECT_DOUBLE_EQ( 1.0, getValue( ds, 10 ) );
+    MDAL_CloseMesh( m );
+  }
+
+  deleteFile( cadtsFile );
+  deleteFile( fplainFile );
+  deleteFile( appendedFile );
+}
+
 TEST( MeshFlo2dTest, BarnHDF5 )
 {
   std::string path = test_file( "/flo2d/BarnHDF5/BASE.OUT" );
@@ -882,6 +947,262 @@ TEST( MeshFlo2dTest, pro_16_02_14 )
 }
 
 
+TEST( MeshFlo2dTest, LargeTimdepOut )
+{
+  // grid of cells with more face lines than one block of the offsets index of TIMDEP.OUT
+  const int columns = 50;
+  const int rows = 50;
+  const int cellsCount = columns * rows;
+  const std::string baseFile = tmp_file( "/BASE.OUT" );
+  const std::string cadtsFile = tmp_file( "/CADPTS.DAT" );
+  const std::string fplainFile = tmp_file( "/FPLAIN.DAT" );
+  const std::string timdepFile = tmp_file( "/TIMDEP.OUT" );
+  deleteFile( tmp_file( "/TIMDEP.HDF5" ) );
+
+  FILE *base = fopen( baseFile.c_str(), "w" );
+  ASSERT_NE( base, nullptr );
+  fclose( base );
+
+  FILE *cadpts = fopen( cadtsFile.c_str(), "w" );
+  FILE *fplain = fopen( fplainFile.c_str(), "w" );
+  ASSERT_NE( cadpts, nullptr );
+  ASSERT_NE( fplain, nullptr );
+  for ( int i = 0; i < cellsCount; ++i )
+  {
+    const int c = i % columns;
+    const int r = i / columns;
+    fprintf( cadpts, "%d %d.5 %d.5\n", i + 1, c, r );
+    const int north = r + 1 < rows ? i + 1 + columns : 0;
+    const int east = c + 1 < columns ? i + 2 : 0;
+    const int south = r > 0 ? i + 1 - columns : 0;
+    const int west = c > 0 ? i : 0;
+    fprintf( fplain, "%d %d %d %d %d 0.025 %d.5\n", i + 1, north, east, south, west, i % 3 );
+  }
+  fclose( cadpts );
+  fclose( fplain );
+
+  // second time step is not complete, the missing values are NaN
+  FILE *timdep = fopen( timdepFile.c_str(), "w" );
+  ASSERT_NE( timdep, nullptr );
+  for ( int ts = 0; ts < 2; ++ts )
+  {
+    fprintf( timdep, "      %d.50\r\n", ts );
+    const int linesCount = ts == 0 ? cellsCount : cellsCount - 100;
+    for ( int i = 0; i < linesCount; ++i )
+      fprintf( timdep, "%6d %9d.25 %9.2f %9d.00 %9d.00\r\n", i + 1, ( i + ts ) % 5, 0.0, i, -i );
+  }
+  fclose( timdep );
+
+  MeshH m = MDAL_LoadMesh( baseFile.c_str() );
+  ASSERT_NE( m, nullptr );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( cellsCount, MDAL_M_faceCount( m ) );
+  EXPECT_EQ( ( columns + 1 ) * ( rows + 1 ), MDAL_M_vertexCount( m ) );
+  ASSERT_EQ( 4, MDAL_M_datasetGroupCount( m ) );
+
+  DatasetGroupH depth = MDAL_M_datasetGroup( m, 1 );
+  EXPECT_EQ( std::string( "Depth" ), std::string( MDAL_G_name( depth ) ) );
+  ASSERT_EQ( 2, MDAL_G_datasetCount( depth ) );
+  DatasetH ds = MDAL_G_dataset( depth, 1 );
+  EXPECT_TRUE( compareDurationInHours( 1.5, MDAL_D_time( ds ) ) );
+  EXPECT_DOUBLE_EQ( 2.25, getValue( ds, 2201 ) );
+  EXPECT_DOUBLE_EQ( 0.25, getValue( ds, 2399 ) );
+  EXPECT_TRUE( std::isnan( getValue( ds, 2400 ) ) );
+  double min, max;
+  MDAL_D_minimumMaximum( ds, &min, &max );
+  EXPECT_DOUBLE_EQ( 0.25, min );
+  EXPECT_DOUBLE_EQ( 4.25, max );
+
+  DatasetGroupH velocity = MDAL_M_datasetGroup( m, 2 );
+  EXPECT_EQ( std::string( "Velocity" ), std::string( MDAL_G_name( velocity ) ) );
+  ds = MDAL_G_dataset( velocity, 0 );
+  EXPECT_DOUBLE_EQ( 1500, getValueX( ds, 1500 ) );
+  EXPECT_DOUBLE_EQ( -1500, getValueY( ds, 1500 ) );
+  EXPECT_TRUE( std::isnan( getValueX( ds, 0 ) ) );
+
+  DatasetGroupH waterLevel = MDAL_M_datasetGroup( m, 3 );
+  EXPECT_EQ( std::string( "Water Level" ), std::string( MDAL_G_name( waterLevel ) ) );
+  ds = MDAL_G_dataset( waterLevel, 0 );
+  EXPECT_DOUBLE_EQ( 3.25 + 2.5, getValue( ds, 2003 ) );
+  EXPECT_DOUBLE_EQ( 0.25 + 1.5, getValue( ds, 2005 ) );
+
+  MDAL_CloseMesh( m );
+  deleteFile( baseFile );
+  deleteFile( cadtsFile );
+  deleteFile( fplainFile );
+  deleteFile( timdepFile );
+}
+
+//! Checks the values of the meshes are the same bit by bit, including NaN
+static void _compareDatasets( MeshH m, MeshH other )
+{
+  ASSERT_EQ( MDAL_M_datasetGroupCount( m ), MDAL_M_datasetGroupCount( other ) );
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( m ); ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    DatasetGroupH otherGroup = MDAL_M_datasetGroup( other, g );
+    const bool isScalar = MDAL_G_hasScalarData( group );
+    ASSERT_EQ( MDAL_G_datasetCount( group ), MDAL_G_datasetCount( otherGroup ) );
+    for ( int d = 0; d < MDAL_G_datasetCount( group ); ++d )
+    {
+      DatasetH ds = MDAL_G_dataset( group, d );
+      DatasetH otherDs = MDAL_G_dataset( otherGroup, d );
+      const int count = MDAL_D_valueCount( ds );
+      const size_t size = static_cast<size_t>( isScalar ? count : 2 * count );
+      const MDAL_DataType type = isScalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+      std::vector<double> values( size ), otherValues( size );
+      ASSERT_EQ( count, MDAL_D_data( ds, 0, count, type, values.data() ) );
+      ASSERT_EQ( count, MDAL_D_data( otherDs, 0, count, type, otherValues.data() ) );
+      EXPECT_EQ( 0, memcmp( values.data(), otherValues.data(), size * sizeof( double ) ) );
+
+      std::vector<int> indices( count ), otherIndices( count );
+      const int validCount = MDAL_D_validIndices( ds, 0, count, indices.data() );
+      EXPECT_EQ( validCount, MDAL_D_validIndices( otherDs, 0, count, otherIndices.data() ) );
+      EXPECT_EQ( indices, otherIndices );
+
+      double min, max, otherMin, otherMax;
+      MDAL_D_minimumMaximum( ds, &min, &max );
+      MDAL_D_minimumMaximum( otherDs, &otherMin, &otherMax );
+      EXPECT_EQ( std::isnan( min ), std::isnan( otherMin ) );
+      if ( !std::isnan( min ) )
+      {
+        EXPECT_DOUBLE_EQ( min, otherMin );
+        EXPECT_DOUBLE_EQ( max, otherMax );
+      }
+    }
+  }
+}
+
+TEST( MeshFlo2dTest, CompressedDatasets )
+{
+  const std::string path = test_file( "/flo2d/pro_16_02_14/BASE.OUT" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_SetOpenOption( "COMPRESS_DATASETS", "YES" );
+  MeshH compressed = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetOpenOption( "COMPRESS_DATASETS", "" );
+  ASSERT_NE( compressed, nullptr );
+
+  _compareDatasets( m, compressed );
+
+  MDAL_CloseMesh( compressed );
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshFlo2dTest, LoadKeepsLoadedDatasets )
+{
+  const std::string path = test_file( "/flo2d/BarnHDF5/TIMDEP.HDF5" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  const int groupsCount = MDAL_M_datasetGroupCount( m );
+  DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 0 );
+  int stride = 0;
+  const double *values = MDAL_D_dataPointer( ds, &stride );
+  ASSERT_NE( values, nullptr );
+
+  // datasets loaded before may be held by the caller, they are not made sparse by the next load
+  MDAL_SetOpenOption( "SPARSE_DATASETS", "1" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  MDAL_SetOpenOption( "SPARSE_DATASETS", "" );
+  EXPECT_GT( MDAL_M_datasetGroupCount( m ), groupsCount );
+  EXPECT_EQ( ds, MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 0 ) );
+  EXPECT_EQ( values, MDAL_D_dataPointer( ds, &stride ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshFlo2dTest, SparseDatasets )
+{
+  const std::string path = test_file( "/flo2d/pro_16_02_14/BASE.OUT" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  // every dataset is sparse, the rest of them compressed with the lower fraction
+  for ( const char *fraction : { "1", "0.2" } )
+  {
+    MDAL_SetOpenOption( "SPARSE_DATASETS", fraction );
+    MDAL_SetOpenOption( "COMPRESS_DATASETS", "YES" );
+    MeshH sparse = MDAL_LoadMesh( path.c_str() );
+    MDAL_SetOpenOption( "SPARSE_DATASETS", "" );
+    MDAL_SetOpenOption( "COMPRESS_DATASETS", "" );
+    ASSERT_NE( sparse, nullptr );
+
+    _compareDatasets( m, sparse );
+    MDAL_CloseMesh( sparse );
+  }
+
+  // valid indices of a range
+  DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 1 ), 1 );
+  const int count = MDAL_D_valueCount( ds );
+  std::vector<double> values( count );
+  ASSERT_EQ( count, MDAL_D_data( ds, 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  std::vector<int> expected;
+  for ( int i = 10; i < count - 10; ++i )
+  {
+    if ( !std::isnan( values[i] ) )
+      expected.push_back( i );
+  }
+  std::vector<int> indices( count );
+  indices.resize( MDAL_D_validIndices( ds, 10, count - 20, indices.data() ) );
+  EXPECT_EQ( expected, indices );
+  EXPECT_EQ( 0, MDAL_D_validIndices( ds, count, 1, indices.data() ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshFlo2dTest, DataPointer )
+{
+  const std::string path = test_file( "/flo2d/pro_16_02_14/BASE.OUT" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( m ); ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    DatasetH ds = MDAL_G_dataset( group, 0 );
+    const int count = MDAL_D_valueCount( ds );
+    const bool isScalar = MDAL_G_hasScalarData( group );
+    std::vector<double> values( isScalar ? count : 2 * count );
+    ASSERT_EQ( count, MDAL_D_data( ds, 0, count, isScalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE, values.data() ) );
+
+    // elevation and maximums are held in memory, TIMDEP.OUT results are read on demand
+    int stride = 0;
+    const double *pointer = MDAL_D_dataPointer( ds, &stride );
+    EXPECT_EQ( g == 0 || g > 3, pointer != nullptr );
+    EXPECT_EQ( isScalar ? 1 : 2, stride );
+    EXPECT_EQ( nullptr, MDAL_D_dataPointerFloat( ds, &stride ) );
+    if ( pointer )
+    {
+      EXPECT_EQ( 0, memcmp( values.data(), pointer, values.size() * sizeof( double ) ) );
+      EXPECT_EQ( pointer, MDAL_D_dataPointer( ds, nullptr ) );
+    }
+  }
+
+  // values are not held as doubles
+  MDAL_SetOpenOption( "COMPRESS_DATASETS", "YES" );
+  MeshH compressed = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetOpenOption( "COMPRESS_DATASETS", "" );
+  ASSERT_NE( compressed, nullptr );
+  EXPECT_EQ( nullptr, MDAL_D_dataPointer( MDAL_G_dataset( MDAL_M_datasetGroup( compressed, 0 ), 0 ), nullptr ) );
+  MDAL_CloseMesh( compressed );
+
+  MDAL_SetOpenOption( "SINGLE_PRECISION", "YES" );
+  MeshH singlePrecision = MDAL_LoadMesh( path.c_str() );
+  MDAL_SetOpenOption( "SINGLE_PRECISION", "" );
+  ASSERT_NE( singlePrecision, nullptr );
+  DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( singlePrecision, 0 ), 0 );
+  EXPECT_EQ( nullptr, MDAL_D_dataPointer( ds, nullptr ) );
+  const int count = MDAL_D_valueCount( ds );
+  std::vector<float> floats( count );
+  ASSERT_EQ( count, MDAL_D_data( ds, 0, count, MDAL_DataType::SCALAR_FLOAT, floats.data() ) );
+  const float *floatPointer = MDAL_D_dataPointerFloat( ds, nullptr );
+  ASSERT_NE( floatPointer, nullptr );
+  EXPECT_EQ( 0, memcmp( floats.data(), floatPointer, floats.size() * sizeof( float ) ) );
+  MDAL_CloseMesh( singlePrecision );
+
+  MDAL_CloseMesh( m );
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
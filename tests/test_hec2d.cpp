@@ -7,6 +7,7 @@
 #include <vector>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 //mdal
 #include "mdal.h"
@@ -174,6 +175,15 @@ TEST( MeshHec2dTest, MultiAreas )
   int f_count = MDAL_M_faceCount( m );
   EXPECT_EQ( 725, f_count );
 
+  // ///////////
+  // Edges, stored in the file for each area
+  // ///////////
+  EXPECT_EQ( 1398, MDAL_M_edgeCount( m ) );
+  std::vector<int> edge( 2 );
+  EXPECT_EQ( 1, MDAL_M_edgeVertices( m, 1, 1, edge.data() ) );
+  EXPECT_EQ( 11, edge[0] );
+  EXPECT_EQ( 13, edge[1] );
+
   // ///////////
   // Bed elevation dataset
   // ///////////
@@ -265,6 +275,56 @@ TEST( MeshHec2dTest, MultiAreas )
   MDAL_CloseMesh( m );
 }
 
+TEST( MeshHec2dTest, MultiAreasPartialReads )
+{
+  std::string path = test_file( "/hec2d/2areas/baldeagle_multi2d.hdf" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  // values are read per flow area, chunks crossing the areas must match the whole read,
+  // chunks of the first and last time step are read alternately, so values kept for one time step are not reused for the other
+  const int f_count = MDAL_M_faceCount( m );
+  const int chunk = 100;
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+    ASSERT_NE( g, nullptr );
+    const int datasetIndexes[2] = { 0, MDAL_G_datasetCount( g ) - 1 };
+
+    std::vector<double> expected[2];
+    for ( int d = 0; d < 2; ++d )
+    {
+      DatasetH ds = MDAL_G_dataset( g, datasetIndexes[d] );
+      ASSERT_NE( ds, nullptr );
+      expected[d].resize( static_cast<size_t>( f_count ) );
+      ASSERT_EQ( f_count, MDAL_D_data( ds, 0, f_count, MDAL_DataType::SCALAR_DOUBLE, expected[d].data() ) );
+    }
+
+    for ( int start = 0; start < f_count; start += chunk )
+    {
+      for ( int d = 0; d < 2; ++d )
+      {
+        DatasetH ds = MDAL_G_dataset( g, datasetIndexes[d] );
+        const int count = std::min( chunk, f_count - start );
+        std::vector<double> values( static_cast<size_t>( count ) );
+        ASSERT_EQ( count, MDAL_D_data( ds, start, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+        for ( int j = 0; j < count; ++j )
+        {
+          const double e = expected[d][static_cast<size_t>( start + j )];
+          if ( std::isnan( e ) )
+            EXPECT_TRUE( std::isnan( values[static_cast<size_t>( j )] ) );
+          else
+            EXPECT_DOUBLE_EQ( e, values[static_cast<size_t>( j )] );
+        }
+      }
+    }
+  }
+
+  EXPECT_TRUE( compareDataBlock( MDAL_M_datasetGroup( m, 1 ), 2, 4, 650, 75 ) );
+
+  MDAL_CloseMesh( m );
+}
+
 TEST( MeshHec2dTest, model_505 )
 {
   std::string path = test_file( "/hec2d/2dmodel_5.0.5/temp.p01.hdf" );
@@ -4,6 +4,9 @@
  (christophe dot coulet at arteliagroup dot com)
 */
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <string>
 #include <vector>
 
@@ -204,11 +207,133 @@ TEST( MeshSLFTest, MalpassetResultFrench )
   EXPECT_DOUBLE_EQ( 2.3694833011052991e-12, min );
   EXPECT_DOUBLE_EQ( 7.5673562379016834, max );
 
+  // values are read from the file per time step on request
+  EXPECT_TRUE( compareDataBlock( r, 0, 2, 8000, 1000 ) );
+
   EXPECT_TRUE( compareReferenceTime( r, "1900-01-01T00:00:00" ) );
 
   MDAL_CloseMesh( m );
 }
 
+static void _countReadyGroup( DatasetGroupH, void *userData )
+{
+  ++*static_cast<std::atomic<int> *>( userData );
+}
+
+static void _expectSameMinimumMaximum( double expectedMin, double expectedMax, double min, double max )
+{
+  EXPECT_EQ( std::isnan( expectedMin ), std::isnan( min ) );
+  EXPECT_EQ( std::isnan( expectedMax ), std::isnan( max ) );
+  if ( !std::isnan( expectedMin ) )
+  {
+    EXPECT_DOUBLE_EQ( expectedMin, min );
+  }
+  if ( !std::isnan( expectedMax ) )
+  {
+    EXPECT_DOUBLE_EQ( expectedMax, max );
+  }
+}
+
+TEST( MeshSLFTest, ProgressiveLoad )
+{
+  std::string path = test_file( "/slf/example_res_fr.slf" );
+  MeshH expected = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( expected, nullptr );
+
+  std::atomic<int> readyCount( 0 );
+  MDAL_SetGroupReadyCallback( &_countReadyGroup, &readyCount );
+  MDAL_SetOpenOption( "PROGRESSIVE_LOAD", "YES" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // groups are there before they are ready
+  ASSERT_EQ( MDAL_M_datasetGroupCount( expected ), MDAL_M_datasetGroupCount( m ) );
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    DatasetGroupH expectedGroup = MDAL_M_datasetGroup( expected, i );
+    DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+    EXPECT_TRUE( MDAL_G_isReady( expectedGroup ) );
+    EXPECT_TRUE( MDAL_G_waitUntilReady( g ) );
+    EXPECT_TRUE( MDAL_G_isReady( g ) );
+
+    double expectedMin, expectedMax, min, max;
+    MDAL_G_minimumMaximum( expectedGroup, &expectedMin, &expectedMax );
+    MDAL_G_minimumMaximum( g, &min, &max );
+    _expectSameMinimumMaximum( expectedMin, expectedMax, min, max );
+
+    for ( int d = 0; d < MDAL_G_datasetCount( g ); ++d )
+    {
+      MDAL_D_minimumMaximum( MDAL_G_dataset( expectedGroup, d ), &expectedMin, &expectedMax );
+      MDAL_D_minimumMaximum( MDAL_G_dataset( g, d ), &min, &max );
+      _expectSameMinimumMaximum( expectedMin, expectedMax, min, max );
+    }
+  }
+  // the background thread is finished with the callbacks when the mesh is closed
+  const int groupCount = MDAL_M_datasetGroupCount( m );
+  MDAL_CloseMesh( m );
+  EXPECT_EQ( groupCount, readyCount );
+
+  // closed during the background load
+  m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_CloseMesh( m );
+
+  MDAL_SetOpenOption( "PROGRESSIVE_LOAD", "" );
+  MDAL_SetGroupReadyCallback( nullptr, nullptr );
+  MDAL_CloseMesh( expected );
+}
+
+TEST( MeshSLFTest, ActiveFlagsByBlocks )
+{
+  std::string path = test_file( "/slf/example_res_fr.slf" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+
+  DatasetH ds = MDAL_G_dataset( MDAL_M_datasetGroup( m, 0 ), 1 );
+  ASSERT_NE( ds, nullptr );
+  const int facesCount = MDAL_M_faceCount( m );
+  std::vector<int> active( static_cast<size_t>( facesCount ) );
+  ASSERT_EQ( facesCount, MDAL_D_data( ds, 0, facesCount, MDAL_DataType::ACTIVE_INTEGER, active.data() ) );
+
+  // blocks are served from the flags of the time step
+  const int blockSize = 1000;
+  std::vector<int> block( blockSize );
+  for ( int start = 0; start < facesCount; start += blockSize )
+  {
+    const int count = std::min( blockSize, facesCount - start );
+    ASSERT_EQ( count, MDAL_D_data( ds, start, blockSize, MDAL_DataType::ACTIVE_INTEGER, block.data() ) );
+    for ( int i = 0; i < count; ++i )
+      EXPECT_EQ( active[static_cast<size_t>( start + i )], block[static_cast<size_t>( i )] );
+  }
+  EXPECT_EQ( 0, MDAL_D_data( ds, facesCount, 1, MDAL_DataType::ACTIVE_INTEGER, block.data() ) );
+
+  MDAL_CloseMesh( m );
+}
+
+static bool _cancelAfterFirstReport( double, void *userData )
+{
+  int *reportsCount = static_cast<int *>( userData );
+  return ++( *reportsCount ) < 2;
+}
+
+TEST( MeshSLFTest, CancelledLoad )
+{
+  std::string path = test_file( "/slf/example_res_fr.slf" );
+  int reportsCount = 0;
+  MDAL_SetProgressCallback( &_cancelAfterFirstReport, &reportsCount );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  EXPECT_EQ( m, nullptr );
+  EXPECT_EQ( MDAL_Status::Err_Cancelled, MDAL_LastStatus() );
+  EXPECT_EQ( 2, reportsCount );
+  MDAL_SetProgressCallback( nullptr, nullptr );
+
+  m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  MDAL_CloseMesh( m );
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
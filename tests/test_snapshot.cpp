@@ -0,0 +1,264 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+#include "gtest/gtest.h"
+#include <string>
+#include <vector>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string.h>
+
+//mdal
+#include "mdal.h"
+#include "mdal_testutils.hpp"
+
+//! Same groups, datasets, values and active flags
+static void _compareDatasets( MeshH meshA, MeshH meshB )
+{
+  ASSERT_EQ( MDAL_M_datasetGroupCount( meshA ), MDAL_M_datasetGroupCount( meshB ) );
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( meshA ); ++i )
+  {
+    DatasetGroupH groupA = MDAL_M_datasetGroup( meshA, i );
+    DatasetGroupH groupB = MDAL_M_datasetGroup( meshB, i );
+    EXPECT_EQ( std::string( MDAL_G_name( groupA ) ), std::string( MDAL_G_name( groupB ) ) );
+    EXPECT_EQ( MDAL_G_hasScalarData( groupA ), MDAL_G_hasScalarData( groupB ) );
+    EXPECT_EQ( MDAL_G_dataLocation( groupA ), MDAL_G_dataLocation( groupB ) );
+    EXPECT_EQ( MDAL_G_metadataCount( groupA ), MDAL_G_metadataCount( groupB ) );
+
+    double minA, maxA, minB, maxB;
+    MDAL_G_minimumMaximum( groupA, &minA, &maxA );
+    MDAL_G_minimumMaximum( groupB, &minB, &maxB );
+    EXPECT_DOUBLE_EQ( minA, minB );
+    EXPECT_DOUBLE_EQ( maxA, maxB );
+
+    ASSERT_EQ( MDAL_G_datasetCount( groupA ), MDAL_G_datasetCount( groupB ) );
+    for ( int j = 0; j < MDAL_G_datasetCount( groupA ); ++j )
+    {
+      DatasetH datasetA = MDAL_G_dataset( groupA, j );
+      DatasetH datasetB = MDAL_G_dataset( groupB, j );
+      EXPECT_DOUBLE_EQ( MDAL_D_time( datasetA ), MDAL_D_time( datasetB ) );
+      ASSERT_EQ( MDAL_D_valueCount( datasetA ), MDAL_D_valueCount( datasetB ) );
+      EXPECT_EQ( MDAL_D_hasActiveFlagCapability( datasetA ), MDAL_D_hasActiveFlagCapability( datasetB ) );
+
+      for ( int k = 0; k < MDAL_D_valueCount( datasetA ); ++k )
+      {
+        if ( MDAL_G_hasScalarData( groupA ) )
+        {
+          const double valueA = getValue( datasetA, k );
+          const double valueB = getValue( datasetB, k );
+          EXPECT_TRUE( ( std::isnan( valueA ) && std::isnan( valueB ) ) || valueA == valueB );
+        }
+        else
+        {
+          EXPECT_DOUBLE_EQ( getValueX( datasetA, k ), getValueX( datasetB, k ) );
+          EXPECT_DOUBLE_EQ( getValueY( datasetA, k ), getValueY( datasetB, k ) );
+        }
+      }
+
+      if ( MDAL_D_hasActiveFlagCapability( datasetA ) )
+      {
+        for ( int k = 0; k < MDAL_M_faceCount( meshA ); ++k )
+          EXPECT_EQ( getActive( datasetA, k ), getActive( datasetB, k ) );
+      }
+    }
+  }
+}
+
+TEST( MeshSnapshotTest, SaveAndLoad )
+{
+  EXPECT_TRUE( MDAL_DR_saveMeshCapability( MDAL_driverFromName( "MDALB" ) ) );
+
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( mesh, nullptr );
+  std::string scalarFile = test_file( "/ascii_dat/quad_and_triangle_vertex_scalar.dat" );
+  MDAL_M_LoadDatasets( mesh, scalarFile.c_str() );
+  std::string vectorFile = test_file( "/ascii_dat/quad_and_triangle_els_vector.dat" );
+  MDAL_M_LoadDatasets( mesh, vectorFile.c_str() );
+  ASSERT_EQ( MDAL_M_datasetGroupCount( mesh ), 3 );
+
+  std::string snapshotFile = tmp_file( "/quad_and_triangle.mdalb" );
+  MDAL_SaveMesh( mesh, snapshotFile.c_str(), "MDALB" );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  MeshH snapshot = MDAL_LoadMesh( snapshotFile.c_str() );
+  ASSERT_NE( snapshot, nullptr );
+  EXPECT_EQ( std::string( "MDALB" ), std::string( MDAL_M_driverName( snapshot ) ) );
+  EXPECT_EQ( MDAL_M_faceVerticesMaximumCount( mesh ), MDAL_M_faceVerticesMaximumCount( snapshot ) );
+  EXPECT_EQ( MDAL_M_uniformFaceVerticesCount( mesh ), MDAL_M_uniformFaceVerticesCount( snapshot ) );
+  EXPECT_TRUE( compareMeshFrames( mesh, snapshot ) );
+
+  // faces of the snapshot are read by the iterator, not in place
+  RenderBuffersH buffers = MDAL_M_renderBuffers( mesh, MDAL_RenderVertices::RenderFaceCorners, 1000, 2000, 0 );
+  RenderBuffersH snapshotBuffers = MDAL_M_renderBuffers( snapshot, MDAL_RenderVertices::RenderFaceCorners, 1000, 2000, 0 );
+  ASSERT_NE( buffers, nullptr );
+  ASSERT_NE( snapshotBuffers, nullptr );
+  const int64_t renderVerticesCount = MDAL_RB_vertexCount( buffers );
+  const int64_t trianglesCount = MDAL_RB_triangleCount( buffers );
+  ASSERT_EQ( renderVerticesCount, MDAL_RB_vertexCount( snapshotBuffers ) );
+  ASSERT_EQ( trianglesCount, MDAL_RB_triangleCount( snapshotBuffers ) );
+  EXPECT_EQ( std::vector<float>( MDAL_RB_vertices( buffers ), MDAL_RB_vertices( buffers ) + 3 * renderVerticesCount ),
+             std::vector<float>( MDAL_RB_vertices( snapshotBuffers ), MDAL_RB_vertices( snapshotBuffers ) + 3 * renderVerticesCount ) );
+  EXPECT_EQ( std::vector<uint32_t>( MDAL_RB_indices( buffers ), MDAL_RB_indices( buffers ) + 3 * trianglesCount ),
+             std::vector<uint32_t>( MDAL_RB_indices( snapshotBuffers ), MDAL_RB_indices( snapshotBuffers ) + 3 * trianglesCount ) );
+  MDAL_RB_close( buffers );
+  MDAL_RB_close( snapshotBuffers );
+  _compareDatasets( mesh, snapshot );
+
+  double minX, maxX, minY, maxY, snapshotMinX, snapshotMaxX, snapshotMinY, snapshotMaxY;
+  MDAL_M_extent( mesh, &minX, &maxX, &minY, &maxY );
+  MDAL_M_extent( snapshot, &snapshotMinX, &snapshotMaxX, &snapshotMinY, &snapshotMaxY );
+  EXPECT_DOUBLE_EQ( minX, snapshotMinX );
+  EXPECT_DOUBLE_EQ( maxX, snapshotMaxX );
+  EXPECT_DOUBLE_EQ( minY, snapshotMinY );
+  EXPECT_DOUBLE_EQ( maxY, snapshotMaxY );
+
+  // faces selected by extent are read up to the last selected one from the snapshot, in place from the memory mesh
+  const double extents[2][4] = { { minX, maxX, minY, maxY }, { minX, minX, minY, minY } };
+  for ( const double *extent : extents )
+  {
+    std::vector<int> faces[2];
+    MeshH meshes[2] = { mesh, snapshot };
+    for ( int i = 0; i < 2; ++i )
+    {
+      MeshFaceIteratorH it = MDAL_M_faceIteratorInExtent( meshes[i], extent[0], extent[1], extent[2], extent[3] );
+      ASSERT_NE( it, nullptr );
+      int offsets[1];
+      int vertices[16];
+      while ( MDAL_FI_next( it, 1, offsets, 16, vertices ) == 1 )
+        faces[i].insert( faces[i].end(), vertices, vertices + offsets[0] );
+      MDAL_FI_close( it );
+    }
+    EXPECT_FALSE( faces[0].empty() );
+    EXPECT_EQ( faces[0], faces[1] );
+  }
+
+  // the snapshot can be saved over the file it is mapped from
+  MDAL_SaveMesh( snapshot, snapshotFile.c_str(), "MDALB" );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  MeshH resaved = MDAL_LoadMesh( snapshotFile.c_str() );
+  ASSERT_NE( resaved, nullptr );
+  EXPECT_TRUE( compareMeshFrames( mesh, resaved ) );
+  _compareDatasets( mesh, resaved );
+
+  MDAL_CloseMesh( resaved );
+  MDAL_CloseMesh( snapshot );
+  MDAL_CloseMesh( mesh );
+  std::remove( snapshotFile.c_str() );
+}
+
+TEST( MeshSnapshotTest, SaveToBuffer )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( mesh, nullptr );
+  std::string scalarFile = test_file( "/ascii_dat/quad_and_triangle_vertex_scalar.dat" );
+  MDAL_M_LoadDatasets( mesh, scalarFile.c_str() );
+
+  // the header is written last, at the beginning of the buffer
+  void *buffer = nullptr;
+  const int64_t size = MDAL_SaveMeshToBuffer( mesh, "MDALB", &buffer );
+  ASSERT_GT( size, 0 );
+  std::string snapshotFile = tmp_file( "/quad_and_triangle_buffer.mdalb" );
+  {
+    std::ofstream out( snapshotFile, std::ofstream::binary | std::ofstream::trunc );
+    out.write( static_cast<const char *>( buffer ), static_cast<std::streamsize>( size ) );
+  }
+  MDAL_FreeBuffer( buffer );
+
+  MeshH snapshot = MDAL_LoadMesh( snapshotFile.c_str() );
+  ASSERT_NE( snapshot, nullptr );
+  EXPECT_TRUE( compareMeshFrames( mesh, snapshot ) );
+  _compareDatasets( mesh, snapshot );
+
+  MDAL_CloseMesh( snapshot );
+  MDAL_CloseMesh( mesh );
+  std::remove( snapshotFile.c_str() );
+}
+
+TEST( MeshSnapshotTest, InvalidFile )
+{
+  // truncated snapshot is not loaded
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( mesh, nullptr );
+  std::string snapshotFile = tmp_file( "/truncated.mdalb" );
+  MDAL_SaveMesh( mesh, snapshotFile.c_str(), "MDALB" );
+  MDAL_CloseMesh( mesh );
+
+  std::string content;
+  {
+    std::ifstream in( snapshotFile, std::ifstream::binary );
+    content.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+  }
+  {
+    std::ofstream out( snapshotFile, std::ofstream::binary | std::ofstream::trunc );
+    out.write( content.data(), static_cast<std::streamsize>( content.size() / 2 ) );
+  }
+
+  MeshH truncated = MDAL_LoadMesh( snapshotFile.c_str() );
+  EXPECT_EQ( truncated, nullptr );
+  std::remove( snapshotFile.c_str() );
+}
+
+//! Saves the content with the value written at the position, returns whether the file loads
+template<typename T>
+static bool _loadsCorrupted( const std::string &content, size_t position, T value )
+{
+  std::string corrupted = content;
+  memcpy( &corrupted[position], &value, sizeof( T ) );
+  std::string snapshotFile = tmp_file( "/corrupted.mdalb" );
+  {
+    std::ofstream out( snapshotFile, std::ofstream::binary | std::ofstream::trunc );
+    out.write( corrupted.data(), static_cast<std::streamsize>( corrupted.size() ) );
+  }
+  MeshH mesh = MDAL_LoadMesh( snapshotFile.c_str() );
+  MDAL_CloseMesh( mesh );
+  std::remove( snapshotFile.c_str() );
+  return mesh != nullptr;
+}
+
+TEST( MeshSnapshotTest, CorruptedFile )
+{
+  std::string path = test_file( "/2dm/quad_and_triangle.2dm" );
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( mesh, nullptr );
+  std::string snapshotFile = tmp_file( "/corrupted.mdalb" );
+  MDAL_SaveMesh( mesh, snapshotFile.c_str(), "MDALB" );
+  MDAL_CloseMesh( mesh );
+
+  std::string content;
+  {
+    std::ifstream in( snapshotFile, std::ifstream::binary );
+    content.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+  }
+  ASSERT_GT( content.size(), 152u );
+
+  // positions of the counts and offsets in the header
+  uint64_t faceOffsetsOffset, vertexIndicesOffset;
+  memcpy( &faceOffsetsOffset, &content[120], sizeof( uint64_t ) );
+  memcpy( &vertexIndicesOffset, &content[128], sizeof( uint64_t ) );
+
+  EXPECT_TRUE( _loadsCorrupted( content, 0, content[0] ) );
+  // count of faces overflowing the size of the section
+  EXPECT_FALSE( _loadsCorrupted( content, 24, std::numeric_limits<uint64_t>::max() ) );
+  // offsets of the faces going back or beyond the indices
+  EXPECT_FALSE( _loadsCorrupted( content, static_cast<size_t>( faceOffsetsOffset + 8 ), uint64_t( 1000 ) ) );
+  EXPECT_FALSE( _loadsCorrupted( content, static_cast<size_t>( faceOffsetsOffset + 8 ), uint64_t( 0 ) ) );
+  // vertex index out of the vertices
+  EXPECT_FALSE( _loadsCorrupted( content, static_cast<size_t>( vertexIndicesOffset ), uint32_t( 5 ) ) );
+
+  std::remove( snapshotFile.c_str() );
+}
+
+int main( int argc, char **argv )
+{
+  testing::InitGoogleTest( &argc, argv );
+  init_test();
+  int ret =  RUN_ALL_TESTS();
+  finalize_test();
+  return ret;
+}
@@ -3,6 +3,8 @@
  Copyright (C) 2019 Peter Petrik (zilolv at gmail dot com)
 */
 #include "gtest/gtest.h"
+#include <cmath>
+#include <vector>
 
 //mdal
 #include "mdal.h"
@@ -592,6 +594,77 @@ TEST( XdmfTest, Simple )
   MDAL_CloseMesh( m );
 }
 
+TEST( XdmfTest, DerivedGroupsOfFunctions )
+{
+  // derived groups read the function datasets (subtraction, flow, join) by blocks
+  {
+    std::string path = test_file( "/xdmf/basement3/3Slopes/3Slopes_Counter.2dm" );
+    MeshH m = MDAL_LoadMesh( path.c_str() );
+    ASSERT_NE( m, nullptr );
+    path = test_file( "/xdmf/basement3/3Slopes/7_J_run.XMDF" );
+    MDAL_M_LoadDatasets( m, path.c_str() );
+    ASSERT_EQ( 7, MDAL_M_datasetGroupCount( m ) );
+
+    DatasetGroupH g = MDAL_M_addDerivedGroup( m, "discharge", "water_depth * flow_velocity_abs + delta_z" );
+    ASSERT_NE( g, nullptr );
+    DatasetGroupH depth = MDAL_M_datasetGroup( m, 6 );
+    DatasetGroupH velocity = MDAL_M_datasetGroup( m, 4 );
+    DatasetGroupH deltaZ = MDAL_M_datasetGroup( m, 3 );
+    ASSERT_EQ( 2, MDAL_G_datasetCount( g ) );
+
+    const int indexStart = 1000;
+    const int count = 5000;
+    for ( int d = 0; d < 2; ++d )
+    {
+      std::vector<double> depthValues( count );
+      std::vector<double> velocityValues( count );
+      std::vector<double> deltaZValues( count );
+      std::vector<double> values( count );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( depth, d ), indexStart, count, MDAL_DataType::SCALAR_DOUBLE, depthValues.data() ) );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( velocity, d ), indexStart, count, MDAL_DataType::SCALAR_DOUBLE, velocityValues.data() ) );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( deltaZ, d ), indexStart, count, MDAL_DataType::SCALAR_DOUBLE, deltaZValues.data() ) );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, d ), indexStart, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+      for ( size_t i = 0; i < values.size(); ++i )
+      {
+        const double expected = depthValues[i] * velocityValues[i] + deltaZValues[i];
+        if ( std::isnan( expected ) )
+          EXPECT_TRUE( std::isnan( values[i] ) );
+        else
+          EXPECT_DOUBLE_EQ( expected, values[i] );
+      }
+    }
+    MDAL_CloseMesh( m );
+  }
+
+  {
+    std::string path = test_file( "/xdmf/basement3/3HumpsTest/3_humps_mesh.2dm" );
+    MeshH m = MDAL_LoadMesh( path.c_str() );
+    ASSERT_NE( m, nullptr );
+    path = test_file( "/xdmf/basement3/3HumpsTest/three_humps.xdmf" );
+    MDAL_M_LoadDatasets( m, path.c_str() );
+    ASSERT_EQ( 5, MDAL_M_datasetGroupCount( m ) );
+
+    // JOIN vectors are used as magnitudes
+    DatasetGroupH g = MDAL_M_addDerivedGroup( m, "double discharge", "2 * spec_discharge" );
+    ASSERT_NE( g, nullptr );
+    DatasetGroupH discharge = MDAL_M_datasetGroup( m, 3 );
+    ASSERT_EQ( 11, MDAL_G_datasetCount( g ) );
+
+    const int count = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+    ASSERT_EQ( 18497, count );
+    for ( int d : { 0, 5, 10 } )
+    {
+      std::vector<double> vectors( 2 * static_cast<size_t>( count ) );
+      std::vector<double> values( static_cast<size_t>( count ) );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( discharge, d ), 0, count, MDAL_DataType::VECTOR_2D_DOUBLE, vectors.data() ) );
+      ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, d ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+      for ( size_t i = 0; i < values.size(); ++i )
+        EXPECT_DOUBLE_EQ( 2 * std::sqrt( vectors[2 * i] * vectors[2 * i] + vectors[2 * i + 1] * vectors[2 * i + 1] ), values[i] );
+    }
+    MDAL_CloseMesh( m );
+  }
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
@@ -4,6 +4,12 @@
 */
 #include "gtest/gtest.h"
 #include <string>
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <vector>
 
 //mdal
 #include "mdal.h"
@@ -271,6 +277,578 @@ TEST( MeshXmdfTest, CustomGroupsDataset )
   MDAL_CloseMesh( m );
 }
 
+TEST( MeshXmdfTest, DataBlock )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+    const int datasetCount = MDAL_G_datasetCount( g );
+    const int valueCount = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+    EXPECT_TRUE( compareDataBlock( g, 0, datasetCount, 0, valueCount ) );
+    if ( datasetCount > 2 )
+    {
+      EXPECT_TRUE( compareDataBlock( g, 1, datasetCount - 2, 100, 500 ) );
+    }
+  }
+
+  // Depth
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 4 );
+  std::vector<double> values( 3 * 5 );
+  EXPECT_EQ( 15, MDAL_G_dataBlock( g, 50, 3, 60, 5, MDAL_DataType::SCALAR_DOUBLE, MDAL_DataBlockLayout::TimeMajor, values.data() ) );
+  std::vector<double> expectedValues = { 0.173723, 0.572754, 0.285215, 0.661351, 0.369279 };
+  EXPECT_TRUE( compareVectors( std::vector<double>( values.begin(), values.begin() + 5 ), expectedValues ) );
+
+  // out of range
+  EXPECT_EQ( 0, MDAL_G_dataBlock( g, 50, 12, 0, 5, MDAL_DataType::SCALAR_DOUBLE, MDAL_DataBlockLayout::TimeMajor, values.data() ) );
+  EXPECT_EQ( MDAL_Status::Err_IncompatibleDataset, MDAL_LastStatus() );
+  EXPECT_EQ( 0, MDAL_G_dataBlock( g, 50, 3, 1975, 5, MDAL_DataType::SCALAR_DOUBLE, MDAL_DataBlockLayout::TimeMajor, values.data() ) );
+  EXPECT_EQ( 0, MDAL_G_dataBlock( g, 50, 3, 0, 5, MDAL_DataType::VECTOR_2D_DOUBLE, MDAL_DataBlockLayout::TimeMajor, values.data() ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, DataAtIndices )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // unsorted, repeated and far apart indices
+  const std::vector<int> indices = { 1975, 60, 3, 61, 60, 1200, 0 };
+  const int count = static_cast<int>( indices.size() );
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+    DatasetH ds = MDAL_G_dataset( g, MDAL_G_datasetCount( g ) - 1 );
+    if ( MDAL_D_valueCount( ds ) != 1976 )
+      continue;
+
+    if ( MDAL_G_hasScalarData( g ) )
+    {
+      std::vector<double> values( indices.size() );
+      std::vector<float> floatValues( indices.size() );
+      ASSERT_EQ( count, MDAL_D_dataAtIndices( ds, count, indices.data(), MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+      ASSERT_EQ( count, MDAL_D_dataAtIndices( ds, count, indices.data(), MDAL_DataType::SCALAR_FLOAT, floatValues.data() ) );
+      for ( size_t j = 0; j < indices.size(); ++j )
+      {
+        EXPECT_DOUBLE_EQ( getValue( ds, indices[j] ), values[j] );
+        EXPECT_FLOAT_EQ( static_cast<float>( values[j] ), floatValues[j] );
+      }
+    }
+    else
+    {
+      std::vector<double> values( 2 * indices.size() );
+      std::vector<float> floatValues( 2 * indices.size() );
+      ASSERT_EQ( count, MDAL_D_dataAtIndices( ds, count, indices.data(), MDAL_DataType::VECTOR_2D_DOUBLE, values.data() ) );
+      ASSERT_EQ( count, MDAL_D_dataAtIndices( ds, count, indices.data(), MDAL_DataType::VECTOR_2D_FLOAT, floatValues.data() ) );
+      for ( size_t j = 0; j < indices.size(); ++j )
+      {
+        EXPECT_DOUBLE_EQ( getValueX( ds, indices[j] ), values[2 * j] );
+        EXPECT_DOUBLE_EQ( getValueY( ds, indices[j] ), values[2 * j + 1] );
+        EXPECT_FLOAT_EQ( static_cast<float>( values[2 * j + 1] ), floatValues[2 * j + 1] );
+      }
+    }
+
+    if ( MDAL_D_hasActiveFlagCapability( ds ) )
+    {
+      const std::vector<int> faces = { 1800, 5, 900, 5 };
+      std::vector<int> active( faces.size() );
+      ASSERT_EQ( 4, MDAL_D_dataAtIndices( ds, 4, faces.data(), MDAL_DataType::ACTIVE_INTEGER, active.data() ) );
+      for ( size_t j = 0; j < faces.size(); ++j )
+        EXPECT_EQ( getActive( ds, faces[j] ), active[j] );
+    }
+  }
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, SampleTimeSeriesAtPoints )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // points over the mesh extent and around it
+  std::vector<double> x;
+  std::vector<double> y;
+  for ( int i = 0; i < 40; ++i )
+  {
+    x.push_back( 381440 + 4.1 * i );
+    y.push_back( 168695 + 1.7 * i );
+  }
+
+  for ( int g = 0; g < MDAL_M_datasetGroupCount( m ); ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    const size_t seriesSize = static_cast<size_t>( MDAL_G_datasetCount( group ) ) * ( MDAL_G_hasScalarData( group ) ? 1 : 2 );
+    std::vector<double> values( x.size() * seriesSize );
+    ASSERT_EQ( MDAL_G_datasetCount( group ), MDAL_M_sampleTimeSeriesAtPoints( m, group, static_cast<int>( x.size() ), x.data(), y.data(), values.data() ) );
+
+    std::vector<double> expected( seriesSize );
+    for ( size_t p = 0; p < x.size(); ++p )
+    {
+      MDAL_M_sampleTimeSeries( m, group, x[p], y[p], expected.data() );
+      for ( size_t i = 0; i < seriesSize; ++i )
+      {
+        const double value = values[p * seriesSize + i];
+        if ( std::isnan( expected[i] ) )
+          EXPECT_TRUE( std::isnan( value ) );
+        else
+          EXPECT_NEAR( expected[i], value, 1e-9 );
+      }
+    }
+  }
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, TemporalAggregates )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  const int facesCount = MDAL_M_faceCount( m );
+  std::vector<std::vector<int>> faceVertices( static_cast<size_t>( facesCount ) );
+  for ( int f = 0; f < facesCount; ++f )
+  {
+    for ( int j = 0; j < getFaceVerticesCountAt( m, f ); ++j )
+      faceVertices[static_cast<size_t>( f )].push_back( getFaceVerticesIndexAt( m, f, j ) );
+  }
+
+  const int groupCount = MDAL_M_datasetGroupCount( m );
+  for ( int g = 0; g < groupCount; ++g )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    if ( MDAL_G_datasetCount( group ) < 2 )
+      continue;
+
+    // aggregates of the values (magnitudes of vectors) of active faces computed from all datasets
+    const int count = MDAL_D_valueCount( MDAL_G_dataset( group, 0 ) );
+    const bool onVertices = MDAL_G_dataLocation( group ) == MDAL_DataLocation::DataOnVertices2D;
+    std::vector<double> maximum( static_cast<size_t>( count ), -std::numeric_limits<double>::infinity() );
+    std::vector<double> timeOfMaximum( static_cast<size_t>( count ), std::numeric_limits<double>::quiet_NaN() );
+    std::vector<double> sum( static_cast<size_t>( count ), 0 );
+    std::vector<int> validCount( static_cast<size_t>( count ), 0 );
+    for ( int d = 0; d < MDAL_G_datasetCount( group ); ++d )
+    {
+      DatasetH ds = MDAL_G_dataset( group, d );
+      std::vector<bool> isActive( static_cast<size_t>( count ), true );
+      if ( MDAL_D_hasActiveFlagCapability( ds ) )
+      {
+        std::vector<int> active( static_cast<size_t>( facesCount ) );
+        ASSERT_EQ( facesCount, MDAL_D_data( ds, 0, facesCount, MDAL_DataType::ACTIVE_INTEGER, active.data() ) );
+        std::fill( isActive.begin(), isActive.end(), !onVertices );
+        for ( int f = 0; f < facesCount; ++f )
+        {
+          if ( !onVertices )
+            isActive[static_cast<size_t>( f )] = active[static_cast<size_t>( f )] != 0;
+          else if ( active[static_cast<size_t>( f )] != 0 )
+          {
+            for ( int vertex : faceVertices[static_cast<size_t>( f )] )
+              isActive[static_cast<size_t>( vertex )] = true;
+          }
+        }
+      }
+
+      const bool scalar = MDAL_G_hasScalarData( group );
+      std::vector<double> values( static_cast<size_t>( scalar ? count : 2 * count ) );
+      ASSERT_EQ( count, MDAL_D_data( ds, 0, count, scalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE, values.data() ) );
+      for ( size_t i = 0; i < static_cast<size_t>( count ); ++i )
+      {
+        const double value = scalar ? values[i] : std::hypot( values[2 * i], values[2 * i + 1] );
+        if ( !isActive[i] || std::isnan( value ) )
+          continue;
+        if ( value > maximum[i] )
+        {
+          maximum[i] = value;
+          timeOfMaximum[i] = MDAL_D_time( ds );
+        }
+        sum[i] += value;
+        ++validCount[i];
+      }
+    }
+
+    DatasetGroupH maximumGroup = MDAL_G_addTemporalAggregateGroup( group, "maximum", MDAL_TemporalAggregate::TemporalMaximum );
+    DatasetGroupH timeGroup = MDAL_G_addTemporalAggregateGroup( group, "time of maximum", MDAL_TemporalAggregate::TimeOfMaximum );
+    DatasetGroupH meanGroup = MDAL_G_addTemporalAggregateGroup( group, "mean", MDAL_TemporalAggregate::TemporalMean );
+    ASSERT_NE( maximumGroup, nullptr );
+    ASSERT_NE( timeGroup, nullptr );
+    ASSERT_NE( meanGroup, nullptr );
+    EXPECT_TRUE( MDAL_G_hasScalarData( maximumGroup ) );
+    EXPECT_EQ( 1, MDAL_G_datasetCount( maximumGroup ) );
+    EXPECT_EQ( MDAL_G_dataLocation( group ), MDAL_G_dataLocation( maximumGroup ) );
+
+    std::vector<double> maximumValues( static_cast<size_t>( count ) );
+    std::vector<double> timeValues( static_cast<size_t>( count ) );
+    std::vector<double> meanValues( static_cast<size_t>( count ) );
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( maximumGroup, 0 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, maximumValues.data() ) );
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( timeGroup, 0 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, timeValues.data() ) );
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( meanGroup, 0 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, meanValues.data() ) );
+    for ( size_t i = 0; i < static_cast<size_t>( count ); ++i )
+    {
+      if ( validCount[i] == 0 )
+      {
+        EXPECT_TRUE( std::isnan( maximumValues[i] ) );
+        EXPECT_TRUE( std::isnan( timeValues[i] ) );
+        EXPECT_TRUE( std::isnan( meanValues[i] ) );
+        continue;
+      }
+      EXPECT_DOUBLE_EQ( maximum[i], maximumValues[i] );
+      EXPECT_DOUBLE_EQ( timeOfMaximum[i], timeValues[i] );
+      EXPECT_NEAR( sum[i] / validCount[i], meanValues[i], 1e-9 );
+    }
+  }
+
+  // only groups on vertices or faces with datasets
+  EXPECT_EQ( nullptr, MDAL_G_addTemporalAggregateGroup( MDAL_M_datasetGroup( m, 0 ), nullptr, MDAL_TemporalAggregate::TemporalMinimum ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_G_addTemporalAggregateGroup( MDAL_M_datasetGroup( m, 0 ), "unknown", static_cast<MDAL_TemporalAggregate>( 9 ) ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, DerivedGroup )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // time steps of Depth, static bed elevation and magnitude of the vectors
+  const char *expression = "Depth * (\"Vector Velocity\" + 0.5) - \"Bed Elevation\" / 100";
+  DatasetGroupH g = MDAL_M_addDerivedGroup( m, "hazard", expression );
+  ASSERT_NE( g, nullptr );
+  EXPECT_EQ( 10, MDAL_M_datasetGroupCount( m ) );
+  EXPECT_TRUE( MDAL_G_hasScalarData( g ) );
+  EXPECT_EQ( std::string( "expression" ), std::string( MDAL_G_metadataKey( g, 1 ) ) );
+  EXPECT_EQ( std::string( expression ), std::string( MDAL_G_metadataValue( g, 1 ) ) );
+
+  DatasetGroupH depth = MDAL_M_datasetGroup( m, 4 );
+  DatasetGroupH velocity = MDAL_M_datasetGroup( m, 5 );
+  DatasetGroupH bed = MDAL_M_datasetGroup( m, 0 );
+  ASSERT_EQ( MDAL_G_datasetCount( depth ), MDAL_G_datasetCount( g ) );
+
+  const int count = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+  const int facesCount = MDAL_M_faceCount( m );
+  std::vector<double> bedValues( static_cast<size_t>( count ) );
+  ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( bed, 0 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, bedValues.data() ) );
+  for ( int d : { 0, 30, 60 } )
+  {
+    DatasetH ds = MDAL_G_dataset( g, d );
+    EXPECT_DOUBLE_EQ( MDAL_D_time( MDAL_G_dataset( depth, d ) ), MDAL_D_time( ds ) );
+
+    std::vector<double> depthValues( static_cast<size_t>( count ) );
+    std::vector<double> velocityValues( static_cast<size_t>( 2 * count ) );
+    std::vector<double> values( static_cast<size_t>( count ) );
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( depth, d ), 0, count, MDAL_DataType::SCALAR_DOUBLE, depthValues.data() ) );
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( velocity, d ), 0, count, MDAL_DataType::VECTOR_2D_DOUBLE, velocityValues.data() ) );
+    ASSERT_EQ( count, MDAL_D_data( ds, 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+    for ( size_t i = 0; i < static_cast<size_t>( count ); ++i )
+    {
+      const double expected = depthValues[i] * ( std::sqrt( velocityValues[2 * i] * velocityValues[2 * i] + velocityValues[2 * i + 1] * velocityValues[2 * i + 1] ) + 0.5 )
+                              - bedValues[i] / 100;
+      EXPECT_DOUBLE_EQ( expected, values[i] );
+    }
+
+    // partial range
+    ASSERT_EQ( 5, MDAL_D_data( ds, 100, 5, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+    EXPECT_DOUBLE_EQ( depthValues[100] * ( std::hypot( velocityValues[200], velocityValues[201] ) + 0.5 ) - bedValues[100] / 100, values[0] );
+
+    // active where both Depth and Vector Velocity are active
+    ASSERT_TRUE( MDAL_D_hasActiveFlagCapability( ds ) );
+    std::vector<int> active( static_cast<size_t>( facesCount ) );
+    ASSERT_EQ( facesCount, MDAL_D_data( ds, 0, facesCount, MDAL_DataType::ACTIVE_INTEGER, active.data() ) );
+    for ( int f = 0; f < facesCount; f += 97 )
+      EXPECT_EQ( getActive( MDAL_G_dataset( depth, d ), f ) && getActive( MDAL_G_dataset( velocity, d ), f ), active[static_cast<size_t>( f )] );
+  }
+
+  EXPECT_EQ( nullptr, MDAL_M_addDerivedGroup( m, "invalid", "Depth *" ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  EXPECT_EQ( nullptr, MDAL_M_addDerivedGroup( m, "unknown", "Depth + Unknown" ) );
+  EXPECT_EQ( nullptr, MDAL_M_addDerivedGroup( m, "constant", "1 + 2" ) );
+  EXPECT_EQ( 10, MDAL_M_datasetGroupCount( m ) );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, DerivedGroupInCommaDecimalLocale )
+{
+  // applications may set the C locale of the process to a locale with decimal comma
+  const std::string previousLocale = std::setlocale( LC_NUMERIC, nullptr );
+  bool isCommaLocale = false;
+  for ( const char *name : { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR", "German_Germany.1252" } )
+  {
+    if ( std::setlocale( LC_NUMERIC, name ) && std::string( std::localeconv()->decimal_point ) == "," )
+    {
+      isCommaLocale = true;
+      break;
+    }
+  }
+  if ( !isCommaLocale )
+  {
+    std::setlocale( LC_NUMERIC, previousLocale.c_str() );
+    GTEST_SKIP() << "no locale with decimal comma available";
+  }
+
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  DatasetGroupH g = MDAL_M_addDerivedGroup( m, "half depth", "Depth * 0.5 + 1.25e1" );
+  std::setlocale( LC_NUMERIC, previousLocale.c_str() );
+  ASSERT_NE( g, nullptr );
+
+  DatasetGroupH depth = MDAL_M_datasetGroup( m, 4 );
+  const int count = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+  std::vector<double> depthValues( static_cast<size_t>( count ) );
+  std::vector<double> values( static_cast<size_t>( count ) );
+  ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( depth, 10 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, depthValues.data() ) );
+  ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, 10 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  for ( size_t i = 0; i < static_cast<size_t>( count ); ++i )
+    EXPECT_DOUBLE_EQ( depthValues[i] * 0.5 + 12.5, values[i] );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, QuantilesAndHistograms )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // Depth and Vector Velocity
+  for ( int g : { 4, 5 } )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, g );
+    const bool isScalar = MDAL_G_hasScalarData( group );
+    std::vector<double> allValues;
+    double groupInRange = 0;
+    for ( int d = 0; d < MDAL_G_datasetCount( group ); ++d )
+    {
+      DatasetH ds = MDAL_G_dataset( group, d );
+      const int count = MDAL_D_valueCount( ds );
+      std::vector<double> data( isScalar ? count : 2 * count );
+      ASSERT_EQ( count, MDAL_D_data( ds, 0, count, isScalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE, data.data() ) );
+
+      std::vector<double> values;
+      for ( int i = 0; i < count; ++i )
+      {
+        const double value = isScalar ? data[i] : std::sqrt( data[2 * i] * data[2 * i] + data[2 * i + 1] * data[2 * i + 1] );
+        if ( !std::isnan( value ) )
+          values.push_back( value );
+      }
+      std::sort( values.begin(), values.end() );
+      allValues.insert( allValues.end(), values.begin(), values.end() );
+
+      // the file holds minimum and maximum of the magnitudes in single precision
+      double min, max;
+      MDAL_D_minimumMaximum( ds, &min, &max );
+      EXPECT_FLOAT_EQ( min, MDAL_D_quantile( ds, 0 ) );
+      EXPECT_FLOAT_EQ( max, MDAL_D_quantile( ds, 1 ) );
+
+      // rank of the quantile is within the error bound
+      for ( double fraction : { 0.02, 0.5, 0.98 } )
+      {
+        const double quantile = MDAL_D_quantile( ds, fraction );
+        const double rankLow = static_cast<double>( std::lower_bound( values.begin(), values.end(), quantile ) - values.begin() );
+        const double rankHigh = static_cast<double>( std::upper_bound( values.begin(), values.end(), quantile ) - values.begin() );
+        const double rank = fraction * static_cast<double>( values.size() );
+        EXPECT_LE( rankLow - 0.01 * values.size(), rank );
+        EXPECT_GE( rankHigh + 0.01 * values.size(), rank );
+      }
+
+      std::vector<double> counts( 8 );
+      ASSERT_TRUE( MDAL_D_histogram( ds, 0, 1, 8, counts.data() ) );
+      double inRange = 0;
+      for ( double c : counts )
+        inRange += c;
+      EXPECT_NEAR( static_cast<double>( std::upper_bound( values.begin(), values.end(), 1.0 ) - std::lower_bound( values.begin(), values.end(), 0.0 ) ),
+                   inRange, 0.01 * values.size() );
+      groupInRange += inRange;
+    }
+
+    std::sort( allValues.begin(), allValues.end() );
+    const double median = MDAL_G_quantile( group, 0.5 );
+    const double rank = static_cast<double>( std::lower_bound( allValues.begin(), allValues.end(), median ) - allValues.begin() );
+    const double rankHigh = static_cast<double>( std::upper_bound( allValues.begin(), allValues.end(), median ) - allValues.begin() );
+    EXPECT_LE( rank - 0.01 * allValues.size(), 0.5 * allValues.size() );
+    EXPECT_GE( rankHigh + 0.01 * allValues.size(), 0.5 * allValues.size() );
+
+    std::vector<double> counts( 8 );
+    ASSERT_TRUE( MDAL_G_histogram( group, 0, 1, 8, counts.data() ) );
+    double inRange = 0;
+    for ( double c : counts )
+      inRange += c;
+    EXPECT_NEAR( groupInRange, inRange, 0.01 * allValues.size() );
+  }
+
+  EXPECT_FALSE( MDAL_D_histogram( MDAL_G_dataset( MDAL_M_datasetGroup( m, 4 ), 0 ), 0, 1, 0, nullptr ) );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, ConcurrentReads )
+{
+  MDAL_SetOpenOption( "LAZY_STATISTICS", "YES" );
+
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  ASSERT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+
+  // sum of values and statistics of all datasets, statistics are calculated concurrently too
+  auto readAll = [m]( std::vector<double> *results, MDAL_Status * status )
+  {
+    for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+    {
+      DatasetGroupH g = MDAL_M_datasetGroup( m, i );
+      const bool scalar = MDAL_G_hasScalarData( g );
+      for ( int j = 0; j < MDAL_G_datasetCount( g ); ++j )
+      {
+        DatasetH ds = MDAL_G_dataset( g, j );
+        const int count = MDAL_D_valueCount( ds );
+        std::vector<double> values( scalar ? count : 2 * count );
+        MDAL_D_data( ds, 0, count, scalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE, values.data() );
+        double sum = 0;
+        for ( double value : values )
+          sum += std::isnan( value ) ? 0 : value;
+        double min, max;
+        MDAL_D_minimumMaximum( ds, &min, &max );
+        results->push_back( sum );
+        results->push_back( min );
+        results->push_back( max );
+      }
+    }
+    *status = MDAL_LastStatus();
+  };
+
+  const size_t threadCount = 4;
+  std::vector<std::vector<double>> results( threadCount );
+  std::vector<MDAL_Status> statuses( threadCount, MDAL_Status::Err_UnknownFormat );
+  std::vector<std::thread> threads;
+  for ( size_t t = 0; t < threadCount; ++t )
+    threads.emplace_back( readAll, &results[t], &statuses[t] );
+  for ( std::thread &t : threads )
+    t.join();
+
+  std::vector<double> expected;
+  MDAL_Status status;
+  readAll( &expected, &status );
+  EXPECT_EQ( MDAL_Status::None, status );
+  ASSERT_FALSE( expected.empty() );
+
+  for ( size_t t = 0; t < threadCount; ++t )
+  {
+    EXPECT_EQ( MDAL_Status::None, statuses[t] );
+    EXPECT_TRUE( compareVectors( expected, results[t] ) );
+  }
+
+  MDAL_CloseMesh( m );
+  MDAL_SetOpenOption( "LAZY_STATISTICS", nullptr );
+}
+
+TEST( MeshXmdfTest, FileHandlePool )
+{
+  std::string meshPath = test_file( "/2dm/regular_grid.2dm" );
+  std::string path = test_file( "/xmdf/regular_grid.xmdf" );
+  MDAL_SetFileHandlePoolSize( 4 );
+  EXPECT_EQ( 4, MDAL_FileHandlePoolSize() );
+
+  const long long opens = MDAL_FileHandleOpens();
+  MeshH m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( opens + 1, MDAL_FileHandleOpens() );
+  MDAL_CloseMesh( m );
+
+  // the idle file is not opened again
+  const long long reuses = MDAL_FileHandleReuses();
+  m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( opens + 1, MDAL_FileHandleOpens() );
+  EXPECT_LT( reuses, MDAL_FileHandleReuses() );
+  int valueCount = MDAL_G_datasetCount( MDAL_M_datasetGroup( m, 1 ) );
+  EXPECT_LT( 0, valueCount );
+  MDAL_CloseMesh( m );
+
+  // idle files are closed without the pool
+  const long long reopens = MDAL_FileHandleReopens();
+  MDAL_SetFileHandlePoolSize( 0 );
+  m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( opens + 2, MDAL_FileHandleOpens() );
+  EXPECT_EQ( reopens + 1, MDAL_FileHandleReopens() );
+  MDAL_CloseMesh( m );
+}
+
+TEST( MeshXmdfTest, FileHandleLimit )
+{
+  std::string meshPath = test_file( "/2dm/regular_grid.2dm" );
+  std::string path = test_file( "/xmdf/regular_grid.xmdf" );
+  std::string otherMeshPath = test_file( "/2dm/M01_5m_002.2dm" );
+  std::string otherPath = test_file( "/xmdf/custom_groups.xmdf" );
+  MDAL_SetFileHandleLimit( -1 );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+  MDAL_SetFileHandlePoolSize( 4 );
+  MDAL_SetFileHandleLimit( 1 );
+  EXPECT_EQ( 1, MDAL_FileHandleLimit() );
+
+  MeshH m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  MDAL_CloseMesh( m );
+
+  // the idle file is closed to open the other one at the limit
+  m = MDAL_LoadMesh( otherMeshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, otherPath.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  MDAL_CloseMesh( m );
+
+  const long long reopens = MDAL_FileHandleReopens();
+  m = MDAL_LoadMesh( meshPath.c_str() );
+  ASSERT_NE( m, nullptr );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  EXPECT_EQ( MDAL_Status::None, MDAL_LastStatus() );
+  EXPECT_EQ( reopens + 1, MDAL_FileHandleReopens() );
+  MDAL_CloseMesh( m );
+
+  MDAL_SetFileHandleLimit( 0 );
+  MDAL_SetFileHandlePoolSize( 0 );
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
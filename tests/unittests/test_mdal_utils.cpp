@@ -5,13 +5,36 @@
 #include "gtest/gtest.h"
 #include <limits>
 #include <cmath>
+#include <clocale>
+#include <string.h>
 #include <string>
 #include <vector>
 
 //mdal
 #include "mdal.h"
 #include "mdal_utils.hpp"
+#include "mdal_file_signature.hpp"
+#include "mdal_id_map.hpp"
+#include "mdal_options.hpp"
+#include "mdal_parallel.hpp"
+#include "mdal_pipeline.hpp"
+#include "mdal_prefetch.hpp"
+#include "mdal_quantile_sketch.hpp"
+#include "mdal_regular_grid_mesh.hpp"
+#include "mdal_remote.hpp"
+#include "mdal_block_cache.hpp"
+#include "mdal_compressed_values.hpp"
+#include "mdal_contours.hpp"
+#include "mdal_simd.hpp"
+#include "mdal_sparse_dataset.hpp"
+#include "mdal_spatial_index.hpp"
+#include "mdal_spill.hpp"
+#include "mdal_statistics_cache.hpp"
 #include "mdal_testutils.hpp"
+#include "mdal_volume_iterator.hpp"
+#include "mdal_averaging.hpp"
+#include "mdal_expression.hpp"
+#include "mdal_reorder.hpp"
 
 struct SplitTestData
 {
@@ -71,6 +94,1710 @@ TEST( MdalUtilsTest, SplitChar )
   }
 }
 
+TEST( MdalUtilsTest, ParseNumbersInPlace )
+{
+  std::vector<std::string> doubles =
+  {
+    "0", "-0.0", "1", "+2.5", "-1000.125", ".5", "1.", "123456789.123456",
+    "1e3", "1.5E-7", "-2.25e+10", "0.000000000000000000001", "12345678901234567890.5",
+    "1e308", "4.9e-324", "1,5", "abc", "12abc", ""
+  };
+  for ( const auto &test : doubles )
+  {
+    const double expected = MDAL::toDouble( test );
+    const double parsed = MDAL::toDouble( test.data(), test.data() + test.size() );
+    EXPECT_EQ( expected, parsed ) << test;
+  }
+
+  std::vector<std::pair<std::string, size_t>> sizes =
+  {
+    { "0", 0 }, { "1", 1 }, { "+17", 17 }, { "-5", 0 }, { "42abc", 42 }, { "abc", 0 }, { "", 0 }
+  };
+  for ( const auto &test : sizes )
+  {
+    EXPECT_EQ( test.second, MDAL::toSizeT( test.first.data(), test.first.data() + test.first.size() ) ) << test.first;
+  }
+
+  std::vector<std::string> ints = { "0", "1", "+17", "-5", "42abc", "-0", "abc", "", "2147483647", "-2147483648" };
+  for ( const auto &test : ints )
+  {
+    EXPECT_EQ( MDAL::toInt( test ), MDAL::toInt( test.data(), test.data() + test.size() ) ) << test;
+  }
+}
+
+TEST( MdalUtilsTest, SplitSpans )
+{
+  const std::string text = "ND 1  2.5\t-3 \r\n\n last";
+  const char *ptr = text.data();
+  const char *end = ptr + text.size();
+
+  MDAL::StringSpan tokens[3];
+  MDAL::StringSpan line = MDAL::nextLine( ptr, end );
+  ASSERT_EQ( 4, MDAL::split( line.begin, line.end, tokens, 3 ) );
+  EXPECT_EQ( "ND", std::string( tokens[0].begin, tokens[0].end ) );
+  EXPECT_EQ( "1", std::string( tokens[1].begin, tokens[1].end ) );
+  EXPECT_EQ( "2.5", std::string( tokens[2].begin, tokens[2].end ) );
+
+  line = MDAL::nextLine( ptr, end );
+  EXPECT_EQ( 0, MDAL::split( line.begin, line.end, tokens, 3 ) );
+
+  // last line without end of line
+  line = MDAL::nextLine( ptr, end );
+  EXPECT_EQ( end, ptr );
+  ASSERT_EQ( 1, MDAL::split( line.begin, line.end, tokens, 3 ) );
+  EXPECT_EQ( "last", std::string( tokens[0].begin, tokens[0].end ) );
+}
+
+TEST( MdalUtilsTest, MinMaxKernels )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  double min, max;
+
+  // odd count to test also the remainder of vectorized loop
+  std::vector<double> values = { 3, nan, -1, 8, nan, 2, 7, nan, 5 };
+  EXPECT_TRUE( MDAL::minMax( values.data(), values.size(), min, max ) );
+  EXPECT_DOUBLE_EQ( -1, min );
+  EXPECT_DOUBLE_EQ( 8, max );
+
+  EXPECT_TRUE( MDAL::minMax( values.data(), 1, min, max ) );
+  EXPECT_DOUBLE_EQ( 3, min );
+  EXPECT_DOUBLE_EQ( 3, max );
+
+  std::vector<double> nans( 7, nan );
+  EXPECT_FALSE( MDAL::minMax( nans.data(), nans.size(), min, max ) );
+  EXPECT_TRUE( std::isnan( min ) );
+  EXPECT_TRUE( std::isnan( max ) );
+
+  EXPECT_FALSE( MDAL::minMax( nullptr, 0, min, max ) );
+  EXPECT_TRUE( std::isnan( min ) );
+
+  // vector with any NaN component is skipped
+  std::vector<double> xy = { 3, 4, nan, 100, 1, 0, 0, nan, 6, 8 };
+  EXPECT_TRUE( MDAL::minMaxSquaredMagnitude( xy.data(), xy.size() / 2, min, max ) );
+  EXPECT_DOUBLE_EQ( 1, min );
+  EXPECT_DOUBLE_EQ( 100, max );
+
+  EXPECT_FALSE( MDAL::minMaxSquaredMagnitude( nans.data(), 3, min, max ) );
+  EXPECT_TRUE( std::isnan( max ) );
+}
+
+TEST( MdalUtilsTest, FunctionKernels )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // odd count to test also the remainder of vectorized loop
+  std::vector<double> a = { 5, 1, nan, 4, 10, 2, 3, 0.5, 7 };
+  std::vector<double> b = { 2, 1, 3, nan, 4, 3, 3, 0.5, 1 };
+  std::vector<double> result( a.size() );
+  MDAL::subtract( a.data(), b.data(), a.size(), result.data() );
+  EXPECT_DOUBLE_EQ( 3, result[0] );
+  EXPECT_TRUE( std::isnan( result[2] ) );
+  EXPECT_TRUE( std::isnan( result[3] ) );
+  EXPECT_DOUBLE_EQ( -1, result[5] );
+  EXPECT_DOUBLE_EQ( 6, result[8] );
+
+  // vector with any NaN component is NaN
+  std::vector<double> xy( 2 * a.size() );
+  MDAL::join( a.data(), b.data(), a.size(), xy.data() );
+  for ( size_t i = 0; i < a.size(); ++i )
+  {
+    if ( i == 2 || i == 3 )
+    {
+      EXPECT_TRUE( std::isnan( xy[2 * i] ) );
+      EXPECT_TRUE( std::isnan( xy[2 * i + 1] ) );
+    }
+    else
+    {
+      EXPECT_DOUBLE_EQ( a[i], xy[2 * i] );
+      EXPECT_DOUBLE_EQ( b[i], xy[2 * i + 1] );
+    }
+  }
+
+  // depth h - z is 0 for indices 1, 6 and 7
+  std::vector<double> qx = { 3, 1, 1, 1, 6, 1, 1, 1, 0 };
+  std::vector<double> qy = { 4, 1, 1, 1, 8, 1, 1, nan, 12 };
+  MDAL::flowVelocity( qx.data(), qy.data(), a.data(), b.data(), a.size(), result.data() );
+  EXPECT_DOUBLE_EQ( 5.0 / 3.0, result[0] );
+  EXPECT_TRUE( std::isnan( result[1] ) );
+  EXPECT_TRUE( std::isnan( result[2] ) );
+  EXPECT_TRUE( std::isnan( result[3] ) );
+  EXPECT_DOUBLE_EQ( 10.0 / 6.0, result[4] );
+  EXPECT_DOUBLE_EQ( std::sqrt( 2.0 ), result[5] );
+  EXPECT_TRUE( std::isnan( result[6] ) );
+  EXPECT_TRUE( std::isnan( result[7] ) );
+  EXPECT_DOUBLE_EQ( 2, result[8] );
+}
+
+TEST( MdalUtilsTest, TemporalKernels )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // odd count to test also the remainder of vectorized loop
+  std::vector<double> xy = { 3, 4, 0, 0, nan, 1, -6, 8, 1, 1, 5, 12, 0, -2, 2, nan, 8, 15 };
+  std::vector<double> magnitudes( xy.size() / 2 );
+  MDAL::magnitude( xy.data(), magnitudes.size(), magnitudes.data() );
+  const std::vector<double> expectedMagnitudes = { 5, 0, nan, 10, std::sqrt( 2.0 ), 13, 2, nan, 17 };
+  for ( size_t i = 0; i < magnitudes.size(); ++i )
+  {
+    if ( std::isnan( expectedMagnitudes[i] ) )
+      EXPECT_TRUE( std::isnan( magnitudes[i] ) );
+    else
+      EXPECT_DOUBLE_EQ( expectedMagnitudes[i], magnitudes[i] );
+  }
+
+  const size_t count = 9;
+  std::vector<std::vector<double>> steps =
+  {
+    { 1, nan, 3, 4, 5, 6, 7, 8, nan },
+    { 2, nan, 1, 4, 6, 5, 8, 7, nan },
+    { 0, 5, 3, 9, 6, 4, 9, 6, nan },
+  };
+  std::vector<double> minimum( count, inf );
+  std::vector<double> maximum( count, -inf );
+  std::vector<double> timeOfMaximum( count, nan );
+  std::vector<double> sum( count, 0 );
+  std::vector<double> validCount( count, 0 );
+  for ( size_t t = 0; t < steps.size(); ++t )
+  {
+    MDAL::accumulateTimeStep( steps[t].data(), count, 10.0 * t, minimum.data(), maximum.data(), timeOfMaximum.data(),
+                              sum.data(), validCount.data() );
+  }
+
+  EXPECT_DOUBLE_EQ( 2, maximum[0] );
+  EXPECT_DOUBLE_EQ( 10, timeOfMaximum[0] );
+  EXPECT_DOUBLE_EQ( 0, minimum[0] );
+  EXPECT_DOUBLE_EQ( 3, sum[0] );
+  EXPECT_DOUBLE_EQ( 3, validCount[0] );
+
+  // valid only in the last step
+  EXPECT_DOUBLE_EQ( 5, maximum[1] );
+  EXPECT_DOUBLE_EQ( 20, timeOfMaximum[1] );
+  EXPECT_DOUBLE_EQ( 1, validCount[1] );
+
+  // first time of the maximum is kept
+  EXPECT_DOUBLE_EQ( 3, maximum[2] );
+  EXPECT_DOUBLE_EQ( 0, timeOfMaximum[2] );
+  EXPECT_DOUBLE_EQ( 1, minimum[2] );
+  EXPECT_DOUBLE_EQ( 6, maximum[4] );
+  EXPECT_DOUBLE_EQ( 10, timeOfMaximum[4] );
+  EXPECT_DOUBLE_EQ( 9, maximum[6] );
+  EXPECT_DOUBLE_EQ( 20, timeOfMaximum[6] );
+  EXPECT_DOUBLE_EQ( 21, sum[7] );
+
+  // never valid
+  EXPECT_EQ( -inf, maximum[8] );
+  EXPECT_EQ( inf, minimum[8] );
+  EXPECT_TRUE( std::isnan( timeOfMaximum[8] ) );
+  EXPECT_DOUBLE_EQ( 0, validCount[8] );
+
+  // accumulators not needed are skipped
+  std::vector<double> minimumOnly( count, inf );
+  std::vector<double> minimumValidCount( count, 0 );
+  for ( size_t t = 0; t < steps.size(); ++t )
+    MDAL::accumulateTimeStep( steps[t].data(), count, 10.0 * t, minimumOnly.data(), nullptr, nullptr, nullptr, minimumValidCount.data() );
+  EXPECT_EQ( minimum, minimumOnly );
+  EXPECT_EQ( validCount, minimumValidCount );
+}
+
+TEST( MdalUtilsTest, Expression )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const std::vector<double> a = { 1, 2, -3, nan, 0.5 };
+  const std::vector<double> b = { 4, 2, 1, 1, 0 };
+
+  auto evaluate = [&]( const std::string &text, std::vector<double> &result )
+  {
+    MDAL::Expression expression( text );
+    if ( !expression.isValid() )
+      return false;
+    std::vector<const double *> inputs;
+    for ( const std::string &name : expression.groupNames() )
+      inputs.push_back( name == "b" ? b.data() : a.data() );
+    result.resize( a.size() );
+    expression.evaluate( inputs, a.size(), result.data() );
+    return true;
+  };
+
+  std::vector<double> result;
+  ASSERT_TRUE( evaluate( "2 + 3 * a ^ 2 - b / 2", result ) );
+  EXPECT_DOUBLE_EQ( 3, result[0] );
+  EXPECT_DOUBLE_EQ( 13, result[1] );
+  EXPECT_DOUBLE_EQ( 28.5, result[2] );
+  EXPECT_TRUE( std::isnan( result[3] ) );
+
+  // unary minus binds weaker than power, power is right associative
+  ASSERT_TRUE( evaluate( "-a ^ 2 + 2 ^ 3 ^ 0 * -(b)", result ) );
+  EXPECT_DOUBLE_EQ( -1 - 8, result[0] );
+  EXPECT_DOUBLE_EQ( -9 - 2, result[2] );
+
+  ASSERT_TRUE( evaluate( "if(a >= b, abs(a), sqrt(b)) + min(a, b) * (max(a, 0) != 0)", result ) );
+  EXPECT_DOUBLE_EQ( 2 + 1, result[0] );
+  EXPECT_DOUBLE_EQ( 2 + 2, result[1] );
+  EXPECT_DOUBLE_EQ( 1, result[2] );
+  EXPECT_TRUE( std::isnan( result[3] ) );
+  EXPECT_DOUBLE_EQ( 0.5, result[4] );
+
+  // comparisons with NaN are false
+  ASSERT_TRUE( evaluate( "(a < b) + (a == a) * 10 + (a != b) * 100 + (a > 1e9)", result ) );
+  EXPECT_DOUBLE_EQ( 111, result[0] );
+  EXPECT_DOUBLE_EQ( 10, result[1] );
+  EXPECT_DOUBLE_EQ( 0, result[3] );
+
+  // quoted names, each group is one input
+  MDAL::Expression named( "\"Water Level\" - Bed_1 + \"Water Level\"" );
+  ASSERT_TRUE( named.isValid() );
+  ASSERT_EQ( 2, named.groupNames().size() );
+  EXPECT_EQ( "Water Level", named.groupNames()[0] );
+  EXPECT_EQ( "Bed_1", named.groupNames()[1] );
+
+  // constant only expression has no input
+  ASSERT_TRUE( evaluate( "1.5e1", result ) );
+  EXPECT_DOUBLE_EQ( 15, result[4] );
+
+  const std::vector<std::string> invalid = { "", "a +", "(a", "a b", "foo(a)", "min(a)", "\"a", "a $ b" };
+  for ( const std::string &text : invalid )
+  {
+    MDAL::Expression expression( text );
+    EXPECT_FALSE( expression.isValid() ) << text;
+    EXPECT_FALSE( expression.error().empty() ) << text;
+  }
+}
+
+TEST( MdalUtilsTest, FloatToDoubleKernel )
+{
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> values = { 1.5f, -2.25f, nan, 0.1f, 1e30f, -0.f, 7 };
+  std::vector<double> result( values.size() );
+  MDAL::floatToDouble( values.data(), values.size(), result.data() );
+  for ( size_t i = 0; i < values.size(); ++i )
+  {
+    if ( std::isnan( values[i] ) )
+      EXPECT_TRUE( std::isnan( result[i] ) );
+    else
+      EXPECT_EQ( static_cast<double>( values[i] ), result[i] );
+  }
+}
+
+TEST( MdalUtilsTest, ByteSwapKernel )
+{
+  // sizes not divisible by the vector width to test the scalar tail too
+  std::vector<uint16_t> v16( 19 );
+  std::vector<uint32_t> v32( 19 );
+  std::vector<uint64_t> v64( 19 );
+  for ( size_t i = 0; i < 19; ++i )
+  {
+    v16[i] = static_cast<uint16_t>( 0x0102 + i );
+    v32[i] = static_cast<uint32_t>( 0x01020304 + i );
+    v64[i] = 0x0102030405060708ull + i;
+  }
+  MDAL::byteSwap( v16.data(), 2, v16.size() );
+  MDAL::byteSwap( v32.data(), 4, v32.size() );
+  MDAL::byteSwap( v64.data(), 8, v64.size() );
+  for ( size_t i = 0; i < 19; ++i )
+  {
+    const uint16_t e16 = static_cast<uint16_t>( 0x0102 + i );
+    const uint32_t e32 = static_cast<uint32_t>( 0x01020304 + i );
+    const uint64_t e64 = 0x0102030405060708ull + i;
+    EXPECT_EQ( static_cast<uint16_t>( ( e16 >> 8 ) | ( e16 << 8 ) ), v16[i] );
+    EXPECT_EQ( ( e32 >> 24 ) | ( ( e32 >> 8 ) & 0xFF00u ) | ( ( e32 << 8 ) & 0xFF0000u ) | ( e32 << 24 ), v32[i] );
+    uint64_t swapped = 0;
+    for ( int b = 0; b < 8; ++b )
+      swapped |= ( ( e64 >> ( 8 * b ) ) & 0xFF ) << ( 8 * ( 7 - b ) );
+    EXPECT_EQ( swapped, v64[i] );
+  }
+
+  // other sizes are reversed too
+  char bytes[6] = { 1, 2, 3, 4, 5, 6 };
+  MDAL::byteSwap( bytes, 3, 2 );
+  EXPECT_EQ( 3, bytes[0] );
+  EXPECT_EQ( 4, bytes[5] );
+}
+
+TEST( MdalUtilsTest, BitPackingKernels )
+{
+  // count not divisible by the vector width to test the scalar tail too
+  std::vector<int> flags( 29 );
+  for ( size_t i = 0; i < flags.size(); ++i )
+    flags[i] = ( i % 3 == 0 ) ? 0 : static_cast<int>( i );
+  std::vector<unsigned char> bits( 4, 0xAA );
+  MDAL::packBits( flags.data(), flags.size(), bits.data() );
+  EXPECT_EQ( 0xB6, bits[0] ); // faces 1, 2, 4, 5, 7
+  EXPECT_EQ( 0x16, bits[3] ); // faces 25, 26, 28, unused bits are zero
+
+  std::vector<int> unpacked( flags.size() );
+  MDAL::unpackBits( bits.data(), unpacked.size(), unpacked.data() );
+  for ( size_t i = 0; i < flags.size(); ++i )
+    EXPECT_EQ( flags[i] != 0 ? 1 : 0, unpacked[i] );
+
+  // ranges not starting on the byte boundary
+  MDAL::unpackBits( bits.data(), 3, 20, unpacked.data() );
+  for ( size_t i = 0; i < 20; ++i )
+    EXPECT_EQ( flags[i + 3] != 0 ? 1 : 0, unpacked[i] );
+
+  std::vector<unsigned char> copied( 2, 0xFF );
+  MDAL::copyBits( bits.data(), flags.size(), 5, 10, copied.data() );
+  for ( size_t i = 0; i < 10; ++i )
+    EXPECT_EQ( flags[i + 5] != 0 ? 1 : 0, ( copied[i / 8] >> ( i % 8 ) ) & 1 );
+  EXPECT_EQ( 0, copied[1] >> 2 ); // unused bits are zero
+}
+
+TEST( MdalUtilsTest, TriangleSpanKernel )
+{
+  // pixels 3 ... 12 of 15 are covered: e0 = 12.5 - i, e1 = i - 3, e2 = 1
+  const double edges[3] = { 12.5, -3, 1 };
+  const double steps[3] = { -1, 1, 0 };
+  std::vector<float> row( 15, -1.0f );
+  EXPECT_EQ( 10u, MDAL::triangleSpan( edges, steps, 10, 0.5, 2, row.size(), row.data() ) );
+  for ( size_t i = 0; i < row.size(); ++i )
+  {
+    if ( i < 3 || i > 12 )
+      EXPECT_EQ( -1.0f, row[i] );
+    else
+      EXPECT_EQ( static_cast<float>( 10 + ( ( static_cast<double>( i ) - 3 ) * 0.5 + 2 ) ), row[i] );
+  }
+
+  // constant value is kept exactly
+  std::fill( row.begin(), row.end(), -1.0f );
+  EXPECT_EQ( 10u, MDAL::triangleSpan( edges, steps, 0.1, 0, 0, row.size(), row.data() ) );
+  EXPECT_EQ( 0.1f, row[5] );
+}
+
+TEST( MdalUtilsTest, HilbertIndex )
+{
+  // 4 x 4 cells in the corner are the first 16 cells of the curve, each next to the previous one
+  std::vector<std::pair<uint32_t, uint32_t>> cells( 16 );
+  std::vector<bool> visited( 16, false );
+  for ( uint32_t x = 0; x < 4; ++x )
+  {
+    for ( uint32_t y = 0; y < 4; ++y )
+    {
+      const uint32_t d = MDAL::hilbertIndex( x, y );
+      ASSERT_LT( d, 16u );
+      EXPECT_FALSE( visited[d] );
+      visited[d] = true;
+      cells[d] = std::make_pair( x, y );
+    }
+  }
+  for ( size_t d = 1; d < cells.size(); ++d )
+  {
+    const int dx = std::abs( static_cast<int>( cells[d].first ) - static_cast<int>( cells[d - 1].first ) );
+    const int dy = std::abs( static_cast<int>( cells[d].second ) - static_cast<int>( cells[d - 1].second ) );
+    EXPECT_EQ( 1, dx + dy );
+  }
+
+  EXPECT_EQ( 0u, MDAL::hilbertIndex( 0, 0 ) );
+  EXPECT_EQ( 0xAAAAAAAAu, MDAL::hilbertIndex( 65535, 65535 ) ); // corner of the third quarter on every level
+  EXPECT_EQ( 0xFFFFFFFFu, MDAL::hilbertIndex( 65535, 0 ) ); // end of the curve
+}
+
+TEST( MdalUtilsTest, HilbertRTree )
+{
+  // boxes of various sizes, two of them invalid, the search must match the brute force
+  std::vector<MDAL::BBox> boxes;
+  for ( size_t i = 0; i < 1000; ++i )
+  {
+    const double x = static_cast<double>( ( i * 37 ) % 101 );
+    const double y = static_cast<double>( ( i * 53 ) % 97 );
+    const double size = static_cast<double>( i % 7 );
+    boxes.push_back( MDAL::BBox( x, x + size, y, y + size / 2 ) );
+  }
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  boxes[10] = MDAL::BBox( nan, nan, nan, nan );
+  boxes[20].minY = nan;
+  MDAL::HilbertRTree tree( boxes );
+
+  const std::vector<MDAL::BBox> extents =
+  {
+    MDAL::BBox( 10, 20, 10, 20 ),
+    MDAL::BBox( -100, 200, -100, 200 ),
+    MDAL::BBox( 50, 50, 30, 30 ),
+    MDAL::BBox( 200, 300, 0, 10 )
+  };
+  for ( const MDAL::BBox &extent : extents )
+  {
+    std::vector<size_t> expected;
+    for ( size_t i = 0; i < boxes.size(); ++i )
+    {
+      const MDAL::BBox &b = boxes[i];
+      if ( b.maxX >= extent.minX && b.minX <= extent.maxX && b.maxY >= extent.minY && b.minY <= extent.maxY )
+        expected.push_back( i );
+    }
+    EXPECT_EQ( expected, tree.search( extent ) );
+  }
+  EXPECT_EQ( 998u, tree.search( extents[1] ).size() );
+
+  EXPECT_TRUE( MDAL::HilbertRTree( std::vector<MDAL::BBox>() ).search( extents[1] ).empty() );
+}
+
+TEST( MdalUtilsTest, ParallelFor )
+{
+  std::vector<int> visited( 1000, 0 );
+  MDAL::parallelFor( visited.size(), [&visited]( size_t i ) { visited[i] += 1; } );
+  for ( int v : visited )
+    EXPECT_EQ( 1, v );
+
+  EXPECT_THROW(
+    MDAL::parallelFor( 100, []( size_t i ) { if ( i == 50 ) throw MDAL_Status::Err_InvalidData; } ),
+    MDAL_Status );
+}
+
+static MDAL::DatasetGroups _cacheTestGroups( MDAL::Mesh *mesh, const std::string &uri, size_t datasetCount )
+{
+  std::shared_ptr<MDAL::DatasetGroup> group = std::make_shared<MDAL::DatasetGroup>( "test", mesh, uri, "depth" );
+  group->setIsScalar( true );
+  group->setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  for ( size_t i = 0; i < datasetCount; ++i )
+  {
+    std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared<MDAL::MemoryDataset2D>( group.get() );
+    dataset->setTime( static_cast<double>( i ) );
+    for ( size_t j = 0; j < 3; ++j )
+      dataset->setScalarValue( j, static_cast<double>( i + j ) );
+    group->datasets.push_back( dataset );
+  }
+  return MDAL::DatasetGroups( { group } );
+}
+
+TEST( MdalUtilsTest, StatisticsCache )
+{
+  // any existing file can be used as the source of the groups
+  const std::string uri = test_file( "/2dm/quad_and_triangle.2dm" );
+  MDAL::MemoryMesh mesh( "test", 3, 1, 3, MDAL::BBox(), uri );
+
+  {
+    MDAL::StatisticsCache cache( uri );
+    EXPECT_FALSE( cache.isEnabled() );
+  }
+
+  MDAL::setOpenOption( MDAL::OPTION_STATISTICS_CACHE_DIR, tmp_file( "" ) );
+
+  MDAL::DatasetGroups groups = _cacheTestGroups( &mesh, uri, 2 );
+  MDAL::updateStatistics( groups[0] );
+  {
+    MDAL::StatisticsCache cache( uri );
+    EXPECT_TRUE( cache.isEnabled() );
+    cache.store( groups );
+  }
+
+  MDAL::StatisticsCache cache( uri );
+  ASSERT_TRUE( cache.hasEntry() );
+
+  MDAL::DatasetGroups loadedGroups = _cacheTestGroups( &mesh, uri, 2 );
+  EXPECT_TRUE( cache.apply( loadedGroups ) );
+  EXPECT_TRUE( loadedGroups[0]->hasStatistics() );
+  EXPECT_TRUE( loadedGroups[0]->datasets[1]->hasStatistics() );
+  EXPECT_DOUBLE_EQ( 3, loadedGroups[0]->statistics().maximum );
+  EXPECT_DOUBLE_EQ( 1, loadedGroups[0]->datasets[1]->statistics().minimum );
+
+  // different layout, nothing is applied
+  MDAL::DatasetGroups otherGroups = _cacheTestGroups( &mesh, uri, 3 );
+  EXPECT_FALSE( cache.apply( otherGroups ) );
+  EXPECT_FALSE( otherGroups[0]->hasStatistics() );
+  EXPECT_FALSE( otherGroups[0]->datasets[0]->hasStatistics() );
+  EXPECT_FALSE( loadedGroups[0]->statistics().sketch );
+
+  // stale entry is replaced by the statistics of the groups, calculated when the load skipped them
+  cache.sync( otherGroups );
+  EXPECT_TRUE( otherGroups[0]->datasets[2]->hasStatistics() );
+  MDAL::DatasetGroups syncedGroups = _cacheTestGroups( &mesh, uri, 3 );
+  EXPECT_TRUE( MDAL::StatisticsCache( uri ).apply( syncedGroups ) );
+  EXPECT_DOUBLE_EQ( 4, syncedGroups[0]->statistics().maximum );
+
+  // sketches are stored with the statistics
+  MDAL::setOpenOption( MDAL::OPTION_QUANTILE_SKETCH, "YES" );
+  MDAL::DatasetGroups sketchedGroups = _cacheTestGroups( &mesh, uri, 2 );
+  MDAL::updateStatistics( sketchedGroups[0] );
+  ASSERT_TRUE( sketchedGroups[0]->statistics().sketch );
+  MDAL::StatisticsCache( uri ).store( sketchedGroups );
+  MDAL::setOpenOption( MDAL::OPTION_QUANTILE_SKETCH, "" );
+
+  MDAL::DatasetGroups loadedSketchedGroups = _cacheTestGroups( &mesh, uri, 2 );
+  EXPECT_TRUE( MDAL::StatisticsCache( uri ).apply( loadedSketchedGroups ) );
+  const MDAL::Statistics groupStatistics = loadedSketchedGroups[0]->statistics();
+  ASSERT_TRUE( groupStatistics.sketch );
+  EXPECT_EQ( 6, groupStatistics.sketch->count() );
+  EXPECT_DOUBLE_EQ( 1, groupStatistics.sketch->quantile( 0.5 ) );
+  ASSERT_TRUE( loadedSketchedGroups[0]->datasets[1]->statistics().sketch );
+  EXPECT_DOUBLE_EQ( 3, loadedSketchedGroups[0]->datasets[1]->statistics().sketch->quantile( 1 ) );
+
+  MDAL::setOpenOption( MDAL::OPTION_STATISTICS_CACHE_DIR, "" );
+}
+
+TEST( MdalUtilsTest, QuantileSketch )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  MDAL::QuantileSketch empty;
+  EXPECT_EQ( 0, empty.count() );
+  EXPECT_TRUE( std::isnan( empty.quantile( 0.5 ) ) );
+
+  // small sketches are exact
+  MDAL::QuantileSketch small;
+  const std::vector<double> smallValues = { 5, nan, 1, 4, 2, 3 };
+  small.add( smallValues.data(), smallValues.size() );
+  EXPECT_EQ( 5, small.count() );
+  EXPECT_DOUBLE_EQ( 1, small.quantile( 0 ) );
+  EXPECT_DOUBLE_EQ( 3, small.quantile( 0.5 ) );
+  EXPECT_DOUBLE_EQ( 5, small.quantile( 1 ) );
+  std::vector<double> counts( 2 );
+  EXPECT_TRUE( small.histogram( 1, 5, 2, counts.data() ) );
+  EXPECT_DOUBLE_EQ( 2, counts[0] );
+  EXPECT_DOUBLE_EQ( 3, counts[1] );
+  EXPECT_FALSE( small.histogram( 5, 1, 2, counts.data() ) );
+  EXPECT_FALSE( small.histogram( 1, 5, 0, counts.data() ) );
+
+  // values in scattered order, in two halves merged together
+  const size_t count = 200000;
+  std::vector<double> values( count );
+  for ( size_t i = 0; i < count; ++i )
+    values[i] = static_cast<double>( ( i * 7919 ) % count );
+
+  MDAL::QuantileSketch sketch;
+  sketch.add( values.data(), count );
+  MDAL::QuantileSketch first, second;
+  first.add( values.data(), count / 2 );
+  second.add( values.data() + count / 2, count / 2 );
+  first.merge( second );
+
+  for ( const MDAL::QuantileSketch *s : { &sketch, &first } )
+  {
+    EXPECT_EQ( count, s->count() );
+    size_t items = 0;
+    for ( const std::vector<double> &level : s->levels() )
+      items += level.size();
+    EXPECT_LT( items, 4 * s->k() );
+    EXPECT_DOUBLE_EQ( 0, s->quantile( 0 ) );
+    EXPECT_DOUBLE_EQ( count - 1, s->quantile( 1 ) );
+    for ( double fraction : { 0.02, 0.25, 0.5, 0.75, 0.98 } )
+      EXPECT_NEAR( fraction * count, s->quantile( fraction ), 0.01 * count );
+
+    std::vector<double> bins( 10 );
+    EXPECT_TRUE( s->histogram( 0, count - 1, bins.size(), bins.data() ) );
+    double total = 0;
+    for ( double bin : bins )
+    {
+      EXPECT_NEAR( count / 10, bin, 0.01 * count );
+      total += bin;
+    }
+    EXPECT_DOUBLE_EQ( count, total );
+  }
+
+  // the same values give the same sketch
+  MDAL::QuantileSketch again;
+  again.add( values.data(), count );
+  EXPECT_EQ( sketch.levels(), again.levels() );
+}
+
+TEST( MdalUtilsTest, FileSignature )
+{
+  MDAL::FileSignature mesh2dm( test_file( "/2dm/quad_and_triangle.2dm" ) );
+  EXPECT_EQ( MDAL::FileSignature::Text, mesh2dm.format() );
+  EXPECT_TRUE( mesh2dm.startsWith( "MESH2D" ) );
+  EXPECT_EQ( "2dm", mesh2dm.extension() );
+
+  MDAL::FileSignature xmdf( test_file( "/xmdf/regular_grid.xmdf" ) );
+  EXPECT_EQ( MDAL::FileSignature::Hdf5, xmdf.format() );
+
+  MDAL::FileSignature netcdf( test_file( "/ugrid/D-Flow1.1/manzese_1d2d_small_map.nc" ) );
+  EXPECT_EQ( MDAL::FileSignature::NetCDF, netcdf.format() );
+
+  MDAL::FileSignature grib( test_file( "/grib/Madagascar.wave.7days.grb" ) );
+  EXPECT_EQ( MDAL::FileSignature::Grib, grib.format() );
+
+  MDAL::FileSignature selafin( test_file( "/slf/example.slf" ) );
+  EXPECT_EQ( MDAL::FileSignature::Unknown, selafin.format() );
+  EXPECT_TRUE( selafin.startsWith( std::string( "\0\0\0\x50", 4 ) ) );
+
+  MDAL::FileSignature missing( test_file( "/non/existent/file.2dm" ) );
+  EXPECT_EQ( MDAL::FileSignature::Unknown, missing.format() );
+  EXPECT_TRUE( missing.header().empty() );
+}
+
+TEST( MdalUtilsTest, FaceSpatialIndex )
+{
+  // 20 x 10 grid of unit squares, each split to 2 triangles
+  const size_t columns = 20;
+  const size_t rows = 10;
+  MDAL::MemoryMesh mesh( "test", ( columns + 1 ) * ( rows + 1 ), 2 * columns * rows, 3, MDAL::BBox(), "" );
+  MDAL::Vertices vertices;
+  for ( size_t row = 0; row <= rows; ++row )
+  {
+    for ( size_t column = 0; column <= columns; ++column )
+    {
+      MDAL::Vertex v;
+      v.x = static_cast<double>( column );
+      v.y = static_cast<double>( row );
+      vertices.push_back( v );
+    }
+  }
+  mesh.vertices = vertices;
+
+  MDAL::Faces faces;
+  for ( size_t row = 0; row < rows; ++row )
+  {
+    for ( size_t column = 0; column < columns; ++column )
+    {
+      const size_t v0 = row * ( columns + 1 ) + column;
+      faces.push_back( { v0, v0 + 1, v0 + columns + 2 } );
+      faces.push_back( { v0, v0 + columns + 2, v0 + columns + 1 } );
+    }
+  }
+  mesh.faces = faces;
+
+  const MDAL::FaceSpatialIndex &index = mesh.spatialIndex();
+  for ( size_t row = 0; row < rows; ++row )
+  {
+    for ( size_t column = 0; column < columns; ++column )
+    {
+      const size_t lowerFace = 2 * ( row * columns + column );
+      EXPECT_EQ( lowerFace, index.faceAt( column + 0.7, row + 0.2 ) );
+      EXPECT_EQ( lowerFace + 1, index.faceAt( column + 0.2, row + 0.7 ) );
+    }
+  }
+
+  EXPECT_EQ( MDAL::FaceSpatialIndex::NO_FACE, index.faceAt( -0.5, 5 ) );
+  EXPECT_EQ( MDAL::FaceSpatialIndex::NO_FACE, index.faceAt( 5, 10.5 ) );
+  EXPECT_EQ( &index, &mesh.spatialIndex() );
+}
+
+TEST( MdalUtilsTest, RegularGridMesh )
+{
+  // 4 x 3 raster of 10 x 5 pixels, north up
+  const double gt[6] = { 100, 10, 0, 200, 0, -5 };
+  MDAL::RegularGridMesh mesh( "test", 4, 3, gt, "" );
+  EXPECT_EQ( 12, mesh.verticesCount() );
+  EXPECT_EQ( 6, mesh.facesCount() );
+  EXPECT_DOUBLE_EQ( 105, mesh.extent().minX );
+  EXPECT_DOUBLE_EQ( 135, mesh.extent().maxX );
+  EXPECT_DOUBLE_EQ( 187.5, mesh.extent().minY );
+  EXPECT_DOUBLE_EQ( 197.5, mesh.extent().maxY );
+
+  // vertices are read in batches crossing the rows
+  std::unique_ptr<MDAL::MeshVertexIterator> vertexIt = mesh.readVertices();
+  std::vector<double> coordinates( 3 * 12 );
+  EXPECT_EQ( 5, vertexIt->next( 5, coordinates.data() ) );
+  EXPECT_EQ( 7, vertexIt->next( 10, coordinates.data() + 15 ) );
+  EXPECT_EQ( 0, vertexIt->next( 10, coordinates.data() ) );
+  for ( size_t i = 0; i < 12; ++i )
+  {
+    EXPECT_DOUBLE_EQ( 105 + 10 * static_cast<double>( i % 4 ), coordinates[3 * i] );
+    EXPECT_DOUBLE_EQ( 197.5 - 5 * static_cast<double>( i / 4 ), coordinates[3 * i + 1] );
+    EXPECT_DOUBLE_EQ( 0, coordinates[3 * i + 2] );
+  }
+
+  std::vector<double> x( 3 );
+  EXPECT_EQ( 2, mesh.vertexCoordinates( 10, 3, x.data(), nullptr, nullptr ) );
+  EXPECT_DOUBLE_EQ( 125, x[0] );
+  EXPECT_DOUBLE_EQ( 135, x[1] );
+
+  // faces are limited by both buffers
+  std::unique_ptr<MDAL::MeshFaceIterator> faceIt = mesh.readFaces();
+  std::vector<int> offsets( 6 );
+  std::vector<int> indices( 24 );
+  EXPECT_EQ( 2, faceIt->next( 6, offsets.data(), 9, indices.data() ) );
+  EXPECT_EQ( 8, offsets[1] );
+  EXPECT_EQ( std::vector<int>( { 5, 4, 0, 1, 6, 5, 1, 2 } ), std::vector<int>( indices.begin(), indices.begin() + 8 ) );
+  EXPECT_EQ( 4, faceIt->next( 6, offsets.data(), 24, indices.data() ) );
+  EXPECT_EQ( 16, offsets[3] );
+  EXPECT_EQ( 11, indices[12] );
+  EXPECT_EQ( 0, faceIt->next( 6, offsets.data(), 24, indices.data() ) );
+
+  EXPECT_EQ( 0, mesh.faceAt( 106, 197 ) );
+  EXPECT_EQ( 5, mesh.faceAt( 134, 188 ) );
+  EXPECT_EQ( 5, mesh.faceAt( 135, 187.5 ) );
+  EXPECT_EQ( 4, mesh.faceAt( 120, 190 ) );
+  EXPECT_EQ( MDAL::RegularGridMesh::NO_FACE, mesh.faceAt( 104, 190 ) );
+  EXPECT_EQ( MDAL::RegularGridMesh::NO_FACE, mesh.faceAt( 120, 198 ) );
+
+  // values are x coordinates of the vertices, last vertex has no value
+  std::shared_ptr<MDAL::DatasetGroup> group = std::make_shared<MDAL::DatasetGroup>( "test", &mesh, "", "x" );
+  group->setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared<MDAL::MemoryDataset2D>( group.get(), true );
+  for ( size_t i = 0; i < 12; ++i )
+    dataset->setScalarValue( i, 105 + 10 * static_cast<double>( i % 4 ) );
+  dataset->setScalarValue( 11, std::numeric_limits<double>::quiet_NaN() );
+  dataset->activateFaces( &mesh );
+  group->datasets.push_back( dataset );
+  EXPECT_EQ( 1, dataset->active( 4 ) );
+  EXPECT_EQ( 0, dataset->active( 5 ) );
+  int activeFlags[3];
+  EXPECT_EQ( 3, dataset->activeData( 3, 5, activeFlags ) );
+  EXPECT_EQ( 0, activeFlags[2] );
+  unsigned char activeBits = 0xFF;
+  EXPECT_EQ( 3, dataset->activeDataBits( 3, 5, &activeBits ) );
+  EXPECT_EQ( 0x3, activeBits );
+
+  EXPECT_TRUE( MDAL::supportsPointSampling( mesh ) );
+  double value = 0;
+  EXPECT_EQ( 1, MDAL::sampleTimeSeries( mesh, *group, 112, 195, &value ) );
+  EXPECT_DOUBLE_EQ( 112, value );
+  EXPECT_EQ( 1, MDAL::sampleTimeSeries( mesh, *group, 130, 189, &value ) );
+  EXPECT_TRUE( std::isnan( value ) );
+  EXPECT_EQ( 1, MDAL::sampleTimeSeries( mesh, *group, 90, 189, &value ) );
+  EXPECT_TRUE( std::isnan( value ) );
+}
+
+//! Two columns of 2 and 3 volumes, counts the requests of the values
+class TestDataset3D: public MDAL::Dataset3D
+{
+  public:
+    TestDataset3D( MDAL::DatasetGroup *parent ): MDAL::Dataset3D( parent, 5, 3 ) {}
+
+    size_t verticalLevelCountData( size_t indexStart, size_t count, int *buffer ) override
+    {
+      const int levelCounts[2] = { 2, 3 };
+      return copy( levelCounts, 2, indexStart, count, buffer );
+    }
+
+    size_t verticalLevelData( size_t indexStart, size_t count, double *buffer ) override
+    {
+      ++requests;
+      const double levels[7] = { 0, -1, -2, 0, -2, -4, -6 };
+      return copy( levels, 7, indexStart, count, buffer );
+    }
+
+    size_t faceToVolumeData( size_t indexStart, size_t count, int *buffer ) override
+    {
+      const int faceToVolume[2] = { 0, 2 };
+      return copy( faceToVolume, 2, indexStart, count, buffer );
+    }
+
+    size_t scalarVolumesData( size_t indexStart, size_t count, double *buffer ) override
+    {
+      ++requests;
+      const double values[5] = { 1, 2, 3, 4, 5 };
+      return copy( values, 5, indexStart, count, buffer );
+    }
+
+    size_t vectorVolumesData( size_t, size_t, double * ) override { return 0; }
+
+    int requests = 0;
+
+  private:
+    template<typename T>
+    static size_t copy( const T *data, size_t size, size_t indexStart, size_t count, T *buffer )
+    {
+      if ( indexStart >= size )
+        return 0;
+      const size_t copyValues = std::min( size - indexStart, count );
+      std::copy( data + indexStart, data + indexStart + copyValues, buffer );
+      return copyValues;
+    }
+};
+
+TEST( MdalUtilsTest, Contours )
+{
+  // 300 x 300 unit squares, enough faces for several tiles, values increase to the east
+  const size_t size = 301;
+  const double gt[6] = { 0, 1, 0, 0, 0, 1 };
+  MDAL::RegularGridMesh mesh( "test", size, size, gt, "" );
+  MDAL::DatasetGroup group( "test", &mesh, "", "x" );
+  group.setIsScalar( true );
+  group.setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  std::shared_ptr<MDAL::MemoryDataset2D> dataset = std::make_shared<MDAL::MemoryDataset2D>( &group );
+  std::vector<double> x( mesh.verticesCount() );
+  std::vector<double> y( mesh.verticesCount() );
+  mesh.vertexCoordinates( 0, mesh.verticesCount(), x.data(), y.data(), nullptr );
+  dataset->setValues( x.data() );
+
+  // lines of the tiles are joined to one line per level, from the south to the north
+  const std::vector<double> levels = { 10.25, 100.75, 200.25 };
+  MDAL::ContourIterator lines( *dataset, levels, MDAL::ContourIterator::Lines );
+  ASSERT_EQ( 3, lines.partsCount() );
+  std::vector<int> levelIndices( 3 );
+  std::vector<int> offsets( 3 );
+  std::vector<double> coordinates( 2 * 3 * lines.maximumPointCount() );
+  EXPECT_EQ( 3, lines.next( 3, levelIndices.data(), offsets.data(), coordinates.size(), coordinates.data() ) );
+  EXPECT_EQ( 0, lines.next( 3, levelIndices.data(), offsets.data(), coordinates.size(), coordinates.data() ) );
+  std::vector<int> found( 3, 0 );
+  for ( size_t part = 0; part < 3; ++part )
+  {
+    const size_t first = part == 0 ? 0 : static_cast<size_t>( offsets[part - 1] );
+    const size_t last = static_cast<size_t>( offsets[part] ) - 1;
+    const double level = levels[static_cast<size_t>( levelIndices[part] )];
+    ++found[static_cast<size_t>( levelIndices[part] )];
+    for ( size_t i = first; i <= last; ++i )
+      EXPECT_NEAR( level, coordinates[2 * i], 1e-9 );
+    EXPECT_DOUBLE_EQ( y.front(), coordinates[2 * first + 1] );
+    EXPECT_DOUBLE_EQ( y.back(), coordinates[2 * last + 1] );
+  }
+  EXPECT_EQ( std::vector<int>( { 1, 1, 1 } ), found );
+
+  // parts do not fit to small buffers
+  MDAL::ContourIterator again( *dataset, levels, MDAL::ContourIterator::Lines );
+  EXPECT_EQ( 0, again.next( 3, levelIndices.data(), offsets.data(), 4, coordinates.data() ) );
+
+  // bands cover the mesh without overlaps
+  MDAL::ContourIterator bands( *dataset, { 0, 100.75, 1000 }, MDAL::ContourIterator::Bands );
+  levelIndices.resize( bands.partsCount() );
+  offsets.resize( bands.partsCount() );
+  coordinates.resize( 2 * bands.partsCount() * bands.maximumPointCount() );
+  ASSERT_EQ( bands.partsCount(), bands.next( bands.partsCount(), levelIndices.data(), offsets.data(), coordinates.size(), coordinates.data() ) );
+  std::vector<double> areas( 2, 0 );
+  for ( size_t part = 0; part < bands.partsCount(); ++part )
+  {
+    const size_t first = part == 0 ? 0 : static_cast<size_t>( offsets[part - 1] );
+    const size_t last = static_cast<size_t>( offsets[part] ) - 1;
+    EXPECT_DOUBLE_EQ( coordinates[2 * first], coordinates[2 * last] );
+    double area = 0;
+    for ( size_t i = first; i < last; ++i )
+      area += coordinates[2 * i] * coordinates[2 * i + 3] - coordinates[2 * i + 2] * coordinates[2 * i + 1];
+    EXPECT_GT( area, 0 );
+    areas[static_cast<size_t>( levelIndices[part] )] += area / 2;
+  }
+  EXPECT_NEAR( 300 * ( 100.75 - x.front() ), areas[0], 1e-6 );
+  EXPECT_NEAR( 300 * ( x.back() - 100.75 ), areas[1], 1e-6 );
+}
+
+TEST( MdalUtilsTest, FaceIterator64 )
+{
+  // vertex indices beyond int are returned only by next64
+  const size_t large = 3000000000;
+  MDAL::MemoryMesh mesh( "test", large + 2, 2, 4, MDAL::BBox(), "" );
+  mesh.faces = MDAL::Faces( { { 0, 1, 2 }, { 5, large, large + 1, 2 } } );
+  std::unique_ptr<MDAL::MeshFaceIterator> faceIt = mesh.readFaces();
+  std::vector<int64_t> offsets( 2 );
+  std::vector<int64_t> indices( 8 );
+  EXPECT_EQ( 1, faceIt->next64( 2, offsets.data(), 4, indices.data() ) );
+  EXPECT_EQ( 3, offsets[0] );
+  EXPECT_EQ( 1, faceIt->next64( 2, offsets.data(), 8, indices.data() ) );
+  EXPECT_EQ( 4, offsets[0] );
+  EXPECT_EQ( std::vector<int64_t>( { 5, 3000000000, 3000000001, 2 } ), std::vector<int64_t>( indices.begin(), indices.begin() + 4 ) );
+  EXPECT_EQ( 0, faceIt->next64( 2, offsets.data(), 8, indices.data() ) );
+
+  // the same faces as next() for the regular grid
+  const double gt[6] = { 100, 10, 0, 200, 0, -5 };
+  MDAL::RegularGridMesh grid( "test", 4, 3, gt, "" );
+  std::unique_ptr<MDAL::MeshFaceIterator> gridIt = grid.readFaces();
+  std::vector<int64_t> gridOffsets( 6 );
+  std::vector<int64_t> gridIndices( 24 );
+  EXPECT_EQ( 6, gridIt->next64( 6, gridOffsets.data(), 24, gridIndices.data() ) );
+  EXPECT_EQ( 24, gridOffsets[5] );
+  EXPECT_EQ( std::vector<int64_t>( { 5, 4, 0, 1 } ), std::vector<int64_t>( gridIndices.begin(), gridIndices.begin() + 4 ) );
+  EXPECT_EQ( std::vector<int64_t>( { 11, 10, 6, 7 } ), std::vector<int64_t>( gridIndices.begin() + 20, gridIndices.end() ) );
+}
+
+TEST( MdalUtilsTest, PipelinedIterators )
+{
+  // triangles and quads, read ahead in chunks not aligned with the reads
+  MDAL::MemoryMesh mesh( "test", 20, 10, 4, MDAL::BBox(), "" );
+  MDAL::Vertices vertices( 20 );
+  for ( size_t i = 0; i < vertices.size(); ++i )
+    vertices[i].x = static_cast<double>( i );
+  mesh.vertices = vertices;
+  MDAL::Faces faces;
+  for ( size_t i = 0; i < 10; ++i )
+  {
+    if ( i % 2 )
+      faces.push_back( { i, i + 1, i + 2, i + 3 } );
+    else
+      faces.push_back( { i, i + 1, i + 2 } );
+  }
+  mesh.faces = faces;
+
+  MDAL::PipelinedVertexIterator vertexIt( mesh.readVertices(), 3, 1 );
+  std::vector<double> coordinates( 3 * 20 );
+  EXPECT_EQ( 7, vertexIt.next( 7, coordinates.data() ) );
+  EXPECT_EQ( 13, vertexIt.next( 20, coordinates.data() + 21 ) );
+  EXPECT_EQ( 0, vertexIt.next( 20, coordinates.data() ) );
+  for ( size_t i = 0; i < 20; ++i )
+    EXPECT_DOUBLE_EQ( static_cast<double>( i ), coordinates[3 * i] );
+
+  // faces are returned whole, the offsets relative to the returned indices
+  MDAL::PipelinedFaceIterator faceIt( mesh.readFaces(), 3, 4, 1 );
+  std::vector<int> offsets( 10 );
+  std::vector<int> indices( 40 );
+  EXPECT_EQ( 2, faceIt.next( 10, offsets.data(), 8, indices.data() ) );
+  EXPECT_EQ( std::vector<int>( { 3, 7 } ), std::vector<int>( offsets.begin(), offsets.begin() + 2 ) );
+  EXPECT_EQ( std::vector<int>( { 0, 1, 2, 1, 2, 3, 4 } ), std::vector<int>( indices.begin(), indices.begin() + 7 ) );
+  EXPECT_EQ( 5, faceIt.next( 5, offsets.data(), 40, indices.data() ) );
+  EXPECT_EQ( 17, offsets[4] );
+  EXPECT_EQ( std::vector<int>( { 2, 3, 4 } ), std::vector<int>( indices.begin(), indices.begin() + 3 ) );
+  EXPECT_EQ( 3, faceIt.next( 10, offsets.data(), 40, indices.data() ) );
+  EXPECT_EQ( std::vector<int>( { 4, 7, 11 } ), std::vector<int>( offsets.begin(), offsets.begin() + 3 ) );
+  EXPECT_EQ( std::vector<int>( { 9, 10, 11, 12 } ), std::vector<int>( indices.begin() + 7, indices.begin() + 11 ) );
+  EXPECT_EQ( 0, faceIt.next( 10, offsets.data(), 40, indices.data() ) );
+}
+
+TEST( MdalUtilsTest, UniformFaces )
+{
+  // triangles are stored with fixed stride until a quad is added
+  MDAL::CompressedFaces faces;
+  EXPECT_EQ( 0, faces.uniformVerticesCount() );
+  faces.addFace( { 0, 1, 2 } );
+  faces.addFace( { 2, 1, 3 } );
+  EXPECT_EQ( 3, faces.uniformVerticesCount() );
+  EXPECT_EQ( 6, faces.indicesCount() );
+  EXPECT_EQ( 3, faces.faceOffset( 1 ) );
+  EXPECT_EQ( MDAL::Face( { 2, 1, 3 } ), faces.face( 1 ) );
+
+  faces.addFace( { 1, 4, 5, 3 } );
+  EXPECT_EQ( 0, faces.uniformVerticesCount() );
+  EXPECT_EQ( 10, faces.indicesCount() );
+  EXPECT_EQ( 6, faces.faceOffset( 2 ) );
+  EXPECT_EQ( 4, faces.faceVerticesCount( 2 ) );
+  EXPECT_EQ( MDAL::Face( { 1, 4, 5, 3 } ), faces.face( 2 ) );
+
+  // appending faces of the same size keeps the storage uniform
+  MDAL::CompressedFaces quads;
+  quads.addFace( { 0, 1, 2, 3 } );
+  MDAL::CompressedFaces moreQuads;
+  moreQuads.addFace( { 4, 5, 6, 7 } );
+  quads.append( moreQuads );
+  EXPECT_EQ( 4, quads.uniformVerticesCount() );
+  EXPECT_EQ( MDAL::Face( { 4, 5, 6, 7 } ), quads.face( 1 ) );
+
+  quads.append( faces );
+  EXPECT_EQ( 0, quads.uniformVerticesCount() );
+  EXPECT_EQ( 5, quads.size() );
+  EXPECT_EQ( 11, quads.faceOffset( 3 ) );
+  EXPECT_EQ( MDAL::Face( { 1, 4, 5, 3 } ), quads.face( 4 ) );
+  EXPECT_EQ( 18, quads.indicesCount() );
+
+  // specialized and general kernels see the same faces
+  MDAL::MemoryMesh mesh( "test", 6, 2, 4, MDAL::BBox(), "" );
+  MDAL::Vertices vertices( 6 );
+  for ( size_t i = 0; i < vertices.size(); ++i )
+  {
+    vertices[i].x = static_cast<double>( i % 3 );
+    vertices[i].y = static_cast<double>( i / 3 );
+  }
+  mesh.vertices = vertices;
+  mesh.faces = MDAL::Faces( { { 0, 1, 4, 3 }, { 1, 2, 5, 4 } } );
+  EXPECT_EQ( 4, mesh.uniformFaceVerticesCount() );
+  std::vector<int> offsets( 2 );
+  std::vector<int> indices( 8 );
+  EXPECT_EQ( 1, mesh.readFaces()->next( 2, offsets.data(), 7, indices.data() ) );
+  EXPECT_EQ( 4, offsets[0] );
+  std::unique_ptr<MDAL::MeshFaceIterator> it = mesh.readFaces();
+  EXPECT_EQ( 2, it->next( 2, offsets.data(), 8, indices.data() ) );
+  EXPECT_EQ( std::vector<int>( { 4, 8 } ), offsets );
+  EXPECT_EQ( std::vector<int>( { 0, 1, 4, 3, 1, 2, 5, 4 } ), indices );
+  EXPECT_EQ( 1, mesh.spatialIndex().faceAt( 1.6, 0.3 ) );
+  EXPECT_EQ( MDAL::FaceSpatialIndex::NO_FACE, mesh.spatialIndex().faceAt( 2.5, 0.3 ) );
+
+  const double gt[6] = { 0, 1, 0, 0, 0, 1 };
+  MDAL::RegularGridMesh grid( "test", 3, 2, gt, "" );
+  EXPECT_EQ( 4, grid.uniformFaceVerticesCount() );
+}
+
+TEST( MdalUtilsTest, VolumeIterator )
+{
+  const double gt[6] = { 0, 1, 0, 0, 0, 1 };
+  MDAL::RegularGridMesh mesh( "test", 3, 2, gt, "" );
+  ASSERT_EQ( 2, mesh.facesCount() );
+  MDAL::DatasetGroup group( "test", &mesh, "", "Temperature" );
+  group.setDataLocation( MDAL_DataLocation::DataOnVolumes3D );
+  group.setIsScalar( true );
+  TestDataset3D dataset( &group );
+
+  // the second face does not fit to the levels buffer
+  std::vector<int> levelCounts( 2 );
+  std::vector<double> levels( 7 );
+  std::vector<double> values( 5 );
+  MDAL::DatasetVolumeIterator it( &dataset );
+  EXPECT_EQ( 1, it.next( 2, levelCounts.data(), 3, levels.data(), 5, values.data() ) );
+  EXPECT_EQ( 2, levelCounts[0] );
+  EXPECT_DOUBLE_EQ( -2, levels[2] );
+  EXPECT_DOUBLE_EQ( 2, values[1] );
+
+  EXPECT_EQ( 1, it.next( 2, levelCounts.data(), 7, levels.data(), 5, values.data() ) );
+  EXPECT_EQ( 3, levelCounts[0] );
+  EXPECT_DOUBLE_EQ( 0, levels[0] );
+  EXPECT_DOUBLE_EQ( -6, levels[3] );
+  EXPECT_DOUBLE_EQ( 3, values[0] );
+  EXPECT_DOUBLE_EQ( 5, values[2] );
+  EXPECT_EQ( 0, it.next( 2, levelCounts.data(), 7, levels.data(), 5, values.data() ) );
+
+  // levels and values of the batch are read once
+  EXPECT_EQ( 2, dataset.requests );
+}
+
+TEST( MdalUtilsTest, AveragedDataset )
+{
+  const double gt[6] = { 0, 1, 0, 0, 0, 1 };
+  MDAL::RegularGridMesh mesh( "test", 3, 2, gt, "" );
+  MDAL::DatasetGroup group( "test", &mesh, "", "Temperature" );
+  group.setDataLocation( MDAL_DataLocation::DataOnVolumes3D );
+  group.setIsScalar( true );
+  std::shared_ptr<TestDataset3D> dataset = std::make_shared<TestDataset3D>( &group );
+  group.datasets.push_back( dataset );
+
+  struct Expected
+  {
+    MDAL_AveragingMethod type;
+    double start;
+    double end;
+    double face0;
+    double face1;
+  };
+  const Expected expected[] =
+  {
+    { MDAL_AveragingMethod::SINGLE_LEVEL_FROM_TOP, 1, 0, 2, 4 },
+    { MDAL_AveragingMethod::SINGLE_LEVEL_FROM_BOTTOM, 0, 0, 2, 5 },
+    { MDAL_AveragingMethod::SIGMA, 0, 1, 1.5, 4 },
+    { MDAL_AveragingMethod::DEPTH_FROM_SURFACE, 0, 3, 1.5, 10.0 / 3 },
+    { MDAL_AveragingMethod::HEIGHT_FROM_BED, 1, 0, 2, 5 },
+    { MDAL_AveragingMethod::ELEVATION, -1.5, -1.5, 2, 3 },
+  };
+
+  for ( const Expected &e : expected )
+  {
+    MDAL::AveragingMethod method;
+    method.type = e.type;
+    method.startParameter = e.start;
+    method.endParameter = e.end;
+    MDAL::DatasetGroup *averaged = MDAL::addAveragedGroup( &group, method, "Averaged" );
+    ASSERT_TRUE( averaged );
+    EXPECT_EQ( MDAL_DataLocation::DataOnFaces2D, averaged->dataLocation() );
+    ASSERT_EQ( 1, averaged->datasets.size() );
+
+    // values are calculated once and read from memory then
+    std::vector<double> values( 2 );
+    dataset->requests = 0;
+    EXPECT_EQ( 2, averaged->datasets[0]->scalarData( 0, 2, values.data() ) );
+    EXPECT_EQ( 1, averaged->datasets[0]->scalarData( 1, 2, values.data() + 1 ) );
+    EXPECT_EQ( 2, dataset->requests );
+    EXPECT_DOUBLE_EQ( e.face0, values[0] );
+    EXPECT_DOUBLE_EQ( e.face1, values[1] );
+  }
+  EXPECT_EQ( 6, mesh.datasetGroups.size() );
+
+  // level out of the column
+  MDAL::AveragingMethod method;
+  method.type = MDAL_AveragingMethod::SINGLE_LEVEL_FROM_TOP;
+  method.startParameter = 2;
+  const double levels[3] = { 0, -1, -2 };
+  const double values[2] = { 1, 2 };
+  EXPECT_TRUE( std::isnan( MDAL::averageColumn( method, 2, levels, values ) ) );
+}
+
+TEST( MdalUtilsTest, AveragedDatasetCache )
+{
+  const double gt[6] = { 0, 1, 0, 0, 0, 1 };
+  MDAL::RegularGridMesh mesh( "test", 3, 2, gt, "" );
+  MDAL::DatasetGroup group( "test", &mesh, "", "Temperature" );
+  group.setDataLocation( MDAL_DataLocation::DataOnVolumes3D );
+  group.setIsScalar( true );
+  std::shared_ptr<TestDataset3D> dataset = std::make_shared<TestDataset3D>( &group );
+  const size_t datasetsCount = MDAL::AveragedDataset2D::DATASETS_CACHED + 2;
+  for ( size_t i = 0; i < datasetsCount; ++i )
+    group.datasets.push_back( dataset );
+
+  MDAL::DatasetGroup *averaged = MDAL::addAveragedGroup( &group, MDAL::AveragingMethod(), "Averaged" );
+  ASSERT_TRUE( averaged );
+  ASSERT_EQ( datasetsCount, averaged->datasets.size() );
+  std::vector<double> values( 2 );
+  for ( const std::shared_ptr<MDAL::Dataset> &ds : averaged->datasets )
+  {
+    EXPECT_EQ( 2, ds->scalarData( 0, 2, values.data() ) );
+    EXPECT_DOUBLE_EQ( 1.5, values[0] );
+  }
+
+  // only the values of the last datasets read are kept
+  dataset->requests = 0;
+  EXPECT_EQ( 2, averaged->datasets.back()->scalarData( 0, 2, values.data() ) );
+  EXPECT_EQ( 0, dataset->requests );
+  EXPECT_EQ( 2, averaged->datasets.front()->scalarData( 0, 2, values.data() ) );
+  EXPECT_EQ( 2, dataset->requests );
+  EXPECT_DOUBLE_EQ( 1.5, values[0] );
+  EXPECT_DOUBLE_EQ( 4, values[1] );
+}
+
+TEST( MdalUtilsTest, BlockCache )
+{
+  MDAL::BlockCache &cache = MDAL::BlockCache::instance();
+  // datasets are used only as keys
+  int a, b;
+  const MDAL::Dataset *datasetA = reinterpret_cast<const MDAL::Dataset *>( &a );
+  const MDAL::Dataset *datasetB = reinterpret_cast<const MDAL::Dataset *>( &b );
+
+  std::vector<double> values( 10 );
+  for ( size_t i = 0; i < values.size(); ++i )
+    values[i] = static_cast<double>( i );
+  std::vector<double> buffer( 10 );
+  size_t count = 0;
+
+  // disabled by default
+  cache.put( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 10, values.data(), 10 );
+  EXPECT_FALSE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 10, buffer.data(), &count ) );
+  EXPECT_EQ( 0, cache.size() );
+
+  // space for 3 blocks
+  cache.setMaximumSize( 3 * 10 * sizeof( double ) );
+  const long long hits = cache.hits();
+  const long long misses = cache.misses();
+  cache.put( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 10, values.data(), 10 );
+  cache.put( datasetA, MDAL_DataType::SCALAR_DOUBLE, 10, 10, values.data(), 10 );
+  cache.put( datasetB, MDAL_DataType::SCALAR_DOUBLE, 0, 10, values.data(), 10 );
+
+  EXPECT_TRUE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 10, buffer.data(), &count ) );
+  EXPECT_EQ( 10, count );
+  EXPECT_TRUE( compareVectors( values, buffer ) );
+  EXPECT_FALSE( cache.get( datasetA, MDAL_DataType::VECTOR_2D_DOUBLE, 0, 10, buffer.data(), &count ) );
+  EXPECT_FALSE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 5, buffer.data(), &count ) );
+
+  // least recently used block (A 10..20) is removed
+  cache.put( datasetB, MDAL_DataType::SCALAR_DOUBLE, 10, 10, values.data(), 10 );
+  EXPECT_EQ( 3 * 10 * sizeof( double ), cache.size() );
+  EXPECT_FALSE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 10, 10, buffer.data(), &count ) );
+  EXPECT_TRUE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 10, buffer.data(), &count ) );
+  EXPECT_TRUE( cache.get( datasetB, MDAL_DataType::SCALAR_DOUBLE, 10, 10, buffer.data(), &count ) );
+  EXPECT_EQ( hits + 3, cache.hits() );
+  EXPECT_EQ( misses + 3, cache.misses() );
+
+  // blocks over budget are not stored
+  std::vector<double> large( 40 );
+  cache.put( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 40, large.data(), 40 );
+  EXPECT_FALSE( cache.get( datasetA, MDAL_DataType::SCALAR_DOUBLE, 0, 40, large.data(), &count ) );
+
+  cache.remove( datasetB );
+  EXPECT_EQ( 10 * sizeof( double ), cache.size() );
+  EXPECT_FALSE( cache.get( datasetB, MDAL_DataType::SCALAR_DOUBLE, 0, 10, buffer.data(), &count ) );
+
+  cache.setMaximumSize( 0 );
+  EXPECT_EQ( 0, cache.size() );
+}
+
+TEST( MdalUtilsTest, Prefetch )
+{
+  std::string path = test_file( "/2dm/regular_grid.2dm" );
+  MeshH m = MDAL_LoadMesh( path.c_str() );
+  ASSERT_NE( m, nullptr );
+  path = test_file( "/binary_dat/regular_grid_scalar.dat" );
+  MDAL_M_LoadDatasets( m, path.c_str() );
+  DatasetGroupH g = MDAL_M_datasetGroup( m, 1 );
+  ASSERT_NE( g, nullptr );
+  ASSERT_GT( MDAL_G_datasetCount( g ), 30 );
+  const int count = MDAL_D_valueCount( MDAL_G_dataset( g, 0 ) );
+  std::vector<double> values( static_cast<size_t>( count ) );
+
+  // nothing is prefetched without cache
+  MDAL_SetPrefetchCount( 3 );
+  EXPECT_EQ( 3, MDAL_PrefetchCount() );
+  ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, 10 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  MDAL::Prefetcher::instance().wait();
+  EXPECT_EQ( 0, MDAL::BlockCache::instance().size() );
+
+  // the following datasets are read after a dataset is read
+  MDAL_SetCacheSize( 10 * 1024 * 1024 );
+  long long hits = MDAL_CacheHits();
+  ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, 10 ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  MDAL::Prefetcher::instance().wait();
+  for ( int i = 11; i <= 13; ++i )
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, i ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( hits + 3, MDAL_CacheHits() );
+
+  // explicit request
+  MDAL_SetPrefetchCount( 0 );
+  MDAL_G_prefetch( g, 20, 5 );
+  MDAL::Prefetcher::instance().wait();
+  hits = MDAL_CacheHits();
+  for ( int i = 20; i < 25; ++i )
+    ASSERT_EQ( count, MDAL_D_data( MDAL_G_dataset( g, i ), 0, count, MDAL_DataType::SCALAR_DOUBLE, values.data() ) );
+  EXPECT_EQ( hits + 5, MDAL_CacheHits() );
+
+  MDAL_G_prefetch( g, 20, 100000 );
+  EXPECT_EQ( MDAL_Status::Err_InvalidData, MDAL_LastStatus() );
+
+  // pending blocks are cancelled when the mesh is closed
+  MDAL_G_prefetch( g, 0, MDAL_G_datasetCount( g ) );
+  MDAL_CloseMesh( m );
+  MDAL::Prefetcher::instance().wait();
+  EXPECT_EQ( 0, MDAL::BlockCache::instance().size() );
+
+  MDAL_SetCacheSize( 0 );
+}
+
+TEST( MdalUtilsTest, MemoryBudget )
+{
+  const size_t count = MDAL::MIN_SPILL_BLOCK_SIZE / sizeof( double ) * 2;
+  const size_t spilled = MDAL::spilledSize();
+  {
+    // no budget, everything on the heap
+    MDAL::SpillVector<double> values( count, 1.0 );
+    EXPECT_EQ( spilled, MDAL::spilledSize() );
+  }
+
+  MDAL::setOpenOption( MDAL::OPTION_MEMORY_BUDGET, "1" );
+  {
+    MDAL::SpillVector<double> small( 10, 1.0 );
+    EXPECT_EQ( spilled, MDAL::spilledSize() );
+
+    MDAL::VertexArrays vertices;
+    vertices.resize( count );
+    EXPECT_EQ( spilled + 3 * count * sizeof( double ), MDAL::spilledSize() );
+
+    MDAL::Vertex vertex;
+    vertex.x = 1;
+    vertex.y = 2;
+    vertex.z = 3;
+    vertices.setVertex( count - 1, vertex );
+    EXPECT_DOUBLE_EQ( 0, vertices.x()[0] );
+    EXPECT_DOUBLE_EQ( 3, vertices[count - 1].z );
+  }
+  EXPECT_EQ( spilled, MDAL::spilledSize() );
+  MDAL::setOpenOption( MDAL::OPTION_MEMORY_BUDGET, "" );
+}
+
+TEST( MdalUtilsTest, MemoryArena )
+{
+  MDAL::MemoryArena arena;
+  const MDAL::SpillAllocator<double> allocator( &arena );
+  const double *first = nullptr;
+  {
+    MDAL::SpillVector<double> values( 100, 1.0, allocator );
+    first = values.data();
+    EXPECT_EQ( 800, arena.usedSize() );
+    EXPECT_EQ( 64 * 1024, arena.reservedSize() );
+
+    // the arena moves with the storage
+    MDAL::SpillVector<double> other;
+    other.swap( values );
+    EXPECT_EQ( &arena, other.get_allocator().arena() );
+    EXPECT_EQ( nullptr, values.get_allocator().arena() );
+  }
+  EXPECT_EQ( 0, arena.usedSize() );
+
+  // freed array is reused by the next one of the same size
+  {
+    MDAL::SpillVector<double> values( 100, 2.0, allocator );
+    EXPECT_EQ( first, values.data() );
+    MDAL::SpillVector<unsigned char> flags( 13, 0, MDAL::SpillAllocator<unsigned char>( &arena ) );
+    EXPECT_EQ( 800 + 16, arena.usedSize() );
+    EXPECT_EQ( 64 * 1024, arena.reservedSize() );
+
+    // chunks grow, large arrays are allocated on their own
+    MDAL::SpillVector<double> medium( 10000, 3.0, allocator );
+    EXPECT_EQ( ( 64 + 128 ) * 1024, arena.reservedSize() );
+    MDAL::SpillVector<double> large( MDAL::MIN_SPILL_BLOCK_SIZE / sizeof( double ), 4.0, allocator );
+    EXPECT_EQ( ( 64 + 128 ) * 1024 + MDAL::MIN_SPILL_BLOCK_SIZE, arena.reservedSize() );
+    EXPECT_DOUBLE_EQ( 3.0, medium.back() );
+    EXPECT_DOUBLE_EQ( 4.0, large.back() );
+  }
+  EXPECT_EQ( 0, arena.usedSize() );
+  EXPECT_EQ( ( 64 + 128 ) * 1024, arena.reservedSize() );
+
+  // datasets of the mesh are allocated from its arena
+  MDAL::MemoryMesh mesh( "test", 3, 1, 3, MDAL::BBox(), "" );
+  MDAL::Vertices vertices( 3 );
+  mesh.vertices = vertices;
+  mesh.faces = MDAL::Faces( { { 0, 1, 2 } } );
+  const size_t meshUsage = mesh.memoryUsage();
+  EXPECT_EQ( 3 * 3 * sizeof( double ) + 3 * sizeof( uint32_t ) + sizeof( size_t ), meshUsage );
+
+  std::shared_ptr<MDAL::DatasetGroup> group = std::make_shared<MDAL::DatasetGroup>( "test", &mesh, "" );
+  group->setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  mesh.datasetGroups.push_back( group );
+  for ( int i = 0; i < 10; ++i )
+    group->datasets.push_back( std::make_shared<MDAL::MemoryDataset2D>( group.get(), true ) );
+  EXPECT_EQ( 10 * ( 32 + 16 ), mesh.memoryArena()->usedSize() );
+  EXPECT_EQ( meshUsage + 64 * 1024, mesh.memoryUsage() );
+
+  // the arena outlives the mesh while its datasets are used
+  std::shared_ptr<MDAL::Dataset> dataset = group->datasets[0];
+  group->datasets.clear();
+  EXPECT_EQ( 32 + 16, mesh.memoryArena()->usedSize() );
+  EXPECT_EQ( 3, mesh.memoryArena().use_count() ); // the mesh, the dataset and the returned pointer
+}
+
+TEST( MdalUtilsTest, StatisticsInParallel )
+{
+  const std::string uri = test_file( "/2dm/quad_and_triangle.2dm" );
+  MDAL::MemoryMesh mesh( "test", 3, 1, 3, MDAL::BBox(), uri );
+  MDAL::DatasetGroups groups = _cacheTestGroups( &mesh, uri, 50 );
+  const std::vector<std::shared_ptr<MDAL::Dataset>> &datasets = groups[0]->datasets;
+
+  {
+    MDAL::ScopedOpenOption lazy( MDAL::OPTION_LAZY_STATISTICS, "YES" );
+    MDAL::updateStatisticsInParallel( datasets );
+    EXPECT_FALSE( datasets[0]->hasStatistics() );
+  }
+
+  // with the library lock held as during the load
+  {
+    std::lock_guard<std::recursive_mutex> lock( MDAL::libraryMutex() );
+    MDAL::updateStatisticsInParallel( datasets );
+  }
+  for ( size_t i = 0; i < datasets.size(); ++i )
+  {
+    ASSERT_TRUE( datasets[i]->hasStatistics() );
+    EXPECT_DOUBLE_EQ( static_cast<double>( i ), datasets[i]->statistics().minimum );
+    EXPECT_DOUBLE_EQ( static_cast<double>( i + 2 ), datasets[i]->statistics().maximum );
+  }
+}
+
+TEST( MdalUtilsTest, SinglePrecision )
+{
+  const std::string uri = test_file( "/2dm/quad_and_triangle.2dm" );
+  MDAL::MemoryMesh mesh( "test", 3, 1, 3, MDAL::BBox(), uri );
+  MDAL::DatasetGroup group( "test", &mesh, uri, "velocity" );
+  group.setIsScalar( false );
+  group.setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+
+  MDAL::ScopedOpenOption singlePrecision( MDAL::OPTION_SINGLE_PRECISION, "YES" );
+  MDAL::MemoryDataset2D dataset( &group );
+  EXPECT_TRUE( dataset.isSinglePrecision() );
+  EXPECT_EQ( nullptr, dataset.values() );
+
+  const std::vector<double> values = { 0.1, 1, 2, 3, -4, 5 };
+  dataset.setValues( values.data() );
+  dataset.setValueY( 2, std::numeric_limits<double>::quiet_NaN() );
+
+  std::vector<double> buffer( 6 );
+  EXPECT_EQ( 3, dataset.data( MDAL_DataType::VECTOR_2D_DOUBLE, 0, 3, buffer.data() ) );
+  EXPECT_DOUBLE_EQ( static_cast<double>( 0.1f ), buffer[0] );
+  EXPECT_DOUBLE_EQ( -4, buffer[4] );
+  EXPECT_TRUE( std::isnan( buffer[5] ) );
+
+  std::vector<float> floatBuffer( 4 );
+  EXPECT_EQ( 2, dataset.data( MDAL_DataType::VECTOR_2D_FLOAT, 1, 2, floatBuffer.data() ) );
+  EXPECT_FLOAT_EQ( 2, floatBuffer[0] );
+  EXPECT_FLOAT_EQ( -4, floatBuffer[2] );
+
+  const MDAL::Statistics stats = MDAL::calculateStatistics( &dataset );
+  EXPECT_NEAR( std::sqrt( 0.01 + 1 ), stats.minimum, 1e-6 );
+  EXPECT_DOUBLE_EQ( std::sqrt( 13.0 ), stats.maximum );
+}
+
+TEST( MdalUtilsTest, CompressedValues )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // NaN region, smooth field of single precision values and constant region
+  const size_t count = 10000;
+  std::vector<double> field( count, nan );
+  for ( size_t i = 3000; i < 8000; ++i )
+    field[i] = static_cast<float>( 10 + std::sin( static_cast<double>( i ) / 500 ) );
+  for ( size_t i = 8000; i < count; ++i )
+    field[i] = 2.5;
+
+  MDAL::CompressedValues compressed( field.data(), count, 1 );
+  EXPECT_EQ( count, compressed.count() );
+  EXPECT_FALSE( compressed.isSinglePrecision() );
+  EXPECT_LT( compressed.compressedSize(), count * sizeof( double ) / 3 );
+  std::vector<double> buffer( count );
+  compressed.read( 0, count, buffer.data() );
+  EXPECT_EQ( 0, memcmp( field.data(), buffer.data(), count * sizeof( double ) ) );
+  // across the blocks and from the buffer of the thread
+  compressed.read( 4000, 200, buffer.data() );
+  compressed.read( 4000 + 200, 4000, buffer.data() + 200 );
+  EXPECT_EQ( 0, memcmp( field.data() + 4000, buffer.data(), 4200 * sizeof( double ) ) );
+  EXPECT_TRUE( std::isnan( compressed.value( 10 ) ) );
+  EXPECT_DOUBLE_EQ( field[5000], compressed.value( 5000 ) );
+
+  // random bits do not compress, the blocks are stored raw
+  std::vector<double> noise( count );
+  uint64_t state = 12345;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    noise[i] = static_cast<double>( state >> 11 ) / 9007199254740992.0;
+  }
+  MDAL::CompressedValues raw( noise.data(), count, 1 );
+  EXPECT_LT( raw.compressedSize(), count * sizeof( double ) + 100 );
+  raw.read( 0, count, buffer.data() );
+  EXPECT_EQ( 0, memcmp( noise.data(), buffer.data(), count * sizeof( double ) ) );
+
+  // vectors of floats
+  std::vector<float> vectors( 2 * count );
+  for ( size_t i = 0; i < count; ++i )
+  {
+    vectors[2 * i] = static_cast<float>( i % 100 );
+    vectors[2 * i + 1] = -1.5f;
+  }
+  MDAL::CompressedValues floats( vectors.data(), vectors.size(), 2 );
+  EXPECT_TRUE( floats.isSinglePrecision() );
+  std::vector<float> floatBuffer( vectors.size() );
+  floats.read( 0, vectors.size(), floatBuffer.data() );
+  EXPECT_EQ( vectors, floatBuffer );
+  EXPECT_DOUBLE_EQ( -1.5, floats.value( 2 * 9999 + 1 ) );
+
+  // memory dataset
+  const std::string uri = test_file( "/2dm/quad_and_triangle.2dm" );
+  MDAL::MemoryMesh mesh( "test", count, 1, 3, MDAL::BBox(), uri );
+  MDAL::DatasetGroup group( "test", &mesh, uri, "depth" );
+  group.setIsScalar( true );
+  group.setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  MDAL::MemoryDataset2D dataset( &group );
+  dataset.setValues( field.data() );
+  const MDAL::Statistics expected = MDAL::calculateStatistics( &dataset );
+  dataset.compress();
+  EXPECT_TRUE( dataset.isCompressed() );
+  EXPECT_EQ( nullptr, dataset.values() );
+  EXPECT_DOUBLE_EQ( field[7000], dataset.scalarValue( 7000 ) );
+  const MDAL::Statistics stats = MDAL::calculateStatistics( &dataset );
+  EXPECT_DOUBLE_EQ( expected.minimum, stats.minimum );
+  EXPECT_DOUBLE_EQ( expected.maximum, stats.maximum );
+
+  // concurrent reads use their own buffers
+  std::vector<int> matches( 64, 0 );
+  MDAL::parallelFor( matches.size(), [&]( size_t i )
+  {
+    std::vector<double> values( 500 );
+    const size_t start = ( i * 1237 ) % ( count - 500 );
+    dataset.scalarData( start, 500, values.data() );
+    matches[i] = memcmp( field.data() + start, values.data(), 500 * sizeof( double ) ) == 0;
+  } );
+  EXPECT_EQ( matches, std::vector<int>( 64, 1 ) );
+
+  // setting values decompresses them
+  dataset.setValues( noise.data() );
+  EXPECT_FALSE( dataset.isCompressed() );
+  EXPECT_DOUBLE_EQ( noise[1], dataset.scalarValue( 1 ) );
+}
+
+TEST( MdalUtilsTest, SparseDataset )
+{
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const std::string uri = test_file( "/2dm/quad_and_triangle.2dm" );
+  const size_t count = 10000;
+  MDAL::MemoryMesh mesh( "test", count, count, 3, MDAL::BBox(), uri );
+
+  // wet areas across the read blocks, the last index is wet
+  MDAL::DatasetGroup group( "test", &mesh, uri, "depth" );
+  group.setIsScalar( true );
+  group.setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  std::shared_ptr<MDAL::MemoryDataset2D> dense = std::make_shared<MDAL::MemoryDataset2D>( &group, true );
+  std::vector<double> values( count, nan );
+  std::vector<size_t> wet;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    if ( ( i >= 4090 && i < 4100 ) || ( i >= 7000 && i < 7300 ) || i == 8000 || i == count - 1 )
+    {
+      values[i] = static_cast<double>( i ) / 10;
+      wet.push_back( i );
+    }
+    dense->setActive( i, i % 3 != 0 );
+  }
+  dense->setValues( values.data() );
+  dense->setTime( MDAL::RelativeTimestamp( 2, MDAL::RelativeTimestamp::hours ) );
+  MDAL::updateStatistics( dense );
+
+  // too many valid values
+  EXPECT_EQ( dense, MDAL::sparseIfMostlyInvalid( dense, 0.01 ) );
+  std::shared_ptr<MDAL::Dataset> dataset = MDAL::sparseIfMostlyInvalid( dense, 0.05 );
+  MDAL::SparseDataset2D *sparse = dynamic_cast<MDAL::SparseDataset2D *>( dataset.get() );
+  ASSERT_TRUE( sparse );
+  EXPECT_EQ( wet.size(), sparse->storedCount() );
+  EXPECT_DOUBLE_EQ( 2, sparse->time( MDAL::RelativeTimestamp::hours ) );
+  EXPECT_DOUBLE_EQ( dense->statistics().maximum, sparse->statistics().maximum );
+
+  std::vector<double> buffer( count );
+  EXPECT_EQ( count, sparse->scalarData( 0, count, buffer.data() ) );
+  EXPECT_EQ( 0, memcmp( values.data(), buffer.data(), count * sizeof( double ) ) );
+  // starting and ending inside the runs
+  EXPECT_EQ( 3010, sparse->scalarData( 4095, 3010, buffer.data() ) );
+  EXPECT_EQ( 0, memcmp( values.data() + 4095, buffer.data(), 3010 * sizeof( double ) ) );
+  EXPECT_EQ( 2, sparse->scalarData( count - 2, 5, buffer.data() ) );
+  EXPECT_TRUE( std::isnan( buffer[0] ) );
+  EXPECT_DOUBLE_EQ( values[count - 1], buffer[1] );
+  std::vector<float> floatBuffer( 10 );
+  EXPECT_EQ( 10, sparse->scalarDataFloat( 7295, 10, floatBuffer.data() ) );
+  EXPECT_FLOAT_EQ( static_cast<float>( values[7299] ), floatBuffer[4] );
+  EXPECT_TRUE( std::isnan( floatBuffer[5] ) );
+
+  const std::vector<size_t> indices = { 0, 4090, 4099, 4100, 8000, count - 1 };
+  EXPECT_EQ( indices.size(), sparse->dataAtIndices( MDAL_DataType::SCALAR_DOUBLE, indices.data(), indices.size(), buffer.data() ) );
+  for ( size_t i = 0; i < indices.size(); ++i )
+    EXPECT_EQ( std::isnan( values[indices[i]] ), std::isnan( buffer[i] ) );
+  EXPECT_DOUBLE_EQ( values[4099], buffer[2] );
+
+  std::vector<int> active( count ), denseActive( count );
+  EXPECT_EQ( count - 1, sparse->activeData( 1, count, active.data() ) );
+  dense->activeData( 1, count, denseActive.data() );
+  EXPECT_EQ( denseActive, active );
+
+  // valid indices of the range, the same as of the dense dataset
+  std::vector<size_t> valid( count ), denseValid( count );
+  EXPECT_EQ( wet.size(), sparse->validIndices( 0, count, valid.data() ) );
+  valid.resize( wet.size() );
+  EXPECT_EQ( wet, valid );
+  EXPECT_EQ( 10, sparse->validIndices( 4095, 2910, valid.data() ) );
+  EXPECT_EQ( 10, dense->validIndices( 4095, 2910, denseValid.data() ) );
+  EXPECT_EQ( 7004, valid[9] );
+  EXPECT_EQ( 4095, valid[0] );
+  EXPECT_EQ( 4095, denseValid[0] );
+  EXPECT_EQ( 0, sparse->validIndices( 0, 4000, valid.data() ) );
+
+  // vectors with a single valid component are stored, but are not valid
+  MDAL::DatasetGroup vectorGroup( "test", &mesh, uri, "velocity" );
+  vectorGroup.setIsScalar( false );
+  vectorGroup.setDataLocation( MDAL_DataLocation::DataOnVertices2D );
+  std::shared_ptr<MDAL::MemoryDataset2D> denseVectors = std::make_shared<MDAL::MemoryDataset2D>( &vectorGroup );
+  for ( size_t i = 0; i < count; ++i )
+    denseVectors->setVectorValue( i, nan, nan );
+  denseVectors->setVectorValue( 10, 1, 2 );
+  denseVectors->setVectorValue( 11, 3, nan );
+  std::shared_ptr<MDAL::Dataset> sparseVectors = MDAL::sparseIfMostlyInvalid( denseVectors, 0.01 );
+  ASSERT_TRUE( dynamic_cast<MDAL::SparseDataset2D *>( sparseVectors.get() ) );
+  EXPECT_EQ( 2, static_cast<MDAL::SparseDataset2D *>( sparseVectors.get() )->storedCount() );
+  EXPECT_EQ( 3, sparseVectors->vectorData( 10, 3, buffer.data() ) );
+  EXPECT_DOUBLE_EQ( 2, buffer[1] );
+  EXPECT_DOUBLE_EQ( 3, buffer[2] );
+  EXPECT_TRUE( std::isnan( buffer[3] ) );
+  EXPECT_TRUE( std::isnan( buffer[4] ) );
+  EXPECT_EQ( 1, sparseVectors->validIndices( 0, count, valid.data() ) );
+  EXPECT_EQ( 10, valid[0] );
+  EXPECT_EQ( 1, denseVectors->validIndices( 0, count, denseValid.data() ) );
+}
+
+TEST( MdalUtilsTest, IdToIndexMap )
+{
+  MDAL::IdToIndexMap sparse;
+  EXPECT_TRUE( sparse.empty() );
+  EXPECT_EQ( MDAL::IdToIndexMap::NOT_FOUND, sparse.find( 5 ) );
+  for ( size_t i = 0; i < 1000; ++i )
+    EXPECT_TRUE( sparse.insert( i * 1000 + 7, i ) );
+  EXPECT_FALSE( sparse.insert( 7, 42 ) );
+  EXPECT_TRUE( sparse.insert( std::numeric_limits<size_t>::max(), 1000 ) );
+  sparse.optimize(); // too sparse, stays in the hash table
+  EXPECT_EQ( 1001, sparse.size() );
+  EXPECT_EQ( std::numeric_limits<size_t>::max(), sparse.maximumId() );
+  EXPECT_EQ( 0, sparse.find( 7 ) );
+  EXPECT_EQ( 999, sparse.find( 999007 ) );
+  EXPECT_EQ( 1000, sparse.find( std::numeric_limits<size_t>::max() ) );
+  EXPECT_EQ( MDAL::IdToIndexMap::NOT_FOUND, sparse.find( 8 ) );
+
+  MDAL::IdToIndexMap dense;
+  for ( size_t i = 0; i < 1000; ++i )
+    dense.insert( 2 * i + 10, i );
+  dense.optimize();
+  EXPECT_EQ( 1000, dense.size() );
+  EXPECT_EQ( 2008, dense.maximumId() );
+  EXPECT_EQ( 500, dense.find( 1010 ) );
+  EXPECT_EQ( MDAL::IdToIndexMap::NOT_FOUND, dense.find( 1011 ) );
+  EXPECT_EQ( MDAL::IdToIndexMap::NOT_FOUND, dense.find( 100000 ) );
+  EXPECT_FALSE( dense.insert( 10, 1 ) );
+
+  // insert out of the dense table switches back to the hash table
+  EXPECT_TRUE( dense.insert( 100000, 1000 ) );
+  EXPECT_EQ( 1001, dense.size() );
+  EXPECT_EQ( 1000, dense.find( 100000 ) );
+  EXPECT_EQ( 999, dense.find( 2008 ) );
+
+  // the only id is the one equal to the empty slot marker, there is no table
+  MDAL::IdToIndexMap maximum;
+  EXPECT_TRUE( maximum.insert( std::numeric_limits<size_t>::max(), 3 ) );
+  EXPECT_EQ( 1, maximum.size() );
+  EXPECT_EQ( 3, maximum.find( std::numeric_limits<size_t>::max() ) );
+  EXPECT_EQ( MDAL::IdToIndexMap::NOT_FOUND, maximum.find( 5 ) );
+}
+
+namespace
+{
+  //! Range source of the bytes in memory, counts the requests
+  class MemoryRangeSource: public MDAL::RangeSource
+  {
+    public:
+      explicit MemoryRangeSource( const std::vector<char> &data ): mData( data ) {}
+
+      int64_t size() override { return static_cast<int64_t>( mData.size() ); }
+
+      size_t read( uint64_t offset, size_t count, char *buffer ) override
+      {
+        ++requests;
+        if ( offset >= mData.size() )
+          return 0;
+        const size_t bytes = std::min( count, mData.size() - static_cast<size_t>( offset ) );
+        memcpy( buffer, mData.data() + offset, bytes );
+        return bytes;
+      }
+
+      int requests = 0;
+
+    private:
+      std::vector<char> mData;
+  };
+}
+
+TEST( MdalUtilsTest, RemoteFile )
+{
+  EXPECT_TRUE( MDAL::isRemoteUri( "https://example.com/results.nc" ) );
+  EXPECT_TRUE( MDAL::isRemoteUri( "S3://bucket/results.h5" ) );
+  EXPECT_FALSE( MDAL::isRemoteUri( "/data/results.nc" ) );
+  EXPECT_EQ( "http://example.com/a.2dm", MDAL::remoteUrl( "http://example.com/a.2dm" ) );
+  EXPECT_EQ( "https://bucket.s3.amazonaws.com/dir/a.nc", MDAL::remoteUrl( "s3://bucket/dir/a.nc" ) );
+  MDAL::setOpenOption( MDAL::OPTION_S3_ENDPOINT, "http://localhost:9000" );
+  EXPECT_EQ( "http://localhost:9000/bucket/dir/a.nc", MDAL::remoteUrl( "s3://bucket/dir/a.nc" ) );
+  MDAL::setOpenOption( MDAL::OPTION_S3_ENDPOINT, "" );
+  EXPECT_EQ( nullptr, MDAL::RemoteFile::open( test_file( "/2dm/quad_and_triangle.2dm" ) ) );
+
+  std::vector<char> data( 1000 );
+  for ( size_t i = 0; i < data.size(); ++i )
+    data[i] = static_cast<char>( i % 251 );
+  MemoryRangeSource *source = new MemoryRangeSource( data );
+  // blocks of 100 bytes, 3 blocks cached, 2 blocks read ahead
+  MDAL::RemoteFile file( std::unique_ptr<MDAL::RangeSource>( source ), 100, 300, 2 );
+  EXPECT_EQ( 1000, file.size() );
+
+  // across the block boundary, both blocks in one request
+  std::vector<char> buffer( 200 );
+  EXPECT_EQ( 100, file.read( 150, 100, buffer.data() ) );
+  EXPECT_TRUE( std::equal( buffer.begin(), buffer.begin() + 100, data.begin() + 150 ) );
+  EXPECT_EQ( 1, file.rangeRequests() );
+  EXPECT_EQ( 200, file.fetchedBytes() );
+
+  // cached
+  EXPECT_EQ( 50, file.read( 160, 50, buffer.data() ) );
+  EXPECT_TRUE( std::equal( buffer.begin(), buffer.begin() + 50, data.begin() + 160 ) );
+  EXPECT_EQ( 1, file.rangeRequests() );
+
+  // sequential read fetches the following blocks ahead
+  EXPECT_EQ( 10, file.read( 300, 10, buffer.data() ) );
+  EXPECT_EQ( 2, file.rangeRequests() );
+  EXPECT_EQ( 500, file.fetchedBytes() );
+  EXPECT_EQ( 200, file.read( 400, 200, buffer.data() ) );
+  EXPECT_TRUE( std::equal( buffer.begin(), buffer.end(), data.begin() + 400 ) );
+  EXPECT_EQ( 2, file.rangeRequests() );
+
+  // random read does not read ahead and is clamped to the end of the file
+  EXPECT_EQ( 50, file.read( 950, 100, buffer.data() ) );
+  EXPECT_TRUE( std::equal( buffer.begin(), buffer.begin() + 50, data.begin() + 950 ) );
+  EXPECT_EQ( 3, file.rangeRequests() );
+  EXPECT_EQ( 600, file.fetchedBytes() );
+  EXPECT_EQ( 0, file.read( 1000, 5, buffer.data() ) );
+
+  // least recently used blocks were removed
+  EXPECT_EQ( 10, file.read( 150, 10, buffer.data() ) );
+  EXPECT_EQ( 4, file.rangeRequests() );
+  EXPECT_EQ( 4, source->requests );
+}
+
+TEST( MdalUtilsTest, DoubleToChars )
+{
+  const std::vector<std::pair<double, std::string>> tests =
+  {
+    { 0, "0" },
+    { -2.5, "-2.5" },
+    { 300000.123, "300000.123" },
+    { 0.1, "0.1" },
+    { 1e20, "1e+20" },
+    { 1.0 / 3.0, "0.3333333333333333" },
+    { 123456789012, "123456789012" }
+  };
+  char buffer[MDAL::MAX_NUMBER_CHARS];
+  for ( const auto &test : tests )
+    EXPECT_EQ( test.second, std::string( buffer, MDAL::doubleToChars( test.first, buffer ) ) );
+
+  // all values read back exactly
+  double value = 0.000123;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    value = value * 1.37 + 0.001;
+    const std::string text( buffer, MDAL::doubleToChars( -value, buffer ) );
+    EXPECT_EQ( -value, strtod( text.c_str(), nullptr ) ) << text;
+  }
+
+  // the decimal separator does not follow the locale of the process, when the locale is installed
+  if ( setlocale( LC_NUMERIC, "de_DE.UTF-8" ) )
+  {
+    EXPECT_EQ( "0.3333333333333333", std::string( buffer, MDAL::doubleToChars( 1.0 / 3.0, buffer ) ) );
+    setlocale( LC_NUMERIC, "C" );
+  }
+
+  EXPECT_EQ( "1234567890", std::string( buffer, MDAL::sizeTToChars( 1234567890, buffer ) ) );
+}
+
 TEST( MdalUtilsTest, TimeParsing )
 {
   std::vector<std::pair<std::string, double>> tests =
@@ -0,0 +1,396 @@
+/*
+ MDAL - Mesh Data Abstraction Library (MIT License)
+ Copyright (C) 2020 Lutra Consulting Ltd.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "mdal_config.hpp"
+#include "mdal.h"
+
+/*
+ * Benchmark of the loads, mesh iteration and dataset reads on synthetic meshes
+ *
+ * A regular grid of quads of the requested size is written as 2DM, then saved
+ * by the other writable mesh drivers, and datasets with time steps are written
+ * by the writable dataset drivers. Each file is loaded back and read, and the
+ * timings are printed as JSON, so the results can be tracked over time.
+ */
+
+//! Number of vertices or faces read by one call of the iterators
+static const int ITERATOR_BLOCK = 65536;
+
+struct Options
+{
+  int64_t faces = 1000000;
+  int timesteps = 3;
+  std::string directory = ".";
+  std::string output;
+  std::vector<std::string> formats = { "2DM", "Ugrid", "ASCII_DAT", "BINARY_DAT", "FLO2D" };
+  bool keepFiles = false;
+};
+
+//! Result of one format, printed as JSON object
+struct Result
+{
+  std::string format;
+  std::vector<std::pair<std::string, double>> values;
+  std::string error;
+
+  void add( const std::string &name, double value ) { values.push_back( std::make_pair( name, value ) ); }
+};
+
+class Timer
+{
+  public:
+    Timer(): mStart( std::chrono::steady_clock::now() ) {}
+
+    double seconds() const
+    {
+      return std::chrono::duration<double>( std::chrono::steady_clock::now() - mStart ).count();
+    }
+
+  private:
+    std::chrono::steady_clock::time_point mStart;
+};
+
+//! Peak resident set size of the process in kB, 0 when not available
+static double peakRssKb()
+{
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    return 0;
+#ifdef __APPLE__
+  return static_cast<double>( usage.ru_maxrss ) / 1024.0; // bytes
+#else
+  return static_cast<double>( usage.ru_maxrss );
+#endif
+#endif
+}
+
+static std::vector<std::string> split( const std::string &str, char delimiter )
+{
+  std::vector<std::string> ret;
+  std::stringstream stream( str );
+  std::string item;
+  while ( std::getline( stream, item, delimiter ) )
+  {
+    if ( !item.empty() )
+      ret.push_back( item );
+  }
+  return ret;
+}
+
+//! Returns the first extension of the driver filters (e.g. "nc" for "*.nc;;*.cdf"), "bin" when there is none
+static std::string driverExtension( DriverH driver )
+{
+  const std::string filters = MDAL_DR_filters( driver );
+  const size_t start = filters.find( "*." );
+  if ( start == std::string::npos )
+    return "bin";
+  const size_t end = filters.find_first_of( "; ", start );
+  return filters.substr( start + 2, end == std::string::npos ? std::string::npos : end - start - 2 );
+}
+
+//! Writes regular grid of quads with at least faces count faces, returns false on error
+static bool writeGrid2dm( const std::string &path, int64_t faces )
+{
+  const int64_t columns = std::max<int64_t>( 1, static_cast<int64_t>( std::ceil( std::sqrt( static_cast<double>( faces ) ) ) ) );
+  const int64_t rows = std::max<int64_t>( 1, ( faces + columns - 1 ) / columns );
+  FILE *file = fopen( path.c_str(), "w" );
+  if ( !file )
+    return false;
+
+  fprintf( file, "MESH2D\n" );
+  int64_t vertexId = 1;
+  for ( int64_t r = 0; r <= rows; ++r )
+  {
+    for ( int64_t c = 0; c <= columns; ++c )
+      fprintf( file, "ND %lld %lld.0 %lld.0 %.3f\n", static_cast<long long>( vertexId++ ),
+               static_cast<long long>( c ), static_cast<long long>( r ), std::sin( 0.01 * static_cast<double>( r + c ) ) );
+  }
+  int64_t faceId = 1;
+  for ( int64_t r = 0; r < rows; ++r )
+  {
+    for ( int64_t c = 0; c < columns; ++c )
+    {
+      const int64_t v = r * ( columns + 1 ) + c + 1;
+      fprintf( file, "E4Q %lld %lld %lld %lld %lld 1\n",
+               static_cast<long long>( faceId++ ),
+               static_cast<long long>( v ),
+               static_cast<long long>( v + 1 ),
+               static_cast<long long>( v + columns + 2 ),
+               static_cast<long long>( v + columns + 1 ) );
+    }
+  }
+  return fclose( file ) == 0;
+}
+
+//! Loads the mesh and iterates its vertices and faces
+static MeshH benchMesh( const std::string &path, Result &result )
+{
+  Timer openTimer;
+  MeshH mesh = MDAL_LoadMesh( path.c_str() );
+  if ( !mesh )
+  {
+    result.error = "load failed with status " + std::to_string( MDAL_LastStatus() );
+    return nullptr;
+  }
+  result.add( "open_s", openTimer.seconds() );
+  result.add( "vertices", static_cast<double>( MDAL_M_vertexCount( mesh ) ) );
+  result.add( "faces", static_cast<double>( MDAL_M_faceCount( mesh ) ) );
+
+  // memory meshes return nothing for blocks larger than the mesh
+  const int vertexBlock = std::max( 1, std::min( ITERATOR_BLOCK, MDAL_M_vertexCount( mesh ) ) );
+  std::vector<double> coordinates( 3 * static_cast<size_t>( vertexBlock ) );
+  Timer vertexTimer;
+  int64_t vertices = 0;
+  MeshVertexIteratorH vertexIterator = MDAL_M_vertexIterator( mesh );
+  while ( int count = MDAL_VI_next( vertexIterator, vertexBlock, coordinates.data() ) )
+    vertices += count;
+  MDAL_VI_close( vertexIterator );
+  result.add( "vertex_iteration_per_s", static_cast<double>( vertices ) / std::max( vertexTimer.seconds(), 1e-9 ) );
+
+  const int maxVertices = MDAL_M_faceVerticesMaximumCount( mesh );
+  std::vector<int> offsets( ITERATOR_BLOCK );
+  std::vector<int> indices( static_cast<size_t>( ITERATOR_BLOCK ) * static_cast<size_t>( std::max( maxVertices, 1 ) ) );
+  Timer faceTimer;
+  int64_t faces = 0;
+  MeshFaceIteratorH faceIterator = MDAL_M_faceIterator( mesh );
+  while ( int count = MDAL_FI_next( faceIterator, ITERATOR_BLOCK, offsets.data(), static_cast<int>( indices.size() ), indices.data() ) )
+    faces += count;
+  MDAL_FI_close( faceIterator );
+  result.add( "face_iteration_per_s", static_cast<double>( faces ) / std::max( faceTimer.seconds(), 1e-9 ) );
+  return mesh;
+}
+
+//! Writes group of the datasets with time steps by the driver
+static bool writeDatasets( MeshH mesh, const std::string &driverName, const std::string &path, MDAL_DataLocation location, int timesteps )
+{
+  DriverH driver = MDAL_driverFromName( driverName.c_str() );
+  if ( !driver )
+    return false;
+
+  DatasetGroupH group = MDAL_M_addDatasetGroup( mesh, "bench", location, true, driver, path.c_str() );
+  if ( !group )
+    return false;
+
+  const size_t count = static_cast<size_t>( location == MDAL_DataLocation::DataOnFaces2D ? MDAL_M_faceCount( mesh ) : MDAL_M_vertexCount( mesh ) );
+  std::vector<double> values( count );
+  for ( int t = 0; t < timesteps; ++t )
+  {
+    for ( size_t i = 0; i < count; ++i )
+      values[i] = std::cos( 0.001 * static_cast<double>( i ) + t );
+    if ( !MDAL_G_addDataset( group, t, values.data(), nullptr ) )
+      return false;
+  }
+  MDAL_G_closeEditMode( group );
+  return !MDAL_G_isInEditMode( group );
+}
+
+//! Loads the datasets on the mesh, reads all their values and calculates statistics
+static void benchDatasets( const std::string &meshPath, const std::string &path, Result &result )
+{
+  MeshH mesh = MDAL_LoadMesh( meshPath.c_str() );
+  if ( !mesh )
+  {
+    result.error = "mesh load failed with status " + std::to_string( MDAL_LastStatus() );
+    return;
+  }
+
+  const int groupsBefore = MDAL_M_datasetGroupCount( mesh );
+  Timer openTimer;
+  MDAL_M_LoadDatasets( mesh, path.c_str() );
+  if ( MDAL_M_datasetGroupCount( mesh ) <= groupsBefore )
+  {
+    result.error = "load failed with status " + std::to_string( MDAL_LastStatus() );
+    MDAL_CloseMesh( mesh );
+    return;
+  }
+  result.add( "open_s", openTimer.seconds() );
+
+  DatasetGroupH group = MDAL_M_datasetGroup( mesh, MDAL_M_datasetGroupCount( mesh ) - 1 );
+  std::vector<double> values( ITERATOR_BLOCK );
+  Timer readTimer;
+  int64_t read = 0;
+  for ( int d = 0; d < MDAL_G_datasetCount( group ); ++d )
+  {
+    DatasetH dataset = MDAL_G_dataset( group, d );
+    const int count = MDAL_D_valueCount( dataset );
+    for ( int start = 0; start < count; start += ITERATOR_BLOCK )
+      read += MDAL_D_data( dataset, start, std::min( ITERATOR_BLOCK, count - start ), MDAL_DataType::SCALAR_DOUBLE, values.data() );
+  }
+  result.add( "data_values_per_s", static_cast<double>( read ) / std::max( readTimer.seconds(), 1e-9 ) );
+
+  Timer statisticsTimer;
+  double min, max;
+  MDAL_G_minimumMaximum( group, &min, &max );
+  result.add( "statistics_s", statisticsTimer.seconds() );
+  MDAL_CloseMesh( mesh );
+}
+
+static void printJson( std::ostream &out, const Options &options, const std::vector<Result> &results )
+{
+  out << "{\n  \"mdal_version\": \"" << MDAL_Version() << "\",\n"
+      << "  \"requested_faces\": " << options.faces << ",\n"
+      << "  \"timesteps\": " << options.timesteps << ",\n"
+      << "  \"results\": [";
+  for ( size_t i = 0; i < results.size(); ++i )
+  {
+    const Result &result = results[i];
+    out << ( i > 0 ? "," : "" ) << "\n    {\n      \"format\": \"" << result.format << "\"";
+    for ( const auto &value : result.values )
+      out << ",\n      \"" << value.first << "\": " << value.second;
+    if ( !result.error.empty() )
+      out << ",\n      \"error\": \"" << result.error << "\"";
+    out << "\n    }";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static void printHelp()
+{
+  std::cout << "mdal_bench [-h] [--faces count] [--timesteps count] [--formats 2DM,Ugrid,ASCII_DAT,BINARY_DAT,FLO2D]" << std::endl
+            << "           [--dir directory] [--output file.json] [--keep]" << std::endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  std::vector<std::string> args( argv + 1, argv + argc );
+  Options options;
+  for ( size_t i = 0; i < args.size(); ++i )
+  {
+    const std::string &arg = args[i];
+    const bool hasValue = i + 1 < args.size();
+    if ( arg == "-h" )
+    {
+      printHelp();
+      return EXIT_SUCCESS;
+    }
+    else if ( arg == "--keep" )
+      options.keepFiles = true;
+    else if ( arg == "--faces" && hasValue )
+      options.faces = std::atoll( args[++i].c_str() );
+    else if ( arg == "--timesteps" && hasValue )
+      options.timesteps = std::atoi( args[++i].c_str() );
+    else if ( arg == "--formats" && hasValue )
+      options.formats = split( args[++i], ',' );
+    else if ( arg == "--dir" && hasValue )
+      options.directory = args[++i];
+    else if ( arg == "--output" && hasValue )
+      options.output = args[++i];
+    else
+    {
+      std::cerr << "Invalid argument " << arg << std::endl;
+      printHelp();
+      return EXIT_FAILURE;
+    }
+  }
+  if ( options.faces < 1 || options.timesteps < 1 )
+  {
+    std::cerr << "Faces and time steps must be positive" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::string base = options.directory + "/mdal_bench_" + std::to_string( options.faces );
+  const std::string gridPath = base + ".2dm";
+  std::vector<std::string> writtenFiles = { gridPath };
+  std::vector<Result> results;
+
+  Timer generateTimer;
+  if ( !writeGrid2dm( gridPath, options.faces ) )
+  {
+    std::cerr << "Unable to write " << gridPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  const double generateSeconds = generateTimer.seconds();
+
+  // datasets are written on the mesh loaded from the 2DM file
+  MeshH gridMesh = MDAL_LoadMesh( gridPath.c_str() );
+  if ( !gridMesh )
+  {
+    std::cerr << "Unable to load " << gridPath << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  for ( const std::string &format : options.formats )
+  {
+    Result result;
+    result.format = format;
+    DriverH driver = MDAL_driverFromName( format.c_str() );
+    if ( !driver )
+    {
+      result.error = "driver not available";
+      results.push_back( result );
+      continue;
+    }
+
+    if ( MDAL_DR_saveMeshCapability( driver ) )
+    {
+      std::string path = gridPath;
+      if ( format == "2DM" )
+        result.add( "write_s", generateSeconds );
+      else
+      {
+        path = base + "_" + format + "." + driverExtension( driver );
+        Timer writeTimer;
+        MDAL_SaveMesh( gridMesh, path.c_str(), format.c_str() );
+        result.add( "write_s", writeTimer.seconds() );
+        writtenFiles.push_back( path );
+      }
+      MeshH mesh = benchMesh( path, result );
+      if ( mesh )
+        MDAL_CloseMesh( mesh );
+    }
+    else
+    {
+      const MDAL_DataLocation location = MDAL_DR_writeDatasetsCapability( driver, MDAL_DataLocation::DataOnVertices2D ) ?
+                                         MDAL_DataLocation::DataOnVertices2D : MDAL_DataLocation::DataOnFaces2D;
+      const std::string path = base + "_" + format + "." + driverExtension( driver );
+      Timer writeTimer;
+      if ( writeDatasets( gridMesh, format, path, location, options.timesteps ) )
+      {
+        result.add( "write_s", writeTimer.seconds() );
+        writtenFiles.push_back( path );
+        benchDatasets( gridPath, path, result );
+      }
+      else
+        result.error = "write failed with status " + std::to_string( MDAL_LastStatus() );
+    }
+    result.add( "peak_rss_kb", peakRssKb() );
+    results.push_back( result );
+  }
+  MDAL_CloseMesh( gridMesh );
+
+  if ( !options.keepFiles )
+  {
+    for ( const std::string &file : writtenFiles )
+      remove( file.c_str() );
+  }
+
+  if ( options.output.empty() )
+    printJson( std::cout, options, results );
+  else
+  {
+    std::ofstream out( options.output );
+    printJson( out, options, results );
+  }
+  return EXIT_SUCCESS;
+}
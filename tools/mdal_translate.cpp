@@ -5,9 +5,25 @@
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include <exception>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
+
 #include "mdal_config.hpp"
 #include "mdal.h"
 
@@ -27,7 +43,8 @@ void printFormats()
 
 void printHelp()
 {
-  std::cout << "mdal_translate [-h] -of format src_mesh dst_mesh" << std::endl;
+  std::cout << "mdal_translate [-h] [-j jobs] -of format src_mesh dst_mesh" << std::endl;
+  std::cout << "mdal_translate [-h] [-j jobs] -of format -batch dst_dir src_mesh [src_mesh ...]" << std::endl;
   printFormats();
 }
 
@@ -49,6 +66,148 @@ void saveMeshAs( MeshH mesh, const std::string &format, const std::string &outpu
     throw std::runtime_error( "Saving mesh file failed" );
 }
 
+void translate( const std::string &meshFile, const std::string &format, const std::string &destFile )
+{
+  // Load Mesh
+  MeshH mesh = loadMeshFile( meshFile );
+
+  // Save Mesh
+  try
+  {
+    saveMeshAs( mesh, format, destFile );
+  }
+  catch ( ... )
+  {
+    MDAL_CloseMesh( mesh );
+    throw;
+  }
+  MDAL_CloseMesh( mesh );
+}
+
+//! Returns the path of the converted file in the directory: name of the source file with the first extension of the driver
+std::string batchDestination( const std::string &meshFile, const std::string &format, const std::string &destDir )
+{
+  std::string name = meshFile.substr( meshFile.find_last_of( "/\\" ) + 1 );
+  const size_t dot = name.find_last_of( '.' );
+  if ( dot != std::string::npos && dot > 0 )
+    name = name.substr( 0, dot );
+
+  std::string extension;
+  const std::string filters = MDAL_DR_filters( MDAL_driverFromName( format.c_str() ) );
+  const size_t start = filters.find( "*." );
+  if ( start != std::string::npos )
+    extension = filters.substr( start + 1, filters.find_first_of( "; ", start ) - start - 1 );
+
+  return destDir + "/" + name + extension;
+}
+
+#ifdef _WIN32
+//! Quotes the argument for the command line of CreateProcess, parsed back by the rules of CommandLineToArgvW
+static std::string quoteArgument( const std::string &argument )
+{
+  std::string quoted = "\"";
+  size_t backslashes = 0;
+  for ( char c : argument )
+  {
+    if ( c == '\\' )
+    {
+      ++backslashes;
+      continue;
+    }
+    // backslashes are literal unless they precede a quote
+    quoted.append( c == '"' ? 2 * backslashes + 1 : backslashes, '\\' );
+    backslashes = 0;
+    quoted.push_back( c );
+  }
+  quoted.append( 2 * backslashes, '\\' );
+  quoted.push_back( '"' );
+  return quoted;
+}
+#endif
+
+//! Runs the program with the arguments without a shell, waits for it and returns whether it exited with success
+static bool runProcess( const std::string &program, const std::vector<std::string> &arguments )
+{
+#ifdef _WIN32
+  std::string commandLine = quoteArgument( program );
+  for ( const std::string &argument : arguments )
+    commandLine += " " + quoteArgument( argument );
+
+  STARTUPINFOA startupInfo = {};
+  startupInfo.cb = sizeof( startupInfo );
+  PROCESS_INFORMATION processInfo = {};
+  if ( !CreateProcessA( program.c_str(), &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo ) )
+    return false;
+  WaitForSingleObject( processInfo.hProcess, INFINITE );
+  DWORD exitCode = EXIT_FAILURE;
+  GetExitCodeProcess( processInfo.hProcess, &exitCode );
+  CloseHandle( processInfo.hThread );
+  CloseHandle( processInfo.hProcess );
+  return exitCode == EXIT_SUCCESS;
+#else
+  std::vector<std::string> argv( 1, program );
+  argv.insert( argv.end(), arguments.begin(), arguments.end() );
+  std::vector<char *> argvPointers;
+  for ( std::string &argument : argv )
+    argvPointers.push_back( &argument[0] );
+  argvPointers.push_back( nullptr );
+
+  pid_t pid;
+  if ( posix_spawnp( &pid, program.c_str(), nullptr, nullptr, argvPointers.data(), environ ) != 0 )
+    return false;
+  int status = 0;
+  while ( waitpid( pid, &status, 0 ) == -1 )
+  {
+    if ( errno != EINTR )
+      return false;
+  }
+  return WIFEXITED( status ) && WEXITSTATUS( status ) == EXIT_SUCCESS;
+#endif
+}
+
+/**
+ * Converts the files by jobs running concurrently, returns number of the failed ones
+ *
+ * The library serializes loads and saves within a process and its status is kept per thread,
+ * so each file is converted by a child process of this tool, started from a pool of threads.
+ * The child gets its arguments as an argument vector, no shell parses the file names.
+ */
+int translateBatch( const std::string &program, const std::vector<std::string> &meshFiles, const std::string &format, const std::string &destDir, int jobs )
+{
+  std::atomic<size_t> nextFile( 0 );
+  std::atomic<int> failures( 0 );
+  std::mutex outputMutex;
+
+  auto worker = [&]()
+  {
+    for ( size_t i = nextFile++; i < meshFiles.size(); i = nextFile++ )
+    {
+      const std::string destFile = batchDestination( meshFiles[i], format, destDir );
+      const bool ok = runProcess( program, { "-of", format, meshFiles[i], destFile } );
+
+      std::lock_guard<std::mutex> lock( outputMutex );
+      if ( ok )
+      {
+        std::cout << meshFiles[i] << " -> " << destFile << std::endl;
+      }
+      else
+      {
+        ++failures;
+        std::cout << meshFiles[i] << ": FAILED" << std::endl;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for ( int i = 1; i < jobs; ++i )
+    threads.emplace_back( worker );
+  worker();
+  for ( std::thread &thread : threads )
+    thread.join();
+
+  return failures;
+}
+
 int main( int argc, char *argv[] )
 {
   std::vector<std::string> args( static_cast<size_t>( argc ) );
@@ -63,23 +222,62 @@ int main( int argc, char *argv[] )
     return EXIT_SUCCESS;
   }
 
-  if ( args.size() < 5 )
+  std::string format;
+  std::string batchDir;
+  int jobs = 1;
+  std::vector<std::string> files;
+  for ( size_t i = 1; i < args.size(); ++i )
+  {
+    const bool hasValue = i + 1 < args.size();
+    if ( args[i] == "-of" && hasValue )
+      format = args[++i];
+    else if ( args[i] == "-j" && hasValue )
+      jobs = std::max( 1, std::atoi( args[++i].c_str() ) );
+    else if ( args[i] == "-batch" && hasValue )
+      batchDir = args[++i];
+    else
+      files.push_back( args[i] );
+  }
+
+  if ( format.empty() || files.empty() || ( batchDir.empty() && files.size() != 2 ) )
   {
     printHelp();
     return EXIT_FAILURE;
   }
 
-  std::string format = args[2];
-  std::string meshFile = args[3];
-  std::string destFile = args[4];
+  if ( !batchDir.empty() )
+  {
+    if ( !MDAL_driverFromName( format.c_str() ) )
+    {
+      std::cout << "Error has accoured: Unknown format " << format << std::endl;
+      return EXIT_FAILURE;
+    }
+    // files of the same name from different directories would overwrite each other's output
+    std::map<std::string, std::string> sources;
+    for ( const std::string &file : files )
+    {
+      const std::string destFile = batchDestination( file, format, batchDir );
+      auto inserted = sources.emplace( destFile, file );
+      if ( !inserted.second )
+      {
+        std::cout << "Error has accoured: " << inserted.first->second << " and " << file
+                  << " would both be converted to " << destFile << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+
+    const int failures = translateBatch( args[0], files, format, batchDir, jobs );
+    if ( failures > 0 )
+    {
+      std::cout << failures << " of " << files.size() << " files failed" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
 
   try
   {
-    // Load Mesh
-    MeshH mesh = loadMeshFile( meshFile );
-
-    // Save Mesh
-    saveMeshAs( mesh, format, destFile );
+    translate( files[0], format, files[1] );
   }
   catch ( std::exception &e )
   {
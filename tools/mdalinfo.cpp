@@ -5,10 +5,16 @@
 
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 #include <limits>
+#include <map>
 #include <string>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
 #include "mdal_config.hpp"
 #include "mdal.h"
 
@@ -62,6 +68,141 @@ void printFormats()
   }
 }
 
+static double secondsSince( const std::chrono::steady_clock::time_point &start )
+{
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+//! Current values of MDAL performance counters, empty when MDAL is built without them
+static std::map<std::string, long long> perfCounters()
+{
+  std::map<std::string, long long> ret;
+  const int count = MDAL_GetPerfCounters( nullptr, nullptr, 0 );
+  std::vector<const char *> names( static_cast<size_t>( count ) );
+  std::vector<long long> values( static_cast<size_t>( count ) );
+  MDAL_GetPerfCounters( names.data(), values.data(), count );
+  for ( size_t i = 0; i < names.size(); ++i )
+    ret[names[i]] = values[i];
+  return ret;
+}
+
+//! Peak resident set size of the process in kB, 0 when not available
+static long peakRssKb()
+{
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    return 0;
+#ifdef __APPLE__
+  return static_cast<long>( usage.ru_maxrss / 1024 ); // bytes
+#else
+  return static_cast<long>( usage.ru_maxrss );
+#endif
+#endif
+}
+
+//! Reads all values of all datasets of the group, returns number of bytes read
+static long long readAllDatasets( DatasetGroupH group )
+{
+  const int blockSize = 65536;
+  const bool isScalar = MDAL_G_hasScalarData( group );
+  const bool isVolume = MDAL_G_dataLocation( group ) == MDAL_DataLocation::DataOnVolumes3D;
+  MDAL_DataType type;
+  if ( isVolume )
+    type = isScalar ? MDAL_DataType::SCALAR_VOLUMES_DOUBLE : MDAL_DataType::VECTOR_2D_VOLUMES_DOUBLE;
+  else
+    type = isScalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE;
+  const int valuesPerElement = isScalar ? 1 : 2;
+
+  std::vector<double> buffer( static_cast<size_t>( blockSize * valuesPerElement ) );
+  long long bytes = 0;
+  for ( int i = 0; i < MDAL_G_datasetCount( group ); ++i )
+  {
+    DatasetH dataset = MDAL_G_dataset( group, i );
+    const int count = MDAL_D_valueCount( dataset );
+    for ( int start = 0; start < count; start += blockSize )
+    {
+      const int read = MDAL_D_data( dataset, start, std::min( blockSize, count - start ), type, buffer.data() );
+      if ( read == 0 )
+        break;
+      bytes += static_cast<long long>( read ) * valuesPerElement * static_cast<long long>( sizeof( double ) );
+    }
+  }
+  return bytes;
+}
+
+/**
+ * Requests statistics of all groups, which are calculated on the first request unless they are cached,
+ * returns the time of the calculation of statistics including the statistics calculated by the load,
+ * the wall time of the requests when MDAL is built without ENABLE_PERF_COUNTERS
+ */
+static double calculateStatistics( MeshH m )
+{
+  const auto start = std::chrono::steady_clock::now();
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    double min, max;
+    MDAL_G_minimumMaximum( MDAL_M_datasetGroup( m, i ), &min, &max );
+  }
+  const double requestsTime = secondsSince( start );
+
+  std::map<std::string, long long> counters = perfCounters();
+  if ( counters.empty() )
+    return requestsTime;
+  return static_cast<double>( counters["statistics.time_us"] ) / 1e6;
+}
+
+/**
+ * Prints wall time of the phases of the load, bytes read, peak memory
+ * and read throughput of the dataset groups, to triage slow files
+ */
+void printProfile( MeshH m, double meshLoadTime, double datasetsLoadTime, double statisticsTime )
+{
+  std::map<std::string, long long> counters = perfCounters();
+  std::cout << "Profile:" << std::endl;
+  std::cout << "  Mesh load:        " << meshLoadTime << " s" << std::endl;
+  if ( !counters.empty() )
+  {
+    const double driverTime = static_cast<double>( counters["driver." + std::string( MDAL_M_driverName( m ) ) + ".load.time_us"] ) / 1e6;
+    const double loadTime = static_cast<double>( counters["load.time_us"] ) / 1e6;
+    std::cout << "    detection:      " << std::max( loadTime - driverTime, 0.0 ) << " s" << std::endl;
+    std::cout << "    mesh parse:     " << driverTime << " s" << std::endl;
+  }
+  std::cout << "  Datasets load:    " << datasetsLoadTime << " s" << std::endl;
+  std::cout << "  Statistics:       " << statisticsTime << " s" << std::endl;
+  std::cout << "  Dataset reads:" << std::endl;
+  for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
+  {
+    DatasetGroupH group = MDAL_M_datasetGroup( m, i );
+    const auto start = std::chrono::steady_clock::now();
+    const long long bytes = readAllDatasets( group );
+    const double time = secondsSince( start );
+    std::cout << "    " << MDAL_G_name( group ) << ": "
+              << MDAL_G_datasetCount( group ) << " datasets, "
+              << bytes << " bytes in " << time << " s";
+    if ( time > 0 )
+      std::cout << " (" << static_cast<double>( bytes ) / time / 1e6 << " MB/s)";
+    std::cout << std::endl;
+  }
+
+  // including the reads of the datasets above
+  counters = perfCounters();
+  if ( !counters.empty() )
+  {
+    std::cout << "  Bytes read:       " << counters["hdf5.bytes"] + counters["netcdf.bytes"] + counters["mapped_file.bytes"]
+              << " (HDF5 " << counters["hdf5.bytes"]
+              << ", NetCDF " << counters["netcdf.bytes"]
+              << ", mapped " << counters["mapped_file.bytes"] << ")" << std::endl;
+  }
+  else
+  {
+    std::cout << "  Bytes read:       not available, MDAL is built without ENABLE_PERF_COUNTERS" << std::endl;
+  }
+
+  std::cout << "  Peak RSS:         " << peakRssKb() << " kB" << std::endl;
+}
 
 int main( int argc, char *argv[] )
 {
@@ -74,7 +215,7 @@ int main( int argc, char *argv[] )
   // PARSE ARGS
   if ( std::find( args.begin(), args.end(), "-h" ) != args.end() )
   {
-    std::cout << "mdalinfo mesh_file [dataset_file ...] [-h] [--formats] [--stats]" << std::endl;
+    std::cout << "mdalinfo mesh_file [dataset_file ...] [-h] [--formats] [--stats] [--profile]" << std::endl;
     return EXIT_SUCCESS;
   }
 
@@ -93,6 +234,16 @@ int main( int argc, char *argv[] )
     --argc;
   }
 
+  bool profile = false;
+  it = std::find( args.begin(), args.end(),  "--profile" );
+  if ( it != args.end() )
+  {
+    profile = true;
+    args.erase( it );
+    --argc;
+    MDAL_ResetPerfCounters();
+  }
+
   if ( argc < 2 ) // no mesh argument
   {
     std::cout << "Missing mesh file argument" << std::endl;
@@ -110,7 +261,9 @@ int main( int argc, char *argv[] )
 
   // MESH
   std::cout << "Mesh File: " << mesh_file << std::endl;
+  auto start = std::chrono::steady_clock::now();
   MeshH m = MDAL_LoadMesh( mesh_file.c_str() );
+  const double meshLoadTime = secondsSince( start );
   if ( m )
   {
     std::cout << "Mesh loaded: OK" << std::endl;
@@ -130,6 +283,7 @@ int main( int argc, char *argv[] )
   }
 
   // EXTRA DATASETS
+  start = std::chrono::steady_clock::now();
   for ( const std::string &dataset : extraDatasets )
   {
     std::cout << "Dataset File: " << dataset << std::endl;
@@ -142,6 +296,9 @@ int main( int argc, char *argv[] )
     }
   }
 
+  const double datasetsLoadTime = secondsSince( start );
+  const double statisticsTime = profile ? calculateStatistics( m ) : 0;
+
   std::cout << "Datasets loaded: OK" << std::endl;
   std::cout << "  Groups count: " << MDAL_M_datasetGroupCount( m ) <<  std::endl;
   for ( int i = 0; i < MDAL_M_datasetGroupCount( m ); ++i )
@@ -181,6 +338,9 @@ int main( int argc, char *argv[] )
     std::cout << std::endl;
   }
 
+  if ( profile )
+    printProfile( m, meshLoadTime, datasetsLoadTime, statisticsTime );
+
   MDAL_CloseMesh( m );
   return EXIT_SUCCESS;
 }